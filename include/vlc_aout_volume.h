@@ -24,6 +24,8 @@
 #ifndef VLC_AOUT_MIXER_H
 #define VLC_AOUT_MIXER_H 1
 
+#include <math.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -38,6 +40,17 @@ extern "C" {
 
 typedef struct audio_volume audio_volume_t;
 
+/**
+ * Gain ramp over a buffer, from frame to frame
+ */
+typedef struct audio_volume_ramp
+{
+    float from; /**< Gain of the first frame */
+    float to; /**< Gain of the frame following the buffer */
+    bool exponential; /**< Constant ratio between frames, rather than
+                           constant steps, i.e. linear in decibels */
+} audio_volume_ramp_t;
+
 /**
  * Audio volume
  */
@@ -47,8 +60,61 @@ struct audio_volume
 
     vlc_fourcc_t format; /**< Audio samples format */
     void (*amplify)(audio_volume_t *, block_t *, float); /**< Amplifier */
+
+    /**
+     * Amplifier with a gain ramp (optional)
+     *
+     * \param channels number of interleaved channels
+     */
+    void (*ramp)(audio_volume_t *, block_t *, unsigned channels,
+                 const audio_volume_ramp_t *);
+
+    /**
+     * Mixer (optional)
+     *
+     * Writes the sum of the inputs, each with its own gain ramp, to the
+     * output buffer. The inputs are at least as long as the output, and
+     * only the first one can be the output buffer.
+     *
+     * \param channels number of interleaved channels
+     */
+    void (*mix)(audio_volume_t *, block_t *out, block_t *const *in,
+                const audio_volume_ramp_t *ramps, unsigned count,
+                unsigned channels);
 };
 
+/**
+ * Gets the ramp between two gains.
+ *
+ * The ramp is exponential, so that the loudness changes at a constant pace,
+ * unless one of the gains is silent.
+ */
+static inline audio_volume_ramp_t audio_volume_Ramp(float from, float to)
+{
+    audio_volume_ramp_t ramp = { from, to, from > 0.f && to > 0.f };
+    return ramp;
+}
+
+/**
+ * Gets the progression of a gain ramp over a number of frames.
+ *
+ * The gain of a frame is the gain of the previous frame multiplied by the
+ * ratio, plus the step.
+ */
+static inline void audio_volume_RampProgression(const audio_volume_ramp_t *ramp,
+                                                size_t frames, double *ratio,
+                                                double *step)
+{
+    *ratio = 1.;
+    *step = 0.;
+    if (frames == 0 || ramp->from == ramp->to)
+        return;
+    if (ramp->exponential)
+        *ratio = pow((double)ramp->to / ramp->from, 1. / frames);
+    else
+        *step = ((double)ramp->to - ramp->from) / frames;
+}
+
 /** @} */
 
 #ifdef __cplusplus
@@ -107,8 +107,10 @@ VLC_API unsigned vlc_CPU(void);
 
 # ifdef __AVX2__
 #  define vlc_CPU_AVX2() (1)
+#  define VLC_AVX2
 # else
 #  define vlc_CPU_AVX2() ((vlc_CPU() & VLC_CPU_AVX2) != 0)
+#  define VLC_AVX2 __attribute__ ((__target__ ("avx2")))
 # endif
 
 # ifdef __3dNOW__
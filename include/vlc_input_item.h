@@ -433,10 +433,17 @@ struct input_stats_t
     /* Vout */
     int64_t i_displayed_pictures;
     int64_t i_lost_pictures;
+    int64_t i_late_pictures;            /**< displayed past their deadline */
+    vlc_tick_t i_display_offset_avg;    /**< mean absolute display offset */
+    vlc_tick_t i_display_offset_max;    /**< peak absolute display offset */
 
     /* Aout */
     int64_t i_played_abuffers;
     int64_t i_lost_abuffers;
+
+    /* Clock (live streams in low latency mode) */
+    vlc_tick_t i_clock_jitter;   /**< peak to peak arrival jitter */
+    vlc_tick_t i_clock_headroom; /**< buffering left before being late */
 };
 
 /**
@@ -225,6 +225,25 @@ VLC_API void picture_Reset( picture_t * );
 VLC_API void picture_CopyPixels( picture_t *p_dst, const picture_t *p_src );
 VLC_API void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src );
 
+/**
+ * This function will copy the pixels of a rectangular area of a picture.
+ *
+ * The area is given in pixels of the picture format, including the crop
+ * offsets, and is extended as needed to cover whole chroma samples.
+ * Both pictures must have the same chroma and the area is clipped to the
+ * smaller one.
+ *
+ * \param p_dst pointer to the destination picture.
+ * \param p_src pointer to the source picture.
+ * \param i_x horizontal position of the area
+ * \param i_y vertical position of the area
+ * \param i_width width of the area
+ * \param i_height height of the area
+ */
+VLC_API void picture_CopyArea( picture_t *p_dst, const picture_t *p_src,
+                               unsigned i_x, unsigned i_y,
+                               unsigned i_width, unsigned i_height );
+
 /**
  * This function will copy both picture dynamic properties and pixels.
  * You have to notice that sometime a simple picture_Hold may do what
@@ -1203,6 +1203,18 @@ vlc_player_Resume(vlc_player_t *player);
 VLC_API void
 vlc_player_NextVideoFrame(vlc_player_t *player);
 
+/**
+ * Pause and display the previous video frame
+ *
+ * @note Stepping back is fast when the previous frames are still in the
+ * scrubbing cache (see the "scrub-cache" option), otherwise it decodes again
+ * from the previous keyframe.
+ *
+ * @param player locked player instance
+ */
+VLC_API void
+vlc_player_PreviousVideoFrame(vlc_player_t *player);
+
 /**
  * Get the state of the player
  *
@@ -231,6 +231,68 @@ VLC_USED;
  */
 VLC_API ssize_t vlc_stream_Peek(stream_t *, const uint8_t **, size_t) VLC_USED;
 
+/**
+ * Peeks at data from a byte stream without copying.
+ *
+ * This function works like vlc_stream_Peek(), except that the data is not
+ * gathered into a single contiguous buffer. Instead, it stores a pointer to
+ * a chain of one or more blocks (linked by their p_next field) which together
+ * cover at least the returned number of bytes. This avoids reallocating and
+ * copying when peeking large amounts of data, e.g. while probing.
+ *
+ * The chain may extend beyond the requested length. It belongs to the stream
+ * and must neither be modified nor released. It remains valid until the next
+ * read/peek or seek operation on the same stream.
+ *
+ * \see vlc_stream_ChainAt() to access bytes within the chain
+ *
+ * \param chainp storage space for the first block of the chain [OUT]
+ * \param len number of bytes to peek
+ * \return the number of bytes actually available (shorter than requested if
+ * the end-of-stream is reached), or a negative value on error.
+ */
+VLC_API ssize_t vlc_stream_PeekChain(stream_t *, const block_t **,
+                                     size_t) VLC_USED;
+
+/**
+ * Gets contiguous bytes from a peeked block chain.
+ *
+ * \param chain block chain from vlc_stream_PeekChain()
+ * \param offset byte offset from the start of the chain
+ * \param len number of contiguous bytes needed
+ * \param buf scratch buffer of at least len bytes, used only if the bytes
+ *            straddle a block boundary
+ * \return a pointer to len bytes, or NULL if the chain is too short
+ */
+static inline const uint8_t *vlc_stream_ChainAt(const block_t *chain,
+                                                size_t offset, size_t len,
+                                                uint8_t *buf)
+{
+    while (chain != NULL && offset >= chain->i_buffer)
+    {
+        offset -= chain->i_buffer;
+        chain = chain->p_next;
+    }
+
+    if (chain == NULL)
+        return NULL;
+    if (len <= chain->i_buffer - offset)
+        return chain->p_buffer + offset;
+
+    for (size_t copied = 0; copied < len; chain = chain->p_next)
+    {
+        if (chain == NULL)
+            return NULL;
+
+        size_t copy = __MIN(chain->i_buffer - offset, len - copied);
+
+        memcpy(buf + copied, chain->p_buffer + offset, copy);
+        copied += copy;
+        offset = 0;
+    }
+    return buf;
+}
+
 /**
  * Reads a data block from a byte stream.
  *
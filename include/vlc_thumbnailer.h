@@ -43,6 +43,27 @@ typedef struct vlc_thumbnailer_request_t vlc_thumbnailer_request_t;
  */
 typedef void(*vlc_thumbnailer_cb)( void* data, picture_t* thumbnail );
 
+/**
+ * \brief vlc_thumbnailer_batch_cb defines a callback invoked for each
+ * thumbnail of a batch request
+ *
+ * This callback will be called once for each requested time, provided
+ * vlc_thumbnailer_RequestBatch returned a non NULL request, and provided the
+ * request is not cancelled before its completion.
+ * It is called from a worker thread, and not necessarily in the order of the
+ * requested times, but never concurrently for a given request.
+ * The picture, if any, is owned by the thumbnailer, and must be acquired by
+ * using \link picture_Hold \endlink to use it pass the callback's scope.
+ *
+ * \param data Is the opaque pointer passed as vlc_thumbnailer_RequestBatch
+ *             last parameter
+ * \param index The index of the thumbnail time in the requested times
+ * \param thumbnail The generated thumbnail, or NULL in case of failure or
+ *                  timeout
+ */
+typedef void(*vlc_thumbnailer_batch_cb)( void* data, size_t index,
+                                         picture_t* thumbnail );
+
 
 /**
  * \brief vlc_thumbnailer_Create Creates a thumbnailer object
@@ -112,6 +133,46 @@ vlc_thumbnailer_RequestByPos( vlc_thumbnailer_t *thumbnailer,
                               input_item_t *input_item, vlc_tick_t timeout,
                               vlc_thumbnailer_cb cb, void* user_data );
 
+/**
+ * \brief vlc_thumbnailer_RequestBatch Requests thumbnails at several times
+ * \param thumbnailer A thumbnailer object
+ * \param times The times at which the thumbnails should be taken
+ * \param count The number of times
+ * \param speed The seeking speed \sa{enum vlc_thumbnailer_seek_speed}
+ * \param width The maximum width of the thumbnails, or 0
+ * \param height The maximum height of the thumbnails, or 0
+ * \param input_item The input item to generate the thumbnails for
+ * \param timeout A timeout value for the whole batch, or VLC_TICK_INVALID to
+ *                disable timeout
+ * \param cb A user callback to be called for each thumbnail (success & error)
+ * \param user_data An opaque value, provided as pf_cb's first parameter
+ * \return An opaque request object, or NULL in case of failure
+ *
+ * The input is opened once, and the thumbnails are taken in increasing time
+ * order, each from the keyframe preceding its time. With
+ * VLC_THUMBNAILER_SEEK_FAST, that keyframe is the thumbnail; with
+ * VLC_THUMBNAILER_SEEK_PRECISE, the video is decoded from it up to the time.
+ *
+ * The thumbnails are scaled on worker threads to fit in width x height,
+ * keeping their aspect ratio. If only one of them is 0, it is computed from
+ * the other; if both are 0, the thumbnails are not scaled.
+ *
+ * If this function returns a valid request object, the callback is guaranteed
+ * to be called for each time, even in case of later failure.
+ * The returned request object must not be used after the last callback has
+ * been invoked. That request object is owned by the thumbnailer, and must not
+ * be released.
+ * The times are copied, and the provided input_item will be held by the
+ * thumbnailer: both can safely be released after calling this function.
+ */
+VLC_API vlc_thumbnailer_request_t*
+vlc_thumbnailer_RequestBatch( vlc_thumbnailer_t *thumbnailer,
+                              const vlc_tick_t *times, size_t count,
+                              enum vlc_thumbnailer_seek_speed speed,
+                              unsigned width, unsigned height,
+                              input_item_t *input_item, vlc_tick_t timeout,
+                              vlc_thumbnailer_batch_cb cb, void* user_data );
+
 /**
  * \brief vlc_thumbnailer_Cancel Cancel a thumbnail request
  * \param thumbnailer A thumbnailer object
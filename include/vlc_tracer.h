@@ -0,0 +1,88 @@
+/*****************************************************************************
+ * vlc_tracer.h: pipeline tracing interface
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_TRACER_H
+#define VLC_TRACER_H
+
+/**
+ * \defgroup tracer Tracer
+ * \ingroup os
+ * Pipeline latency tracing
+ *
+ * When a tracer module is selected with the "tracer" option, the core stamps
+ * timed data (blocks and pictures) as it crosses the boundaries of the
+ * playback pipeline stages: demux output, decoder input and output, video
+ * output filtering, preparation and display.
+ *
+ * Stamps of a same elementary stream are correlated through the stream
+ * timestamp of the data, so that a tracer module can rebuild the time spent
+ * by each frame in every stage.
+ * @{
+ * \file
+ * Tracer interface
+ */
+
+struct vlc_tracer;
+
+/**
+ * Tracer module callbacks.
+ */
+struct vlc_tracer_operations
+{
+    /**
+     * Records a stage boundary.
+     *
+     * This callback can be invoked concurrently from any thread.
+     *
+     * \param opaque module private data
+     * \param ts time when the boundary was crossed (vlc_tick_now())
+     * \param type pipeline component name (e.g. "DEMUX", "DEC", "VOUT")
+     * \param id elementary stream identifier
+     * \param stage boundary name within the component (e.g. "IN", "OUT")
+     * \param pts stream timestamp of the traced data
+     */
+    void (*trace)(void *opaque, vlc_tick_t ts, const char *type, int id,
+                  const char *stage, vlc_tick_t pts);
+    void (*destroy)(void *opaque);
+};
+
+/**
+ * Gets the tracer of the LibVLC instance.
+ *
+ * \return the tracer, or NULL if tracing is not enabled
+ */
+VLC_API struct vlc_tracer *vlc_object_get_tracer(vlc_object_t *obj);
+#define vlc_object_get_tracer(o) vlc_object_get_tracer(VLC_OBJECT(o))
+
+/**
+ * Stamps timed data of an elementary stream.
+ *
+ * \param tracer tracer (cannot be NULL)
+ * \param type pipeline component name (static string)
+ * \param id elementary stream identifier
+ * \param stage boundary name within the component (static string)
+ * \param pts stream timestamp of the data
+ */
+VLC_API void vlc_tracer_TraceStreamPTS(struct vlc_tracer *tracer,
+                                       const char *type, int id,
+                                       const char *stage, vlc_tick_t pts);
+
+/** @} */
+#endif
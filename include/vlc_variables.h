@@ -197,6 +197,70 @@ VLC_API int var_GetChecked( vlc_object_t *, const char *, int, vlc_value_t * );
 VLC_API int var_GetAndSet(vlc_object_t *obj, const char *name, int op,
                           vlc_value_t *value);
 
+/**
+ * \defgroup var_handle Variable handles
+ *
+ * Handles refer to a variable of an object without looking its name up on
+ * every access. They are meant for variables which are accessed repeatedly,
+ * e.g. once per picture or per block.
+ *
+ * A handle holds a reference to the variable, as var_Create() does, so the
+ * variable remains valid until the handle is released, even if the variable
+ * is destroyed by name in the meantime.
+ * @{
+ */
+
+typedef struct variable_t vlc_var_t;
+
+/**
+ * Gets a handle to a variable.
+ *
+ * \note The variable is not inherited from the parent objects.
+ *
+ * \param obj Object holding the variable
+ * \param name Variable name
+ * \return a variable handle, or NULL if the object has no such variable
+ */
+VLC_API vlc_var_t *var_Resolve(vlc_object_t *obj, const char *name) VLC_USED;
+
+/**
+ * Releases a variable handle.
+ *
+ * \param obj Object holding the variable
+ * \param var Variable handle from var_Resolve()
+ */
+VLC_API void var_Release(vlc_object_t *obj, vlc_var_t *var);
+
+/**
+ * Sets a variable value through a handle.
+ *
+ * This is equivalent to var_SetChecked(), without the name lookup.
+ * It still takes the variable lock, as the value must be set and the
+ * callbacks run in the same order as with var_Set().
+ *
+ * \param obj Object holding the variable
+ * \param var Variable handle from var_Resolve()
+ * \param type Expected variable type (see \ref var_type), or zero
+ * \param val Variable value to set
+ */
+VLC_API void var_HandleSet(vlc_object_t *obj, vlc_var_t *var, int type,
+                           vlc_value_t val);
+
+/**
+ * Gets a variable value through a handle.
+ *
+ * This does not take the variable lock. The value is the one set last by
+ * any thread, although it may not yet reflect a concurrent var_Set().
+ *
+ * \warning This cannot be used with string variables.
+ *
+ * \param var Variable handle from var_Resolve()
+ * \return the variable value
+ */
+VLC_API vlc_value_t var_HandleGet(const vlc_var_t *var) VLC_USED;
+
+/** @} */
+
 /**
  * Finds the value of a variable.
  *
@@ -297,6 +361,65 @@ static inline int var_SetInteger( vlc_object_t *p_obj, const char *psz_name,
     return var_SetChecked( p_obj, psz_name, VLC_VAR_INTEGER, val );
 }
 
+static inline void var_HandleSetInteger(vlc_object_t *obj, vlc_var_t *var,
+                                        int64_t i)
+{
+    vlc_value_t val;
+    val.i_int = i;
+    var_HandleSet(obj, var, VLC_VAR_INTEGER, val);
+}
+
+static inline void var_HandleSetBool(vlc_object_t *obj, vlc_var_t *var, bool b)
+{
+    vlc_value_t val;
+    val.b_bool = b;
+    var_HandleSet(obj, var, VLC_VAR_BOOL, val);
+}
+
+static inline void var_HandleSetFloat(vlc_object_t *obj, vlc_var_t *var,
+                                      float f)
+{
+    vlc_value_t val;
+    val.f_float = f;
+    var_HandleSet(obj, var, VLC_VAR_FLOAT, val);
+}
+
+static inline void var_HandleSetCoords(vlc_object_t *obj, vlc_var_t *var,
+                                       int32_t x, int32_t y)
+{
+    vlc_value_t val;
+    val.coords.x = x;
+    val.coords.y = y;
+    var_HandleSet(obj, var, VLC_VAR_COORDS, val);
+}
+
+VLC_USED
+static inline int64_t var_HandleGetInteger(const vlc_var_t *var)
+{
+    return var_HandleGet(var).i_int;
+}
+
+VLC_USED
+static inline bool var_HandleGetBool(const vlc_var_t *var)
+{
+    return var_HandleGet(var).b_bool;
+}
+
+VLC_USED
+static inline float var_HandleGetFloat(const vlc_var_t *var)
+{
+    return var_HandleGet(var).f_float;
+}
+
+static inline void var_HandleGetCoords(const vlc_var_t *var,
+                                       int32_t *px, int32_t *py)
+{
+    vlc_value_t val = var_HandleGet(var);
+
+    *px = val.coords.x;
+    *py = val.coords.y;
+}
+
 /**
  * Set the value of an boolean variable
  *
@@ -793,6 +916,14 @@ VLC_API int var_LocationParse(vlc_object_t *, const char *mrl, const char *prefi
 
 #define var_GetCoords(o,n,x,y) var_GetCoords(VLC_OBJECT(o), n, x, y)
 
+#define var_Resolve(o,n) var_Resolve(VLC_OBJECT(o), n)
+#define var_Release(o,v) var_Release(VLC_OBJECT(o), v)
+#define var_HandleSet(o,v,t,x) var_HandleSet(VLC_OBJECT(o), v, t, x)
+#define var_HandleSetInteger(o,v,i) var_HandleSetInteger(VLC_OBJECT(o), v, i)
+#define var_HandleSetBool(o,v,b) var_HandleSetBool(VLC_OBJECT(o), v, b)
+#define var_HandleSetFloat(o,v,f) var_HandleSetFloat(VLC_OBJECT(o), v, f)
+#define var_HandleSetCoords(o,v,x,y) var_HandleSetCoords(VLC_OBJECT(o), v, x, y)
+
 #define var_IncInteger(a,b) var_IncInteger(VLC_OBJECT(a), b)
 #define var_DecInteger(a,b) var_DecInteger(VLC_OBJECT(a), b)
 #define var_OrInteger(a,b,c) var_OrInteger(VLC_OBJECT(a), b, c)
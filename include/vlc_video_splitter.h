@@ -123,6 +123,54 @@ static inline int video_splitter_NewPicture(video_splitter_t *splitter,
     return VLC_SUCCESS;
 }
 
+static inline void video_splitter_ReleaseSource(picture_t *pic)
+{
+    picture_Release((picture_t *)pic->p_sys);
+}
+
+/**
+ * It will create an output picture referencing a region of the source
+ * picture, without copying it.
+ *
+ * The source picture is held until the output picture is released. The
+ * output picture must not be modified.
+ *
+ * \param i_output index of the output, setting the size of the region
+ * \param x,y top left corner of the region in the source, in pixels
+ * \return the output picture, or NULL on error
+ */
+static inline picture_t *video_splitter_NewCrop(video_splitter_t *splitter,
+                                                int i_output, picture_t *src,
+                                                unsigned x, unsigned y)
+{
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription(splitter->fmt.i_chroma);
+    if (dsc == NULL || (int)dsc->plane_count != src->i_planes)
+        return NULL;
+
+    picture_resource_t res;
+    res.p_sys = src;
+    res.pf_destroy = video_splitter_ReleaseSource;
+    for (unsigned i = 0; i < dsc->plane_count; i++) {
+        const plane_t *p = &src->p[i];
+        const unsigned px = x * dsc->p[i].w.num / dsc->p[i].w.den;
+        const unsigned py = y * dsc->p[i].h.num / dsc->p[i].h.den;
+
+        res.p[i].p_pixels = p->p_pixels + py * p->i_pitch
+                          + px * dsc->pixel_size;
+        res.p[i].i_lines = p->i_lines - py;
+        res.p[i].i_pitch = p->i_pitch;
+    }
+
+    picture_t *pic = picture_NewFromResource(&splitter->p_output[i_output].fmt,
+                                             &res);
+    if (pic == NULL)
+        return NULL;
+    picture_Hold(src);
+    picture_CopyProperties(pic, src);
+    return pic;
+}
+
 /**
  * It will release an array of pictures created by video_splitter_NewPicture.
  * Provided for convenience.
@@ -0,0 +1,685 @@
+/*****************************************************************************
+ * uring.c: asynchronous file input using Linux io_uring
+ *****************************************************************************
+ * Copyright (C) 2020 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_access.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_interrupt.h>
+
+/* Buffers are page-aligned so that they can be used with O_DIRECT. */
+#define URING_ALIGN     4096
+#define URING_MAX_DEPTH 16
+
+/*****************************************************************************
+ * Buffer pool
+ *****************************************************************************
+ * Reads land directly in the payload of the blocks handed to the stream
+ * core. The pool outlives the access if blocks are still held downstream,
+ * hence the reference count.
+ *****************************************************************************/
+struct uring_pool;
+
+struct uring_buffer
+{
+    block_t self;
+    struct uring_pool *pool;
+    unsigned index;
+};
+
+struct uring_pool
+{
+    atomic_uint refs;
+    atomic_uint free_mask; /**< buffers not currently held by a block */
+    size_t size; /**< bytes per buffer */
+    unsigned count;
+    uint8_t *base;
+    struct uring_buffer bufs[];
+};
+
+static_assert(2 * URING_MAX_DEPTH <= 32, "pool mask too small");
+
+static void PoolRelease(struct uring_pool *pool)
+{
+    if (atomic_fetch_sub_explicit(&pool->refs, 1, memory_order_acq_rel) == 1)
+    {
+        free(pool->base);
+        free(pool);
+    }
+}
+
+static void PoolBufferFree(block_t *block)
+{
+    struct uring_buffer *buf = container_of(block, struct uring_buffer, self);
+    struct uring_pool *pool = buf->pool;
+
+    atomic_fetch_or_explicit(&pool->free_mask, 1u << buf->index,
+                             memory_order_release);
+    PoolRelease(pool);
+}
+
+static const struct vlc_block_callbacks pool_cbs =
+{
+    PoolBufferFree,
+};
+
+static struct uring_pool *PoolCreate(unsigned count, size_t size)
+{
+    struct uring_pool *pool = malloc(sizeof (*pool)
+                                     + count * sizeof (pool->bufs[0]));
+    if (unlikely(pool == NULL))
+        return NULL;
+
+    pool->base = aligned_alloc(URING_ALIGN, count * size);
+    if (unlikely(pool->base == NULL))
+    {
+        free(pool);
+        return NULL;
+    }
+
+    atomic_init(&pool->refs, 1);
+    atomic_init(&pool->free_mask, (count < 32) ? (1u << count) - 1 : ~0u);
+    pool->size = size;
+    pool->count = count;
+    for (unsigned i = 0; i < count; i++)
+    {
+        pool->bufs[i].pool = pool;
+        pool->bufs[i].index = i;
+    }
+    return pool;
+}
+
+static struct uring_buffer *PoolGet(struct uring_pool *pool)
+{
+    unsigned mask = atomic_load_explicit(&pool->free_mask,
+                                         memory_order_acquire);
+    unsigned index;
+
+    do
+    {
+        if (mask == 0)
+            return NULL; /* everything is held downstream */
+        index = ctz(mask);
+    }
+    while (!atomic_compare_exchange_weak_explicit(&pool->free_mask, &mask,
+                                                  mask & ~(1u << index),
+                                                  memory_order_acquire,
+                                                  memory_order_acquire));
+
+    atomic_fetch_add_explicit(&pool->refs, 1, memory_order_relaxed);
+
+    struct uring_buffer *buf = &pool->bufs[index];
+    block_Init(&buf->self, &pool_cbs, pool->base + index * pool->size,
+               pool->size);
+    return buf;
+}
+
+static void AlignedBlockFree(block_t *block)
+{
+    free(block->p_start);
+    free(block);
+}
+
+static const struct vlc_block_callbacks aligned_cbs =
+{
+    AlignedBlockFree,
+};
+
+/**
+ * Allocates a heap block suitable for O_DIRECT, for when the pool is
+ * exhausted.
+ */
+static block_t *AlignedBlockAlloc(size_t size)
+{
+    block_t *block = malloc(sizeof (*block));
+    if (unlikely(block == NULL))
+        return NULL;
+
+    void *base = aligned_alloc(URING_ALIGN, size);
+    if (unlikely(base == NULL))
+    {
+        free(block);
+        return NULL;
+    }
+    return block_Init(block, &aligned_cbs, base, size);
+}
+
+/*****************************************************************************
+ * Ring
+ *****************************************************************************/
+struct uring_slot
+{
+    block_t *block;
+    uint64_t offset;
+    int result;
+    bool done;
+};
+
+typedef struct
+{
+    int fd;
+    int ring;
+    int event;
+
+    struct
+    {
+        void *map;
+        size_t map_size;
+        unsigned *head;
+        unsigned *tail;
+        unsigned *mask;
+        unsigned *array;
+        struct io_uring_sqe *sqes;
+        size_t sqes_size;
+    } sq;
+
+    struct
+    {
+        void *map;
+        size_t map_size;
+        unsigned *head;
+        unsigned *tail;
+        unsigned *mask;
+        struct io_uring_cqe *cqes;
+    } cq;
+
+    struct uring_pool *pool;
+    bool fixed; /**< pool buffers are registered with the kernel */
+    bool direct; /**< file descriptor was opened with O_DIRECT */
+    bool eof;
+
+    size_t block_size;
+    uint64_t offset; /**< file offset of the next read to submit */
+    size_t skip; /**< bytes to skip in the next delivered block */
+
+    unsigned depth;
+    unsigned head; /**< oldest in-flight slot */
+    unsigned inflight;
+    struct uring_slot slots[URING_MAX_DEPTH];
+} access_sys_t;
+
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned submit, unsigned min, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, submit, min, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned opcode, const void *arg,
+                          unsigned count)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+static unsigned load_acquire(const unsigned *p)
+{
+    return atomic_load_explicit((const _Atomic unsigned *)p,
+                                memory_order_acquire);
+}
+
+static void store_release(unsigned *p, unsigned v)
+{
+    atomic_store_explicit((_Atomic unsigned *)p, v, memory_order_release);
+}
+
+static int RingInit(access_sys_t *sys, unsigned entries)
+{
+    struct io_uring_params p;
+
+    memset(&p, 0, sizeof (p));
+    sys->ring = uring_setup(entries, &p);
+    if (sys->ring == -1)
+        return -1;
+
+    sys->sq.map_size = p.sq_off.array + p.sq_entries * sizeof (unsigned);
+    sys->cq.map_size = p.cq_off.cqes
+                     + p.cq_entries * sizeof (struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        sys->sq.map_size = sys->cq.map_size =
+            __MAX(sys->sq.map_size, sys->cq.map_size);
+
+    sys->sq.map = mmap(NULL, sys->sq.map_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, sys->ring,
+                       IORING_OFF_SQ_RING);
+    if (sys->sq.map == MAP_FAILED)
+        goto error;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        sys->cq.map = sys->sq.map;
+    else
+    {
+        sys->cq.map = mmap(NULL, sys->cq.map_size, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, sys->ring,
+                           IORING_OFF_CQ_RING);
+        if (sys->cq.map == MAP_FAILED)
+            goto error_sq;
+    }
+
+    sys->sq.sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+    sys->sq.sqes = mmap(NULL, sys->sq.sqes_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, sys->ring,
+                        IORING_OFF_SQES);
+    if (sys->sq.sqes == MAP_FAILED)
+        goto error_cq;
+
+    uint8_t *sq = sys->sq.map, *cq = sys->cq.map;
+
+    sys->sq.head = (unsigned *)(sq + p.sq_off.head);
+    sys->sq.tail = (unsigned *)(sq + p.sq_off.tail);
+    sys->sq.mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    sys->sq.array = (unsigned *)(sq + p.sq_off.array);
+    sys->cq.head = (unsigned *)(cq + p.cq_off.head);
+    sys->cq.tail = (unsigned *)(cq + p.cq_off.tail);
+    sys->cq.mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    sys->cq.cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    return 0;
+
+error_cq:
+    if (sys->cq.map != sys->sq.map)
+        munmap(sys->cq.map, sys->cq.map_size);
+error_sq:
+    munmap(sys->sq.map, sys->sq.map_size);
+error:
+    close(sys->ring);
+    return -1;
+}
+
+static void RingDestroy(access_sys_t *sys)
+{
+    munmap(sys->sq.sqes, sys->sq.sqes_size);
+    if (sys->cq.map != sys->sq.map)
+        munmap(sys->cq.map, sys->cq.map_size);
+    munmap(sys->sq.map, sys->sq.map_size);
+    close(sys->ring);
+}
+
+/**
+ * Collects all available completions into their slots.
+ */
+static void Reap(access_sys_t *sys)
+{
+    unsigned head = *sys->cq.head;
+    unsigned tail = load_acquire(sys->cq.tail);
+
+    while (head != tail)
+    {
+        const struct io_uring_cqe *cqe = &sys->cq.cqes[head & *sys->cq.mask];
+        struct uring_slot *slot = &sys->slots[cqe->user_data];
+
+        assert(cqe->user_data < sys->depth && !slot->done);
+        slot->result = cqe->res;
+        slot->done = true;
+        head++;
+    }
+    store_release(sys->cq.head, head);
+}
+
+static block_t *SlotBlock(access_sys_t *sys, bool *restrict fixed)
+{
+    struct uring_buffer *buf = PoolGet(sys->pool);
+    if (buf != NULL)
+    {
+        *fixed = sys->fixed;
+        return &buf->self;
+    }
+
+    *fixed = false;
+    return AlignedBlockAlloc(sys->block_size);
+}
+
+/**
+ * Queues reads ahead of the current position until all slots are busy.
+ */
+static void Fill(stream_t *access)
+{
+    access_sys_t *sys = access->p_sys;
+    unsigned tail = *sys->sq.tail;
+    unsigned count = 0;
+
+    while (sys->inflight < sys->depth)
+    {
+        unsigned index = (sys->head + sys->inflight) % sys->depth;
+        struct uring_slot *slot = &sys->slots[index];
+        bool fixed;
+
+        slot->block = SlotBlock(sys, &fixed);
+        if (unlikely(slot->block == NULL))
+            break;
+
+        struct io_uring_sqe *sqe = &sys->sq.sqes[tail & *sys->sq.mask];
+
+        memset(sqe, 0, sizeof (*sqe));
+        sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = sys->fd;
+        sqe->off = sys->offset;
+        sqe->addr = (uintptr_t)slot->block->p_buffer;
+        sqe->len = sys->block_size;
+        if (fixed)
+            sqe->buf_index =
+                container_of(slot->block, struct uring_buffer, self)->index;
+        sqe->user_data = index;
+        sys->sq.array[tail & *sys->sq.mask] = tail & *sys->sq.mask;
+
+        slot->offset = sys->offset;
+        slot->done = false;
+        sys->offset += sys->block_size;
+        sys->inflight++;
+        tail++;
+        count++;
+    }
+
+    if (count == 0)
+        return;
+
+    store_release(sys->sq.tail, tail);
+
+    if (uring_enter(sys->ring, count, 0, 0) < 0)
+        msg_Err(access, "submission error: %s", vlc_strerror_c(errno));
+}
+
+/**
+ * Waits for all in-flight reads and discards their results.
+ */
+static void Drain(stream_t *access)
+{
+    access_sys_t *sys = access->p_sys;
+
+    while (sys->inflight > 0)
+    {
+        struct uring_slot *slot = &sys->slots[sys->head];
+
+        while (!slot->done)
+        {
+            Reap(sys);
+            if (!slot->done
+             && uring_enter(sys->ring, 0, 1, IORING_ENTER_GETEVENTS) < 0
+             && errno != EINTR)
+            {
+                msg_Err(access, "completion error: %s",
+                        vlc_strerror_c(errno));
+                return;
+            }
+        }
+
+        block_Release(slot->block);
+        slot->block = NULL;
+        slot->done = false;
+        sys->head = (sys->head + 1) % sys->depth;
+        sys->inflight--;
+    }
+}
+
+static block_t *Block(stream_t *access, bool *restrict eof)
+{
+    access_sys_t *sys = access->p_sys;
+
+    if (!sys->eof)
+        Fill(access);
+
+    if (sys->inflight == 0)
+    {
+        *eof = true;
+        return NULL;
+    }
+
+    struct uring_slot *slot = &sys->slots[sys->head];
+
+    Reap(sys);
+    while (!slot->done)
+    {
+        struct pollfd ufd = { .fd = sys->event, .events = POLLIN };
+        uint64_t val;
+
+        if (vlc_poll_i11e(&ufd, 1, -1) < 0)
+            return NULL; /* interrupted, the read stays queued */
+        if (read(sys->event, &val, sizeof (val)) < 0 && errno != EAGAIN)
+            msg_Warn(access, "event error: %s", vlc_strerror_c(errno));
+        Reap(sys);
+    }
+
+    block_t *block = slot->block;
+    uint64_t offset = slot->offset;
+    int result = slot->result;
+
+    slot->block = NULL;
+    slot->done = false;
+    sys->head = (sys->head + 1) % sys->depth;
+    sys->inflight--;
+
+    if (result < 0)
+        msg_Err(access, "read error: %s", vlc_strerror_c(-result));
+
+    if (result <= 0 || (size_t)result <= sys->skip)
+    {
+        block_Release(block);
+        Drain(access);
+        sys->eof = true;
+        *eof = true;
+        return NULL;
+    }
+
+    block->i_buffer = result;
+    block->p_buffer += sys->skip;
+    block->i_buffer -= sys->skip;
+    sys->skip = 0;
+
+    if ((size_t)result < sys->block_size)
+    {   /* Short read: the reads queued after this one are misplaced. */
+        Drain(access);
+        sys->offset = offset + result;
+        if (sys->direct)
+        {   /* Resume from the aligned offset and drop what was delivered. */
+            sys->skip = sys->offset & (URING_ALIGN - 1);
+            sys->offset -= sys->skip;
+        }
+    }
+    return block;
+}
+
+static int Seek(stream_t *access, uint64_t pos)
+{
+    access_sys_t *sys = access->p_sys;
+
+    Drain(access);
+    sys->offset = sys->direct ? (pos & ~(uint64_t)(URING_ALIGN - 1)) : pos;
+    sys->skip = pos - sys->offset;
+    sys->eof = false;
+    return VLC_SUCCESS;
+}
+
+static int Control(stream_t *access, int query, va_list args)
+{
+    access_sys_t *sys = access->p_sys;
+
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_FASTSEEK:
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+            *va_arg(args, bool *) = true;
+            break;
+
+        case STREAM_GET_SIZE:
+        {
+            struct stat st;
+
+            if (fstat(sys->fd, &st) || !S_ISREG(st.st_mode))
+                return VLC_EGENERIC;
+            *va_arg(args, uint64_t *) = st.st_size;
+            break;
+        }
+
+        case STREAM_GET_PTS_DELAY:
+            *va_arg(args, vlc_tick_t *) = VLC_TICK_FROM_MS(
+                var_InheritInteger(access, "file-caching"));
+            break;
+
+        case STREAM_SET_PAUSE_STATE:
+            break;
+
+        default:
+            return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static int Open(vlc_object_t *obj)
+{
+    stream_t *access = (stream_t *)obj;
+
+    if (access->psz_filepath == NULL || !var_InheritBool(obj, "uring"))
+        return VLC_EGENERIC;
+
+    access_sys_t *sys = vlc_obj_calloc(obj, 1, sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return VLC_ENOMEM;
+
+    sys->depth = var_InheritInteger(obj, "uring-depth");
+    sys->block_size = var_InheritInteger(obj, "uring-block-size") << 10;
+    sys->block_size = (sys->block_size + URING_ALIGN - 1)
+                    & ~(size_t)(URING_ALIGN - 1);
+
+    sys->fd = -1;
+    if (var_InheritBool(obj, "uring-direct"))
+    {
+        sys->fd = vlc_open(access->psz_filepath, O_RDONLY | O_DIRECT);
+        if (sys->fd == -1)
+            msg_Dbg(access, "direct I/O not available: %s",
+                    vlc_strerror_c(errno));
+        else
+            sys->direct = true;
+    }
+    if (sys->fd == -1)
+        sys->fd = vlc_open(access->psz_filepath, O_RDONLY);
+    if (sys->fd == -1)
+    {
+        msg_Err(access, "cannot open file %s (%s)", access->psz_filepath,
+                vlc_strerror_c(errno));
+        return VLC_EGENERIC;
+    }
+
+    struct stat st;
+    if (fstat(sys->fd, &st) || !S_ISREG(st.st_mode))
+        goto error; /* leave pipes, devices and directories to the others */
+
+    if (RingInit(sys, sys->depth))
+    {
+        msg_Dbg(access, "io_uring not available: %s", vlc_strerror_c(errno));
+        goto error;
+    }
+
+    sys->event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (sys->event == -1
+     || uring_register(sys->ring, IORING_REGISTER_EVENTFD, &sys->event, 1))
+        goto error_ring;
+
+    sys->pool = PoolCreate(2 * sys->depth, sys->block_size);
+    if (unlikely(sys->pool == NULL))
+        goto error_ring;
+
+    struct iovec iov[2 * URING_MAX_DEPTH];
+    for (unsigned i = 0; i < sys->pool->count; i++)
+    {
+        iov[i].iov_base = sys->pool->base + i * sys->pool->size;
+        iov[i].iov_len = sys->pool->size;
+    }
+    /* Registration pins memory and may exceed RLIMIT_MEMLOCK. */
+    sys->fixed = uring_register(sys->ring, IORING_REGISTER_BUFFERS, iov,
+                                sys->pool->count) == 0;
+
+    msg_Dbg(access, "%u reads of %zu bytes in flight%s%s", sys->depth,
+            sys->block_size, sys->fixed ? ", registered buffers" : "",
+            sys->direct ? ", direct I/O" : "");
+
+    access->pf_read = NULL;
+    access->pf_block = Block;
+    access->pf_seek = Seek;
+    access->pf_control = Control;
+    access->p_sys = sys;
+    return VLC_SUCCESS;
+
+error_ring:
+    if (sys->event != -1)
+        vlc_close(sys->event);
+    RingDestroy(sys);
+error:
+    vlc_close(sys->fd);
+    return VLC_EGENERIC;
+}
+
+static void Close(vlc_object_t *obj)
+{
+    stream_t *access = (stream_t *)obj;
+    access_sys_t *sys = access->p_sys;
+
+    Drain(access);
+    RingDestroy(sys);
+    PoolRelease(sys->pool);
+    vlc_close(sys->event);
+    vlc_close(sys->fd);
+}
+
+vlc_module_begin()
+    set_shortname(N_("io_uring"))
+    set_description(N_("Asynchronous file input (io_uring)"))
+    set_category(CAT_INPUT)
+    set_subcategory(SUBCAT_INPUT_ACCESS)
+    set_capability("access", 60)
+    add_shortcut("file")
+    set_callbacks(Open, Close)
+
+    add_bool("uring", false, N_("Use io_uring"),
+             N_("Read local files asynchronously with several requests "
+                "in flight."), true)
+    add_integer("uring-depth", 4, N_("Queue depth"),
+                N_("Number of reads in flight."), true)
+        change_integer_range(1, URING_MAX_DEPTH)
+    add_integer("uring-block-size", 128, N_("Block size"),
+                N_("Size of each read (KiB)."), true)
+        change_integer_range(4, 1 << 14)
+    add_bool("uring-direct", false, N_("Direct I/O"),
+             N_("Bypass the page cache (O_DIRECT). This suits large "
+                "sequential media read only once."), true)
+vlc_module_end()
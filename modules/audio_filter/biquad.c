@@ -0,0 +1,359 @@
+/*****************************************************************************
+ * biquad.c: Biquad filter sections for audio filters
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
+#include "biquad.h"
+
+/* Frames deinterleaved into the lanes at once */
+#define BIQUAD_CHUNK 256
+/* Channels are padded to a multiple of the widest vectors */
+#define BIQUAD_LANES 8
+/* State values below this are flushed, well under hearing */
+#define BIQUAD_TINY 1e-30
+
+/* Filters a chunk of frames in place */
+typedef void (*biquad_kernel_t)(const audio_biquad_t *bq, void *buf,
+                                unsigned frames);
+
+struct audio_biquad
+{
+    unsigned channels;
+    unsigned lanes;
+    unsigned sections;
+    bool bank;
+    bool double_precision;
+
+    /* b0, b1, b2, a1, a2 and gain of each section */
+    double *coeffs;
+    double direct;
+
+    /* x[-1], x[-2], y[-1] and y[-2] lanes of each section, the input
+     * history of a bank in the first section */
+    void *state;
+    /* Chunk of frames, one sample per lane */
+    void *buf;
+
+    biquad_kernel_t kernel;
+};
+
+/* Each frame goes through all the sections: the sections of a bank, or the
+ * next frames in the first sections of a cascade, overlap in the CPU
+ * pipeline while a section waits for its previous output. The feedback
+ * terms come last to shorten that wait. */
+#define BIQUAD_KERNEL(name, type, vec, width, load, store, set1, add, sub, \
+                      mul) \
+static void name(const audio_biquad_t *bq, void *buf_, unsigned frames) \
+{ \
+    const unsigned lanes = bq->lanes, sections = bq->sections; \
+    type *restrict buf = buf_, *restrict state = bq->state; \
+    vec k[6 * sections]; \
+\
+    for (unsigned i = 0; i < 6 * sections; i++) \
+        k[i] = set1((type)bq->coeffs[i]); \
+    const vec direct = set1((type)bq->direct); \
+\
+    for (unsigned v = 0; v < bq->channels; v += width) \
+    { \
+        type *restrict in = buf + v, *restrict st0 = state + v; \
+\
+        if (bq->bank) \
+            for (unsigned n = 0; n < frames; n++, in += lanes) \
+            { \
+                const vec x = load(in); \
+                const vec x1 = load(st0), x2 = load(st0 + lanes); \
+                vec out = mul(direct, x); \
+\
+                for (unsigned s = 0; s < sections; s++) \
+                { \
+                    const vec *c = k + 6 * s; \
+                    type *st = st0 + 4 * lanes * s; \
+                    const vec y1 = load(st + 2 * lanes); \
+                    const vec y2 = load(st + 3 * lanes); \
+                    const vec y = sub(sub(add(add(mul(c[0], x), \
+                                                  mul(c[1], x1)), \
+                                              mul(c[2], x2)), \
+                                          mul(c[4], y2)), mul(c[3], y1)); \
+                    store(st + 3 * lanes, y1); \
+                    store(st + 2 * lanes, y); \
+                    out = add(out, mul(c[5], y)); \
+                } \
+                store(st0 + lanes, x1); \
+                store(st0, x); \
+                store(in, out); \
+            } \
+        else \
+            for (unsigned n = 0; n < frames; n++, in += lanes) \
+            { \
+                vec x = load(in); \
+\
+                for (unsigned s = 0; s < sections; s++) \
+                { \
+                    const vec *c = k + 6 * s; \
+                    type *st = st0 + 4 * lanes * s; \
+                    const vec x1 = load(st), x2 = load(st + lanes); \
+                    const vec y1 = load(st + 2 * lanes); \
+                    const vec y2 = load(st + 3 * lanes); \
+                    const vec y = sub(sub(add(add(mul(c[0], x), \
+                                                  mul(c[1], x1)), \
+                                              mul(c[2], x2)), \
+                                          mul(c[4], y2)), mul(c[3], y1)); \
+                    store(st + lanes, x1); \
+                    store(st, x); \
+                    store(st + 3 * lanes, y1); \
+                    store(st + 2 * lanes, y); \
+                    x = y; \
+                } \
+                store(in, x); \
+            } \
+    } \
+}
+
+#define C_LOAD(p) (*(p))
+#define C_STORE(p, v) (*(p) = (v))
+#define C_SET1(x) (x)
+#define C_ADD(a, b) ((a) + (b))
+#define C_SUB(a, b) ((a) - (b))
+#define C_MUL(a, b) ((a) * (b))
+
+BIQUAD_KERNEL(KernelFloatC, float, float, 1, C_LOAD, C_STORE, C_SET1,
+              C_ADD, C_SUB, C_MUL)
+BIQUAD_KERNEL(KernelDoubleC, double, double, 1, C_LOAD, C_STORE, C_SET1,
+              C_ADD, C_SUB, C_MUL)
+
+#if defined(HAVE_SSE2_INTRINSICS)
+VLC_SSE
+BIQUAD_KERNEL(KernelFloatSSE, float, __m128, 4, _mm_loadu_ps, _mm_storeu_ps,
+              _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps)
+__attribute__ ((__target__ ("sse2")))
+BIQUAD_KERNEL(KernelDoubleSSE2, double, __m128d, 2, _mm_loadu_pd,
+              _mm_storeu_pd, _mm_set1_pd, _mm_add_pd, _mm_sub_pd, _mm_mul_pd)
+#endif
+
+#if defined(HAVE_AVX2_INTRINSICS)
+__attribute__ ((__target__ ("avx")))
+BIQUAD_KERNEL(KernelFloatAVX, float, __m256, 8, _mm256_loadu_ps,
+              _mm256_storeu_ps, _mm256_set1_ps, _mm256_add_ps,
+              _mm256_sub_ps, _mm256_mul_ps)
+__attribute__ ((__target__ ("avx")))
+BIQUAD_KERNEL(KernelDoubleAVX, double, __m256d, 4, _mm256_loadu_pd,
+              _mm256_storeu_pd, _mm256_set1_pd, _mm256_add_pd,
+              _mm256_sub_pd, _mm256_mul_pd)
+#endif
+
+#if defined(__ARM_NEON)
+BIQUAD_KERNEL(KernelFloatNEON, float, float32x4_t, 4, vld1q_f32, vst1q_f32,
+              vdupq_n_f32, vaddq_f32, vsubq_f32, vmulq_f32)
+#endif
+
+static biquad_kernel_t GetKernel(bool double_precision)
+{
+    if (double_precision)
+    {
+#if defined(HAVE_AVX2_INTRINSICS)
+        if (vlc_CPU_AVX())
+            return KernelDoubleAVX;
+#endif
+#if defined(HAVE_SSE2_INTRINSICS)
+        if (vlc_CPU_SSE2())
+            return KernelDoubleSSE2;
+#endif
+        return KernelDoubleC;
+    }
+
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (vlc_CPU_AVX())
+        return KernelFloatAVX;
+#endif
+#if defined(HAVE_SSE2_INTRINSICS)
+    if (vlc_CPU_SSE())
+        return KernelFloatSSE;
+#endif
+#if defined(__ARM_NEON)
+    if (vlc_CPU_ARM_NEON())
+        return KernelFloatNEON;
+#endif
+    return KernelFloatC;
+}
+
+audio_biquad_t *audio_biquad_New(unsigned channels, unsigned sections,
+                                 bool bank, bool double_precision)
+{
+    if (channels == 0 || sections == 0)
+        return NULL;
+
+    audio_biquad_t *bq = malloc(sizeof (*bq));
+    if (unlikely(bq == NULL))
+        return NULL;
+
+    const size_t size = double_precision ? sizeof (double) : sizeof (float);
+
+    bq->channels = channels;
+    bq->lanes = (channels + BIQUAD_LANES - 1) & ~(BIQUAD_LANES - 1);
+    bq->sections = sections;
+    bq->bank = bank;
+    bq->double_precision = double_precision;
+    bq->direct = 1.;
+    bq->coeffs = calloc(sections * 6, sizeof (double));
+    bq->state = calloc((size_t)sections * 4 * bq->lanes, size);
+    /* The padding lanes stay silent */
+    bq->buf = calloc((size_t)BIQUAD_CHUNK * bq->lanes, size);
+    if (unlikely(bq->coeffs == NULL || bq->state == NULL || bq->buf == NULL))
+    {
+        audio_biquad_Delete(bq);
+        return NULL;
+    }
+    bq->kernel = GetKernel(double_precision);
+    return bq;
+}
+
+void audio_biquad_Delete(audio_biquad_t *bq)
+{
+    free(bq->coeffs);
+    free(bq->state);
+    free(bq->buf);
+    free(bq);
+}
+
+void audio_biquad_SetSection(audio_biquad_t *bq, unsigned section,
+                             const double coeffs[5], double gain)
+{
+    assert(section < bq->sections);
+    memcpy(bq->coeffs + section * 6, coeffs, 5 * sizeof (double));
+    bq->coeffs[section * 6 + 5] = gain;
+}
+
+void audio_biquad_SetDirect(audio_biquad_t *bq, double gain)
+{
+    bq->direct = gain;
+}
+
+void audio_biquad_Reset(audio_biquad_t *bq)
+{
+    const size_t size = bq->double_precision ? sizeof (double)
+                                             : sizeof (float);
+    memset(bq->state, 0, (size_t)bq->sections * 4 * bq->lanes * size);
+}
+
+/* Flushes the decaying state before it reaches denormal numbers, which
+ * are very slow on most CPUs */
+static void Flush(audio_biquad_t *bq)
+{
+    const size_t count = (size_t)bq->sections * 4 * bq->lanes;
+
+    if (bq->double_precision)
+    {
+        double *state = bq->state;
+        for (size_t i = 0; i < count; i++)
+            if (fabs(state[i]) < BIQUAD_TINY)
+                state[i] = 0.;
+    }
+    else
+    {
+        float *state = bq->state;
+        for (size_t i = 0; i < count; i++)
+            if (fabsf(state[i]) < (float)BIQUAD_TINY)
+                state[i] = 0.f;
+    }
+}
+
+#if defined(HAVE_SSE2_INTRINSICS)
+/* Within a chunk, the state can still decay to denormal numbers: make SSE
+ * flush them to zero meanwhile */
+VLC_SSE
+static unsigned EnterFlushToZero(void)
+{
+    const unsigned csr = _mm_getcsr();
+    _mm_setcsr(csr | _MM_FLUSH_ZERO_ON);
+    return csr;
+}
+
+VLC_SSE
+static void LeaveFlushToZero(unsigned csr)
+{
+    _mm_setcsr(csr);
+}
+#endif
+
+#define BIQUAD_PROCESS(type) \
+    do { \
+        type *buf = bq->buf; \
+\
+        for (unsigned n = 0; n < count; n++) \
+            for (unsigned c = 0; c < channels; c++) \
+                buf[n * lanes + c] = in[n * channels + c]; \
+\
+        bq->kernel(bq, buf, count); \
+\
+        for (unsigned n = 0; n < count; n++) \
+            for (unsigned c = 0; c < channels; c++) \
+                out[n * channels + c] = buf[n * lanes + c]; \
+    } while (0)
+
+void audio_biquad_Process(audio_biquad_t *bq, const float *in, float *out,
+                          unsigned frames)
+{
+    const unsigned channels = bq->channels, lanes = bq->lanes;
+
+#if defined(HAVE_SSE2_INTRINSICS)
+    const bool sse = vlc_CPU_SSE();
+    unsigned csr = 0;
+    if (sse)
+        csr = EnterFlushToZero();
+#endif
+
+    while (frames > 0)
+    {
+        const unsigned count = __MIN(frames, BIQUAD_CHUNK);
+
+        if (bq->double_precision)
+            BIQUAD_PROCESS(double);
+        else
+            BIQUAD_PROCESS(float);
+
+        Flush(bq);
+
+        in += count * channels;
+        out += count * channels;
+        frames -= count;
+    }
+
+#if defined(HAVE_SSE2_INTRINSICS)
+    if (sse)
+        LeaveFlushToZero(csr);
+#endif
+}
@@ -0,0 +1,77 @@
+/*****************************************************************************
+ * biquad.h: Biquad filter sections for audio filters
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FILTER_BIQUAD_H
+#define VLC_AUDIO_FILTER_BIQUAD_H
+
+/**
+ * Direct form 1 biquad sections, applied to every channel of interleaved
+ * float frames, with the channels in SIMD lanes.
+ *
+ * The sections run either in series (a cascade), or in parallel on the same
+ * input (a bank), the output then being the input and the section outputs
+ * weighted by their gains.
+ *
+ * The double precision variant keeps the state and computations in double,
+ * for sections tuned to very low frequencies relatively to the sample rate,
+ * where the poles get too close to the unit circle for single precision.
+ * Values too small to be heard are flushed to avoid denormal numbers.
+ */
+typedef struct audio_biquad audio_biquad_t;
+
+/**
+ * Creates biquad sections.
+ *
+ * All the sections are initially silent, and the direct gain is 1.
+ *
+ * \param channels number of interleaved channels
+ * \param sections number of sections
+ * \param bank true to run the sections in parallel, false in series
+ * \param double_precision true to compute in double precision
+ * \return the sections, or NULL on error
+ */
+audio_biquad_t *audio_biquad_New(unsigned channels, unsigned sections,
+                                 bool bank, bool double_precision);
+void audio_biquad_Delete(audio_biquad_t *bq);
+
+/**
+ * Sets the coefficients of a section.
+ *
+ * \param coeffs b0, b1, b2, a1 and a2, normalized by a0
+ * \param gain weight of the section output in a bank, unused in a cascade
+ */
+void audio_biquad_SetSection(audio_biquad_t *bq, unsigned section,
+                             const double coeffs[5], double gain);
+
+/** Sets the weight of the input in the output of a bank */
+void audio_biquad_SetDirect(audio_biquad_t *bq, double gain);
+
+/**
+ * Filters interleaved frames.
+ *
+ * The output can be the input buffer.
+ */
+void audio_biquad_Process(audio_biquad_t *bq, const float *in, float *out,
+                          unsigned frames);
+
+/** Forgets the past samples */
+void audio_biquad_Reset(audio_biquad_t *bq);
+
+#endif
@@ -37,12 +37,15 @@
 #include <vlc_filter.h>
 #include <vlc_block.h>
 
+#include "../convolver.h"
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
 static int  OpenFilter ( vlc_object_t * );
 static void CloseFilter( vlc_object_t * );
 static block_t *Convert( filter_t *, block_t * );
+static void Flush( filter_t * );
 
 /*****************************************************************************
  * Module descriptor
@@ -70,6 +73,14 @@ static block_t *Convert( filter_t *, block_t * );
      "Dolby Surround encoded streams won't be decoded before being " \
      "processed by this filter. Enabling this setting is not recommended.")
 
+#define HEADPHONE_HRIR_TEXT N_("Impulse responses file")
+#define HEADPHONE_HRIR_LONGTEXT N_( \
+     "WAV file of measured head-related impulse responses, used instead " \
+     "of the geometric model. It holds a left ear and right ear channel " \
+     "for each virtual speaker, in order: front left, front right, " \
+     "middle left, middle right, rear left, rear right, rear center, " \
+     "center and low frequencies. Missing speakers use the model.")
+
 vlc_module_begin ()
     set_description( N_("Headphone virtual spatialization effect") )
     set_shortname( N_("Headphone effect") )
@@ -83,6 +94,8 @@ vlc_module_begin ()
               HEADPHONE_COMPENSATE_LONGTEXT, true )
     add_bool( "headphone-dolby", false, HEADPHONE_DOLBY_TEXT,
               HEADPHONE_DOLBY_LONGTEXT, true )
+    add_loadfile( "headphone-hrir", NULL, HEADPHONE_HRIR_TEXT,
+                  HEADPHONE_HRIR_LONGTEXT )
 
     set_capability( "audio filter", 0 )
     set_callbacks( OpenFilter, CloseFilter )
@@ -90,6 +103,12 @@ vlc_module_begin ()
 vlc_module_end ()
 
 
+/* Partition size of the convolution, in frames: the latency of the
+ * impulse responses */
+#define CONVOLVER_BLOCK 256
+/* Longest impulse response, in frames, to bound the processing cost */
+#define CONVOLVER_MAX_LENGTH 65536
+
 /*****************************************************************************
  * Internal data structures
  *****************************************************************************/
@@ -107,6 +126,7 @@ typedef struct
     float * p_overflow_buffer;
     unsigned int i_nb_atomic_operations;
     struct atomic_operation_t * p_atomic_operations;
+    audio_convolver_t * p_convolver;/* impulse responses, if loaded */
 } filter_sys_t;
 
 /*****************************************************************************
@@ -325,6 +345,100 @@ static int Init( vlc_object_t *p_this, filter_sys_t * p_data
     return 0;
 }
 
+/*****************************************************************************
+ * InitConvolver: load the measured impulse responses of the virtual speakers
+ * and complete them with the atomic operations
+ *****************************************************************************/
+static int InitConvolver( vlc_object_t *p_this, filter_sys_t * p_data
+        , const char *psz_path, unsigned int i_nb_channels
+        , uint32_t i_physical_channels, unsigned int i_rate )
+{
+    unsigned int i_file_channels, i_file_frames;
+    unsigned int i_length;
+    float * p_file;
+    float * p_response;
+    unsigned int i, j;
+
+    p_file = audio_convolver_LoadWAV( p_this, psz_path, i_rate,
+                                      &i_file_channels, &i_file_frames );
+    if( p_file == NULL )
+        return -1;
+    if( i_file_channels % 2 )
+    {
+        msg_Err( p_this, "impulse responses must come in left and right "
+                 "ear pairs (%u channels)", i_file_channels );
+        free( p_file );
+        return -1;
+    }
+
+    i_length = i_file_frames;
+    for( i = 0 ; i < p_data->i_nb_atomic_operations ; i++ )
+        i_length = __MAX( i_length,
+                          p_data->p_atomic_operations[i].i_delay + 1 );
+    if( i_length > CONVOLVER_MAX_LENGTH )
+    {
+        msg_Warn( p_this, "truncating impulse responses from %u to %u "
+                  "samples", i_length, CONVOLVER_MAX_LENGTH );
+        i_length = CONVOLVER_MAX_LENGTH;
+    }
+
+    p_data->p_convolver = audio_convolver_New( i_nb_channels, 2,
+                                               CONVOLVER_BLOCK, i_length );
+    p_response = malloc( i_length * sizeof (float) );
+    if( p_data->p_convolver == NULL || p_response == NULL )
+    {
+        if( p_data->p_convolver != NULL )
+            audio_convolver_Delete( p_data->p_convolver );
+        p_data->p_convolver = NULL;
+        free( p_response );
+        free( p_file );
+        return -1;
+    }
+
+    /* The source channels and the file pairs are both in the WG4 order */
+    unsigned int i_source = 0;
+    for( unsigned int i_position = 0; pi_vlc_chan_order_wg4[i_position]
+                                      && i_source < i_nb_channels;
+         i_position++ )
+    {
+        if( !( i_physical_channels & pi_vlc_chan_order_wg4[i_position] ) )
+            continue;
+
+        for( unsigned int i_ear = 0; i_ear < 2; i_ear++ )
+        {
+            memset( p_response, 0, i_length * sizeof (float) );
+            if( 2 * i_position < i_file_channels )
+            {
+                for( j = 0; j < __MIN( i_file_frames, i_length ); j++ )
+                    p_response[j] = p_file[j * i_file_channels
+                                           + 2 * i_position + i_ear];
+            }
+            else
+            {
+                for( i = 0 ; i < p_data->i_nb_atomic_operations ; i++ )
+                {
+                    const struct atomic_operation_t *p_op =
+                        &p_data->p_atomic_operations[i];
+                    if( p_op->i_source_channel_offset == (int)i_source
+                     && p_op->i_dest_channel_offset == (int)i_ear
+                     && p_op->i_delay < i_length )
+                        p_response[p_op->i_delay] += p_op->d_amplitude_factor;
+                }
+            }
+            audio_convolver_SetResponse( p_data->p_convolver, i_source, i_ear,
+                                         p_response, i_length );
+        }
+        i_source++;
+    }
+
+    msg_Dbg( p_this, "convolving %u samples long impulse responses, "
+             "%u samples latency", i_length,
+             audio_convolver_Latency( p_data->p_convolver ) );
+    free( p_response );
+    free( p_file );
+    return 0;
+}
+
 /*****************************************************************************
  * DoWork: convert a buffer
  *****************************************************************************/
@@ -354,6 +468,13 @@ static void DoWork( filter_t * p_filter,
     p_out = (float *)p_out_buf->p_buffer;
     i_out_size = p_out_buf->i_buffer;
 
+    if( p_sys->p_convolver != NULL )
+    {
+        audio_convolver_Process( p_sys->p_convolver, p_in, p_out,
+                                 p_out_buf->i_nb_samples );
+        return;
+    }
+
     /* Slide the overflow buffer */
     p_overflow = (uint8_t *) p_sys->p_overflow_buffer;
     i_overflow_size = p_sys->i_overflow_buffer_size;
@@ -456,15 +577,7 @@ static int OpenFilter( vlc_object_t *p_this )
     p_sys->p_overflow_buffer = NULL;
     p_sys->i_nb_atomic_operations = 0;
     p_sys->p_atomic_operations = NULL;
-
-    if( Init( VLC_OBJECT(p_filter), p_sys
-                , aout_FormatNbChannels ( &(p_filter->fmt_in.audio) )
-                , p_filter->fmt_in.audio.i_physical_channels
-                , p_filter->fmt_in.audio.i_rate ) < 0 )
-    {
-        free( p_sys );
-        return VLC_EGENERIC;
-    }
+    p_sys->p_convolver = NULL;
 
     /* Request a specific format if not already compatible */
     p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
@@ -479,10 +592,32 @@ static int OpenFilter( vlc_object_t *p_this )
         p_filter->fmt_in.audio.i_physical_channels = AOUT_CHANS_5_0;
     }
     p_filter->pf_audio_filter = Convert;
+    p_filter->pf_flush = Flush;
 
     aout_FormatPrepare(&p_filter->fmt_in.audio);
     aout_FormatPrepare(&p_filter->fmt_out.audio);
 
+    /* Once the input layout is known, Dolby Surround decoding included */
+    if( Init( VLC_OBJECT(p_filter), p_sys
+                , aout_FormatNbChannels ( &(p_filter->fmt_in.audio) )
+                , p_filter->fmt_in.audio.i_physical_channels
+                , p_filter->fmt_in.audio.i_rate ) < 0 )
+    {
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    char *psz_hrir = var_InheritString( p_filter, "headphone-hrir" );
+    if( psz_hrir != NULL )
+    {
+        if( InitConvolver( VLC_OBJECT(p_filter), p_sys, psz_hrir
+                    , aout_FormatNbChannels ( &(p_filter->fmt_in.audio) )
+                    , p_filter->fmt_in.audio.i_physical_channels
+                    , p_filter->fmt_in.audio.i_rate ) < 0 )
+            msg_Warn( p_filter, "using the geometric model" );
+        free( psz_hrir );
+    }
+
     return VLC_SUCCESS;
 }
 
@@ -494,11 +629,22 @@ static void CloseFilter( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
+    if( p_sys->p_convolver != NULL )
+        audio_convolver_Delete( p_sys->p_convolver );
     free( p_sys->p_overflow_buffer );
     free( p_sys->p_atomic_operations );
     free( p_sys );
 }
 
+static void Flush( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->p_convolver != NULL )
+        audio_convolver_Reset( p_sys->p_convolver );
+    memset( p_sys->p_overflow_buffer, 0, p_sys->i_overflow_buffer_size );
+}
+
 static block_t *Convert( filter_t *p_filter, block_t *p_block )
 {
     if( !p_block || !p_block->i_nb_samples )
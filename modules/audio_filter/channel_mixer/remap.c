@@ -398,8 +398,32 @@ static block_t *Remap( filter_t *p_filter, block_t *p_block )
         return NULL;
     }
 
-    size_t i_out_size = p_block->i_nb_samples *
-        p_filter->fmt_out.audio.i_bytes_per_frame;
+    const unsigned i_in_frame = p_filter->fmt_in.audio.i_bytes_per_frame;
+    const unsigned i_out_frame = p_filter->fmt_out.audio.i_bytes_per_frame;
+    size_t i_out_size = p_block->i_nb_samples * i_out_frame;
+
+    if( i_out_frame <= i_in_frame )
+    {
+        /* In place: each output frame is written at or before its input
+         * frame, so remap a copy of the input, one chunk at a time */
+        double chunk[512];
+        const unsigned i_chunk = sizeof( chunk ) / i_in_frame;
+
+        for( unsigned i = 0; i < p_block->i_nb_samples; i += i_chunk )
+        {
+            unsigned n = __MIN( i_chunk, p_block->i_nb_samples - i );
+            uint8_t *p_dst = p_block->p_buffer + i * i_out_frame;
+
+            memcpy( chunk, p_block->p_buffer + i * i_in_frame,
+                    n * i_in_frame );
+            memset( p_dst, 0, n * i_out_frame );
+            p_sys->pf_remap( p_filter, chunk, p_dst, n,
+                             p_filter->fmt_in.audio.i_channels,
+                             p_filter->fmt_out.audio.i_channels );
+        }
+        p_block->i_buffer = i_out_size;
+        return p_block;
+    }
 
     block_t *p_out = block_Alloc( i_out_size );
     if( !p_out )
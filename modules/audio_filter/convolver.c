@@ -0,0 +1,548 @@
+/*****************************************************************************
+ * convolver.c: Partitioned convolution for audio filters
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_fs.h>
+
+#include "convolver.h"
+#include "fft.h"
+
+/* Largest WAV file to load, impulse responses are much shorter */
+#define WAV_MAX_SIZE (64 << 20)
+
+struct audio_convolver
+{
+    unsigned inputs;
+    unsigned outputs;
+    unsigned block;
+    unsigned partitions;
+    unsigned bins;          /* non-negative frequencies of a 2 block FFT */
+
+    audio_fft_t *fft;
+    double *re;
+    double *im;
+
+    /* Previous and current input blocks of each channel */
+    float *history;
+    /* Output block of each channel, returned during the next block */
+    float *result;
+    unsigned fill;          /* frames in the current block */
+
+    /* Frequency-domain delay line: the input spectra of the last
+     * partitions blocks, per input, the newest in slot current */
+    float *fdl_re;
+    float *fdl_im;
+    unsigned current;
+
+    /* Spectra of the response partitions, per input and output pair */
+    float *ir_re;
+    float *ir_im;
+    /* Number of partitions up to the last non-silent one, per pair */
+    unsigned *used;
+
+    float *acc_re;
+    float *acc_im;
+};
+
+audio_convolver_t *audio_convolver_New(unsigned inputs, unsigned outputs,
+                                       unsigned block, unsigned length)
+{
+    if (inputs == 0 || outputs == 0 || length == 0
+     || block < 2 || (block & (block - 1)) != 0)
+        return NULL;
+
+    audio_convolver_t *conv = calloc(1, sizeof (*conv));
+    if (unlikely(conv == NULL))
+        return NULL;
+
+    conv->inputs = inputs;
+    conv->outputs = outputs;
+    conv->block = block;
+    conv->partitions = (length + block - 1) / block;
+    conv->bins = block + 1;
+
+    const size_t fdl = (size_t)inputs * conv->partitions * conv->bins;
+    const size_t ir = fdl * outputs;
+
+    conv->fft = audio_fft_New(2 * block);
+    conv->re = vlc_alloc(2 * block, sizeof (double));
+    conv->im = vlc_alloc(2 * block, sizeof (double));
+    conv->history = calloc((size_t)inputs * 2 * block, sizeof (float));
+    conv->result = calloc((size_t)outputs * block, sizeof (float));
+    conv->fdl_re = calloc(fdl, sizeof (float));
+    conv->fdl_im = calloc(fdl, sizeof (float));
+    conv->ir_re = vlc_alloc(ir, sizeof (float));
+    conv->ir_im = vlc_alloc(ir, sizeof (float));
+    conv->used = calloc((size_t)inputs * outputs, sizeof (unsigned));
+    conv->acc_re = vlc_alloc((size_t)outputs * conv->bins, sizeof (float));
+    conv->acc_im = vlc_alloc((size_t)outputs * conv->bins, sizeof (float));
+    if (unlikely(conv->fft == NULL || conv->re == NULL || conv->im == NULL
+              || conv->history == NULL || conv->result == NULL
+              || conv->fdl_re == NULL || conv->fdl_im == NULL
+              || conv->ir_re == NULL || conv->ir_im == NULL
+              || conv->used == NULL
+              || conv->acc_re == NULL || conv->acc_im == NULL))
+    {
+        audio_convolver_Delete(conv);
+        return NULL;
+    }
+    return conv;
+}
+
+void audio_convolver_Delete(audio_convolver_t *conv)
+{
+    if (conv->fft != NULL)
+        audio_fft_Delete(conv->fft);
+    free(conv->re);
+    free(conv->im);
+    free(conv->history);
+    free(conv->result);
+    free(conv->fdl_re);
+    free(conv->fdl_im);
+    free(conv->ir_re);
+    free(conv->ir_im);
+    free(conv->used);
+    free(conv->acc_re);
+    free(conv->acc_im);
+    free(conv);
+}
+
+void audio_convolver_SetResponse(audio_convolver_t *conv, unsigned input,
+                                 unsigned output, const float *response,
+                                 unsigned length)
+{
+    assert(input < conv->inputs && output < conv->outputs);
+
+    const unsigned block = conv->block, bins = conv->bins;
+    const size_t pair = (size_t)input * conv->outputs + output;
+    float *ir_re = conv->ir_re + pair * conv->partitions * bins;
+    float *ir_im = conv->ir_im + pair * conv->partitions * bins;
+    /* Fold the normalization of the inverse transform in the response */
+    const double scale = 1. / (2 * block);
+
+    length = __MIN(length, conv->partitions * block);
+    conv->used[pair] = 0;
+
+    for (unsigned p = 0; p < conv->partitions; p++)
+    {
+        bool silent = true;
+
+        for (unsigned n = 0; n < 2 * block; n++)
+        {
+            const unsigned i = p * block + n;
+            conv->re[n] = (n < block && i < length) ? response[i] : 0.;
+            conv->im[n] = 0.;
+            if (conv->re[n] != 0.)
+                silent = false;
+        }
+        if (!silent)
+            conv->used[pair] = p + 1;
+
+        audio_fft_Forward(conv->fft, conv->re, conv->im);
+        for (unsigned k = 0; k < bins; k++)
+        {
+            ir_re[p * bins + k] = conv->re[k] * scale;
+            ir_im[p * bins + k] = conv->im[k] * scale;
+        }
+    }
+}
+
+/* Transforms the last two blocks of a pair of inputs at once, as the real
+ * and imaginary parts of one signal, and separates their spectra */
+static void ForwardPair(audio_convolver_t *conv, unsigned input)
+{
+    const unsigned block = conv->block, size = 2 * block, bins = conv->bins;
+    const float *a = conv->history + (size_t)input * size;
+    const float *b = (input + 1 < conv->inputs) ? a + size : NULL;
+
+    for (unsigned n = 0; n < size; n++)
+    {
+        conv->re[n] = a[n];
+        conv->im[n] = (b != NULL) ? b[n] : 0.;
+    }
+    audio_fft_Forward(conv->fft, conv->re, conv->im);
+
+    const size_t slot = (size_t)conv->current * bins;
+    float *a_re = conv->fdl_re + (size_t)input * conv->partitions * bins
+                + slot;
+    float *a_im = conv->fdl_im + (size_t)input * conv->partitions * bins
+                + slot;
+    float *b_re = a_re + (size_t)conv->partitions * bins;
+    float *b_im = a_im + (size_t)conv->partitions * bins;
+
+    for (unsigned k = 0; k < bins; k++)
+    {
+        const unsigned m = (size - k) & (size - 1);
+        const double xr = conv->re[k], xi = conv->im[k];
+        const double yr = conv->re[m], yi = conv->im[m];
+
+        /* A = (X[k] + conj(X[-k])) / 2, B = (X[k] - conj(X[-k])) / 2i */
+        a_re[k] = (xr + yr) * .5;
+        a_im[k] = (xi - yi) * .5;
+        if (b != NULL)
+        {
+            b_re[k] = (xi + yi) * .5;
+            b_im[k] = (yr - xr) * .5;
+        }
+    }
+}
+
+/* Accumulates the products of the input spectra with the responses into
+ * the spectrum of each output */
+static void MultiplyAccumulate(audio_convolver_t *conv)
+{
+    const unsigned partitions = conv->partitions, bins = conv->bins;
+
+    for (unsigned o = 0; o < conv->outputs; o++)
+    {
+        float *restrict acc_re = conv->acc_re + (size_t)o * bins;
+        float *restrict acc_im = conv->acc_im + (size_t)o * bins;
+
+        memset(acc_re, 0, bins * sizeof (float));
+        memset(acc_im, 0, bins * sizeof (float));
+
+        for (unsigned i = 0; i < conv->inputs; i++)
+        {
+            const size_t pair = (size_t)i * conv->outputs + o;
+            const float *ir_re = conv->ir_re + pair * partitions * bins;
+            const float *ir_im = conv->ir_im + pair * partitions * bins;
+            const float *fdl_re = conv->fdl_re + (size_t)i * partitions * bins;
+            const float *fdl_im = conv->fdl_im + (size_t)i * partitions * bins;
+
+            for (unsigned p = 0; p < conv->used[pair]; p++)
+            {
+                /* The input of p blocks ago */
+                const unsigned slot = (conv->current + partitions - p)
+                                    % partitions;
+                const float *restrict xr = fdl_re + (size_t)slot * bins;
+                const float *restrict xi = fdl_im + (size_t)slot * bins;
+                const float *restrict hr = ir_re + (size_t)p * bins;
+                const float *restrict hi = ir_im + (size_t)p * bins;
+
+                for (unsigned k = 0; k < bins; k++)
+                {
+                    acc_re[k] += xr[k] * hr[k] - xi[k] * hi[k];
+                    acc_im[k] += xr[k] * hi[k] + xi[k] * hr[k];
+                }
+            }
+        }
+    }
+}
+
+/* Transforms back a pair of outputs at once, as the real and imaginary
+ * parts of one signal, and keeps the last block, free of circular
+ * aliasing */
+static void InversePair(audio_convolver_t *conv, unsigned output)
+{
+    const unsigned block = conv->block, size = 2 * block, bins = conv->bins;
+    const float *a_re = conv->acc_re + (size_t)output * bins;
+    const float *a_im = conv->acc_im + (size_t)output * bins;
+    const bool pair = output + 1 < conv->outputs;
+    const float *b_re = a_re + bins, *b_im = a_im + bins;
+
+    for (unsigned k = 0; k < bins; k++)
+    {
+        const double br = pair ? b_re[k] : 0., bi = pair ? b_im[k] : 0.;
+
+        /* Z = A + i B, with the conjugate symmetric halves of A and B */
+        conv->re[k] = a_re[k] - bi;
+        conv->im[k] = a_im[k] + br;
+        if (k > 0 && k < block)
+        {
+            conv->re[size - k] = a_re[k] + bi;
+            conv->im[size - k] = br - a_im[k];
+        }
+    }
+    audio_fft_Inverse(conv->fft, conv->re, conv->im);
+
+    float *a = conv->result + (size_t)output * block;
+    for (unsigned n = 0; n < block; n++)
+        a[n] = conv->re[block + n];
+    if (pair)
+        for (unsigned n = 0; n < block; n++)
+            a[block + n] = conv->im[block + n];
+}
+
+static void ProcessBlock(audio_convolver_t *conv)
+{
+    const unsigned block = conv->block;
+
+    conv->current = (conv->current + 1) % conv->partitions;
+    for (unsigned i = 0; i < conv->inputs; i += 2)
+        ForwardPair(conv, i);
+
+    MultiplyAccumulate(conv);
+
+    for (unsigned o = 0; o < conv->outputs; o += 2)
+        InversePair(conv, o);
+
+    /* The current block becomes the previous one */
+    for (unsigned i = 0; i < conv->inputs; i++)
+    {
+        float *history = conv->history + (size_t)i * 2 * block;
+        memcpy(history, history + block, block * sizeof (float));
+    }
+}
+
+void audio_convolver_Process(audio_convolver_t *conv, const float *in,
+                             float *out, unsigned frames)
+{
+    const unsigned block = conv->block;
+    const unsigned inputs = conv->inputs, outputs = conv->outputs;
+
+    while (frames > 0)
+    {
+        const unsigned count = __MIN(frames, block - conv->fill);
+
+        for (unsigned i = 0; i < inputs; i++)
+        {
+            float *history = conv->history + (size_t)i * 2 * block
+                           + block + conv->fill;
+            for (unsigned n = 0; n < count; n++)
+                history[n] = in[n * inputs + i];
+        }
+        for (unsigned o = 0; o < outputs; o++)
+        {
+            const float *result = conv->result + (size_t)o * block
+                                + conv->fill;
+            for (unsigned n = 0; n < count; n++)
+                out[n * outputs + o] = result[n];
+        }
+
+        in += count * inputs;
+        out += count * outputs;
+        frames -= count;
+        conv->fill += count;
+
+        if (conv->fill == block)
+        {
+            ProcessBlock(conv);
+            conv->fill = 0;
+        }
+    }
+}
+
+void audio_convolver_Reset(audio_convolver_t *conv)
+{
+    const size_t fdl = (size_t)conv->inputs * conv->partitions * conv->bins;
+
+    memset(conv->history, 0,
+           (size_t)conv->inputs * 2 * conv->block * sizeof (float));
+    memset(conv->result, 0,
+           (size_t)conv->outputs * conv->block * sizeof (float));
+    memset(conv->fdl_re, 0, fdl * sizeof (float));
+    memset(conv->fdl_im, 0, fdl * sizeof (float));
+    conv->fill = 0;
+}
+
+unsigned audio_convolver_Latency(const audio_convolver_t *conv)
+{
+    return conv->block;
+}
+
+/* Converts the sample of a PCM or float WAV file */
+static float WAVSample(const uint8_t *p, unsigned bits, bool is_float)
+{
+    if (is_float)
+    {
+        union { uint32_t u; float f; } u = { .u = GetDWLE(p) };
+        return u.f;
+    }
+    switch (bits)
+    {
+        case 8:
+            return (p[0] - 128) / 128.f;
+        case 16:
+            return (int16_t)GetWLE(p) / 32768.f;
+        case 24:
+            return (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16
+                           | (uint32_t)p[2] << 24) / 2147483648.f;
+        case 32:
+            return (int32_t)GetDWLE(p) / 2147483648.f;
+    }
+    vlc_assert_unreachable();
+}
+
+/* Resamples impulse responses with a windowed sinc, preserving their
+ * frequency response */
+static float *Resample(const float *in, unsigned channels, unsigned frames,
+                       unsigned rate_in, unsigned rate_out,
+                       unsigned *frames_out)
+{
+    const double ratio = (double)rate_in / rate_out;
+    const double cutoff = __MIN(1., 1. / ratio);
+    const double half = 16. / cutoff;
+    const unsigned count = ceil(frames / ratio);
+
+    float *out = vlc_alloc((size_t)count * channels, sizeof (float));
+    if (unlikely(out == NULL))
+        return NULL;
+
+    for (unsigned n = 0; n < count; n++)
+    {
+        const double t = n * ratio;
+        const double lo = ceil(t - half), hi = floor(t + half);
+        const int first = __MAX(0, (int)lo);
+        const int last = __MIN((int)frames - 1, (int)hi);
+
+        for (unsigned c = 0; c < channels; c++)
+            out[n * channels + c] = 0.f;
+        for (int m = first; m <= last; m++)
+        {
+            const double x = t - m;
+            const double arg = M_PI * cutoff * x;
+            const double sinc = (arg != 0.) ? sin(arg) / arg : 1.;
+            const double window = .5 + .5 * cos(M_PI * x / half);
+            const double w = ratio * cutoff * sinc * window;
+
+            for (unsigned c = 0; c < channels; c++)
+                out[n * channels + c] += w * in[m * channels + c];
+        }
+    }
+    *frames_out = count;
+    return out;
+}
+
+float *audio_convolver_LoadWAV(vlc_object_t *obj, const char *path,
+                               unsigned rate, unsigned *channels,
+                               unsigned *frames)
+{
+    FILE *file = vlc_fopen(path, "rb");
+    if (file == NULL)
+    {
+        msg_Err(obj, "cannot open %s: %s", path, vlc_strerror_c(errno));
+        return NULL;
+    }
+
+    uint8_t *buf = NULL;
+    float *samples = NULL;
+    long size;
+    if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0
+     || fseek(file, 0, SEEK_SET) != 0)
+    {
+        msg_Err(obj, "cannot seek %s: %s", path, vlc_strerror_c(errno));
+        goto out;
+    }
+    if (size < 12 || size > WAV_MAX_SIZE)
+    {
+        msg_Err(obj, "invalid WAV file size: %ld bytes", size);
+        goto out;
+    }
+    buf = malloc(size);
+    if (unlikely(buf == NULL))
+        goto out;
+    if (fread(buf, 1, size, file) != (size_t)size)
+    {
+        msg_Err(obj, "cannot read %s", path);
+        goto out;
+    }
+
+    if (memcmp(buf, "RIFF", 4) || memcmp(buf + 8, "WAVE", 4))
+    {
+        msg_Err(obj, "%s is not a WAV file", path);
+        goto out;
+    }
+
+    const uint8_t *fmt = NULL, *data = NULL;
+    size_t data_size = 0;
+    for (size_t pos = 12; pos + 8 <= (size_t)size;)
+    {
+        const uint32_t chunk = GetDWLE(buf + pos + 4);
+        if (chunk > (size_t)size - pos - 8)
+            break;
+        if (!memcmp(buf + pos, "fmt ", 4) && chunk >= 16)
+            fmt = buf + pos + 8;
+        else if (!memcmp(buf + pos, "data", 4))
+        {
+            data = buf + pos + 8;
+            data_size = chunk;
+        }
+        pos += 8 + chunk + (chunk & 1);
+    }
+    if (fmt == NULL || data == NULL)
+    {
+        msg_Err(obj, "%s has no format or data", path);
+        goto out;
+    }
+
+    unsigned tag = GetWLE(fmt);
+    const unsigned nb_channels = GetWLE(fmt + 2);
+    const unsigned file_rate = GetDWLE(fmt + 4);
+    const unsigned bits = GetWLE(fmt + 14);
+    if (tag == 0xFFFE /* WAVE_FORMAT_EXTENSIBLE */
+     && fmt + 26 <= data /* has a sub-format */)
+        tag = GetWLE(fmt + 24);
+
+    const bool is_float = tag == 3 /* WAVE_FORMAT_IEEE_FLOAT */;
+    if (!(tag == 1 /* WAVE_FORMAT_PCM */
+          && (bits == 8 || bits == 16 || bits == 24 || bits == 32))
+     && !(is_float && bits == 32))
+    {
+        msg_Err(obj, "unsupported WAV format 0x%04X, %u bits", tag, bits);
+        goto out;
+    }
+    if (nb_channels == 0 || file_rate == 0)
+    {
+        msg_Err(obj, "invalid WAV format");
+        goto out;
+    }
+
+    const unsigned frame_size = nb_channels * (bits / 8);
+    const unsigned count = data_size / frame_size;
+    if (count == 0)
+    {
+        msg_Err(obj, "%s is empty", path);
+        goto out;
+    }
+
+    samples = vlc_alloc((size_t)count * nb_channels, sizeof (float));
+    if (unlikely(samples == NULL))
+        goto out;
+    for (size_t i = 0; i < (size_t)count * nb_channels; i++)
+        samples[i] = WAVSample(data + i * (bits / 8), bits, is_float);
+
+    *channels = nb_channels;
+    *frames = count;
+
+    if (file_rate != rate)
+    {
+        msg_Dbg(obj, "resampling impulse responses from %u Hz to %u Hz",
+                file_rate, rate);
+        float *resampled = Resample(samples, nb_channels, count, file_rate,
+                                    rate, frames);
+        free(samples);
+        samples = resampled;
+    }
+out:
+    free(buf);
+    fclose(file);
+    return samples;
+}
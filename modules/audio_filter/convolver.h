@@ -0,0 +1,92 @@
+/*****************************************************************************
+ * convolver.h: Partitioned convolution for audio filters
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FILTER_CONVOLVER_H
+#define VLC_AUDIO_FILTER_CONVOLVER_H
+
+/**
+ * Multichannel convolution with long impulse responses, uniformly
+ * partitioned in the frequency domain (overlap-save).
+ *
+ * Each output channel is the sum of the input channels convolved with the
+ * impulse response set for each pair. The cost per frame grows with the
+ * number of partitions, that is the response length over the block size,
+ * while the latency is one block.
+ */
+typedef struct audio_convolver audio_convolver_t;
+
+/**
+ * Creates a convolver.
+ *
+ * All the impulse responses are silent until set.
+ *
+ * \param inputs number of interleaved input channels
+ * \param outputs number of interleaved output channels
+ * \param block partition size in frames, a power of two
+ * \param length maximum impulse response length in frames
+ * \return the convolver, or NULL on error
+ */
+audio_convolver_t *audio_convolver_New(unsigned inputs, unsigned outputs,
+                                       unsigned block, unsigned length);
+void audio_convolver_Delete(audio_convolver_t *conv);
+
+/**
+ * Sets the impulse response from an input channel to an output channel.
+ *
+ * \param length number of samples of the response, truncated to the
+ * maximum length of the convolver
+ */
+void audio_convolver_SetResponse(audio_convolver_t *conv, unsigned input,
+                                 unsigned output, const float *response,
+                                 unsigned length);
+
+/**
+ * Convolves interleaved frames.
+ *
+ * The output is delayed by the block size: the first frames are the tail
+ * of the previous calls, or silence after creation or a reset.
+ * The input and output buffers must not overlap.
+ */
+void audio_convolver_Process(audio_convolver_t *conv, const float *in,
+                             float *out, unsigned frames);
+
+/** Forgets the past input */
+void audio_convolver_Reset(audio_convolver_t *conv);
+
+/** Returns the latency in frames */
+unsigned audio_convolver_Latency(const audio_convolver_t *conv);
+
+/**
+ * Loads impulse responses from a WAV file.
+ *
+ * The samples are converted to float, resampled to the requested rate if
+ * needed, and returned interleaved.
+ *
+ * \param path local file path
+ * \param rate sample rate of the responses to return
+ * \param channels [OUT] number of channels in the file
+ * \param frames [OUT] number of frames returned
+ * \return the samples to free(), or NULL on error
+ */
+float *audio_convolver_LoadWAV(vlc_object_t *obj, const char *path,
+                               unsigned rate, unsigned *channels,
+                               unsigned *frames);
+
+#endif
@@ -38,9 +38,9 @@
 #include <vlc_filter.h>
 
 #include "equalizer_presets.h"
+#include "biquad.h"
 
 /* TODO:
- *  - optimize a bit (you can hardly do slower ;)
  *  - add tables for more bands (15 and 32 would be cool), maybe with auto coeffs
  *    computation (not too hard once the Q is found).
  *  - support for external preset
@@ -113,13 +113,8 @@ typedef struct
     float f_gamp;   /* Global preamp */
     bool b_2eqz;
 
-    /* Filter state */
-    float x[32][2];
-    float y[32][128][2];
-
-    /* Second filter state */
-    float x2[32][2];
-    float y2[32][128][2];
+    /* Filter banks of the first and second pass */
+    audio_biquad_t *p_bank[2];
 
     vlc_mutex_t lock;
 } filter_sys_t;
@@ -128,7 +123,7 @@ static block_t *DoWork( filter_t *, block_t * );
 
 #define EQZ_IN_FACTOR (0.25f)
 static int  EqzInit( filter_t *, int );
-static void EqzFilter( filter_t *, float *, float *, int, int );
+static void EqzFilter( filter_t *, float *, float *, int );
 static void EqzClean( filter_t * );
 
 static int PresetCallback ( vlc_object_t *, char const *, vlc_value_t,
@@ -191,8 +186,7 @@ static void Close( vlc_object_t *p_this )
 static block_t * DoWork( filter_t * p_filter, block_t * p_in_buf )
 {
     EqzFilter( p_filter, (float*)p_in_buf->p_buffer,
-               (float*)p_in_buf->p_buffer, p_in_buf->i_nb_samples,
-               aout_FormatNbChannels( &p_filter->fmt_in.audio ) );
+               (float*)p_in_buf->p_buffer, p_in_buf->i_nb_samples );
     return p_in_buf;
 }
 
@@ -280,7 +274,7 @@ static int EqzInit( filter_t *p_filter, int i_rate )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
     eqz_config_t cfg;
-    int i, ch;
+    int i;
     vlc_value_t val1, val2, val3;
     vlc_object_t *p_aout = vlc_object_parent(p_filter);
     int i_ret = VLC_ENOMEM;
@@ -293,7 +287,18 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     p_sys->f_alpha = vlc_alloc( p_sys->i_band, sizeof(float) );
     p_sys->f_beta  = vlc_alloc( p_sys->i_band, sizeof(float) );
     p_sys->f_gamma = vlc_alloc( p_sys->i_band, sizeof(float) );
-    if( !p_sys->f_alpha || !p_sys->f_beta || !p_sys->f_gamma )
+    p_sys->f_amp   = NULL;
+
+    /* Filter state: the bands of a pass run in parallel on all the channels.
+     * Poles of bands below a thousandth of the rate are too close to the
+     * unit circle for single precision. */
+    const bool b_double = cfg.band[0].f_frequency * 1000.f < i_rate;
+    for( i = 0; i < 2; i++ )
+        p_sys->p_bank[i] = audio_biquad_New(
+            aout_FormatNbChannels( &p_filter->fmt_in.audio ),
+            p_sys->i_band, true, b_double );
+    if( !p_sys->f_alpha || !p_sys->f_beta || !p_sys->f_gamma
+     || !p_sys->p_bank[0] || !p_sys->p_bank[1] )
         goto error;
 
     for( i = 0; i < p_sys->i_band; i++ )
@@ -315,23 +320,6 @@ static int EqzInit( filter_t *p_filter, int i_rate )
         p_sys->f_amp[i] = 0.0f;
     }
 
-    /* Filter state */
-    for( ch = 0; ch < 32; ch++ )
-    {
-        p_sys->x[ch][0]  =
-        p_sys->x[ch][1]  =
-        p_sys->x2[ch][0] =
-        p_sys->x2[ch][1] = 0.0f;
-
-        for( i = 0; i < p_sys->i_band; i++ )
-        {
-            p_sys->y[ch][i][0]  =
-            p_sys->y[ch][i][1]  =
-            p_sys->y2[ch][i][0] =
-            p_sys->y2[ch][i][1] = 0.0f;
-        }
-    }
-
     var_Create( p_aout, "equalizer-bands", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
     var_Create( p_aout, "equalizer-preset", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
 
@@ -356,7 +344,6 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     {
         msg_Err(p_filter, "No preset selected");
         free( val2.psz_string );
-        free( p_sys->f_amp );
         i_ret = VLC_EGENERIC;
         goto error;
     }
@@ -368,8 +355,9 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     var_AddCallback( p_aout, "equalizer-preamp", PreampCallback, p_sys );
     var_AddCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
 
-    msg_Dbg( p_filter, "equalizer loaded for %d Hz with %d bands %d pass",
-                        i_rate, p_sys->i_band, p_sys->b_2eqz ? 2 : 1 );
+    msg_Dbg( p_filter, "equalizer loaded for %d Hz with %d bands %d pass "
+             "in %s precision", i_rate, p_sys->i_band, p_sys->b_2eqz ? 2 : 1,
+             b_double ? "double" : "single" );
     for( i = 0; i < p_sys->i_band; i++ )
     {
         msg_Dbg( p_filter, "   %.2f Hz -> factor:%f alpha:%f beta:%f gamma:%f",
@@ -379,71 +367,53 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     return VLC_SUCCESS;
 
 error:
+    for( i = 0; i < 2; i++ )
+        if( p_sys->p_bank[i] )
+            audio_biquad_Delete( p_sys->p_bank[i] );
     free( p_sys->f_alpha );
     free( p_sys->f_beta );
     free( p_sys->f_gamma );
+    free( p_sys->f_amp );
     return i_ret;
 }
 
+/* Sets the gains of a pass: its output is
+ * gain * (EQZ_IN_FACTOR * x + sum(amp[j] * band[j](x))) */
+static void EqzSetGains( filter_sys_t *p_sys, audio_biquad_t *p_bank,
+                         float f_gain )
+{
+    for( int j = 0; j < p_sys->i_band; j++ )
+    {
+        /* y = alpha * (x[0] - x[-2]) + gamma * y[-1] - beta * y[-2] */
+        const double coeffs[5] = {
+            p_sys->f_alpha[j], 0., -p_sys->f_alpha[j],
+            -p_sys->f_gamma[j], p_sys->f_beta[j],
+        };
+        audio_biquad_SetSection( p_bank, j, coeffs,
+                                 f_gain * p_sys->f_amp[j] );
+    }
+    audio_biquad_SetDirect( p_bank, f_gain * EQZ_IN_FACTOR );
+}
+
 static void EqzFilter( filter_t *p_filter, float *out, float *in,
-                       int i_samples, int i_channels )
+                       int i_samples )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    int i, ch, j;
 
     vlc_mutex_lock( &p_sys->lock );
-    for( i = 0; i < i_samples; i++ )
+    if( p_sys->b_2eqz )
     {
-        for( ch = 0; ch < i_channels; ch++ )
-        {
-            const float x = in[ch];
-            float o = 0.0f;
-
-            for( j = 0; j < p_sys->i_band; j++ )
-            {
-                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
-                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
-                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
-
-                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
-                p_sys->y[ch][j][0] = y;
-
-                o += y * p_sys->f_amp[j];
-            }
-            p_sys->x[ch][1] = p_sys->x[ch][0];
-            p_sys->x[ch][0] = x;
-
-            /* Second filter */
-            if( p_sys->b_2eqz )
-            {
-                const float x2 = EQZ_IN_FACTOR * x + o;
-                o = 0.0f;
-                for( j = 0; j < p_sys->i_band; j++ )
-                {
-                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
-                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
-                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
-
-                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
-                    p_sys->y2[ch][j][0] = y;
-
-                    o += y * p_sys->f_amp[j];
-                }
-                p_sys->x2[ch][1] = p_sys->x2[ch][0];
-                p_sys->x2[ch][0] = x2;
-
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp * p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
-            }
-            else
-            {
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x + o );
-            }
-        }
-
-        in  += i_channels;
-        out += i_channels;
+        /* The preamp applies to the output of the second pass only */
+        EqzSetGains( p_sys, p_sys->p_bank[0], 1.f );
+        EqzSetGains( p_sys, p_sys->p_bank[1],
+                     p_sys->f_gamp * p_sys->f_gamp );
+        audio_biquad_Process( p_sys->p_bank[0], in, out, i_samples );
+        audio_biquad_Process( p_sys->p_bank[1], out, out, i_samples );
+    }
+    else
+    {
+        EqzSetGains( p_sys, p_sys->p_bank[0], p_sys->f_gamp );
+        audio_biquad_Process( p_sys->p_bank[0], in, out, i_samples );
     }
     vlc_mutex_unlock( &p_sys->lock );
 }
@@ -458,6 +428,9 @@ static void EqzClean( filter_t *p_filter )
     var_DelCallback( p_aout, "equalizer-preamp", PreampCallback, p_sys );
     var_DelCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
 
+    audio_biquad_Delete( p_sys->p_bank[0] );
+    audio_biquad_Delete( p_sys->p_bank[1] );
+
     free( p_sys->f_alpha );
     free( p_sys->f_beta );
     free( p_sys->f_gamma );
@@ -0,0 +1,140 @@
+/*****************************************************************************
+ * fft.c: Fast Fourier transform for audio filters
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+
+#include "fft.h"
+
+struct audio_fft
+{
+    unsigned size;
+    unsigned *bitrev;
+    /* Twiddle factors of each pass, exp(-i pi k / half) for k < half,
+     * stored contiguously from index half - 1 */
+    double *cos;
+    double *sin;
+};
+
+audio_fft_t *audio_fft_New(unsigned size)
+{
+    if (size < 2 || (size & (size - 1)) != 0)
+        return NULL;
+
+    audio_fft_t *fft = malloc(sizeof (*fft));
+    if (unlikely(fft == NULL))
+        return NULL;
+
+    fft->size = size;
+    fft->bitrev = vlc_alloc(size, sizeof (*fft->bitrev));
+    fft->cos = vlc_alloc(size - 1, sizeof (*fft->cos));
+    fft->sin = vlc_alloc(size - 1, sizeof (*fft->sin));
+    if (unlikely(fft->bitrev == NULL || fft->cos == NULL || fft->sin == NULL))
+    {
+        audio_fft_Delete(fft);
+        return NULL;
+    }
+
+    unsigned bits = 0;
+    while ((1u << bits) < size)
+        bits++;
+    for (unsigned i = 0; i < size; i++)
+    {
+        unsigned rev = 0;
+        for (unsigned b = 0; b < bits; b++)
+            rev |= ((i >> b) & 1) << (bits - 1 - b);
+        fft->bitrev[i] = rev;
+    }
+
+    for (unsigned half = 1; half < size; half *= 2)
+        for (unsigned k = 0; k < half; k++)
+        {
+            fft->cos[half - 1 + k] = cos(M_PI * k / half);
+            fft->sin[half - 1 + k] = -sin(M_PI * k / half);
+        }
+
+    return fft;
+}
+
+void audio_fft_Delete(audio_fft_t *fft)
+{
+    free(fft->bitrev);
+    free(fft->cos);
+    free(fft->sin);
+    free(fft);
+}
+
+unsigned audio_fft_Size(const audio_fft_t *fft)
+{
+    return fft->size;
+}
+
+void audio_fft_Forward(const audio_fft_t *fft, double *restrict re,
+                       double *restrict im)
+{
+    const unsigned size = fft->size;
+
+    for (unsigned i = 0; i < size; i++)
+    {
+        unsigned j = fft->bitrev[i];
+        if (i < j)
+        {
+            double r = re[i], m = im[i];
+            re[i] = re[j]; im[i] = im[j];
+            re[j] = r; im[j] = m;
+        }
+    }
+
+    for (unsigned half = 1; half < size; half *= 2)
+    {
+        const double *wr = fft->cos + half - 1;
+        const double *wi = fft->sin + half - 1;
+
+        for (unsigned i = 0; i < size; i += 2 * half)
+        {
+            double *restrict ar = re + i, *restrict ai = im + i;
+            double *restrict br = ar + half, *restrict bi = ai + half;
+
+            for (unsigned k = 0; k < half; k++)
+            {
+                const double tr = wr[k] * br[k] - wi[k] * bi[k];
+                const double ti = wr[k] * bi[k] + wi[k] * br[k];
+
+                br[k] = ar[k] - tr;
+                bi[k] = ai[k] - ti;
+                ar[k] += tr;
+                ai[k] += ti;
+            }
+        }
+    }
+}
+
+void audio_fft_Inverse(const audio_fft_t *fft, double *re, double *im)
+{
+    /* Swapping the real and imaginary parts before and after the forward
+     * transform conjugates its kernel */
+    audio_fft_Forward(fft, im, re);
+}
@@ -0,0 +1,49 @@
+/*****************************************************************************
+ * fft.h: Fast Fourier transform for audio filters
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_AUDIO_FILTER_FFT_H
+#define VLC_AUDIO_FILTER_FFT_H
+
+/**
+ * Complex radix-2 transform of a fixed power of two size, in double
+ * precision, in place on split real and imaginary arrays.
+ *
+ * The transforms are not normalized: an inverse transform following a
+ * forward transform multiplies the input by the size.
+ */
+typedef struct audio_fft audio_fft_t;
+
+/**
+ * Creates a transform.
+ *
+ * \param size number of complex points, a power of two
+ * \return the transform, or NULL on error
+ */
+audio_fft_t *audio_fft_New(unsigned size);
+void audio_fft_Delete(audio_fft_t *fft);
+
+unsigned audio_fft_Size(const audio_fft_t *fft);
+
+/** Computes X[k] = sum x[n] exp(-2 i pi k n / size) */
+void audio_fft_Forward(const audio_fft_t *fft, double *re, double *im);
+/** Computes x[n] = sum X[k] exp(2 i pi k n / size) */
+void audio_fft_Inverse(const audio_fft_t *fft, double *re, double *im);
+
+#endif
@@ -36,6 +36,8 @@
 #include <vlc_aout.h>
 #include <vlc_filter.h>
 
+#include "biquad.h"
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -43,8 +45,6 @@ static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 static void CalcPeakEQCoeffs( float, float, float, float, float * );
 static void CalcShelfEQCoeffs( float, float, float, int, float, float * );
-static void ProcessEQ( const float *, float *, float *, unsigned, unsigned,
-                       const float *, unsigned );
 static block_t *DoWork( filter_t *, block_t * );
 
 vlc_module_begin ()
@@ -92,8 +92,8 @@ typedef struct
     float   f_highf, f_highgain;
     /* Filter computed coeffs */
     float   coeffs[5*5];
-    /* State */
-    float  *p_state;
+    /* Cascade of the sections */
+    audio_biquad_t *p_biquad;
 } filter_sys_t;
 
 
@@ -145,8 +145,27 @@ static int Open( vlc_object_t *p_this )
                       i_samplerate, p_sys->coeffs+3*5);
     CalcShelfEQCoeffs(p_sys->f_highf, 1, p_sys->f_highgain, 0,
                       i_samplerate, p_sys->coeffs+4*5);
-    p_sys->p_state = (float*)calloc( p_filter->fmt_in.audio.i_channels*5*4,
-                                     sizeof(float) );
+
+    /* Poles below a thousandth of the rate are too close to the unit
+     * circle for single precision */
+    float f_min = __MIN( p_sys->f_lowf, p_sys->f_highf );
+    f_min = __MIN( f_min, __MIN( p_sys->f_f1, p_sys->f_f2 ) );
+    f_min = __MIN( f_min, p_sys->f_f3 );
+    p_sys->p_biquad = audio_biquad_New( p_filter->fmt_in.audio.i_channels, 5,
+                                        false, f_min * 1000.f < i_samplerate );
+    if( !p_sys->p_biquad )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    for( unsigned i = 0; i < 5; i++ )
+    {
+        const double coeffs[5] = {
+            p_sys->coeffs[i*5+0], p_sys->coeffs[i*5+1], p_sys->coeffs[i*5+2],
+            p_sys->coeffs[i*5+3], p_sys->coeffs[i*5+4],
+        };
+        audio_biquad_SetSection( p_sys->p_biquad, i, coeffs, 1. );
+    }
 
     return VLC_SUCCESS;
 }
@@ -155,7 +174,7 @@ static void Close( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
-    free( p_sys->p_state );
+    audio_biquad_Delete( p_sys->p_biquad );
     free( p_sys );
 }
 
@@ -167,10 +186,8 @@ static void Close( vlc_object_t *p_this )
 static block_t *DoWork( filter_t * p_filter, block_t * p_in_buf )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    ProcessEQ( (float*)p_in_buf->p_buffer, (float*)p_in_buf->p_buffer,
-               p_sys->p_state,
-               p_filter->fmt_in.audio.i_channels, p_in_buf->i_nb_samples,
-               p_sys->coeffs, 5 );
+    audio_biquad_Process( p_sys->p_biquad, (float*)p_in_buf->p_buffer,
+                          (float*)p_in_buf->p_buffer, p_in_buf->i_nb_samples );
     return p_in_buf;
 }
 
@@ -274,50 +291,3 @@ static void CalcShelfEQCoeffs( float f0, float slope, float gainDB, int high,
     coeffs[3] = a1/a0;
     coeffs[4] = a2/a0;
 }
-
-/*
-  src is assumed to be interleaved
-  dest is assumed to be interleaved
-  size of state is 4*channels*eqCount
-  samples is not premultiplied by channels
-  size of coeffs is 5*eqCount
-*/
-void ProcessEQ( const float *src, float *dest, float *state,
-                unsigned channels, unsigned samples, const float *coeffs,
-                unsigned eqCount )
-{
-    unsigned i, chn, eq;
-    float   b0, b1, b2, a1, a2;
-    float   x, y = 0;
-    const float *src1 = src;
-    float *dest1 = dest;
-
-    for (i = 0; i < samples; i++)
-    {
-        float *state1 = state;
-        for (chn = 0; chn < channels; chn++)
-        {
-            const float *coeffs1 = coeffs;
-            x = *src1++;
-            /* Direct form 1 IIRs */
-            for (eq = 0; eq < eqCount; eq++)
-            {
-                b0 = coeffs1[0];
-                b1 = coeffs1[1];
-                b2 = coeffs1[2];
-                a1 = coeffs1[3];
-                a2 = coeffs1[4];
-                coeffs1 += 5;
-                y = x*b0 + state1[0]*b1 + state1[1]*b2 - state1[2]*a1 - state1[3]*a2;
-                state1[1] = state1[0];
-                state1[0] = x;
-                state1[3] = state1[2];
-                state1[2] = y;
-                x = y;
-                state1 += 4;
-            }
-            *dest1++ = y;
-        }
-    }
-}
-
@@ -0,0 +1,665 @@
+/*****************************************************************************
+ * polyphase.c : polyphase windowed-sinc resampler
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble:
+ *
+ * The low-pass filter is a Kaiser-windowed sinc, sampled in a table at
+ * POLYPHASE_PHASES phases between two input samples. The coefficients of
+ * each output sample are linearly interpolated between the two nearest
+ * phases, so that any ratio, including the slowly varying ratios of the
+ * audio output drift compensation, can be used without rebuilding the table.
+ *
+ * The input is kept planar, so that the filter of each channel is a dot
+ * product of contiguous samples, vectorized with SSE, AVX or NEON.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_aout.h>
+#include <vlc_filter.h>
+#include <vlc_block.h>
+#include <vlc_cpu.h>
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
+/* Phases of the filter table between two input samples */
+#define POLYPHASE_PHASES 256
+/* Taps of the filter, without decimation, a multiple of 16 */
+#define POLYPHASE_TAPS 64
+#define POLYPHASE_MAX_TAPS 512
+/* Kaiser window parameter, for about 90 dB of stop-band attenuation */
+#define POLYPHASE_BETA 9.
+/* Cut-off frequency, relative to the Nyquist frequency, so that the
+ * transition band of the filter ends at the Nyquist frequency */
+#define POLYPHASE_CUTOFF .91
+
+static int  OpenConverter( vlc_object_t * );
+static int  OpenResampler( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+vlc_module_begin ()
+    set_category( CAT_AUDIO )
+    set_subcategory( SUBCAT_AUDIO_RESAMPLER )
+    set_description( N_("Polyphase audio resampler") )
+    set_capability( "audio converter", 30 )
+    set_callbacks( OpenConverter, Close )
+
+    add_submodule()
+    set_capability( "audio resampler", 30 )
+    set_callbacks( OpenResampler, Close )
+    add_shortcut( "polyphase" )
+vlc_module_end ()
+
+/**
+ * Computes one output frame.
+ *
+ * \param out output frame
+ * \param in first input sample of the first channel
+ * \param stride distance between the input samples of two channels
+ * \param h0 coefficients of the phase before the output sample
+ * \param h1 coefficients of the phase after the output sample
+ * \param frac position of the output sample between the two phases
+ * \param coefs storage for the interpolated coefficients
+ */
+typedef void (*polyphase_kernel_t)( float *out, const float *in, size_t stride,
+                                    unsigned channels, const float *h0,
+                                    const float *h1, float frac,
+                                    float *coefs, unsigned taps );
+
+typedef struct
+{
+    /* filter */
+    float   *table;         /* POLYPHASE_PHASES + 1 rows of taps */
+    float   *coefs;
+    unsigned taps;
+    double   cutoff;
+    polyphase_kernel_t kernel;
+
+    /* planar input, delayed by half of the filter */
+    float   *history;
+    size_t   capacity;      /* frames of each channel row */
+    size_t   count;
+    double   pos;           /* position of the next output frame */
+    bool     idle;          /* passing the input through */
+
+    vlc_tick_t next_pts;    /* of the next input frame */
+} filter_sys_t;
+
+/*****************************************************************************
+ * Kernels
+ *****************************************************************************/
+static void FilterC( float *restrict out, const float *restrict in,
+                     size_t stride, unsigned channels,
+                     const float *restrict h0, const float *restrict h1,
+                     float frac, float *restrict coefs, unsigned taps )
+{
+    for( unsigned k = 0; k < taps; k++ )
+        coefs[k] = h0[k] + frac * ( h1[k] - h0[k] );
+
+    for( unsigned c = 0; c < channels; c++ )
+    {
+        const float *x = in + c * stride;
+        float sum = 0.f;
+        for( unsigned k = 0; k < taps; k++ )
+            sum += coefs[k] * x[k];
+        out[c] = sum;
+    }
+}
+
+#if defined(HAVE_SSE2_INTRINSICS)
+VLC_SSE
+static void FilterSSE( float *restrict out, const float *restrict in,
+                       size_t stride, unsigned channels,
+                       const float *restrict h0, const float *restrict h1,
+                       float frac, float *restrict coefs, unsigned taps )
+{
+    const __m128 f = _mm_set1_ps( frac );
+    for( unsigned k = 0; k < taps; k += 4 )
+    {
+        __m128 a = _mm_loadu_ps( h0 + k ), b = _mm_loadu_ps( h1 + k );
+        _mm_storeu_ps( coefs + k,
+                       _mm_add_ps( a, _mm_mul_ps( f, _mm_sub_ps( b, a ) ) ) );
+    }
+
+    for( unsigned c = 0; c < channels; c++ )
+    {
+        const float *x = in + c * stride;
+        __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+        for( unsigned k = 0; k < taps; k += 8 )
+        {
+            s0 = _mm_add_ps( s0, _mm_mul_ps( _mm_loadu_ps( coefs + k ),
+                                             _mm_loadu_ps( x + k ) ) );
+            s1 = _mm_add_ps( s1, _mm_mul_ps( _mm_loadu_ps( coefs + k + 4 ),
+                                             _mm_loadu_ps( x + k + 4 ) ) );
+        }
+        s0 = _mm_add_ps( s0, s1 );
+        s0 = _mm_add_ps( s0, _mm_movehl_ps( s0, s0 ) );
+        s0 = _mm_add_ss( s0, _mm_shuffle_ps( s0, s0, 1 ) );
+        _mm_store_ss( out + c, s0 );
+    }
+}
+#endif
+
+#if defined(HAVE_AVX2_INTRINSICS)
+__attribute__ ((__target__ ("avx")))
+static void FilterAVX( float *restrict out, const float *restrict in,
+                       size_t stride, unsigned channels,
+                       const float *restrict h0, const float *restrict h1,
+                       float frac, float *restrict coefs, unsigned taps )
+{
+    const __m256 f = _mm256_set1_ps( frac );
+    for( unsigned k = 0; k < taps; k += 8 )
+    {
+        __m256 a = _mm256_loadu_ps( h0 + k ), b = _mm256_loadu_ps( h1 + k );
+        _mm256_storeu_ps( coefs + k,
+            _mm256_add_ps( a, _mm256_mul_ps( f, _mm256_sub_ps( b, a ) ) ) );
+    }
+
+    for( unsigned c = 0; c < channels; c++ )
+    {
+        const float *x = in + c * stride;
+        __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+        for( unsigned k = 0; k < taps; k += 16 )
+        {
+            s0 = _mm256_add_ps( s0, _mm256_mul_ps( _mm256_loadu_ps( coefs + k ),
+                                                   _mm256_loadu_ps( x + k ) ) );
+            s1 = _mm256_add_ps( s1, _mm256_mul_ps( _mm256_loadu_ps( coefs + k + 8 ),
+                                                   _mm256_loadu_ps( x + k + 8 ) ) );
+        }
+        s0 = _mm256_add_ps( s0, s1 );
+        __m128 s = _mm_add_ps( _mm256_castps256_ps128( s0 ),
+                               _mm256_extractf128_ps( s0, 1 ) );
+        s = _mm_add_ps( s, _mm_movehl_ps( s, s ) );
+        s = _mm_add_ss( s, _mm_shuffle_ps( s, s, 1 ) );
+        _mm_store_ss( out + c, s );
+    }
+}
+#endif
+
+#if defined(__ARM_NEON)
+static void FilterNEON( float *restrict out, const float *restrict in,
+                        size_t stride, unsigned channels,
+                        const float *restrict h0, const float *restrict h1,
+                        float frac, float *restrict coefs, unsigned taps )
+{
+    for( unsigned k = 0; k < taps; k += 4 )
+    {
+        float32x4_t a = vld1q_f32( h0 + k ), b = vld1q_f32( h1 + k );
+        vst1q_f32( coefs + k, vmlaq_n_f32( a, vsubq_f32( b, a ), frac ) );
+    }
+
+    for( unsigned c = 0; c < channels; c++ )
+    {
+        const float *x = in + c * stride;
+        float32x4_t s0 = vdupq_n_f32( 0.f ), s1 = vdupq_n_f32( 0.f );
+        for( unsigned k = 0; k < taps; k += 8 )
+        {
+            s0 = vmlaq_f32( s0, vld1q_f32( coefs + k ), vld1q_f32( x + k ) );
+            s1 = vmlaq_f32( s1, vld1q_f32( coefs + k + 4 ),
+                            vld1q_f32( x + k + 4 ) );
+        }
+        s0 = vaddq_f32( s0, s1 );
+        float32x2_t s = vadd_f32( vget_low_f32( s0 ), vget_high_f32( s0 ) );
+        out[c] = vget_lane_f32( vpadd_f32( s, s ), 0 );
+    }
+}
+#endif
+
+static polyphase_kernel_t GetKernel( void )
+{
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX() )
+        return FilterAVX;
+#endif
+#if defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE() )
+        return FilterSSE;
+#endif
+#if defined(__ARM_NEON)
+    if( vlc_CPU_ARM_NEON() )
+        return FilterNEON;
+#endif
+    return FilterC;
+}
+
+/*****************************************************************************
+ * Filter table
+ *****************************************************************************/
+static double BesselI0( double x )
+{
+    double sum = 1., term = 1.;
+    for( unsigned k = 1; term > sum * 1e-12; k++ )
+    {
+        term *= ( x / ( 2 * k ) ) * ( x / ( 2 * k ) );
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * Builds the table of the filter for a cut-off frequency, relative to the
+ * input Nyquist frequency, and widens the input history to the new filter.
+ */
+static int SetupTable( filter_sys_t *p_sys, unsigned channels, double cutoff )
+{
+    unsigned taps = ceil( POLYPHASE_TAPS * POLYPHASE_CUTOFF / cutoff / 16 ) * 16;
+    taps = __MIN( taps, POLYPHASE_MAX_TAPS );
+
+    if( taps != p_sys->taps )
+    {
+        float *table = vlc_alloc( ( POLYPHASE_PHASES + 1 ) * taps,
+                                  sizeof( *table ) );
+        float *coefs = vlc_alloc( taps, sizeof( *coefs ) );
+        if( unlikely( table == NULL || coefs == NULL ) )
+        {
+            free( table );
+            free( coefs );
+            return VLC_ENOMEM;
+        }
+        free( p_sys->table );
+        free( p_sys->coefs );
+        p_sys->table = table;
+        p_sys->coefs = coefs;
+
+        /* Keep the history of the widest filter */
+        if( taps > p_sys->taps )
+        {
+            const size_t pad = taps / 2 - p_sys->taps / 2;
+            const size_t capacity = p_sys->count + pad;
+            if( capacity > p_sys->capacity )
+            {
+                float *history = vlc_alloc( channels * capacity,
+                                            sizeof( *history ) );
+                if( unlikely( history == NULL ) )
+                    return VLC_ENOMEM;
+                for( unsigned c = 0; c < channels; c++ )
+                    memcpy( history + c * capacity + pad,
+                            p_sys->history + c * p_sys->capacity,
+                            p_sys->count * sizeof( *history ) );
+                free( p_sys->history );
+                p_sys->history = history;
+                p_sys->capacity = capacity;
+            }
+            else
+                for( unsigned c = 0; c < channels; c++ )
+                    memmove( p_sys->history + c * p_sys->capacity + pad,
+                             p_sys->history + c * p_sys->capacity,
+                             p_sys->count * sizeof( *p_sys->history ) );
+            for( unsigned c = 0; c < channels; c++ )
+                memset( p_sys->history + c * p_sys->capacity, 0,
+                        pad * sizeof( *p_sys->history ) );
+            p_sys->count += pad;
+            p_sys->pos += pad;
+        }
+        p_sys->taps = taps;
+    }
+
+    const double half = taps / 2;
+    const double i0_beta = BesselI0( POLYPHASE_BETA );
+    for( unsigned p = 0; p <= POLYPHASE_PHASES; p++ )
+    {
+        float *h = p_sys->table + p * taps;
+        double sum = 0.;
+
+        for( unsigned k = 0; k < taps; k++ )
+        {
+            /* Distance from the output sample to the input sample */
+            const double d = (double)p / POLYPHASE_PHASES + half - 1 - k;
+            const double t = d / half;
+            double v = 0.;
+
+            if( fabs( t ) < 1. )
+            {
+                const double x = M_PI * cutoff * d;
+                v = cutoff * ( x != 0. ? sin( x ) / x : 1. )
+                  * BesselI0( POLYPHASE_BETA * sqrt( 1. - t * t ) ) / i0_beta;
+            }
+            h[k] = v;
+            sum += v;
+        }
+        /* Unity gain at every phase */
+        for( unsigned k = 0; k < taps; k++ )
+            h[k] /= sum;
+    }
+    p_sys->cutoff = cutoff;
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * History
+ *****************************************************************************/
+static void Reset( filter_sys_t *p_sys, unsigned channels )
+{
+    /* Silence before the first input frame */
+    const size_t half = p_sys->taps / 2;
+    for( unsigned c = 0; c < channels; c++ )
+        memset( p_sys->history + c * p_sys->capacity, 0,
+                ( half - 1 ) * sizeof( *p_sys->history ) );
+    p_sys->count = half - 1;
+    p_sys->pos = half - 1;
+    p_sys->idle = true;
+    p_sys->next_pts = VLC_TICK_INVALID;
+}
+
+static int Append( filter_sys_t *p_sys, unsigned channels,
+                   const float *in, size_t frames )
+{
+    if( p_sys->count + frames > p_sys->capacity )
+    {
+        const size_t capacity = p_sys->count + frames;
+        float *history = vlc_alloc( channels * capacity, sizeof( *history ) );
+        if( unlikely( history == NULL ) )
+            return VLC_ENOMEM;
+        for( unsigned c = 0; c < channels; c++ )
+            memcpy( history + c * capacity,
+                    p_sys->history + c * p_sys->capacity,
+                    p_sys->count * sizeof( *history ) );
+        free( p_sys->history );
+        p_sys->history = history;
+        p_sys->capacity = capacity;
+    }
+
+    for( unsigned c = 0; c < channels; c++ )
+    {
+        float *row = p_sys->history + c * p_sys->capacity + p_sys->count;
+        for( size_t i = 0; i < frames; i++ )
+            row[i] = in[i * channels + c];
+    }
+    p_sys->count += frames;
+    return VLC_SUCCESS;
+}
+
+/* Drops the frames before the filter of the next output frame */
+static void Consume( filter_sys_t *p_sys, unsigned channels )
+{
+    const size_t drop = (size_t)p_sys->pos - ( p_sys->taps / 2 - 1 );
+    if( drop == 0 )
+        return;
+
+    for( unsigned c = 0; c < channels; c++ )
+    {
+        float *row = p_sys->history + c * p_sys->capacity;
+        memmove( row, row + drop, ( p_sys->count - drop ) * sizeof( *row ) );
+    }
+    p_sys->count -= drop;
+    p_sys->pos -= drop;
+}
+
+/*****************************************************************************
+ * Resample: convert a buffer
+ *****************************************************************************/
+static block_t *PassThrough( filter_t *p_filter, block_t *p_in )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned channels = p_filter->fmt_in.audio.i_channels;
+    const size_t i_bytes_per_frame = p_filter->fmt_out.audio.i_bytes_per_frame;
+    const size_t i_held = p_sys->count - (size_t)p_sys->pos;
+    block_t *p_out = p_in;
+
+    /* Output the frames that the filter still holds first */
+    if( i_held > 0 )
+    {
+        p_out = block_Alloc( ( i_held + p_in->i_nb_samples )
+                             * i_bytes_per_frame );
+        if( unlikely( p_out == NULL ) )
+        {
+            block_Release( p_in );
+            return NULL;
+        }
+        float *out = (float *)p_out->p_buffer;
+        for( unsigned c = 0; c < channels; c++ )
+        {
+            const float *row = p_sys->history + c * p_sys->capacity
+                             + (size_t)p_sys->pos;
+            for( size_t i = 0; i < i_held; i++ )
+                out[i * channels + c] = row[i];
+        }
+        memcpy( out + i_held * channels, p_in->p_buffer,
+                p_in->i_nb_samples * i_bytes_per_frame );
+        p_out->i_nb_samples = i_held + p_in->i_nb_samples;
+        p_out->i_flags = p_in->i_flags;
+        p_out->i_pts = p_out->i_dts = p_in->i_pts
+            - vlc_tick_from_samples( i_held, p_filter->fmt_in.audio.i_rate );
+        p_out->i_length = vlc_tick_from_samples( p_out->i_nb_samples,
+                                                 p_filter->fmt_out.audio.i_rate );
+    }
+
+    /* Keep the last input frames, so that the filter can start seamlessly */
+    const size_t keep = __MIN( p_sys->taps / 2 - 1, p_in->i_nb_samples );
+    p_sys->pos = p_sys->count;
+    Consume( p_sys, channels );
+    if( Append( p_sys, channels, (const float *)p_in->p_buffer
+                + ( p_in->i_nb_samples - keep ) * channels, keep ) == 0 )
+    {
+        p_sys->pos = p_sys->count;
+        Consume( p_sys, channels );
+    }
+    p_sys->idle = true;
+
+    if( p_out != p_in )
+        block_Release( p_in );
+    return p_out;
+}
+
+static block_t *Convert( filter_t *p_filter, block_t *p_in )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned channels = p_filter->fmt_in.audio.i_channels;
+    const unsigned i_in_rate = p_filter->fmt_in.audio.i_rate;
+    const unsigned i_out_rate = p_filter->fmt_out.audio.i_rate;
+    const size_t i_bytes_per_frame = p_filter->fmt_out.audio.i_bytes_per_frame;
+
+    /* Adapt the filter to the ratio, ignoring the drift adjustments */
+    const double cutoff = POLYPHASE_CUTOFF
+                        * __MIN( 1., i_out_rate / (double)i_in_rate );
+    if( fabs( cutoff - p_sys->cutoff ) > p_sys->cutoff * .01
+     && SetupTable( p_sys, channels, cutoff ) )
+        goto error;
+
+    const size_t i_start = p_sys->count;
+    if( Append( p_sys, channels, (const float *)p_in->p_buffer,
+                p_in->i_nb_samples ) )
+        goto error;
+    p_sys->idle = false;
+
+    const size_t half = p_sys->taps / 2;
+    const double step = i_in_rate / (double)i_out_rate;
+    size_t i_max_out = 0;
+    if( p_sys->count > p_sys->pos + half )
+        i_max_out = ( p_sys->count - half - p_sys->pos ) / step + 2;
+
+    block_t *p_out = block_Alloc( i_max_out * i_bytes_per_frame );
+    if( unlikely( p_out == NULL ) )
+        goto error;
+
+    const double i_first_pos = p_sys->pos;
+    float *out = (float *)p_out->p_buffer;
+    size_t i_out = 0;
+    while( i_out < i_max_out )
+    {
+        const size_t center = p_sys->pos;
+        if( center + half >= p_sys->count )
+            break;
+
+        const double phase = ( p_sys->pos - center ) * POLYPHASE_PHASES;
+        unsigned p = phase;
+        float frac = phase - p;
+        if( unlikely( p >= POLYPHASE_PHASES ) )
+        {
+            p = POLYPHASE_PHASES - 1;
+            frac = 1.f;
+        }
+        const float *h0 = p_sys->table + p * p_sys->taps;
+
+        p_sys->kernel( out, p_sys->history + center - ( half - 1 ),
+                       p_sys->capacity, channels, h0, h0 + p_sys->taps, frac,
+                       p_sys->coefs, p_sys->taps );
+        out += channels;
+        i_out++;
+        p_sys->pos += step;
+    }
+    Consume( p_sys, channels );
+
+    p_out->i_nb_samples = i_out;
+    p_out->i_buffer = i_out * i_bytes_per_frame;
+    p_out->i_flags = p_in->i_flags;
+    p_out->i_pts = p_out->i_dts = p_in->i_pts
+        + vlc_tick_from_secf( ( i_first_pos - i_start ) / i_in_rate );
+    p_out->i_length = vlc_tick_from_samples( i_out, i_out_rate );
+
+    block_Release( p_in );
+    return p_out;
+
+error:
+    block_Release( p_in );
+    return NULL;
+}
+
+static block_t *Resample( filter_t *p_filter, block_t *p_in )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const unsigned i_in_rate = p_filter->fmt_in.audio.i_rate;
+
+    if( p_in->i_flags & BLOCK_FLAG_DISCONTINUITY )
+        Reset( p_sys, p_filter->fmt_in.audio.i_channels );
+
+    p_sys->next_pts = p_in->i_pts
+                    + vlc_tick_from_samples( p_in->i_nb_samples, i_in_rate );
+
+    /* The drift compensation only adjusts the rate from time to time:
+     * pass through whenever the output frames fall on input frames */
+    if( i_in_rate == p_filter->fmt_out.audio.i_rate
+     && p_sys->pos == floor( p_sys->pos ) )
+        return PassThrough( p_filter, p_in );
+    return Convert( p_filter, p_in );
+}
+
+static block_t *Drain( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->idle )
+        return NULL;
+
+    /* Push silence through the filter to output the held frames */
+    const size_t frames = p_sys->taps / 2;
+    block_t *p_block = block_Alloc( frames
+                                  * p_filter->fmt_in.audio.i_bytes_per_frame );
+    if( unlikely( p_block == NULL ) )
+        return NULL;
+    memset( p_block->p_buffer, 0, p_block->i_buffer );
+    p_block->i_nb_samples = frames;
+    p_block->i_pts = p_sys->next_pts;
+
+    block_t *p_out = Convert( p_filter, p_block );
+    Reset( p_sys, p_filter->fmt_in.audio.i_channels );
+    return p_out;
+}
+
+static void Flush( filter_t *p_filter )
+{
+    Reset( p_filter->p_sys, p_filter->fmt_in.audio.i_channels );
+}
+
+/*****************************************************************************
+ * Open/Close
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    if( p_filter->fmt_in.audio.i_format != VLC_CODEC_FL32
+     || p_filter->fmt_out.audio.i_format != VLC_CODEC_FL32
+     || p_filter->fmt_in.audio.i_channels != p_filter->fmt_out.audio.i_channels
+     || p_filter->fmt_in.audio.i_channels == 0 )
+        return VLC_EGENERIC;
+
+    filter_sys_t *p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( unlikely( p_sys == NULL ) )
+        return VLC_ENOMEM;
+
+    const unsigned channels = p_filter->fmt_in.audio.i_channels;
+    const double cutoff = POLYPHASE_CUTOFF
+        * __MIN( 1., p_filter->fmt_out.audio.i_rate
+                     / (double)p_filter->fmt_in.audio.i_rate );
+
+    p_sys->capacity = POLYPHASE_MAX_TAPS;
+    p_sys->history = vlc_alloc( channels * p_sys->capacity,
+                                sizeof( *p_sys->history ) );
+    if( unlikely( p_sys->history == NULL )
+     || SetupTable( p_sys, channels, cutoff ) )
+    {
+        free( p_sys->table );
+        free( p_sys->coefs );
+        free( p_sys->history );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    p_sys->kernel = GetKernel();
+    Reset( p_sys, channels );
+
+    msg_Dbg( p_filter, "%u Hz -> %u Hz, %u channels, %u taps",
+             p_filter->fmt_in.audio.i_rate, p_filter->fmt_out.audio.i_rate,
+             channels, p_sys->taps );
+
+    p_filter->p_sys = p_sys;
+    p_filter->pf_audio_filter = Resample;
+    p_filter->pf_audio_drain = Drain;
+    p_filter->pf_flush = Flush;
+    return VLC_SUCCESS;
+}
+
+static int OpenResampler( vlc_object_t *p_this )
+{
+    return Open( p_this );
+}
+
+static int OpenConverter( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    if( p_filter->fmt_in.audio.i_rate == p_filter->fmt_out.audio.i_rate )
+        return VLC_EGENERIC;
+    return Open( p_this );
+}
+
+static void Close( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    free( p_sys->table );
+    free( p_sys->coefs );
+    free( p_sys->history );
+    free( p_sys );
+}
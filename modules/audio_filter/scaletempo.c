@@ -36,6 +36,14 @@
 
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
+#include <float.h> /* for FLT_EPSILON */
+#include <math.h>
+
+#include "fft.h"
+
+/* Relative cost of an FFT butterfly and of a multiply-add of the direct
+ * correlation, used to choose the overlap search */
+#define SCALETEMPO_FFT_COST 2.
 
 /*****************************************************************************
  * Module descriptor
@@ -88,6 +96,9 @@ vlc_module_end ()
  * Scaletempo smooths the overlap further by searching within the input buffer
  * for the best overlap position.  Scaletempo uses a statistical cross correlation
  * (roughly a dot-product).  Scaletempo consumes most of its CPU cycles here.
+ * With long searches or many channels, the cross correlation of all the
+ * search positions is computed with FFTs instead, and only the positions that
+ * could be the best one, given the rounding errors, are correlated directly.
  *
  * NOTE:
  * sample: a single audio sample for one channel
@@ -129,6 +140,12 @@ typedef struct
     void     *buf_pre_corr;
     void     *table_window;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
+    /* best overlap with FFT */
+    audio_fft_t *fft;
+    double   *fft_re;
+    double   *fft_im;
+    double   *corr_re;
+    double   *corr_im;
 #ifdef PITCH_SHIFTER
     /* pitch */
     filter_t * resampler;
@@ -139,13 +156,10 @@ typedef struct
 /*****************************************************************************
  * best_overlap_offset: calculate best offset for overlap
  *****************************************************************************/
-static unsigned best_overlap_offset_float( filter_t *p_filter )
+static void pre_correlate_float( filter_sys_t *p )
 {
-    filter_sys_t *p = p_filter->p_sys;
-    float *pw, *po, *ppc, *search_start;
-    float best_corr = INT_MIN;
-    unsigned best_off = 0;
-    unsigned i, off;
+    float *pw, *po, *ppc;
+    unsigned i;
 
     pw  = p->table_window;
     po  = p->buf_overlap;
@@ -154,15 +168,31 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
       *ppc++ = *pw++ * *po++;
     }
+}
+
+static float correlate_float( const float *ppc, const float *ps, unsigned n )
+{
+    float corr = 0;
+    for( unsigned i = 0; i < n; i++ ) {
+      corr += *ppc++ * *ps++;
+    }
+    return corr;
+}
+
+static unsigned best_overlap_offset_float( filter_t *p_filter )
+{
+    filter_sys_t *p = p_filter->p_sys;
+    float *search_start;
+    float best_corr = INT_MIN;
+    unsigned best_off = 0;
+    unsigned off;
+
+    pre_correlate_float( p );
 
     search_start = (float *)p->buf_queue + p->samples_per_frame;
     for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
+      float corr = correlate_float( p->buf_pre_corr, search_start,
+                                    p->samples_overlap - p->samples_per_frame );
       if( corr > best_corr ) {
         best_corr = corr;
         best_off  = off;
@@ -173,6 +203,124 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     return best_off * p->bytes_per_frame;
 }
 
+/*****************************************************************************
+ * best_overlap_offset_fft: same as best_overlap_offset_float, using FFTs
+ *****************************************************************************
+ * The correlation of every offset is the sum, over the channels, of the
+ * circular cross correlation of the pre-correlation window and the queue,
+ * computed in double precision. The float correlation of an offset can
+ * differ from it by at most the float summation error, bounded by
+ * n * (FLT_EPSILON * |window| * |queue at offset| + FLT_MIN), the last term
+ * accounting for the underflows, so only the offsets whose
+ * upper bound reaches the best lower bound are correlated again in float,
+ * in order, which selects the exact same offset as the direct search.
+ *****************************************************************************/
+static unsigned best_overlap_offset_fft( filter_t *p_filter )
+{
+    filter_sys_t *p = p_filter->p_sys;
+    const unsigned channels = p->samples_per_frame;
+    const unsigned samples = p->samples_overlap - channels;
+    const unsigned frames_window = samples / channels;
+    const unsigned frames_queue = p->frames_search + frames_window - 1;
+    const unsigned size = audio_fft_Size( p->fft );
+    const float *pc = p->buf_pre_corr;
+    const float *search_start = (float *)p->buf_queue + channels;
+    double *re = p->fft_re, *im = p->fft_im;
+    double *corr = p->corr_re, *err = p->corr_im;
+    unsigned off, i, c;
+
+    pre_correlate_float( p );
+
+    double norm_window = 0, norm_queue = 0;
+    for( i = 0; i < samples; i++ )
+        norm_window += (double)pc[i] * pc[i];
+    for( i = 0; i < frames_queue * channels; i++ )
+        norm_queue += (double)search_start[i] * search_start[i];
+    if( norm_window == 0 || norm_queue == 0 )
+        return 0; /* every correlation is zero, the first one is the best */
+    if( !isfinite( norm_window * norm_queue ) )
+        return best_overlap_offset_float( p_filter );
+
+    /* Cross spectrum of the window and the queue, summed over the channels.
+     * Both real signals are transformed at once, as the real and imaginary
+     * parts of a single complex signal. */
+    memset( corr, 0, size * sizeof( *corr ) );
+    memset( err, 0, size * sizeof( *err ) );
+    for( c = 0; c < channels; c++ )
+    {
+        for( i = 0; i < frames_queue; i++ )
+            re[i] = search_start[i * channels + c];
+        for( ; i < size; i++ )
+            re[i] = 0;
+        for( i = 0; i < frames_window; i++ )
+            im[i] = pc[i * channels + c];
+        for( ; i < size; i++ )
+            im[i] = 0;
+
+        audio_fft_Forward( p->fft, re, im );
+
+        for( i = 0; i < size; i++ )
+        {
+            const unsigned j = ( size - i ) & ( size - 1 );
+            const double q_re = ( re[i] + re[j] ) / 2;
+            const double q_im = ( im[i] - im[j] ) / 2;
+            const double w_re = ( im[i] + im[j] ) / 2;
+            const double w_im = ( re[j] - re[i] ) / 2;
+
+            corr[i] += w_re * q_re + w_im * q_im;
+            err[i]  += w_re * q_im - w_im * q_re;
+        }
+    }
+    audio_fft_Inverse( p->fft, corr, err );
+
+    /* Error bounds, from the energy of the queue at each offset, with some
+     * slack for the sliding sum */
+    const double float_error = 2. * samples * FLT_EPSILON;
+    const double abs_error = 8. * size * channels * DBL_EPSILON
+                           * sqrt( norm_window * norm_queue )
+                           + 2. * samples * FLT_MIN;
+    const double energy_error = 4. * frames_queue * channels * DBL_EPSILON
+                              * norm_queue;
+    double energy = 0;
+    for( i = 0; i < samples; i++ )
+        energy += (double)search_start[i] * search_start[i];
+
+    double best_lower = -INFINITY;
+    for( off = 0; off < p->frames_search; off++ )
+    {
+        if( off > 0 )
+        {
+            const float *ps = search_start + ( off - 1 ) * channels;
+            for( c = 0; c < channels; c++ )
+                energy += (double)ps[samples + c] * ps[samples + c]
+                        - (double)ps[c] * ps[c];
+        }
+
+        corr[off] /= size;
+        err[off] = float_error * sqrt( norm_window * ( fmax( energy, 0 )
+                                                     + energy_error ) )
+                 + abs_error;
+        best_lower = fmax( best_lower, corr[off] - err[off] );
+    }
+
+    float best_corr = INT_MIN;
+    unsigned best_off = 0;
+    for( off = 0; off < p->frames_search; off++ )
+    {
+        if( corr[off] + err[off] < best_lower )
+            continue;
+
+        float corr_float = correlate_float( pc, search_start + off * channels,
+                                            samples );
+        if( corr_float > best_corr ) {
+            best_corr = corr_float;
+            best_off  = off;
+        }
+    }
+
+    return best_off * p->bytes_per_frame;
+}
+
 /*****************************************************************************
  * output_overlap: blend end of previous stride with beginning of current stride
  *****************************************************************************/
@@ -352,6 +500,30 @@ static int reinit_buffers( filter_t *p_filter )
                 *pw++ = v;
         }
         p->best_overlap_offset = best_overlap_offset_float;
+
+        /* Use FFTs if they cost less than the direct correlations */
+        unsigned frames_queue = p->frames_search + frames_overlap - 2;
+        unsigned size = 2, log2_size = 1;
+        while( size < frames_queue )
+        {
+            size *= 2;
+            log2_size++;
+        }
+        double cost_direct = (double)p->frames_search
+                           * ( p->samples_overlap - p->samples_per_frame );
+        double cost_fft = SCALETEMPO_FFT_COST * ( p->samples_per_frame + 1 )
+                        * size * log2_size;
+        if( cost_fft < cost_direct )
+        {
+            p->fft     = audio_fft_New( size );
+            p->fft_re  = vlc_alloc( size, sizeof( double ) );
+            p->fft_im  = vlc_alloc( size, sizeof( double ) );
+            p->corr_re = vlc_alloc( size, sizeof( double ) );
+            p->corr_im = vlc_alloc( size, sizeof( double ) );
+            if( !p->fft || !p->fft_re || !p->fft_im || !p->corr_re || !p->corr_im )
+                return VLC_ENOMEM;
+            p->best_overlap_offset = best_overlap_offset_fft;
+        }
     }
 
     unsigned new_size = ( p->frames_search + frames_stride + frames_overlap ) * p->bytes_per_frame;
@@ -381,13 +553,13 @@ static int reinit_buffers( filter_t *p_filter )
     p->frames_stride_scaled = p->bytes_stride_scaled / p->bytes_per_frame;
 
     msg_Dbg( VLC_OBJECT(p_filter),
-             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search, %i queue, %s mode",
+             "%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search%s, %i queue, %s mode",
              p->scale,
              p->frames_stride_scaled,
              (int)( p->bytes_stride / p->bytes_per_frame ),
              (int)( p->bytes_standing / p->bytes_per_frame ),
              (int)( p->bytes_overlap / p->bytes_per_frame ),
-             p->frames_search,
+             p->frames_search, p->fft ? " (fft)" : "",
              (int)( p->bytes_queue_max / p->bytes_per_frame ),
              "fl32");
 
@@ -430,6 +602,11 @@ static int Open( vlc_object_t *p_this )
     p_sys->table_blend    = NULL;
     p_sys->buf_pre_corr   = NULL;
     p_sys->table_window   = NULL;
+    p_sys->fft            = NULL;
+    p_sys->fft_re         = NULL;
+    p_sys->fft_im         = NULL;
+    p_sys->corr_re        = NULL;
+    p_sys->corr_im        = NULL;
     p_sys->bytes_overlap  = 0;
     p_sys->bytes_queued   = 0;
     p_sys->bytes_to_slide = 0;
@@ -527,6 +704,12 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->table_blend );
     free( p_sys->buf_pre_corr );
     free( p_sys->table_window );
+    if( p_sys->fft )
+        audio_fft_Delete( p_sys->fft );
+    free( p_sys->fft_re );
+    free( p_sys->fft_im );
+    free( p_sys->corr_re );
+    free( p_sys->corr_im );
     free( p_sys );
 }
 
@@ -28,12 +28,22 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
 #include <stddef.h>
+#include <string.h>
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_cpu.h>
 #include <vlc_aout.h>
 #include <vlc_aout_volume.h>
 
+#if defined(HAVE_SSE2_INTRINSICS)
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
+
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
@@ -50,8 +60,164 @@ vlc_module_begin ()
     set_callbacks( Create, NULL )
 vlc_module_end ()
 
+/*****************************************************************************
+ * Kernels
+ *****************************************************************************
+ * They write src times the gain, or add it to dst if accumulate is set, while
+ * the gain of each frame follows the ramp progression from *gain, which is
+ * updated for the next frames.
+ *****************************************************************************/
+typedef void (*ramp_fl32_t)( float *, const float *, bool, size_t, unsigned,
+                             double *, double, double );
+
+#define RAMP_C(name, type) \
+static void name( type *dst, const type *src, bool accumulate, \
+                  size_t frames, unsigned channels, double *gain, \
+                  double ratio, double step ) \
+{ \
+    double g = *gain; \
+\
+    if( ratio == 1. && step == 0. ) \
+    { \
+        const type f = g; \
+\
+        /* Separate loops, that the compiler can vectorize */ \
+        if( accumulate ) \
+            for( size_t i = 0; i < frames * channels; i++ ) \
+                dst[i] += src[i] * f; \
+        else if( dst == src ) \
+            for( size_t i = 0; i < frames * channels; i++ ) \
+                dst[i] *= f; \
+        else \
+            for( size_t i = 0; i < frames * channels; i++ ) \
+                dst[i] = src[i] * f; \
+        return; \
+    } \
+\
+    for( size_t n = 0; n < frames; n++ ) \
+    { \
+        const type f = g; \
+\
+        for( unsigned c = 0; c < channels; c++ ) \
+            dst[c] = (accumulate ? dst[c] : 0) + src[c] * f; \
+        dst += channels; \
+        src += channels; \
+        g = g * ratio + step; \
+    } \
+    *gain = g; \
+}
+
+RAMP_C(RampFL32C, float)
+RAMP_C(RampFL64C, double)
+
+/* A group of as many frames as the lanes of a vector spans as many vectors as
+ * channels. In each of them, the gain of every lane is the gain of the first
+ * frame of the group times a factor, plus an offset. */
+#define RAMP_SIMD(name, vec, width, load, store, set1, add, mul) \
+static void name( float *dst, const float *src, bool accumulate, \
+                  size_t frames, unsigned channels, double *gain, \
+                  double ratio, double step ) \
+{ \
+    double factor[width + 1], offset[width + 1]; \
+    vec vfactor[AOUT_CHAN_MAX], voffset[AOUT_CHAN_MAX]; \
+\
+    if( ratio == 1. && step == 0. ) \
+    { \
+        const vec vg = set1( (float)*gain ); \
+        size_t i = 0; \
+\
+        if( accumulate ) \
+            for( ; i + width <= frames * channels; i += width ) \
+                store( dst + i, add( load( dst + i ), \
+                                     mul( load( src + i ), vg ) ) ); \
+        else \
+            for( ; i + width <= frames * channels; i += width ) \
+                store( dst + i, mul( load( src + i ), vg ) ); \
+        RampFL32C( dst + i, src + i, accumulate, frames * channels - i, \
+                   1, gain, ratio, step ); \
+        return; \
+    } \
+\
+    assert( channels <= AOUT_CHAN_MAX ); \
+    factor[0] = 1.; \
+    offset[0] = 0.; \
+    for( unsigned k = 0; k < width; k++ ) \
+    { \
+        factor[k + 1] = factor[k] * ratio; \
+        offset[k + 1] = offset[k] * ratio + step; \
+    } \
+    for( unsigned j = 0; j < channels; j++ ) \
+    { \
+        float f[width], o[width]; \
+\
+        for( unsigned l = 0; l < width; l++ ) \
+        { \
+            const unsigned k = (j * width + l) / channels; \
+            f[l] = factor[k]; \
+            o[l] = offset[k]; \
+        } \
+        vfactor[j] = load( f ); \
+        voffset[j] = load( o ); \
+    } \
+\
+    double g = *gain; \
+    size_t n = 0; \
+\
+    for( ; n + width <= frames; n += width ) \
+    { \
+        const vec vg = set1( (float)g ); \
+\
+        for( unsigned j = 0; j < channels; j++ ) \
+        { \
+            const vec v = mul( load( src ), add( mul( vg, vfactor[j] ), \
+                                                 voffset[j] ) ); \
+            store( dst, accumulate ? add( load( dst ), v ) : v ); \
+            dst += width; \
+            src += width; \
+        } \
+        g = g * factor[width] + offset[width]; \
+    } \
+    *gain = g; \
+    RampFL32C( dst, src, accumulate, frames - n, channels, gain, ratio, \
+               step ); \
+}
+
+#if defined(HAVE_SSE2_INTRINSICS)
+VLC_SSE
+RAMP_SIMD(RampFL32SSE, __m128, 4, _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps,
+          _mm_add_ps, _mm_mul_ps)
+#endif
+
+#if defined(HAVE_AVX2_INTRINSICS)
+__attribute__ ((__target__ ("avx")))
+RAMP_SIMD(RampFL32AVX, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps,
+          _mm256_set1_ps, _mm256_add_ps, _mm256_mul_ps)
+#endif
+
+#if defined(__ARM_NEON)
+RAMP_SIMD(RampFL32NEON, float32x4_t, 4, vld1q_f32, vst1q_f32, vdupq_n_f32,
+          vaddq_f32, vmulq_f32)
+#endif
+
+static ramp_fl32_t GetRampFL32( void )
+{
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX() )
+        return RampFL32AVX;
+#endif
+#if defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE() )
+        return RampFL32SSE;
+#endif
+#if defined(__ARM_NEON)
+    if( vlc_CPU_ARM_NEON() )
+        return RampFL32NEON;
+#endif
+    return RampFL32C;
+}
+
 /**
- * Mixes a new output buffer
+ * Amplifies a buffer
  */
 static void FilterFL32( audio_volume_t *p_volume, block_t *p_buffer,
                         float f_multiplier )
@@ -60,9 +226,10 @@ static void FilterFL32( audio_volume_t *p_volume, block_t *p_buffer,
         return; /* nothing to do */
 
     float *p = (float *)p_buffer->p_buffer;
-    for( size_t i = p_buffer->i_buffer / sizeof(*p); i > 0; i-- )
-        *(p++) *= f_multiplier;
+    double gain = f_multiplier;
 
+    GetRampFL32()( p, p, false, p_buffer->i_buffer / sizeof(*p), 1, &gain,
+                   1., 0. );
     (void) p_volume;
 }
 
@@ -80,6 +247,81 @@ static void FilterFL64( audio_volume_t *p_volume, block_t *p_buffer,
     (void) p_volume;
 }
 
+/**
+ * Amplifies a buffer with a gain ramp
+ */
+static void RampFL32( audio_volume_t *p_volume, block_t *p_buffer,
+                      unsigned i_channels, const audio_volume_ramp_t *p_ramp )
+{
+    float *p = (float *)p_buffer->p_buffer;
+    const size_t i_frames = p_buffer->i_buffer / (i_channels * sizeof(*p));
+    double ratio, step, gain = p_ramp->from;
+
+    audio_volume_RampProgression( p_ramp, i_frames, &ratio, &step );
+    GetRampFL32()( p, p, false, i_frames, i_channels, &gain, ratio, step );
+    (void) p_volume;
+}
+
+static void RampFL64( audio_volume_t *p_volume, block_t *p_buffer,
+                      unsigned i_channels, const audio_volume_ramp_t *p_ramp )
+{
+    double *p = (double *)p_buffer->p_buffer;
+    const size_t i_frames = p_buffer->i_buffer / (i_channels * sizeof(*p));
+    double ratio, step, gain = p_ramp->from;
+
+    audio_volume_RampProgression( p_ramp, i_frames, &ratio, &step );
+    RampFL64C( p, p, false, i_frames, i_channels, &gain, ratio, step );
+    (void) p_volume;
+}
+
+/**
+ * Mixes input buffers into an output buffer, in a single pass per input
+ */
+static void MixFL32( audio_volume_t *p_volume, block_t *p_out,
+                     block_t *const *pp_in, const audio_volume_ramp_t *p_ramps,
+                     unsigned i_count, unsigned i_channels )
+{
+    float *p = (float *)p_out->p_buffer;
+    const size_t i_frames = p_out->i_buffer / (i_channels * sizeof(*p));
+    const ramp_fl32_t ramp = GetRampFL32();
+
+    if( i_count == 0 )
+        memset( p, 0, i_frames * i_channels * sizeof(*p) );
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        double ratio, step, gain = p_ramps[i].from;
+
+        assert( pp_in[i]->i_buffer >= i_frames * i_channels * sizeof(*p) );
+        audio_volume_RampProgression( &p_ramps[i], i_frames, &ratio, &step );
+        ramp( p, (const float *)pp_in[i]->p_buffer, i > 0, i_frames,
+              i_channels, &gain, ratio, step );
+    }
+    (void) p_volume;
+}
+
+static void MixFL64( audio_volume_t *p_volume, block_t *p_out,
+                     block_t *const *pp_in, const audio_volume_ramp_t *p_ramps,
+                     unsigned i_count, unsigned i_channels )
+{
+    double *p = (double *)p_out->p_buffer;
+    const size_t i_frames = p_out->i_buffer / (i_channels * sizeof(*p));
+
+    if( i_count == 0 )
+        memset( p, 0, i_frames * i_channels * sizeof(*p) );
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        double ratio, step, gain = p_ramps[i].from;
+
+        assert( pp_in[i]->i_buffer >= i_frames * i_channels * sizeof(*p) );
+        audio_volume_RampProgression( &p_ramps[i], i_frames, &ratio, &step );
+        RampFL64C( p, (const double *)pp_in[i]->p_buffer, i > 0, i_frames,
+                   i_channels, &gain, ratio, step );
+    }
+    (void) p_volume;
+}
+
 /**
  * Initializes the mixer
  */
@@ -91,9 +333,13 @@ static int Create( vlc_object_t *p_this )
     {
         case VLC_CODEC_FL32:
             p_volume->amplify = FilterFL32;
+            p_volume->ramp = RampFL32;
+            p_volume->mix = MixFL32;
             break;
         case VLC_CODEC_FL64:
             p_volume->amplify = FilterFL64;
+            p_volume->ramp = RampFL64;
+            p_volume->mix = MixFL64;
             break;
         default:
             return -1;
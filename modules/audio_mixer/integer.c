@@ -22,6 +22,7 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
 #include <math.h>
 #include <limits.h>
 
@@ -40,6 +41,49 @@ vlc_module_begin ()
     set_callbacks (Activate, NULL)
 vlc_module_end ()
 
+/* Scales a sample by a fixed point multiplier, without clipping */
+static inline int_fast64_t ScaleS32N (int32_t s, int_fast32_t mult)
+{
+    return (s * (int_fast64_t)mult) >> INT64_C(24);
+}
+
+static inline int32_t ClipS32N (int_fast64_t s)
+{
+    if (s > INT32_MAX)
+        return INT32_MAX;
+    if (s < INT32_MIN)
+        return INT32_MIN;
+    return s;
+}
+
+static inline int_fast32_t ScaleS16N (int16_t s, int_fast32_t mult)
+{
+    return (s * mult) >> 8;
+}
+
+static inline int16_t ClipS16N (int_fast32_t s)
+{
+    if (s > INT16_MAX)
+        return INT16_MAX;
+    if (s < INT16_MIN)
+        return INT16_MIN;
+    return s;
+}
+
+static inline int_fast32_t ScaleU8 (uint8_t s, int_fast32_t mult)
+{
+    return (((int_fast8_t)(s - 128)) * mult) >> 8;
+}
+
+static inline uint8_t ClipU8 (int_fast32_t s)
+{
+    if (s > INT8_MAX)
+        return INT8_MAX + 128;
+    if (s < INT8_MIN)
+        return INT8_MIN + 128;
+    return s + 128;
+}
+
 static void FilterS32N (audio_volume_t *vol, block_t *block, float volume)
 {
     int32_t *p = (int32_t *)block->p_buffer;
@@ -50,13 +94,8 @@ static void FilterS32N (audio_volume_t *vol, block_t *block, float volume)
 
     for (size_t n = block->i_buffer / sizeof (*p); n > 0; n--)
     {
-        int_fast64_t s = (*p * (int_fast64_t)mult) >> INT64_C(24);
-        if (s > INT32_MAX)
-            s = INT32_MAX;
-        else
-        if (s < INT32_MIN)
-            s = INT32_MIN;
-        *(p++) = s;
+        *p = ClipS32N (ScaleS32N (*p, mult));
+        p++;
     }
     (void) vol;
 }
@@ -71,13 +110,8 @@ static void FilterS16N (audio_volume_t *vol, block_t *block, float volume)
 
     for (size_t n = block->i_buffer / sizeof (*p); n > 0; n--)
     {
-        int_fast32_t s = (*p * (int_fast32_t)mult) >> 8;
-        if (s > INT16_MAX)
-            s = INT16_MAX;
-        else
-        if (s < INT16_MIN)
-            s = INT16_MIN;
-        *(p++) = s;
+        *p = ClipS16N (ScaleS16N (*p, mult));
+        p++;
     }
     (void) vol;
 }
@@ -92,17 +126,78 @@ static void FilterU8 (audio_volume_t *vol, block_t *block, float volume)
 
     for (size_t n = block->i_buffer / sizeof (*p); n > 0; n--)
     {
-        int_fast32_t s = (((int_fast8_t)(*p - 128)) * (int_fast32_t)mult) >> 8;
-        if (s > INT8_MAX)
-            s = INT8_MAX;
-        else
-        if (s < INT8_MIN)
-            s = INT8_MIN;
-        *(p++) = s + 128;
+        *p = ClipU8 (ScaleU8 (*p, mult));
+        p++;
     }
     (void) vol;
 }
 
+/* The fixed point multiplier is updated for each frame, following the ramp
+ * progression. */
+#define INTEGER_MIXER(name, type, wide, bits) \
+static void Ramp##name (audio_volume_t *vol, block_t *block, \
+                        unsigned channels, const audio_volume_ramp_t *ramp) \
+{ \
+    type *p = (type *)block->p_buffer; \
+    const size_t frames = block->i_buffer / (channels * sizeof (*p)); \
+    double ratio, step, gain = ramp->from; \
+\
+    audio_volume_RampProgression (ramp, frames, &ratio, &step); \
+    for (size_t n = 0; n < frames; n++) \
+    { \
+        const int_fast32_t mult = lround (gain * (1 << bits)); \
+\
+        for (unsigned c = 0; c < channels; c++) \
+            p[c] = Clip##name (Scale##name (p[c], mult)); \
+        p += channels; \
+        gain = gain * ratio + step; \
+    } \
+    (void) vol; \
+} \
+\
+static void Mix##name (audio_volume_t *vol, block_t *out, \
+                       block_t *const *in, const audio_volume_ramp_t *ramps, \
+                       unsigned count, unsigned channels) \
+{ \
+    type *p = (type *)out->p_buffer; \
+    const size_t frames = out->i_buffer / (channels * sizeof (*p)); \
+    double gain[count + 1], ratio[count + 1], step[count + 1]; \
+    int_fast32_t mult[count + 1]; \
+\
+    for (unsigned i = 0; i < count; i++) \
+    { \
+        assert (in[i]->i_buffer >= frames * channels * sizeof (*p)); \
+        audio_volume_RampProgression (&ramps[i], frames, &ratio[i], \
+                                      &step[i]); \
+        gain[i] = ramps[i].from; \
+    } \
+\
+    for (size_t n = 0; n < frames; n++) \
+    { \
+        for (unsigned i = 0; i < count; i++) \
+        { \
+            mult[i] = lround (gain[i] * (1 << bits)); \
+            gain[i] = gain[i] * ratio[i] + step[i]; \
+        } \
+\
+        for (unsigned c = 0; c < channels; c++) \
+        { \
+            const size_t pos = n * channels + c; \
+            wide sum = 0; \
+\
+            for (unsigned i = 0; i < count; i++) \
+                sum += Scale##name (((const type *)in[i]->p_buffer)[pos], \
+                                    mult[i]); \
+            p[pos] = Clip##name (sum); \
+        } \
+    } \
+    (void) vol; \
+}
+
+INTEGER_MIXER(S32N, int32_t, int_fast64_t, 24)
+INTEGER_MIXER(S16N, int16_t, int_fast32_t, 8)
+INTEGER_MIXER(U8, uint8_t, int_fast32_t, 8)
+
 static int Activate (vlc_object_t *obj)
 {
     audio_volume_t *vol = (audio_volume_t *)obj;
@@ -111,12 +206,18 @@ static int Activate (vlc_object_t *obj)
     {
         case VLC_CODEC_S32N:
             vol->amplify = FilterS32N;
+            vol->ramp = RampS32N;
+            vol->mix = MixS32N;
             break;
         case VLC_CODEC_S16N:
             vol->amplify = FilterS16N;
+            vol->ramp = RampS16N;
+            vol->mix = MixS16N;
             break;
         case VLC_CODEC_U8:
             vol->amplify = FilterU8;
+            vol->ramp = RampU8;
+            vol->mix = MixU8;
             break;
         default:
             return -1;
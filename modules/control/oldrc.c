@@ -108,7 +108,7 @@ static int  AudioChannel ( vlc_object_t *, char const *,
 static int  Statistics   ( vlc_object_t *, char const *,
                            vlc_value_t, vlc_value_t, void * );
 
-static int updateStatistics( intf_thread_t *, input_item_t *);
+static int updateStatistics( intf_thread_t *, input_item_t *, bool );
 
 /* Status Callbacks */
 static int VolumeChanged( vlc_object_t *, char const *,
@@ -1704,12 +1704,14 @@ static int Statistics ( vlc_object_t *p_this, char const *psz_cmd,
     if( !p_input )
         return VLC_ENOOBJ;
 
-    updateStatistics( p_intf, input_GetItem(p_input) );
+    updateStatistics( p_intf, input_GetItem(p_input),
+                      var_InheritBool( p_input, "clock-low-latency" ) );
     input_Release(p_input);
     return VLC_SUCCESS;
 }
 
-static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
+static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item,
+                             bool b_clock )
 {
     if( !p_item ) return VLC_EGENERIC;
 
@@ -1739,6 +1741,11 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
             p_item->p_stats->i_displayed_pictures );
     msg_rc(_("| frames lost      :    %5"PRIi64),
             p_item->p_stats->i_lost_pictures );
+    msg_rc(_("| frames late      :    %5"PRIi64),
+            p_item->p_stats->i_late_pictures );
+    msg_rc(_("| display offset   :    %5"PRId64" ms (max %"PRId64" ms)"),
+            MS_FROM_VLC_TICK(p_item->p_stats->i_display_offset_avg),
+            MS_FROM_VLC_TICK(p_item->p_stats->i_display_offset_max) );
     msg_rc("|");
     /* Audio*/
     msg_rc("%s", _("+-[Audio Decoding]"));
@@ -1749,6 +1756,16 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
     msg_rc(_("| buffers lost     :    %5"PRIi64),
             p_item->p_stats->i_lost_abuffers );
     msg_rc("|");
+    /* Clock, only measured in low latency mode */
+    if( b_clock )
+    {
+        msg_rc("%s", _("+-[Clock]"));
+        msg_rc(_("| arrival jitter   :    %5"PRId64" ms"),
+                MS_FROM_VLC_TICK(p_item->p_stats->i_clock_jitter) );
+        msg_rc(_("| buffering        :    %5"PRId64" ms"),
+                MS_FROM_VLC_TICK(p_item->p_stats->i_clock_headroom) );
+        msg_rc("|");
+    }
     msg_rc( "+----[ end of statistical info ]" );
     vlc_mutex_unlock( &p_item->lock );
 
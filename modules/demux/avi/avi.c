@@ -44,6 +44,7 @@
 
 #include "libavi.h"
 #include "../rawdv.h"
+#include "../seekindex.h"
 #include "bitmapinfoheader.h"
 
 /*****************************************************************************
@@ -219,6 +220,8 @@ static int AVI_PacketSearch   ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
 static void AVI_IndexCreate  ( demux_t * );
+static int  AVI_IndexLoadCache( demux_t * );
+static void AVI_IndexStoreCache( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -683,6 +686,7 @@ aviindex:
         AVI_IndexLoad( p_demux );
     }
 
+aviindexed:
     /* *** movie length in vlc_tick_t *** */
     p_sys->i_length = AVI_MovieGetLength( p_demux );
 
@@ -706,6 +710,12 @@ aviindex:
                 b_index = true;
                 goto aviindex;
             }
+            if( AVI_IndexLoadCache( p_demux ) == VLC_SUCCESS )
+            {
+                /* Index fixed during a previous playback */
+                b_index = true;
+                goto aviindexed;
+            }
             if( i_do_index == 0 )
             {
                 const char *psz_msg = _(
@@ -2562,6 +2572,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     vlc_tick_t i_dialog_update;
     vlc_dialog_id *p_dialog_id = NULL;
+    bool b_cancelled = false;
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0, true );
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0, true );
@@ -2572,6 +2583,9 @@ static void AVI_IndexCreate( demux_t *p_demux )
         return;
     }
 
+    if( AVI_IndexLoadCache( p_demux ) == VLC_SUCCESS )
+        return;
+
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
         avi_index_Init( &p_sys->track[i_stream]->idx );
 
@@ -2600,7 +2614,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         if( p_dialog_id != NULL && vlc_tick_now() - i_dialog_update > VLC_TICK_FROM_MS(100) )
         {
             if( vlc_dialog_is_cancelled( p_demux, p_dialog_id ) )
+            {
+                b_cancelled = true;
                 break;
+            }
 
             double f_current = vlc_stream_Tell( p_demux->s );
             double f_size    = stream_Size( p_demux->s );
@@ -2679,6 +2696,135 @@ print_stat:
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
                 i_stream, p_sys->track[i_stream]->idx.i_size );
     }
+
+    if( !b_cancelled )
+        AVI_IndexStoreCache( p_demux );
+}
+
+/*****************************************************************************
+ * Index cache: rebuilt indexes are kept across playbacks
+ *****************************************************************************
+ * Layout (little endian): track count, then for each track its entry count
+ * followed by its entries (fourcc, flags, position, length).
+ *****************************************************************************/
+#define AVI_INDEX_CACHE_VERSION 1
+#define AVI_INDEX_CACHE_ENTRY   20
+
+static void AVI_IndexStoreCache( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    size_t i_size = 4;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        i_size += 4 + (size_t)p_sys->track[i]->idx.i_size * AVI_INDEX_CACHE_ENTRY;
+
+    uint8_t *p_buf = malloc( i_size );
+    if( !p_buf )
+        return;
+
+    uint8_t *p = p_buf;
+    SetDWLE( p, p_sys->i_track ); p += 4;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i]->idx;
+
+        SetDWLE( p, p_index->i_size ); p += 4;
+        for( uint32_t j = 0; j < p_index->i_size; j++ )
+        {
+            const avi_entry_t *p_entry = &p_index->p_entry[j];
+            SetDWLE( &p[0], p_entry->i_id );
+            SetDWLE( &p[4], p_entry->i_flags );
+            SetQWLE( &p[8], p_entry->i_pos );
+            SetDWLE( &p[16], p_entry->i_length );
+            p += AVI_INDEX_CACHE_ENTRY;
+        }
+    }
+
+    demux_SeekIndexStore( p_demux, "avi", AVI_INDEX_CACHE_VERSION,
+                          p_buf, i_size );
+    free( p_buf );
+}
+
+static int AVI_IndexLoadCache( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_size;
+
+    if( p_sys->i_track == 0 )
+        return VLC_EGENERIC;
+
+    avi_index_t *p_index = vlc_alloc( p_sys->i_track, sizeof(*p_index) );
+    if( !p_index )
+        return VLC_ENOMEM;
+
+    uint8_t *p_buf = demux_SeekIndexLoad( p_demux, "avi",
+                                          AVI_INDEX_CACHE_VERSION, &i_size );
+    if( !p_buf )
+    {
+        free( p_index );
+        return VLC_EGENERIC;
+    }
+
+    const uint64_t i_stream_size = stream_Size( p_demux->s );
+    const uint8_t *p = p_buf;
+    uint64_t i_last_pos = p_sys->i_movi_lastchunk_pos;
+    unsigned i_track = 0;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        avi_index_Init( &p_index[i] );
+
+    if( i_size < 4 || GetDWLE( p ) != p_sys->i_track )
+        goto error;
+    p += 4; i_size -= 4;
+
+    for( ; i_track < p_sys->i_track; i_track++ )
+    {
+        if( i_size < 4 )
+            goto error;
+        uint32_t i_count = GetDWLE( p );
+        p += 4; i_size -= 4;
+        if( i_size / AVI_INDEX_CACHE_ENTRY < i_count )
+            goto error;
+
+        for( uint32_t j = 0; j < i_count; j++ )
+        {
+            avi_entry_t index;
+            index.i_id      = GetDWLE( &p[0] );
+            index.i_flags   = GetDWLE( &p[4] );
+            index.i_pos     = GetQWLE( &p[8] );
+            index.i_length  = GetDWLE( &p[16] );
+            index.i_lengthtotal = index.i_length;
+            p += AVI_INDEX_CACHE_ENTRY; i_size -= AVI_INDEX_CACHE_ENTRY;
+
+            if( index.i_pos >= i_stream_size )
+                goto error;
+            avi_index_Append( &p_index[i_track], &i_last_pos, &index );
+            if( p_index[i_track].i_size != j + 1 )
+                goto error; /* allocation failure */
+        }
+    }
+    free( p_buf );
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_track_t *tk = p_sys->track[i];
+        avi_index_Clean( &tk->idx );
+        tk->idx = p_index[i];
+        msg_Dbg( p_demux, "stream[%u] reusing %u cached index entries",
+                 i, tk->idx.i_size );
+    }
+    free( p_index );
+    p_sys->i_movi_lastchunk_pos = i_last_pos;
+    p_sys->b_indexloaded = true;
+    return VLC_SUCCESS;
+
+error:
+    msg_Warn( p_demux, "cached index does not match the file" );
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        avi_index_Clean( &p_index[i] );
+    free( p_index );
+    free( p_buf );
+    return VLC_EGENERIC;
 }
 
 /* */
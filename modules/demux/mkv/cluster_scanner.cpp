@@ -0,0 +1,254 @@
+/*****************************************************************************
+ * cluster_scanner.cpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "cluster_scanner.hpp"
+
+#include <vlc_stream.h>
+
+namespace mkv {
+
+/* EBML IDs, with their length marker */
+#define MKV_ID_CLUSTER    0x1F43B675
+#define MKV_ID_TIMECODE   0xE7
+#define MKV_ID_CRC32      0xBF
+#define MKV_ID_VOID       0xEC
+
+/* Size of the read window, element headers within it cost no I/O */
+#define MKV_SCAN_WINDOW   (64 * 1024)
+
+/* Longest element header: 4 bytes of ID and 8 bytes of size */
+#define MKV_SCAN_HEADER   12
+
+namespace {
+    /* Returns the length of the EBML variable size integer, 0 if invalid.
+     * The length marker is kept for IDs and removed for sizes, for which
+     * the reserved all ones value means an unknown size (UINT64_MAX). */
+    size_t read_vint( const uint8_t *p, size_t avail, size_t max_len,
+                      bool b_id, uint64_t *p_value )
+    {
+        if( avail == 0 || p[0] == 0 )
+            return 0;
+
+        size_t len = 1;
+        while( !( p[0] & ( 0x80 >> ( len - 1 ) ) ) )
+            len++;
+        if( len > max_len || len > avail )
+            return 0;
+
+        uint8_t mask = 0xFF >> len;
+        uint64_t value = b_id ? p[0] : ( p[0] & mask );
+        bool b_all_ones = ( p[0] & mask ) == mask;
+
+        for( size_t i = 1; i < len; i++ )
+        {
+            value = ( value << 8 ) | p[i];
+            b_all_ones = b_all_ones && p[i] == 0xFF;
+        }
+
+        *p_value = ( !b_id && b_all_ones ) ? UINT64_MAX : value;
+        return len;
+    }
+}
+
+ClusterScanner::ClusterScanner( demux_t *p_demux, uint64_t i_timescale,
+                                fptr_t i_start, fptr_t i_end )
+    : p_demux( p_demux )
+    , s( NULL )
+    , i_timescale( i_timescale )
+    , i_start( i_start )
+    , i_end( i_end )
+    , p_buffer( NULL )
+    , i_buffer_pos( 0 )
+    , i_buffer( 0 )
+    , b_running( false )
+    , p_interrupt( NULL )
+{
+    vlc_mutex_init( &lock );
+}
+
+ClusterScanner::~ClusterScanner()
+{
+    Stop();
+    if( p_interrupt != NULL )
+        vlc_interrupt_destroy( p_interrupt );
+    free( p_buffer );
+    vlc_mutex_destroy( &lock );
+}
+
+bool ClusterScanner::Start()
+{
+    p_buffer = static_cast<uint8_t *>( malloc( MKV_SCAN_WINDOW ) );
+    p_interrupt = vlc_interrupt_create();
+    if( unlikely( p_buffer == NULL || p_interrupt == NULL ) )
+        return false;
+
+    b_running = !vlc_clone( &thread, Thread, this, VLC_THREAD_PRIORITY_LOW );
+    return b_running;
+}
+
+void ClusterScanner::Stop()
+{
+    if( !b_running )
+        return;
+
+    vlc_interrupt_kill( p_interrupt );
+    vlc_join( thread, NULL );
+    b_running = false;
+}
+
+void ClusterScanner::Collect( SegmentSeeker & seeker )
+{
+    std::vector<SegmentSeeker::Cluster> found;
+
+    vlc_mutex_lock( &lock );
+    found.swap( pending );
+    vlc_mutex_unlock( &lock );
+
+    for( size_t i = 0; i < found.size(); i++ )
+        seeker.add_cluster( found[i] );
+}
+
+void *ClusterScanner::Thread( void *data )
+{
+    ClusterScanner *p_this = static_cast<ClusterScanner *>( data );
+
+    vlc_interrupt_set( p_this->p_interrupt );
+    p_this->Scan();
+    return NULL;
+}
+
+/* Returns the number of bytes available at pos, up to size */
+size_t ClusterScanner::Fill( fptr_t pos, size_t size )
+{
+    if( pos < i_buffer_pos || pos >= i_buffer_pos + i_buffer ||
+        pos + size > i_buffer_pos + i_buffer )
+    {
+        i_buffer = 0;
+        if( vlc_stream_Seek( s, pos ) )
+            return 0;
+
+        ssize_t i_read = vlc_stream_Read( s, p_buffer, MKV_SCAN_WINDOW );
+        if( i_read <= 0 )
+            return 0;
+
+        i_buffer_pos = pos;
+        i_buffer = i_read;
+    }
+
+    return std::min<size_t>( size, i_buffer_pos + i_buffer - pos );
+}
+
+/* Returns the length of the element header at pos, 0 on error */
+size_t ClusterScanner::ReadHeader( fptr_t pos, uint32_t *p_id, uint64_t *p_size )
+{
+    size_t avail = Fill( pos, MKV_SCAN_HEADER );
+    const uint8_t *p = p_buffer + ( pos - i_buffer_pos );
+    uint64_t i_id;
+
+    size_t i_id_len = read_vint( p, avail, 4, true, &i_id );
+    if( i_id_len == 0 )
+        return 0;
+
+    size_t i_size_len = read_vint( p + i_id_len, avail - i_id_len, 8,
+                                   false, p_size );
+    if( i_size_len == 0 )
+        return 0;
+
+    *p_id = i_id;
+    return i_id_len + i_size_len;
+}
+
+void ClusterScanner::Scan()
+{
+    s = vlc_stream_NewURL( p_demux, p_demux->psz_url );
+    if( s == NULL )
+        return;
+
+    fptr_t pos = i_start;
+    size_t i_count = 0;
+
+    while( pos < i_end && !vlc_killed() )
+    {
+        uint32_t i_id;
+        uint64_t i_size;
+        size_t i_header = ReadHeader( pos, &i_id, &i_size );
+
+        /* payloads of unknown size can only be skipped by parsing them */
+        if( i_header == 0 || i_size == UINT64_MAX )
+            break;
+
+        if( i_id == MKV_ID_CLUSTER )
+        {
+            fptr_t child = pos + i_header;
+            fptr_t child_end = child + i_size;
+
+            while( child < child_end )
+            {
+                uint32_t i_child_id;
+                uint64_t i_child_size;
+                size_t i_child_header = ReadHeader( child, &i_child_id, &i_child_size );
+
+                if( i_child_header == 0 || i_child_size == UINT64_MAX )
+                    break;
+
+                if( i_child_id == MKV_ID_TIMECODE )
+                {
+                    if( i_child_size > 8 ||
+                        Fill( child + i_child_header, i_child_size ) != i_child_size )
+                        break;
+
+                    const uint8_t *p = p_buffer + ( child + i_child_header - i_buffer_pos );
+                    uint64_t i_timecode = 0;
+                    for( size_t i = 0; i < i_child_size; i++ )
+                        i_timecode = ( i_timecode << 8 ) | p[i];
+
+                    SegmentSeeker::Cluster cinfo = {
+                        /* fpos     */ pos,
+                        /* pts      */ vlc_tick_t( VLC_TICK_FROM_NS( i_timecode * i_timescale ) ),
+                        /* duration */ vlc_tick_t( -1 ),
+                        /* size     */ i_header + i_size
+                    };
+
+                    vlc_mutex_lock( &lock );
+                    pending.push_back( cinfo );
+                    vlc_mutex_unlock( &lock );
+                    i_count++;
+                    break;
+                }
+
+                /* the timecode is the first element of a cluster */
+                if( i_child_id != MKV_ID_CRC32 && i_child_id != MKV_ID_VOID )
+                    break;
+
+                child += i_child_header + i_child_size;
+            }
+        }
+
+        pos += i_header + i_size;
+    }
+
+    msg_Dbg( p_demux, "found %zu clusters in the background, stopped at %" PRIu64,
+             i_count, pos );
+
+    vlc_stream_Delete( s );
+    s = NULL;
+}
+
+} // namespace
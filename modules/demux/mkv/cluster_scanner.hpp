@@ -0,0 +1,81 @@
+/*****************************************************************************
+ * cluster_scanner.hpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_MKV_CLUSTER_SCANNER_HPP_
+#define VLC_MKV_CLUSTER_SCANNER_HPP_
+
+#include "mkv.hpp"
+#include "matroska_segment_seeker.hpp"
+
+#include <vlc_interrupt.h>
+
+#include <vector>
+
+namespace mkv {
+
+/* Rebuilds the cluster map of a segment without cues in the background.
+ *
+ * A dedicated thread opens its own stream on the URL of the demuxer and walks
+ * the level 1 elements of the segment, only reading the header and the
+ * timecode of each cluster and skipping over its payload. It is only started
+ * for sources that can seek fast, as skipping a payload is a seek. The clusters found are
+ * handed over to the seeker when the demuxer thread calls Collect(), so that
+ * seeks get closer starting points as the scan progresses. */
+class ClusterScanner
+{
+public:
+    typedef SegmentSeeker::fptr_t fptr_t;
+
+    ClusterScanner( demux_t *, uint64_t i_timescale, fptr_t i_start, fptr_t i_end );
+    ~ClusterScanner();
+
+    bool Start();
+    void Stop();
+    void Collect( SegmentSeeker & );
+
+private:
+    static void *Thread( void * );
+    void Scan();
+
+    size_t Fill( fptr_t pos, size_t size );
+    size_t ReadHeader( fptr_t pos, uint32_t *p_id, uint64_t *p_size );
+
+    demux_t          *p_demux;
+    stream_t         *s;
+    uint64_t         i_timescale;
+    fptr_t           i_start;
+    fptr_t           i_end;
+
+    /* read window, so that small clusters do not cost a seek each */
+    uint8_t          *p_buffer;
+    fptr_t           i_buffer_pos;
+    size_t           i_buffer;
+
+    bool             b_running;
+    vlc_thread_t     thread;
+    vlc_interrupt_t  *p_interrupt;
+
+    vlc_mutex_t      lock;
+    std::vector<SegmentSeeker::Cluster> pending;
+};
+
+} // namespace
+
+#endif
@@ -27,6 +27,7 @@
 #include "util.hpp"
 #include "Ebml_parser.hpp"
 #include "Ebml_dispatcher.hpp"
+#include "../seekindex.h"
 
 #include <new>
 #include <iterator>
@@ -47,6 +48,7 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,i_chapters_position(-1)
     ,i_attachments_position(-1)
     ,cluster(NULL)
+    ,i_first_cluster_position(-1)
     ,i_block_pos(0)
     ,p_segment_uid(NULL)
     ,p_prev_segment_uid(NULL)
@@ -62,11 +64,16 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,ep( EbmlParser(&estream, p_seg, &demuxer.demuxer ))
     ,b_preloaded(false)
     ,b_ref_external_segments(false)
+    ,b_seekindex_cache(false)
+    ,_seekindex_clusters(0)
+    ,p_cluster_scanner(NULL)
 {
 }
 
 matroska_segment_c::~matroska_segment_c()
 {
+    delete p_cluster_scanner;
+
     free( psz_writing_application );
     free( psz_muxing_application );
     free( psz_segment_filename );
@@ -636,6 +643,7 @@ bool matroska_segment_c::Preload( )
 
 
             cluster = kc_ptr;
+            i_first_cluster_position = cluster->GetElementPosition();
 
             // add first cluster as trusted seekpoint for all tracks
             for( tracks_map_t::const_iterator it = tracks.begin();
@@ -691,6 +699,115 @@ bool matroska_segment_c::Preload( )
     return true;
 }
 
+/* Without cues, seek points are found by scanning clusters as seeks happen,
+ * this work is kept in the seek index cache across playbacks */
+#define MKV_SEEKINDEX_VERSION 1
+
+void matroska_segment_c::LoadSeekIndex()
+{
+    if( b_cues || !sys.b_seekable )
+        return;
+
+    b_seekindex_cache = true;
+
+    size_t i_size;
+    uint8_t *p_data = static_cast<uint8_t *>( demux_SeekIndexLoad(
+        &sys.demuxer, "mkv", MKV_SEEKINDEX_VERSION, &i_size ) );
+    if( p_data == NULL )
+        return;
+
+    if( _seeker.deserialize( p_data, i_size ) )
+        msg_Dbg( &sys.demuxer, "reusing %zu cached seek ranges",
+                 _seeker._ranges_searched.size() );
+    else
+        msg_Warn( &sys.demuxer, "cached seek index does not match the file" );
+    free( p_data );
+
+    _seekindex_ranges = _seeker._ranges_searched;
+    _seekindex_clusters = _seeker._clusters.size();
+}
+
+void matroska_segment_c::StoreSeekIndex()
+{
+    if( p_cluster_scanner )
+    {
+        p_cluster_scanner->Stop();
+        p_cluster_scanner->Collect( _seeker );
+    }
+
+    if( !b_seekindex_cache )
+        return;
+
+    struct range_equal {
+        bool operator()( SegmentSeeker::Range const& a, SegmentSeeker::Range const& b ) const
+        {
+            return a.start == b.start && a.end == b.end;
+        }
+    };
+
+    SegmentSeeker::ranges_t const& ranges = _seeker._ranges_searched;
+    if( _seeker._clusters.size() == _seekindex_clusters &&
+        ranges.size() == _seekindex_ranges.size() &&
+        std::equal( ranges.begin(), ranges.end(), _seekindex_ranges.begin(), range_equal() ) )
+        return; /* nothing new was indexed */
+
+    std::vector<uint8_t> data;
+    _seeker.serialize( data );
+    demux_SeekIndexStore( &sys.demuxer, "mkv", MKV_SEEKINDEX_VERSION,
+                          data.data(), data.size() );
+}
+
+/* Without cues, seeking far ahead means parsing every cluster on the way:
+ * find the clusters in the background so that seeks can jump close to
+ * their target instead */
+void matroska_segment_c::StartClusterScan()
+{
+    bool b_fast_seek;
+
+    if( b_cues || !sys.b_seekable || i_first_cluster_position < 0 ||
+        p_cluster_scanner != NULL )
+        return;
+
+    /* The scanner opens a second stream from the URL and seeks over every
+     * cluster larger than its read window: skip the sources that cannot be
+     * opened twice or where each seek costs a new request */
+    if( sys.demuxer.psz_url == NULL || sys.demuxer.psz_url[0] == '\0' ||
+        vlc_stream_Control( sys.demuxer.s, STREAM_CAN_FASTSEEK, &b_fast_seek ) ||
+        !b_fast_seek )
+        return;
+
+    /* skip the clusters already known, from the cache or the preloading */
+    std::map<SegmentSeeker::fptr_t, SegmentSeeker::fptr_t> known;
+    for( SegmentSeeker::cluster_map_t::const_iterator it = _seeker._clusters.begin();
+         it != _seeker._clusters.end(); ++it )
+    {
+        if( it->second.size != UINT64_MAX )
+            known[ it->second.fpos ] = it->second.size;
+    }
+
+    SegmentSeeker::fptr_t i_start = i_first_cluster_position;
+    std::map<SegmentSeeker::fptr_t, SegmentSeeker::fptr_t>::const_iterator it;
+    while( ( it = known.find( i_start ) ) != known.end() )
+        i_start += it->second;
+
+    uint64_t i_end;
+    if( segment->IsFiniteSize() )
+        i_end = segment->GetEndPosition();
+    else if( vlc_stream_GetSize( sys.demuxer.s, &i_end ) )
+        return;
+
+    if( i_start >= i_end )
+        return;
+
+    p_cluster_scanner = new (std::nothrow) ClusterScanner( &sys.demuxer, i_timescale,
+                                                           i_start, i_end );
+    if( p_cluster_scanner && !p_cluster_scanner->Start() )
+    {
+        delete p_cluster_scanner;
+        p_cluster_scanner = NULL;
+    }
+}
+
 /* Here we try to load elements that were found in Seek Heads, but not yet parsed */
 bool matroska_segment_c::LoadSeekHeadItem( const EbmlCallbacks & ClassInfos, int64_t i_element_position )
 {
@@ -836,6 +953,9 @@ bool matroska_segment_c::Seek( demux_t &demuxer, vlc_tick_t i_absolute_mk_date,
 
     // find appropriate seekpoints //
 
+    if( p_cluster_scanner )
+        p_cluster_scanner->Collect( _seeker );
+
     try {
         seekpoints = _seeker.get_seekpoints( *this, i_mk_date, priority, selected_tracks );
     }
@@ -27,6 +27,7 @@
 #include "demux.hpp"
 #include "mkv.hpp"
 #include "matroska_segment_seeker.hpp"
+#include "cluster_scanner.hpp"
 #include <vector>
 #include <string>
 
@@ -109,6 +110,7 @@ public:
     int64_t                 i_attachments_position;
 
     KaxCluster              *cluster;
+    int64_t                 i_first_cluster_position;
     uint64                  i_block_pos;
     KaxSegmentUID           *p_segment_uid;
     KaxPrevUID              *p_prev_segment_uid;
@@ -137,12 +139,17 @@ public:
     EbmlParser                     ep;
     bool                           b_preloaded;
     bool                           b_ref_external_segments;
+    bool                           b_seekindex_cache;
 
     bool Preload();
     bool PreloadFamily( const matroska_segment_c & segment );
     bool PreloadClusters( uint64 i_cluster_position );
     void InformationCreate();
 
+    void LoadSeekIndex();
+    void StoreSeekIndex();
+    void StartClusterScan();
+
     bool Seek( demux_t &, vlc_tick_t i_mk_date, vlc_tick_t i_mk_time_offset, bool b_accurate );
 
     int BlockGet( KaxBlock * &, KaxSimpleBlock * &, bool *, bool *, int64_t *);
@@ -174,6 +181,9 @@ private:
     void EnsureDuration();
 
     SegmentSeeker _seeker;
+    SegmentSeeker::ranges_t _seekindex_ranges; /* searched when loaded */
+    size_t                  _seekindex_clusters; /* known when loaded */
+    ClusterScanner          *p_cluster_scanner;
 
     friend SegmentSeeker;
 };
@@ -50,18 +50,6 @@ namespace {
 
 namespace mkv {
 
-SegmentSeeker::cluster_positions_t::iterator
-SegmentSeeker::add_cluster_position( fptr_t fpos )
-{
-    cluster_positions_t::iterator insertion_point = std::upper_bound(
-      _cluster_positions.begin(),
-      _cluster_positions.end(),
-      fpos
-    );
-
-    return _cluster_positions.insert( insertion_point, fpos );
-}
-
 SegmentSeeker::cluster_map_t::iterator
 SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
 {
@@ -74,61 +62,7 @@ SegmentSeeker::add_cluster( KaxCluster * const p_cluster )
             : UINT64_MAX
     };
 
-    add_cluster_position( cinfo.fpos );
-
-    cluster_map_t::iterator it = _clusters.lower_bound( cinfo.pts );
-
-    if( it != _clusters.end() && it->second.pts == cinfo.pts )
-    {
-        // cluster already known
-    }
-    else
-    {
-        it = _clusters.insert( cluster_map_t::value_type( cinfo.pts, cinfo ) ).first;
-    }
-
-    // ------------------------------------------------------------------
-    // IF we have two adjecent clusters, update duration where applicable
-    // ------------------------------------------------------------------
-
-    struct Duration {
-        static void fix( Cluster& prev, Cluster& next )
-        {
-            if( ( prev.fpos + prev.size) == next.fpos )
-                prev.duration = next.pts - prev.pts; 
-        }
-    };
-
-    if( it != _clusters.begin() )
-    {
-        Duration::fix( prev_( it )->second, it->second );
-    }
-
-    if( it != _clusters.end() && next_( it ) != _clusters.end() )
-    {
-        Duration::fix( it->second, next_( it )->second );
-    }
-
-    return it;
-}
-
-void
-SegmentSeeker::add_seekpoint( track_id_t track_id, Seekpoint sp )
-{
-    seekpoints_t&  seekpoints = _tracks_seekpoints[ track_id ];
-    seekpoints_t::iterator it = std::lower_bound( seekpoints.begin(), seekpoints.end(), sp );
-
-    if( it != seekpoints.end() && it->pts == sp.pts )
-    {
-        if (sp.trust_level <= it->trust_level)
-            return;
-
-        *it = sp;
-    }
-    else
-    {
-        seekpoints.insert( it, sp );
-    }
+    return add_cluster( cinfo );
 }
 
 SegmentSeeker::tracks_seekpoint_t
@@ -385,42 +319,6 @@ SegmentSeeker::index_unsearched_range( matroska_segment_c& ms, Range search_area
     mark_range_as_searched( search_area );
 }
 
-void
-SegmentSeeker::mark_range_as_searched( Range data )
-{
-    /* TODO: this is utterly ugly, we should do the insertion in-place */
-
-    _ranges_searched.insert( std::upper_bound( _ranges_searched.begin(), _ranges_searched.end(), data ), data );
-
-    {
-        ranges_t merged;
-
-        for( ranges_t::iterator it = _ranges_searched.begin(); it != _ranges_searched.end(); ++it )
-        {
-            if( merged.size() )
-            {
-                Range& last_entry = *merged.rbegin();
-
-                if( last_entry.end+1 >= it->start && last_entry.end < it->end )
-                {
-                    last_entry.end = it->end;
-                    continue;
-                }
-
-                if( it->start >= last_entry.start && it->end <= last_entry.end )
-                {
-                    last_entry.end = std::max( last_entry.end, it->end );
-                    continue;
-                }
-            }
-
-            merged.push_back( *it );
-        }
-
-        _ranges_searched = merged;
-    }
-}
-
 
 SegmentSeeker::ranges_t
 SegmentSeeker::get_search_areas( fptr_t start, fptr_t end ) const
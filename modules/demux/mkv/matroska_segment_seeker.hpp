@@ -110,6 +110,7 @@ class SegmentSeeker
 
         cluster_positions_t::iterator add_cluster_position( fptr_t pos );
         cluster_map_t      ::iterator add_cluster( KaxCluster * const );
+        cluster_map_t      ::iterator add_cluster( Cluster const& );
 
         void mkv_jump_to( matroska_segment_c&, fptr_t );
 
@@ -119,6 +120,9 @@ class SegmentSeeker
         void mark_range_as_searched( Range );
         ranges_t get_search_areas( fptr_t start, fptr_t end ) const;
 
+        void serialize( std::vector<uint8_t>& ) const;
+        bool deserialize( const uint8_t *, size_t );
+
     public:
         ranges_t            _ranges_searched;
         tracks_seekpoints_t _tracks_seekpoints;
@@ -0,0 +1,292 @@
+/*****************************************************************************
+ * matroska_segment_seeker_index.cpp : matroska demuxer
+ *****************************************************************************
+ * Copyright (C) 2016-2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Bookkeeping of the SegmentSeeker index and its serialization for the seek
+ * index cache: none of it depends on the demuxer nor on libmatroska, so that
+ * it can be tested on its own. */
+
+#include "matroska_segment_seeker.hpp"
+
+#include <algorithm>
+
+namespace {
+    template<class It> It prev_( It it ) { return --it; }
+    template<class It> It next_( It it ) { return ++it; }
+}
+
+namespace mkv {
+
+SegmentSeeker::cluster_positions_t::iterator
+SegmentSeeker::add_cluster_position( fptr_t fpos )
+{
+    cluster_positions_t::iterator insertion_point = std::upper_bound(
+      _cluster_positions.begin(),
+      _cluster_positions.end(),
+      fpos
+    );
+
+    if( insertion_point != _cluster_positions.begin() && *prev_( insertion_point ) == fpos )
+        return prev_( insertion_point ); // already known
+
+    return _cluster_positions.insert( insertion_point, fpos );
+}
+
+SegmentSeeker::cluster_map_t::iterator
+SegmentSeeker::add_cluster( Cluster const& cinfo )
+{
+    add_cluster_position( cinfo.fpos );
+
+    cluster_map_t::iterator it = _clusters.lower_bound( cinfo.pts );
+
+    if( it != _clusters.end() && it->second.pts == cinfo.pts )
+    {
+        // cluster already known
+    }
+    else
+    {
+        it = _clusters.insert( cluster_map_t::value_type( cinfo.pts, cinfo ) ).first;
+    }
+
+    // ------------------------------------------------------------------
+    // IF we have two adjecent clusters, update duration where applicable
+    // ------------------------------------------------------------------
+
+    struct Duration {
+        static void fix( Cluster& prev, Cluster& next )
+        {
+            if( ( prev.fpos + prev.size) == next.fpos )
+                prev.duration = next.pts - prev.pts; 
+        }
+    };
+
+    if( it != _clusters.begin() )
+    {
+        Duration::fix( prev_( it )->second, it->second );
+    }
+
+    if( it != _clusters.end() && next_( it ) != _clusters.end() )
+    {
+        Duration::fix( it->second, next_( it )->second );
+    }
+
+    return it;
+}
+
+void
+SegmentSeeker::add_seekpoint( track_id_t track_id, Seekpoint sp )
+{
+    seekpoints_t&  seekpoints = _tracks_seekpoints[ track_id ];
+    seekpoints_t::iterator it = std::lower_bound( seekpoints.begin(), seekpoints.end(), sp );
+
+    if( it != seekpoints.end() && it->pts == sp.pts )
+    {
+        if (sp.trust_level <= it->trust_level)
+            return;
+
+        *it = sp;
+    }
+    else
+    {
+        seekpoints.insert( it, sp );
+    }
+}
+
+void
+SegmentSeeker::mark_range_as_searched( Range data )
+{
+    /* TODO: this is utterly ugly, we should do the insertion in-place */
+
+    _ranges_searched.insert( std::upper_bound( _ranges_searched.begin(), _ranges_searched.end(), data ), data );
+
+    {
+        ranges_t merged;
+
+        for( ranges_t::iterator it = _ranges_searched.begin(); it != _ranges_searched.end(); ++it )
+        {
+            if( merged.size() )
+            {
+                Range& last_entry = *merged.rbegin();
+
+                if( last_entry.end+1 >= it->start && last_entry.end < it->end )
+                {
+                    last_entry.end = it->end;
+                    continue;
+                }
+
+                if( it->start >= last_entry.start && it->end <= last_entry.end )
+                {
+                    last_entry.end = std::max( last_entry.end, it->end );
+                    continue;
+                }
+            }
+
+            merged.push_back( *it );
+        }
+
+        _ranges_searched = merged;
+    }
+}
+
+namespace {
+    void put_u32( std::vector<uint8_t>& out, uint32_t value )
+    {
+        uint8_t buf[4];
+        SetDWLE( buf, value );
+        out.insert( out.end(), buf, buf + sizeof( buf ) );
+    }
+
+    void put_u64( std::vector<uint8_t>& out, uint64_t value )
+    {
+        uint8_t buf[8];
+        SetQWLE( buf, value );
+        out.insert( out.end(), buf, buf + sizeof( buf ) );
+    }
+
+    struct reader_t
+    {
+        const uint8_t *p;
+        size_t         left;
+        bool           error;
+
+        uint32_t u32()
+        {
+            if( error || left < 4 ) { error = true; return 0; }
+            uint32_t value = GetDWLE( p );
+            p += 4; left -= 4;
+            return value;
+        }
+
+        uint64_t u64()
+        {
+            if( error || left < 8 ) { error = true; return 0; }
+            uint64_t value = GetQWLE( p );
+            p += 8; left -= 8;
+            return value;
+        }
+    };
+}
+
+/* Layout (little endian), each list prefixed by its element count:
+ * searched ranges (start, end), cluster positions, clusters (position, pts,
+ * duration, size), then for each track its id and its seekpoints (position,
+ * pts, trust level). */
+void
+SegmentSeeker::serialize( std::vector<uint8_t>& out ) const
+{
+    put_u32( out, _ranges_searched.size() );
+    for( ranges_t::const_iterator it = _ranges_searched.begin(); it != _ranges_searched.end(); ++it )
+    {
+        put_u64( out, it->start );
+        put_u64( out, it->end );
+    }
+
+    put_u32( out, _cluster_positions.size() );
+    for( cluster_positions_t::const_iterator it = _cluster_positions.begin(); it != _cluster_positions.end(); ++it )
+        put_u64( out, *it );
+
+    put_u32( out, _clusters.size() );
+    for( cluster_map_t::const_iterator it = _clusters.begin(); it != _clusters.end(); ++it )
+    {
+        put_u64( out, it->second.fpos );
+        put_u64( out, it->second.pts );
+        put_u64( out, it->second.duration );
+        put_u64( out, it->second.size );
+    }
+
+    put_u32( out, _tracks_seekpoints.size() );
+    for( tracks_seekpoints_t::const_iterator it = _tracks_seekpoints.begin(); it != _tracks_seekpoints.end(); ++it )
+    {
+        put_u32( out, it->first );
+        put_u32( out, it->second.size() );
+        for( seekpoints_t::const_iterator sp = it->second.begin(); sp != it->second.end(); ++sp )
+        {
+            put_u64( out, sp->fpos );
+            put_u64( out, sp->pts );
+            put_u32( out, sp->trust_level );
+        }
+    }
+}
+
+bool
+SegmentSeeker::deserialize( const uint8_t *p, size_t size )
+{
+    reader_t in = { p, size, false };
+    SegmentSeeker cached;
+
+    for( uint32_t i = in.u32(); i > 0 && !in.error; --i )
+    {
+        fptr_t start = in.u64();
+        fptr_t end   = in.u64();
+        cached._ranges_searched.push_back( Range( start, end ) );
+    }
+
+    for( uint32_t i = in.u32(); i > 0 && !in.error; --i )
+        cached._cluster_positions.push_back( in.u64() );
+
+    for( uint32_t i = in.u32(); i > 0 && !in.error; --i )
+    {
+        Cluster cinfo;
+        cinfo.fpos     = in.u64();
+        cinfo.pts      = in.u64();
+        cinfo.duration = in.u64();
+        cinfo.size     = in.u64();
+        cached._clusters.insert( cluster_map_t::value_type( cinfo.pts, cinfo ) );
+    }
+
+    for( uint32_t i = in.u32(); i > 0 && !in.error; --i )
+    {
+        seekpoints_t& seekpoints = cached._tracks_seekpoints[ in.u32() ];
+        for( uint32_t j = in.u32(); j > 0 && !in.error; --j )
+        {
+            fptr_t     fpos  = in.u64();
+            vlc_tick_t pts   = in.u64();
+            int32_t    trust = in.u32();
+            if( trust != Seekpoint::TRUSTED && trust != Seekpoint::QUESTIONABLE &&
+                trust != Seekpoint::DISABLED )
+                in.error = true;
+            seekpoints.push_back( Seekpoint( fpos, pts, Seekpoint::TrustLevel( trust ) ) );
+        }
+    }
+
+    if( in.error || in.left )
+        return false;
+
+    /* merge with what was already gathered while opening */
+    for( ranges_t::const_iterator it = cached._ranges_searched.begin(); it != cached._ranges_searched.end(); ++it )
+        mark_range_as_searched( *it );
+
+    for( cluster_positions_t::const_iterator it = cached._cluster_positions.begin(); it != cached._cluster_positions.end(); ++it )
+    {
+        if( !std::binary_search( _cluster_positions.begin(), _cluster_positions.end(), *it ) )
+            add_cluster_position( *it );
+    }
+
+    _clusters.insert( cached._clusters.begin(), cached._clusters.end() );
+
+    for( tracks_seekpoints_t::const_iterator it = cached._tracks_seekpoints.begin(); it != cached._tracks_seekpoints.end(); ++it )
+    {
+        for( seekpoints_t::const_iterator sp = it->second.begin(); sp != it->second.end(); ++sp )
+            add_seekpoint( it->first, *sp );
+    }
+
+    return true;
+}
+
+} // namespace mkv
@@ -256,6 +256,9 @@ static int Open( vlc_object_t * p_this )
 
     p_sys->FreeUnused();
 
+    p_segment->LoadSeekIndex();
+    p_segment->StartClusterScan();
+
     return VLC_SUCCESS;
 
 error:
@@ -278,6 +281,9 @@ static void Close( vlc_object_t *p_this )
             p_segment->ESDestroy();
     }
 
+    for( size_t i = 0; i < p_sys->opened_segments.size(); i++ )
+        p_sys->opened_segments[i]->StoreSeekIndex();
+
     delete p_sys;
 }
 
@@ -253,6 +253,9 @@ Control(demux_t *demux, int query, va_list args)
             if (!sys->can_seek)
                 return VLC_EGENERIC;
             sys->pts = va_arg(args, vlc_tick_t);
+            if (va_arg(args, int)) /* precise */
+                es_out_Control(demux->out, ES_OUT_SET_NEXT_DISPLAY_TIME,
+                               sys->pts);
             return VLC_SUCCESS;
         case DEMUX_GET_TITLE_INFO:
             if (sys->title_count > 0)
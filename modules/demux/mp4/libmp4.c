@@ -303,13 +303,21 @@ MP4_Box_t * MP4_BoxExtract( MP4_Box_t **pp_chain, uint32_t i_type )
  *****************************************************************************/
 static int MP4_PeekBoxHeader( stream_t *p_stream, MP4_Box_t *p_box )
 {
-    int      i_read;
+    ssize_t  i_read;
     const uint8_t  *p_peek;
+    const block_t  *p_chain;
+    uint8_t  p_buffer[32];
 
-    if( ( ( i_read = vlc_stream_Peek( p_stream, &p_peek, 32 ) ) < 8 ) )
+    /* The header is taken from the buffered blocks without flattening them,
+     * only copied if it straddles two of them */
+    if( ( ( i_read = vlc_stream_PeekChain( p_stream, &p_chain, 32 ) ) < 8 ) )
     {
         return 0;
     }
+    i_read = __MIN( i_read, 32 );
+    p_peek = vlc_stream_ChainAt( p_chain, 0, i_read, p_buffer );
+    if( p_peek == NULL )
+        return 0;
     p_box->i_pos = vlc_stream_Tell( p_stream );
 
     p_box->data.p_payload = NULL;
@@ -368,6 +376,41 @@ static int MP4_PeekBoxHeader( stream_t *p_stream, MP4_Box_t *p_box )
  * if p_box == NULL, box is invalid or failed, position undefined
  * on success, position is past read box or EOF
  *****************************************************************************/
+/* Sample tables only needed when seeking. When they are big and the stream
+ * can seek back, they are skipped while reading the moov and parsed on
+ * first use with MP4_BoxLoad(). */
+static const uint32_t rgi_deferred_types[] = {
+    ATOM_stss, ATOM_stsh, ATOM_stdp, ATOM_sdtp, ATOM_sbgp, ATOM_sgpd, 0 };
+
+#define MP4_BOX_DEFERRED_MIN_SIZE (1 << 12)
+
+static bool MP4_BoxCanDefer( stream_t *p_stream, const MP4_Box_t *p_box,
+                             const MP4_Box_t *p_father )
+{
+    if( !p_father || p_father->i_type != ATOM_stbl ||
+        p_box->i_size < MP4_BOX_DEFERRED_MIN_SIZE )
+        return false;
+
+    size_t i = 0;
+    while( rgi_deferred_types[i] && rgi_deferred_types[i] != p_box->i_type )
+        i++;
+    if( !rgi_deferred_types[i] )
+        return false;
+
+    /* Only boxes of the file hierarchy can be read back later,
+     * not the ones from a decompressed moov */
+    while( p_father->p_father )
+        p_father = p_father->p_father;
+    if( p_father->i_type != ATOM_root )
+        return false;
+
+    /* Going back for a sample table costs a round trip on network streams,
+     * which are better read at once */
+    bool b_canfastseek;
+    return vlc_stream_Control( p_stream, STREAM_CAN_FASTSEEK,
+                               &b_canfastseek ) == VLC_SUCCESS && b_canfastseek;
+}
+
 static MP4_Box_t *MP4_ReadBoxRestricted( stream_t *p_stream, MP4_Box_t *p_father,
                                          const uint32_t onlytypes[], const uint32_t nottypes[],
                                          bool *pb_restrictionhit )
@@ -423,7 +466,11 @@ static MP4_Box_t *MP4_ReadBoxRestricted( stream_t *p_stream, MP4_Box_t *p_father
 
     const uint64_t i_next = p_box->i_pos + p_box->i_size;
     p_box->p_father = p_father;
-    if( MP4_Box_Read_Specific( p_stream, p_box, p_father ) != VLC_SUCCESS )
+    if( MP4_BoxCanDefer( p_stream, p_box, p_father ) )
+    {
+        p_box->e_flags |= BOX_FLAG_DEFERRED; /* payload skipped below */
+    }
+    else if( MP4_Box_Read_Specific( p_stream, p_box, p_father ) != VLC_SUCCESS )
     {
         msg_Warn( p_stream, "Failed reading box %4.4s", (char*) &peekbox.i_type );
         MP4_BoxFree( p_box );
@@ -5297,6 +5344,36 @@ void MP4_BoxFree( MP4_Box_t *p_box )
     free( p_box );
 }
 
+int MP4_BoxLoad( stream_t *p_stream, MP4_Box_t *p_box )
+{
+    if( !(p_box->e_flags & BOX_FLAG_DEFERRED) )
+        return p_box->data.p_payload ? VLC_SUCCESS : VLC_EGENERIC;
+
+    /* Try only once */
+    p_box->e_flags &= ~BOX_FLAG_DEFERRED;
+
+    const uint64_t i_pos = vlc_stream_Tell( p_stream );
+    int i_ret = MP4_Seek( p_stream, p_box->i_pos );
+    if( i_ret == VLC_SUCCESS )
+        i_ret = MP4_Box_Read_Specific( p_stream, p_box, p_box->p_father );
+
+    if( i_ret != VLC_SUCCESS )
+    {
+        msg_Warn( p_stream, "Failed reading deferred box %4.4s",
+                  (char*) &p_box->i_type );
+        if( p_box->pf_free )
+            p_box->pf_free( p_box );
+        p_box->pf_free = NULL;
+        free( p_box->data.p_payload );
+        p_box->data.p_payload = NULL;
+    }
+
+    if( MP4_Seek( p_stream, i_pos ) != VLC_SUCCESS )
+        msg_Warn( p_stream, "cannot restore position %"PRIu64, i_pos );
+
+    return i_ret;
+}
+
 MP4_Box_t *MP4_BoxGetNextChunk( stream_t *s )
 {
     /* p_chunk is a virtual root container for the moof and mdat boxes */
@@ -5449,7 +5526,8 @@ static void MP4_BoxDumpStructure_Internal( stream_t *s, const MP4_Box_t *p_box,
         snprintf( &str[i_level * 4], sizeof(str) - 4*i_level,
                   "+ %4.4s size %"PRIu64" offset %"PRIu64"%s",
                   (char *)&i_displayedtype, p_box->i_size, p_box->i_pos,
-                  p_box->e_flags & BOX_FLAG_INCOMPLETE ? " (\?\?\?\?)" : "" );
+                  p_box->e_flags & BOX_FLAG_INCOMPLETE ? " (\?\?\?\?)" :
+                  p_box->e_flags & BOX_FLAG_DEFERRED ? " (deferred)" : "" );
         msg_Dbg( s, "%s", str );
     }
     p_child = p_box->p_first;
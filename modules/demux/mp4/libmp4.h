@@ -1838,6 +1838,7 @@ struct MP4_Box_s
     {
         BOX_FLAG_NONE = 0,
         BOX_FLAG_INCOMPLETE,
+        BOX_FLAG_DEFERRED, /* payload not parsed yet, see MP4_BoxLoad */
     }            e_flags;
 
     UUID_t       i_uuid;  /* Set if i_type == "uuid" */
@@ -1905,6 +1906,16 @@ MP4_Box_t *MP4_BoxGetNextChunk( stream_t * );
  *****************************************************************************/
 MP4_Box_t *MP4_BoxGetRoot( stream_t * );
 
+/*****************************************************************************
+ * MP4_BoxLoad : Parse the payload of a box left deferred by MP4_BoxGetRoot
+ *****************************************************************************
+ *  Large sample tables only used for seeking are skipped while reading the
+ *  moov of a seekable stream. Call this before accessing their data.
+ *  The stream position is preserved.
+ *  returns VLC_SUCCESS if the box data is available
+ *****************************************************************************/
+int MP4_BoxLoad( stream_t *, MP4_Box_t * );
+
 /*****************************************************************************
  * MP4_BoxNew : Allocates a new MP4 Box with its atom type
  *****************************************************************************
@@ -331,23 +331,26 @@ static inline vlc_tick_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track
 {
     demux_sys_t *p_sys = p_demux->p_sys;
     const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
+    const MP4_Box_data_stts_t *stts = p_track->p_stts;
 
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - p_chunk->i_sample_first;
+    uint32_t i_index = p_chunk->i_stts_index;
+    uint32_t i_skip = p_chunk->i_stts_skip;
+    uint32_t i_sample = p_track->i_sample - p_chunk->i_sample_first;
     int64_t sdts = p_chunk->i_first_dts;
 
-    while( i_sample > 0 && i_index < p_chunk->i_entries_dts )
+    while( i_sample > 0 && i_index < stts->i_entry_count )
     {
-        if( i_sample > p_chunk->p_sample_count_dts[i_index] )
+        const uint32_t i_run = stts->pi_sample_count[i_index] - i_skip;
+        if( i_sample > i_run )
         {
-            sdts += p_chunk->p_sample_count_dts[i_index] *
-                p_chunk->p_sample_delta_dts[i_index];
-            i_sample -= p_chunk->p_sample_count_dts[i_index];
+            sdts += (int64_t) i_run * stts->pi_sample_delta[i_index];
+            i_sample -= i_run;
             i_index++;
+            i_skip = 0;
         }
         else
         {
-            sdts += i_sample * p_chunk->p_sample_delta_dts[i_index];
+            sdts += (int64_t) i_sample * stts->pi_sample_delta[i_index];
             break;
         }
     }
@@ -380,24 +383,26 @@ static inline bool MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track,
                                          vlc_tick_t *pi_delta )
 {
     VLC_UNUSED( p_demux );
-    mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+    const mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+    const MP4_Box_data_ctts_t *ctts = p_track->p_ctts;
 
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
-
-    if( ck->p_sample_count_pts == NULL || ck->p_sample_offset_pts == NULL )
+    if( ctts == NULL )
         return false;
 
-    for( i_index = 0; i_index < ck->i_entries_pts ; i_index++ )
+    /* Count from the start of the run of the first sample of the chunk */
+    uint32_t i_sample = p_track->i_sample - ck->i_sample_first + ck->i_ctts_skip;
+
+    for( uint32_t i_index = ck->i_ctts_index; i_index < ctts->i_entry_count; i_index++ )
     {
-        if( i_sample < ck->p_sample_count_pts[i_index] )
+        if( i_sample < ctts->pi_sample_count[i_index] )
         {
-            *pi_delta = MP4_rescale_mtime( ck->p_sample_offset_pts[i_index],
+            *pi_delta = MP4_rescale_mtime( ctts->pi_sample_offset[i_index] +
+                                           p_track->i_cts_shift,
                                            p_track->i_timescale );
             return true;
         }
 
-        i_sample -= ck->p_sample_count_pts[i_index];
+        i_sample -= ctts->pi_sample_count[i_index];
     }
     return false;
 }
@@ -408,42 +413,31 @@ static inline vlc_tick_t MP4_GetSamplesDuration( demux_t *p_demux, mp4_track_t *
     VLC_UNUSED( p_demux );
 
     const mp4_chunk_t *p_chunk = &p_track->chunk[p_track->i_chunk];
+    const MP4_Box_data_stts_t *stts = p_track->p_stts;
     stime_t i_duration = 0;
 
+    /* Samples of the chunk only */
+    uint32_t i_sample = p_track->i_sample - p_chunk->i_sample_first;
+    if( i_sample >= p_chunk->i_sample_count )
+        return 0;
+    i_nb_samples = __MIN( i_nb_samples, p_chunk->i_sample_count - i_sample );
+
     /* Forward to right index, and set remaining count in that index */
-    unsigned i_index = 0;
-    unsigned i_remain = 0;
-    for( unsigned i = p_chunk->i_sample_first;
-         i<p_track->i_sample && i_index < p_chunk->i_entries_dts; )
-    {
-        if( p_track->i_sample - i >= p_chunk->p_sample_count_dts[i_index] )
-        {
-            i += p_chunk->p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
-        {
-            i_remain = p_track->i_sample - i;
-            break;
-        }
-    }
+    uint32_t i_index = p_chunk->i_stts_index;
+    uint32_t i_remain = i_sample + p_chunk->i_stts_skip;
+    while( i_index < stts->i_entry_count &&
+           i_remain >= stts->pi_sample_count[i_index] )
+        i_remain -= stts->pi_sample_count[i_index++];
 
     /* Compute total duration from all samples from index */
-    while( i_nb_samples > 0 && i_index < p_chunk->i_entries_dts )
+    while( i_nb_samples > 0 && i_index < stts->i_entry_count )
     {
-        if( i_nb_samples >= p_chunk->p_sample_count_dts[i_index] - i_remain )
-        {
-            i_duration += (p_chunk->p_sample_count_dts[i_index] - i_remain) *
-                          (int64_t) p_chunk->p_sample_delta_dts[i_index];
-            i_nb_samples -= (p_chunk->p_sample_count_dts[i_index] - i_remain);
-            i_index++;
-            i_remain = 0;
-        }
-        else
-        {
-            i_duration += i_nb_samples * p_chunk->p_sample_delta_dts[i_index];
-            break;
-        }
+        const uint32_t i_run = __MIN( stts->pi_sample_count[i_index] - i_remain,
+                                      i_nb_samples );
+        i_duration += (int64_t) i_run * stts->pi_sample_delta[i_index];
+        i_nb_samples -= i_run;
+        i_index++;
+        i_remain = 0;
     }
 
     return MP4_rescale_mtime( i_duration, p_track->i_timescale );
@@ -2446,12 +2440,10 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
         ck->i_offset = BOXDATA(p_co64)->i_chunk_offset[i_chunk];
 
         ck->i_first_dts = 0;
-        ck->i_entries_dts = 0;
-        ck->p_sample_count_dts = NULL;
-        ck->p_sample_delta_dts = NULL;
-        ck->i_entries_pts = 0;
-        ck->p_sample_count_pts = NULL;
-        ck->p_sample_offset_pts = NULL;
+        ck->i_stts_index = 0;
+        ck->i_stts_skip = 0;
+        ck->i_ctts_index = 0;
+        ck->i_ctts_skip = 0;
     }
 
     /* now we read index for SampleEntry( soun vide mp4a mp4v ...)
@@ -2513,54 +2505,6 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
-static int xTTS_CountEntries( demux_t *p_demux, uint32_t *pi_entry /* out */,
-                              const uint32_t i_index,
-                              uint32_t i_index_samples_left,
-                              uint32_t i_sample_count,
-                              const uint32_t *pi_index_sample_count,
-                              const uint32_t i_table_count )
-{
-    uint32_t i_array_offset;
-    while( i_sample_count > 0 )
-    {
-        if ( likely((UINT32_MAX - i_index) >= *pi_entry) )
-            i_array_offset = i_index + *pi_entry;
-        else
-            return VLC_EGENERIC;
-
-        if ( i_array_offset >= i_table_count )
-        {
-            msg_Err( p_demux, "invalid index counting total samples %u %u", i_array_offset,  i_table_count );
-            return VLC_ENOVAR;
-        }
-
-        if ( i_index_samples_left )
-        {
-            if ( i_index_samples_left > i_sample_count )
-            {
-                i_index_samples_left -= i_sample_count;
-                i_sample_count = 0;
-                *pi_entry +=1; /* No samples left, go copy */
-                break;
-            }
-            else
-            {
-                i_sample_count -= i_index_samples_left;
-                i_index_samples_left = 0;
-                *pi_entry += 1;
-                continue;
-            }
-        }
-        else
-        {
-            i_sample_count -= __MIN( i_sample_count, pi_index_sample_count[i_array_offset] );
-            *pi_entry += 1;
-        }
-    }
-
-    return VLC_SUCCESS;
-}
-
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
@@ -2598,18 +2542,10 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     }
     else
     {
-        /* 2: each sample can have a different size */
+        /* 2: each sample can have a different size, use the stsz table
+         * which lives as long as the moov box */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( uint32_t i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
     }
 
     if ( p_demux_track->i_chunk_count && p_demux_track->i_sample_size == 0 )
@@ -2624,120 +2560,62 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
     /* Use stts table to create a sample number -> dts table.
      * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
-
-     /* FIXME: refactor STTS & CTTS, STTS having now only few extra lines and
-      *        differing in 2/2 fields and 1 signedness */
+     *  the box! so each chunk only points to its first run in the table,
+     *  the runs being walked when computing timestamps */
 
     int64_t i_next_dts = 0;
     /* Find stts
      *  Gives mapping between sample and decoding time
      */
     p_box = MP4_BoxGet( p_demux_track->p_stbl, "stts" );
-    if( !p_box )
+    if( !p_box || !p_box->data.p_stts )
     {
         msg_Warn( p_demux, "cannot find STTS box" );
         return VLC_EGENERIC;
     }
     else
     {
-        MP4_Box_data_stts_t *stts = p_box->data.p_stts;
+        const MP4_Box_data_stts_t *stts = p_box->data.p_stts;
 
         msg_Warn( p_demux, "STTS table of %"PRIu32" entries", stts->i_entry_count );
 
-        /* Create sample -> dts table per chunk */
+        p_demux_track->p_stts = stts;
+
+        /* Locate each chunk in the runs */
         uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        uint32_t i_skip = 0;
+        bool b_truncated = false;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
+            uint32_t i_sample_count = ck->i_sample_count;
 
             /* save first dts */
             ck->i_first_dts = i_next_dts;
+            ck->i_stts_index = i_index;
+            ck->i_stts_skip = i_skip;
 
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            ck->i_entries_dts = 0;
-
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_dts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           stts->pi_sample_count,
-                                           stts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            ck->p_sample_delta_dts = calloc( ck->i_entries_dts, sizeof( uint32_t ) );
-            if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
+            while( i_sample_count > 0 && i_index < stts->i_entry_count )
             {
-                free( ck->p_sample_count_dts );
-                free( ck->p_sample_delta_dts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_dts );
-                ck->i_entries_dts = 0;
-                return VLC_ENOMEM;
-            }
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-
-            for( uint32_t i = 0; i < ck->i_entries_dts; i++ )
-            {
-                if ( i_current_index_samples_left )
+                const uint32_t i_run = __MIN( stts->pi_sample_count[i_index] - i_skip,
+                                              i_sample_count );
+                i_next_dts += (int64_t) i_run * stts->pi_sample_delta[i_index];
+                i_sample_count -= i_run;
+                i_skip += i_run;
+                if( i_skip == stts->pi_sample_count[i_index] )
                 {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = i_current_index_samples_left;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_current_index_samples_left ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
+                    i_index++;
+                    i_skip = 0;
                 }
-                else
-                {
-                    if ( stts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_dts[i] = i_sample_count;
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( i_sample_count ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_current_index_samples_left = stts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_dts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_dts[i] = stts->pi_sample_count[i_index];
-                        ck->p_sample_delta_dts[i] = stts->pi_sample_delta[i_index];
-                        i_next_dts += ck->p_sample_count_dts[i] * stts->pi_sample_delta[i_index];
-                        if ( stts->pi_sample_count[i_index] ) ck->i_duration = i_next_dts - ck->i_first_dts;
-                        i_sample_count -= stts->pi_sample_count[i_index];
-                        i_index++;
-                    }
-                }
-
             }
+            ck->i_duration = i_next_dts - ck->i_first_dts;
+            b_truncated |= i_sample_count > 0;
         }
+
+        if( b_truncated )
+            msg_Err( p_demux, "invalid index counting total samples %"PRIu32,
+                     stts->i_entry_count );
     }
 
 
@@ -2747,93 +2625,39 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
     if( p_box && p_box->data.p_ctts )
     {
-        MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
+        const MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
 
         msg_Warn( p_demux, "CTTS table of %"PRIu32" entries", ctts->i_entry_count );
 
-        int64_t i_cts_shift = 0;
+        p_demux_track->p_ctts = ctts;
+        p_demux_track->i_cts_shift = 0;
         const MP4_Box_t *p_cslg = MP4_BoxGet( p_demux_track->p_stbl, "cslg" );
         if( p_cslg && BOXDATA(p_cslg) )
-            i_cts_shift = BOXDATA(p_cslg)->ct_to_dts_shift;
+            p_demux_track->i_cts_shift = BOXDATA(p_cslg)->ct_to_dts_shift;
 
-        /* Create pts-dts table per chunk */
+        /* Locate each chunk in the runs */
         uint32_t i_index = 0;
-        uint32_t i_current_index_samples_left = 0;
+        uint32_t i_skip = 0;
 
         for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
         {
             mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            uint32_t i_sample_count;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_offset_pts and p_sample_count_pts */
-            ck->i_entries_pts = 0;
-            int i_ret = xTTS_CountEntries( p_demux, &ck->i_entries_pts, i_index,
-                                           i_current_index_samples_left,
-                                           ck->i_sample_count,
-                                           ctts->pi_sample_count,
-                                           ctts->i_entry_count );
-            if ( i_ret == VLC_EGENERIC )
-                return i_ret;
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( ck->i_entries_pts, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( ck->i_entries_pts, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-            {
-                free( ck->p_sample_count_pts );
-                free( ck->p_sample_offset_pts );
-                msg_Err( p_demux, "can't allocate memory for i_entry=%"PRIu32, ck->i_entries_pts );
-                ck->i_entries_pts = 0;
-                return VLC_ENOMEM;
-            }
+            uint32_t i_sample_count = ck->i_sample_count;
 
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
+            ck->i_ctts_index = i_index;
+            ck->i_ctts_skip = i_skip;
 
-            for( uint32_t i = 0; i < ck->i_entries_pts; i++ )
+            while( i_sample_count > 0 && i_index < ctts->i_entry_count )
             {
-                if ( i_current_index_samples_left )
-                {
-                    if ( i_current_index_samples_left > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left -= i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        break;
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = i_current_index_samples_left;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= i_current_index_samples_left;
-                        i_current_index_samples_left = 0;
-                        i_index++;
-                    }
-                }
-                else
+                const uint32_t i_run = __MIN( ctts->pi_sample_count[i_index] - i_skip,
+                                              i_sample_count );
+                i_sample_count -= i_run;
+                i_skip += i_run;
+                if( i_skip == ctts->pi_sample_count[i_index] )
                 {
-                    if ( ctts->pi_sample_count[i_index] > i_sample_count )
-                    {
-                        ck->p_sample_count_pts[i] = i_sample_count;
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_current_index_samples_left = ctts->pi_sample_count[i_index] - i_sample_count;
-                        i_sample_count = 0;
-                        assert( i == ck->i_entries_pts - 1 );
-                        // keep building from same index
-                    }
-                    else
-                    {
-                        ck->p_sample_count_pts[i] = ctts->pi_sample_count[i_index];
-                        ck->p_sample_offset_pts[i] = ctts->pi_sample_offset[i_index] + i_cts_shift;
-                        i_sample_count -= ctts->pi_sample_count[i_index];
-                        i_index++;
-                    }
+                    i_index++;
+                    i_skip = 0;
                 }
-
-
             }
         }
     }
@@ -3017,8 +2841,9 @@ static int TrackGetNearestSeekPoint( demux_t *p_demux, mp4_track_t *p_track,
     int i_ret = VLC_EGENERIC;
     *pi_sync_sample = 0;
 
-    const MP4_Box_t *p_stss;
-    if( ( p_stss = MP4_BoxGet( p_track->p_stbl, "stss" ) ) )
+    MP4_Box_t *p_stss;
+    if( ( p_stss = MP4_BoxGet( p_track->p_stbl, "stss" ) ) &&
+        MP4_BoxLoad( p_demux->s, p_stss ) == VLC_SUCCESS )
     {
         const MP4_Box_data_stss_t *p_stss_data = BOXDATA(p_stss);
         msg_Dbg( p_demux, "track[Id 0x%x] using Sync Sample Box (stss)",
@@ -3038,13 +2863,15 @@ static int TrackGetNearestSeekPoint( demux_t *p_demux, mp4_track_t *p_track,
     }
 
     /* try rap samples groups */
-    const MP4_Box_t *p_sbgp = MP4_BoxGet( p_track->p_stbl, "sbgp" );
+    MP4_Box_t *p_sbgp = MP4_BoxGet( p_track->p_stbl, "sbgp" );
     for( ; p_sbgp; p_sbgp = p_sbgp->p_next )
     {
-        const MP4_Box_data_sbgp_t *p_sbgp_data = BOXDATA(p_sbgp);
-        if( p_sbgp->i_type != ATOM_sbgp || !p_sbgp_data )
+        if( p_sbgp->i_type != ATOM_sbgp ||
+            MP4_BoxLoad( p_demux->s, p_sbgp ) != VLC_SUCCESS )
             continue;
 
+        const MP4_Box_data_sbgp_t *p_sbgp_data = BOXDATA(p_sbgp);
+
         if( p_sbgp_data->i_grouping_type == SAMPLEGROUP_rap )
         {
             uint32_t i_group_sample = 0;
@@ -3091,7 +2918,6 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     uint64_t     i_dts;
     unsigned int i_sample;
     unsigned int i_chunk;
-    int          i_index;
     stime_t      i_start;
 
     /* FIXME see if it's needed to check p_track->i_chunk_count */
@@ -3135,52 +2961,51 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = MP4_rescale_qtime( start, p_track->i_timescale );
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
     /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
+    /* chunks are sorted by dts, look for the last one starting before i_start */
+    uint32_t i_lo = 0, i_hi = p_track->i_chunk_count;
+    while( i_hi - i_lo > 1 )
     {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
-
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
+        const uint32_t i_mid = i_lo + (i_hi - i_lo) / 2;
+        if( (uint64_t)i_start >= p_track->chunk[i_mid].i_first_dts )
+            i_lo = i_mid;
+        else
+            i_hi = i_mid;
     }
+    i_chunk = i_lo;
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
+    const mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    const MP4_Box_data_stts_t *stts = p_track->p_stts;
+    uint32_t i_index = ck->i_stts_index;
+    uint32_t i_skip = ck->i_stts_skip;
+    uint32_t i_left = ck->i_sample_count;
+
+    i_sample = ck->i_sample_first;
+    i_dts    = ck->i_first_dts;
+    while( i_left > 0 && i_index < stts->i_entry_count )
     {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
-        {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+        const uint32_t i_run = __MIN( stts->pi_sample_count[i_index] - i_skip, i_left );
+        const int32_t i_delta = stts->pi_sample_delta[i_index];
 
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
+        if( i_dts + (int64_t) i_run * i_delta < (uint64_t)i_start )
+        {
+            i_dts    += (int64_t) i_run * i_delta;
+            i_sample += i_run;
+            i_left   -= i_run;
             i_index++;
+            i_skip = 0;
         }
         else
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
-            {
-                break;
-            }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+            if( i_delta > 0 )
+                i_sample += ( i_start - i_dts ) / i_delta;
             break;
         }
     }
+    /* past the end of the last chunk: stick to its last sample */
+    if( i_left == 0 && ck->i_sample_count > 0 )
+        i_sample--;
 
     if( i_sample >= p_track->i_sample_count )
     {
@@ -3613,15 +3438,6 @@ static void MP4_TrackSetup( demux_t *p_demux, mp4_track_t *p_track,
     p_track->b_ok = true;
 }
 
-static void DestroyChunk( mp4_chunk_t *ck )
-{
-    free( ck->p_sample_count_dts );
-    free( ck->p_sample_delta_dts );
-    free( ck->p_sample_count_pts );
-    free( ck->p_sample_offset_pts );
-    free( ck->p_sample_size );
-}
-
 /****************************************************************************
  * MP4_TrackClean:
  ****************************************************************************
@@ -3634,16 +3450,8 @@ static void MP4_TrackClean( es_out_t *out, mp4_track_t *p_track )
     if( p_track->p_es )
         es_out_Del( out, p_track->p_es );
 
-    if( p_track->chunk )
-    {
-        for( unsigned int i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-            DestroyChunk( &p_track->chunk[i_chunk] );
-    }
     free( p_track->chunk );
 
-    if( !p_track->i_sample_size )
-        free( p_track->p_sample_size );
-
     if ( p_track->asfinfo.p_frame )
         block_ChainRelease( p_track->asfinfo.p_frame );
 
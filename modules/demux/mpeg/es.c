@@ -780,6 +780,9 @@ static int WavSkipHeader( demux_t *p_demux, uint64_t *pi_skip,
     return VLC_SUCCESS;
 }
 
+/* Largest header checked by GenericProbe() (MLP/TrueHD major sync) */
+#define GENERIC_PROBE_MAX_CHECK_SIZE (4+28+16*4)
+
 static int GenericProbe( demux_t *p_demux, uint64_t *pi_offset,
                          const char * ppsz_name[],
                          int (*pf_check)( const uint8_t *, unsigned * ),
@@ -793,9 +796,12 @@ static int GenericProbe( demux_t *p_demux, uint64_t *pi_offset,
     bool   b_forced_demux;
 
     uint64_t i_offset;
-    const uint8_t *p_peek;
+    const block_t *p_peek;
+    uint8_t p_check[GENERIC_PROBE_MAX_CHECK_SIZE];
     uint64_t i_skip;
 
+    assert( i_check_size <= sizeof( p_check ) );
+
     b_forced_demux = false;
     for( size_t i = 0; ppsz_name[i] != NULL; i++ )
     {
@@ -816,7 +822,8 @@ static int GenericProbe( demux_t *p_demux, uint64_t *pi_offset,
      * We will accept probing 0.5s of data in this case.
      */
     const size_t i_probe = i_skip + i_check_size + i_base_probing + ( b_wav ? i_wav_extra_probing : 0);
-    const size_t i_peek = vlc_stream_Peek( p_demux->s, &p_peek, i_probe );
+    const ssize_t i_ret = vlc_stream_PeekChain( p_demux->s, &p_peek, i_probe );
+    const size_t i_peek = i_ret > 0 ? i_ret : 0;
     if( i_peek < i_skip + i_check_size )
     {
         msg_Dbg( p_demux, "cannot peek" );
@@ -831,7 +838,8 @@ static int GenericProbe( demux_t *p_demux, uint64_t *pi_offset,
             break;
         }
         unsigned i_samples = 0;
-        int i_size = pf_check( &p_peek[i_skip], &i_samples );
+        int i_size = pf_check( vlc_stream_ChainAt( p_peek, i_skip, i_check_size,
+                                                   p_check ), &i_samples );
         if( i_size >= 0 )
         {
             if( i_size == 0 || /* 0 sized frame ?? */
@@ -854,7 +862,9 @@ static int GenericProbe( demux_t *p_demux, uint64_t *pi_offset,
 
                 if( i_skip + i_check_size + i_size <= i_peek )
                 {
-                    b_ok = pf_check( &p_peek[i_skip+i_size], NULL ) >= 0;
+                    b_ok = pf_check( vlc_stream_ChainAt( p_peek, i_skip + i_size,
+                                                         i_check_size, p_check ),
+                                     NULL ) >= 0;
                     if( b_ok )
                         break;
                 }
@@ -948,10 +958,13 @@ static int MpgaProbe( demux_t *p_demux, uint64_t *pi_offset )
         if( !b_forced_demux && !b_forced )
             return VLC_EGENERIC;
 
-        i_peek = vlc_stream_Peek( p_demux->s, &p_peek, i_skip + 8096 );
+        const block_t *p_chain;
+        uint8_t p_sync[4];
+
+        i_peek = vlc_stream_PeekChain( p_demux->s, &p_chain, i_skip + 8096 );
         while( i_peek > 0 && i_skip + 4 < (uint64_t) i_peek )
         {
-            if( MpgaCheckSync( &p_peek[i_skip] ) )
+            if( MpgaCheckSync( vlc_stream_ChainAt( p_chain, i_skip, 4, p_sync ) ) )
             {
                 b_ok = true;
                 break;
@@ -206,35 +206,43 @@ static void PCRFixHandle( demux_t *, ts_pmt_t *, block_t * );
 #define PROBE_CHUNK_COUNT 500
 #define PROBE_MAX         (PROBE_CHUNK_COUNT * 10)
 
+static inline bool IsSyncByte( const block_t *p_chain, size_t i_offset )
+{
+    uint8_t i_byte;
+    const uint8_t *p = vlc_stream_ChainAt( p_chain, i_offset, 1, &i_byte );
+    return p != NULL && *p == 0x47;
+}
+
 static int DetectPacketSize( demux_t *p_demux, unsigned *pi_header_size, int i_offset )
 {
-    const uint8_t *p_peek;
+    const block_t *p_peek;
+    const ssize_t i_avail = vlc_stream_PeekChain( p_demux->s, &p_peek,
+                                                  i_offset + TS_PACKET_SIZE_MAX * 4 );
 
-    if( vlc_stream_Peek( p_demux->s,
-                     &p_peek, i_offset + TS_PACKET_SIZE_MAX ) < i_offset + TS_PACKET_SIZE_MAX )
+    if( i_avail < i_offset + TS_PACKET_SIZE_MAX )
         return -1;
 
     for( int i_sync = 0; i_sync < TS_PACKET_SIZE_MAX; i_sync++ )
     {
-        if( p_peek[i_offset + i_sync] != 0x47 )
+        if( !IsSyncByte( p_peek, i_offset + i_sync ) )
             continue;
 
         /* Check next 3 sync bytes */
         int i_peek = i_offset + TS_PACKET_SIZE_MAX * 3 + i_sync + 1;
-        if( ( vlc_stream_Peek( p_demux->s, &p_peek, i_peek ) ) < i_peek )
+        if( i_avail < i_peek )
         {
             msg_Dbg( p_demux, "cannot peek" );
             return -1;
         }
-        if( p_peek[i_offset + i_sync + 1 * TS_PACKET_SIZE_188] == 0x47 &&
-            p_peek[i_offset + i_sync + 2 * TS_PACKET_SIZE_188] == 0x47 &&
-            p_peek[i_offset + i_sync + 3 * TS_PACKET_SIZE_188] == 0x47 )
+        if( IsSyncByte( p_peek, i_offset + i_sync + 1 * TS_PACKET_SIZE_188 ) &&
+            IsSyncByte( p_peek, i_offset + i_sync + 2 * TS_PACKET_SIZE_188 ) &&
+            IsSyncByte( p_peek, i_offset + i_sync + 3 * TS_PACKET_SIZE_188 ) )
         {
             return TS_PACKET_SIZE_188;
         }
-        else if( p_peek[i_offset + i_sync + 1 * TS_PACKET_SIZE_192] == 0x47 &&
-                 p_peek[i_offset + i_sync + 2 * TS_PACKET_SIZE_192] == 0x47 &&
-                 p_peek[i_offset + i_sync + 3 * TS_PACKET_SIZE_192] == 0x47 )
+        else if( IsSyncByte( p_peek, i_offset + i_sync + 1 * TS_PACKET_SIZE_192 ) &&
+                 IsSyncByte( p_peek, i_offset + i_sync + 2 * TS_PACKET_SIZE_192 ) &&
+                 IsSyncByte( p_peek, i_offset + i_sync + 3 * TS_PACKET_SIZE_192 ) )
         {
             if( i_sync == 4 )
             {
@@ -242,9 +250,9 @@ static int DetectPacketSize( demux_t *p_demux, unsigned *pi_header_size, int i_o
             }
             return TS_PACKET_SIZE_192;
         }
-        else if( p_peek[i_offset + i_sync + 1 * TS_PACKET_SIZE_204] == 0x47 &&
-                 p_peek[i_offset + i_sync + 2 * TS_PACKET_SIZE_204] == 0x47 &&
-                 p_peek[i_offset + i_sync + 3 * TS_PACKET_SIZE_204] == 0x47 )
+        else if( IsSyncByte( p_peek, i_offset + i_sync + 1 * TS_PACKET_SIZE_204 ) &&
+                 IsSyncByte( p_peek, i_offset + i_sync + 2 * TS_PACKET_SIZE_204 ) &&
+                 IsSyncByte( p_peek, i_offset + i_sync + 3 * TS_PACKET_SIZE_204 ) )
         {
             return TS_PACKET_SIZE_204;
         }
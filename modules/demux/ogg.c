@@ -268,6 +268,7 @@ static void Close( vlc_object_t *p_this )
     /* Cleanup the bitstream parser */
     ogg_sync_clear( &p_sys->oy );
 
+    Oggseek_StoreIndex( p_demux );
     Ogg_EndOfStream( p_demux );
 
     if( p_sys->p_old_stream )
@@ -394,6 +395,9 @@ static int Demux( demux_t * p_demux )
 
             vlc_tick_t i_lastdts = Ogg_GetLastDTS( p_demux );
 
+            Oggseek_StoreIndex( p_demux );
+            p_sys->b_seekindex = false;
+
             /* We keep the ES to try reusing it in Ogg_BeginningOfStream
              * only 1 ES is supported (common case for ogg web radio) */
             if( p_sys->i_streams == 1 && p_sys->pp_stream[0]->p_es )
@@ -425,8 +429,11 @@ static int Demux( demux_t * p_demux )
         {
             /* Find the real duration */
             vlc_stream_Control( p_demux->s, STREAM_CAN_SEEK, &b_canseek );
-            if ( b_canseek )
+            if ( b_canseek && !Oggseek_LoadIndex( p_demux ) )
+            {
                 Oggseek_ProbeEnd( p_demux );
+                p_sys->b_seekindex_dirty = true;
+            }
         }
         else
         {
@@ -222,6 +222,10 @@ typedef struct
     /* Length in second, if available. */
     int64_t i_length;
 
+    /* seek index cache in use (first group of logical streams) */
+    bool b_seekindex;
+    bool b_seekindex_dirty;
+
     bool b_slave;
 
 } demux_sys_t;
@@ -45,6 +45,7 @@
 #include "ogg.h"
 #include "oggseek.h"
 #include "ogg_granule.h"
+#include "seekindex.h"
 
 #define SEGMENT_NOT_FOUND -1
 
@@ -907,14 +908,142 @@ int Oggseek_SeektoAbsolutetime( demux_t *p_demux, logical_stream_t *p_stream,
     }
     /* Insert keyframe position into index */
     OggNoDebug(
-    if ( i_pagepos >= p_stream->i_data_start )
-        OggSeek_IndexAdd( p_stream, i_time, i_pagepos )
+    if ( i_pagepos >= p_stream->i_data_start &&
+         OggSeek_IndexAdd( p_stream, i_time, i_pagepos ) )
+        p_sys->b_seekindex_dirty = true
     );
 
     OggDebug( msg_Dbg( p_demux, "=================== Seeked To %"PRId64" time %"PRId64, i_pagepos, i_time ) );
     return i_pagepos;
 }
 
+/****************************************************************************
+ * Seek index cache: length and keyframe positions found by bisection are
+ * kept across playbacks for the first group of logical streams.
+ *
+ * Layout (little endian): length in seconds, stream count, then for each
+ * stream its serial number, its entry count and its entries (time, page
+ * position).
+ ****************************************************************************/
+bool Oggseek_LoadIndex( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    size_t i_size;
+
+    p_sys->b_seekindex = true;
+    p_sys->b_seekindex_dirty = false;
+
+    uint8_t *p_data = demux_SeekIndexLoad( p_demux, "ogg",
+                                           OGGSEEK_INDEX_VERSION, &i_size );
+    if ( p_data == NULL )
+        return false;
+
+    if ( i_size < 12 )
+        goto error;
+
+    int64_t i_length = GetQWLE( p_data );
+    uint32_t i_streams = GetDWLE( p_data + 8 );
+
+    /* Check the whole layout first, so that a damaged entry does not leave
+     * a partially filled index behind */
+    const uint8_t *p = p_data + 12;
+    size_t i_left = i_size - 12;
+    for ( uint32_t i = 0; i < i_streams; i++ )
+    {
+        if ( i_left < 8 )
+            goto error;
+        uint32_t i_count = GetDWLE( p + 4 );
+        p += 8; i_left -= 8;
+        if ( i_left / 16 < i_count )
+            goto error;
+        p += 16 * (size_t)i_count; i_left -= 16 * (size_t)i_count;
+    }
+    if ( i_left != 0 )
+        goto error;
+
+    p = p_data + 12;
+    for ( uint32_t i = 0; i < i_streams; i++ )
+    {
+        int i_serial_no = GetDWLE( p );
+        uint32_t i_count = GetDWLE( p + 4 );
+        p += 8;
+
+        logical_stream_t *p_stream = NULL;
+        for ( int j = 0; j < p_sys->i_streams; j++ )
+            if ( p_sys->pp_stream[j]->i_serial_no == i_serial_no )
+                p_stream = p_sys->pp_stream[j];
+
+        for ( uint32_t j = 0; j < i_count; j++ )
+        {
+            int64_t i_pagepos = GetQWLE( p + 8 );
+            if ( p_stream && i_pagepos >= p_stream->i_data_start &&
+                 i_pagepos < p_sys->i_total_length )
+                OggSeek_IndexAdd( p_stream, GetQWLE( p ), i_pagepos );
+            p += 16;
+        }
+    }
+    free( p_data );
+
+    if ( i_length <= 0 )
+        return false;
+
+    msg_Dbg( p_demux, "reusing cached length of %"PRId64" seconds", i_length );
+    p_sys->i_length = i_length;
+    return true;
+
+error:
+    msg_Warn( p_demux, "cached seek index does not match the file" );
+    free( p_data );
+    return false;
+}
+
+void Oggseek_StoreIndex( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if ( !p_sys->b_seekindex || !p_sys->b_seekindex_dirty )
+        return;
+
+    size_t i_size = 12;
+    for ( int i = 0; i < p_sys->i_streams; i++ )
+    {
+        i_size += 8;
+        for ( const demux_index_entry_t *idx = p_sys->pp_stream[i]->idx;
+              idx != NULL; idx = idx->p_next )
+            i_size += 16;
+    }
+
+    uint8_t *p_data = malloc( i_size );
+    if ( p_data == NULL )
+        return;
+
+    uint8_t *p = p_data;
+    SetQWLE( p, p_sys->i_length );
+    SetDWLE( p + 8, p_sys->i_streams );
+    p += 12;
+    for ( int i = 0; i < p_sys->i_streams; i++ )
+    {
+        uint8_t *p_count = p + 4;
+        uint32_t i_count = 0;
+
+        SetDWLE( p, p_sys->pp_stream[i]->i_serial_no );
+        p += 8;
+        for ( const demux_index_entry_t *idx = p_sys->pp_stream[i]->idx;
+              idx != NULL; idx = idx->p_next )
+        {
+            SetQWLE( p, idx->i_value );
+            SetQWLE( p + 8, idx->i_pagepos );
+            p += 16;
+            i_count++;
+        }
+        SetDWLE( p_count, i_count );
+    }
+
+    demux_SeekIndexStore( p_demux, "ogg", OGGSEEK_INDEX_VERSION,
+                          p_data, i_size );
+    free( p_data );
+}
+
 /****************************************************************************
  * oggseek_read_page: Read a full Ogg page from the physical bitstream.
  ****************************************************************************
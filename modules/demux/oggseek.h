@@ -39,6 +39,9 @@
 
 #define OGGSEEK_BYTES_TO_READ 8500
 
+/* layout version of the cached seek index */
+#define OGGSEEK_INDEX_VERSION 1
+
 /* index entries are structured as follows:
  *   - for theora, highest granulepos -> pagepos (bytes) where keyframe begins
  *  - for dirac, kframe (sync point) -> pagepos of sequence start (?)
@@ -63,6 +66,8 @@ int     Oggseek_BlindSeektoPosition ( demux_t *, logical_stream_t *, double f, b
 int     Oggseek_SeektoAbsolutetime ( demux_t *, logical_stream_t *, vlc_tick_t );
 const demux_index_entry_t *OggSeek_IndexAdd ( logical_stream_t *, vlc_tick_t, int64_t );
 void    Oggseek_ProbeEnd( demux_t * );
+bool    Oggseek_LoadIndex( demux_t * );
+void    Oggseek_StoreIndex( demux_t * );
 
 void oggseek_index_entries_free ( demux_index_entry_t * );
 
@@ -0,0 +1,392 @@
+/*****************************************************************************
+ * seekindex.c: persistent seek index cache for demuxers
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_configuration.h>
+#include <vlc_vector.h>
+
+#include "seekindex.h"
+
+#define SEEKINDEX_MAGIC   "VLCSKIDX"
+#define SEEKINDEX_FORMAT  1
+#define SEEKINDEX_HEADER  (8 + 4 + 4 + 8 + 16)
+#define SEEKINDEX_SUFFIX  ".idx"
+
+/* Bytes hashed at the start, and where cheap the end, to identify a file:
+ * a few when its modification date is known, more otherwise */
+#define SEEKINDEX_PROBE_LOCAL (4 * 1024)
+#define SEEKINDEX_PROBE       (64 * 1024)
+
+/* Upper bound of a cache entry, anything larger is considered corrupted */
+#define SEEKINDEX_MAX     (32 * 1024 * 1024)
+
+/* Bounds of the cache directory, the oldest entries are evicted first */
+#ifndef SEEKINDEX_CACHE_ENTRIES
+# define SEEKINDEX_CACHE_ENTRIES 256
+#endif
+#ifndef SEEKINDEX_CACHE_SIZE
+# define SEEKINDEX_CACHE_SIZE    (128 * 1024 * 1024)
+#endif
+
+static bool SeekIndexHashRange(stream_t *s, struct md5_s *md5,
+                               uint64_t offset, size_t len)
+{
+    uint8_t buf[4096];
+
+    if (vlc_stream_Seek(s, offset))
+        return false;
+
+    while (len > 0)
+    {
+        ssize_t val = vlc_stream_Read(s, buf, __MIN(len, sizeof (buf)));
+        if (val <= 0)
+            return false;
+        AddMD5(md5, buf, val);
+        len -= val;
+    }
+    return true;
+}
+
+/* Returns the cache directory */
+static char *SeekIndexGetDir(void)
+{
+    char *dir = config_GetUserDir(VLC_CACHE_DIR);
+    char *path;
+
+    if (unlikely(dir == NULL)
+     || asprintf(&path, "%s"DIR_SEP"seekindex", dir) == -1)
+        path = NULL;
+    free(dir);
+    return path;
+}
+
+/* Returns the path of the cache entry of the demuxed file */
+static char *SeekIndexGetPath(demux_t *demux, const char *tag)
+{
+    stream_t *s = demux->s;
+    bool can_seek, fast_seek;
+    uint64_t size;
+
+    /* Preparsing never seeks, do not even hash the file */
+    if (demux->b_preparsing || !var_InheritBool(demux, "seek-index-cache")
+     || vlc_stream_Control(s, STREAM_CAN_SEEK, &can_seek) || !can_seek
+     || vlc_stream_GetSize(s, &size) || size == 0)
+        return NULL;
+
+    int64_t mtime = 0, mtime_ns = 0;
+    bool local = false;
+    if (demux->psz_filepath != NULL)
+    {
+        struct stat st;
+
+        if (vlc_stat(demux->psz_filepath, &st) == 0)
+        {
+            mtime = st.st_mtime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+            mtime_ns = st.st_mtim.tv_nsec;
+#endif
+            local = true;
+        }
+    }
+
+    /* A local file rewritten since it was indexed has another date, but it
+     * can be rewritten within the timestamp granularity of its file system:
+     * also hash its last bytes, which a seek away are cheap to reach.
+     * Otherwise, hash more, and the last ones only unless reaching them
+     * costs another request. */
+    size_t head, tail;
+    if (local)
+    {
+        head = __MIN(size, SEEKINDEX_PROBE_LOCAL);
+        tail = head;
+    }
+    else
+    {
+        head = __MIN(size, SEEKINDEX_PROBE);
+        tail = vlc_stream_Control(s, STREAM_CAN_FASTSEEK, &fast_seek) == 0
+            && fast_seek ? head : 0;
+    }
+
+    struct md5_s md5;
+    uint8_t buf[8];
+
+    InitMD5(&md5);
+    AddMD5(&md5, tag, strlen(tag) + 1);
+    SetQWLE(buf, size);
+    AddMD5(&md5, buf, sizeof (buf));
+    SetQWLE(buf, mtime);
+    AddMD5(&md5, buf, sizeof (buf));
+    SetQWLE(buf, mtime_ns);
+    AddMD5(&md5, buf, sizeof (buf));
+
+    const uint64_t pos = vlc_stream_Tell(s);
+    bool ok = SeekIndexHashRange(s, &md5, 0, head)
+           && (tail == 0 || SeekIndexHashRange(s, &md5, size - tail, tail));
+
+    if (vlc_stream_Seek(s, pos))
+        ok = false;
+    if (!ok)
+        return NULL;
+
+    EndMD5(&md5);
+
+    char *dir = SeekIndexGetDir();
+    if (unlikely(dir == NULL))
+        return NULL;
+
+    char *hash = psz_md5_hash(&md5);
+    char *path;
+    if (unlikely(hash == NULL)
+     || asprintf(&path, "%s"DIR_SEP"%s"SEEKINDEX_SUFFIX, dir, hash) == -1)
+        path = NULL;
+    free(hash);
+    free(dir);
+    return path;
+}
+
+struct seekindex_entry
+{
+    char *path;
+    time_t mtime;
+    uint64_t size;
+};
+
+static int SeekIndexCompare(const void *a, const void *b)
+{
+    const struct seekindex_entry *ea = a, *eb = b;
+
+    if (ea->mtime != eb->mtime)
+        return ea->mtime < eb->mtime ? -1 : 1;
+    return strcmp(ea->path, eb->path);
+}
+
+/* Evicts the oldest entries but the given one until the cache fits its
+ * bounds */
+static void SeekIndexPrune(demux_t *demux, const char *keep)
+{
+    char *dir = SeekIndexGetDir();
+    if (unlikely(dir == NULL))
+        return;
+
+    DIR *handle = vlc_opendir(dir);
+    if (handle == NULL)
+    {
+        free(dir);
+        return;
+    }
+
+    struct VLC_VECTOR(struct seekindex_entry) entries = VLC_VECTOR_INITIALIZER;
+    uint64_t total = 0;
+    const char *name;
+
+    while ((name = vlc_readdir(handle)) != NULL)
+    {
+        const size_t len = strlen(name);
+        struct seekindex_entry entry;
+        struct stat st;
+
+        /* Skip the entries being written */
+        if (len <= strlen(SEEKINDEX_SUFFIX)
+         || strcmp(name + len - strlen(SEEKINDEX_SUFFIX), SEEKINDEX_SUFFIX))
+            continue;
+        if (asprintf(&entry.path, "%s"DIR_SEP"%s", dir, name) == -1)
+            break;
+        if (vlc_stat(entry.path, &st) || !S_ISREG(st.st_mode)
+         || !strcmp(entry.path, keep))
+        {
+            free(entry.path);
+            continue;
+        }
+        entry.mtime = st.st_mtime;
+        entry.size = st.st_size;
+        if (!vlc_vector_push(&entries, entry))
+        {
+            free(entry.path);
+            break;
+        }
+        total += entry.size;
+    }
+    closedir(handle);
+    free(dir);
+
+    struct stat st;
+    if (vlc_stat(keep, &st) == 0)
+        total += st.st_size;
+
+    qsort(entries.data, entries.size, sizeof (*entries.data),
+          SeekIndexCompare);
+
+    /* The kept entry counts too */
+    size_t count = entries.size + 1;
+    for (size_t i = 0; i < entries.size; i++)
+    {
+        struct seekindex_entry *entry = &entries.data[i];
+
+        if (count > SEEKINDEX_CACHE_ENTRIES || total > SEEKINDEX_CACHE_SIZE)
+        {
+            msg_Dbg(demux, "evicting seek index cache %s", entry->path);
+            vlc_unlink(entry->path);
+            total -= entry->size;
+            count--;
+        }
+        free(entry->path);
+    }
+    vlc_vector_clear(&entries);
+}
+
+void *demux_SeekIndexLoad(demux_t *demux, const char *tag, uint32_t version,
+                          size_t *sizep)
+{
+    char *path = SeekIndexGetPath(demux, tag);
+    if (path == NULL)
+        return NULL;
+
+    FILE *file = vlc_fopen(path, "rb");
+    if (file == NULL)
+    {
+        free(path);
+        return NULL;
+    }
+
+    uint8_t header[SEEKINDEX_HEADER];
+    void *data = NULL;
+    uint64_t size;
+
+    if (fread(header, sizeof (header), 1, file) != 1
+     || memcmp(header, SEEKINDEX_MAGIC, 8)
+     || GetDWLE(header + 8) != SEEKINDEX_FORMAT
+     || GetDWLE(header + 12) != version
+     || (size = GetQWLE(header + 16)) > SEEKINDEX_MAX
+     || (data = malloc(size ? size : 1)) == NULL
+     || fread(data, 1, size, file) != size)
+        goto error;
+
+    struct md5_s md5;
+    InitMD5(&md5);
+    AddMD5(&md5, data, size);
+    EndMD5(&md5);
+    if (memcmp(md5.buf, header + 24, 16))
+        goto error;
+
+    fclose(file);
+    msg_Dbg(demux, "loaded %"PRIu64" bytes of seek index from %s", size, path);
+    free(path);
+    *sizep = size;
+    return data;
+
+error:
+    msg_Warn(demux, "discarding invalid seek index cache %s", path);
+    fclose(file);
+    vlc_unlink(path);
+    free(path);
+    free(data);
+    return NULL;
+}
+
+int demux_SeekIndexStore(demux_t *demux, const char *tag, uint32_t version,
+                         const void *data, size_t size)
+{
+    if (size > SEEKINDEX_MAX)
+        return VLC_EGENERIC;
+
+    char *path = SeekIndexGetPath(demux, tag);
+    if (path == NULL)
+        return VLC_EGENERIC;
+
+    /* Create the missing cache directories */
+    for (char *sep = strchr(path + 1, DIR_SEP_CHAR); sep != NULL;
+         sep = strchr(sep + 1, DIR_SEP_CHAR))
+    {
+        *sep = '\0';
+        vlc_mkdir(path, 0700);
+        *sep = DIR_SEP_CHAR;
+    }
+
+    char *tmppath;
+    if (asprintf(&tmppath, "%s.XXXXXX", path) == -1)
+    {
+        free(path);
+        return VLC_ENOMEM;
+    }
+
+    int fd = vlc_mkstemp(tmppath);
+    FILE *file = (fd != -1) ? fdopen(fd, "wb") : NULL;
+    if (file == NULL)
+    {
+        msg_Warn(demux, "cannot create %s: %s", tmppath,
+                 vlc_strerror_c(errno));
+        if (fd != -1)
+        {
+            vlc_close(fd);
+            vlc_unlink(tmppath);
+        }
+        free(tmppath);
+        free(path);
+        return VLC_EGENERIC;
+    }
+
+    uint8_t header[SEEKINDEX_HEADER];
+    struct md5_s md5;
+
+    InitMD5(&md5);
+    AddMD5(&md5, data, size);
+    EndMD5(&md5);
+
+    memcpy(header, SEEKINDEX_MAGIC, 8);
+    SetDWLE(header + 8, SEEKINDEX_FORMAT);
+    SetDWLE(header + 12, version);
+    SetQWLE(header + 16, size);
+    memcpy(header + 24, md5.buf, 16);
+
+    bool ok = fwrite(header, sizeof (header), 1, file) == 1
+           && fwrite(data, 1, size, file) == size;
+    if (fclose(file))
+        ok = false;
+
+    /* Atomically replace the previous entry */
+    if (!ok || vlc_rename(tmppath, path))
+    {
+        msg_Warn(demux, "cannot write %s: %s", path, vlc_strerror_c(errno));
+        vlc_unlink(tmppath);
+        ok = false;
+    }
+    else
+    {
+        msg_Dbg(demux, "stored %zu bytes of seek index to %s", size, path);
+        SeekIndexPrune(demux, path);
+    }
+
+    free(tmppath);
+    free(path);
+    return ok ? VLC_SUCCESS : VLC_EGENERIC;
+}
@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * seekindex.h: persistent seek index cache for demuxers
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_DEMUX_SEEKINDEX_H
+#define VLC_DEMUX_SEEKINDEX_H
+
+/*
+ * Demuxers which have to scan the whole file to build their seek points
+ * (broken AVI index, Matroska without cues, Ogg bisection) can store the
+ * result in the user cache directory and reload it on the next open.
+ *
+ * Entries are keyed by the identity of the file: its size, a hash of its
+ * first bytes, and its modification date when it is a local file, else a
+ * hash of its last bytes when the stream can seek there quickly.
+ * The data itself is opaque, each demuxer serializes its own index and bumps
+ * its version whenever the layout changes.
+ *
+ * The cache directory is bounded in size and number of entries, the oldest
+ * entries being evicted first when a new one is stored.
+ *
+ * Caching is only done on seekable streams, not while preparsing, and can be
+ * disabled with the "seek-index-cache" option.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Loads the seek index previously stored for the demuxed file.
+ *
+ * The stream position is preserved.
+ *
+ * \param demux demuxer
+ * \param tag demuxer identifier (e.g. "avi")
+ * \param version version of the demuxer data layout
+ * \param sizep pointer to the size of the data [OUT]
+ * \return heap allocated data (release with free()), or NULL if there is
+ * no valid entry for this file
+ */
+void *demux_SeekIndexLoad(demux_t *demux, const char *tag, uint32_t version,
+                          size_t *sizep);
+
+/**
+ * Stores the seek index of the demuxed file, replacing any previous one.
+ *
+ * The stream position is preserved.
+ *
+ * \param demux demuxer
+ * \param tag demuxer identifier (e.g. "avi")
+ * \param version version of the demuxer data layout
+ * \param data serialized index
+ * \param size size of the serialized index in bytes
+ * \return VLC_SUCCESS or an error code
+ */
+int demux_SeekIndexStore(demux_t *demux, const char *tag, uint32_t version,
+                         const void *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,429 @@
+/*****************************************************************************
+ * latency.c: pipeline latency tracer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_fs.h>
+#include <vlc_tracer.h>
+#include <vlc_vector.h>
+
+/* Latency histograms use power of two buckets of microseconds:
+ * bucket n counts latencies in [2^(n-1), 2^n[ us, the last one up to ~8 s. */
+#define LATENCY_BUCKETS 24
+
+/* Number of frames in flight tracked per elementary stream */
+#define LATENCY_PENDING 64
+
+/* Number of trace events queued before the writer thread is woken up */
+#define LATENCY_BATCH 1024
+
+/* Last boundary crossed by a frame, identified by its stream timestamp */
+struct latency_pending
+{
+    vlc_tick_t pts;
+    vlc_tick_t ts;
+    const char *type;
+    const char *stage;
+};
+
+struct latency_stream
+{
+    int id;
+    unsigned next;
+    struct latency_pending pending[LATENCY_PENDING];
+};
+
+/* Time spent between two successive boundaries */
+struct latency_edge
+{
+    int id;
+    const char *from_type, *from_stage;
+    const char *to_type, *to_stage;
+    uint64_t count;
+    vlc_tick_t sum;
+    vlc_tick_t max;
+    uint64_t buckets[LATENCY_BUCKETS];
+};
+
+/* Interval queued for the trace file */
+struct latency_event
+{
+    int id;
+    const char *from_type, *from_stage;
+    const char *to_type, *to_stage;
+    vlc_tick_t ts; /* relative to the first stamp */
+    vlc_tick_t duration;
+    vlc_tick_t pts;
+};
+
+typedef struct VLC_VECTOR(struct latency_event) latency_events_t;
+
+typedef struct
+{
+    vlc_object_t *obj;
+    vlc_mutex_t lock;
+    struct VLC_VECTOR(struct latency_stream *) streams;
+    struct VLC_VECTOR(struct latency_edge *) edges;
+    vlc_tick_t origin;
+
+    /* The trace file is written by a separate thread, so that the traced
+     * threads never wait for file I/O */
+    FILE *trace; /* Chrome trace event file, or NULL */
+    bool first_event;
+    vlc_thread_t writer;
+    vlc_cond_t wait;
+    latency_events_t events;
+    bool quit;
+} vlc_tracer_sys_t;
+
+static bool BoundaryEqual(const char *type_a, const char *stage_a,
+                          const char *type_b, const char *stage_b)
+{
+    return !strcmp(type_a, type_b) && !strcmp(stage_a, stage_b);
+}
+
+static struct latency_stream *GetStream(vlc_tracer_sys_t *sys, int id)
+{
+    struct latency_stream *stream;
+
+    vlc_vector_foreach(stream, &sys->streams)
+        if (stream->id == id)
+            return stream;
+
+    stream = calloc(1, sizeof (*stream));
+    if (unlikely(stream == NULL))
+        return NULL;
+    stream->id = id;
+    for (unsigned i = 0; i < LATENCY_PENDING; i++)
+        stream->pending[i].pts = VLC_TICK_INVALID;
+
+    if (!vlc_vector_push(&sys->streams, stream))
+    {
+        free(stream);
+        return NULL;
+    }
+    return stream;
+}
+
+static struct latency_edge *GetEdge(vlc_tracer_sys_t *sys, int id,
+                                    const struct latency_pending *from,
+                                    const char *type, const char *stage)
+{
+    struct latency_edge *edge;
+
+    vlc_vector_foreach(edge, &sys->edges)
+        if (edge->id == id
+         && BoundaryEqual(edge->from_type, edge->from_stage,
+                          from->type, from->stage)
+         && BoundaryEqual(edge->to_type, edge->to_stage, type, stage))
+            return edge;
+
+    edge = calloc(1, sizeof (*edge));
+    if (unlikely(edge == NULL))
+        return NULL;
+    edge->id = id;
+    edge->from_type = from->type;
+    edge->from_stage = from->stage;
+    edge->to_type = type;
+    edge->to_stage = stage;
+
+    if (!vlc_vector_push(&sys->edges, edge))
+    {
+        free(edge);
+        return NULL;
+    }
+    return edge;
+}
+
+static void EdgeAdd(struct latency_edge *edge, vlc_tick_t latency)
+{
+    int64_t us = US_FROM_VLC_TICK(latency);
+    unsigned bucket = 0;
+
+    while (us > 0 && bucket < LATENCY_BUCKETS - 1)
+    {
+        us >>= 1;
+        bucket++;
+    }
+
+    edge->count++;
+    edge->sum += latency;
+    if (latency > edge->max)
+        edge->max = latency;
+    edge->buckets[bucket]++;
+}
+
+/* Returns the upper bound of the bucket holding the given quantile */
+static vlc_tick_t EdgeQuantile(const struct latency_edge *edge,
+                               unsigned percent)
+{
+    uint64_t rank = (edge->count * percent + 99) / 100;
+    uint64_t seen = 0;
+
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++)
+    {
+        seen += edge->buckets[i];
+        if (seen >= rank)
+            return __MIN(VLC_TICK_FROM_US(INT64_C(1) << i), edge->max);
+    }
+    return edge->max;
+}
+
+static void TraceEvent(vlc_tracer_sys_t *sys, int id,
+                       const struct latency_pending *from,
+                       const char *type, const char *stage, vlc_tick_t ts)
+{
+    struct latency_event event = {
+        .id = id,
+        .from_type = from->type, .from_stage = from->stage,
+        .to_type = type, .to_stage = stage,
+        .ts = from->ts - sys->origin,
+        .duration = ts - from->ts,
+        .pts = from->pts,
+    };
+
+    if (unlikely(!vlc_vector_push(&sys->events, event)))
+        return;
+    if (sys->events.size == LATENCY_BATCH)
+        vlc_cond_signal(&sys->wait);
+}
+
+static void WriteEvent(vlc_tracer_sys_t *sys,
+                       const struct latency_event *event)
+{
+    if (sys->first_event)
+        sys->first_event = false;
+    else
+        fputs(",\n", sys->trace);
+
+    /* Complete event ("X"), one thread line per elementary stream */
+    fprintf(sys->trace, "{\"name\":\"%s:%s > %s:%s\",\"cat\":\"%s\","
+            "\"ph\":\"X\",\"ts\":%"PRId64",\"dur\":%"PRId64","
+            "\"pid\":1,\"tid\":%d,\"args\":{\"pts\":%"PRId64"}}",
+            event->from_type, event->from_stage, event->to_type,
+            event->to_stage, event->to_type, US_FROM_VLC_TICK(event->ts),
+            US_FROM_VLC_TICK(event->duration), event->id,
+            US_FROM_VLC_TICK(event->pts));
+}
+
+static void *Writer(void *data)
+{
+    vlc_tracer_sys_t *sys = data;
+    latency_events_t batch = VLC_VECTOR_INITIALIZER;
+    bool quit;
+
+    vlc_mutex_lock(&sys->lock);
+    do
+    {
+        while (sys->events.size < LATENCY_BATCH && !sys->quit)
+            vlc_cond_wait(&sys->wait, &sys->lock);
+
+        /* Take the queued events, and write them without the lock */
+        latency_events_t queued = sys->events;
+        sys->events = batch;
+        batch = queued;
+        quit = sys->quit;
+        vlc_mutex_unlock(&sys->lock);
+
+        for (size_t i = 0; i < batch.size; i++)
+            WriteEvent(sys, &batch.data[i]);
+        vlc_vector_clear(&batch);
+
+        vlc_mutex_lock(&sys->lock);
+    }
+    while (!quit);
+    vlc_mutex_unlock(&sys->lock);
+    return NULL;
+}
+
+static void Trace(void *opaque, vlc_tick_t ts, const char *type, int id,
+                  const char *stage, vlc_tick_t pts)
+{
+    vlc_tracer_sys_t *sys = opaque;
+
+    if (pts == VLC_TICK_INVALID)
+        return;
+
+    vlc_mutex_lock(&sys->lock);
+    if (sys->origin == VLC_TICK_INVALID)
+        sys->origin = ts;
+
+    struct latency_stream *stream = GetStream(sys, id);
+    if (unlikely(stream == NULL))
+        goto out;
+
+    struct latency_pending *pending = NULL;
+    for (unsigned i = 0; i < LATENCY_PENDING; i++)
+        if (stream->pending[i].pts == pts)
+        {
+            pending = &stream->pending[i];
+            break;
+        }
+
+    if (pending == NULL)
+    {   /* New frame: evict the oldest one */
+        pending = &stream->pending[stream->next];
+        stream->next = (stream->next + 1) % LATENCY_PENDING;
+    }
+    else if (BoundaryEqual(pending->type, pending->stage, type, stage))
+        /* Same frame split in several blocks: keep the first one */
+        goto out;
+    else
+    {
+        struct latency_edge *edge = GetEdge(sys, id, pending, type, stage);
+        if (likely(edge != NULL))
+            EdgeAdd(edge, ts - pending->ts);
+        if (sys->trace != NULL)
+            TraceEvent(sys, id, pending, type, stage, ts);
+    }
+
+    pending->pts = pts;
+    pending->ts = ts;
+    pending->type = type;
+    pending->stage = stage;
+out:
+    vlc_mutex_unlock(&sys->lock);
+}
+
+static void Close(void *opaque)
+{
+    vlc_tracer_sys_t *sys = opaque;
+    struct latency_edge *edge;
+    struct latency_stream *stream;
+
+    vlc_vector_foreach(edge, &sys->edges)
+    {
+        msg_Info(sys->obj, "ES %d %s:%s -> %s:%s: %"PRIu64" frames, "
+                 "mean %.3f ms, p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, "
+                 "max %.3f ms", edge->id, edge->from_type, edge->from_stage,
+                 edge->to_type, edge->to_stage, edge->count,
+                 secf_from_vlc_tick(edge->sum / (vlc_tick_t)edge->count) * 1000.f,
+                 secf_from_vlc_tick(EdgeQuantile(edge, 50)) * 1000.f,
+                 secf_from_vlc_tick(EdgeQuantile(edge, 90)) * 1000.f,
+                 secf_from_vlc_tick(EdgeQuantile(edge, 99)) * 1000.f,
+                 secf_from_vlc_tick(edge->max) * 1000.f);
+        free(edge);
+    }
+    vlc_vector_destroy(&sys->edges);
+
+    vlc_vector_foreach(stream, &sys->streams)
+        free(stream);
+    vlc_vector_destroy(&sys->streams);
+
+    if (sys->trace != NULL)
+    {
+        vlc_mutex_lock(&sys->lock);
+        sys->quit = true;
+        vlc_cond_signal(&sys->wait);
+        vlc_mutex_unlock(&sys->lock);
+        vlc_join(sys->writer, NULL);
+        vlc_vector_destroy(&sys->events);
+        vlc_cond_destroy(&sys->wait);
+
+        fputs("\n]}\n", sys->trace);
+        fclose(sys->trace);
+    }
+    vlc_mutex_destroy(&sys->lock);
+    free(sys);
+}
+
+static const struct vlc_tracer_operations latency_ops =
+{
+    Trace,
+    Close,
+};
+
+static const struct vlc_tracer_operations *Open(vlc_object_t *obj,
+                                                void **restrict sysp)
+{
+    vlc_tracer_sys_t *sys = malloc(sizeof (*sys));
+    if (unlikely(sys == NULL))
+        return NULL;
+
+    sys->obj = obj;
+    sys->trace = NULL;
+    sys->first_event = true;
+    sys->origin = VLC_TICK_INVALID;
+
+    char *path = var_InheritString(obj, "latency-trace-file");
+    if (path != NULL)
+    {
+        sys->trace = vlc_fopen(path, "wt");
+        if (sys->trace == NULL)
+        {
+            msg_Err(obj, "cannot open trace file `%s': %s", path,
+                    vlc_strerror_c(errno));
+            free(path);
+            free(sys);
+            return NULL;
+        }
+        msg_Dbg(obj, "writing trace events to `%s'", path);
+        free(path);
+        fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", sys->trace);
+    }
+
+    vlc_mutex_init(&sys->lock);
+    vlc_vector_init(&sys->streams);
+    vlc_vector_init(&sys->edges);
+
+    if (sys->trace != NULL)
+    {
+        vlc_cond_init(&sys->wait);
+        vlc_vector_init(&sys->events);
+        sys->quit = false;
+
+        if (vlc_clone(&sys->writer, Writer, sys, VLC_THREAD_PRIORITY_LOW))
+        {
+            vlc_cond_destroy(&sys->wait);
+            vlc_mutex_destroy(&sys->lock);
+            fclose(sys->trace);
+            free(sys);
+            return NULL;
+        }
+    }
+
+    *sysp = sys;
+    return &latency_ops;
+}
+
+#define FILE_TEXT N_("Trace file")
+#define FILE_LONGTEXT N_( \
+    "Write the latency of every frame through every pipeline stage to this " \
+    "file, in the Chrome trace event format (chrome://tracing, Perfetto).")
+
+vlc_module_begin()
+    set_shortname(N_("Latency"))
+    set_description(N_("Pipeline latency tracer"))
+    set_category(CAT_ADVANCED)
+    set_subcategory(SUBCAT_ADVANCED_MISC)
+    set_capability("tracer", 0)
+    add_shortcut("latency")
+    set_callbacks(Open, NULL)
+
+    add_savefile("latency-trace-file", NULL, FILE_TEXT, FILE_LONGTEXT)
+vlc_module_end()
@@ -205,6 +205,9 @@ static int vlclua_input_item_stats( lua_State *L )
         STATS_INT( decoded_video )
         STATS_INT( displayed_pictures )
         STATS_INT( lost_pictures )
+        STATS_INT( late_pictures )
+        STATS_INT( display_offset_avg )
+        STATS_INT( display_offset_max )
         STATS_INT( played_abuffers )
         STATS_INT( lost_abuffers )
 #undef STATS_INT
@@ -831,36 +831,33 @@ static block_t *OutputPicture( decoder_t *p_dec )
         }
     }
 
-    /* Gather PPS/SPS if required */
-    block_t *p_xpsnal = NULL;
-    block_t **pp_xpsnal_tail = &p_xpsnal;
+    /* Gather PPS/SPS if required, they are only copied into the AU */
+    const block_t *xpsnal[H264_SPS_ID_MAX + 1 + H264_PPS_ID_MAX];
+    size_t i_xpsnal = 0;
     if( b_need_sps_pps || p_sys->b_new_sps || p_sys->b_new_pps )
     {
         for( int i = 0; i <= H264_SPS_ID_MAX && (b_need_sps_pps || p_sys->b_new_sps); i++ )
         {
             if( p_sys->sps[i].p_block )
-                block_ChainLastAppend( &pp_xpsnal_tail, block_Duplicate( p_sys->sps[i].p_block ) );
+                xpsnal[i_xpsnal++] = p_sys->sps[i].p_block;
         }
         for( int i = 0; i < H264_PPS_ID_MAX && (b_need_sps_pps || p_sys->b_new_pps); i++ )
         {
             if( p_sys->pps[i].p_block )
-                block_ChainLastAppend( &pp_xpsnal_tail, block_Duplicate( p_sys->pps[i].p_block ) );
+                xpsnal[i_xpsnal++] = p_sys->pps[i].p_block;
         }
     }
 
     /* Now rebuild NAL Sequence, inserting PPS/SPS if any */
+    block_t *p_au = NULL;
     if( p_sys->leading.p_head &&
        (p_sys->leading.p_head->i_flags & BLOCK_FLAG_PRIVATE_AUD) )
     {
-        block_t *p_au = p_sys->leading.p_head;
+        p_au = p_sys->leading.p_head;
         p_sys->leading.p_head = p_au->p_next;
         p_au->p_next = NULL;
-        block_ChainLastAppend( &pp_pic_last, p_au );
     }
 
-    if( p_xpsnal )
-        block_ChainLastAppend( &pp_pic_last, p_xpsnal );
-
     if( p_sys->leading.p_head )
         block_ChainLastAppend( &pp_pic_last, p_sys->leading.p_head );
 
@@ -874,7 +871,7 @@ static block_t *OutputPicture( decoder_t *p_dec )
     p_sys->leading.p_head = NULL;
     p_sys->leading.pp_append = &p_sys->leading.p_head;
 
-    p_pic = block_ChainGather( p_pic );
+    p_pic = hxxx_GatherAU( p_au, xpsnal, i_xpsnal, p_pic );
 
     if( !p_pic )
     {
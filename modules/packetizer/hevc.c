@@ -116,7 +116,7 @@ static block_t *ParseNALBlock(decoder_t *, bool *pb_ts_used, block_t *);
 static int PacketizeValidate(void *p_private, block_t *);
 static bool ParseSEICallback( const hxxx_sei_data_t *, void * );
 static block_t *GetCc( decoder_t *, decoder_cc_desc_t * );
-static block_t *GetXPSCopy(decoder_sys_t *);
+static size_t GetXPS(decoder_sys_t *, const block_t **);
 
 #define BLOCK_FLAG_DROP (1 << BLOCK_FLAG_PRIVATE_SHIFT)
 
@@ -133,36 +133,37 @@ static inline void InitQueue( block_t **pp_head, block_t ***ppp_tail )
 
 static block_t * OutputQueues(decoder_sys_t *p_sys, bool b_valid)
 {
+    block_t *p_au = NULL;
     block_t *p_output = NULL;
     block_t **pp_output_last = &p_output;
+    const block_t *xps[HEVC_VPS_ID_MAX + 1 + HEVC_SPS_ID_MAX + 1 + HEVC_PPS_ID_MAX + 1];
+    size_t i_xps = 0;
     uint32_t i_flags = 0; /* Because block_ChainGather does not merge flags or times */
 
     if(p_sys->pre.p_chain)
     {
         i_flags |= p_sys->pre.p_chain->i_flags;
-        if(p_sys->b_recovery_point && p_sys->sets != SENT)
+        if(b_valid && p_sys->b_recovery_point && p_sys->sets != SENT)
         {
             if(p_sys->pre.p_chain->i_buffer >= 5 &&
                hevc_getNALType(&p_sys->pre.p_chain->p_buffer[4]) == HEVC_NAL_AUD)
             {
-                block_t *p_au = p_sys->pre.p_chain;
+                p_au = p_sys->pre.p_chain;
                 p_sys->pre.p_chain = p_sys->pre.p_chain->p_next;
                 p_au->p_next = NULL;
-                block_ChainLastAppend(&pp_output_last, p_au);
             }
-            block_ChainLastAppend(&pp_output_last, GetXPSCopy(p_sys));
+            i_xps = GetXPS(p_sys, xps);
         }
         if(p_sys->pre.p_chain)
             block_ChainLastAppend(&pp_output_last, p_sys->pre.p_chain);
         INITQ(pre);
     }
 
-    if(p_sys->frame.p_chain)
+    const bool b_frame = p_sys->frame.p_chain != NULL;
+    if(b_frame)
     {
         i_flags |= p_sys->frame.p_chain->i_flags;
         block_ChainLastAppend(&pp_output_last, p_sys->frame.p_chain);
-        p_output->i_dts = date_Get(&p_sys->dts);
-        p_output->i_pts = p_sys->pts;
         INITQ(frame);
     }
 
@@ -173,8 +174,25 @@ static block_t * OutputQueues(decoder_sys_t *p_sys, bool b_valid)
         INITQ(post);
     }
 
+    if(!b_valid)
+    {
+        /* Will be dropped, avoid useless gather */
+        if(p_au)
+        {
+            p_au->p_next = p_output;
+            p_output = p_au;
+        }
+    }
+    else
+        p_output = hxxx_GatherAU(p_au, xps, i_xps, p_output);
+
     if(p_output)
     {
+        if(b_frame)
+        {
+            p_output->i_dts = date_Get(&p_sys->dts);
+            p_output->i_pts = p_sys->pts;
+        }
         p_output->i_flags |= i_flags;
         if(!b_valid)
             p_output->i_flags |= BLOCK_FLAG_DROP;
@@ -483,21 +501,18 @@ static bool InsertXPS(decoder_t *p_dec, uint8_t i_nal_type, uint8_t i_id,
     return false;
 }
 
-static block_t *GetXPSCopy(decoder_sys_t *p_sys)
+static size_t GetXPS(decoder_sys_t *p_sys, const block_t **pp_xps)
 {
-    block_t *p_chain = NULL;
-    block_t **pp_append = &p_chain;
-    struct hevc_tuple_s *xpstype[3] = {p_sys->rg_vps, p_sys->rg_sps, p_sys->rg_pps};
-    size_t xpsmax[3] = {HEVC_VPS_ID_MAX, HEVC_SPS_ID_MAX, HEVC_PPS_ID_MAX};
+    size_t i_xps = 0;
+    const struct hevc_tuple_s *xpstype[3] = {p_sys->rg_vps, p_sys->rg_sps, p_sys->rg_pps};
+    const size_t xpsmax[3] = {HEVC_VPS_ID_MAX, HEVC_SPS_ID_MAX, HEVC_PPS_ID_MAX};
     for(size_t i=0; i<3; i++)
-        for(size_t j=0; j<xpsmax[i]; j++)
+        for(size_t j=0; j<=xpsmax[i]; j++)
         {
-            block_t *p_dup;
-            if(xpstype[i]->p_nal &&
-               (p_dup = block_Duplicate(xpstype[i]->p_nal)))
-                block_ChainLastAppend(&pp_append, p_dup);
-        };
-    return p_chain;
+            if(xpstype[i][j].p_nal)
+                pp_xps[i_xps++] = xpstype[i][j].p_nal;
+        }
+    return i_xps;
 }
 
 static bool XPSReady(decoder_sys_t *p_sys)
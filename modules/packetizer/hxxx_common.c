@@ -21,6 +21,8 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_codec.h>
@@ -105,6 +107,148 @@ block_t * cc_storage_get_current( cc_storage_t *p_ccs, decoder_cc_desc_t *p_desc
     return p_block;
 }
 
+/****************************************************************************
+ * Access unit assembly
+ ****************************************************************************/
+static size_t hxxx_ChainSize( const block_t *p_chain, const block_t *p_stop,
+                              vlc_tick_t *pi_length )
+{
+    size_t i_size = 0;
+    for( ; p_chain != p_stop; p_chain = p_chain->p_next )
+    {
+        i_size += p_chain->i_buffer;
+        *pi_length += p_chain->i_length;
+    }
+    return i_size;
+}
+
+static const block_t *hxxx_ChainLargest( const block_t *p_chain,
+                                         const block_t *p_largest )
+{
+    for( ; p_chain; p_chain = p_chain->p_next )
+        if( !p_largest || p_chain->i_buffer > p_largest->i_buffer )
+            p_largest = p_chain;
+    return p_largest;
+}
+
+/* Copies the chain, except the anchor already in place, and releases it.
+ * i_anchor is the size of the anchor before it was grown. */
+static uint8_t *hxxx_ChainMove( uint8_t *p_dst, block_t *p_chain,
+                                const block_t *p_anchor, size_t i_anchor )
+{
+    while( p_chain )
+    {
+        block_t *p_next = p_chain->p_next;
+        if( p_chain != p_anchor )
+        {
+            memcpy( p_dst, p_chain->p_buffer, p_chain->i_buffer );
+            p_dst += p_chain->i_buffer;
+            block_Release( p_chain );
+        }
+        else
+            p_dst += i_anchor;
+        p_chain = p_next;
+    }
+    return p_dst;
+}
+
+block_t *hxxx_GatherAU( block_t *p_head, const block_t *const *pp_xps,
+                        size_t i_xps, block_t *p_tail )
+{
+    if( i_xps == 0 )
+    {
+        if( !p_head )
+            return p_tail ? block_ChainGather( p_tail ) : NULL;
+        if( !p_tail && !p_head->p_next )
+            return p_head; /* Already gathered */
+    }
+
+    /* Properties of the first NAL unit */
+    const block_t *p_first = p_head ? p_head : i_xps ? pp_xps[0] : p_tail;
+    const uint32_t i_flags = p_first->i_flags;
+    const vlc_tick_t i_pts = p_first->i_pts;
+    const vlc_tick_t i_dts = p_first->i_dts;
+
+    /* Pick the NAL unit that could hold the whole access unit */
+    block_t *p_anchor = (block_t *)hxxx_ChainLargest( p_tail,
+                                       hxxx_ChainLargest( p_head, NULL ) );
+
+    vlc_tick_t i_length = 0;
+    size_t i_xps_size = 0;
+    for( size_t i = 0; i < i_xps; i++ )
+    {
+        i_xps_size += pp_xps[i]->i_buffer;
+        i_length += pp_xps[i]->i_length;
+    }
+
+    size_t i_before, i_after;
+    if( p_anchor == NULL ) /* Only parameter sets */
+    {
+        i_before = i_xps_size;
+        i_after = 0;
+    }
+    else
+    {
+        bool b_in_head = false;
+        for( const block_t *p = p_head; p; p = p->p_next )
+            b_in_head |= p == p_anchor;
+
+        if( b_in_head )
+        {
+            i_before = hxxx_ChainSize( p_head, p_anchor, &i_length );
+            i_after = hxxx_ChainSize( p_anchor->p_next, NULL, &i_length )
+                    + i_xps_size + hxxx_ChainSize( p_tail, NULL, &i_length );
+        }
+        else
+        {
+            i_before = hxxx_ChainSize( p_head, NULL, &i_length ) + i_xps_size
+                     + hxxx_ChainSize( p_tail, p_anchor, &i_length );
+            i_after = hxxx_ChainSize( p_anchor->p_next, NULL, &i_length );
+        }
+        i_length += p_anchor->i_length;
+    }
+
+    block_t *p_au;
+    const size_t i_anchor = p_anchor ? p_anchor->i_buffer : 0;
+    if( p_anchor != NULL &&
+        (size_t)(p_anchor->p_buffer - p_anchor->p_start) >= i_before &&
+        (size_t)(p_anchor->p_start + p_anchor->i_size
+               - p_anchor->p_buffer - p_anchor->i_buffer) >= i_after )
+    {
+        /* Enough room: grow the anchor, this neither fails nor moves it */
+        p_au = block_TryRealloc( p_anchor, i_before, i_anchor + i_after );
+        assert( p_au == p_anchor );
+    }
+    else
+    {
+        const size_t i_size = i_before + i_anchor + i_after;
+        p_anchor = NULL;
+        p_au = block_Alloc( i_size );
+        if( unlikely(p_au == NULL) )
+        {
+            block_ChainRelease( p_head );
+            block_ChainRelease( p_tail );
+            return NULL;
+        }
+    }
+
+    uint8_t *p_dst = hxxx_ChainMove( p_au->p_buffer, p_head,
+                                     p_anchor, i_anchor );
+    for( size_t i = 0; i < i_xps; i++ )
+    {
+        memcpy( p_dst, pp_xps[i]->p_buffer, pp_xps[i]->i_buffer );
+        p_dst += pp_xps[i]->i_buffer;
+    }
+    hxxx_ChainMove( p_dst, p_tail, p_anchor, i_anchor );
+
+    p_au->p_next = NULL;
+    p_au->i_flags = i_flags;
+    p_au->i_pts = i_pts;
+    p_au->i_dts = i_dts;
+    p_au->i_length = i_length;
+    return p_au;
+}
+
 /****************************************************************************
  * PacketizeXXC1: Takes VCL blocks of data and creates annexe B type NAL stream
  * Will always use 4 byte 0 0 0 1 startcodes
@@ -37,6 +37,21 @@ block_t * cc_storage_get_current( cc_storage_t *p_ccs, decoder_cc_desc_t * );
 
 /* */
 
+/**
+ * Gathers the NAL units of an access unit into a single block.
+ *
+ * The NAL units are output in order: the p_head chain, the pp_xps parameter
+ * sets, then the p_tail chain. Both chains are consumed, while the parameter
+ * sets remain owned by the caller and are only copied.
+ * The largest NAL unit is grown in place, without copying it, when its
+ * buffer has enough room for the rest of the access unit (e.g. when it still
+ * lies in its demuxed sample).
+ * Like block_ChainGather(), the access unit gets the flags and timestamps of
+ * its first NAL unit and the sum of their lengths.
+ */
+block_t *hxxx_GatherAU( block_t *p_head, const block_t *const *pp_xps,
+                        size_t i_xps, block_t *p_tail );
+
 typedef block_t * (*pf_annexb_nal_packetizer)(decoder_t *, bool *, block_t *);
 block_t *PacketizeXXC1( decoder_t *, uint8_t, block_t **, pf_annexb_nal_packetizer );
 
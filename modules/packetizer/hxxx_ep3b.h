@@ -19,6 +19,7 @@
  * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
  *****************************************************************************/
 #include <vlc_bits.h>
+#include "startcode_helper.h"
 
 static inline uint8_t *hxxx_ep3b_to_rbsp( uint8_t *p, uint8_t *end, unsigned *pi_prev, size_t i_count )
 {
@@ -35,7 +36,7 @@ static inline uint8_t *hxxx_ep3b_to_rbsp( uint8_t *p, uint8_t *end, unsigned *pi
             if( (*pi_prev & 0x06) == 0x06 )
             {
                 ++p;
-                *pi_prev = ((*pi_prev >> 1) << 1) | (!*p);
+                *pi_prev = (*pi_prev << 1) | (!*p);
             }
         }
     }
@@ -81,19 +82,43 @@ static void hxxx_bsfw_ep3b_ctx_init( struct hxxx_bsfw_ep3b_ctx_s *ctx )
     ctx->i_bytesize = 0;
 }
 
-static size_t hxxx_ep3b_total_size( const uint8_t *p, const uint8_t *p_end )
+/* Looks up the next 0x00 0x00 0x03 emulation prevention sequence */
+static inline const uint8_t * hxxx_ep3b_find( const uint8_t *p, const uint8_t *end )
 {
-    /* compute final size */
-    unsigned i_prev = 0;
-    size_t i = 0;
-    while( p < p_end )
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+        return startcode_FindPrefix_AVX2( p, end, 0x03 );
+#endif
+#ifdef STARTCODE_NEON
+    return startcode_FindPrefix_NEON( p, end, 0x03 );
+#else
+    /* Sequences are rare, and memchr() is vectorized by the C library */
+    while( end - p >= 3 )
     {
-        uint8_t *n = hxxx_ep3b_to_rbsp( (uint8_t *)p, (uint8_t *)p_end, &i_prev, 1 );
-        if( n > p )
-            ++i;
-        p = n;
+        const uint8_t *z = memchr( p + 1, 0x00, end - p - 2 );
+        if( z == NULL )
+            break;
+        if( z[-1] == 0x00 && z[1] == 0x03 )
+            return z - 1;
+        p = z;
     }
-    return i;
+    return NULL;
+#endif
+}
+
+static size_t hxxx_ep3b_total_size( const uint8_t *p, const uint8_t *p_end )
+{
+    /* compute final size: as in hxxx_ep3b_to_rbsp(), the first byte never
+     * starts a sequence and the last byte is never stripped */
+    size_t i_size = p_end - p;
+    if( i_size < 5 )
+        return i_size;
+
+    for( p = hxxx_ep3b_find( p + 1, p_end - 1 ); p != NULL;
+         p = hxxx_ep3b_find( p + 3, p_end - 1 ) )
+        i_size--;
+
+    return i_size;
 }
 
 static size_t hxxx_bsfw_byte_forward_ep3b( bs_t *s, size_t i_count )
@@ -25,6 +25,89 @@
 #if !defined(CAN_COMPILE_SSE2) && defined(HAVE_SSE2_INTRINSICS)
    #include <emmintrin.h>
 #endif
+#if defined(HAVE_AVX2_INTRINSICS)
+   #include <immintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+   #define STARTCODE_NEON 1
+   #include <arm_neon.h>
+#endif
+
+/* Looks up for the 3 bytes sequence 0x00 0x00 i_last, as AnnexB startcodes
+ * and emulation prevention sequences, by comparing every possible position
+ * of a whole vector at once. Returns a pointer to the first 0x00. */
+
+#if defined(HAVE_AVX2_INTRINSICS)
+VLC_AVX2
+static inline const uint8_t * startcode_FindPrefix_AVX2( const uint8_t *p, const uint8_t *end,
+                                                         uint8_t i_last )
+{
+    const __m256i zeros = _mm256_setzero_si256();
+    const __m256i last = _mm256_set1_epi8( i_last );
+
+    /* 32 positions, the last one reading up to p[33] */
+    for( ; end - p >= 34; p += 32 )
+    {
+        __m256i v0 = _mm256_loadu_si256( (const __m256i *) p );
+        __m256i v1 = _mm256_loadu_si256( (const __m256i *) (p + 1) );
+        __m256i v2 = _mm256_loadu_si256( (const __m256i *) (p + 2) );
+        __m256i res = _mm256_and_si256( _mm256_cmpeq_epi8( v0, zeros ),
+                                        _mm256_cmpeq_epi8( v1, zeros ) );
+        res = _mm256_and_si256( res, _mm256_cmpeq_epi8( v2, last ) );
+        uint32_t match = _mm256_movemask_epi8( res );
+        if( match )
+            return p + vlc_ctz( match );
+    }
+
+    for( end -= 3; p <= end; p++ ) {
+        if( p[0] == 0 && p[1] == 0 && p[2] == i_last )
+            return p;
+    }
+
+    return NULL;
+}
+
+VLC_AVX2
+static inline const uint8_t * startcode_FindAnnexB_AVX2( const uint8_t *p, const uint8_t *end )
+{
+    return startcode_FindPrefix_AVX2( p, end, 0x01 );
+}
+#endif
+
+#ifdef STARTCODE_NEON
+static inline const uint8_t * startcode_FindPrefix_NEON( const uint8_t *p, const uint8_t *end,
+                                                         uint8_t i_last )
+{
+    const uint8x16_t last = vdupq_n_u8( i_last );
+
+    /* 16 positions, the last one reading up to p[17] */
+    for( ; end - p >= 18; p += 16 )
+    {
+        uint8x16_t res = vandq_u8( vceqzq_u8( vld1q_u8( p ) ),
+                                   vceqzq_u8( vld1q_u8( p + 1 ) ) );
+        res = vandq_u8( res, vceqq_u8( vld1q_u8( p + 2 ), last ) );
+        if( vmaxvq_u8( res ) )
+        {
+            /* Narrow the byte mask to 4 bits per position */
+            uint8x8_t nibbles = vshrn_n_u16( vreinterpretq_u16_u8( res ), 4 );
+            uint64_t match = vget_lane_u64( vreinterpret_u64_u8( nibbles ), 0 );
+            return p + vlc_ctzll( match ) / 4;
+        }
+    }
+
+    for( end -= 3; p <= end; p++ ) {
+        if( p[0] == 0 && p[1] == 0 && p[2] == i_last )
+            return p;
+    }
+
+    return NULL;
+}
+
+static inline const uint8_t * startcode_FindAnnexB_NEON( const uint8_t *p, const uint8_t *end )
+{
+    return startcode_FindPrefix_NEON( p, end, 0x01 );
+}
+#endif
 
 /* Looks up efficiently for an AnnexB startcode 0x00 0x00 0x01
  * by using a 4 times faster trick than single byte lookup. */
@@ -57,7 +140,8 @@ static inline const uint8_t * startcode_FindAnnexB_SSE2( const uint8_t *p, const
             return p;
     }
 
-    if( p == end )
+    /* end is the last position a startcode can start at */
+    if( p > end )
         return NULL;
 
     alignedend = end - ((intptr_t) end & 15);
@@ -143,11 +227,17 @@ static inline const uint8_t * startcode_FindAnnexB_Bits( const uint8_t *p, const
 #if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
 static inline const uint8_t * startcode_FindAnnexB( const uint8_t *p, const uint8_t *end )
 {
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (vlc_CPU_AVX2())
+        return startcode_FindAnnexB_AVX2(p, end);
+#endif
     if (vlc_CPU_SSE2())
         return startcode_FindAnnexB_SSE2(p, end);
     else
         return startcode_FindAnnexB_Bits(p, end);
 }
+#elif defined(STARTCODE_NEON)
+    #define startcode_FindAnnexB startcode_FindAnnexB_NEON
 #else
     #define startcode_FindAnnexB startcode_FindAnnexB_Bits
 #endif
@@ -69,6 +69,10 @@
 #include "platform_fonts.h"
 #include "freetype.h"
 #include "text_layout.h"
+#include "glyph_cache.h"
+
+/* Upper bound of the memory used by cached glyphs and shaped runs */
+#define FREETYPE_CACHE_SIZE (4 * 1024 * 1024)
 
 /*****************************************************************************
  * Module descriptor
@@ -1391,6 +1395,7 @@ static int Render( filter_t *p_filter, subpicture_region_t *p_region_out,
     }
 
     FreeLines( text_block.p_laid );
+    GlyphCacheTrim( p_sys->p_glyph_cache );
 
     free( text_block.p_uchars );
     FreeStylesArray( text_block.pp_styles, text_block.i_count );
@@ -1437,6 +1442,8 @@ static int Create( vlc_object_t *p_this )
         p_sys->p_stroker = NULL;
     }
 
+    p_sys->p_glyph_cache = GlyphCacheNew( FREETYPE_CACHE_SIZE );
+
     /* Dictionnaries for fonts and families */
     vlc_dictionary_init( &p_sys->face_map, 50 );
     vlc_dictionary_init( &p_sys->family_map, 50 );
@@ -1566,6 +1573,9 @@ static void Destroy( vlc_object_t *p_this )
     text_style_Delete( p_sys->p_default_style );
     text_style_Delete( p_sys->p_forced_style );
 
+    /* Cached glyphs reference the faces */
+    GlyphCacheDelete( p_sys->p_glyph_cache );
+
     /* Fonts dicts */
     vlc_dictionary_clear( &p_sys->fallback_map, FreeFamilies, p_filter );
     vlc_dictionary_clear( &p_sys->face_map, FreeFace, p_filter );
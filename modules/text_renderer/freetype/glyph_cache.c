@@ -0,0 +1,446 @@
+/*****************************************************************************
+ * glyph_cache.c : Glyph and shaped run cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** \ingroup freetype_cache
+ * @{
+ * \file
+ * Glyph and shaped run cache
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_list.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glyph_cache.h"
+
+/* Must be a power of 2 */
+#define GLYPH_CACHE_BUCKETS 1024
+
+enum
+{
+    CACHE_NODE_GLYPH,
+    CACHE_NODE_RUN,
+};
+
+typedef struct cache_node_t cache_node_t;
+struct cache_node_t
+{
+    struct vlc_list  lru;           /**< least recently used first */
+    cache_node_t    *p_hash_next;
+    uint32_t         i_hash;
+    int              i_type;
+    size_t           i_size;        /**< accounted memory */
+};
+
+/**
+ * Bitmap of a glyph (or of its outline) rendered at a subpixel position,
+ * with an integer origin
+ */
+typedef struct glyph_bitmap_t glyph_bitmap_t;
+struct glyph_bitmap_t
+{
+    glyph_bitmap_t *p_next;
+    bool            b_outline;
+    FT_Pos          i_phase_x;
+    FT_Pos          i_phase_y;
+    FT_Glyph        p_bitmap;
+};
+
+struct glyph_cache_entry_t
+{
+    cache_node_t      node;
+    glyph_cache_key_t key;
+    FT_Glyph          p_glyph;
+    FT_Glyph          p_outline;
+    FT_Vector         advance;
+    glyph_bitmap_t   *p_bitmaps;
+};
+
+typedef struct
+{
+    cache_node_t    node;
+    FT_Face         p_face;
+    int             i_script;
+    int             i_direction;
+    size_t          i_text;
+    unsigned        i_count;
+    uni_char_t     *p_text;
+    shaped_glyph_t  p_glyphs[];
+} shaped_run_entry_t;
+
+struct glyph_cache_t
+{
+    size_t          i_size;
+    size_t          i_max_size;
+    struct vlc_list lru;
+    cache_node_t   *pp_buckets[GLYPH_CACHE_BUCKETS];
+};
+
+static uint32_t Hash( uint32_t i_hash, const void *p_data, size_t i_data )
+{
+    /* FNV-1a */
+    const uint8_t *p = p_data;
+    for( size_t i = 0; i < i_data; i++ )
+        i_hash = ( i_hash ^ p[i] ) * 16777619;
+    return i_hash;
+}
+
+static uint32_t HashGlyph( const glyph_cache_key_t *p_key )
+{
+    uint32_t i_hash = 2166136261;
+    i_hash = Hash( i_hash, &p_key->p_face, sizeof( p_key->p_face ) );
+    i_hash = Hash( i_hash, &p_key->i_glyph_index, sizeof( p_key->i_glyph_index ) );
+    i_hash = Hash( i_hash, &p_key->i_flags, sizeof( p_key->i_flags ) );
+    return Hash( i_hash, &p_key->i_radius, sizeof( p_key->i_radius ) );
+}
+
+static uint32_t HashRun( FT_Face p_face, int i_script, int i_direction,
+                         const uni_char_t *p_text, size_t i_text )
+{
+    uint32_t i_hash = 2166136261;
+    i_hash = Hash( i_hash, &p_face, sizeof( p_face ) );
+    i_hash = Hash( i_hash, &i_script, sizeof( i_script ) );
+    i_hash = Hash( i_hash, &i_direction, sizeof( i_direction ) );
+    return Hash( i_hash, p_text, i_text * sizeof( *p_text ) );
+}
+
+static size_t GlyphSize( FT_Glyph p_glyph )
+{
+    if( !p_glyph )
+        return 0;
+
+    if( p_glyph->format == FT_GLYPH_FORMAT_BITMAP )
+    {
+        const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph) p_glyph)->bitmap;
+        return sizeof( FT_BitmapGlyphRec ) + p_bitmap->rows * abs( p_bitmap->pitch );
+    }
+    if( p_glyph->format == FT_GLYPH_FORMAT_OUTLINE )
+    {
+        const FT_Outline *p_outline = &((FT_OutlineGlyph) p_glyph)->outline;
+        return sizeof( FT_OutlineGlyphRec )
+             + p_outline->n_points * ( sizeof( FT_Vector ) + 1 )
+             + p_outline->n_contours * sizeof( short );
+    }
+    return sizeof( FT_GlyphRec );
+}
+
+static void Insert( glyph_cache_t *p_cache, cache_node_t *p_node )
+{
+    cache_node_t **pp_bucket =
+        &p_cache->pp_buckets[ p_node->i_hash & ( GLYPH_CACHE_BUCKETS - 1 ) ];
+
+    p_node->p_hash_next = *pp_bucket;
+    *pp_bucket = p_node;
+    vlc_list_append( &p_node->lru, &p_cache->lru );
+    p_cache->i_size += p_node->i_size;
+}
+
+static void Touch( glyph_cache_t *p_cache, cache_node_t *p_node )
+{
+    vlc_list_remove( &p_node->lru );
+    vlc_list_append( &p_node->lru, &p_cache->lru );
+}
+
+static void FreeNode( cache_node_t *p_node )
+{
+    if( p_node->i_type == CACHE_NODE_GLYPH )
+    {
+        glyph_cache_entry_t *p_entry = (glyph_cache_entry_t *) p_node;
+
+        for( glyph_bitmap_t *p_bitmap = p_entry->p_bitmaps; p_bitmap; )
+        {
+            glyph_bitmap_t *p_next = p_bitmap->p_next;
+            FT_Done_Glyph( p_bitmap->p_bitmap );
+            free( p_bitmap );
+            p_bitmap = p_next;
+        }
+        FT_Done_Glyph( p_entry->p_glyph );
+        if( p_entry->p_outline )
+            FT_Done_Glyph( p_entry->p_outline );
+    }
+    free( p_node );
+}
+
+static void Remove( glyph_cache_t *p_cache, cache_node_t *p_node )
+{
+    cache_node_t **pp_node =
+        &p_cache->pp_buckets[ p_node->i_hash & ( GLYPH_CACHE_BUCKETS - 1 ) ];
+
+    while( *pp_node != p_node )
+        pp_node = &(*pp_node)->p_hash_next;
+    *pp_node = p_node->p_hash_next;
+
+    vlc_list_remove( &p_node->lru );
+    p_cache->i_size -= p_node->i_size;
+    FreeNode( p_node );
+}
+
+glyph_cache_t *GlyphCacheNew( size_t i_max_size )
+{
+    glyph_cache_t *p_cache = calloc( 1, sizeof( *p_cache ) );
+    if( !p_cache )
+        return NULL;
+
+    p_cache->i_max_size = i_max_size;
+    vlc_list_init( &p_cache->lru );
+    return p_cache;
+}
+
+void GlyphCacheDelete( glyph_cache_t *p_cache )
+{
+    if( !p_cache )
+        return;
+
+    cache_node_t *p_node;
+    vlc_list_foreach( p_node, &p_cache->lru, lru )
+        FreeNode( p_node );
+    free( p_cache );
+}
+
+void GlyphCacheTrim( glyph_cache_t *p_cache )
+{
+    if( !p_cache )
+        return;
+
+    while( p_cache->i_size > p_cache->i_max_size )
+    {
+        cache_node_t *p_node =
+            vlc_list_first_entry_or_null( &p_cache->lru, cache_node_t, lru );
+        assert( p_node );
+        Remove( p_cache, p_node );
+    }
+}
+
+glyph_cache_entry_t *GlyphCacheGet( glyph_cache_t *p_cache,
+                                    const glyph_cache_key_t *p_key,
+                                    FT_Glyph *pp_glyph, FT_Glyph *pp_outline,
+                                    FT_Vector *p_advance )
+{
+    if( !p_cache )
+        return NULL;
+
+    const uint32_t i_hash = HashGlyph( p_key );
+    glyph_cache_entry_t *p_entry = NULL;
+
+    for( cache_node_t *p_node =
+            p_cache->pp_buckets[ i_hash & ( GLYPH_CACHE_BUCKETS - 1 ) ];
+         p_node; p_node = p_node->p_hash_next )
+    {
+        glyph_cache_entry_t *p_cur = (glyph_cache_entry_t *) p_node;
+        if( p_node->i_hash == i_hash && p_node->i_type == CACHE_NODE_GLYPH
+         && p_cur->key.p_face == p_key->p_face
+         && p_cur->key.i_glyph_index == p_key->i_glyph_index
+         && p_cur->key.i_flags == p_key->i_flags
+         && p_cur->key.i_radius == p_key->i_radius )
+        {
+            p_entry = p_cur;
+            break;
+        }
+    }
+    if( !p_entry )
+        return NULL;
+
+    FT_Glyph p_glyph, p_outline = NULL;
+    if( FT_Glyph_Copy( p_entry->p_glyph, &p_glyph ) )
+        return NULL;
+    if( p_entry->p_outline && FT_Glyph_Copy( p_entry->p_outline, &p_outline ) )
+    {
+        FT_Done_Glyph( p_glyph );
+        return NULL;
+    }
+
+    Touch( p_cache, &p_entry->node );
+    *pp_glyph = p_glyph;
+    *pp_outline = p_outline;
+    *p_advance = p_entry->advance;
+    return p_entry;
+}
+
+glyph_cache_entry_t *GlyphCacheAdd( glyph_cache_t *p_cache,
+                                    const glyph_cache_key_t *p_key,
+                                    FT_Glyph p_glyph, FT_Glyph p_outline,
+                                    const FT_Vector *p_advance )
+{
+    if( !p_cache )
+        return NULL;
+
+    glyph_cache_entry_t *p_entry = malloc( sizeof( *p_entry ) );
+    if( !p_entry )
+        return NULL;
+
+    p_entry->p_outline = NULL;
+    if( FT_Glyph_Copy( p_glyph, &p_entry->p_glyph ) )
+    {
+        free( p_entry );
+        return NULL;
+    }
+    if( p_outline && FT_Glyph_Copy( p_outline, &p_entry->p_outline ) )
+    {
+        FT_Done_Glyph( p_entry->p_glyph );
+        free( p_entry );
+        return NULL;
+    }
+
+    p_entry->key = *p_key;
+    p_entry->advance = *p_advance;
+    p_entry->p_bitmaps = NULL;
+    p_entry->node.i_hash = HashGlyph( p_key );
+    p_entry->node.i_type = CACHE_NODE_GLYPH;
+    p_entry->node.i_size = sizeof( *p_entry ) + GlyphSize( p_entry->p_glyph )
+                         + GlyphSize( p_entry->p_outline );
+    Insert( p_cache, &p_entry->node );
+    return p_entry;
+}
+
+FT_Error GlyphCacheToBitmap( glyph_cache_t *p_cache,
+                             glyph_cache_entry_t *p_entry, bool b_outline,
+                             FT_Glyph *pp_glyph, const FT_Vector *p_origin,
+                             bool b_destroy )
+{
+    FT_Vector origin = *p_origin;
+
+    /* Bitmap fonts ignore the origin */
+    if( !p_cache || !p_entry || (*pp_glyph)->format != FT_GLYPH_FORMAT_OUTLINE )
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   &origin, b_destroy );
+
+    /* Only the subpixel part of the origin changes the rendering */
+    FT_Vector phase = { .x = origin.x & 63, .y = origin.y & 63 };
+    const FT_Int i_shift_x = ( origin.x - phase.x ) / 64;
+    const FT_Int i_shift_y = ( origin.y - phase.y ) / 64;
+
+    glyph_bitmap_t *p_bitmap = p_entry->p_bitmaps;
+    while( p_bitmap && ( p_bitmap->b_outline != b_outline
+                      || p_bitmap->i_phase_x != phase.x
+                      || p_bitmap->i_phase_y != phase.y ) )
+        p_bitmap = p_bitmap->p_next;
+
+    if( !p_bitmap )
+    {
+        FT_Glyph p_rendered = *pp_glyph;
+        FT_Error i_error = FT_Glyph_To_Bitmap( &p_rendered, FT_RENDER_MODE_NORMAL,
+                                               &phase, 0 );
+        if( i_error )
+            return i_error;
+
+        p_bitmap = malloc( sizeof( *p_bitmap ) );
+        if( !p_bitmap )
+        {
+            FT_Done_Glyph( p_rendered );
+            return FT_Err_Out_Of_Memory;
+        }
+        p_bitmap->b_outline = b_outline;
+        p_bitmap->i_phase_x = phase.x;
+        p_bitmap->i_phase_y = phase.y;
+        p_bitmap->p_bitmap = p_rendered;
+        p_bitmap->p_next = p_entry->p_bitmaps;
+        p_entry->p_bitmaps = p_bitmap;
+
+        const size_t i_size = sizeof( *p_bitmap ) + GlyphSize( p_rendered );
+        p_entry->node.i_size += i_size;
+        p_cache->i_size += i_size;
+    }
+
+    FT_Glyph p_copy;
+    FT_Error i_error = FT_Glyph_Copy( p_bitmap->p_bitmap, &p_copy );
+    if( i_error )
+        return i_error;
+
+    ((FT_BitmapGlyph) p_copy)->left += i_shift_x;
+    ((FT_BitmapGlyph) p_copy)->top  += i_shift_y;
+
+    if( b_destroy )
+        FT_Done_Glyph( *pp_glyph );
+    *pp_glyph = p_copy;
+    return 0;
+}
+
+const shaped_glyph_t *GlyphCacheGetRun( glyph_cache_t *p_cache, FT_Face p_face,
+                                        int i_script, int i_direction,
+                                        const uni_char_t *p_text, size_t i_text,
+                                        unsigned *pi_count )
+{
+    if( !p_cache )
+        return NULL;
+
+    const uint32_t i_hash = HashRun( p_face, i_script, i_direction,
+                                     p_text, i_text );
+
+    for( cache_node_t *p_node =
+            p_cache->pp_buckets[ i_hash & ( GLYPH_CACHE_BUCKETS - 1 ) ];
+         p_node; p_node = p_node->p_hash_next )
+    {
+        shaped_run_entry_t *p_run = (shaped_run_entry_t *) p_node;
+        if( p_node->i_hash == i_hash && p_node->i_type == CACHE_NODE_RUN
+         && p_run->p_face == p_face
+         && p_run->i_script == i_script
+         && p_run->i_direction == i_direction
+         && p_run->i_text == i_text
+         && !memcmp( p_run->p_text, p_text, i_text * sizeof( *p_text ) ) )
+        {
+            Touch( p_cache, p_node );
+            *pi_count = p_run->i_count;
+            return p_run->p_glyphs;
+        }
+    }
+    return NULL;
+}
+
+const shaped_glyph_t *GlyphCacheAddRun( glyph_cache_t *p_cache, FT_Face p_face,
+                                        int i_script, int i_direction,
+                                        const uni_char_t *p_text, size_t i_text,
+                                        const shaped_glyph_t *p_glyphs,
+                                        unsigned i_count )
+{
+    if( !p_cache )
+        return NULL;
+
+    const size_t i_size = sizeof( shaped_run_entry_t )
+                        + i_count * sizeof( *p_glyphs )
+                        + i_text * sizeof( *p_text );
+    shaped_run_entry_t *p_run = malloc( i_size );
+    if( !p_run )
+        return NULL;
+
+    p_run->p_face = p_face;
+    p_run->i_script = i_script;
+    p_run->i_direction = i_direction;
+    p_run->i_count = i_count;
+    memcpy( p_run->p_glyphs, p_glyphs, i_count * sizeof( *p_glyphs ) );
+    p_run->i_text = i_text;
+    p_run->p_text = (uni_char_t *) &p_run->p_glyphs[ i_count ];
+    memcpy( p_run->p_text, p_text, i_text * sizeof( *p_text ) );
+
+    p_run->node.i_hash = HashRun( p_face, i_script, i_direction,
+                                  p_text, i_text );
+    p_run->node.i_type = CACHE_NODE_RUN;
+    p_run->node.i_size = i_size;
+    Insert( p_cache, &p_run->node );
+    return p_run->p_glyphs;
+}
+
+/** @} */
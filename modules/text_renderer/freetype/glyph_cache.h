@@ -0,0 +1,132 @@
+/*****************************************************************************
+ * glyph_cache.h : Glyph and shaped run cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FREETYPE_GLYPH_CACHE_H
+#define VLC_FREETYPE_GLYPH_CACHE_H
+
+/** \defgroup freetype_cache Freetype glyph cache
+ * \ingroup freetype
+ * Glyphs and shaped runs kept across renderings.
+ *
+ * Subtitles and overlays keep rendering the same glyphs with the same faces
+ * and styles, so the loaded outlines, their strokes, and their bitmaps at
+ * each subpixel position are kept, as well as the result of shaping runs of
+ * text. The cache memory is bounded, least recently used entries are evicted
+ * by GlyphCacheTrim().
+ *
+ * Entries can only be evicted by GlyphCacheTrim(), so the entries returned
+ * by the cache stay valid until then.
+ * @{
+ * \file
+ */
+
+#include "freetype.h"
+
+/* Synthetic styles applied to the loaded glyph */
+#define GLYPH_CACHE_BOLD    0x1
+#define GLYPH_CACHE_ITALIC  0x2
+
+typedef struct glyph_cache_t glyph_cache_t;
+typedef struct glyph_cache_entry_t glyph_cache_entry_t;
+
+typedef struct
+{
+    FT_Face  p_face;        /**< sized face */
+    FT_UInt  i_glyph_index;
+    int      i_flags;       /**< GLYPH_CACHE_* synthetic styles */
+    FT_Fixed i_radius;      /**< outline stroker radius, 0 without outline */
+} glyph_cache_key_t;
+
+/** Glyph of a shaped run, offsets and advances are 26.6 values */
+typedef struct
+{
+    FT_UInt  i_glyph_index;
+    unsigned i_cluster;
+    FT_Pos   i_x_offset;
+    FT_Pos   i_y_offset;
+    FT_Pos   i_x_advance;
+    FT_Pos   i_y_advance;
+} shaped_glyph_t;
+
+glyph_cache_t *GlyphCacheNew( size_t i_max_size );
+void GlyphCacheDelete( glyph_cache_t *p_cache );
+
+/**
+ * Evicts the least recently used entries until the cache fits its size.
+ */
+void GlyphCacheTrim( glyph_cache_t *p_cache );
+
+/**
+ * Gets copies of the loaded glyph, its outline and its advance.
+ *
+ * \return the entry of the glyph, or NULL if it is not cached
+ */
+glyph_cache_entry_t *GlyphCacheGet( glyph_cache_t *p_cache,
+                                    const glyph_cache_key_t *p_key,
+                                    FT_Glyph *pp_glyph, FT_Glyph *pp_outline,
+                                    FT_Vector *p_advance );
+
+/**
+ * Caches copies of a loaded glyph and its outline (which can be NULL).
+ *
+ * \return the entry of the glyph, or NULL on error
+ */
+glyph_cache_entry_t *GlyphCacheAdd( glyph_cache_t *p_cache,
+                                    const glyph_cache_key_t *p_key,
+                                    FT_Glyph p_glyph, FT_Glyph p_outline,
+                                    const FT_Vector *p_advance );
+
+/**
+ * Equivalent of FT_Glyph_To_Bitmap() with FT_RENDER_MODE_NORMAL for the
+ * glyph or the outline of a cache entry, rendering each subpixel position
+ * only once.
+ *
+ * \param p_entry entry of the glyph, or NULL to render without caching
+ * \param b_outline whether *pp_glyph is the outline of the entry
+ */
+FT_Error GlyphCacheToBitmap( glyph_cache_t *p_cache,
+                             glyph_cache_entry_t *p_entry, bool b_outline,
+                             FT_Glyph *pp_glyph, const FT_Vector *p_origin,
+                             bool b_destroy );
+
+/**
+ * Gets a shaped run of text.
+ *
+ * \return the glyphs of the run, or NULL if it is not cached
+ */
+const shaped_glyph_t *GlyphCacheGetRun( glyph_cache_t *p_cache, FT_Face p_face,
+                                        int i_script, int i_direction,
+                                        const uni_char_t *p_text, size_t i_text,
+                                        unsigned *pi_count );
+
+/**
+ * Caches a shaped run of text.
+ *
+ * \return the cached glyphs of the run, or NULL on error
+ */
+const shaped_glyph_t *GlyphCacheAddRun( glyph_cache_t *p_cache, FT_Face p_face,
+                                        int i_script, int i_direction,
+                                        const uni_char_t *p_text, size_t i_text,
+                                        const shaped_glyph_t *p_glyphs,
+                                        unsigned i_count );
+
+/** @} */
+
+#endif
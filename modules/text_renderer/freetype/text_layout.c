@@ -64,6 +64,7 @@
 #include "freetype.h"
 #include "text_layout.h"
 #include "platform_fonts.h"
+#include "glyph_cache.h"
 
 #include <stdlib.h>
 
@@ -109,8 +110,8 @@ typedef struct run_desc_t
     hb_direction_t              direction;
     hb_font_t                  *p_hb_font;
     hb_buffer_t                *p_buffer;
-    hb_glyph_info_t            *p_glyph_infos;
-    hb_glyph_position_t        *p_glyph_positions;
+    const shaped_glyph_t       *p_glyphs;   /**< cached or p_shaped */
+    shaped_glyph_t             *p_shaped;
     unsigned int                i_glyph_count;
 #endif
 
@@ -124,6 +125,7 @@ typedef struct glyph_bitmaps_t
     FT_Glyph p_glyph;
     FT_Glyph p_outline;
     FT_Glyph p_shadow;
+    glyph_cache_entry_t *p_cache;   /**< cache entry of the loaded glyph */
     FT_BBox  glyph_bbox;
     FT_BBox  outline_bbox;
     FT_BBox  shadow_bbox;
@@ -785,6 +787,20 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         else
             p_face = p_run->p_face;
 
+        const uni_char_t *p_text =
+            p_paragraph->p_code_points + p_run->i_start_offset;
+        const size_t i_text = p_run->i_end_offset - p_run->i_start_offset;
+
+        p_run->p_glyphs = GlyphCacheGetRun( p_sys->p_glyph_cache, p_face,
+                                            p_run->script, p_run->direction,
+                                            p_text, i_text,
+                                            &p_run->i_glyph_count );
+        if( p_run->p_glyphs )
+        {
+            i_total_glyphs += p_run->i_glyph_count;
+            continue;
+        }
+
         p_run->p_hb_font = hb_ft_font_create( p_face, 0 );
         if( !p_run->p_hb_font )
         {
@@ -804,20 +820,14 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         hb_buffer_set_direction( p_run->p_buffer, p_run->direction );
         hb_buffer_set_script( p_run->p_buffer, p_run->script );
 #ifdef __OS2__
-        hb_buffer_add_utf16( p_run->p_buffer,
-                             p_paragraph->p_code_points + p_run->i_start_offset,
-                             p_run->i_end_offset - p_run->i_start_offset, 0,
-                             p_run->i_end_offset - p_run->i_start_offset );
+        hb_buffer_add_utf16( p_run->p_buffer, p_text, i_text, 0, i_text );
 #else
-        hb_buffer_add_utf32( p_run->p_buffer,
-                             p_paragraph->p_code_points + p_run->i_start_offset,
-                             p_run->i_end_offset - p_run->i_start_offset, 0,
-                             p_run->i_end_offset - p_run->i_start_offset );
+        hb_buffer_add_utf32( p_run->p_buffer, p_text, i_text, 0, i_text );
 #endif
         hb_shape( p_run->p_hb_font, p_run->p_buffer, 0, 0 );
-        p_run->p_glyph_infos =
+        hb_glyph_info_t *p_infos =
             hb_buffer_get_glyph_infos( p_run->p_buffer, &p_run->i_glyph_count );
-        p_run->p_glyph_positions =
+        hb_glyph_position_t *p_positions =
             hb_buffer_get_glyph_positions( p_run->p_buffer, &p_run->i_glyph_count );
 
         if( p_run->i_glyph_count <= 0 )
@@ -827,6 +837,28 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             goto error;
         }
 
+        p_run->p_shaped = vlc_alloc( p_run->i_glyph_count,
+                                     sizeof( *p_run->p_shaped ) );
+        if( !p_run->p_shaped )
+        {
+            i_ret = VLC_ENOMEM;
+            goto error;
+        }
+        for( unsigned int j = 0; j < p_run->i_glyph_count; ++j )
+        {
+            p_run->p_shaped[ j ].i_glyph_index = p_infos[ j ].codepoint;
+            p_run->p_shaped[ j ].i_cluster = p_infos[ j ].cluster;
+            p_run->p_shaped[ j ].i_x_offset = p_positions[ j ].x_offset;
+            p_run->p_shaped[ j ].i_y_offset = p_positions[ j ].y_offset;
+            p_run->p_shaped[ j ].i_x_advance = p_positions[ j ].x_advance;
+            p_run->p_shaped[ j ].i_y_advance = p_positions[ j ].y_advance;
+        }
+        p_run->p_glyphs = p_run->p_shaped;
+
+        GlyphCacheAddRun( p_sys->p_glyph_cache, p_face,
+                          p_run->script, p_run->direction, p_text, i_text,
+                          p_run->p_shaped, p_run->i_glyph_count );
+
         i_total_glyphs += p_run->i_glyph_count;
     }
 
@@ -850,8 +882,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
         run_desc_t *p_run = p_paragraph->p_runs + i;
-        hb_glyph_info_t *p_infos = p_run->p_glyph_infos;
-        hb_glyph_position_t *p_positions = p_run->p_glyph_positions;
+        const shaped_glyph_t *p_glyphs = p_run->p_glyphs;
         for( unsigned int j = 0; j < p_run->i_glyph_count; ++j )
         {
             /*
@@ -864,11 +895,11 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             int i_run_index = p_run->direction == HB_DIRECTION_LTR ?
                     j : p_run->i_glyph_count - 1 - j;
             int i_source_index =
-                    p_infos[ i_run_index ].cluster + p_run->i_start_offset;
+                    p_glyphs[ i_run_index ].i_cluster + p_run->i_start_offset;
 
             p_new_paragraph->p_code_points[ i_index ] = 0;
             p_new_paragraph->pi_glyph_indices[ i_index ] =
-                p_infos[ i_run_index ].codepoint;
+                p_glyphs[ i_run_index ].i_glyph_index;
             p_new_paragraph->p_scripts[ i_index ] =
                 p_paragraph->p_scripts[ i_source_index ];
             p_new_paragraph->p_types[ i_index ] =
@@ -883,13 +914,13 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             p_new_paragraph->pi_karaoke_bar[ i_index ] =
                 p_paragraph->pi_karaoke_bar[ i_source_index ];
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_x_offset =
-                p_positions[ i_run_index ].x_offset;
+                p_glyphs[ i_run_index ].i_x_offset;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_y_offset =
-                p_positions[ i_run_index ].y_offset;
+                p_glyphs[ i_run_index ].i_y_offset;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_x_advance =
-                p_positions[ i_run_index ].x_advance;
+                p_glyphs[ i_run_index ].i_x_advance;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_y_advance =
-                p_positions[ i_run_index ].y_advance;
+                p_glyphs[ i_run_index ].i_y_advance;
 
             ++i_index;
         }
@@ -900,8 +931,11 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
 
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
-        hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
-        hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        if( p_paragraph->p_runs[ i ].p_hb_font )
+            hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
+        if( p_paragraph->p_runs[ i ].p_buffer )
+            hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        free( p_paragraph->p_runs[ i ].p_shaped );
     }
     FreeParagraph( *p_old_paragraph );
     *p_old_paragraph = p_new_paragraph;
@@ -915,6 +949,7 @@ error:
             hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
         if( p_paragraph->p_runs[ i ].p_buffer )
             hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
+        free( p_paragraph->p_runs[ i ].p_shaped );
     }
 
     if( p_new_paragraph )
@@ -1056,6 +1091,8 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        glyph_cache_key_t key = { .p_face = p_face };
+
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
@@ -1066,8 +1103,16 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
                             FT_STROKER_LINEJOIN_ROUND, 0 );
+            key.i_radius = i_radius;
         }
 
+        if( ( p_style->i_style_flags & STYLE_BOLD )
+              && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+            key.i_flags |= GLYPH_CACHE_BOLD;
+        if( ( p_style->i_style_flags & STYLE_ITALIC )
+              && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+            key.i_flags |= GLYPH_CACHE_ITALIC;
+
         for( int j = p_run->i_start_offset; j < p_run->i_end_offset; ++j )
         {
             int i_glyph_index;
@@ -1084,6 +1129,7 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         p_bitmaps->p_glyph = 0; \
         p_bitmaps->p_outline = 0; \
         p_bitmaps->p_shadow = 0; \
+        p_bitmaps->p_cache = NULL; \
         p_bitmaps->i_x_advance = 0; \
         p_bitmaps->i_y_advance = 0; \
         continue; \
@@ -1118,39 +1164,55 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
+            key.i_glyph_index = i_glyph_index;
 
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+            FT_Vector advance;
+            p_bitmaps->p_cache = GlyphCacheGet( p_sys->p_glyph_cache, &key,
+                                                &p_bitmaps->p_glyph,
+                                                &p_bitmaps->p_outline,
+                                                &advance );
+            if( !p_bitmaps->p_cache )
+            {
+                if( FT_Load_Glyph( p_face, i_glyph_index,
+                                   FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+                 && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
-                SKIP_GLYPH( p_bitmaps )
+                if( key.i_flags & GLYPH_CACHE_BOLD )
+                    FT_GlyphSlot_Embolden( p_face->glyph );
+                if( key.i_flags & GLYPH_CACHE_ITALIC )
+                    FT_GlyphSlot_Oblique( p_face->glyph );
 
-#undef SKIP_GLYPH
+                if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-            if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
-            {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
+                p_bitmaps->p_outline = 0;
+                if( key.i_radius )
+                {
+                    p_bitmaps->p_outline = p_bitmaps->p_glyph;
+                    if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
+                                               p_sys->p_stroker, 0, 0 ) )
+                        p_bitmaps->p_outline = 0;
+                }
+
+                advance = p_face->glyph->advance;
+                p_bitmaps->p_cache = GlyphCacheAdd( p_sys->p_glyph_cache, &key,
+                                                    p_bitmaps->p_glyph,
+                                                    p_bitmaps->p_outline,
+                                                    &advance );
             }
 
+#undef SKIP_GLYPH
+
+            p_bitmaps->p_shadow = 0;
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
                                       p_bitmaps->p_outline : p_bitmaps->p_glyph;
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
 
             unsigned i_x_advance = FT_FLOOR( abs( p_bitmaps->i_x_advance ) );
@@ -1257,8 +1319,9 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            if( GlyphCacheToBitmap( p_sys->p_glyph_cache, p_bitmaps->p_cache,
+                                    p_bitmaps->p_shadow == p_bitmaps->p_outline,
+                                    &p_bitmaps->p_shadow, &pen_shadow, false ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1266,8 +1329,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( GlyphCacheToBitmap( p_sys->p_glyph_cache, p_bitmaps->p_cache,
+                                    false, &p_bitmaps->p_glyph, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1282,8 +1345,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( GlyphCacheToBitmap( p_sys->p_glyph_cache, p_bitmaps->p_cache,
+                                    true, &p_bitmaps->p_outline, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
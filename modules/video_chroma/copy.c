@@ -34,7 +34,46 @@
 #include <vlc_cpu.h>
 #include <assert.h>
 
+#if defined (CAN_COMPILE_SSE2) && defined (HAVE_AVX2_INTRINSICS)
+# define COPY_AVX2 1
+# include <immintrin.h>
+#endif
+#if defined (__aarch64__) && defined (__ARM_NEON)
+# define COPY_NEON 1
+# include <arm_neon.h>
+#endif
+
 #include "copy.h"
+
+#ifdef COPY_TEST
+/* The benchmark masks CPU features to time every kernel level in turn */
+# ifdef COPY_TEST_NOOPTIM
+#  define COPY_TEST_CPU(flag) (0)
+# else
+static unsigned copy_test_cpu = ~0u;
+#  if defined (__i386__) || defined (__x86_64__)
+#   define COPY_TEST_CPU(flag) ((vlc_CPU() & copy_test_cpu & (flag)) != 0)
+#  else
+#   define COPY_TEST_CPU(flag) ((copy_test_cpu & (flag)) != 0)
+#  endif
+# endif
+# if defined (__i386__) || defined (__x86_64__)
+#  undef vlc_CPU_SSE2
+#  define vlc_CPU_SSE2() COPY_TEST_CPU(VLC_CPU_SSE2)
+#  undef vlc_CPU_SSE3
+#  define vlc_CPU_SSE3() COPY_TEST_CPU(VLC_CPU_SSE3)
+#  undef vlc_CPU_SSSE3
+#  define vlc_CPU_SSSE3() COPY_TEST_CPU(VLC_CPU_SSSE3)
+#  undef vlc_CPU_SSE4_1
+#  define vlc_CPU_SSE4_1() COPY_TEST_CPU(VLC_CPU_SSE4_1)
+#  undef vlc_CPU_AVX2
+#  define vlc_CPU_AVX2() COPY_TEST_CPU(VLC_CPU_AVX2)
+# elif defined (__aarch64__)
+#  undef vlc_CPU_ARM_NEON
+#  define vlc_CPU_ARM_NEON() COPY_TEST_CPU(VLC_CPU_ARM_NEON)
+# endif
+#endif
+
 static void CopyPlane(uint8_t *dst, size_t dst_pitch,
                       const uint8_t *src, size_t src_pitch,
                       unsigned height, int bitshift);
@@ -121,17 +160,6 @@ void CopyCleanCache(copy_cache_t *cache)
 #define COPY64(dstp, srcp, load, store) \
     COPY64_S(dstp, srcp, load, store, "")
 
-#ifdef COPY_TEST_NOOPTIM
-# undef vlc_CPU_SSE4_1
-# define vlc_CPU_SSE4_1() (0)
-# undef vlc_CPU_SSE3
-# define vlc_CPU_SSE3() (0)
-# undef vlc_CPU_SSSE3
-# define vlc_CPU_SSSE3() (0)
-# undef vlc_CPU_SSE2
-# define vlc_CPU_SSE2() (0)
-#endif
-
 /* Optimized copy from "Uncacheable Speculative Write Combining" memory
  * as used by some video surface.
  * XXX It is really efficient only when SSE4.1 is available.
@@ -196,7 +224,7 @@ static void CopyFromUswc(uint8_t *dst, size_t dst_pitch,
             SSE_USWC_COPY(COPY16_SHIFTR("$4"), COPY64_SHIFTR("$4"))
             break;
         case -4:
-            SSE_USWC_COPY(COPY16_SHIFTL("$2"), COPY64_SHIFTL("$2"))
+            SSE_USWC_COPY(COPY16_SHIFTL("$4"), COPY64_SHIFTL("$4"))
             break;
         default:
             vlc_assert_unreachable();
@@ -460,6 +488,149 @@ static void SSE_SplitUV(uint8_t *dstu, size_t dstu_pitch,
 #undef LOAD64
 }
 
+#ifdef COPY_AVX2
+/* AVX2 variants of the cache to destination kernels above. The source is
+ * always our (16 bytes aligned) cache, the destination may be unaligned. */
+VLC_AVX2
+static void AVX2_Copy2d(uint8_t *dst, size_t dst_pitch,
+                        const uint8_t *src, size_t src_pitch,
+                        unsigned width, unsigned height)
+{
+    assert(((intptr_t)src & 0x0f) == 0 && (src_pitch & 0x0f) == 0);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        if (((intptr_t)dst & 0x1f) == 0) {
+            for (; x+63 < width; x += 64) {
+                __m256i a = _mm256_loadu_si256((const __m256i *)&src[x]);
+                __m256i b = _mm256_loadu_si256((const __m256i *)&src[x+32]);
+                _mm256_stream_si256((__m256i *)&dst[x], a);
+                _mm256_stream_si256((__m256i *)&dst[x+32], b);
+            }
+        } else {
+            for (; x+63 < width; x += 64) {
+                __m256i a = _mm256_loadu_si256((const __m256i *)&src[x]);
+                __m256i b = _mm256_loadu_si256((const __m256i *)&src[x+32]);
+                _mm256_storeu_si256((__m256i *)&dst[x], a);
+                _mm256_storeu_si256((__m256i *)&dst[x+32], b);
+            }
+        }
+
+        for (; x < width; x++)
+            dst[x] = src[x];
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+    _mm_sfence();
+}
+
+VLC_AVX2
+static void AVX2_SplitUV(uint8_t *dstu, size_t dstu_pitch,
+                         uint8_t *dstv, size_t dstv_pitch,
+                         const uint8_t *src, size_t src_pitch,
+                         unsigned width, unsigned height, uint8_t pixel_size)
+{
+    assert(pixel_size == 1 || pixel_size == 2);
+    assert(((intptr_t)src & 0xf) == 0 && (src_pitch & 0x0f) == 0);
+
+    /* Gather U in the low and V in the high quadword of each lane, then
+     * regroup the quadwords so that each register holds U then V. */
+    const __m256i shuffle = pixel_size == 1 ?
+        _mm256_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15,
+                         0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15) :
+        _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+                         0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+        for (; x < (width & ~31); x += 32) {
+            __m256i a = _mm256_loadu_si256((const __m256i *)&src[2*x]);
+            __m256i b = _mm256_loadu_si256((const __m256i *)&src[2*x+32]);
+            a = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(a, shuffle), 0xd8);
+            b = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(b, shuffle), 0xd8);
+            _mm256_storeu_si256((__m256i *)&dstu[x],
+                                _mm256_permute2x128_si256(a, b, 0x20));
+            _mm256_storeu_si256((__m256i *)&dstv[x],
+                                _mm256_permute2x128_si256(a, b, 0x31));
+        }
+        if (pixel_size == 1)
+        {
+            for (; x < width; x++) {
+                dstu[x] = src[2*x+0];
+                dstv[x] = src[2*x+1];
+            }
+        }
+        else
+        {
+            for (; x < width; x+= 2) {
+                dstu[x] = src[2*x+0];
+                dstu[x+1] = src[2*x+1];
+                dstv[x] = src[2*x+2];
+                dstv[x+1] = src[2*x+3];
+            }
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+}
+
+VLC_AVX2
+static void AVX2_InterleaveUV(uint8_t *dst, size_t dst_pitch,
+                              const uint8_t *srcu, size_t srcu_pitch,
+                              const uint8_t *srcv, size_t srcv_pitch,
+                              unsigned width, unsigned height,
+                              uint8_t pixel_size)
+{
+    assert(pixel_size == 1 || pixel_size == 2);
+    assert(!((intptr_t)srcu & 0xf) && !(srcu_pitch & 0x0f) &&
+           !((intptr_t)srcv & 0xf) && !(srcv_pitch & 0x0f));
+
+    for (unsigned y = 0; y < height; y++)
+    {
+        unsigned x = 0;
+        for (; x < (width & ~31); x += 32) {
+            __m256i u = _mm256_loadu_si256((const __m256i *)&srcu[x]);
+            __m256i v = _mm256_loadu_si256((const __m256i *)&srcv[x]);
+            __m256i lo, hi;
+            if (pixel_size == 1) {
+                lo = _mm256_unpacklo_epi8(u, v);
+                hi = _mm256_unpackhi_epi8(u, v);
+            } else {
+                lo = _mm256_unpacklo_epi16(u, v);
+                hi = _mm256_unpackhi_epi16(u, v);
+            }
+            /* unpack works per lane: put the lanes back in order */
+            _mm256_storeu_si256((__m256i *)&dst[2*x],
+                                _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i *)&dst[2*x+32],
+                                _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+        if (pixel_size == 1)
+        {
+            for (; x < width; x++) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcv[x];
+            }
+        }
+        else
+        {
+            for (; x < width; x+= 2) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcu[x + 1];
+                dst[2*x+2] = srcv[x];
+                dst[2*x+3] = srcv[x + 1];
+            }
+        }
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst += dst_pitch;
+    }
+}
+#endif /* COPY_AVX2 */
+
 static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
                           const uint8_t *src, size_t src_pitch,
                           uint8_t *cache, size_t cache_size,
@@ -482,6 +653,11 @@ static void SSE_CopyPlane(uint8_t *dst, size_t dst_pitch,
         CopyFromUswc(cache, w16, src, src_pitch, cache_width, hblock, bitshift);
 
         /* Copy from our cache to the destination */
+#ifdef COPY_AVX2
+        if (vlc_CPU_AVX2())
+            AVX2_Copy2d(dst, dst_pitch, cache, w16, copy_pitch, hblock);
+        else
+#endif
         Copy2d(dst, dst_pitch, cache, w16, copy_pitch, hblock);
 
         /* */
@@ -515,6 +691,13 @@ SSE_InterleavePlanes(uint8_t *dst, size_t dst_pitch,
                      cachev_width, hblock, bitshift);
 
         /* Copy from our cache to the destination */
+#ifdef COPY_AVX2
+        if (vlc_CPU_AVX2())
+            AVX2_InterleaveUV(dst, dst_pitch, cache, w16,
+                              cache + w16 * hblock, w16,
+                              copy_pitch, hblock, pixel_size);
+        else
+#endif
         SSE_InterleaveUV(dst, dst_pitch, cache, w16,
                          cache + w16 * hblock, w16,
                          copy_pitch, hblock, pixel_size);
@@ -545,6 +728,12 @@ static void SSE_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
         CopyFromUswc(cache, w16, src, src_pitch, cache_width, hblock, bitshift);
 
         /* Copy from our cache to the destination */
+#ifdef COPY_AVX2
+        if (vlc_CPU_AVX2())
+            AVX2_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
+                         cache, w16, copy_pitch, hblock, pixel_size);
+        else
+#endif
         SSE_SplitUV(dstu, dstu_pitch, dstv, dstv_pitch,
                     cache, w16, copy_pitch, hblock, pixel_size);
 
@@ -612,6 +801,162 @@ static void SSE_Copy420_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
 #undef COPY64
 #endif /* CAN_COMPILE_SSE2 */
 
+#ifdef COPY_NEON
+/* vshlq shifts right when given a negative count, so a single kernel handles
+ * both directions of bitshift. */
+static inline uint16_t NEON_Shift16(uint16_t v, int bitshift)
+{
+    return bitshift >= 0 ? v >> bitshift : v << -bitshift;
+}
+
+static void NEON_CopyPlane16(uint8_t *dst, size_t dst_pitch,
+                             const uint8_t *src, size_t src_pitch,
+                             unsigned height, int bitshift)
+{
+    const size_t copy_pitch = __MIN(src_pitch, dst_pitch) / 2;
+    const int16x8_t shift = vdupq_n_s16(-bitshift);
+
+    for (unsigned y = 0; y < height; y++) {
+        uint16_t *dst16 = (uint16_t *) dst;
+        const uint16_t *src16 = (const uint16_t *) src;
+        unsigned x = 0;
+
+        for (; x + 16 <= copy_pitch; x += 16) {
+            uint16x8_t a = vld1q_u16(&src16[x]);
+            uint16x8_t b = vld1q_u16(&src16[x+8]);
+            vst1q_u16(&dst16[x], vshlq_u16(a, shift));
+            vst1q_u16(&dst16[x+8], vshlq_u16(b, shift));
+        }
+        for (; x < copy_pitch; x++)
+            dst16[x] = NEON_Shift16(src16[x], bitshift);
+
+        src += src_pitch;
+        dst += dst_pitch;
+    }
+}
+
+static void NEON_SplitPlanes(uint8_t *dstu, size_t dstu_pitch,
+                             uint8_t *dstv, size_t dstv_pitch,
+                             const uint8_t *src, size_t src_pitch,
+                             unsigned height, uint8_t pixel_size, int bitshift)
+{
+    const size_t copy_pitch = __MIN(__MIN(src_pitch / 2, dstu_pitch), dstv_pitch);
+    const int16x8_t shift = vdupq_n_s16(-bitshift);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        if (pixel_size == 1) {
+            for (; x + 16 <= copy_pitch; x += 16) {
+                uint8x16x2_t uv = vld2q_u8(&src[2*x]);
+                vst1q_u8(&dstu[x], uv.val[0]);
+                vst1q_u8(&dstv[x], uv.val[1]);
+            }
+            for (; x < copy_pitch; x++) {
+                dstu[x] = src[2*x+0];
+                dstv[x] = src[2*x+1];
+            }
+        } else {
+            const uint16_t *src16 = (const uint16_t *) src;
+            uint16_t *dstu16 = (uint16_t *) dstu;
+            uint16_t *dstv16 = (uint16_t *) dstv;
+            const unsigned width = copy_pitch / 2;
+
+            for (; x + 8 <= width; x += 8) {
+                uint16x8x2_t uv = vld2q_u16(&src16[2*x]);
+                vst1q_u16(&dstu16[x], vshlq_u16(uv.val[0], shift));
+                vst1q_u16(&dstv16[x], vshlq_u16(uv.val[1], shift));
+            }
+            for (; x < width; x++) {
+                dstu16[x] = NEON_Shift16(src16[2*x+0], bitshift);
+                dstv16[x] = NEON_Shift16(src16[2*x+1], bitshift);
+            }
+        }
+        src  += src_pitch;
+        dstu += dstu_pitch;
+        dstv += dstv_pitch;
+    }
+}
+
+static void NEON_InterleavePlanes(uint8_t *dst, size_t dst_pitch,
+                                  const uint8_t *srcu, size_t srcu_pitch,
+                                  const uint8_t *srcv, size_t srcv_pitch,
+                                  unsigned height, uint8_t pixel_size,
+                                  int bitshift)
+{
+    const size_t copy_pitch = __MIN(dst_pitch / 2, srcu_pitch);
+    const int16x8_t shift = vdupq_n_s16(-bitshift);
+
+    for (unsigned y = 0; y < height; y++) {
+        unsigned x = 0;
+
+        if (pixel_size == 1) {
+            for (; x + 16 <= copy_pitch; x += 16) {
+                uint8x16x2_t uv = { { vld1q_u8(&srcu[x]), vld1q_u8(&srcv[x]) } };
+                vst2q_u8(&dst[2*x], uv);
+            }
+            for (; x < copy_pitch; x++) {
+                dst[2*x+0] = srcu[x];
+                dst[2*x+1] = srcv[x];
+            }
+        } else {
+            const uint16_t *srcu16 = (const uint16_t *) srcu;
+            const uint16_t *srcv16 = (const uint16_t *) srcv;
+            uint16_t *dst16 = (uint16_t *) dst;
+            const unsigned width = copy_pitch / 2;
+
+            for (; x + 8 <= width; x += 8) {
+                uint16x8x2_t uv = { {
+                    vshlq_u16(vld1q_u16(&srcu16[x]), shift),
+                    vshlq_u16(vld1q_u16(&srcv16[x]), shift),
+                } };
+                vst2q_u16(&dst16[2*x], uv);
+            }
+            for (; x < width; x++) {
+                dst16[2*x+0] = NEON_Shift16(srcu16[x], bitshift);
+                dst16[2*x+1] = NEON_Shift16(srcv16[x], bitshift);
+            }
+        }
+        srcu += srcu_pitch;
+        srcv += srcv_pitch;
+        dst  += dst_pitch;
+    }
+}
+
+static void NEON_Copy420_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
+                                 const size_t src_pitch[static 2],
+                                 unsigned height, uint8_t pixel_size,
+                                 int bitshift)
+{
+    if (bitshift != 0)
+        NEON_CopyPlane16(dst->p[0].p_pixels, dst->p[0].i_pitch,
+                         src[0], src_pitch[0], height, bitshift);
+    else
+        CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+                  src[0], src_pitch[0], height, 0);
+    NEON_SplitPlanes(dst->p[1].p_pixels, dst->p[1].i_pitch,
+                     dst->p[2].p_pixels, dst->p[2].i_pitch,
+                     src[1], src_pitch[1], (height+1) / 2, pixel_size, bitshift);
+}
+
+static void NEON_Copy420_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
+                                 const size_t src_pitch[static 3],
+                                 unsigned height, uint8_t pixel_size,
+                                 int bitshift)
+{
+    if (bitshift != 0)
+        NEON_CopyPlane16(dst->p[0].p_pixels, dst->p[0].i_pitch,
+                         src[0], src_pitch[0], height, bitshift);
+    else
+        CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
+                  src[0], src_pitch[0], height, 0);
+    NEON_InterleavePlanes(dst->p[1].p_pixels, dst->p[1].i_pitch,
+                          src[U_PLANE], src_pitch[U_PLANE],
+                          src[V_PLANE], src_pitch[V_PLANE],
+                          (height+1) / 2, pixel_size, bitshift);
+}
+#endif /* COPY_NEON */
+
 static void CopyPlane(uint8_t *dst, size_t dst_pitch,
                       const uint8_t *src, size_t src_pitch,
                       unsigned height, int bitshift)
@@ -750,6 +1095,10 @@ void Copy420_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
 #else
     VLC_UNUSED(cache);
 #endif
+#ifdef COPY_NEON
+    if (vlc_CPU_ARM_NEON())
+        return NEON_Copy420_SP_to_P(dst, src, src_pitch, height, 1, 0);
+#endif
 
     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
               src[0], src_pitch[0], height, 0);
@@ -771,6 +1120,10 @@ void Copy420_16_SP_to_P(picture_t *dst, const uint8_t *src[static 2],
 #else
     VLC_UNUSED(cache);
 #endif
+#ifdef COPY_NEON
+    if (vlc_CPU_ARM_NEON())
+        return NEON_Copy420_SP_to_P(dst, src, src_pitch, height, 2, bitshift);
+#endif
 
     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
               src[0], src_pitch[0], height, bitshift);
@@ -826,6 +1179,10 @@ void Copy420_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
 #else
     (void) cache;
 #endif
+#ifdef COPY_NEON
+    if (vlc_CPU_ARM_NEON())
+        return NEON_Copy420_P_to_SP(dst, src, src_pitch, height, 1, 0);
+#endif
 
     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
               src[0], src_pitch[0], height, 0);
@@ -857,6 +1214,10 @@ void Copy420_16_P_to_SP(picture_t *dst, const uint8_t *src[static 3],
 #else
     (void) cache;
 #endif
+#ifdef COPY_NEON
+    if (vlc_CPU_ARM_NEON())
+        return NEON_Copy420_P_to_SP(dst, src, src_pitch, height, 2, bitshift);
+#endif
 
     CopyPlane(dst->p[0].p_pixels, dst->p[0].i_pitch,
               src[0], src_pitch[0], height, bitshift);
@@ -1105,81 +1466,183 @@ static picture_t *pic_new_unaligned(const video_format_t *fmt)
     return picture_NewFromResource(fmt, &rsc);
 }
 
-int main(void)
+struct test_cpu
 {
-    alarm(10);
+    const char *name;
+    unsigned flags;
+};
 
+static const struct test_cpu cpus[] = {
+    { "C", 0 },
 #ifndef COPY_TEST_NOOPTIM
-    if (!vlc_CPU_SSE2())
-    {
-        fprintf(stderr, "WARNING: could not test SSE\n");
-        return 77;
-    }
+# if defined (__i386__) || defined (__x86_64__)
+    { "SSE2", VLC_CPU_SSE2 },
+    { "SSSE3", VLC_CPU_SSE2 | VLC_CPU_SSE3 | VLC_CPU_SSSE3 },
+    { "SSE4.1", VLC_CPU_SSE2 | VLC_CPU_SSE3 | VLC_CPU_SSSE3 | VLC_CPU_SSE4_1 },
+    { "AVX2", VLC_CPU_SSE2 | VLC_CPU_SSE3 | VLC_CPU_SSSE3 | VLC_CPU_SSE4_1
+              | VLC_CPU_AVX2 },
+# elif defined (COPY_NEON)
+    { "NEON", VLC_CPU_ARM_NEON },
+# endif
+#endif
+};
+#define NB_CPUS ARRAY_SIZE(cpus)
+
+static bool cpu_select(const struct test_cpu *cpu)
+{
+#ifdef COPY_TEST_NOOPTIM
+    return cpu->flags == 0;
+#else
+# if defined (__i386__) || defined (__x86_64__)
+    if ((vlc_CPU() & cpu->flags) != cpu->flags)
+        return false;
+# endif
+    copy_test_cpu = cpu->flags;
+    return true;
 #endif
+}
 
+static void convert(const struct test_dst *test_dst, picture_t *dst,
+                    const picture_t *src, const copy_cache_t *cache)
+{
+    const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
+                                      src->p[U_PLANE].p_pixels,
+                                      src->p[V_PLANE].p_pixels };
+    const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
+                                       src->p[U_PLANE].i_pitch,
+                                       src->p[V_PLANE].i_pitch };
+
+    if (test_dst->bitshift == 0)
+        test_dst->conv(dst, src_planes, src_pitches,
+                       src->format.i_visible_height, cache);
+    else
+        test_dst->conv16(dst, src_planes, src_pitches,
+                         src->format.i_visible_height, test_dst->bitshift,
+                         cache);
+}
+
+/* Runs every conversion for the given size. With a non zero count, each
+ * conversion is timed over that many frames instead of being checked. */
+static void run(const struct test_cpu *cpu, const struct test_size *size,
+                unsigned count)
+{
     for (size_t i = 0; i < NB_CONVS; ++i)
     {
         const struct test_conv *conv = &convs[i];
 
-        for (size_t j = 0; j < NB_SIZES; ++j)
+        const vlc_chroma_description_t *src_dsc =
+            vlc_fourcc_GetChromaDescription(conv->src_chroma);
+        assert(src_dsc);
+
+        video_format_t fmt;
+        video_format_Init(&fmt, 0);
+        video_format_Setup(&fmt, conv->src_chroma,
+                           size->i_width, size->i_height,
+                           size->i_visible_width, size->i_visible_height,
+                           1, 1);
+        picture_t *src = pic_new_unaligned(&fmt);
+        assert(src);
+        piccheck(src, src_dsc, true);
+
+        copy_cache_t cache;
+        int ret = CopyInitCache(&cache, src->format.i_width
+                                * src_dsc->pixel_size);
+        assert(ret == VLC_SUCCESS);
+
+        for (size_t f = 0; conv->dsts[f].chroma != 0; ++f)
         {
-            const struct test_size *size = &sizes[j];
-
-            const vlc_chroma_description_t *src_dsc =
-                vlc_fourcc_GetChromaDescription(conv->src_chroma);
-            assert(src_dsc);
-
-            video_format_t fmt;
-            video_format_Init(&fmt, 0);
-            video_format_Setup(&fmt, conv->src_chroma,
-                               size->i_width, size->i_height,
-                               size->i_visible_width, size->i_visible_height,
-                               1, 1);
-            picture_t *src = pic_new_unaligned(&fmt);
-            assert(src);
-            piccheck(src, src_dsc, true);
-
-            copy_cache_t cache;
-            int ret = CopyInitCache(&cache, src->format.i_width
-                                    * src_dsc->pixel_size);
-            assert(ret == VLC_SUCCESS);
-
-            for (size_t f = 0; conv->dsts[f].chroma != 0; ++f)
+            const struct test_dst *test_dst= &conv->dsts[f];
+
+            const vlc_chroma_description_t *dst_dsc =
+                vlc_fourcc_GetChromaDescription(test_dst->chroma);
+            assert(dst_dsc);
+            fmt.i_chroma = test_dst->chroma;
+            picture_t *dst = picture_NewFromFormat(&fmt);
+            assert(dst);
+
+            if (count == 0)
             {
-                const struct test_dst *test_dst= &conv->dsts[f];
-
-                const vlc_chroma_description_t *dst_dsc =
-                    vlc_fourcc_GetChromaDescription(test_dst->chroma);
-                assert(dst_dsc);
-                fmt.i_chroma = test_dst->chroma;
-                picture_t *dst = picture_NewFromFormat(&fmt);
-                assert(dst);
-
-                const uint8_t * src_planes[3] = { src->p[Y_PLANE].p_pixels,
-                                                  src->p[U_PLANE].p_pixels,
-                                                  src->p[V_PLANE].p_pixels };
-                const size_t    src_pitches[3] = { src->p[Y_PLANE].i_pitch,
-                                                   src->p[U_PLANE].i_pitch,
-                                                   src->p[V_PLANE].i_pitch };
-
-                fprintf(stderr, "testing: %u x %u (vis: %u x %u) %4.4s -> %4.4s\n",
-                        size->i_width, size->i_height,
+                fprintf(stderr, "testing: %s %u x %u (vis: %u x %u) %4.4s -> %4.4s\n",
+                        cpu->name, size->i_width, size->i_height,
                         size->i_visible_width, size->i_visible_height,
                         (const char *) &src->format.i_chroma,
                         (const char *) &dst->format.i_chroma);
-                if (test_dst->bitshift == 0)
-                    test_dst->conv(dst, src_planes, src_pitches,
-                                   src->format.i_visible_height, &cache);
-                else
-                    test_dst->conv16(dst, src_planes, src_pitches,
-                                   src->format.i_visible_height, test_dst->bitshift,
-                                   &cache);
+                convert(test_dst, dst, src, &cache);
                 piccheck(dst, dst_dsc, false);
-                picture_Release(dst);
             }
-            picture_Release(src);
-            CopyCleanCache(&cache);
+            else
+            {
+                size_t bytes = 0;
+                for (int p = 0; p < src->i_planes; p++)
+                    bytes += src->p[p].i_visible_pitch
+                           * src->p[p].i_visible_lines;
+
+                vlc_tick_t start = vlc_tick_now();
+                for (unsigned n = 0; n < count; n++)
+                    convert(test_dst, dst, src, &cache);
+                vlc_tick_t elapsed = vlc_tick_now() - start;
+
+                fprintf(stderr, "%-6s %4u x %4u %4.4s -> %4.4s: "
+                        "%7.1f fps %8.1f MiB/s\n", cpu->name,
+                        size->i_visible_width, size->i_visible_height,
+                        (const char *) &src->format.i_chroma,
+                        (const char *) &dst->format.i_chroma,
+                        (double) count * CLOCK_FREQ / elapsed,
+                        (double) bytes * count * CLOCK_FREQ / elapsed
+                        / (1024 * 1024));
+            }
+            picture_Release(dst);
         }
+        picture_Release(src);
+        CopyCleanCache(&cache);
+    }
+}
+
+/* Usage: chroma_copy_test [bench [frames]]
+ * Without arguments, every kernel level is checked for correctness. The bench
+ * mode reports the throughput of every kernel level for HD and UHD frames. */
+int main(int argc, char *argv[])
+{
+    unsigned count = 0;
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        count = argc > 2 ? strtoul(argv[2], NULL, 0) : 100;
+    if (count == 0)
+        alarm(10);
+
+#ifndef COPY_TEST_NOOPTIM
+# if defined (__i386__) || defined (__x86_64__)
+    if (!vlc_CPU_SSE2())
+    {
+        fprintf(stderr, "WARNING: could not test SSE\n");
+        return 77;
+    }
+# elif defined (COPY_NEON)
+    if (!vlc_CPU_ARM_NEON())
+    {
+        fprintf(stderr, "WARNING: could not test NEON\n");
+        return 77;
+    }
+# else
+    fprintf(stderr, "WARNING: no optimized kernels to test\n");
+    return 77;
+# endif
+#endif
+
+    for (size_t c = 0; c < NB_CPUS; ++c)
+    {
+        if (!cpu_select(&cpus[c]))
+        {
+            fprintf(stderr, "skipping: %s not supported\n", cpus[c].name);
+            continue;
+        }
+
+        if (count == 0)
+            for (size_t j = 0; j < NB_SIZES; ++j)
+                run(&cpus[c], &sizes[j], 0);
+        else
+            for (size_t j = NB_SIZES - 2; j < NB_SIZES; ++j)
+                run(&cpus[c], &sizes[j], count);
     }
     return 0;
 }
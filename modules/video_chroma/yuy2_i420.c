@@ -32,6 +32,14 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
 
 #define SRC_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422"
 #define DEST_FOURCC  "I420"
@@ -112,214 +120,186 @@ VIDEO_FILTER_WRAPPER( YVYU_I420 )
 VIDEO_FILTER_WRAPPER( UYVY_I420 )
 
 /*****************************************************************************
- * YUY2_I420: packed YUY2 4:2:2 to planar YUV 4:2:0
+ * Row kernels: one line of packed 4:2:2 pixel pairs to planar lines
+ *****************************************************************************
+ * The chroma of the odd lines is dropped: u and v are NULL for them.
+ * Kernels for luma first (YUYV) and chroma first (UYVY) pairs are enough,
+ * YVYU is YUYV with the chroma planes swapped.
  *****************************************************************************/
-static void YUY2_I420( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
-{
-    uint8_t *p_line = p_source->p->p_pixels;
-
-    uint8_t *p_y = p_dest->Y_PIXELS;
-    uint8_t *p_u = p_dest->U_PIXELS;
-    uint8_t *p_v = p_dest->V_PIXELS;
-
-    int i_x, i_y;
-
-    const int i_dest_margin = p_dest->p[0].i_pitch
-                                 - p_dest->p[0].i_visible_pitch
-                                 - p_filter->fmt_out.video.i_x_offset;
-    const int i_dest_margin_c = p_dest->p[1].i_pitch
-                                 - p_dest->p[1].i_visible_pitch
-                                 - ( p_filter->fmt_out.video.i_x_offset / 2 );
-    const int i_source_margin = p_source->p->i_pitch
-                               - p_source->p->i_visible_pitch
-                               - ( p_filter->fmt_in.video.i_x_offset * 2 );
-
-    bool b_skip = false;
+typedef void (*packed_row_t)( uint8_t *restrict y, uint8_t *restrict u,
+                              uint8_t *restrict v, const uint8_t *restrict src,
+                              unsigned pairs );
 
-    for( i_y = (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) ; i_y-- ; )
+static void YUYVRowC( uint8_t *restrict y, uint8_t *restrict u,
+                      uint8_t *restrict v, const uint8_t *restrict src,
+                      unsigned pairs )
+{
+    for( unsigned i = 0; i < pairs; i++, src += 4 )
     {
-        if( b_skip )
+        *y++ = src[0];
+        *y++ = src[2];
+        if( u != NULL )
         {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v )      \
-                *p_y++ = *p_line++; p_line++; \
-                *p_y++ = *p_line++; p_line++
-                C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
+            *u++ = src[1];
+            *v++ = src[3];
         }
-        else
+    }
+}
+
+static void UYVYRowC( uint8_t *restrict y, uint8_t *restrict u,
+                      uint8_t *restrict v, const uint8_t *restrict src,
+                      unsigned pairs )
+{
+    for( unsigned i = 0; i < pairs; i++, src += 4 )
+    {
+        *y++ = src[1];
+        *y++ = src[3];
+        if( u != NULL )
         {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_YUYV_YUV422( p_line, p_y, p_u, p_v )      \
-                *p_y++ = *p_line++; *p_u++ = *p_line++; \
-                *p_y++ = *p_line++; *p_v++ = *p_line++
-                C_YUYV_YUV422( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422( p_line, p_y, p_u, p_v );
-                C_YUYV_YUV422( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_YUYV_YUV422( p_line, p_y, p_u, p_v );
-            }
-            p_u += i_dest_margin_c;
-            p_v += i_dest_margin_c;
+            *u++ = src[0];
+            *v++ = src[2];
         }
-        p_line += i_source_margin;
-        p_y += i_dest_margin;
-
-        b_skip = !b_skip;
     }
 }
 
+#if defined(HAVE_SSE2_INTRINSICS)
+/* 8 pixel pairs per iteration: the luma and the chroma bytes are separated
+ * by masking and shifting the 16-bit words, then packed back together */
+# define PACKED_ROW_SSE2(name, luma, chroma, fallback) \
+__attribute__ ((__target__ ("sse2"))) \
+static void name( uint8_t *restrict y, uint8_t *restrict u, \
+                  uint8_t *restrict v, const uint8_t *restrict src, \
+                  unsigned pairs ) \
+{ \
+    const __m128i mask = _mm_set1_epi16( 0x00FF ); \
+    unsigned i = 0; \
+\
+    for( ; i + 8 <= pairs; i += 8, src += 32 ) \
+    { \
+        const __m128i a = _mm_loadu_si128( (const __m128i *)src ); \
+        const __m128i b = _mm_loadu_si128( (const __m128i *)(src + 16) ); \
+\
+        _mm_storeu_si128( (__m128i *)(y + 2 * i), \
+                          _mm_packus_epi16( luma( a ), luma( b ) ) ); \
+        if( u != NULL ) \
+        { \
+            const __m128i uv = _mm_packus_epi16( chroma( a ), chroma( b ) ); \
+\
+            _mm_storel_epi64( (__m128i *)(u + i), _mm_packus_epi16( \
+                _mm_and_si128( uv, mask ), _mm_setzero_si128() ) ); \
+            _mm_storel_epi64( (__m128i *)(v + i), _mm_packus_epi16( \
+                _mm_srli_epi16( uv, 8 ), _mm_setzero_si128() ) ); \
+        } \
+    } \
+    fallback( y + 2 * i, u ? u + i : NULL, v ? v + i : NULL, src, \
+              pairs - i ); \
+}
+
+# define LOW_SSE2(x) _mm_and_si128( x, mask )
+# define HIGH_SSE2(x) _mm_srli_epi16( x, 8 )
+
+PACKED_ROW_SSE2( YUYVRowSSE2, LOW_SSE2, HIGH_SSE2, YUYVRowC )
+PACKED_ROW_SSE2( UYVYRowSSE2, HIGH_SSE2, LOW_SSE2, UYVYRowC )
+#endif
+
+#if defined(__ARM_NEON)
+/* 8 pixel pairs per iteration: vld4 deinterleaves the bytes of the pairs */
+# define PACKED_ROW_NEON(name, y0, u0, y1, v0, fallback) \
+static void name( uint8_t *restrict y, uint8_t *restrict u, \
+                  uint8_t *restrict v, const uint8_t *restrict src, \
+                  unsigned pairs ) \
+{ \
+    unsigned i = 0; \
+\
+    for( ; i + 8 <= pairs; i += 8, src += 32 ) \
+    { \
+        const uint8x8x4_t px = vld4_u8( src ); \
+        const uint8x8x2_t luma = { { px.val[y0], px.val[y1] } }; \
+\
+        vst2_u8( y + 2 * i, luma ); \
+        if( u != NULL ) \
+        { \
+            vst1_u8( u + i, px.val[u0] ); \
+            vst1_u8( v + i, px.val[v0] ); \
+        } \
+    } \
+    fallback( y + 2 * i, u ? u + i : NULL, v ? v + i : NULL, src, \
+              pairs - i ); \
+}
+
+PACKED_ROW_NEON( YUYVRowNEON, 0, 1, 2, 3, YUYVRowC )
+PACKED_ROW_NEON( UYVYRowNEON, 1, 0, 3, 2, UYVYRowC )
+#endif
+
+static packed_row_t GetRowKernel( bool b_luma_first )
+{
+#if defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE2() )
+        return b_luma_first ? YUYVRowSSE2 : UYVYRowSSE2;
+#endif
+#if defined(__ARM_NEON)
+    if( vlc_CPU_ARM_NEON() )
+        return b_luma_first ? YUYVRowNEON : UYVYRowNEON;
+#endif
+    return b_luma_first ? YUYVRowC : UYVYRowC;
+}
+
 /*****************************************************************************
- * YVYU_I420: packed YVYU 4:2:2 to planar YUV 4:2:0
+ * PackedToI420: packed 4:2:2 to planar YUV 4:2:0
  *****************************************************************************/
-static void YVYU_I420( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+static void PackedToI420( filter_t *p_filter, picture_t *p_source,
+                          picture_t *p_dest, packed_row_t row,
+                          uint8_t *p_u, uint8_t *p_v )
 {
-    uint8_t *p_line = p_source->p->p_pixels;
-
+    const uint8_t *p_line = p_source->p->p_pixels;
     uint8_t *p_y = p_dest->Y_PIXELS;
-    uint8_t *p_u = p_dest->U_PIXELS;
-    uint8_t *p_v = p_dest->V_PIXELS;
-
-    int i_x, i_y;
-
-    const int i_dest_margin = p_dest->p[0].i_pitch
-                                 - p_dest->p[0].i_visible_pitch
-                                 - p_filter->fmt_out.video.i_x_offset;
-    const int i_dest_margin_c = p_dest->p[1].i_pitch
-                                 - p_dest->p[1].i_visible_pitch
-                                 - ( p_filter->fmt_out.video.i_x_offset / 2 );
-    const int i_source_margin = p_source->p->i_pitch
-                               - p_source->p->i_visible_pitch
-                               - ( p_filter->fmt_in.video.i_x_offset * 2 );
 
-    bool b_skip = false;
+    const unsigned i_pairs = (p_filter->fmt_out.video.i_x_offset
+                            + p_filter->fmt_out.video.i_visible_width) / 2;
+    const unsigned i_lines = p_filter->fmt_out.video.i_y_offset
+                           + p_filter->fmt_out.video.i_visible_height;
 
-    for( i_y = (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) ; i_y-- ; )
+    for( unsigned i_y = 0; i_y < i_lines; i_y++ )
     {
-        if( b_skip )
-        {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v )      \
-                *p_y++ = *p_line++; p_line++; \
-                *p_y++ = *p_line++; p_line++
-                C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_YVYU_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
-        }
+        if( i_y & 1 )
+            row( p_y, NULL, NULL, p_line, i_pairs );
         else
         {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_YVYU_YUV422( p_line, p_y, p_u, p_v )      \
-                *p_y++ = *p_line++; *p_v++ = *p_line++; \
-                *p_y++ = *p_line++; *p_u++ = *p_line++
-                C_YVYU_YUV422( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422( p_line, p_y, p_u, p_v );
-                C_YVYU_YUV422( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_YVYU_YUV422( p_line, p_y, p_u, p_v );
-            }
-            p_u += i_dest_margin_c;
-            p_v += i_dest_margin_c;
+            row( p_y, p_u, p_v, p_line, i_pairs );
+            p_u += p_dest->p[U_PLANE].i_pitch;
+            p_v += p_dest->p[V_PLANE].i_pitch;
         }
-        p_line += i_source_margin;
-        p_y += i_dest_margin;
-
-        b_skip = !b_skip;
+        p_line += p_source->p->i_pitch;
+        p_y += p_dest->p[Y_PLANE].i_pitch;
     }
 }
 
 /*****************************************************************************
- * UYVY_I420: packed UYVY 4:2:2 to planar YUV 4:2:0
+ * YUY2_I420: packed YUY2 4:2:2 to planar YUV 4:2:0
  *****************************************************************************/
-static void UYVY_I420( filter_t *p_filter, picture_t *p_source,
+static void YUY2_I420( filter_t *p_filter, picture_t *p_source,
                                            picture_t *p_dest )
 {
-    uint8_t *p_line = p_source->p->p_pixels;
-
-    uint8_t *p_y = p_dest->Y_PIXELS;
-    uint8_t *p_u = p_dest->U_PIXELS;
-    uint8_t *p_v = p_dest->V_PIXELS;
-
-    int i_x, i_y;
-
-    const int i_dest_margin = p_dest->p[0].i_pitch
-                                 - p_dest->p[0].i_visible_pitch
-                                 - p_filter->fmt_out.video.i_x_offset;
-    const int i_dest_margin_c = p_dest->p[1].i_pitch
-                                 - p_dest->p[1].i_visible_pitch
-                                 - ( p_filter->fmt_out.video.i_x_offset / 2 );
-    const int i_source_margin = p_source->p->i_pitch
-                               - p_source->p->i_visible_pitch
-                               - ( p_filter->fmt_in.video.i_x_offset * 2 );
-
-    bool b_skip = false;
+    PackedToI420( p_filter, p_source, p_dest, GetRowKernel( true ),
+                  p_dest->U_PIXELS, p_dest->V_PIXELS );
+}
 
-    for( i_y = (p_filter->fmt_out.video.i_y_offset + p_filter->fmt_out.video.i_visible_height) ; i_y-- ; )
-    {
-        if( b_skip )
-        {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v )      \
-                *p_u++ = *p_line++; p_line++; \
-                *p_v++ = *p_line++; p_line++
-                C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
-            }
-        }
-        else
-        {
-            for( i_x = (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) / 8 ; i_x-- ; )
-            {
-    #define C_UYVY_YUV422( p_line, p_y, p_u, p_v )      \
-                *p_u++ = *p_line++; *p_y++ = *p_line++; \
-                *p_v++ = *p_line++; *p_y++ = *p_line++
-                C_UYVY_YUV422( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422( p_line, p_y, p_u, p_v );
-                C_UYVY_YUV422( p_line, p_y, p_u, p_v );
-            }
-            for( i_x = ( (p_filter->fmt_out.video.i_x_offset + p_filter->fmt_out.video.i_visible_width) % 8 ) / 2; i_x-- ; )
-            {
-                C_UYVY_YUV422( p_line, p_y, p_u, p_v );
-            }
-            p_y += i_dest_margin;
-        }
-        p_line += i_source_margin;
-        p_u += i_dest_margin_c;
-        p_v += i_dest_margin_c;
+/*****************************************************************************
+ * YVYU_I420: packed YVYU 4:2:2 to planar YUV 4:2:0
+ *****************************************************************************/
+static void YVYU_I420( filter_t *p_filter, picture_t *p_source,
+                                           picture_t *p_dest )
+{
+    PackedToI420( p_filter, p_source, p_dest, GetRowKernel( true ),
+                  p_dest->V_PIXELS, p_dest->U_PIXELS );
+}
 
-        b_skip = !b_skip;
-    }
+/*****************************************************************************
+ * UYVY_I420: packed UYVY 4:2:2 to planar YUV 4:2:0
+ *****************************************************************************/
+static void UYVY_I420( filter_t *p_filter, picture_t *p_source,
+                                           picture_t *p_dest )
+{
+    PackedToI420( p_filter, p_source, p_dest, GetRowKernel( false ),
+                  p_dest->U_PIXELS, p_dest->V_PIXELS );
 }
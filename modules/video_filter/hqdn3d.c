@@ -33,7 +33,7 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include "filter_picture.h"
-
+#include "slices.h"
 
 #include "hqdn3d.h"
 
@@ -83,6 +83,53 @@ static const char *const filter_options[] = {
     "luma-spat", "chroma-spat", "luma-temp", "chroma-temp", NULL
 };
 
+/*****************************************************************************
+ * Kernels
+ *****************************************************************************
+ * A plane is denoised in two passes: the horizontal low pass of each row,
+ * on bands of rows in parallel, then the vertical and temporal low passes of
+ * each column, on bands of columns in parallel. This gives the same pixels
+ * as the single pass of MPlayer. Without other threads, both passes are
+ * done on 4 rows at once instead.
+ *****************************************************************************/
+
+/* Filters a segment of a row, vertically unless on the first row (vertical
+ * is NULL), then temporally unless disabled (temporal is NULL) */
+static void VerticalRow(unsigned *restrict line,
+                        const unsigned *restrict horiz,
+                        unsigned short *restrict ant,
+                        unsigned char *restrict dst,
+                        int count, int *vertical, int *temporal)
+{
+    if (!vertical)
+        memcpy(line, horiz, count * sizeof (*line));
+    else
+        for (int x = 0; x < count; x++)
+            line[x] = LowPassMul(line[x], horiz[x], vertical);
+
+    if (!temporal) {
+        for (int x = 0; x < count; x++)
+            dst[x] = ((line[x]+0x10007FFF)>>16);
+        return;
+    }
+    for (int x = 0; x < count; x++) {
+        unsigned pixel = LowPassMul(ant[x]<<8, line[x], temporal);
+        ant[x] = ((pixel+0x1000007F)>>8);
+        dst[x] = ((pixel+0x10007FFF)>>16);
+    }
+}
+
+/* Filters a segment of a row temporally only */
+static void TemporalRow(const unsigned char *src, unsigned short *ant,
+                        unsigned char *dst, int count, int *temporal)
+{
+    for (int x = 0; x < count; x++) {
+        unsigned pixel = LowPassMul(ant[x]<<8, src[x]<<16, temporal);
+        ant[x] = ((pixel+0x1000007F)>>8);
+        dst[x] = ((pixel+0x10007FFF)>>16);
+    }
+}
+
 /*****************************************************************************
  * filter_sys_t
  *****************************************************************************/
@@ -95,8 +142,150 @@ typedef struct
     bool   b_recalc_coefs;
     vlc_mutex_t coefs_mutex;
     float  luma_spat, luma_temp, chroma_spat, chroma_temp;
+
+    filter_slices_t *slices;
+    unsigned *horiz; /* Horizontal pass of a plane */
 } filter_sys_t;
 
+/*****************************************************************************
+ * Denoising of a plane
+ *****************************************************************************/
+struct plane_job
+{
+    filter_sys_t *sys;
+    const unsigned char *src;
+    unsigned char *dst;
+    unsigned short *ant;
+    int w, h;
+    ptrdiff_t src_pitch, dst_pitch;
+    int *horizontal, *vertical, *temporal;
+    unsigned slices;
+};
+
+/* Each row is a chain of dependent low passes, so that 4 of them at once
+ * hide the latency of each other */
+static void HorizontalRows(const struct plane_job *job, int y, int rows,
+                           unsigned *restrict horiz)
+{
+    int *coefs = job->horizontal;
+    const int w = job->w;
+    const ptrdiff_t pitch = job->src_pitch;
+
+    for (; rows >= 4; rows -= 4, y += 4, horiz += 4 * w) {
+        const unsigned char *restrict src = job->src + y * pitch;
+        unsigned *restrict h0 = horiz, *restrict h1 = horiz + w;
+        unsigned *restrict h2 = horiz + 2 * w, *restrict h3 = horiz + 3 * w;
+
+        /* First pixel on each line doesn't have previous pixel */
+        unsigned p0 = h0[0] = src[0]<<16;
+        unsigned p1 = h1[0] = src[pitch]<<16;
+        unsigned p2 = h2[0] = src[2 * pitch]<<16;
+        unsigned p3 = h3[0] = src[3 * pitch]<<16;
+        for (int x = 1; x < w; x++) {
+            p0 = h0[x] = LowPassMul(p0, src[x]<<16, coefs);
+            p1 = h1[x] = LowPassMul(p1, src[pitch + x]<<16, coefs);
+            p2 = h2[x] = LowPassMul(p2, src[2 * pitch + x]<<16, coefs);
+            p3 = h3[x] = LowPassMul(p3, src[3 * pitch + x]<<16, coefs);
+        }
+    }
+
+    for (; rows > 0; rows--, y++, horiz += w) {
+        const unsigned char *restrict src = job->src + y * pitch;
+        unsigned pixel = horiz[0] = src[0]<<16;
+
+        for (int x = 1; x < w; x++)
+            pixel = horiz[x] = LowPassMul(pixel, src[x]<<16, coefs);
+    }
+}
+
+static void HorizontalSlice(void *opaque, unsigned slice)
+{
+    const struct plane_job *job = opaque;
+    unsigned begin, end;
+
+    filter_slices_Bounds(slice, job->slices, job->h, 4, &begin, &end);
+    HorizontalRows(job, begin, end - begin, job->sys->horiz + begin * job->w);
+}
+
+static void VerticalSlice(void *opaque, unsigned slice)
+{
+    const struct plane_job *job = opaque;
+    filter_sys_t *sys = job->sys;
+    unsigned begin, end;
+
+    /* Whole cache lines of the line buffer */
+    filter_slices_Bounds(slice, job->slices, job->w, 16, &begin, &end);
+    for (int y = 0; y < job->h; y++)
+        VerticalRow(sys->cfg.Line + begin,
+                    sys->horiz + y * job->w + begin,
+                    job->ant + y * job->w + begin,
+                    job->dst + y * job->dst_pitch + begin, end - begin,
+                    y ? job->vertical : NULL, job->temporal);
+}
+
+static void TemporalSlice(void *opaque, unsigned slice)
+{
+    const struct plane_job *job = opaque;
+    unsigned begin, end;
+
+    filter_slices_Bounds(slice, job->slices, job->h, 1, &begin, &end);
+    for (unsigned y = begin; y < end; y++)
+        TemporalRow(job->src + y * job->src_pitch, job->ant + y * job->w,
+                    job->dst + y * job->dst_pitch, job->w, job->temporal);
+}
+
+static bool Denoise(filter_sys_t *sys, const plane_t *src, plane_t *dst,
+                    unsigned short **FrameAntPtr, int W, int H,
+                    int *Horizontal, int *Vertical, int *Temporal)
+{
+    unsigned short *FrameAnt = *FrameAntPtr;
+
+    if (!FrameAnt) {
+        *FrameAntPtr = FrameAnt = malloc(W*H*sizeof(unsigned short));
+        if (!FrameAnt)
+            return false;
+        for (long Y = 0; Y < H; Y++) {
+            unsigned short *d = &FrameAnt[Y*W];
+            const unsigned char *s = src->p_pixels + Y*src->i_pitch;
+            for (long X = 0; X < W; X++) d[X] = s[X]<<8;
+        }
+    }
+
+    struct plane_job job = {
+        .sys = sys,
+        .src = src->p_pixels, .dst = dst->p_pixels, .ant = FrameAnt,
+        .w = W, .h = H,
+        .src_pitch = src->i_pitch, .dst_pitch = dst->i_pitch,
+        .horizontal = Horizontal, .vertical = Vertical,
+        .temporal = Temporal[0] ? Temporal : NULL,
+        .slices = filter_slices_Threads(sys->slices),
+    };
+
+    if (!Horizontal[0] && !Vertical[0]) {
+        job.temporal = Temporal;
+        filter_slices_Run(sys->slices, TemporalSlice, &job, job.slices);
+        return true;
+    }
+    if (job.slices == 1) {
+        /* Both passes on 4 rows at once, keeping the horizontal one in
+         * cache */
+        for (int y = 0; y < H; y += 4) {
+            const int rows = H - y < 4 ? H - y : 4;
+
+            HorizontalRows(&job, y, rows, sys->horiz);
+            for (int i = 0; i < rows; i++)
+                VerticalRow(sys->cfg.Line, sys->horiz + i * W,
+                            FrameAnt + (y + i) * W,
+                            dst->p_pixels + (y + i) * dst->i_pitch, W,
+                            y + i ? Vertical : NULL, job.temporal);
+        }
+        return true;
+    }
+    filter_slices_Run(sys->slices, HorizontalSlice, &job, job.slices);
+    filter_slices_Run(sys->slices, VerticalSlice, &job, job.slices);
+    return true;
+}
+
 /*****************************************************************************
  * Open
  *****************************************************************************/
@@ -109,7 +298,7 @@ static int Open(vlc_object_t *this)
     const video_format_t *fmt_out = &filter->fmt_out.video;
     const vlc_fourcc_t fourcc_in  = fmt_in->i_chroma;
     const vlc_fourcc_t fourcc_out = fmt_out->i_chroma;
-    int wmax = 0;
+    int wmax = 0, hmax = 0;
 
     const vlc_chroma_description_t *chroma =
             vlc_fourcc_GetChromaDescription(fourcc_in);
@@ -136,9 +325,16 @@ static int Open(vlc_object_t *this)
         sys->w[i] = fmt_in->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
+        if (sys->h[i] > hmax) hmax = sys->h[i];
     }
     cfg->Line = malloc(wmax*sizeof(unsigned int));
-    if (!cfg->Line) {
+    sys->horiz = vlc_alloc((size_t)wmax*hmax, sizeof(unsigned int));
+    sys->slices = filter_slices_New(0);
+    if (!cfg->Line || !sys->horiz || !sys->slices) {
+        if (sys->slices)
+            filter_slices_Delete(sys->slices);
+        free(sys->horiz);
+        free(cfg->Line);
         free(sys);
         return VLC_ENOMEM;
     }
@@ -181,9 +377,11 @@ static void Close(vlc_object_t *this)
 
     vlc_mutex_destroy( &sys->coefs_mutex );
 
+    filter_slices_Delete(sys->slices);
     for (int i = 0; i < 3; ++i) {
         free(cfg->Frame[i]);
     }
+    free(sys->horiz);
     free(cfg->Line);
     free(sys);
 }
@@ -220,26 +418,15 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-
-    if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
+    bool ok = Denoise(sys, &src->p[0], &dst->p[0], &cfg->Frame[0],
+                      sys->w[0], sys->h[0],
+                      cfg->Coefs[0], cfg->Coefs[0], cfg->Coefs[1]);
+    for (int i = 1; i < 3 && ok; i++)
+        ok = Denoise(sys, &src->p[i], &dst->p[i], &cfg->Frame[i],
+                     sys->w[i], sys->h[i],
+                     cfg->Coefs[2], cfg->Coefs[2], cfg->Coefs[3]);
+
+    if(unlikely(!ok))
     {
         picture_Release( src );
         picture_Release( dst );
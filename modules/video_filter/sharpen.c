@@ -42,7 +42,16 @@
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
+#include <vlc_cpu.h>
 #include "filter_picture.h"
+#include "slices.h"
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
 
 #define SIG_TEXT N_("Sharpen strength (0-2)")
 #define SIG_LONGTEXT N_("Set the Sharpen strength, between 0 and 2. Defaults to 0.05.")
@@ -88,11 +97,238 @@ static const char *const ppsz_filter_options[] = {
  * It describes the Sharpen specific properties of an output thread.
  *****************************************************************************/
 
+/* Sharpens a segment of a row, src pointing to the pixel below dst, with
+ * the rows above and below it at pitch pixels */
+typedef void (*sharpen_row_t)( void *dst, const void *src, ptrdiff_t pitch,
+                               unsigned count, int sigma );
+
 typedef struct
 {
     atomic_int sigma;
+    filter_slices_t *slices;
+    sharpen_row_t row, row_10bits;
 } filter_sys_t;
 
+/*****************************************************************************
+ * Row kernels
+ *****************************************************************************
+ * Each pixel gets 8 times itself minus its 8 neighbours, clipped and scaled
+ * by the strength. The SIMD kernels compute that in 16-bit lanes, and the
+ * scaling in 32-bit lanes, which gives the same pixels as the C code.
+ *****************************************************************************/
+#define SHARPEN_ROW_C(name, data_t, maxval) \
+static void name( void *restrict dst_, const void *restrict src_, \
+                  ptrdiff_t pitch, unsigned count, int sigma ) \
+{ \
+    data_t *restrict dst = dst_; \
+    const data_t *restrict src = src_; \
+    const int v1 = -1; \
+    const int v2 = 3; /* 2^3 = 8 */ \
+\
+    for( unsigned j = 0; j < count; j++ ) \
+    { \
+        const data_t *p = src + j; \
+        int pix = \
+            (p[-pitch - 1] * v1) + (p[-pitch] * v1) + (p[-pitch + 1] * v1) + \
+            (p[-1] * v1) + (p[0] << v2) + (p[1] * v1) + \
+            (p[pitch - 1] * v1) + (p[pitch] * v1) + (p[pitch + 1] * v1); \
+\
+        pix = (VLC_CLIP(pix, -(maxval), maxval) * sigma) >> 20; \
+        dst[j] = VLC_CLIP( p[0] + pix, 0, maxval ); \
+    } \
+}
+
+SHARPEN_ROW_C( SharpenRowC, uint8_t, 255 )
+SHARPEN_ROW_C( SharpenRow10C, uint16_t, 1023 )
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# define LOAD_SSE4_1_8(p) _mm_cvtepu8_epi16( _mm_loadl_epi64( (const __m128i *)(p) ) )
+# define LOAD_SSE4_1_16(p) _mm_loadu_si128( (const __m128i *)(p) )
+# define STORE_SSE4_1_8(p, v) _mm_storel_epi64( (__m128i *)(p), _mm_packus_epi16( v, v ) )
+# define STORE_SSE4_1_16(p, v) _mm_storeu_si128( (__m128i *)(p), v )
+
+# define SHARPEN_ROW_SSE4_1(name, data_t, maxval, load, store, fallback) \
+__attribute__ ((__target__ ("sse4.1"))) \
+static void name( void *restrict dst_, const void *restrict src_, \
+                  ptrdiff_t pitch, unsigned count, int sigma ) \
+{ \
+    data_t *restrict dst = dst_; \
+    const data_t *restrict src = src_; \
+    const __m128i max = _mm_set1_epi16( maxval ); \
+    const __m128i min = _mm_set1_epi16( -(maxval) ); \
+    const __m128i zero = _mm_setzero_si128(); \
+    const __m128i strength = _mm_set1_epi32( sigma ); \
+    unsigned j = 0; \
+\
+    for( ; j + 8 <= count; j += 8 ) \
+    { \
+        const data_t *p = src + j; \
+        const __m128i center = load( p ); \
+        __m128i sum = _mm_add_epi16( load( p - pitch - 1 ), load( p - pitch ) ); \
+        sum = _mm_add_epi16( sum, load( p - pitch + 1 ) ); \
+        sum = _mm_add_epi16( sum, load( p - 1 ) ); \
+        sum = _mm_add_epi16( sum, load( p + 1 ) ); \
+        sum = _mm_add_epi16( sum, load( p + pitch - 1 ) ); \
+        sum = _mm_add_epi16( sum, load( p + pitch ) ); \
+        sum = _mm_add_epi16( sum, load( p + pitch + 1 ) ); \
+\
+        __m128i pix = _mm_sub_epi16( _mm_slli_epi16( center, 3 ), sum ); \
+        pix = _mm_min_epi16( _mm_max_epi16( pix, min ), max ); \
+\
+        __m128i lo = _mm_cvtepi16_epi32( pix ); \
+        __m128i hi = _mm_cvtepi16_epi32( _mm_srli_si128( pix, 8 ) ); \
+        lo = _mm_srai_epi32( _mm_mullo_epi32( lo, strength ), 20 ); \
+        hi = _mm_srai_epi32( _mm_mullo_epi32( hi, strength ), 20 ); \
+        pix = _mm_add_epi16( center, _mm_packs_epi32( lo, hi ) ); \
+        pix = _mm_min_epi16( _mm_max_epi16( pix, zero ), max ); \
+        store( dst + j, pix ); \
+    } \
+    fallback( dst + j, src + j, pitch, count - j, sigma ); \
+}
+
+SHARPEN_ROW_SSE4_1( SharpenRowSSE4_1, uint8_t, 255, LOAD_SSE4_1_8,
+                    STORE_SSE4_1_8, SharpenRowC )
+SHARPEN_ROW_SSE4_1( SharpenRow10SSE4_1, uint16_t, 1023, LOAD_SSE4_1_16,
+                    STORE_SSE4_1_16, SharpenRow10C )
+#endif
+
+#if defined(HAVE_AVX2_INTRINSICS)
+# define LOAD_AVX2_8(p) _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)(p) ) )
+# define LOAD_AVX2_16(p) _mm256_loadu_si256( (const __m256i *)(p) )
+# define STORE_AVX2_8(p, v) _mm_storeu_si128( (__m128i *)(p), \
+    _mm256_castsi256_si128( _mm256_permute4x64_epi64( \
+        _mm256_packus_epi16( v, v ), 0xD8 ) ) )
+# define STORE_AVX2_16(p, v) _mm256_storeu_si256( (__m256i *)(p), v )
+
+# define SHARPEN_ROW_AVX2(name, data_t, maxval, load, store, fallback) \
+VLC_AVX2 \
+static void name( void *restrict dst_, const void *restrict src_, \
+                  ptrdiff_t pitch, unsigned count, int sigma ) \
+{ \
+    data_t *restrict dst = dst_; \
+    const data_t *restrict src = src_; \
+    const __m256i max = _mm256_set1_epi16( maxval ); \
+    const __m256i min = _mm256_set1_epi16( -(maxval) ); \
+    const __m256i zero = _mm256_setzero_si256(); \
+    const __m256i strength = _mm256_set1_epi32( sigma ); \
+    unsigned j = 0; \
+\
+    for( ; j + 16 <= count; j += 16 ) \
+    { \
+        const data_t *p = src + j; \
+        const __m256i center = load( p ); \
+        __m256i sum = _mm256_add_epi16( load( p - pitch - 1 ), \
+                                        load( p - pitch ) ); \
+        sum = _mm256_add_epi16( sum, load( p - pitch + 1 ) ); \
+        sum = _mm256_add_epi16( sum, load( p - 1 ) ); \
+        sum = _mm256_add_epi16( sum, load( p + 1 ) ); \
+        sum = _mm256_add_epi16( sum, load( p + pitch - 1 ) ); \
+        sum = _mm256_add_epi16( sum, load( p + pitch ) ); \
+        sum = _mm256_add_epi16( sum, load( p + pitch + 1 ) ); \
+\
+        __m256i pix = _mm256_sub_epi16( _mm256_slli_epi16( center, 3 ), \
+                                        sum ); \
+        pix = _mm256_min_epi16( _mm256_max_epi16( pix, min ), max ); \
+\
+        __m256i lo = _mm256_cvtepi16_epi32( _mm256_castsi256_si128( pix ) ); \
+        __m256i hi = _mm256_cvtepi16_epi32( \
+            _mm256_extracti128_si256( pix, 1 ) ); \
+        lo = _mm256_srai_epi32( _mm256_mullo_epi32( lo, strength ), 20 ); \
+        hi = _mm256_srai_epi32( _mm256_mullo_epi32( hi, strength ), 20 ); \
+        /* Packing works within 128-bit lanes */ \
+        pix = _mm256_permute4x64_epi64( _mm256_packs_epi32( lo, hi ), \
+                                        0xD8 ); \
+        pix = _mm256_add_epi16( center, pix ); \
+        pix = _mm256_min_epi16( _mm256_max_epi16( pix, zero ), max ); \
+        store( dst + j, pix ); \
+    } \
+    fallback( dst + j, src + j, pitch, count - j, sigma ); \
+}
+
+SHARPEN_ROW_AVX2( SharpenRowAVX2, uint8_t, 255, LOAD_AVX2_8, STORE_AVX2_8,
+                  SharpenRowC )
+SHARPEN_ROW_AVX2( SharpenRow10AVX2, uint16_t, 1023, LOAD_AVX2_16,
+                  STORE_AVX2_16, SharpenRow10C )
+#endif
+
+#if defined(__ARM_NEON)
+# define LOAD_NEON_8(p) vreinterpretq_s16_u16( vmovl_u8( vld1_u8( p ) ) )
+# define LOAD_NEON_16(p) vreinterpretq_s16_u16( vld1q_u16( p ) )
+# define STORE_NEON_8(p, v) vst1_u8( p, vqmovun_s16( v ) )
+# define STORE_NEON_16(p, v) vst1q_u16( p, vreinterpretq_u16_s16( v ) )
+
+# define SHARPEN_ROW_NEON(name, data_t, maxval, load, store, fallback) \
+static void name( void *restrict dst_, const void *restrict src_, \
+                  ptrdiff_t pitch, unsigned count, int sigma ) \
+{ \
+    data_t *restrict dst = dst_; \
+    const data_t *restrict src = src_; \
+    const int16x8_t max = vdupq_n_s16( maxval ); \
+    const int16x8_t min = vdupq_n_s16( -(maxval) ); \
+    const int16x8_t zero = vdupq_n_s16( 0 ); \
+    const int32x4_t strength = vdupq_n_s32( sigma ); \
+    unsigned j = 0; \
+\
+    for( ; j + 8 <= count; j += 8 ) \
+    { \
+        const data_t *p = src + j; \
+        const int16x8_t center = load( p ); \
+        int16x8_t sum = vaddq_s16( load( p - pitch - 1 ), load( p - pitch ) ); \
+        sum = vaddq_s16( sum, load( p - pitch + 1 ) ); \
+        sum = vaddq_s16( sum, load( p - 1 ) ); \
+        sum = vaddq_s16( sum, load( p + 1 ) ); \
+        sum = vaddq_s16( sum, load( p + pitch - 1 ) ); \
+        sum = vaddq_s16( sum, load( p + pitch ) ); \
+        sum = vaddq_s16( sum, load( p + pitch + 1 ) ); \
+\
+        int16x8_t pix = vsubq_s16( vshlq_n_s16( center, 3 ), sum ); \
+        pix = vminq_s16( vmaxq_s16( pix, min ), max ); \
+\
+        int32x4_t lo = vmovl_s16( vget_low_s16( pix ) ); \
+        int32x4_t hi = vmovl_s16( vget_high_s16( pix ) ); \
+        lo = vshrq_n_s32( vmulq_s32( lo, strength ), 20 ); \
+        hi = vshrq_n_s32( vmulq_s32( hi, strength ), 20 ); \
+        pix = vaddq_s16( center, vcombine_s16( vmovn_s32( lo ), \
+                                               vmovn_s32( hi ) ) ); \
+        pix = vminq_s16( vmaxq_s16( pix, zero ), max ); \
+        store( dst + j, pix ); \
+    } \
+    fallback( dst + j, src + j, pitch, count - j, sigma ); \
+}
+
+SHARPEN_ROW_NEON( SharpenRowNEON, uint8_t, 255, LOAD_NEON_8, STORE_NEON_8,
+                  SharpenRowC )
+SHARPEN_ROW_NEON( SharpenRow10NEON, uint16_t, 1023, LOAD_NEON_16,
+                  STORE_NEON_16, SharpenRow10C )
+#endif
+
+static void GetRowKernels( sharpen_row_t *row, sharpen_row_t *row_10bits )
+{
+    *row = SharpenRowC;
+    *row_10bits = SharpenRow10C;
+#if defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE4_1() )
+    {
+        *row = SharpenRowSSE4_1;
+        *row_10bits = SharpenRow10SSE4_1;
+    }
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+    {
+        *row = SharpenRowAVX2;
+        *row_10bits = SharpenRow10AVX2;
+    }
+#endif
+#if defined(__ARM_NEON)
+    if( vlc_CPU_ARM_NEON() )
+    {
+        *row = SharpenRowNEON;
+        *row_10bits = SharpenRow10NEON;
+    }
+#endif
+}
+
 /*****************************************************************************
  * Create: allocates Sharpen video thread output method
  *****************************************************************************
@@ -116,6 +352,13 @@ static int Create( vlc_object_t *p_this )
     filter_sys_t *p_sys = malloc( sizeof( filter_sys_t ) );
     if( p_sys == NULL )
         return VLC_ENOMEM;
+    p_sys->slices = filter_slices_New( 0 );
+    if( p_sys->slices == NULL )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    GetRowKernels( &p_sys->row, &p_sys->row_10bits );
     p_filter->p_sys = p_sys;
 
     p_filter->pf_video_filter = Filter;
@@ -145,6 +388,7 @@ static void Destroy( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     var_DelCallback( p_filter, FILTER_PREFIX "sigma", SharpenCallback, p_sys );
+    filter_slices_Delete( p_sys->slices );
     free( p_sys );
 }
 
@@ -159,56 +403,42 @@ static void Destroy( vlc_object_t *p_this )
 #define IS_YUV_420_10BITS(fmt) (fmt == VLC_CODEC_I420_10L ||    \
                                 fmt == VLC_CODEC_I420_10B)
 
-#define SHARPEN_FRAME(maxval, data_t)                                   \
-    do                                                                  \
-    {                                                                   \
-        assert((maxval) >= 0);                                          \
-        data_t *restrict p_src = (data_t *)p_pic->p[Y_PLANE].p_pixels;  \
-        data_t *restrict p_out = (data_t *)p_outpic->p[Y_PLANE].p_pixels; \
-        const unsigned data_sz = sizeof(data_t);                        \
-        const int i_src_line_len = p_outpic->p[Y_PLANE].i_pitch / data_sz; \
-        const int i_out_line_len = p_pic->p[Y_PLANE].i_pitch / data_sz; \
-        const int sigma = atomic_load(&p_sys->sigma);         \
-                                                                        \
-        memcpy(p_out, p_src, i_visible_pitch);                          \
-                                                                        \
-        for( unsigned i = 1; i < i_visible_lines - 1; i++ )             \
-        {                                                               \
-            p_out[i * i_out_line_len] = p_src[i * i_src_line_len];      \
-                                                                        \
-            for( unsigned j = data_sz; j < i_visible_pitch - 1; j++ )   \
-            {                                                           \
-                const int line_idx_1 = (i - 1) * i_src_line_len;        \
-                const int line_idx_2 = i * i_src_line_len;              \
-                const int line_idx_3 = (i + 1) * i_src_line_len;        \
-                int pix =                                               \
-                    (p_src[line_idx_1 + j - 1] * v1) +                  \
-                    (p_src[line_idx_1 + j    ] * v1) +                  \
-                    (p_src[line_idx_1 + j + 1] * v1) +                  \
-                    (p_src[line_idx_2 + j - 1] * v1) +                  \
-                    (p_src[line_idx_2 + j    ] << v2) +                 \
-                    (p_src[line_idx_2 + j + 1] * v1) +                  \
-                    (p_src[line_idx_3 + j - 1] * v1) +                  \
-                    (p_src[line_idx_3 + j    ] * v1) +                  \
-                    (p_src[line_idx_3 + j + 1] * v1);                   \
-                                                                        \
-                pix = (VLC_CLIP(pix, -(maxval), maxval) * sigma) >> 20; \
-                p_out[i * i_out_line_len + j] =                         \
-                    VLC_CLIP( p_src[line_idx_2 + j] + pix, 0, maxval);  \
-            }                                                           \
-            p_out[i * i_out_line_len + i_visible_pitch / data_sz - 1] = \
-                p_src[i * i_src_line_len + i_visible_pitch / data_sz - 1];  \
-        }                                                               \
-        memcpy(&p_out[(i_visible_lines - 1) * i_out_line_len],          \
-               &p_src[(i_visible_lines - 1) * i_src_line_len],          \
-               i_visible_pitch);                                        \
-    } while (0)
+struct sharpen_job
+{
+    sharpen_row_t row;
+    const uint8_t *src;
+    uint8_t *dst;
+    ptrdiff_t src_pitch, dst_pitch;
+    unsigned lines, width, pixel_size;
+    int sigma;
+    unsigned slices;
+};
+
+/* Sharpens a band of rows, but the first and the last rows of the plane */
+static void SharpenSlice( void *opaque, unsigned slice )
+{
+    const struct sharpen_job *job = opaque;
+    const unsigned size = job->pixel_size;
+    unsigned begin, end;
+
+    filter_slices_Bounds( slice, job->slices, job->lines - 2, 1,
+                          &begin, &end );
+    for( unsigned i = begin + 1; i < end + 1; i++ )
+    {
+        const uint8_t *src = job->src + i * job->src_pitch;
+        uint8_t *dst = job->dst + i * job->dst_pitch;
+
+        memcpy( dst, src, size );
+        job->row( dst + size, src + size, job->src_pitch / size,
+                  job->width - 2, job->sigma );
+        memcpy( dst + (job->width - 1) * size,
+                src + (job->width - 1) * size, size );
+    }
+}
 
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     picture_t *p_outpic;
-    const int v1 = -1;
-    const int v2 = 3; /* 2^3 = 8 */
     const unsigned i_visible_lines = p_pic->p[Y_PLANE].i_visible_lines;
     const unsigned i_visible_pitch = p_pic->p[Y_PLANE].i_visible_pitch;
 
@@ -220,11 +450,28 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     }
 
     filter_sys_t *p_sys = p_filter->p_sys;
-
-    if (!IS_YUV_420_10BITS(p_pic->format.i_chroma))
-        SHARPEN_FRAME(255, uint8_t);
+    const bool b_10bits = IS_YUV_420_10BITS(p_pic->format.i_chroma);
+    struct sharpen_job job = {
+        .row = b_10bits ? p_sys->row_10bits : p_sys->row,
+        .src = p_pic->p[Y_PLANE].p_pixels,
+        .dst = p_outpic->p[Y_PLANE].p_pixels,
+        .src_pitch = p_pic->p[Y_PLANE].i_pitch,
+        .dst_pitch = p_outpic->p[Y_PLANE].i_pitch,
+        .lines = i_visible_lines,
+        .pixel_size = b_10bits ? 2 : 1,
+        .sigma = atomic_load( &p_sys->sigma ),
+        .slices = filter_slices_Threads( p_sys->slices ),
+    };
+    job.width = i_visible_pitch / job.pixel_size;
+
+    memcpy( job.dst, job.src, i_visible_pitch );
+    if( i_visible_lines > 2 && job.width > 2 )
+        filter_slices_Run( p_sys->slices, SharpenSlice, &job, job.slices );
     else
-        SHARPEN_FRAME(1023, uint16_t);
+        plane_CopyPixels( &p_outpic->p[Y_PLANE], &p_pic->p[Y_PLANE] );
+    memcpy( job.dst + (i_visible_lines - 1) * job.dst_pitch,
+            job.src + (i_visible_lines - 1) * job.src_pitch,
+            i_visible_pitch );
 
     plane_CopyPixels( &p_outpic->p[U_PLANE], &p_pic->p[U_PLANE] );
     plane_CopyPixels( &p_outpic->p[V_PLANE], &p_pic->p[V_PLANE] );
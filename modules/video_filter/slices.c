@@ -0,0 +1,156 @@
+/*****************************************************************************
+ * slices.c: Run the slices of a picture on worker threads
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include <vlc_common.h>
+
+#include "slices.h"
+
+/* More threads hardly help with the memory bandwidth */
+#define SLICES_MAX_THREADS 16
+
+struct filter_slices
+{
+    vlc_mutex_t lock;
+    vlc_cond_t wait; /* signaled on a new run, or to quit */
+    vlc_cond_t done; /* signaled when the slices of a run are processed */
+    bool quit;
+    unsigned run; /* sequence number of the current run */
+
+    void (*fn)(void *, unsigned);
+    void *opaque;
+    unsigned count; /* slices of the current run */
+    unsigned next; /* next slice to process */
+    unsigned pending; /* slices not processed yet */
+
+    unsigned workers;
+    vlc_thread_t threads[];
+};
+
+/* Processes the slices left, with the lock held */
+static void RunSlices(filter_slices_t *s)
+{
+    while (s->next < s->count)
+    {
+        const unsigned slice = s->next++;
+
+        vlc_mutex_unlock(&s->lock);
+        s->fn(s->opaque, slice);
+        vlc_mutex_lock(&s->lock);
+
+        if (--s->pending == 0)
+            vlc_cond_signal(&s->done);
+    }
+}
+
+static void *Worker(void *data)
+{
+    filter_slices_t *s = data;
+    unsigned run = 0;
+
+    vlc_mutex_lock(&s->lock);
+    for (;;)
+    {
+        while (!s->quit && s->run == run)
+            vlc_cond_wait(&s->wait, &s->lock);
+        if (s->quit)
+            break;
+        run = s->run;
+        RunSlices(s);
+    }
+    vlc_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+filter_slices_t *filter_slices_New(unsigned threads)
+{
+    if (threads == 0)
+        threads = vlc_GetCPUCount();
+    threads = VLC_CLIP(threads, 1, SLICES_MAX_THREADS);
+
+    filter_slices_t *s = malloc(sizeof (*s)
+                                + (threads - 1) * sizeof (vlc_thread_t));
+    if (unlikely(s == NULL))
+        return NULL;
+
+    vlc_mutex_init(&s->lock);
+    vlc_cond_init(&s->wait);
+    vlc_cond_init(&s->done);
+    s->quit = false;
+    s->run = 0;
+    s->count = s->next = s->pending = 0;
+
+    for (s->workers = 0; s->workers < threads - 1; s->workers++)
+        if (vlc_clone(&s->threads[s->workers], Worker, s,
+                      VLC_THREAD_PRIORITY_VIDEO))
+            break; /* run with the threads created so far */
+    return s;
+}
+
+void filter_slices_Delete(filter_slices_t *s)
+{
+    vlc_mutex_lock(&s->lock);
+    s->quit = true;
+    vlc_cond_broadcast(&s->wait);
+    vlc_mutex_unlock(&s->lock);
+
+    for (unsigned i = 0; i < s->workers; i++)
+        vlc_join(s->threads[i], NULL);
+
+    vlc_cond_destroy(&s->done);
+    vlc_cond_destroy(&s->wait);
+    vlc_mutex_destroy(&s->lock);
+    free(s);
+}
+
+unsigned filter_slices_Threads(const filter_slices_t *s)
+{
+    return s->workers + 1;
+}
+
+void filter_slices_Run(filter_slices_t *s, void (*fn)(void *, unsigned),
+                       void *opaque, unsigned count)
+{
+    if (s->workers == 0 || count <= 1)
+    {
+        for (unsigned i = 0; i < count; i++)
+            fn(opaque, i);
+        return;
+    }
+
+    vlc_mutex_lock(&s->lock);
+    s->fn = fn;
+    s->opaque = opaque;
+    s->count = count;
+    s->next = 0;
+    s->pending = count;
+    s->run++;
+    vlc_cond_broadcast(&s->wait);
+
+    RunSlices(s);
+    while (s->pending > 0)
+        vlc_cond_wait(&s->done, &s->lock);
+    vlc_mutex_unlock(&s->lock);
+}
@@ -0,0 +1,70 @@
+/*****************************************************************************
+ * slices.h: Run the slices of a picture on worker threads
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VIDEO_FILTER_SLICES_H
+#define VLC_VIDEO_FILTER_SLICES_H
+
+/**
+ * Worker threads processing independent slices of a picture, such as bands
+ * of rows, in parallel with the calling thread.
+ *
+ * The workers are created once, and wait for the slices of the next picture
+ * meanwhile.
+ */
+typedef struct filter_slices filter_slices_t;
+
+/**
+ * Creates worker threads.
+ *
+ * \param threads number of threads, including the calling thread, or 0 for
+ * one per CPU
+ * \return the workers, or NULL on error
+ */
+filter_slices_t *filter_slices_New(unsigned threads);
+void filter_slices_Delete(filter_slices_t *);
+
+/** Gets the number of threads, including the calling thread */
+unsigned filter_slices_Threads(const filter_slices_t *);
+
+/**
+ * Processes slices.
+ *
+ * Calls fn(opaque, slice) once for each slice from 0 to count - 1, on any
+ * thread, and returns once all of them are processed.
+ */
+void filter_slices_Run(filter_slices_t *, void (*fn)(void *, unsigned),
+                       void *opaque, unsigned count);
+
+/**
+ * Gets the bounds of a slice of a range split evenly.
+ *
+ * \param align alignment of the bounds but the last one
+ */
+static inline void filter_slices_Bounds(unsigned slice, unsigned count,
+                                        unsigned length, unsigned align,
+                                        unsigned *begin, unsigned *end)
+{
+    unsigned size = (length + count - 1) / count;
+    size = (size + align - 1) / align * align;
+    *begin = slice * size < length ? slice * size : length;
+    *end = *begin + size < length ? *begin + size : length;
+}
+
+#endif
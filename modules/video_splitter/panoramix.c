@@ -36,6 +36,8 @@
 #include <vlc_video_splitter.h>
 #include <vlc_vout_window.h>
 
+#include "../video_filter/slices.h"
+
 #define OVERLAP
 
 #ifdef OVERLAP
@@ -258,6 +260,15 @@ typedef struct
 
 } panoramix_output_t;
 
+/* Outputs without black borders nor blending are the source unmodified */
+static inline bool IsFiltered( const panoramix_filter_t *p_cfg )
+{
+    return p_cfg->black.i_left || p_cfg->black.i_right ||
+           p_cfg->black.i_top || p_cfg->black.i_bottom ||
+           p_cfg->attenuate.i_left || p_cfg->attenuate.i_right ||
+           p_cfg->attenuate.i_top || p_cfg->attenuate.i_bottom;
+}
+
 typedef struct
 {
     vlc_fourcc_t i_chroma;
@@ -293,6 +304,8 @@ typedef struct
     int i_col;
     int i_row;
     panoramix_output_t pp_output[COL_MAX][ROW_MAX]; /* [x][y] */
+
+    filter_slices_t *p_slices; /* NULL if no output is filtered */
 } video_splitter_sys_t;
 
 /* */
@@ -313,6 +326,7 @@ static void FilterPlanar( uint8_t *p_out, int i_out_pitch,
                           const uint8_t *p_in, int i_in_pitch,
                           int i_copy_pitch,
                           int i_copy_lines,
+                          int i_begin, int i_end,
                           int i_pixel_black,
                           const panoramix_filter_t *,
                           uint8_t p_lut[ACCURACY + 1][256],
@@ -687,6 +701,25 @@ static int Open( vlc_object_t *p_this )
         }
     }
 
+    /* The outputs to blend are filtered by worker threads */
+    bool b_filtered = false;
+    for( int y = 0; y < p_sys->i_row; y++ )
+        for( int x = 0; x < p_sys->i_col; x++ )
+            if( p_sys->pp_output[x][y].b_active &&
+                IsFiltered( &p_sys->pp_output[x][y].filter ) )
+                b_filtered = true;
+
+    p_sys->p_slices = NULL;
+    if( b_filtered )
+    {
+        p_sys->p_slices = filter_slices_New( 0 );
+        if( !p_sys->p_slices )
+        {
+            free( p_splitter->p_output );
+            free( p_sys );
+            return VLC_ENOMEM;
+        }
+    }
 
     /* */
     p_splitter->pf_filter = Filter;
@@ -703,22 +736,94 @@ static void Close( vlc_object_t *p_this )
     video_splitter_t *p_splitter = (video_splitter_t*)p_this;
     video_splitter_sys_t *p_sys = p_splitter->p_sys;
 
+    if( p_sys->p_slices )
+        filter_slices_Delete( p_sys->p_slices );
     free( p_splitter->p_output );
     free( p_sys );
 }
 
+struct panoramix_job
+{
+    video_splitter_sys_t *p_sys;
+    const picture_t *p_src;
+    picture_t **pp_dst;
+
+    const panoramix_output_t *pp_output[COL_MAX*ROW_MAX]; /* to filter */
+    unsigned i_bands; /* per output */
+};
+
+/**
+ * It filters a band of lines of an output
+ */
+static void FilterSlice( void *opaque, unsigned i_slice )
+{
+    const struct panoramix_job *p_job = opaque;
+    video_splitter_sys_t *p_sys = p_job->p_sys;
+    const panoramix_output_t *p_output = p_job->pp_output[i_slice / p_job->i_bands];
+    const picture_t *p_src = p_job->p_src;
+    picture_t *p_dst = p_job->pp_dst[p_output->i_output];
+
+    for( int i_plane = 0; i_plane < p_src->i_planes; i_plane++ )
+    {
+        const int i_div_w = p_sys->p_chroma->pi_div_w[i_plane];
+        const int i_div_h = p_sys->p_chroma->pi_div_h[i_plane];
+
+        if( !i_div_w || !i_div_h )
+            continue;
+
+        const plane_t *p_srcp = &p_src->p[i_plane];
+        const plane_t *p_dstp = &p_dst->p[i_plane];
+
+        /* */
+        panoramix_filter_t filter;
+        filter.black.i_right  = p_output->filter.black.i_right / i_div_w;
+        filter.black.i_left   = p_output->filter.black.i_left / i_div_w;
+        filter.black.i_top    = p_output->filter.black.i_top / i_div_h;
+        filter.black.i_bottom = p_output->filter.black.i_bottom / i_div_h;
+
+        filter.attenuate.i_right  = p_output->filter.attenuate.i_right / i_div_w;
+        filter.attenuate.i_left   = p_output->filter.attenuate.i_left / i_div_w;
+        filter.attenuate.i_top    = p_output->filter.attenuate.i_top / i_div_h;
+        filter.attenuate.i_bottom = p_output->filter.attenuate.i_bottom / i_div_h;
+
+        /* */
+        const int i_x = p_output->i_src_x/i_div_w;
+        const int i_y = p_output->i_src_y/i_div_h;
+        const int i_copy_lines = p_output->i_src_height/i_div_h;
+        unsigned i_begin, i_end;
+
+        filter_slices_Bounds( i_slice % p_job->i_bands, p_job->i_bands,
+                              filter.black.i_top + i_copy_lines + filter.black.i_bottom,
+                              1, &i_begin, &i_end );
+
+        assert( p_sys->p_chroma->b_planar );
+        FilterPlanar( p_dstp->p_pixels, p_dstp->i_pitch,
+                      &p_srcp->p_pixels[i_y * p_srcp->i_pitch + i_x * p_srcp->i_pixel_pitch], p_srcp->i_pitch,
+                      p_output->i_src_width/i_div_w, i_copy_lines,
+                      i_begin, i_end,
+                      p_sys->p_chroma->pi_black[i_plane],
+                      &filter,
+                      p_sys->p_lut[i_plane],
+                      p_sys->lambdav[i_plane],
+                      p_sys->lambdah[i_plane] );
+    }
+}
+
 /**
  * It creates multiples pictures from the source one
  */
 static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t *p_src )
 {
     video_splitter_sys_t *p_sys = p_splitter->p_sys;
+    struct panoramix_job job = {
+        .p_sys = p_sys,
+        .p_src = p_src,
+        .pp_dst = pp_dst,
+    };
+    unsigned i_filtered = 0;
 
-    if( video_splitter_NewPicture( p_splitter, pp_dst ) )
-    {
-        picture_Release( p_src );
-        return VLC_EGENERIC;
-    }
+    for( int i = 0; i < p_splitter->i_output; i++ )
+        pp_dst[i] = NULL;
 
     for( int y = 0; y < p_sys->i_row; y++ )
     {
@@ -728,53 +833,42 @@ static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t
             if( !p_output->b_active )
                 continue;
 
-            /* */
-            picture_t *p_dst = pp_dst[p_output->i_output];
-
-            /* */
-            picture_CopyProperties( p_dst, p_src );
-
-            /* */
-            for( int i_plane = 0; i_plane < p_src->i_planes; i_plane++ )
+            /* The outputs without blending reference the source picture */
+            picture_t *p_dst;
+            if( IsFiltered( &p_output->filter ) )
             {
-                const int i_div_w = p_sys->p_chroma->pi_div_w[i_plane];
-                const int i_div_h = p_sys->p_chroma->pi_div_h[i_plane];
-
-                if( !i_div_w || !i_div_h )
-                    continue;
-
-                const plane_t *p_srcp = &p_src->p[i_plane];
-                const plane_t *p_dstp = &p_dst->p[i_plane];
-
-                /* */
-                panoramix_filter_t filter;
-                filter.black.i_right  = p_output->filter.black.i_right / i_div_w;
-                filter.black.i_left   = p_output->filter.black.i_left / i_div_w;
-                filter.black.i_top    = p_output->filter.black.i_top / i_div_h;
-                filter.black.i_bottom = p_output->filter.black.i_bottom / i_div_h;
-
-                filter.attenuate.i_right  = p_output->filter.attenuate.i_right / i_div_w;
-                filter.attenuate.i_left   = p_output->filter.attenuate.i_left / i_div_w;
-                filter.attenuate.i_top    = p_output->filter.attenuate.i_top / i_div_h;
-                filter.attenuate.i_bottom = p_output->filter.attenuate.i_bottom / i_div_h;
-
-                /* */
-                const int i_x = p_output->i_src_x/i_div_w;
-                const int i_y = p_output->i_src_y/i_div_h;
-
-                assert( p_sys->p_chroma->b_planar );
-                FilterPlanar( p_dstp->p_pixels, p_dstp->i_pitch,
-                              &p_srcp->p_pixels[i_y * p_srcp->i_pitch + i_x * p_srcp->i_pixel_pitch], p_srcp->i_pitch,
-                              p_output->i_src_width/i_div_w, p_output->i_src_height/i_div_h,
-                              p_sys->p_chroma->pi_black[i_plane],
-                              &filter,
-                              p_sys->p_lut[i_plane],
-                              p_sys->lambdav[i_plane],
-                              p_sys->lambdah[i_plane] );
+                p_dst = picture_NewFromFormat( &p_splitter->p_output[p_output->i_output].fmt );
+                if( p_dst )
+                    picture_CopyProperties( p_dst, p_src );
+                job.pp_output[i_filtered++] = p_output;
             }
+            else
+                p_dst = video_splitter_NewCrop( p_splitter, p_output->i_output,
+                                                p_src, p_output->i_src_x,
+                                                p_output->i_src_y );
+            if( !p_dst )
+            {
+                for( int i = 0; i < p_splitter->i_output; i++ )
+                    if( pp_dst[i] )
+                        picture_Release( pp_dst[i] );
+                msg_Warn( p_splitter, "can't get output pictures" );
+                picture_Release( p_src );
+                return VLC_EGENERIC;
+            }
+            pp_dst[p_output->i_output] = p_dst;
         }
     }
 
+    if( i_filtered > 0 )
+    {
+        /* Split the outputs in bands of lines when there are fewer of them
+         * than threads */
+        const unsigned i_threads = filter_slices_Threads( p_sys->p_slices );
+        job.i_bands = (i_threads + i_filtered - 1) / i_filtered;
+        filter_slices_Run( p_sys->p_slices, FilterSlice, &job,
+                           i_filtered * job.i_bands );
+    }
+
     picture_Release( p_src );
     return VLC_SUCCESS;
 }
@@ -953,12 +1047,13 @@ static int Configuration( panoramix_output_t pp_output[ROW_MAX][COL_MAX],
 }
 
 /**
- * It filters a video plane
+ * It filters the lines from i_begin to i_end of a video plane
  */
 static void FilterPlanar( uint8_t *p_out, int i_out_pitch,
                           const uint8_t *p_in, int i_in_pitch,
                           int i_copy_pitch,
                           int i_copy_lines,
+                          int i_begin, int i_end,
                           int i_pixel_black,
                           const panoramix_filter_t *p_cfg,
                           uint8_t p_lut[ACCURACY + 1][256],
@@ -973,16 +1068,19 @@ static void FilterPlanar( uint8_t *p_out, int i_out_pitch,
 
     const int i_out_width = p_cfg->black.i_left + i_copy_pitch + p_cfg->black.i_right;
 
-    /* Top black border */
-    for( int b = 0; b < p_cfg->black.i_top; b++ )
+    p_out += i_begin * i_out_pitch;
+    for( int i_line = i_begin; i_line < i_end; i_line++, p_out += i_out_pitch )
     {
-        memset( p_out, i_pixel_black, i_out_width );
-        p_out += i_out_pitch;
-    }
+        const int y = i_line - p_cfg->black.i_top;
 
-    for( int y = 0; y < i_copy_lines; y++ )
-    {
-        const uint8_t *p_src = p_in;
+        /* Top and bottom black borders */
+        if( y < 0 || y >= i_copy_lines )
+        {
+            memset( p_out, i_pixel_black, i_out_width );
+            continue;
+        }
+
+        const uint8_t *p_src = &p_in[y * i_in_pitch];
         uint8_t *p_dst = p_out;
 
         /* Black border on the left */
@@ -1020,16 +1118,6 @@ static void FilterPlanar( uint8_t *p_out, int i_out_pitch,
             for( int i = 0; i < i_out_width; i++)
                 p_out[i] = p_lut[i_index][p_out[i]];
         }
-
-        /* */
-        p_in  += i_in_pitch;
-        p_out += i_out_pitch;
-    }
-    /* Bottom black border */
-    for( int b = 0; b < p_cfg->black.i_bottom; b++ )
-    {
-        memset( p_out, i_pixel_black, i_out_width );
-        p_out += i_out_pitch;
     }
 }
 
@@ -387,11 +387,9 @@ static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t
 {
     video_splitter_sys_t *p_sys = p_splitter->p_sys;
 
-    if( video_splitter_NewPicture( p_splitter, pp_dst ) )
-    {
-        picture_Release( p_src );
-        return VLC_EGENERIC;
-    }
+    /* The outputs reference the source picture, rather than copying it */
+    for( int i = 0; i < p_splitter->i_output; i++ )
+        pp_dst[i] = NULL;
 
     for( int y = 0; y < p_sys->i_row; y++ )
     {
@@ -401,20 +399,21 @@ static int Filter( video_splitter_t *p_splitter, picture_t *pp_dst[], picture_t
             if( !p_output->b_active )
                 continue;
 
-            picture_t *p_dst = pp_dst[p_output->i_output];
-
-            /* */
-            picture_t tmp = *p_src;
-            for( int i = 0; i < tmp.i_planes; i++ )
+            picture_t *p_dst = video_splitter_NewCrop( p_splitter,
+                                                       p_output->i_output,
+                                                       p_src,
+                                                       p_output->i_left,
+                                                       p_output->i_top );
+            if( !p_dst )
             {
-                plane_t *p0 = &tmp.p[0];
-                plane_t *p = &tmp.p[i];
-                const int i_y = p_output->i_top  * p->i_visible_pitch / p0->i_visible_pitch;
-                const int i_x = p_output->i_left * p->i_visible_lines / p0->i_visible_lines;
-
-                p->p_pixels += i_y * p->i_pitch + ( i_x - (i_x % p->i_pixel_pitch));
+                for( int i = 0; i < p_splitter->i_output; i++ )
+                    if( pp_dst[i] )
+                        picture_Release( pp_dst[i] );
+                msg_Warn( p_splitter, "can't get output pictures" );
+                picture_Release( p_src );
+                return VLC_EGENERIC;
             }
-            picture_Copy( p_dst, &tmp );
+            pp_dst[p_output->i_output] = p_dst;
         }
     }
 
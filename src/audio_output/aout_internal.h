@@ -106,9 +106,10 @@ static inline aout_owner_t *aout_owner (audio_output_t *aout)
 /* From mixer.c : */
 aout_volume_t *aout_volume_New(vlc_object_t *, const audio_replay_gain_t *);
 #define aout_volume_New(o, g) aout_volume_New(VLC_OBJECT(o), g)
-int aout_volume_SetFormat(aout_volume_t *, vlc_fourcc_t);
+int aout_volume_SetFormat(aout_volume_t *, const audio_sample_format_t *);
 void aout_volume_SetVolume(aout_volume_t *, float);
 int aout_volume_Amplify(aout_volume_t *, block_t *);
+int aout_volume_GetFactor(aout_volume_t *, float *);
 void aout_volume_Delete(aout_volume_t *);
 
 
@@ -180,5 +181,8 @@ aout_filters_t *aout_FiltersNewWithClock(vlc_object_t *, const vlc_clock_t *,
 void aout_FiltersResetClock(aout_filters_t *filters);
 void aout_FiltersSetClockDelay(aout_filters_t *filters, vlc_tick_t delay);
 bool aout_FiltersCanResample (aout_filters_t *filters);
+/* Applies the software volume in the last filter, instead of the volume
+ * module. Returns false if the filters cannot. */
+bool aout_FiltersSetAmplification (aout_filters_t *filters, float amp);
 
 #endif /* !LIBVLC_AOUT_INTERNAL_H */
@@ -98,7 +98,7 @@ int aout_DecNew(audio_output_t *p_aout, const audio_sample_format_t *p_format,
     owner->filters_cfg = AOUT_FILTERS_CFG_INIT;
     if (aout_OutputNew (p_aout, &owner->mixer_format, &owner->filters_cfg))
         goto error;
-    aout_volume_SetFormat (owner->volume, owner->mixer_format.i_format);
+    aout_volume_SetFormat (owner->volume, &owner->mixer_format);
 
     /* Create the audio filtering "input" pipeline */
     owner->filters = aout_FiltersNewWithClock(VLC_OBJECT(p_aout), clock, p_format,
@@ -163,8 +163,7 @@ static int aout_CheckReady (audio_output_t *aout)
             owner->filters_cfg = AOUT_FILTERS_CFG_INIT;
             if (aout_OutputNew (aout, &owner->mixer_format, &owner->filters_cfg))
                 owner->mixer_format.i_format = 0;
-            aout_volume_SetFormat (owner->volume,
-                                   owner->mixer_format.i_format);
+            aout_volume_SetFormat (owner->volume, &owner->mixer_format);
 
             /* Notify the decoder that the aout changed in order to try a new
              * suitable codec (like an HDMI audio format). However, keep the
@@ -432,6 +431,11 @@ int aout_DecPlay(audio_output_t *aout, block_t *block)
         owner->original_pts = block->i_pts;
     }
 
+    /* Software volume, in the last pass of the filters if possible */
+    float amp;
+    bool amplified = aout_volume_GetFactor (owner->volume, &amp) == 0
+                  && aout_FiltersSetAmplification (owner->filters, amp);
+
     block = aout_FiltersPlay(owner->filters, block, owner->sync.rate);
     if (block == NULL)
         return ret;
@@ -439,8 +443,8 @@ int aout_DecPlay(audio_output_t *aout, block_t *block)
     const vlc_tick_t original_pts = owner->original_pts;
     owner->original_pts = VLC_TICK_INVALID;
 
-    /* Software volume */
-    aout_volume_Amplify (owner->volume, block);
+    if (!amplified)
+        aout_volume_Amplify (owner->volume, block);
 
     /* Update delay */
     if (owner->sync.request_delay != owner->sync.delay)
@@ -35,6 +35,7 @@
 #include <vlc_dialog.h>
 #include <vlc_modules.h>
 #include <vlc_aout.h>
+#include <vlc_aout_volume.h>
 #include <vlc_filter.h>
 #include <libvlc.h>
 #include "aout_internal.h"
@@ -106,6 +107,15 @@ static filter_t *FindResampler (vlc_object_t *obj,
     return filter;
 }
 
+/**
+ * Processing time counters of a filter.
+ */
+struct aout_filter_stats
+{
+    vlc_tick_t time; /**< Total processing time */
+    uint64_t buffers; /**< Number of processed buffers */
+};
+
 /**
  * Destroys a chain of audio filters.
  */
@@ -276,16 +286,21 @@ error:
  * Filters an audio buffer through a chain of filters.
  */
 static block_t *aout_FiltersPipelinePlay(filter_t *const *filters,
+                                         struct aout_filter_stats *stats,
                                          unsigned count, block_t *block)
 {
     /* TODO: use filter chain */
     for (unsigned i = 0; (i < count) && (block != NULL); i++)
     {
         filter_t *filter = filters[i];
+        vlc_tick_t start = vlc_tick_now();
 
         /* Please note that p_block->i_nb_samples & i_buffer
          * shall be set by the filter plug-in. */
         block = filter->pf_audio_filter (filter, block);
+
+        stats[i].time += vlc_tick_now() - start;
+        stats[i].buffers++;
     }
     return block;
 }
@@ -295,6 +310,7 @@ static block_t *aout_FiltersPipelinePlay(filter_t *const *filters,
  * Drain the chain of filters.
  */
 static block_t *aout_FiltersPipelineDrain(filter_t *const *filters,
+                                          struct aout_filter_stats *stats,
                                           unsigned count)
 {
     block_t *chain = NULL;
@@ -310,6 +326,7 @@ static block_t *aout_FiltersPipelineDrain(filter_t *const *filters,
              * chain of filters  */
             if (i + 1 < count)
                 block = aout_FiltersPipelinePlay (&filters[i + 1],
+                                                  &stats[i + 1],
                                                   count - i - 1, block);
             if (block)
                 block_ChainAppend (&chain, block);
@@ -340,6 +357,185 @@ static void aout_FiltersPipelineChangeViewpoint(filter_t *const *filters,
         filter_ChangeViewpoint (filters[i], vp);
 }
 
+/**
+ * Output stage of the filters.
+ *
+ * It converts the float samples out of the resampler to the output sample
+ * format, reorders the channels and applies the software volume, in a single
+ * pass and in place, instead of a converter, a remap filter and the audio
+ * volume module each going through the buffer. When the volume changes, the
+ * gain ramps to the new volume over the next buffer.
+ */
+struct aout_output_stage
+{
+    vlc_fourcc_t format; /**< Output sample format, 0 if no stage */
+    unsigned channels;
+    bool remap; /**< Whether the channels are reordered */
+    uint8_t map[AOUT_CHAN_MAX]; /**< Output position of each channel */
+    float amp; /**< Software volume of the next frame */
+    float target; /**< Software volume to ramp to */
+    bool amp_set; /**< Whether the software volume was set */
+};
+
+static inline float OutputFL32(float s)
+{
+    return s;
+}
+
+static inline int16_t OutputS16N(float s)
+{
+    /* This is Walken's trick based on IEEE float format. */
+    union { float f; int32_t i; } u;
+    u.f = s + 384.f;
+    if (u.i > 0x43c07fff)
+        return 32767;
+    if (u.i < 0x43bf8000)
+        return -32768;
+    return u.i - 0x43c00000;
+}
+
+static inline int32_t OutputS32N(float s)
+{
+    s *= 2147483648.f;
+    if (s >= 2147483647.f)
+        return 2147483647;
+    if (s <= -2147483648.f)
+        return -2147483648;
+    return lroundf(s);
+}
+
+static inline uint8_t OutputU8(float s)
+{
+    s *= 128.f;
+    if (s >= 127.f)
+        return 255;
+    if (s <= -128.f)
+        return 0;
+    return lroundf(s) + 128;
+}
+
+/* The output samples are never larger than the input ones: each output frame
+ * is written at or before the input frame it comes from. */
+#define OUTPUT_STAGE(name, type) \
+static void OutputStage##name(const struct aout_output_stage *stage, \
+                              void *buf, size_t frames) \
+{ \
+    const unsigned channels = stage->channels; \
+    const audio_volume_ramp_t ramp = audio_volume_Ramp(stage->amp, \
+                                                       stage->target); \
+    const float *src = buf; \
+    type *dst = buf; \
+    double ratio, step, gain = stage->amp; \
+\
+    audio_volume_RampProgression(&ramp, frames, &ratio, &step); \
+    if (!stage->remap && ratio == 1. && step == 0.) \
+    { \
+        const float amp = stage->amp; \
+\
+        for (size_t i = 0; i < frames * channels; i++) \
+            dst[i] = Output##name(src[i] * amp); \
+        return; \
+    } \
+\
+    for (size_t i = 0; i < frames; i++) \
+    { \
+        const float amp = gain; \
+        type frame[AOUT_CHAN_MAX]; \
+\
+        for (unsigned c = 0; c < channels; c++) \
+            frame[stage->remap ? stage->map[c] : c] = \
+                Output##name(src[c] * amp); \
+        /* Write through memcpy(), as the frame may overlap the input */ \
+        memcpy(dst, frame, channels * sizeof (type)); \
+        src += channels; \
+        dst += channels; \
+        gain = gain * ratio + step; \
+    } \
+}
+
+OUTPUT_STAGE(FL32, float)
+OUTPUT_STAGE(S16N, int16_t)
+OUTPUT_STAGE(S32N, int32_t)
+OUTPUT_STAGE(U8, uint8_t)
+#undef OUTPUT_STAGE
+
+static bool aout_OutputStageSupports(vlc_fourcc_t format)
+{
+    switch (format)
+    {
+        case VLC_CODEC_FL32:
+        case VLC_CODEC_S16N:
+        case VLC_CODEC_S32N:
+        case VLC_CODEC_U8:
+            return true;
+    }
+    return false;
+}
+
+/**
+ * Computes the channel reordering of a wg4 remap table, if it only
+ * reorders the channels of a layout.
+ */
+static bool aout_OutputStageSetRemap(struct aout_output_stage *stage,
+                                     uint32_t layout, const int *wg4_remap)
+{
+    int pos[AOUT_CHAN_MAX];
+    bool used[AOUT_CHAN_MAX] = { false };
+    uint8_t map[AOUT_CHAN_MAX];
+    bool reorder = false;
+    unsigned n = 0;
+
+    for (unsigned i = 0; i < AOUT_CHAN_MAX; i++)
+        pos[i] = (layout & pi_vlc_chan_order_wg4[i]) ? (int)n++ : -1;
+
+    for (unsigned i = 0; i < AOUT_CHAN_MAX; i++)
+    {
+        if (pos[i] < 0)
+            continue;
+
+        int to = wg4_remap[i];
+        if (to < 0 || to >= AOUT_CHAN_MAX || pos[to] < 0 || used[to])
+            return false;
+        used[to] = true;
+        map[pos[i]] = pos[to];
+        reorder |= to != (int)i;
+    }
+    memcpy(stage->map, map, sizeof (map));
+    stage->remap = reorder;
+    return true;
+}
+
+static block_t *aout_OutputStagePlay(struct aout_output_stage *stage,
+                                     block_t *block)
+{
+    /* Drained buffers may be gathered without their samples count */
+    const size_t frames = block->i_buffer / (stage->channels * sizeof (float));
+
+    switch (stage->format)
+    {
+        case VLC_CODEC_FL32:
+            if (stage->amp == 1.f && stage->target == 1.f && !stage->remap)
+                return block;
+            OutputStageFL32(stage, block->p_buffer, frames);
+            break;
+        case VLC_CODEC_S16N:
+            OutputStageS16N(stage, block->p_buffer, frames);
+            break;
+        case VLC_CODEC_S32N:
+            OutputStageS32N(stage, block->p_buffer, frames);
+            break;
+        case VLC_CODEC_U8:
+            OutputStageU8(stage, block->p_buffer, frames);
+            break;
+        default:
+            vlc_assert_unreachable();
+    }
+    block->i_buffer = frames * stage->channels
+                    * aout_BitsPerSample(stage->format) / 8;
+    stage->amp = stage->target;
+    return block;
+}
+
 #define AOUT_MAX_FILTERS 10
 
 struct aout_filters
@@ -349,10 +545,15 @@ struct aout_filters
     filter_t *resampler; /**< The resampler */
     int resampling; /**< Current resampling (Hz) */
     vlc_clock_t *clock;
+    struct aout_output_stage output; /**< Conversion after the resampler */
 
     unsigned count; /**< Number of filters */
     filter_t *tab[AOUT_MAX_FILTERS]; /**< Configured user filters
         (e.g. equalization) and their conversions */
+
+    struct aout_filter_stats tab_stats[AOUT_MAX_FILTERS];
+    struct aout_filter_stats resampler_stats;
+    struct aout_filter_stats output_stats;
 };
 
 /** Callback for visualization selection */
@@ -498,7 +699,11 @@ aout_filters_t *aout_FiltersNewWithClock(vlc_object_t *obj, const vlc_clock_t *c
     filters->rate_filter = NULL;
     filters->resampler = NULL;
     filters->resampling = 0;
+    filters->output.format = 0;
     filters->count = 0;
+    memset(filters->tab_stats, 0, sizeof (filters->tab_stats));
+    memset(&filters->resampler_stats, 0, sizeof (filters->resampler_stats));
+    memset(&filters->output_stats, 0, sizeof (filters->output_stats));
     if (clock)
     {
         filters->clock = vlc_clock_CreateSlave(clock);
@@ -582,8 +787,41 @@ aout_filters_t *aout_FiltersNewWithClock(vlc_object_t *obj, const vlc_clock_t *c
 
     assert(input_format.channel_type == AUDIO_CHANNEL_TYPE_BITMAP);
 
+    const bool time_stretch = var_InheritBool (obj, "audio-time-stretch");
+    char *str = var_InheritString (obj, "audio-filter");
+    char *visual = var_InheritString(obj, "audio-visual");
+    if (str != NULL && *str == '\0')
+    {
+        free(str);
+        str = NULL;
+    }
+    if (visual != NULL && !strcasecmp(visual, "none"))
+    {
+        free(visual);
+        visual = NULL;
+    }
+
+    /* The resampler works on float samples, and the output stage converts
+     * them to the output format with the software volume, unless the
+     * samples would be converted to float only for that */
+    bool integer = input_format.i_format == outfmt->i_format
+        && outfmt->i_format != VLC_CODEC_FL32
+        && !time_stretch && str == NULL && visual == NULL
+        && input_format.i_physical_channels == outfmt->i_physical_channels
+        && input_format.i_chan_mode == outfmt->i_chan_mode;
+    if (!integer && aout_OutputStageSupports(outfmt->i_format))
+    {
+        filters->output.format = outfmt->i_format;
+        filters->output.channels = outfmt->i_channels;
+        filters->output.remap = false;
+        filters->output.amp = filters->output.target = 1.f;
+        filters->output.amp_set = false;
+        output_format.i_format = VLC_CODEC_FL32;
+        aout_FormatPrepare(&output_format);
+    }
+
     /* parse user filter lists */
-    if (var_InheritBool (obj, "audio-time-stretch"))
+    if (time_stretch)
     {
         if (AppendFilter(obj, "audio filter", "scaletempo",
                          filters, &input_format, &output_format, NULL) == 0)
@@ -592,8 +830,19 @@ aout_filters_t *aout_FiltersNewWithClock(vlc_object_t *obj, const vlc_clock_t *c
 
     if (cfg != NULL)
     {
-        AppendRemapFilter(obj, filters, &input_format, &output_format,
-                          cfg->remap);
+        /* Reorder the channels in the output stage if nothing else needs
+         * them reordered first */
+        bool fused = filters->output.format != 0
+            && str == NULL && visual == NULL
+            && !(input_format.i_channels > 2 && cfg->headphones)
+            && input_format.i_physical_channels == outfmt->i_physical_channels
+            && input_format.i_chan_mode == outfmt->i_chan_mode
+            && aout_OutputStageSetRemap(&filters->output,
+                                        input_format.i_physical_channels,
+                                        cfg->remap);
+        if (!fused)
+            AppendRemapFilter(obj, filters, &input_format, &output_format,
+                              cfg->remap);
 
         if (input_format.i_channels > 2 && cfg->headphones)
             AppendFilter(obj, "audio filter", "binauralizer", filters,
@@ -601,7 +850,6 @@ aout_filters_t *aout_FiltersNewWithClock(vlc_object_t *obj, const vlc_clock_t *c
     }
 
     /* Now add user filters */
-    char *str = var_InheritString (obj, "audio-filter");
     if (str != NULL)
     {
         char *p = str, *name;
@@ -613,8 +861,7 @@ aout_filters_t *aout_FiltersNewWithClock(vlc_object_t *obj, const vlc_clock_t *c
         free (str);
     }
 
-    char *visual = var_InheritString(obj, "audio-visual");
-    if (visual != NULL && strcasecmp(visual, "none"))
+    if (visual != NULL)
         AppendFilter(obj, "visualization", visual, filters,
                      &input_format, &output_format, NULL);
     free(visual);
@@ -631,7 +878,8 @@ aout_filters_t *aout_FiltersNewWithClock(vlc_object_t *obj, const vlc_clock_t *c
 
     /* insert the resampler */
     output_format.i_rate = outfmt->i_rate;
-    assert (AOUT_FMTS_IDENTICAL(&output_format, outfmt));
+    assert (filters->output.format != 0
+         || AOUT_FMTS_IDENTICAL(&output_format, outfmt));
     filters->resampler = FindResampler (obj, &input_format,
                                         &output_format);
     if (filters->resampler == NULL && input_format.i_rate != outfmt->i_rate)
@@ -642,6 +890,10 @@ aout_filters_t *aout_FiltersNewWithClock(vlc_object_t *obj, const vlc_clock_t *c
     if (filters->rate_filter == NULL)
         filters->rate_filter = filters->resampler;
 
+    if (filters->output.format != 0)
+        msg_Dbg (obj, "output stage: float to %4.4s%s",
+                 (const char *)&filters->output.format,
+                 filters->output.remap ? ", channels reordered" : "");
     return filters;
 
 error:
@@ -682,6 +934,15 @@ aout_filters_t *aout_FiltersNew(vlc_object_t *obj,
     return aout_FiltersNewWithClock(obj, NULL, infmt, outfmt, cfg);
 }
 
+static void aout_FiltersPrintStats(vlc_object_t *obj, const char *name,
+                                   const struct aout_filter_stats *stats)
+{
+    if (stats->buffers == 0)
+        return;
+    msg_Dbg (obj, "%s: %"PRIu64" buffers, %"PRId64" us per buffer", name,
+             stats->buffers, US_FROM_VLC_TICK(stats->time) / stats->buffers);
+}
+
 #undef aout_FiltersDelete
 /**
  * Destroys a chain of audio filters.
@@ -690,6 +951,16 @@ aout_filters_t *aout_FiltersNew(vlc_object_t *obj,
  */
 void aout_FiltersDelete (vlc_object_t *obj, aout_filters_t *filters)
 {
+    for (unsigned i = 0; i < filters->count; i++)
+        aout_FiltersPrintStats (obj,
+                                module_get_object (filters->tab[i]->p_module),
+                                &filters->tab_stats[i]);
+    if (filters->resampler != NULL)
+        aout_FiltersPrintStats (obj,
+                            module_get_object (filters->resampler->p_module),
+                            &filters->resampler_stats);
+    aout_FiltersPrintStats (obj, "output stage", &filters->output_stats);
+
     if (filters->resampler != NULL)
         aout_FiltersPipelineDestroy (&filters->resampler, 1);
     aout_FiltersPipelineDestroy (filters->tab, filters->count);
@@ -704,6 +975,35 @@ bool aout_FiltersCanResample (aout_filters_t *filters)
     return (filters->resampler != NULL);
 }
 
+bool aout_FiltersSetAmplification (aout_filters_t *filters, float amp)
+{
+    if (filters->output.format == 0)
+        return false;
+
+    struct aout_output_stage *stage = &filters->output;
+
+    /* Ramp from the previous volume, but not from the default one */
+    if (!stage->amp_set)
+    {
+        stage->amp = amp;
+        stage->amp_set = true;
+    }
+    stage->target = amp;
+    return true;
+}
+
+static block_t *aout_FiltersOutputPlay(aout_filters_t *filters, block_t *block)
+{
+    if (filters->output.format == 0 || block == NULL)
+        return block;
+
+    vlc_tick_t start = vlc_tick_now();
+    block = aout_OutputStagePlay (&filters->output, block);
+    filters->output_stats.time += vlc_tick_now() - start;
+    filters->output_stats.buffers++;
+    return block;
+}
+
 bool aout_FiltersAdjustResampling (aout_filters_t *filters, int adjust)
 {
     if (filters->resampler == NULL)
@@ -732,14 +1032,17 @@ block_t *aout_FiltersPlay(aout_filters_t *filters, block_t *block, float rate)
         rate_filter->fmt_in.audio.i_rate = lroundf(nominal_rate * rate);
     }
 
-    block = aout_FiltersPipelinePlay (filters->tab, filters->count, block);
+    block = aout_FiltersPipelinePlay (filters->tab, filters->tab_stats,
+                                      filters->count, block);
     if (filters->resampler != NULL)
     {   /* NOTE: the resampler needs to run even if resampling is 0.
          * The decoder and output rates can still be different. */
         filters->resampler->fmt_in.audio.i_rate += filters->resampling;
-        block = aout_FiltersPipelinePlay (&filters->resampler, 1, block);
+        block = aout_FiltersPipelinePlay (&filters->resampler,
+                                          &filters->resampler_stats, 1, block);
         filters->resampler->fmt_in.audio.i_rate -= filters->resampling;
     }
+    block = aout_FiltersOutputPlay (filters, block);
 
     if (nominal_rate != 0)
     {   /* Restore input rate */
@@ -756,7 +1059,8 @@ drop:
 block_t *aout_FiltersDrain (aout_filters_t *filters)
 {
     /* Drain the filters pipeline */
-    block_t *block = aout_FiltersPipelineDrain (filters->tab, filters->count);
+    block_t *block = aout_FiltersPipelineDrain (filters->tab, filters->tab_stats,
+                                                filters->count);
 
     if (filters->resampler != NULL)
     {
@@ -767,22 +1071,24 @@ block_t *aout_FiltersDrain (aout_filters_t *filters)
         if (block)
         {
             /* Resample the drained block from the filters pipeline */
-            block = aout_FiltersPipelinePlay (&filters->resampler, 1, block);
+            block = aout_FiltersPipelinePlay (&filters->resampler,
+                                              &filters->resampler_stats, 1,
+                                              block);
             if (block)
                 block_ChainAppend (&chain, block);
         }
 
         /* Drain the resampler filter */
-        block = aout_FiltersPipelineDrain (&filters->resampler, 1);
+        block = aout_FiltersPipelineDrain (&filters->resampler,
+                                           &filters->resampler_stats, 1);
         if (block)
             block_ChainAppend (&chain, block);
 
         filters->resampler->fmt_in.audio.i_rate -= filters->resampling;
 
-        return chain ? block_ChainGather (chain) : NULL;
+        block = chain ? block_ChainGather (chain) : NULL;
     }
-    else
-        return block;
+    return aout_FiltersOutputPlay (filters, block);
 }
 
 void aout_FiltersFlush (aout_filters_t *filters)
@@ -40,6 +40,8 @@ struct aout_volume
     audio_replay_gain_t replay_gain;
     vlc_atomic_float gain_factor;
     float output_factor;
+    float applied_factor; /**< Factor of the last frame, negative if none */
+    unsigned channels;
     module_t *module;
 };
 
@@ -59,6 +61,7 @@ aout_volume_t *aout_volume_New(vlc_object_t *parent,
         return NULL;
     vol->module = NULL;
     vol->output_factor = 1.f;
+    vol->applied_factor = -1.f;
 
     //audio_volume_t *obj = &vol->object;
 
@@ -78,12 +81,15 @@ aout_volume_t *aout_volume_New(vlc_object_t *parent,
 /**
  * Selects the current sample format for software amplification.
  */
-int aout_volume_SetFormat(aout_volume_t *vol, vlc_fourcc_t format)
+int aout_volume_SetFormat(aout_volume_t *vol, const audio_sample_format_t *fmt)
 {
     if (unlikely(vol == NULL))
         return -1;
 
     audio_volume_t *obj = &vol->object;
+    vlc_fourcc_t format = fmt->i_format;
+
+    vol->channels = aout_FormatNbChannels(fmt);
     if (vol->module != NULL)
     {
         if (obj->format == format)
@@ -96,6 +102,8 @@ int aout_volume_SetFormat(aout_volume_t *vol, vlc_fourcc_t format)
     }
 
     obj->format = format;
+    obj->ramp = NULL;
+    obj->mix = NULL;
     vol->module = module_need(obj, "audio volume", NULL, false);
     if (vol->module == NULL)
         return -1;
@@ -129,6 +137,9 @@ void aout_volume_SetVolume(aout_volume_t *vol, float factor)
 
 /**
  * Applies replay gain and software volume to an audio buffer.
+ *
+ * When the factor changed, the gain ramps from the previous factor over the
+ * buffer, rather than stepping, if the volume module supports it.
  */
 int aout_volume_Amplify(aout_volume_t *vol, block_t *block)
 {
@@ -138,7 +149,29 @@ int aout_volume_Amplify(aout_volume_t *vol, block_t *block)
     float amp = vol->output_factor
               * vlc_atomic_load_float (&vol->gain_factor);
 
-    vol->object.amplify(&vol->object, block, amp);
+    if (vol->object.ramp != NULL && vol->channels > 0
+     && vol->applied_factor >= 0.f && vol->applied_factor != amp)
+    {
+        audio_volume_ramp_t ramp = audio_volume_Ramp(vol->applied_factor, amp);
+        vol->object.ramp(&vol->object, block, vol->channels, &ramp);
+    }
+    else
+        vol->object.amplify(&vol->object, block, amp);
+    vol->applied_factor = amp;
+    return 0;
+}
+
+/**
+ * Gets the amplification factor of aout_volume_Amplify().
+ * \return 0 on success, -1 if there is no software amplification
+ */
+int aout_volume_GetFactor(aout_volume_t *vol, float *factor)
+{
+    if (unlikely(vol == NULL) || vol->module == NULL)
+        return -1;
+
+    *factor = vol->output_factor
+            * vlc_atomic_load_float (&vol->gain_factor);
     return 0;
 }
 
@@ -50,6 +50,8 @@ struct vlc_clock_main_t
     vlc_tick_t pause_date;
 
     clock_point_t wait_sync_ref; /* When the master */
+    double wait_sync_rate; /* Rate used from wait_sync_ref */
+    bool low_latency; /* The rate follows the live edge (low latency mode) */
     clock_point_t first_pcr;
     vlc_tick_t output_dejitter; /* Delay used to absorb the output clock jitter */
     vlc_tick_t input_dejitter; /* Delay used to absorb the input jitter */
@@ -217,6 +219,16 @@ vlc_clock_monotonic_to_system_locked(vlc_clock_t *clock, vlc_tick_t now,
             __MAX(input_delay, main_clock->output_dejitter);
 
         main_clock->wait_sync_ref = clock_point_Create(now + delay, ts);
+        main_clock->wait_sync_rate = rate;
+    }
+    else if (main_clock->low_latency && rate != main_clock->wait_sync_rate)
+    {
+        /* Rebase the reference point on the rate change, so that the dates
+         * converted so far are not all shifted at once */
+        main_clock->wait_sync_ref = clock_point_Create(
+            (ts - main_clock->wait_sync_ref.stream) / main_clock->wait_sync_rate
+            + main_clock->wait_sync_ref.system, ts);
+        main_clock->wait_sync_rate = rate;
     }
     return (ts - main_clock->wait_sync_ref.stream) / rate
         + main_clock->wait_sync_ref.system;
@@ -323,7 +335,7 @@ static void vlc_clock_slave_set_dejitter(vlc_clock_t *clock, vlc_tick_t delay)
 }
 
 
-vlc_clock_main_t *vlc_clock_main_New(void)
+vlc_clock_main_t *vlc_clock_main_New(bool low_latency)
 {
     vlc_clock_main_t *main_clock = malloc(sizeof(vlc_clock_main_t));
 
@@ -344,6 +356,8 @@ vlc_clock_main_t *vlc_clock_main_New(void)
         clock_point_Create(VLC_TICK_INVALID, VLC_TICK_INVALID);
     main_clock->wait_sync_ref = main_clock->last =
         clock_point_Create(VLC_TICK_INVALID, VLC_TICK_INVALID);
+    main_clock->wait_sync_rate = 1.0f;
+    main_clock->low_latency = low_latency;
 
     main_clock->pause_date = VLC_TICK_INVALID;
     main_clock->input_dejitter = DEFAULT_PTS_DELAY;
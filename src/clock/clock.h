@@ -32,8 +32,11 @@ typedef struct vlc_clock_t vlc_clock_t;
 
 /**
  * This function creates the vlc_clock_main_t of the program
+ *
+ * In low latency mode, the rate changes done to catch up with a live source
+ * do not shift the dates already converted without a master clock.
  */
-vlc_clock_main_t *vlc_clock_main_New(void);
+vlc_clock_main_t *vlc_clock_main_New(bool low_latency);
 
 /**
  * Destroy the clock main
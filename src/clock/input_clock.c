@@ -102,6 +102,20 @@
 /* */
 #define INPUT_CLOCK_LATE_COUNT (3)
 
+/* Number of clock references used to measure the arrival jitter of streams
+ * whose pace we do not control (a few seconds with usual PCR intervals) */
+#define INPUT_CLOCK_ARRIVAL_COUNT (64)
+
+/* Minimal number of clock references before reporting arrival statistics */
+#define INPUT_CLOCK_ARRIVAL_MIN (16)
+
+/* Low latency catch-up: the buffering kept on top of twice the arrival
+ * jitter, the extra buffering tolerated before catching up, and the rate
+ * factor used to do so */
+#define INPUT_CLOCK_CATCHUP_MARGIN      VLC_TICK_FROM_MS(20)
+#define INPUT_CLOCK_CATCHUP_HYSTERESIS  VLC_TICK_FROM_MS(40)
+#define INPUT_CLOCK_CATCHUP_RATE        (1.05f)
+
 /* */
 struct input_clock_t
 {
@@ -129,10 +143,27 @@ struct input_clock_t
         unsigned i_index;
     } late;
 
+    /* Arrival statistics */
+    struct
+    {
+        vlc_tick_t  pi_offset[INPUT_CLOCK_ARRIVAL_COUNT];
+        vlc_tick_t  pi_headroom[INPUT_CLOCK_ARRIVAL_COUNT];
+        unsigned i_index;
+        unsigned i_count;
+    } arrival;
+
     /* Reference point */
     clock_point_t ref;
     bool          b_has_reference;
 
+    /* Reference point not rescaled on rate changes
+     * It is used to measure the drift at the pace of the source */
+    clock_point_t source;
+
+    /* Low latency live mode: the rate is changed to catch up with the
+     * source, which must not be taken for a drift of the source */
+    bool          b_low_latency;
+
     /* External clock drift */
     vlc_tick_t    i_external_clock;
     bool          b_has_external_clock;
@@ -152,7 +183,7 @@ static vlc_tick_t ClockGetTsOffset( input_clock_t * );
 /*****************************************************************************
  * input_clock_New: create a new clock
  *****************************************************************************/
-input_clock_t *input_clock_New( float rate )
+input_clock_t *input_clock_New( float rate, bool b_low_latency )
 {
     input_clock_t *cl = malloc( sizeof(*cl) );
     if( !cl )
@@ -161,6 +192,7 @@ input_clock_t *input_clock_New( float rate )
     vlc_mutex_init( &cl->lock );
     cl->b_has_reference = false;
     cl->ref = clock_point_Create( VLC_TICK_INVALID, VLC_TICK_INVALID );
+    cl->source = cl->ref;
     cl->b_has_external_clock = false;
 
     cl->last = clock_point_Create( VLC_TICK_INVALID, VLC_TICK_INVALID );
@@ -176,6 +208,10 @@ input_clock_t *input_clock_New( float rate )
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
         cl->late.pi_value[i] = 0;
 
+    cl->arrival.i_index = 0;
+    cl->arrival.i_count = 0;
+
+    cl->b_low_latency = b_low_latency;
     cl->rate = rate;
     cl->i_pts_delay = 0;
     cl->b_paused = false;
@@ -241,14 +277,22 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
         cl->b_has_reference = true;
         cl->ref = clock_point_Create( __MAX( cl->i_ts_max + CR_MEAN_PTS_GAP, i_ck_system ),
                                       i_ck_stream );
+        cl->source = cl->ref;
         cl->b_has_external_clock = false;
+
+        cl->arrival.i_index = 0;
+        cl->arrival.i_count = 0;
     }
 
     /* Compute the drift between the stream clock and the system clock
      * when we don't control the source pace */
     if( !b_can_pace_control && cl->i_next_drift_update < i_ck_system )
     {
-        const vlc_tick_t i_converted = ClockSystemToStream( cl, i_ck_system );
+        /* In low latency mode, our own playback rate is not a drift of
+         * the source */
+        const vlc_tick_t i_converted = cl->b_low_latency
+            ? i_ck_system - cl->source.system + cl->source.stream
+            : ClockSystemToStream( cl, i_ck_system );
 
         AvgUpdate( &cl->drift, i_converted - i_ck_stream );
 
@@ -287,6 +331,20 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
         cl->late.i_index = ( cl->late.i_index + 1 ) % INPUT_CLOCK_LATE_COUNT;
     }
 
+    /* Record the arrival time of the reference relative to the source pace
+     * (independent of our own rate) and how early it arrived compared to
+     * its deadline */
+    if( cl->b_low_latency && !b_can_pace_control )
+    {
+        const unsigned i = cl->arrival.i_index;
+
+        cl->arrival.pi_offset[i] = i_ck_system - i_ck_stream;
+        cl->arrival.pi_headroom[i] = -i_late;
+        cl->arrival.i_index = ( i + 1 ) % INPUT_CLOCK_ARRIVAL_COUNT;
+        if( cl->arrival.i_count < INPUT_CLOCK_ARRIVAL_COUNT )
+            cl->arrival.i_count++;
+    }
+
     vlc_mutex_unlock( &cl->lock );
 }
 
@@ -299,6 +357,7 @@ void input_clock_Reset( input_clock_t *cl )
 
     cl->b_has_reference = false;
     cl->ref = clock_point_Create( VLC_TICK_INVALID, VLC_TICK_INVALID );
+    cl->source = cl->ref;
     cl->b_has_external_clock = false;
     cl->i_ts_max = VLC_TICK_INVALID;
 
@@ -312,7 +371,16 @@ void input_clock_ChangeRate( input_clock_t *cl, float rate )
 {
     vlc_mutex_lock( &cl->lock );
 
-    if( cl->b_has_reference )
+    if( cl->b_has_reference && cl->b_low_latency )
+    {
+        /* Move the reference point (as if we were playing at the new rate
+         * from the start), keeping the date of the last clock reference
+         * unchanged: its arrival date cannot be used for that as the source
+         * pace does not follow our rate when we do not control it */
+        const vlc_tick_t i_stream = cl->last.stream - cl->ref.stream;
+        cl->ref.system += i_stream / cl->rate - i_stream / rate;
+    }
+    else if( cl->b_has_reference )
     {
         /* Move the reference point (as if we were playing at the new rate
          * from the start */
@@ -338,6 +406,7 @@ void input_clock_ChangePause( input_clock_t *cl, bool b_paused, vlc_tick_t i_dat
         if( cl->b_has_reference && i_duration > 0 )
         {
             cl->ref.system += i_duration;
+            cl->source.system += i_duration;
             cl->last.system += i_duration;
         }
     }
@@ -480,6 +549,7 @@ void input_clock_ChangeSystemOrigin( input_clock_t *cl, bool b_absolute, vlc_tic
     }
 
     cl->ref.system += i_offset;
+    cl->source.system += i_offset;
     cl->last.system += i_offset;
 
     vlc_mutex_unlock( &cl->lock );
@@ -526,7 +596,12 @@ void input_clock_SetJitter( input_clock_t *cl,
      * TODO when increasing -> force rebuffering
      */
     if( cl->i_pts_delay < i_pts_delay )
+    {
+        /* The past references now have more time to spare */
+        for( unsigned i = 0; i < cl->arrival.i_count; i++ )
+            cl->arrival.pi_headroom[i] += i_pts_delay - cl->i_pts_delay;
         cl->i_pts_delay = i_pts_delay;
+    }
 
     /* */
     if( i_cr_average < 10 )
@@ -560,6 +635,47 @@ vlc_tick_t input_clock_GetJitter( input_clock_t *cl )
     return i_pts_delay + i_late_median;
 }
 
+int input_clock_GetArrival( input_clock_t *cl,
+                            vlc_tick_t *pi_jitter, vlc_tick_t *pi_headroom )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    const unsigned i_count = cl->arrival.i_count;
+    if( i_count < INPUT_CLOCK_ARRIVAL_MIN )
+    {
+        vlc_mutex_unlock( &cl->lock );
+        return VLC_EGENERIC;
+    }
+
+    vlc_tick_t i_offset_min = cl->arrival.pi_offset[0];
+    vlc_tick_t i_offset_max = cl->arrival.pi_offset[0];
+    vlc_tick_t i_headroom = cl->arrival.pi_headroom[0];
+    for( unsigned i = 1; i < i_count; i++ )
+    {
+        i_offset_min = __MIN( i_offset_min, cl->arrival.pi_offset[i] );
+        i_offset_max = __MAX( i_offset_max, cl->arrival.pi_offset[i] );
+        i_headroom = __MIN( i_headroom, cl->arrival.pi_headroom[i] );
+    }
+
+    vlc_mutex_unlock( &cl->lock );
+
+    *pi_jitter = i_offset_max - i_offset_min;
+    *pi_headroom = i_headroom;
+    return VLC_SUCCESS;
+}
+
+float input_clock_GetCatchup( float catchup,
+                             vlc_tick_t i_jitter, vlc_tick_t i_headroom )
+{
+    const vlc_tick_t i_target = 2 * i_jitter + INPUT_CLOCK_CATCHUP_MARGIN;
+
+    if( i_headroom <= i_target )
+        return 1.f;
+    if( i_headroom > i_target + INPUT_CLOCK_CATCHUP_HYSTERESIS )
+        return INPUT_CLOCK_CATCHUP_RATE;
+    return catchup;
+}
+
 /*****************************************************************************
  * ClockStreamToSystem: converts a movie clock to system date
  *****************************************************************************/
@@ -38,8 +38,11 @@ typedef struct input_clock_t input_clock_t;
 /**
  * This function creates a new input_clock_t.
  * You must use input_clock_Delete to delete it once unused.
+ *
+ * \param b_low_latency enables the arrival statistics and keeps the clock
+ * continuous when the rate is changed to catch up with a live source.
  */
-input_clock_t *input_clock_New( float rate );
+input_clock_t *input_clock_New( float rate, bool b_low_latency );
 
 /**
  * This function destroys a input_clock_t created by input_clock_New.
@@ -135,4 +138,29 @@ void input_clock_SetJitter( input_clock_t *,
  */
 vlc_tick_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * This function returns the arrival statistics of a stream whose pace is not
+ * controlled, measured over the last clock references.
+ *
+ * pi_jitter is filled with the peak to peak arrival jitter of the clock
+ * references and pi_headroom with the smallest margin by which they arrived
+ * before being late.
+ * It will return VLC_EGENERIC if the clock was not created in low latency
+ * mode, or if not enough clock references were received since the last
+ * reset.
+ */
+int input_clock_GetArrival( input_clock_t *,
+                            vlc_tick_t *pi_jitter, vlc_tick_t *pi_headroom );
+
+/**
+ * This function returns the rate factor to play a stream whose pace is not
+ * controlled at, so that its buffering shrinks down to what its arrival
+ * jitter requires.
+ *
+ * catchup is the factor currently used: catching up starts once the headroom
+ * exceeds the target by some margin, and stops when the target is reached.
+ */
+float input_clock_GetCatchup( float catchup,
+                              vlc_tick_t i_jitter, vlc_tick_t i_headroom );
+
 #endif
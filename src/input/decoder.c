@@ -41,6 +41,7 @@
 #include <vlc_meta.h>
 #include <vlc_dialog.h>
 #include <vlc_modules.h>
+#include <vlc_tracer.h>
 
 #include "audio_output/aout_internal.h"
 #include "stream_output/stream_output.h"
@@ -49,6 +50,7 @@
 #include "decoder.h"
 #include "event.h"
 #include "resource.h"
+#include "scrub.h"
 
 #include "../video_output/vout_internal.h"
 
@@ -68,6 +70,7 @@ struct decoder_owner
     input_thread_t  *p_input;
     input_resource_t*p_resource;
     vlc_clock_t     *p_clock;
+    struct vlc_tracer *tracer;
 
     int              i_spu_channel;
     int64_t          i_spu_order;
@@ -144,6 +147,10 @@ struct decoder_owner
     vlc_mutex_t     mouse_lock;
     vlc_mouse_event mouse_event;
     void           *mouse_opaque;
+
+    /* Scrubbing */
+    input_scrub_t  *p_scrub;
+    vlc_tick_t      i_scrub_date; /* date of the picture shown from the cache */
 };
 
 /* Pictures which are DECODER_BOGUS_VIDEO_DELAY or more in advance probably have
@@ -538,7 +545,8 @@ static int vout_update_format( decoder_t *p_dec )
             &(vout_configuration_t) {
                 .vout = p_vout, .clock = p_owner->p_clock, .fmt = &fmt,
                 .dpb_size = dpb_size + p_dec->i_extra_picture_buffers + 1,
-                .mouse_event = MouseEvent, .mouse_opaque = p_dec
+                .mouse_event = MouseEvent, .mouse_opaque = p_dec,
+                .es_id = p_dec->fmt_in.i_id
             } );
 
         vlc_mutex_lock( &p_owner->lock );
@@ -667,12 +675,17 @@ static vlc_tick_t DecoderGetDisplayDate( decoder_t *p_dec, vlc_tick_t system_now
     if( p_owner->b_waiting || p_owner->paused )
         i_ts = VLC_TICK_INVALID;
     float rate = p_owner->output_rate;
+    /* The picture must leave the decoder early enough for the video output
+     * to render it on time */
+    vlc_tick_t render_delay = p_owner->p_vout != NULL
+                            ? vout_GetRenderDelay( p_owner->p_vout ) : 0;
     vlc_mutex_unlock( &p_owner->lock );
 
     if( !p_owner->p_clock || i_ts == VLC_TICK_INVALID )
         return i_ts;
 
-    return vlc_clock_ConvertToSystem( p_owner->p_clock, system_now, i_ts, rate );
+    return vlc_clock_ConvertToSystem( p_owner->p_clock, system_now, i_ts, rate )
+           - render_delay;
 }
 
 static float DecoderGetDisplayRate( decoder_t *p_dec )
@@ -1022,6 +1035,10 @@ static void DecoderPlayVideo( decoder_t *p_dec, picture_t *p_picture,
             /* Ensure no earlier higher pts breaks still state */
             vout_Flush( p_vout, p_picture->date );
         }
+        if( p_owner->tracer != NULL )
+            vlc_tracer_TraceStreamPTS( p_owner->tracer, "DEC",
+                                       p_dec->fmt_in.i_id, "OUT",
+                                       p_picture->date );
         vout_PutPicture( p_vout, p_picture );
     }
     else
@@ -1044,6 +1061,7 @@ static void DecoderUpdateStatVideo( struct decoder_owner *p_owner,
 {
     input_thread_t *p_input = p_owner->p_input;
     unsigned displayed = 0;
+    vout_pacing_t pacing = { 0 };
 
     /* Update ugly stat */
     if( p_input == NULL )
@@ -1053,7 +1071,8 @@ static void DecoderUpdateStatVideo( struct decoder_owner *p_owner,
     {
         unsigned vout_lost = 0;
 
-        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost );
+        vout_GetResetStatistic( p_owner->p_vout, &displayed, &vout_lost,
+                                &pacing );
         lost += vout_lost;
     }
 
@@ -1067,6 +1086,22 @@ static void DecoderUpdateStatVideo( struct decoder_owner *p_owner,
                                   memory_order_relaxed);
         atomic_fetch_add_explicit(&stats->displayed_pictures, displayed,
                                   memory_order_relaxed);
+
+        uintmax_t offset_max = atomic_load_explicit(&stats->display_offset_max,
+                                                    memory_order_relaxed);
+
+        atomic_fetch_add_explicit(&stats->late_pictures, pacing.late,
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&stats->timed_pictures, pacing.timed,
+                                  memory_order_relaxed);
+        atomic_fetch_add_explicit(&stats->display_offset_sum,
+                                  pacing.offset_sum, memory_order_relaxed);
+        /* Several video decoders may feed the same input */
+        while( (uintmax_t)pacing.offset_max > offset_max
+            && !atomic_compare_exchange_weak_explicit(
+                    &stats->display_offset_max, &offset_max,
+                    pacing.offset_max, memory_order_relaxed,
+                    memory_order_relaxed) );
     }
 }
 
@@ -1076,6 +1111,11 @@ static void DecoderQueueVideo( decoder_t *p_dec, picture_t *p_pic )
     unsigned i_lost = 0;
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
 
+    /* Keep the pictures skipped by the preroll too, they are the ones
+     * scrubbing back needs */
+    if( p_owner->p_scrub != NULL )
+        input_scrub_Add( p_owner->p_scrub, p_pic );
+
     DecoderPlayVideo( p_dec, p_pic, &i_lost );
 
     p_owner->pf_update_stat( p_owner, 1, i_lost );
@@ -1100,6 +1140,18 @@ static picture_t *thumbnailer_buffer_new( decoder_t *p_dec )
 static void DecoderQueueThumbnail( decoder_t *p_dec, picture_t *p_pic )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    /* Skip the pictures decoded from the keyframe up to a precise seek */
+    vlc_mutex_lock( &p_owner->lock );
+    if( p_owner->i_preroll_end > p_pic->date )
+    {
+        vlc_mutex_unlock( &p_owner->lock );
+        picture_Release( p_pic );
+        return;
+    }
+    p_owner->i_preroll_end = (vlc_tick_t)INT64_MIN;
+    vlc_mutex_unlock( &p_owner->lock );
+
     if( p_owner->b_first )
     {
         input_SendEvent(p_owner->p_input, &(struct vlc_input_event) {
@@ -1165,6 +1217,10 @@ static void DecoderPlayAudio( decoder_t *p_dec, block_t *p_audio,
 
     if( p_aout != NULL && p_audio->i_pts != VLC_TICK_INVALID )
     {
+        if( p_owner->tracer != NULL )
+            vlc_tracer_TraceStreamPTS( p_owner->tracer, "DEC",
+                                       p_dec->fmt_in.i_id, "OUT",
+                                       p_audio->i_pts );
         int status = aout_DecPlay( p_aout, p_audio );
         if( status == AOUT_DEC_CHANGED )
         {
@@ -1470,6 +1526,11 @@ static void DecoderProcessFlush( decoder_t *p_dec )
     {
         if( p_owner->p_vout )
             vout_FlushAll( p_owner->p_vout );
+        /* A thumbnailer seeking again wants another thumbnail */
+        if( p_owner->p_input && input_priv( p_owner->p_input )->b_thumbnailing )
+            p_owner->b_first = true;
+        if( p_owner->p_scrub != NULL )
+            input_scrub_Flush( p_owner->p_scrub );
     }
     else if( p_dec->fmt_out.i_cat == SPU_ES )
     {
@@ -1680,6 +1741,12 @@ static void *DecoderThread( void *p_data )
 
         vlc_fifo_Unlock( p_owner->p_fifo );
 
+        if( p_owner->tracer != NULL && p_block != NULL )
+            vlc_tracer_TraceStreamPTS( p_owner->tracer, "DEC",
+                                       p_dec->fmt_in.i_id, "IN",
+                                       p_block->i_pts != VLC_TICK_INVALID ?
+                                       p_block->i_pts : p_block->i_dts );
+
         int canc = vlc_savecancel();
         DecoderProcess( p_dec, p_block );
 
@@ -1767,6 +1834,7 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_dec = &p_owner->dec;
 
     p_owner->p_clock = p_clock;
+    p_owner->tracer = vlc_object_get_tracer( p_dec );
     p_owner->i_preroll_end = (vlc_tick_t)INT64_MIN;
     p_owner->p_input = p_input;
     p_owner->p_resource = p_resource;
@@ -1803,6 +1871,9 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->mouse_event = NULL;
     p_owner->mouse_opaque = NULL;
 
+    p_owner->p_scrub = NULL;
+    p_owner->i_scrub_date = VLC_TICK_INVALID;
+
     es_format_Init( &p_owner->fmt, fmt->i_cat, 0 );
 
     /* decoder fifo */
@@ -1843,7 +1914,13 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     {
         case VIDEO_ES:
             if( !p_input || !input_priv( p_input )->b_thumbnailing )
+            {
                 p_dec->cbs = &dec_video_cbs;
+
+                int64_t i_scrub = var_InheritInteger( p_dec, "scrub-cache" );
+                if( p_input != NULL && p_sout == NULL && i_scrub > 0 )
+                    p_owner->p_scrub = input_scrub_New( i_scrub << 20 );
+            }
             else
                 p_dec->cbs = &dec_thumbnailer_cbs;
             p_owner->pf_update_stat = DecoderUpdateStatVideo;
@@ -1971,6 +2048,9 @@ static void DeleteDecoder( decoder_t * p_dec )
 
     decoder_Destroy( p_owner->p_packetizer );
 
+    if( p_owner->p_scrub != NULL )
+        input_scrub_Delete( p_owner->p_scrub );
+
     vlc_cond_destroy( &p_owner->wait_fifo );
     vlc_cond_destroy( &p_owner->wait_acknowledge );
     vlc_cond_destroy( &p_owner->wait_request );
@@ -2250,6 +2330,11 @@ void input_DecoderFlush( decoder_t *p_dec )
     vlc_fifo_Signal( p_owner->p_fifo );
 
     vlc_fifo_Unlock( p_owner->p_fifo );
+
+    /* The output will not show the picture from the cache anymore */
+    vlc_mutex_lock( &p_owner->lock );
+    p_owner->i_scrub_date = VLC_TICK_INVALID;
+    vlc_mutex_unlock( &p_owner->lock );
 }
 
 void input_DecoderGetCcDesc( decoder_t *p_dec, decoder_cc_desc_t *p_desc )
@@ -2460,6 +2545,79 @@ void input_DecoderFrameNext( decoder_t *p_dec, vlc_tick_t *pi_duration )
     vlc_mutex_unlock( &p_owner->lock );
 }
 
+static int DecoderScrubShow( decoder_t *p_dec, picture_t *p_pic )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    if( p_pic == NULL )
+        return VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_owner->lock );
+    if( p_owner->p_vout == NULL )
+    {
+        vlc_mutex_unlock( &p_owner->lock );
+        picture_Release( p_pic );
+        return VLC_EGENERIC;
+    }
+
+    /* Replace whatever the output was about to show while paused */
+    p_owner->i_scrub_date = p_pic->date;
+    vout_FlushAll( p_owner->p_vout );
+    p_pic->b_force = true;
+    vout_PutPicture( p_owner->p_vout, p_pic );
+    vlc_mutex_unlock( &p_owner->lock );
+    return VLC_SUCCESS;
+}
+
+int input_DecoderScrub( decoder_t *p_dec, vlc_tick_t i_date )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    assert( p_owner->paused );
+    if( p_owner->p_scrub == NULL )
+        return VLC_EGENERIC;
+
+    return DecoderScrubShow( p_dec, input_scrub_Get( p_owner->p_scrub, i_date ) );
+}
+
+vlc_tick_t input_DecoderGetScrubDate( decoder_t *p_dec, vlc_tick_t *pi_duration )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    vlc_tick_t i_date;
+
+    vlc_mutex_lock( &p_owner->lock );
+    const video_format_t *p_fmt = &p_owner->fmt.video;
+
+    if( p_owner->fmt.i_cat == VIDEO_ES && p_fmt->i_frame_rate > 0
+     && p_fmt->i_frame_rate_base > 0 )
+        *pi_duration = vlc_tick_from_samples( p_fmt->i_frame_rate_base,
+                                              p_fmt->i_frame_rate );
+    else
+        *pi_duration = 0;
+
+    /* The output may not have shown the cached picture yet */
+    i_date = p_owner->i_scrub_date;
+    if( i_date == VLC_TICK_INVALID && p_owner->p_vout != NULL )
+        i_date = vout_GetDisplayedTimestamp( p_owner->p_vout );
+    vlc_mutex_unlock( &p_owner->lock );
+    return i_date;
+}
+
+int input_DecoderScrubStep( decoder_t *p_dec, vlc_tick_t i_date,
+                            bool b_forward, vlc_tick_t *pi_date )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+
+    assert( p_owner->paused );
+    if( p_owner->p_scrub == NULL )
+        return VLC_EGENERIC;
+
+    picture_t *p_pic = input_scrub_Step( p_owner->p_scrub, i_date, b_forward );
+    if( p_pic != NULL )
+        *pi_date = p_pic->date;
+    return DecoderScrubShow( p_dec, p_pic );
+}
+
 bool input_DecoderHasFormatChanged( decoder_t *p_dec, es_format_t *p_fmt, vlc_meta_t **pp_meta )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
@@ -94,6 +94,28 @@ void input_DecoderGetCcDesc( decoder_t *, decoder_cc_desc_t * );
  */
 void input_DecoderFrameNext( decoder_t *p_dec, vlc_tick_t *pi_duration );
 
+/**
+ * This function shows the cached picture displayed at i_date while paused,
+ * without decoding.
+ *
+ * It fails if the decoder does not cache pictures or if the picture is not
+ * cached.
+ */
+int input_DecoderScrub( decoder_t *p_dec, vlc_tick_t i_date );
+
+/**
+ * This function returns the date of the picture being shown, or
+ * VLC_TICK_INVALID, and fills the duration of a frame if known, 0 otherwise.
+ */
+vlc_tick_t input_DecoderGetScrubDate( decoder_t *p_dec, vlc_tick_t *pi_duration );
+
+/**
+ * This function shows the cached picture following (or preceding) the one
+ * dated i_date while paused, and fills its date.
+ */
+int input_DecoderScrubStep( decoder_t *p_dec, vlc_tick_t i_date,
+                            bool b_forward, vlc_tick_t *pi_date );
+
 /**
  * This function will return true if the ES format or meta data have changed since
  * the last call. In which case, it will do a copy of the current es_format_t if p_fmt
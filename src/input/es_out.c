@@ -39,6 +39,7 @@
 #include <vlc_fourcc.h>
 #include <vlc_meta.h>
 #include <vlc_list.h>
+#include <vlc_tracer.h>
 
 #include "input_internal.h"
 #include "../clock/input_clock.h"
@@ -189,6 +190,10 @@ typedef struct
     int         i_cr_average;
     float       rate;
 
+    /* Low latency live mode */
+    bool        b_low_latency;
+    float       catchup; /* Rate factor used to reach the live edge */
+
     /* */
     bool        b_paused;
     vlc_tick_t  i_pause_date;
@@ -196,6 +201,12 @@ typedef struct
     /* Current preroll */
     vlc_tick_t  i_preroll_end;
 
+    /* Scrubbing: offset from the input time to the stream dates, known after
+     * a precise seek, and last time sent to the input */
+    bool        b_scrub_offset;
+    vlc_tick_t  i_scrub_offset;
+    vlc_tick_t  i_last_time;
+
     /* Used for buffering */
     bool        b_buffering;
     vlc_tick_t  i_buffering_extra_initial;
@@ -364,11 +375,16 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, float rate )
     p_sys->i_pause_date = -1;
 
     p_sys->rate = rate;
+    p_sys->b_low_latency = var_InheritBool( p_input, "clock-low-latency" );
+    p_sys->catchup = 1.f;
 
     p_sys->b_buffering = true;
     p_sys->i_preroll_end = -1;
     p_sys->i_prev_stream_level = -1;
 
+    p_sys->b_scrub_offset = false;
+    p_sys->i_last_time = VLC_TICK_INVALID;
+
     return &p_sys->out;
 }
 
@@ -696,6 +712,11 @@ static void EsOutChangePause( es_out_t *out, bool b_paused, vlc_tick_t i_date )
     p_sys->i_pause_date = i_date;
 }
 
+static float EsOutGetPlaybackRate( es_out_sys_t *p_sys )
+{
+    return p_sys->rate * p_sys->catchup;
+}
+
 static void EsOutChangeRate( es_out_t *out, float rate )
 {
     es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
@@ -706,7 +727,52 @@ static void EsOutChangeRate( es_out_t *out, float rate )
 
     foreach_es_then_es_slaves(es)
         if( es->p_dec != NULL )
-            input_DecoderChangeRate( es->p_dec, rate );
+            input_DecoderChangeRate( es->p_dec, EsOutGetPlaybackRate( p_sys ) );
+}
+
+static void EsOutChangeCatchup( es_out_t *out, float catchup )
+{
+    es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
+
+    if( p_sys->catchup == catchup )
+        return;
+
+    p_sys->catchup = catchup;
+    EsOutChangeRate( out, p_sys->rate );
+}
+
+static void EsOutUpdateLowLatency( es_out_t *out, es_out_pgrm_t *p_pgrm )
+{
+    es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
+    vlc_tick_t i_jitter, i_headroom;
+
+    if( input_clock_GetArrival( p_pgrm->p_input_clock,
+                                &i_jitter, &i_headroom ) != VLC_SUCCESS )
+        return;
+
+    struct input_stats *stats = input_priv(p_sys->p_input)->stats;
+    if( stats != NULL )
+    {
+        atomic_store_explicit( &stats->clock_jitter, i_jitter,
+                               memory_order_relaxed );
+        atomic_store_explicit( &stats->clock_headroom, __MAX( i_headroom, 0 ),
+                               memory_order_relaxed );
+    }
+
+    /* Do not fight against the user playback rate */
+    float catchup = 1.f;
+    if( p_sys->rate == 1.f )
+        catchup = input_clock_GetCatchup( p_sys->catchup,
+                                          i_jitter, i_headroom );
+
+    if( catchup != p_sys->catchup )
+    {
+        msg_Dbg( p_sys->p_input, "%s live edge (jitter %"PRId64" ms, "
+                 "buffering %"PRId64" ms)",
+                 catchup != 1.f ? "catching up with" : "reached",
+                 MS_FROM_VLC_TICK(i_jitter), MS_FROM_VLC_TICK(i_headroom) );
+        EsOutChangeCatchup( out, catchup );
+    }
 }
 
 static void EsOutChangePosition( es_out_t *out, bool b_flush )
@@ -716,6 +782,9 @@ static void EsOutChangePosition( es_out_t *out, bool b_flush )
 
     input_SendEventCache( p_sys->p_input, 0.0 );
 
+    /* We will rebuffer, no need to catch up anymore */
+    EsOutChangeCatchup( out, 1.f );
+
     foreach_es_then_es_slaves(p_es)
         if( p_es->p_dec != NULL )
         {
@@ -914,13 +983,23 @@ static void EsOutProgramsChangeRate( es_out_t *out )
     es_out_pgrm_t *pgrm;
 
     vlc_list_foreach(pgrm, &p_sys->programs, node)
-        input_clock_ChangeRate(pgrm->p_input_clock, p_sys->rate);
+        input_clock_ChangeRate(pgrm->p_input_clock,
+                               EsOutGetPlaybackRate( p_sys ));
+}
+
+static es_out_id_t *EsOutGetFrameVideo( es_out_sys_t *p_sys )
+{
+    es_out_id_t *p_es;
+
+    foreach_es_then_es_slaves(p_es)
+        if( p_es->fmt.i_cat == VIDEO_ES && p_es->p_dec )
+            return p_es;
+    return NULL;
 }
 
 static void EsOutFrameNext( es_out_t *out )
 {
     es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
-    es_out_id_t *p_es_video = NULL, *p_es;
 
     if( p_sys->b_buffering )
     {
@@ -930,13 +1009,7 @@ static void EsOutFrameNext( es_out_t *out )
 
     assert( p_sys->b_paused );
 
-    foreach_es_then_es_slaves(p_es)
-        if( p_es->fmt.i_cat == VIDEO_ES && p_es->p_dec && !p_es_video /* nested loop */ )
-        {
-            p_es_video = p_es;
-            break;
-        }
-
+    es_out_id_t *p_es_video = EsOutGetFrameVideo( p_sys );
     if( !p_es_video )
     {
         msg_Warn( p_sys->p_input, "No video track selected, ignoring 'frame next'" );
@@ -981,6 +1054,79 @@ static void EsOutFrameNext( es_out_t *out )
     p_sys->i_preroll_end = -1;
     p_sys->i_prev_stream_level = -1;
 }
+
+static void EsOutSetSeekTime( es_out_t *out, vlc_tick_t i_time )
+{
+    es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
+
+    /* Without a next display time, the seek was not precise */
+    p_sys->b_scrub_offset = p_sys->i_preroll_end >= 0;
+    if( p_sys->b_scrub_offset )
+        p_sys->i_scrub_offset = p_sys->i_preroll_end - i_time;
+}
+
+static int EsOutScrub( es_out_t *out, vlc_tick_t i_time )
+{
+    es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
+
+    if( !p_sys->b_paused || p_sys->b_buffering || !p_sys->b_scrub_offset )
+        return VLC_EGENERIC;
+
+    es_out_id_t *p_es_video = EsOutGetFrameVideo( p_sys );
+    if( !p_es_video )
+        return VLC_EGENERIC;
+
+    if( input_DecoderScrub( p_es_video->p_dec,
+                            i_time + p_sys->i_scrub_offset ) )
+        return VLC_EGENERIC;
+
+    msg_Dbg( p_sys->p_input, "scrubbed to %"PRId64" from the cache", i_time );
+    return VLC_SUCCESS;
+}
+
+static int EsOutScrubStep( es_out_t *out, bool b_forward, vlc_tick_t *pi_time )
+{
+    es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
+
+    *pi_time = VLC_TICK_INVALID;
+    if( !p_sys->b_paused || p_sys->b_buffering )
+        return VLC_EGENERIC;
+
+    es_out_id_t *p_es_video = EsOutGetFrameVideo( p_sys );
+    if( !p_es_video )
+        return VLC_EGENERIC;
+
+    vlc_tick_t i_duration, i_time;
+    const vlc_tick_t i_date = input_DecoderGetScrubDate( p_es_video->p_dec,
+                                                         &i_duration );
+    if( p_sys->b_scrub_offset && i_date != VLC_TICK_INVALID )
+    {
+        vlc_tick_t i_step_date;
+
+        if( !input_DecoderScrubStep( p_es_video->p_dec, i_date, b_forward,
+                                     &i_step_date ) )
+        {
+            *pi_time = i_step_date - p_sys->i_scrub_offset;
+            return VLC_SUCCESS;
+        }
+        i_time = i_date - p_sys->i_scrub_offset;
+    }
+    else /* Not seeked precisely yet, rely on the last reported time */
+        i_time = p_sys->i_last_time;
+
+    if( i_time == VLC_TICK_INVALID )
+        return VLC_EGENERIC;
+
+    /* A precise seek shows the first picture dated at or after the time:
+     * aim just after the current picture, or in the middle of the previous
+     * one to be robust against rounded dates */
+    if( b_forward )
+        *pi_time = i_time + 1;
+    else if( i_duration > 0 )
+        *pi_time = __MAX( i_time - i_duration * 3 / 2, VLC_TICK_0 );
+    return VLC_EGENERIC;
+}
+
 static vlc_tick_t EsOutGetBuffering( es_out_t *out )
 {
     es_out_sys_t *p_sys = container_of(out, es_out_sys_t, out);
@@ -1147,8 +1293,9 @@ static es_out_pgrm_t *EsOutProgramAdd( es_out_t *out, int i_group )
     p_pgrm->p_meta = NULL;
 
     p_pgrm->p_master_clock = NULL;
-    p_pgrm->p_input_clock = input_clock_New( p_sys->rate );
-    p_pgrm->p_main_clock = vlc_clock_main_New();
+    p_pgrm->p_input_clock = input_clock_New( EsOutGetPlaybackRate( p_sys ),
+                                             p_sys->b_low_latency );
+    p_pgrm->p_main_clock = vlc_clock_main_New( p_sys->b_low_latency );
     if( !p_pgrm->p_input_clock || !p_pgrm->p_main_clock )
     {
         if( p_pgrm->p_input_clock )
@@ -1825,7 +1972,7 @@ static void EsOutCreateDecoder( es_out_t *out, es_out_id_t *p_es )
                             input_priv(p_input)->p_sout );
     if( dec != NULL )
     {
-        input_DecoderChangeRate( dec, p_sys->rate );
+        input_DecoderChangeRate( dec, EsOutGetPlaybackRate( p_sys ) );
 
         if( p_sys->b_buffering )
             input_DecoderStartWait( dec );
@@ -2283,6 +2430,12 @@ static int EsOutSend( es_out_t *out, es_out_id_t *es, block_t *p_block )
         }
     }
 
+    struct vlc_tracer *tracer = vlc_object_get_tracer( p_input );
+    if( tracer != NULL )
+        vlc_tracer_TraceStreamPTS( tracer, "DEMUX", es->fmt.i_id, "OUT",
+                                   p_block->i_pts != VLC_TICK_INVALID ?
+                                   p_block->i_pts : p_block->i_dts );
+
     /* Decode */
     if( es->p_dec_record )
     {
@@ -2778,6 +2931,11 @@ static int EsOutVaControlLocked( es_out_t *out, int i_query, va_list args )
                                     i_pts_delay - i_pts_delay_base,
                                     p_sys->i_cr_average );
             }
+            else if( p_sys->b_low_latency &&
+                     !input_priv(p_sys->p_input)->b_can_pace_control &&
+                     ( !input_priv(p_sys->p_input)->p_sout ||
+                       !input_priv(p_sys->p_input)->b_out_pace_control ) )
+                EsOutUpdateLowLatency( out, p_pgrm );
         }
         return VLC_SUCCESS;
     }
@@ -3004,6 +3162,20 @@ static int EsOutVaControlLocked( es_out_t *out, int i_query, va_list args )
         EsOutFrameNext( out );
         return VLC_SUCCESS;
 
+    case ES_OUT_SET_SEEK_TIME:
+        EsOutSetSeekTime( out, va_arg( args, vlc_tick_t ) );
+        return VLC_SUCCESS;
+
+    case ES_OUT_SCRUB:
+        return EsOutScrub( out, va_arg( args, vlc_tick_t ) );
+
+    case ES_OUT_SCRUB_STEP:
+    {
+        const bool b_forward = va_arg( args, int );
+        vlc_tick_t *pi_time = va_arg( args, vlc_tick_t * );
+        return EsOutScrubStep( out, b_forward, pi_time );
+    }
+
     case ES_OUT_SET_TIMES:
     {
         double f_position = va_arg( args, double );
@@ -3032,6 +3204,7 @@ static int EsOutVaControlLocked( es_out_t *out, int i_query, va_list args )
             if( f_position < 0 )
                 f_position = 0;
 
+            p_sys->i_last_time = i_time;
             input_SendEventPosition( p_sys->p_input, f_position, i_time );
         }
         return VLC_SUCCESS;
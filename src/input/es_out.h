@@ -73,6 +73,17 @@ enum es_out_query_private_e
     /* Set next frame */
     ES_OUT_SET_FRAME_NEXT,                          /*                          res=can fail */
 
+    /* Set the time of a precise seek, after the demuxer has set the next display time */
+    ES_OUT_SET_SEEK_TIME,                           /* arg1=vlc_tick_t          res=cannot fail */
+
+    /* Show the cached picture at a time while paused */
+    ES_OUT_SCRUB,                                   /* arg1=vlc_tick_t          res=can fail */
+
+    /* Show the cached picture next to the current one while paused.
+     * On failure, the time to seek precisely to is returned if known,
+     * VLC_TICK_INVALID otherwise */
+    ES_OUT_SCRUB_STEP,                              /* arg1=bool b_forward arg2=vlc_tick_t * res=can fail */
+
     /* Set position/time/length */
     ES_OUT_SET_TIMES,                               /* arg1=double f_position arg2=vlc_tick_t i_time arg3=vlc_tick_t i_length res=cannot fail */
 
@@ -142,6 +153,19 @@ static inline int es_out_SetFrameNext( es_out_t *p_out )
 {
     return es_out_Control( p_out, ES_OUT_SET_FRAME_NEXT );
 }
+static inline void es_out_SetSeekTime( es_out_t *p_out, vlc_tick_t i_time )
+{
+    int i_ret = es_out_Control( p_out, ES_OUT_SET_SEEK_TIME, i_time );
+    assert( !i_ret );
+}
+static inline int es_out_Scrub( es_out_t *p_out, vlc_tick_t i_time )
+{
+    return es_out_Control( p_out, ES_OUT_SCRUB, i_time );
+}
+static inline int es_out_ScrubStep( es_out_t *p_out, bool b_forward, vlc_tick_t *pi_time )
+{
+    return es_out_Control( p_out, ES_OUT_SCRUB_STEP, b_forward, pi_time );
+}
 static inline void es_out_SetTimes( es_out_t *p_out, double f_position, vlc_tick_t i_time, vlc_tick_t i_length )
 {
     int i_ret = es_out_Control( p_out, ES_OUT_SET_TIMES, f_position, i_time, i_length );
@@ -596,6 +596,23 @@ static int ControlLockedSetFrameNext( es_out_t *p_out )
     return es_out_SetFrameNext( p_sys->p_out );
 }
 
+static int ControlLockedScrub( es_out_t *p_out, int i_query, va_list args )
+{
+    es_out_sys_t *p_sys = container_of(p_out, es_out_sys_t, out);
+
+    /* The decoders lag behind the demuxer by the whole buffer while it is
+     * in use: their cached pictures cannot be matched to the input time */
+    if( !p_sys->b_delayed )
+        return es_out_vaControl( p_sys->p_out, i_query, args );
+
+    if( i_query == ES_OUT_SCRUB_STEP )
+    {
+        (void)va_arg( args, int );
+        *va_arg( args, vlc_tick_t * ) = VLC_TICK_INVALID;
+    }
+    return VLC_EGENERIC;
+}
+
 static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
 {
     es_out_sys_t *p_sys = container_of(p_out, es_out_sys_t, out);
@@ -717,6 +734,10 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
         return ControlLockedSetFrameNext( p_out );
     }
 
+    case ES_OUT_SCRUB:
+    case ES_OUT_SCRUB_STEP:
+        return ControlLockedScrub( p_out, i_query, args );
+
     case ES_OUT_GET_PCR_SYSTEM:
         if( p_sys->b_delayed )
             return VLC_EGENERIC;
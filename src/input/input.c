@@ -303,6 +303,7 @@ static input_thread_t *Create( vlc_object_t *p_parent,
     priv->i_start = 0;
     priv->i_time  = 0;
     priv->i_stop  = 0;
+    priv->b_scrubbed = false;
     priv->i_title = 0;
     priv->title = NULL;
     priv->i_title_offset = input_priv(p_input)->i_seekpoint_offset = 0;
@@ -748,6 +749,16 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
     demux_t *p_demux = input_priv(p_input)->master->p_demux;
     const bool b_can_demux = p_demux->pf_demux != NULL;
 
+    /* Seek before demuxing, or the thumbnail would be the first picture */
+    if( input_priv(p_input)->b_thumbnailing )
+    {
+        int i_type;
+        input_control_param_t param;
+
+        while( !ControlPop( p_input, &i_type, &param, 0, false ) )
+            Control( p_input, i_type, param );
+    }
+
     while( !input_Stopped( p_input ) && input_priv(p_input)->i_state != ERROR_S )
     {
         vlc_tick_t i_wakeup = -1;
@@ -1892,6 +1903,110 @@ static void ControlInsertDemuxFilter( input_thread_t* p_input, const char* psz_d
 }
 
 
+static bool ControlSeekTime( input_thread_t *p_input, vlc_tick_t i_time,
+                             bool b_fast_seek, bool absolute )
+{
+    input_thread_private_t *priv = input_priv(p_input);
+    int i_ret;
+
+    priv->b_scrubbed = false;
+
+    /* Reset the decoders states and clock sync (before calling the demuxer */
+    es_out_Control( priv->p_es_out, ES_OUT_RESET_PCR );
+
+    i_ret = demux_SetTime( priv->master->p_demux, i_time, !b_fast_seek,
+                           absolute );
+    if( i_ret )
+    {
+        vlc_tick_t i_length;
+
+        /* Emulate it with a SET_POS */
+        if( !demux_Control( priv->master->p_demux,
+                            DEMUX_GET_LENGTH, &i_length ) && i_length > 0 )
+        {
+            double f_pos = (double)i_time / (double)i_length;
+            i_ret = demux_SetPosition( priv->master->p_demux, f_pos,
+                                       !b_fast_seek, absolute );
+        }
+    }
+    if( i_ret )
+    {
+        msg_Warn( p_input, "INPUT_CONTROL_SET_TIME %s%"PRId64
+                 " failed or not possible",
+                 absolute ? "@" : i_time >= 0 ? "+" : "", i_time );
+        return false;
+    }
+
+    /* Map the time to the stream dates for scrubbing */
+    if( absolute && !b_fast_seek )
+        es_out_SetSeekTime( priv->p_es_out_display, i_time );
+
+    if( priv->i_slave > 0 )
+        SlaveSeek( p_input );
+    priv->master->b_eof = false;
+    return true;
+}
+
+static void ControlScrubSetTime( input_thread_t *p_input, vlc_tick_t i_time )
+{
+    input_thread_private_t *priv = input_priv(p_input);
+    vlc_tick_t i_length;
+
+    priv->b_scrubbed = true;
+    priv->i_scrub_time = i_time;
+
+    /* The input is paused, the main loop does not report the time */
+    if( demux_Control( priv->master->p_demux, DEMUX_GET_LENGTH, &i_length ) )
+        i_length = 0;
+    input_SendEventPosition( p_input,
+                             i_length > 0 ? (double)i_time / i_length : 0.0,
+                             i_time );
+}
+
+/* Shows the picture at i_time from the cache of the video decoder, without
+ * seeking the demuxer, while paused */
+static bool ControlScrub( input_thread_t *p_input, vlc_tick_t i_time )
+{
+    input_thread_private_t *priv = input_priv(p_input);
+
+    if( priv->i_state != PAUSE_S
+     || es_out_Scrub( priv->p_es_out, i_time ) )
+        return false;
+
+    ControlScrubSetTime( p_input, i_time );
+    return true;
+}
+
+static void ControlFrameStep( input_thread_t *p_input, bool b_forward )
+{
+    input_thread_private_t *priv = input_priv(p_input);
+    vlc_tick_t i_time;
+
+    if( !es_out_ScrubStep( priv->p_es_out, b_forward, &i_time ) )
+    {
+        ControlScrubSetTime( p_input, i_time );
+        return;
+    }
+
+    /* The decoder goes on from where the demuxer is */
+    if( b_forward && !priv->b_scrubbed )
+    {
+        es_out_SetFrameNext( priv->p_es_out );
+        return;
+    }
+
+    if( i_time == VLC_TICK_INVALID )
+    {
+        msg_Warn( p_input, "cannot step to the %s frame",
+                  b_forward ? "next" : "previous" );
+        return;
+    }
+
+    /* Decode from the keyframe again, the cache will hold the pictures
+     * for the next steps */
+    ControlSeekTime( p_input, i_time, false, true );
+}
+
 static bool Control( input_thread_t *p_input,
                      int i_type, input_control_param_t param )
 {
@@ -1901,6 +2016,11 @@ static bool Control( input_thread_t *p_input,
     bool b_force_update = false;
     vlc_value_t val;
 
+    /* Other seeks move the demuxer away from the cached picture anyway */
+    if( ControlIsSeekRequest( i_type ) && i_type != INPUT_CONTROL_SET_TIME
+     && i_type != INPUT_CONTROL_JUMP_TIME )
+        priv->b_scrubbed = false;
+
     switch( i_type )
     {
         case INPUT_CONTROL_SET_POSITION:
@@ -1937,8 +2057,7 @@ static bool Control( input_thread_t *p_input,
         case INPUT_CONTROL_SET_TIME:
         case INPUT_CONTROL_JUMP_TIME:
         {
-            const bool absolute = i_type == INPUT_CONTROL_SET_TIME;
-            int i_ret;
+            bool absolute = i_type == INPUT_CONTROL_SET_TIME;
 
             if( priv->b_recording )
             {
@@ -1946,40 +2065,19 @@ static bool Control( input_thread_t *p_input,
                 break;
             }
 
-            /* Reset the decoders states and clock sync (before calling the demuxer */
-            es_out_Control( priv->p_es_out, ES_OUT_RESET_PCR );
-
-            i_ret = demux_SetTime( priv->master->p_demux, param.time.i_val,
-                                   !param.time.b_fast_seek, absolute );
-            if( i_ret )
-            {
-                vlc_tick_t i_length;
-
-                /* Emulate it with a SET_POS */
-                if( !demux_Control( priv->master->p_demux,
-                                    DEMUX_GET_LENGTH, &i_length ) && i_length > 0 )
-                {
-                    double f_pos = (double)param.time.i_val / (double)i_length;
-                    i_ret = demux_SetPosition( priv->master->p_demux, f_pos,
-                                               !param.time.b_fast_seek,
-                                               absolute );
-                }
-            }
-            if( i_ret )
+            /* The demuxer is not where the cached picture was shown */
+            if( !absolute && priv->b_scrubbed )
             {
-                msg_Warn( p_input, "INPUT_CONTROL_SET_TIME %s%"PRId64
-                         " failed or not possible",
-                         absolute ? "@" : param.time.i_val >= 0 ? "+" : "",
-                         param.time.i_val );
+                param.time.i_val += priv->i_scrub_time;
+                absolute = true;
             }
-            else
-            {
-                if( priv->i_slave > 0 )
-                    SlaveSeek( p_input );
-                priv->master->b_eof = false;
 
-                b_force_update = true;
-            }
+            if( absolute && ControlScrub( p_input, param.time.i_val ) )
+                break;
+
+            b_force_update = ControlSeekTime( p_input, param.time.i_val,
+                                              param.time.b_fast_seek,
+                                              absolute );
             break;
         }
 
@@ -1989,6 +2087,10 @@ static bool Control( input_thread_t *p_input,
                 case PLAYING_S:
                     if( priv->i_state == PAUSE_S )
                     {
+                        /* Resume from the picture shown from the cache */
+                        if( priv->b_scrubbed )
+                            ControlSeekTime( p_input, priv->i_scrub_time,
+                                             false, true );
                         ControlUnpause( p_input, i_control_date );
                         b_force_update = true;
                     }
@@ -2289,9 +2391,13 @@ static bool Control( input_thread_t *p_input,
             break;
 
         case INPUT_CONTROL_SET_FRAME_NEXT:
+        case INPUT_CONTROL_SET_FRAME_PREVIOUS:
+        {
+            const bool b_forward = i_type == INPUT_CONTROL_SET_FRAME_NEXT;
+
             if( priv->i_state == PAUSE_S )
             {
-                es_out_SetFrameNext( priv->p_es_out );
+                ControlFrameStep( p_input, b_forward );
             }
             else if( priv->i_state == PLAYING_S )
             {
@@ -2299,10 +2405,12 @@ static bool Control( input_thread_t *p_input,
             }
             else
             {
-                msg_Err( p_input, "invalid state for frame next" );
+                msg_Err( p_input, "invalid state for frame %s",
+                         b_forward ? "next" : "previous" );
             }
             b_force_update = true;
             break;
+        }
 
         case INPUT_CONTROL_SET_BOOKMARK:
         {
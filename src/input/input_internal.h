@@ -138,6 +138,8 @@ typedef struct input_thread_private_t
     vlc_tick_t  i_start;    /* :start-time,0 by default */
     vlc_tick_t  i_stop;     /* :stop-time, 0 if none */
     vlc_tick_t  i_time;     /* Current time */
+    bool        b_scrubbed; /* Paused on a cached picture, the demuxer is elsewhere */
+    vlc_tick_t  i_scrub_time; /* Time of the cached picture */
 
     /* Delays */
     vlc_tick_t  i_audio_delay;
@@ -263,6 +265,7 @@ enum input_control_e
     INPUT_CONTROL_SET_RECORD_STATE,
 
     INPUT_CONTROL_SET_FRAME_NEXT,
+    INPUT_CONTROL_SET_FRAME_PREVIOUS,
 
     INPUT_CONTROL_SET_RENDERER,
 
@@ -356,6 +359,12 @@ struct input_stats {
     atomic_uintmax_t lost_abuffers;
     atomic_uintmax_t displayed_pictures;
     atomic_uintmax_t lost_pictures;
+    atomic_uintmax_t late_pictures;
+    atomic_uintmax_t timed_pictures;
+    atomic_uintmax_t display_offset_sum;
+    atomic_uintmax_t display_offset_max;
+    atomic_uintmax_t clock_jitter;
+    atomic_uintmax_t clock_headroom;
 };
 
 struct input_stats *input_stats_Create(void);
@@ -0,0 +1,281 @@
+/*****************************************************************************
+ * scrub.c: cache of decoded pictures for scrubbing
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+#include "scrub.h"
+
+struct input_scrub_entry
+{
+    vlc_tick_t i_date;
+    picture_t *p_pic;
+    size_t     i_size;
+    /* The previous entry was output by the decoder right before this one */
+    bool       b_linked;
+};
+
+struct input_scrub_t
+{
+    vlc_mutex_t lock;
+
+    /* Entries sorted by date */
+    struct input_scrub_entry *p_entries;
+    size_t i_count;
+    size_t i_alloc;
+
+    size_t i_size;
+    size_t i_max_size;
+
+    /* Date of the last added picture, invalid after a flush */
+    vlc_tick_t i_last;
+    /* Date around which the entries are kept */
+    vlc_tick_t i_focus;
+};
+
+input_scrub_t *input_scrub_New( size_t i_max_size )
+{
+    input_scrub_t *p_scrub = malloc( sizeof( *p_scrub ) );
+    if( unlikely(p_scrub == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &p_scrub->lock );
+    p_scrub->p_entries = NULL;
+    p_scrub->i_count = 0;
+    p_scrub->i_alloc = 0;
+    p_scrub->i_size = 0;
+    p_scrub->i_max_size = i_max_size;
+    p_scrub->i_last = VLC_TICK_INVALID;
+    p_scrub->i_focus = VLC_TICK_INVALID;
+    return p_scrub;
+}
+
+void input_scrub_Delete( input_scrub_t *p_scrub )
+{
+    for( size_t i = 0; i < p_scrub->i_count; i++ )
+        picture_Release( p_scrub->p_entries[i].p_pic );
+    free( p_scrub->p_entries );
+    vlc_mutex_destroy( &p_scrub->lock );
+    free( p_scrub );
+}
+
+/* Returns the index of the first entry dated after i_date */
+static size_t Upper( const input_scrub_t *p_scrub, vlc_tick_t i_date )
+{
+    size_t i_low = 0, i_high = p_scrub->i_count;
+
+    while( i_low < i_high )
+    {
+        const size_t i_mid = (i_low + i_high) / 2;
+
+        if( p_scrub->p_entries[i_mid].i_date <= i_date )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+static void Remove( input_scrub_t *p_scrub, size_t i )
+{
+    struct input_scrub_entry *p_entries = p_scrub->p_entries;
+
+    picture_Release( p_entries[i].p_pic );
+    p_scrub->i_size -= p_entries[i].i_size;
+    memmove( &p_entries[i], &p_entries[i + 1],
+             (p_scrub->i_count - i - 1) * sizeof( *p_entries ) );
+    p_scrub->i_count--;
+
+    /* The entry following the removed one has lost its predecessor */
+    if( i < p_scrub->i_count )
+        p_entries[i].b_linked = false;
+}
+
+/* Drops the entries the farthest from the focus until the cache fits */
+static void Evict( input_scrub_t *p_scrub )
+{
+    while( p_scrub->i_size > p_scrub->i_max_size && p_scrub->i_count > 1 )
+    {
+        const struct input_scrub_entry *p_first = &p_scrub->p_entries[0];
+        const struct input_scrub_entry *p_last =
+            &p_scrub->p_entries[p_scrub->i_count - 1];
+
+        if( p_scrub->i_focus - p_first->i_date >
+            p_last->i_date - p_scrub->i_focus )
+            Remove( p_scrub, 0 );
+        else
+            Remove( p_scrub, p_scrub->i_count - 1 );
+    }
+}
+
+static size_t PictureSize( const picture_t *p_pic )
+{
+    size_t i_size = 0;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        i_size += (size_t)p_pic->p[i].i_pitch * p_pic->p[i].i_lines;
+    return i_size;
+}
+
+void input_scrub_Add( input_scrub_t *p_scrub, const picture_t *p_pic )
+{
+    const vlc_tick_t i_date = p_pic->date;
+
+    /* Opaque pictures cannot be copied */
+    if( i_date == VLC_TICK_INVALID || p_pic->i_planes == 0 )
+        return;
+
+    vlc_mutex_lock( &p_scrub->lock );
+
+    const vlc_tick_t i_last = p_scrub->i_last;
+    size_t i = Upper( p_scrub, i_date );
+    struct input_scrub_entry *p_entry;
+
+    p_scrub->i_last = i_date;
+    p_scrub->i_focus = i_date;
+
+    if( i > 0 && p_scrub->p_entries[i - 1].i_date == i_date )
+    {
+        /* Decoded again, e.g. after seeking back */
+        p_entry = &p_scrub->p_entries[--i];
+    }
+    else
+    {
+        /* The copy may be laid out differently from the decoded picture:
+         * account what is actually kept */
+        picture_t *p_copy = picture_NewFromFormat( &p_pic->format );
+        if( unlikely(p_copy == NULL) )
+            goto error;
+
+        const size_t i_size = PictureSize( p_copy );
+        if( i_size > p_scrub->i_max_size )
+        {
+            picture_Release( p_copy );
+            goto error;
+        }
+
+        if( p_scrub->i_count == p_scrub->i_alloc )
+        {
+            const size_t i_alloc = p_scrub->i_alloc ? p_scrub->i_alloc * 2 : 16;
+            struct input_scrub_entry *p_entries =
+                realloc( p_scrub->p_entries, i_alloc * sizeof( *p_entries ) );
+            if( unlikely(p_entries == NULL) )
+            {
+                picture_Release( p_copy );
+                goto error;
+            }
+            p_scrub->p_entries = p_entries;
+            p_scrub->i_alloc = i_alloc;
+        }
+        picture_Copy( p_copy, p_pic );
+
+        p_entry = &p_scrub->p_entries[i];
+        memmove( p_entry + 1, p_entry,
+                 (p_scrub->i_count - i) * sizeof( *p_entry ) );
+        p_scrub->i_count++;
+
+        p_entry->i_date = i_date;
+        p_entry->p_pic = p_copy;
+        p_entry->b_linked = false;
+        p_entry->i_size = i_size;
+        p_scrub->i_size += p_entry->i_size;
+
+        /* The following entry was not decoded right after this new one */
+        if( i + 1 < p_scrub->i_count )
+            p_entry[1].b_linked = false;
+    }
+
+    /* A picture decoded again keeps its former predecessor */
+    if( i_last != VLC_TICK_INVALID && i > 0
+     && p_scrub->p_entries[i - 1].i_date == i_last )
+        p_entry->b_linked = true;
+
+    Evict( p_scrub );
+    vlc_mutex_unlock( &p_scrub->lock );
+    return;
+
+error:
+    /* The sequence of pictures is broken */
+    p_scrub->i_last = VLC_TICK_INVALID;
+    vlc_mutex_unlock( &p_scrub->lock );
+}
+
+void input_scrub_Flush( input_scrub_t *p_scrub )
+{
+    vlc_mutex_lock( &p_scrub->lock );
+    p_scrub->i_last = VLC_TICK_INVALID;
+    vlc_mutex_unlock( &p_scrub->lock );
+}
+
+/* Returns a copy of an entry, the cached one must stay untouched */
+static picture_t *Copy( input_scrub_t *p_scrub, size_t i )
+{
+    const picture_t *p_pic = p_scrub->p_entries[i].p_pic;
+    picture_t *p_copy = picture_NewFromFormat( &p_pic->format );
+
+    if( likely(p_copy != NULL) )
+        picture_Copy( p_copy, p_pic );
+    p_scrub->i_focus = p_pic->date;
+    return p_copy;
+}
+
+picture_t *input_scrub_Get( input_scrub_t *p_scrub, vlc_tick_t i_date )
+{
+    picture_t *p_pic = NULL;
+
+    vlc_mutex_lock( &p_scrub->lock );
+    const size_t i = Upper( p_scrub, i_date );
+
+    /* The picture before i is the one displayed at i_date only if no other
+     * picture was decoded in between */
+    if( i > 0 && i < p_scrub->i_count && p_scrub->p_entries[i].b_linked )
+        p_pic = Copy( p_scrub, i - 1 );
+    vlc_mutex_unlock( &p_scrub->lock );
+    return p_pic;
+}
+
+picture_t *input_scrub_Step( input_scrub_t *p_scrub, vlc_tick_t i_date,
+                             bool b_forward )
+{
+    picture_t *p_pic = NULL;
+
+    vlc_mutex_lock( &p_scrub->lock );
+    const size_t i = Upper( p_scrub, i_date );
+
+    if( i > 0 && p_scrub->p_entries[i - 1].i_date == i_date )
+    {
+        if( b_forward )
+        {
+            if( i < p_scrub->i_count && p_scrub->p_entries[i].b_linked )
+                p_pic = Copy( p_scrub, i );
+        }
+        else if( i > 1 && p_scrub->p_entries[i - 1].b_linked )
+            p_pic = Copy( p_scrub, i - 2 );
+    }
+    vlc_mutex_unlock( &p_scrub->lock );
+    return p_pic;
+}
@@ -0,0 +1,80 @@
+/*****************************************************************************
+ * scrub.h: cache of decoded pictures for scrubbing
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_INPUT_SCRUB_H
+#define LIBVLC_INPUT_SCRUB_H 1
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+
+/** @struct input_scrub_t
+ * This structure keeps copies of the pictures recently output by a video
+ * decoder, so that seeking back and forth within them while paused does not
+ * require decoding again from the previous keyframe.
+ *
+ * Pictures are indexed by their date. A picture is only returned when the
+ * cache knows it is the last one before the next cached picture, i.e. when
+ * both were decoded one after the other.
+ *
+ * XXX input_scrub_Add and input_scrub_Flush must be called from the decoder
+ * thread, the other functions can be called from any thread.
+ */
+typedef struct input_scrub_t input_scrub_t;
+
+/**
+ * This function creates a new input_scrub_t keeping at most i_max_size bytes
+ * of pictures.
+ * You must use input_scrub_Delete to delete it once unused.
+ */
+input_scrub_t *input_scrub_New( size_t i_max_size );
+
+/**
+ * This function destroys a input_scrub_t created by input_scrub_New.
+ */
+void input_scrub_Delete( input_scrub_t * );
+
+/**
+ * This function adds a copy of a decoded picture.
+ *
+ * Pictures must be added in decoding output order. Pictures without a date
+ * or without accessible pixels are ignored.
+ */
+void input_scrub_Add( input_scrub_t *, const picture_t *p_pic );
+
+/**
+ * This function tells that the next added picture will not follow the last
+ * added one, after a decoder flush.
+ */
+void input_scrub_Flush( input_scrub_t * );
+
+/**
+ * This function returns a copy of the picture displayed at i_date, or NULL
+ * if it is not cached.
+ */
+picture_t *input_scrub_Get( input_scrub_t *, vlc_tick_t i_date );
+
+/**
+ * This function returns a copy of the picture following (or preceding) the
+ * picture dated i_date, or NULL if they are not both cached.
+ */
+picture_t *input_scrub_Step( input_scrub_t *, vlc_tick_t i_date,
+                             bool b_forward );
+
+#endif
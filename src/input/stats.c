@@ -67,6 +67,12 @@ struct input_stats *input_stats_Create(void)
     atomic_init(&stats->lost_abuffers, 0);
     atomic_init(&stats->displayed_pictures, 0);
     atomic_init(&stats->lost_pictures, 0);
+    atomic_init(&stats->late_pictures, 0);
+    atomic_init(&stats->timed_pictures, 0);
+    atomic_init(&stats->display_offset_sum, 0);
+    atomic_init(&stats->display_offset_max, 0);
+    atomic_init(&stats->clock_jitter, 0);
+    atomic_init(&stats->clock_headroom, 0);
     return stats;
 }
 
@@ -110,6 +116,22 @@ void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
                                                     memory_order_relaxed);
     st->i_lost_pictures = atomic_load_explicit(&stats->lost_pictures,
                                                memory_order_relaxed);
+    st->i_late_pictures = atomic_load_explicit(&stats->late_pictures,
+                                               memory_order_relaxed);
+
+    uintmax_t timed = atomic_load_explicit(&stats->timed_pictures,
+                                           memory_order_relaxed);
+    st->i_display_offset_avg = timed > 0 ?
+        atomic_load_explicit(&stats->display_offset_sum,
+                             memory_order_relaxed) / timed : 0;
+    st->i_display_offset_max = atomic_load_explicit(&stats->display_offset_max,
+                                                    memory_order_relaxed);
+
+    /* Clock */
+    st->i_clock_jitter = atomic_load_explicit(&stats->clock_jitter,
+                                              memory_order_relaxed);
+    st->i_clock_headroom = atomic_load_explicit(&stats->clock_headroom,
+                                                memory_order_relaxed);
 }
 
 /** Update a counter element with new values
@@ -118,8 +118,7 @@ void stream_CommonDelete(stream_t *s)
     if (priv->text.conv != (vlc_iconv_t)(-1))
         vlc_iconv_close(priv->text.conv);
 
-    if (priv->peek != NULL)
-        block_Release(priv->peek);
+    block_ChainRelease(priv->peek);
     if (priv->block != NULL)
         block_Release(priv->block);
 
@@ -395,8 +394,9 @@ static ssize_t vlc_stream_CopyBlock(block_t **restrict pp,
 
     if (block->i_buffer == 0)
     {
+        *pp = block->p_next;
+        block->p_next = NULL;
         block_Release(block);
-        *pp = NULL;
     }
 
     return likely(len > 0) ? (ssize_t)len : -1;
@@ -512,8 +512,41 @@ ssize_t vlc_stream_Peek(stream_t *s, const uint8_t **restrict bufp, size_t len)
         peek->i_buffer = 0;
     }
     else
+    if (peek->i_buffer < len && peek->p_next != NULL)
+    {   /* Gather as much of the peek chain as needed */
+        size_t avail = 0;
+        block_t *rest = peek;
+
+        while (rest != NULL && avail < len)
+        {
+            avail += rest->i_buffer;
+            rest = rest->p_next;
+        }
+
+        block_t *gather = block_Alloc(__MAX(avail, len));
+        if (unlikely(gather == NULL))
+            return VLC_ENOMEM;
+
+        gather->i_buffer = 0;
+        while (peek != rest)
+        {
+            block_t *next = peek->p_next;
+
+            memcpy(gather->p_buffer + gather->i_buffer, peek->p_buffer,
+                   peek->i_buffer);
+            gather->i_buffer += peek->i_buffer;
+            peek->p_next = NULL;
+            block_Release(peek);
+            peek = next;
+        }
+        gather->p_next = rest;
+        peek = gather;
+        priv->peek = peek;
+    }
+
     if (peek->i_buffer < len)
     {
+        assert(peek->p_next == NULL);
         size_t avail = peek->i_buffer;
 
         peek = block_TryRealloc(peek, 0, len);
@@ -544,6 +577,75 @@ ssize_t vlc_stream_Peek(stream_t *s, const uint8_t **restrict bufp, size_t len)
     return len;
 }
 
+ssize_t vlc_stream_PeekChain(stream_t *s, const block_t **restrict chainp,
+                             size_t len)
+{
+    stream_priv_t *priv = (stream_priv_t *)s;
+    block_t **pp = &priv->peek;
+    size_t avail = 0;
+
+    while (*pp != NULL)
+    {
+        avail += (*pp)->i_buffer;
+        pp = &(*pp)->p_next;
+    }
+
+    while (avail < len)
+    {
+        block_t *block;
+
+        if (vlc_killed())
+            break;
+
+        if (priv->block != NULL)
+        {
+            block = priv->block;
+            priv->block = NULL;
+        }
+        else if (s->pf_block != NULL)
+        {
+            bool eof = false;
+
+            block = s->pf_block(s, &eof);
+            if (block == NULL)
+            {
+                if (eof)
+                    break;
+                continue;
+            }
+        }
+        else if (s->pf_read != NULL)
+        {
+            block = block_Alloc(__MAX(len - avail, 4096));
+            if (unlikely(block == NULL))
+                return VLC_ENOMEM;
+
+            ssize_t ret = s->pf_read(s, block->p_buffer, block->i_buffer);
+            if (ret <= 0)
+            {
+                block_Release(block);
+                if (ret == 0)
+                    break;
+                continue;
+            }
+            block->i_buffer = ret;
+        }
+        else
+            break;
+
+        *pp = block;
+        while (block != NULL)
+        {
+            avail += block->i_buffer;
+            pp = &block->p_next;
+            block = block->p_next;
+        }
+    }
+
+    *chainp = priv->peek;
+    return __MIN(avail, len);
+}
+
 block_t *vlc_stream_ReadBlock(stream_t *s)
 {
     stream_priv_t *priv = (stream_priv_t *)s;
@@ -558,7 +660,8 @@ block_t *vlc_stream_ReadBlock(stream_t *s)
     if (priv->peek != NULL)
     {
         block = priv->peek;
-        priv->peek = NULL;
+        priv->peek = block->p_next;
+        block->p_next = NULL;
     }
     else if (priv->block != NULL)
     {
@@ -617,21 +720,23 @@ int vlc_stream_Seek(stream_t *s, uint64_t offset)
     block_t *peek = priv->peek;
     if (peek != NULL)
     {
-        if (offset >= priv->offset
-         && offset <= (priv->offset + peek->i_buffer))
-        {   /* Seeking within the peek buffer */
-            size_t fwd = offset - priv->offset;
+        size_t avail;
 
-            peek->p_buffer += fwd;
-            peek->i_buffer -= fwd;
-            priv->offset = offset;
+        block_ChainProperties(peek, NULL, &avail, NULL);
+        if (offset >= priv->offset && offset <= (priv->offset + avail))
+        {   /* Seeking within the peek buffers */
+            size_t fwd = offset - priv->offset;
 
-            if (peek->i_buffer == 0)
+            while (fwd > 0)
             {
-                priv->peek = NULL;
-                block_Release(peek);
+                ssize_t copy = vlc_stream_CopyBlock(&priv->peek, NULL, fwd);
+                if (copy > 0)
+                    fwd -= copy;
             }
-
+            /* Drop emptied buffers */
+            while (priv->peek != NULL && priv->peek->i_buffer == 0)
+                vlc_stream_CopyBlock(&priv->peek, NULL, 0);
+            priv->offset = offset;
             return VLC_SUCCESS;
         }
     }
@@ -650,11 +755,8 @@ int vlc_stream_Seek(stream_t *s, uint64_t offset)
 
     priv->offset = offset;
 
-    if (peek != NULL)
-    {
-        priv->peek = NULL;
-        block_Release(peek);
-    }
+    block_ChainRelease(peek);
+    priv->peek = NULL;
 
     if (priv->block != NULL)
     {
@@ -685,11 +787,8 @@ int vlc_stream_vaControl(stream_t *s, int cmd, va_list args)
 
             priv->offset = 0;
 
-            if (priv->peek != NULL)
-            {
-                block_Release(priv->peek);
-                priv->peek = NULL;
-            }
+            block_ChainRelease(priv->peek);
+            priv->peek = NULL;
 
             if (priv->block != NULL)
             {
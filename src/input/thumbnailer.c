@@ -26,12 +26,24 @@
 
 #include <vlc_thumbnailer.h>
 #include <vlc_input.h>
+#include <vlc_image.h>
 #include "misc/background_worker.h"
 
+#define THUMBNAILER_MAX_SCALERS 8
+
 struct vlc_thumbnailer_t
 {
     vlc_object_t* parent;
     struct background_worker* worker;
+    /* Scales and delivers the thumbnails of the batch requests */
+    struct background_worker* scaler;
+};
+
+/* A thumbnail time of a batch request */
+struct thumbnailer_target
+{
+    vlc_tick_t time;
+    size_t index;
 };
 
 typedef struct vlc_thumbnailer_params_t
@@ -54,6 +66,15 @@ typedef struct vlc_thumbnailer_params_t
      */
     vlc_tick_t timeout;
     vlc_thumbnailer_cb cb;
+    struct
+    {
+        const vlc_tick_t* times;
+        /* 0 if the request is not a batch */
+        size_t count;
+        unsigned width;
+        unsigned height;
+        vlc_thumbnailer_batch_cb cb;
+    } batch;
     void* user_data;
 } vlc_thumbnailer_params_t;
 
@@ -64,10 +85,206 @@ struct vlc_thumbnailer_request_t
 
     vlc_thumbnailer_params_t params;
 
+    /* Batch requests: the targets sorted by time, the next one to take, and
+     * the number of thumbnails being scaled */
+    struct thumbnailer_target *targets;
+    size_t next;
+    unsigned pending;
+    vlc_cond_t wait;
+    image_handler_t *handlers[THUMBNAILER_MAX_SCALERS];
+    unsigned handler_count;
+
     vlc_mutex_t lock;
     bool done;
 };
 
+/* The thumbnail of one or several targets with the same time */
+struct thumbnailer_job
+{
+    vlc_thumbnailer_request_t *request;
+    picture_t *pic;
+    size_t first;
+    size_t last;
+};
+
+static picture_t *thumbnailer_Scale( image_handler_t *handler, picture_t *pic,
+                                     unsigned width, unsigned height )
+{
+    video_format_t fmt_in = pic->format;
+    if( fmt_in.i_sar_num == 0 || fmt_in.i_sar_den == 0 )
+        fmt_in.i_sar_num = fmt_in.i_sar_den = 1;
+
+    /* Fit the display size of the picture in width x height */
+    const uint64_t display_width = (uint64_t)fmt_in.i_visible_width
+                                 * fmt_in.i_sar_num / fmt_in.i_sar_den;
+    const uint64_t display_height = fmt_in.i_visible_height;
+    if( display_width == 0 || display_height == 0 )
+        return NULL;
+
+    if( width == 0 || ( height != 0 &&
+                        display_width * height < display_height * width ) )
+        width = display_width * height / display_height;
+    else
+        height = display_height * width / display_width;
+
+    video_format_t fmt_out;
+    video_format_Init( &fmt_out, fmt_in.i_chroma );
+    fmt_out.i_width = fmt_out.i_visible_width = __MAX( width, 1 );
+    fmt_out.i_height = fmt_out.i_visible_height = __MAX( height, 1 );
+    fmt_out.i_sar_num = fmt_out.i_sar_den = 1;
+
+    picture_t *scaled = image_Convert( handler, pic, &fmt_in, &fmt_out );
+    video_format_Clean( &fmt_out );
+    return scaled;
+}
+
+static void thumbnailer_job_Hold( void* data )
+{
+    VLC_UNUSED(data);
+}
+
+static void thumbnailer_job_Release( void* data )
+{
+    struct thumbnailer_job *job = data;
+    vlc_thumbnailer_request_t *request = job->request;
+    vlc_thumbnailer_t *thumbnailer = request->thumbnailer;
+
+    picture_Release( job->pic );
+    free( job );
+
+    vlc_mutex_lock( &request->lock );
+    assert( request->pending > 0 );
+    request->pending--;
+    vlc_cond_signal( &request->wait );
+    vlc_mutex_unlock( &request->lock );
+    background_worker_RequestProbe( thumbnailer->worker );
+}
+
+static int thumbnailer_job_Start( void* owner, void* entity, void** out )
+{
+    vlc_thumbnailer_t *thumbnailer = owner;
+    struct thumbnailer_job *job = entity;
+    vlc_thumbnailer_request_t *request = job->request;
+    const unsigned width = request->params.batch.width;
+    const unsigned height = request->params.batch.height;
+    picture_t *pic = job->pic;
+    image_handler_t *handler = NULL;
+
+    vlc_mutex_lock( &request->lock );
+    bool cancelled = request->params.batch.cb == NULL;
+    if ( request->handler_count > 0 )
+        handler = request->handlers[--request->handler_count];
+    vlc_mutex_unlock( &request->lock );
+
+    if ( !cancelled && ( width != 0 || height != 0 ) )
+    {
+        if ( handler == NULL )
+            handler = image_HandlerCreate( thumbnailer->parent );
+        pic = handler ? thumbnailer_Scale( handler, pic, width, height )
+                      : NULL;
+    }
+
+    vlc_mutex_lock( &request->lock );
+    for ( size_t i = job->first; i < job->last; i++ )
+        if ( request->params.batch.cb )
+            request->params.batch.cb( request->params.user_data,
+                                      request->targets[i].index, pic );
+    if ( handler != NULL && request->handler_count < THUMBNAILER_MAX_SCALERS )
+    {
+        request->handlers[request->handler_count++] = handler;
+        handler = NULL;
+    }
+    vlc_mutex_unlock( &request->lock );
+
+    if ( handler != NULL )
+        image_HandlerDelete( handler );
+    if ( pic != NULL && pic != job->pic )
+        picture_Release( pic );
+
+    *out = job;
+    /* The job is already done */
+    background_worker_RequestProbe( thumbnailer->scaler );
+    return VLC_SUCCESS;
+}
+
+static int thumbnailer_job_Probe( void* owner, void* handle )
+{
+    VLC_UNUSED(owner); VLC_UNUSED(handle);
+    return 1;
+}
+
+static void thumbnailer_job_Stop( void* owner, void* handle )
+{
+    VLC_UNUSED(owner); VLC_UNUSED(handle);
+}
+
+/* Fail the targets not taken yet, with the request locked */
+static void thumbnailer_batch_Fail( vlc_thumbnailer_request_t* request )
+{
+    for ( ; request->next < request->params.batch.count; request->next++ )
+        if ( request->params.batch.cb )
+            request->params.batch.cb( request->params.user_data,
+                                      request->targets[request->next].index,
+                                      NULL );
+}
+
+static void
+on_thumbnailer_batch_event( vlc_thumbnailer_request_t* request,
+                            const struct vlc_input_event *event )
+{
+    vlc_thumbnailer_t *thumbnailer = request->thumbnailer;
+    struct thumbnailer_job *job = NULL;
+    bool seek = false;
+    vlc_tick_t time;
+    const size_t count = request->params.batch.count;
+
+    vlc_mutex_lock( &request->lock );
+    if ( request->next < count && event->type == INPUT_EVENT_THUMBNAIL_READY )
+    {
+        job = malloc( sizeof( *job ) );
+        if ( likely( job != NULL ) )
+        {
+            /* Targets at the same time share the thumbnail */
+            time = request->targets[request->next].time;
+            job->request = request;
+            job->pic = picture_Hold( event->thumbnail );
+            job->first = request->next;
+            while ( request->next < count &&
+                    request->targets[request->next].time == time )
+                request->next++;
+            job->last = request->next;
+            request->pending++;
+            if ( request->next < count )
+            {
+                time = request->targets[request->next].time;
+                seek = true;
+            }
+        }
+    }
+    /* Errors, end of stream, or no memory */
+    if ( job == NULL )
+        thumbnailer_batch_Fail( request );
+    vlc_mutex_unlock( &request->lock );
+
+    if ( job != NULL &&
+         background_worker_Push( thumbnailer->scaler, job, request,
+                                 -1 ) != VLC_SUCCESS )
+    {
+        thumbnailer_job_Release( job );
+        vlc_mutex_lock( &request->lock );
+        thumbnailer_batch_Fail( request );
+        seek = false;
+        vlc_mutex_unlock( &request->lock );
+    }
+
+    if ( seek )
+        input_SetTime( request->input_thread, time,
+                       request->params.fast_seek );
+    else if ( event->type == INPUT_EVENT_THUMBNAIL_READY )
+        input_Stop( request->input_thread );
+    background_worker_RequestProbe( thumbnailer->worker );
+}
+
 static void
 on_thumbnailer_input_event( input_thread_t *input,
                             const struct vlc_input_event *event, void *userdata )
@@ -81,6 +298,12 @@ on_thumbnailer_input_event( input_thread_t *input,
     vlc_thumbnailer_request_t* request = userdata;
     picture_t *pic = NULL;
 
+    if ( request->params.batch.count > 0 )
+    {
+        on_thumbnailer_batch_event( request, event );
+        return;
+    }
+
     if ( event->type == INPUT_EVENT_THUMBNAIL_READY )
     {
         /*
@@ -116,11 +339,27 @@ static void thumbnailer_request_Release( void* data )
     if ( request->input_thread )
         input_Close( request->input_thread );
 
+    for ( unsigned i = 0; i < request->handler_count; i++ )
+        image_HandlerDelete( request->handlers[i] );
+    free( request->targets );
     input_item_Release( request->params.input_item );
+    vlc_cond_destroy( &request->wait );
     vlc_mutex_destroy( &request->lock );
     free( request );
 }
 
+static void thumbnailer_request_Fail( vlc_thumbnailer_request_t* request )
+{
+    if ( request->params.batch.count > 0 )
+    {
+        vlc_mutex_lock( &request->lock );
+        thumbnailer_batch_Fail( request );
+        vlc_mutex_unlock( &request->lock );
+    }
+    else
+        request->params.cb( request->params.user_data, NULL );
+}
+
 static int thumbnailer_request_Start( void* owner, void* entity, void** out )
 {
     vlc_thumbnailer_t* thumbnailer = owner;
@@ -131,10 +370,15 @@ static int thumbnailer_request_Start( void* owner, void* entity, void** out )
                                      request->params.input_item );
     if ( unlikely( input == NULL ) )
     {
-        request->params.cb( request->params.user_data, NULL );
+        thumbnailer_request_Fail( request );
         return VLC_EGENERIC;
     }
-    if ( request->params.type == VLC_THUMBNAILER_SEEK_TIME )
+    if ( request->params.batch.count > 0 )
+    {
+        input_SetTime( input, request->targets[0].time,
+                       request->params.fast_seek );
+    }
+    else if ( request->params.type == VLC_THUMBNAILER_SEEK_TIME )
     {
         input_SetTime( input, request->params.time,
                        request->params.fast_seek );
@@ -147,7 +391,7 @@ static int thumbnailer_request_Start( void* owner, void* entity, void** out )
     }
     if ( input_Start( input ) != VLC_SUCCESS )
     {
-        request->params.cb( request->params.user_data, NULL );
+        thumbnailer_request_Fail( request );
         return VLC_EGENERIC;
     }
     *out = request;
@@ -169,6 +413,11 @@ static void thumbnailer_request_Stop( void* owner, void* handle )
         request->params.cb( request->params.user_data, NULL );
         request->params.cb = NULL;
     }
+    /* Same for the batch thumbnails not taken yet; those being scaled are
+     * still delivered */
+    thumbnailer_batch_Fail( request );
+    while ( request->pending > 0 )
+        vlc_cond_wait( &request->wait, &request->lock );
     vlc_mutex_unlock( &request->lock );
     assert( request->input_thread != NULL );
     input_Stop( request->input_thread );
@@ -179,11 +428,22 @@ static int thumbnailer_request_Probe( void* owner, void* handle )
     VLC_UNUSED(owner);
     vlc_thumbnailer_request_t *request = handle;
     vlc_mutex_lock( &request->lock );
-    int res = request->done;
+    int res = request->done ||
+        ( request->params.batch.count > 0 &&
+          request->next == request->params.batch.count &&
+          request->pending == 0 );
     vlc_mutex_unlock( &request->lock );
     return res;
 }
 
+static int thumbnailer_target_Compare( const void* a, const void* b )
+{
+    const struct thumbnailer_target *ta = a, *tb = b;
+    if ( ta->time != tb->time )
+        return ta->time < tb->time ? -1 : 1;
+    return ta->index < tb->index ? -1 : ta->index > tb->index;
+}
+
 static vlc_thumbnailer_request_t*
 thumbnailer_RequestCommon( vlc_thumbnailer_t* thumbnailer,
                            const vlc_thumbnailer_params_t* params )
@@ -195,8 +455,33 @@ thumbnailer_RequestCommon( vlc_thumbnailer_t* thumbnailer,
     request->input_thread = NULL;
     request->params = *(vlc_thumbnailer_params_t*)params;
     request->done = false;
+    request->targets = NULL;
+    request->next = 0;
+    request->pending = 0;
+    request->handler_count = 0;
+
+    const size_t count = params->batch.count;
+    if ( count > 0 )
+    {
+        request->targets = vlc_alloc( count, sizeof( *request->targets ) );
+        if ( unlikely( request->targets == NULL ) )
+        {
+            free( request );
+            return NULL;
+        }
+        for ( size_t i = 0; i < count; i++ )
+        {
+            request->targets[i].time = params->batch.times[i];
+            request->targets[i].index = i;
+        }
+        qsort( request->targets, count, sizeof( *request->targets ),
+               thumbnailer_target_Compare );
+        request->params.batch.times = NULL;
+    }
+
     input_item_Hold( request->params.input_item );
     vlc_mutex_init( &request->lock );
+    vlc_cond_init( &request->wait );
 
     int timeout = params->timeout == VLC_TICK_INVALID ?
                 0 : MS_FROM_VLC_TICK( params->timeout );
@@ -246,12 +531,40 @@ vlc_thumbnailer_RequestByPos( vlc_thumbnailer_t *thumbnailer,
         });
 }
 
+vlc_thumbnailer_request_t*
+vlc_thumbnailer_RequestBatch( vlc_thumbnailer_t *thumbnailer,
+                              const vlc_tick_t *times, size_t count,
+                              enum vlc_thumbnailer_seek_speed speed,
+                              unsigned width, unsigned height,
+                              input_item_t *input_item, vlc_tick_t timeout,
+                              vlc_thumbnailer_batch_cb cb, void* user_data )
+{
+    if ( count == 0 )
+        return NULL;
+    return thumbnailer_RequestCommon( thumbnailer,
+            &(const vlc_thumbnailer_params_t){
+                .type = VLC_THUMBNAILER_SEEK_TIME,
+                .fast_seek = speed == VLC_THUMBNAILER_SEEK_FAST,
+                .input_item = input_item,
+                .timeout = timeout,
+                .batch = {
+                    .times = times,
+                    .count = count,
+                    .width = width,
+                    .height = height,
+                    .cb = cb,
+                },
+                .user_data = user_data,
+        });
+}
+
 void vlc_thumbnailer_Cancel( vlc_thumbnailer_t* thumbnailer,
                              vlc_thumbnailer_request_t* req )
 {
     vlc_mutex_lock( &req->lock );
     /* Ensure we won't invoke the callback if the input was running. */
     req->params.cb = NULL;
+    req->params.batch.cb = NULL;
     vlc_mutex_unlock( &req->lock );
     background_worker_Cancel( thumbnailer->worker, req );
 }
@@ -277,11 +590,30 @@ vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t* parent)
         free( thumbnailer );
         return NULL;
     }
+    /* The scaling threads are only spawned by batch requests */
+    struct background_worker_config scaler_cfg = {
+        .default_timeout = -1,
+        .max_threads = __MIN( vlc_GetCPUCount(), THUMBNAILER_MAX_SCALERS ),
+        .pf_release = thumbnailer_job_Release,
+        .pf_hold = thumbnailer_job_Hold,
+        .pf_start = thumbnailer_job_Start,
+        .pf_probe = thumbnailer_job_Probe,
+        .pf_stop = thumbnailer_job_Stop,
+    };
+    thumbnailer->scaler = background_worker_New( thumbnailer, &scaler_cfg );
+    if ( unlikely( thumbnailer->scaler == NULL ) )
+    {
+        background_worker_Delete( thumbnailer->worker );
+        free( thumbnailer );
+        return NULL;
+    }
     return thumbnailer;
 }
 
 void vlc_thumbnailer_Release( vlc_thumbnailer_t *thumbnailer )
 {
+    /* The requests wait for their thumbnails being scaled */
     background_worker_Delete( thumbnailer->worker );
+    background_worker_Delete( thumbnailer->scaler );
     free( thumbnailer );
 }
@@ -529,6 +529,12 @@ static const char *const ppsz_pos_descriptions[] =
     "This defines the maximum input delay jitter that the synchronization " \
     "algorithms should try to compensate (in milliseconds)." )
 
+#define CLOCK_LOW_LATENCY_TEXT N_("Low latency live clock")
+#define CLOCK_LOW_LATENCY_LONGTEXT N_( \
+    "Measure the arrival jitter of real-time sources and play slightly " \
+    "faster until the buffering is reduced to what this jitter requires, " \
+    "instead of keeping the whole caching delay." )
+
 #define CLOCK_MASTER_TEXT N_("Clock master source")
 
 static const int pi_clock_master_values[] = {
@@ -671,6 +677,18 @@ static const char *const ppsz_prefres[] = {
 #define INPUT_FAST_SEEK_LONGTEXT N_( \
     "Favor speed over precision while seeking" )
 
+#define SEEK_INDEX_CACHE_TEXT N_("Cache seek indexes")
+#define SEEK_INDEX_CACHE_LONGTEXT N_( \
+    "Keep the seek index rebuilt by scanning files without a usable one " \
+    "(broken AVI, Matroska without cues, Ogg) in the cache directory, " \
+    "so that seeking is fast and accurate when they are opened again." )
+
+#define SCRUB_CACHE_TEXT N_("Scrubbing cache (MiB)")
+#define SCRUB_CACHE_LONGTEXT N_( \
+    "Keep this much of the recently decoded video pictures, so that " \
+    "seeking back and forth and stepping frames while paused do not decode " \
+    "again from the previous keyframe. 0 disables the cache." )
+
 #define INPUT_RATE_TEXT N_("Playback speed")
 #define INPUT_RATE_LONGTEXT N_( \
     "This defines the playback speed (nominal speed is 1.0)." )
@@ -1097,6 +1115,11 @@ static const char *const ppsz_prefres[] = {
 #define KEYSTORE_LONGTEXT N_( \
     "List of keystores that VLC will use in priority." )
 
+#define TRACER_TEXT N_("Pipeline tracer")
+#define TRACER_LONGTEXT N_( \
+    "Tracer module recording the latency of every playback pipeline " \
+    "stage. Tracing is disabled if none is selected." )
+
 #define STATS_TEXT N_("Locally collect statistics")
 #define STATS_LONGTEXT N_( \
      "Collect miscellaneous local statistics about the playing media.")
@@ -1821,6 +1844,11 @@ vlc_module_begin ()
     add_bool( "input-fast-seek", false,
               INPUT_FAST_SEEK_TEXT, INPUT_FAST_SEEK_LONGTEXT, false )
         change_safe ()
+    add_bool( "seek-index-cache", true,
+              SEEK_INDEX_CACHE_TEXT, SEEK_INDEX_CACHE_LONGTEXT, true )
+    add_integer( "scrub-cache", 0,
+                 SCRUB_CACHE_TEXT, SCRUB_CACHE_LONGTEXT, true )
+        change_integer_range( 0, 4096 )
     add_float( "rate", 1.,
                INPUT_RATE_TEXT, INPUT_RATE_LONGTEXT, false )
 
@@ -1967,6 +1995,9 @@ vlc_module_begin ()
     add_integer( "clock-jitter", 5000, CLOCK_JITTER_TEXT,
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
+    add_bool( "clock-low-latency", false, CLOCK_LOW_LATENCY_TEXT,
+              CLOCK_LOW_LATENCY_LONGTEXT, true )
+        change_safe()
     add_integer( "clock-master", VLC_CLOCK_MASTER_DEFAULT,
                  CLOCK_MASTER_TEXT, NULL, true )
         change_integer_list( pi_clock_master_values, ppsz_clock_master_descriptions )
@@ -2082,6 +2113,7 @@ vlc_module_begin ()
     add_category_hint(N_("Miscellaneous"), MISC_CAT_LONGTEXT)
     add_module("vod-server", "vod server", NULL,
                VOD_SERVER_TEXT, VOD_SERVER_LONGTEXT)
+    add_module("tracer", "tracer", NULL, TRACER_TEXT, TRACER_LONGTEXT)
 
     set_section( N_("Plugins" ), NULL )
 #ifdef HAVE_DYNAMIC_PLUGINS
@@ -98,6 +98,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->main_playlist = NULL;
     priv->p_vlm = NULL;
     priv->media_source_provider = NULL;
+    priv->tracer = NULL;
 
     vlc_ExitInit( &priv->exit );
 
@@ -223,6 +224,16 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
 
     vlc_CPU_dump( VLC_OBJECT(p_libvlc) );
 
+    psz_val = var_InheritString( p_libvlc, "tracer" );
+    if( psz_val != NULL )
+    {
+        priv->tracer = vlc_TracerCreate( VLC_OBJECT(p_libvlc), psz_val );
+        if( priv->tracer == NULL )
+            msg_Warn( p_libvlc, "tracer \"%s\" initialization failed",
+                      psz_val );
+        free( psz_val );
+    }
+
     if( var_InheritBool( p_libvlc, "media-library") )
     {
         priv->p_media_library = libvlc_MlCreate( p_libvlc );
@@ -424,6 +435,9 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
 
     libvlc_InternalActionsClean( p_libvlc );
 
+    if( priv->tracer != NULL )
+        vlc_TracerDestroy( priv->tracer );
+
     /* Save the configuration */
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
@@ -80,6 +80,12 @@ typedef struct vlc_logger vlc_logger_t;
 int vlc_LogPreinit(libvlc_int_t *) VLC_USED;
 void vlc_LogInit(libvlc_int_t *);
 
+/*
+ * Tracing
+ */
+struct vlc_tracer *vlc_TracerCreate(vlc_object_t *, const char *name);
+void vlc_TracerDestroy(struct vlc_tracer *);
+
 /*
  * LibVLC exit event handling
  */
@@ -189,6 +195,7 @@ typedef struct libvlc_priv_t
     vlc_actions_t *actions; ///< Hotkeys handler
     struct vlc_medialibrary_t *p_media_library; ///< Media library instance
     struct vlc_thumbnailer_t *p_thumbnailer; ///< Lazily instantiated media thumbnailer
+    struct vlc_tracer *tracer; ///< Pipeline tracer (or NULL)
 
     /* Exit callback */
     vlc_exit_t       exit;
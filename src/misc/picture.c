@@ -392,6 +392,61 @@ void picture_CopyPixels( picture_t *p_dst, const picture_t *p_src )
         p_dst->context = p_src->context->copy( p_src->context );
 }
 
+void picture_CopyArea( picture_t *p_dst, const picture_t *p_src,
+                       unsigned i_x, unsigned i_y,
+                       unsigned i_width, unsigned i_height )
+{
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( p_src->format.i_chroma );
+    if( unlikely(!p_dsc) || p_dsc->plane_count != (unsigned)p_src->i_planes )
+        return;
+
+    /* Align the area on whole chroma samples (and YUV 4:2:2 macropixels) */
+    unsigned i_align_w = 2;
+    unsigned i_align_h = 1;
+    for( unsigned i = 0; i < p_dsc->plane_count; i++ )
+    {
+        i_align_w = LCM( i_align_w, p_dsc->p[i].w.den );
+        i_align_h = LCM( i_align_h, p_dsc->p[i].h.den );
+    }
+
+    const unsigned i_x_end = i_x + i_width;
+    const unsigned i_y_end = i_y + i_height;
+    i_x -= i_x % i_align_w;
+    i_y -= i_y % i_align_h;
+
+    for( int i = 0; i < p_src->i_planes; i++ )
+    {
+        const plane_t *p_in  = &p_src->p[i];
+        plane_t       *p_out = &p_dst->p[i];
+        const vlc_rational_t w = p_dsc->p[i].w;
+        const vlc_rational_t h = p_dsc->p[i].h;
+
+        const unsigned i_pitch = __MIN( p_in->i_pitch, p_out->i_pitch );
+        const unsigned i_lines = __MIN( p_in->i_lines, p_out->i_lines );
+
+        unsigned i_left   = i_x * w.num / w.den * p_dsc->pixel_size;
+        unsigned i_right  = (i_x_end * w.num + w.den - 1) / w.den * p_dsc->pixel_size;
+        unsigned i_top    = i_y * h.num / h.den;
+        unsigned i_bottom = (i_y_end * h.num + h.den - 1) / h.den;
+
+        i_right  = __MIN( i_right, i_pitch );
+        i_bottom = __MIN( i_bottom, i_lines );
+        if( i_left >= i_right || i_top >= i_bottom )
+            continue;
+
+        const uint8_t *p_src_line = &p_in->p_pixels[i_top * p_in->i_pitch + i_left];
+        uint8_t *p_dst_line = &p_out->p_pixels[i_top * p_out->i_pitch + i_left];
+
+        for( unsigned i_line = i_top; i_line < i_bottom; i_line++ )
+        {
+            memcpy( p_dst_line, p_src_line, i_right - i_left );
+            p_src_line += p_in->i_pitch;
+            p_dst_line += p_out->i_pitch;
+        }
+    }
+}
+
 void picture_Copy( picture_t *p_dst, const picture_t *p_src )
 {
     picture_CopyPixels( p_dst, p_src );
@@ -34,6 +34,7 @@
 #include <float.h>
 #include <math.h>
 #include <limits.h>
+#include <stdatomic.h>
 
 #include <vlc_common.h>
 #include <vlc_arrays.h>
@@ -71,6 +72,8 @@ struct variable_t
 
     /** The variable's exported value */
     vlc_value_t  val;
+    /** Copy of the value for lock-less reads through handles (not strings) */
+    atomic_uint_least64_t shadow;
 
     /** The variable display name, mainly for use by the interfaces */
     char *       psz_text;
@@ -155,6 +158,22 @@ static variable_t *Lookup( vlc_object_t *obj, const char *psz_name )
     return (pp_var != NULL) ? *pp_var : NULL;
 }
 
+static_assert(sizeof (vlc_value_t) <= sizeof (uint_least64_t),
+              "vlc_value_t does not fit in the shadow value");
+
+/**
+ * Publishes the current value for var_HandleGet().
+ * Must be called with the variable lock held, whenever the value changes.
+ */
+static void Publish( variable_t *p_var )
+{
+    uint_least64_t raw = 0;
+
+    if( p_var->ops->pf_free == FreeDummy )
+        memcpy( &raw, &p_var->val, sizeof (p_var->val) );
+    atomic_store_explicit( &p_var->shadow, raw, memory_order_release );
+}
+
 static void Destroy( variable_t *p_var )
 {
     p_var->ops->pf_free( &p_var->val );
@@ -307,6 +326,7 @@ int (var_Create)( vlc_object_t *p_this, const char *psz_name, int i_type )
 
     p_var->b_incallback = false;
     p_var->value_callbacks = NULL;
+    atomic_init( &p_var->shadow, 0 );
 
     /* Always initialize the variable, even if it is a list variable; this
      * will lead to errors if the variable is not initialized, but it will
@@ -350,6 +370,7 @@ int (var_Create)( vlc_object_t *p_this, const char *psz_name, int i_type )
 
     if (i_type & VLC_VAR_DOINHERIT)
         var_Inherit(p_this, psz_name, i_type, &p_var->val);
+    Publish(p_var);
 
     vlc_object_internals_t *p_priv = vlc_internals( p_this );
     variable_t **pp_var, *p_oldvar;
@@ -376,6 +397,26 @@ int (var_Create)( vlc_object_t *p_this, const char *psz_name, int i_type )
     return ret;
 }
 
+/**
+ * Drops a reference to a variable, removing it from the object if it was the
+ * last one. Must be called with the variable lock held.
+ * \return the variable to destroy once unlocked, or NULL
+ */
+static variable_t *Unref( vlc_object_t *p_this, variable_t *p_var )
+{
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+
+    if( --p_var->i_usage == 0 )
+    {
+        assert(!p_var->b_incallback);
+        tdelete( p_var, &p_priv->var_root, varcmp );
+        return p_var;
+    }
+
+    assert(p_var->i_usage != -1u);
+    return NULL;
+}
+
 void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
 {
     variable_t *p_var;
@@ -388,16 +429,8 @@ void (var_Destroy)(vlc_object_t *p_this, const char *psz_name)
     if( p_var == NULL )
         msg_Dbg( p_this, "attempt to destroy nonexistent variable \"%s\"",
                  psz_name );
-    else if( --p_var->i_usage == 0 )
-    {
-        assert(!p_var->b_incallback);
-        tdelete( p_var, &p_priv->var_root, varcmp );
-    }
     else
-    {
-        assert(p_var->i_usage != -1u);
-        p_var = NULL;
-    }
+        p_var = Unref( p_this, p_var );
     vlc_mutex_unlock( &p_priv->var_lock );
 
     if( p_var != NULL )
@@ -454,6 +487,7 @@ int (var_Change)(vlc_object_t *p_this, const char *psz_name, int i_action, ...)
             assert(p_var->ops->pf_free == FreeDummy);
             p_var->step = va_arg(ap, vlc_value_t);
             CheckValue( p_var, &p_var->val );
+            Publish( p_var );
             break;
         case VLC_VAR_GETSTEP:
             switch (p_var->i_type & VLC_VAR_TYPE)
@@ -538,6 +572,7 @@ int (var_Change)(vlc_object_t *p_this, const char *psz_name, int i_action, ...)
             CheckValue( p_var, &newval );
             /* Set the variable */
             p_var->val = newval;
+            Publish( p_var );
             /* Free data if needed */
             p_var->ops->pf_free( &oldval );
             break;
@@ -640,6 +675,7 @@ int (var_GetAndSet)(vlc_object_t *p_this, const char *psz_name, int i_action,
 
     /*  Check boundaries */
     CheckValue( p_var, &p_var->val );
+    Publish( p_var );
     *p_val = p_var->val;
 
     /* Deal with callbacks.*/
@@ -670,23 +706,16 @@ int (var_Type)(vlc_object_t *p_this, const char *psz_name)
     return i_type;
 }
 
-int (var_SetChecked)(vlc_object_t *p_this, const char *psz_name,
-                     int expected_type, vlc_value_t val)
+/**
+ * Sets the value of a variable and triggers its callbacks.
+ * Must be called with the variable lock held.
+ */
+static void SetValue( vlc_object_t *p_this, variable_t *p_var,
+                      const char *psz_name, int expected_type,
+                      vlc_value_t val )
 {
-    variable_t *p_var;
     vlc_value_t oldval;
 
-    assert( p_this );
-
-    vlc_object_internals_t *p_priv = vlc_internals( p_this );
-
-    p_var = Lookup( p_this, psz_name );
-    if( p_var == NULL )
-    {
-        vlc_mutex_unlock( &p_priv->var_lock );
-        return VLC_ENOVAR;
-    }
-
     assert( expected_type == 0 ||
             (p_var->i_type & VLC_VAR_CLASS) == expected_type );
     assert ((p_var->i_type & VLC_VAR_CLASS) != VLC_VAR_VOID);
@@ -704,12 +733,32 @@ int (var_SetChecked)(vlc_object_t *p_this, const char *psz_name,
 
     /* Set the variable */
     p_var->val = val;
+    Publish( p_var );
 
     /* Deal with callbacks */
     TriggerCallback( p_this, p_var, psz_name, oldval );
 
     /* Free data if needed */
     p_var->ops->pf_free( &oldval );
+}
+
+int (var_SetChecked)(vlc_object_t *p_this, const char *psz_name,
+                     int expected_type, vlc_value_t val)
+{
+    variable_t *p_var;
+
+    assert( p_this );
+
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+
+    p_var = Lookup( p_this, psz_name );
+    if( p_var == NULL )
+    {
+        vlc_mutex_unlock( &p_priv->var_lock );
+        return VLC_ENOVAR;
+    }
+
+    SetValue( p_this, p_var, psz_name, expected_type, val );
 
     vlc_mutex_unlock( &p_priv->var_lock );
     return VLC_SUCCESS;
@@ -754,6 +803,52 @@ int (var_Get)(vlc_object_t *p_this, const char *psz_name, vlc_value_t *p_val)
     return var_GetChecked( p_this, psz_name, 0, p_val );
 }
 
+vlc_var_t *(var_Resolve)(vlc_object_t *p_this, const char *psz_name)
+{
+    assert( p_this );
+
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+    variable_t *p_var = Lookup( p_this, psz_name );
+
+    if( p_var != NULL )
+        p_var->i_usage++;
+    vlc_mutex_unlock( &p_priv->var_lock );
+    return p_var;
+}
+
+void (var_Release)(vlc_object_t *p_this, vlc_var_t *p_var)
+{
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+
+    vlc_mutex_lock( &p_priv->var_lock );
+    p_var = Unref( p_this, p_var );
+    vlc_mutex_unlock( &p_priv->var_lock );
+
+    if( p_var != NULL )
+        Destroy( p_var );
+}
+
+void (var_HandleSet)(vlc_object_t *p_this, vlc_var_t *p_var,
+                     int expected_type, vlc_value_t val)
+{
+    vlc_object_internals_t *p_priv = vlc_internals( p_this );
+
+    vlc_mutex_lock( &p_priv->var_lock );
+    SetValue( p_this, p_var, p_var->psz_name, expected_type, val );
+    vlc_mutex_unlock( &p_priv->var_lock );
+}
+
+vlc_value_t var_HandleGet(const vlc_var_t *p_var)
+{
+    uint_least64_t raw;
+    vlc_value_t val;
+
+    assert( p_var->ops->pf_free == FreeDummy );
+    raw = atomic_load_explicit( &p_var->shadow, memory_order_acquire );
+    memcpy( &val, &raw, sizeof (val) );
+    return val;
+}
+
 typedef enum
 {
     vlc_value_callback,
@@ -24,18 +24,34 @@
 # define LIBVLC_VOUT_STATISTIC_H
 # include <stdatomic.h>
 
-/* NOTE: Both statistics are atomic on their own, so one might be older than
- * the other one. Currently, only one of them is updated at a time, so this
- * is a non-issue. */
+/* NOTE: The statistics are atomic on their own, so one might be older than
+ * the other ones. A picture may then be accounted in the next reading, which
+ * does not matter to running totals. */
 typedef struct {
     atomic_uint displayed;
     atomic_uint lost;
+    atomic_uint late;
+    atomic_uint timed;
+    atomic_llong offset_sum;
+    atomic_llong offset_max;
 } vout_statistic_t;
 
+/* Frame pacing of the pictures displayed at their date */
+typedef struct {
+    unsigned   late;        /**< displayed past their deadline */
+    unsigned   timed;       /**< displayed with a measured offset */
+    vlc_tick_t offset_sum;  /**< of the absolute display offsets */
+    vlc_tick_t offset_max;
+} vout_pacing_t;
+
 static inline void vout_statistic_Init(vout_statistic_t *stat)
 {
     atomic_init(&stat->displayed, 0);
     atomic_init(&stat->lost, 0);
+    atomic_init(&stat->late, 0);
+    atomic_init(&stat->timed, 0);
+    atomic_init(&stat->offset_sum, 0);
+    atomic_init(&stat->offset_max, 0);
 }
 
 static inline void vout_statistic_Clean(vout_statistic_t *stat)
@@ -45,11 +61,20 @@ static inline void vout_statistic_Clean(vout_statistic_t *stat)
 
 static inline void vout_statistic_GetReset(vout_statistic_t *stat,
                                            unsigned *restrict displayed,
-                                           unsigned *restrict lost)
+                                           unsigned *restrict lost,
+                                           vout_pacing_t *restrict pacing)
 {
     *displayed = atomic_exchange_explicit(&stat->displayed, 0,
                                           memory_order_relaxed);
     *lost = atomic_exchange_explicit(&stat->lost, 0, memory_order_relaxed);
+    pacing->late = atomic_exchange_explicit(&stat->late, 0,
+                                            memory_order_relaxed);
+    pacing->timed = atomic_exchange_explicit(&stat->timed, 0,
+                                             memory_order_relaxed);
+    pacing->offset_sum = atomic_exchange_explicit(&stat->offset_sum, 0,
+                                                  memory_order_relaxed);
+    pacing->offset_max = atomic_exchange_explicit(&stat->offset_max, 0,
+                                                  memory_order_relaxed);
 }
 
 static inline void vout_statistic_AddDisplayed(vout_statistic_t *stat,
@@ -64,4 +89,23 @@ static inline void vout_statistic_AddLost(vout_statistic_t *stat, int lost)
     atomic_fetch_add_explicit(&stat->lost, lost, memory_order_relaxed);
 }
 
+static inline void vout_statistic_AddTimed(vout_statistic_t *stat,
+                                           vlc_tick_t offset, bool late)
+{
+    long long max = atomic_load_explicit(&stat->offset_max,
+                                         memory_order_relaxed);
+
+    atomic_fetch_add_explicit(&stat->timed, 1, memory_order_relaxed);
+    if (late)
+        atomic_fetch_add_explicit(&stat->late, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stat->offset_sum, offset,
+                              memory_order_relaxed);
+    /* The reader may reset the maximum concurrently */
+    while (offset > max
+        && !atomic_compare_exchange_weak_explicit(&stat->offset_max, &max,
+                                                  offset,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed));
+}
+
 #endif
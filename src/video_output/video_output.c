@@ -47,6 +47,7 @@
 #include <vlc_vout_osd.h>
 #include <vlc_image.h>
 #include <vlc_plugin.h>
+#include <vlc_tracer.h>
 
 #include <libvlc.h>
 #include "vout_internal.h"
@@ -210,9 +211,15 @@ static void vout_UpdateWindowSize(vout_thread_t *vout)
 
 /* */
 void vout_GetResetStatistic(vout_thread_t *vout, unsigned *restrict displayed,
-                            unsigned *restrict lost)
+                            unsigned *restrict lost,
+                            vout_pacing_t *restrict pacing)
 {
-    vout_statistic_GetReset( &vout->p->statistic, displayed, lost );
+    vout_statistic_GetReset( &vout->p->statistic, displayed, lost, pacing );
+}
+
+vlc_tick_t vout_GetRenderDelay(vout_thread_t *vout)
+{
+    return atomic_load_explicit(&vout->p->render_delay, memory_order_relaxed);
 }
 
 bool vout_IsEmpty(vout_thread_t *vout)
@@ -823,6 +830,60 @@ static void ThreadChangeFilters(vout_thread_t *vout,
 }
 
 
+/* Expected time between the start of the rendering of a picture and the
+ * end of its display */
+static vlc_tick_t ThreadExpectedRenderCost(vout_thread_sys_t *sys)
+{
+    return sys->chrono.filter.avg + sys->chrono.spu.avg
+         + sys->chrono.prepare.avg + sys->chrono.display.avg;
+}
+
+/* How early the rendering of a picture must start to be done by its display
+ * date, with a margin for the rendering cost variations */
+static vlc_tick_t ThreadRenderDelay(vout_thread_sys_t *sys)
+{
+    return vout_chrono_GetHigh(&sys->chrono.filter)
+         + vout_chrono_GetHigh(&sys->chrono.spu)
+         + vout_chrono_GetHigh(&sys->chrono.prepare)
+         + VOUT_MWAIT_TOLERANCE;
+}
+
+static void ThreadResetPacing(vout_thread_sys_t *sys)
+{
+    vout_chrono_Reset(&sys->chrono.filter);
+    vout_chrono_Reset(&sys->chrono.spu);
+    vout_chrono_Reset(&sys->chrono.prepare);
+    vout_chrono_Reset(&sys->chrono.display);
+    atomic_store_explicit(&sys->render_delay, ThreadRenderDelay(sys),
+                          memory_order_relaxed);
+
+    sys->pacing.displayed    = 0;
+    sys->pacing.late         = 0;
+    sys->pacing.dropped      = 0;
+    sys->pacing.lateness_sum = 0;
+    sys->pacing.lateness_max = 0;
+}
+
+static void ThreadPrintPacing(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    if (sys->pacing.displayed == 0)
+        return;
+
+    msg_Dbg(vout, "frame pacing: %u displayed, %u late, %u dropped, "
+            "display offset mean %"PRId64" us max %"PRId64" us",
+            sys->pacing.displayed, sys->pacing.late, sys->pacing.dropped,
+            US_FROM_VLC_TICK(sys->pacing.lateness_sum / sys->pacing.displayed),
+            US_FROM_VLC_TICK(sys->pacing.lateness_max));
+    msg_Dbg(vout, "rendering cost: filters %"PRId64" us, subpictures %"PRId64
+            " us, prepare %"PRId64" us, display %"PRId64" us",
+            US_FROM_VLC_TICK(sys->chrono.filter.avg),
+            US_FROM_VLC_TICK(sys->chrono.spu.avg),
+            US_FROM_VLC_TICK(sys->chrono.prepare.avg),
+            US_FROM_VLC_TICK(sys->chrono.display.avg));
+}
+
 /* */
 static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool frame_by_frame)
 {
@@ -847,7 +908,9 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
                     const vlc_tick_t system_pts =
                         vlc_clock_ConvertToSystem(vout->p->clock, date,
                                                   decoded->date, sys->rate);
-                    const vlc_tick_t late = date - system_pts;
+                    /* Late by the time it would be displayed */
+                    const vlc_tick_t late = date + ThreadExpectedRenderCost(sys)
+                                          - system_pts;
                     vlc_tick_t late_threshold;
                     if (decoded->format.i_frame_rate && decoded->format.i_frame_rate_base)
                         late_threshold = VLC_TICK_FROM_MS(500) * decoded->format.i_frame_rate_base / decoded->format.i_frame_rate;
@@ -857,6 +920,7 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
                         msg_Warn(vout, "picture is too late to be displayed (missing %"PRId64" ms)", MS_FROM_VLC_TICK(late));
                         picture_Release(decoded);
                         vout_statistic_AddLost(&vout->p->statistic, 1);
+                        sys->pacing.dropped++;
                         continue;
                     } else if (late > 0) {
                         msg_Dbg(vout, "picture might be displayed late (missing %"PRId64" ms)", MS_FROM_VLC_TICK(late));
@@ -886,6 +950,10 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
     if (!picture)
         return VLC_EGENERIC;
 
+    if (sys->tracer != NULL)
+        vlc_tracer_TraceStreamPTS(sys->tracer, "VOUT", sys->es_id, "FILTER",
+                                  picture->date);
+
     assert(!vout->p->displayed.next);
     if (!vout->p->displayed.current)
         vout->p->displayed.current = picture;
@@ -949,6 +1017,90 @@ static picture_t *ConvertRGB32AndBlend(vout_thread_t *vout, picture_t *pic,
     return NULL;
 }
 
+/* Whether the picture is only referenced by the video output thread, and can
+ * thus be modified, as long as it is restored before its next use */
+static bool ThreadOwnsPicture(vout_thread_sys_t *sys, picture_t *pic)
+{
+    uintptr_t refs = 1;
+
+    if (pic == sys->displayed.current)
+        refs++;
+    if (pic == sys->displayed.decoded)
+        refs++;
+    return atomic_load_explicit(&pic->refs, memory_order_acquire) == refs;
+}
+
+static void ThreadCopySubpictureAreas(picture_t *dst, const picture_t *src,
+                                      const video_format_t *fmt,
+                                      const subpicture_t *subpic)
+{
+    for (const subpicture_region_t *r = subpic->p_region; r != NULL;
+         r = r->p_next)
+    {
+        /* The blender ignores regions with negative offsets */
+        if (r->i_x < 0 || r->i_y < 0)
+            continue;
+        picture_CopyArea(dst, src, fmt->i_x_offset + r->i_x,
+                         fmt->i_y_offset + r->i_y,
+                         r->fmt.i_visible_width, r->fmt.i_visible_height);
+    }
+}
+
+/* Blends the subpicture directly onto the picture, when no one else can see
+ * it, saving the pixels under the regions instead of copying the whole
+ * picture. ThreadRestoreUnderlay() must be called once it is displayed. */
+static bool ThreadBlendInPlace(vout_thread_sys_t *sys, picture_t *pic,
+                               subpicture_t *subpic)
+{
+    const video_format_t *fmt = &sys->spu_blend->fmt_out.video;
+    picture_t *save = sys->spu_underlay.save;
+
+    assert(sys->spu_underlay.picture == NULL);
+
+    if (pic->i_planes == 0 || pic->context != NULL
+     || !ThreadOwnsPicture(sys, pic))
+        return false;
+
+    if (save != NULL
+     && (save->format.i_chroma != pic->format.i_chroma
+      || save->format.i_width  != pic->format.i_width
+      || save->format.i_height != pic->format.i_height))
+    {
+        picture_Release(save);
+        save = NULL;
+    }
+    if (save == NULL)
+    {
+        save = picture_NewFromFormat(&pic->format);
+        sys->spu_underlay.save = save;
+        if (save == NULL)
+            return false;
+    }
+
+    ThreadCopySubpictureAreas(save, pic, fmt, subpic);
+    picture_BlendSubpicture(pic, sys->spu_blend, subpic);
+
+    sys->spu_underlay.picture = picture_Hold(pic);
+    sys->spu_underlay.subpic = subpic;
+    return true;
+}
+
+static void ThreadRestoreUnderlay(vout_thread_sys_t *sys)
+{
+    picture_t *pic = sys->spu_underlay.picture;
+    subpicture_t *subpic = sys->spu_underlay.subpic;
+
+    if (pic == NULL)
+        return;
+
+    ThreadCopySubpictureAreas(pic, sys->spu_underlay.save,
+                              &sys->spu_blend->fmt_out.video, subpic);
+    picture_Release(pic);
+    subpicture_Delete(subpic);
+    sys->spu_underlay.picture = NULL;
+    sys->spu_underlay.subpic = NULL;
+}
+
 static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 {
     vout_thread_sys_t *sys = vout->p;
@@ -956,18 +1108,22 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 
     picture_t *torender = picture_Hold(sys->displayed.current);
 
-    vout_chrono_Start(&sys->render);
+    vout_chrono_Start(&sys->chrono.filter);
 
     vlc_mutex_lock(&sys->filter.lock);
     picture_t *filtered = filter_chain_VideoFilter(sys->filter.chain_interactive, torender);
     vlc_mutex_unlock(&sys->filter.lock);
 
+    vout_chrono_Stop(&sys->chrono.filter);
+
     if (!filtered)
         return VLC_EGENERIC;
 
     if (filtered->date != sys->displayed.current->date)
         msg_Warn(vout, "Unsupported timestamp modifications done by chain_interactive");
 
+    vout_chrono_Start(&sys->chrono.spu);
+
     /*
      * Get the subpicture to be displayed
      */
@@ -1053,7 +1209,11 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     picture_t *todisplay = filtered;
     picture_t *snap_pic = todisplay;
     if (do_early_spu && subpic) {
-        if (sys->spu_blend) {
+        if (sys->spu_blend && !do_snapshot
+         && ThreadBlendInPlace(sys, filtered, subpic)) {
+            /* Restored once displayed */
+            subpic = NULL;
+        } else if (sys->spu_blend) {
             picture_t *blent = picture_pool_Get(sys->private_pool);
             if (blent) {
                 video_format_CopyCropAr(&blent->format, &filtered->format);
@@ -1076,7 +1236,8 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
                 }
             }
         }
-        subpicture_Delete(subpic);
+        if (subpic != NULL)
+            subpicture_Delete(subpic);
         subpic = NULL;
     }
 
@@ -1091,10 +1252,15 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
             picture_Release(snap_pic);
     }
 
+    vout_chrono_Stop(&sys->chrono.spu);
+    vout_chrono_Start(&sys->chrono.prepare);
+
     /* Render the direct buffer */
     vout_UpdateDisplaySourceProperties(vd, &todisplay->format);
 
     todisplay = vout_ConvertForDisplay(vd, todisplay);
+    if (todisplay != sys->spu_underlay.picture)
+        ThreadRestoreUnderlay(sys);
     if (todisplay == NULL) {
         if (subpic != NULL)
             subpicture_Delete(subpic);
@@ -1111,32 +1277,52 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
 
     if (vd->prepare != NULL)
         vd->prepare(vd, todisplay, do_dr_spu ? subpic : NULL, system_pts);
+    if (sys->tracer != NULL)
+        vlc_tracer_TraceStreamPTS(sys->tracer, "VOUT", sys->es_id, "PREPARE",
+                                  pts);
 
-    vout_chrono_Stop(&sys->render);
-#if 0
-        {
-        static int i = 0;
-        if (((i++)%10) == 0)
-            msg_Info(vout, "render: avg %d ms var %d ms",
-                     (int)(sys->render.avg/1000), (int)(sys->render.var/1000));
-        }
-#endif
+    vout_chrono_Stop(&sys->chrono.prepare);
+    atomic_store_explicit(&sys->render_delay, ThreadRenderDelay(sys),
+                          memory_order_relaxed);
 
     if (!is_forced)
     {
+        /* Start displaying early enough for the picture to be shown on time,
+         * when the display itself takes time (e.g. buffer swap) */
+        const vlc_tick_t display_delay = vout_chrono_GetLow(&sys->chrono.display);
+
         system_now = vlc_tick_now();
-        vlc_clock_Wait(sys->clock, system_now, pts, sys->rate,
-                       VOUT_REDISPLAY_DELAY);
+        vlc_clock_Wait(sys->clock, system_now,
+                       pts - (vlc_tick_t)(display_delay * sys->rate),
+                       sys->rate, VOUT_REDISPLAY_DELAY);
     }
 
     /* Display the direct buffer returned by vout_RenderPicture */
+    vout_chrono_Start(&sys->chrono.display);
     vout_display_Display(vd, todisplay);
+    vout_chrono_Stop(&sys->chrono.display);
+    ThreadRestoreUnderlay(sys);
+    if (sys->tracer != NULL)
+        vlc_tracer_TraceStreamPTS(sys->tracer, "VOUT", sys->es_id, "DISPLAY",
+                                  pts);
     if (subpic)
         subpicture_Delete(subpic);
 
     if (!is_forced)
     {
         system_now = vlc_tick_now();
+
+        const vlc_tick_t offset = system_now - system_pts;
+        const vlc_tick_t lateness = offset < 0 ? -offset : offset;
+        sys->pacing.displayed++;
+        sys->pacing.lateness_sum += lateness;
+        if (lateness > sys->pacing.lateness_max)
+            sys->pacing.lateness_max = lateness;
+        if (offset > VOUT_DISPLAY_LATE_THRESHOLD)
+            sys->pacing.late++;
+        vout_statistic_AddTimed(&sys->statistic, lateness,
+                                offset > VOUT_DISPLAY_LATE_THRESHOLD);
+
         const vlc_tick_t drift = vlc_clock_Update(sys->clock, system_now,
                                                   pts, sys->rate);
         if (drift != VLC_TICK_INVALID)
@@ -1167,7 +1353,7 @@ static int ThreadDisplayPicture(vout_thread_t *vout, vlc_tick_t *deadline)
             ;
 
     const vlc_tick_t system_now = vlc_tick_now();
-    const vlc_tick_t render_delay = vout_chrono_GetHigh(&sys->render) + VOUT_MWAIT_TOLERANCE;
+    const vlc_tick_t render_delay = ThreadRenderDelay(sys);
 
     bool drop_next_frame = frame_by_frame;
     vlc_tick_t date_next = VLC_TICK_INVALID;
@@ -1311,6 +1497,14 @@ void vout_NextPicture(vout_thread_t *vout, vlc_tick_t *duration)
     vout_control_Release(&vout->p->control);
 }
 
+vlc_tick_t vout_GetDisplayedTimestamp(vout_thread_t *vout)
+{
+    vout_control_Hold(&vout->p->control);
+    vlc_tick_t timestamp = vout->p->displayed.timestamp;
+    vout_control_Release(&vout->p->control);
+    return timestamp;
+}
+
 void vout_ChangeDelay(vout_thread_t *vout, vlc_tick_t delay)
 {
     vout_thread_sys_t *sys = vout->p;
@@ -1373,17 +1567,18 @@ static void ThreadProcessMouseState(vout_thread_t *vout,
     vlc_mutex_unlock(&vout->p->filter.lock);
 
     if (vlc_mouse_HasMoved(&vout->p->mouse, m))
-        var_SetCoords(vout, "mouse-moved", m->i_x, m->i_y);
+        var_HandleSetCoords(vout, vout->p->mouse_var.moved, m->i_x, m->i_y);
 
     if (vlc_mouse_HasButton(&vout->p->mouse, m)) {
-        var_SetInteger(vout, "mouse-button-down", m->i_pressed);
+        var_HandleSetInteger(vout, vout->p->mouse_var.button_down,
+                             m->i_pressed);
 
         if (vlc_mouse_HasPressed(&vout->p->mouse, m, MOUSE_BUTTON_LEFT)) {
             /* FIXME? */
             int x, y;
 
-            var_GetCoords(vout, "mouse-moved", &x, &y);
-            var_SetCoords(vout, "mouse-clicked", x, y);
+            var_HandleGetCoords(vout->p->mouse_var.moved, &x, &y);
+            var_HandleSetCoords(vout, vout->p->mouse_var.clicked, x, y);
         }
     }
 
@@ -1404,6 +1599,8 @@ static int vout_Start(vout_thread_t *vout, const vout_configuration_t *cfg)
     vlc_mouse_Init(&sys->mouse);
 
     sys->dpb_size = cfg->dpb_size;
+    sys->tracer = vlc_object_get_tracer(vout);
+    sys->es_id = cfg->es_id;
     sys->decoder_fifo = picture_fifo_New();
     sys->decoder_pool = NULL;
     sys->display_pool = NULL;
@@ -1480,6 +1677,8 @@ static int vout_Start(vout_thread_t *vout, const vout_configuration_t *cfg)
 
     assert(sys->decoder_pool != NULL && sys->private_pool != NULL);
 
+    ThreadResetPacing(sys);
+
     sys->displayed.current       = NULL;
     sys->displayed.next          = NULL;
     sys->displayed.decoded       = NULL;
@@ -1495,6 +1694,9 @@ static int vout_Start(vout_thread_t *vout, const vout_configuration_t *cfg)
 
     sys->spu_blend_chroma        = 0;
     sys->spu_blend               = NULL;
+    sys->spu_underlay.picture    = NULL;
+    sys->spu_underlay.subpic     = NULL;
+    sys->spu_underlay.save       = NULL;
 
     video_format_Print(VLC_OBJECT(vout), "original format", &sys->original);
     return VLC_SUCCESS;
@@ -1516,6 +1718,8 @@ static void ThreadStop(vout_thread_t *vout)
 {
     if (vout->p->spu_blend)
         filter_DeleteBlend(vout->p->spu_blend);
+    if (vout->p->spu_underlay.save)
+        picture_Release(vout->p->spu_underlay.save);
 
     /* Destroy translation tables */
     if (vout->p->display) {
@@ -1653,6 +1857,7 @@ static void vout_StopDisplay(vout_thread_t *vout)
     assert(sys->original.i_chroma != 0);
     vout_control_PushVoid(&sys->control, VOUT_CONTROL_CLEAN);
     vlc_join(sys->thread, NULL);
+    ThreadPrintPacing(vout);
 
     spu_Detach(sys->spu);
     sys->mouse_event = NULL;
@@ -1686,7 +1891,10 @@ void vout_Close(vout_thread_t *vout)
     vout_IntfDeinit(VLC_OBJECT(vout));
     vout_snapshot_End(sys->snapshot);
     vout_control_Dead(&sys->control);
-    vout_chrono_Clean(&sys->render);
+    vout_chrono_Clean(&sys->chrono.filter);
+    vout_chrono_Clean(&sys->chrono.spu);
+    vout_chrono_Clean(&sys->chrono.prepare);
+    vout_chrono_Clean(&sys->chrono.display);
 
     vlc_mutex_destroy(&sys->window_lock);
     vout_display_window_Delete(sys->display_cfg.window);
@@ -1699,6 +1907,18 @@ void vout_Close(vout_thread_t *vout)
     vout_Release(vout);
 }
 
+static void VoutReleaseMouseVars(vout_thread_t *vout)
+{
+    vout_thread_sys_t *sys = vout->p;
+
+    if (sys->mouse_var.moved != NULL)
+        var_Release(vout, sys->mouse_var.moved);
+    if (sys->mouse_var.button_down != NULL)
+        var_Release(vout, sys->mouse_var.button_down);
+    if (sys->mouse_var.clicked != NULL)
+        var_Release(vout, sys->mouse_var.clicked);
+}
+
 void vout_Release(vout_thread_t *vout)
 {
     vout_thread_sys_t *sys = vout->p;
@@ -1707,6 +1927,7 @@ void vout_Release(vout_thread_t *vout)
         return;
 
     free(vout->p->splitter_name);
+    VoutReleaseMouseVars(vout);
 
     /* Destroy the locks */
     vlc_mutex_destroy(&vout->p->window_lock);
@@ -1745,6 +1966,18 @@ vout_thread_t *vout_Create(vlc_object_t *object)
 
     vout->p = sys;
 
+    /* They are set for every mouse event */
+    sys->mouse_var.moved       = var_Resolve(vout, "mouse-moved");
+    sys->mouse_var.button_down = var_Resolve(vout, "mouse-button-down");
+    sys->mouse_var.clicked     = var_Resolve(vout, "mouse-clicked");
+    if (unlikely(sys->mouse_var.moved == NULL
+              || sys->mouse_var.button_down == NULL
+              || sys->mouse_var.clicked == NULL)) {
+        VoutReleaseMouseVars(vout);
+        vlc_object_delete(vout);
+        return NULL;
+    }
+
     /* Get splitter name if present */
     sys->splitter_name = config_GetType("video-splitter") ?
         var_InheritString(vout, "video-splitter") : NULL;
@@ -1783,14 +2016,19 @@ vout_thread_t *vout_Create(vlc_object_t *object)
     sys->window_active = false;
     vlc_mutex_init(&sys->window_lock);
 
-    /* Arbitrary initial time */
-    vout_chrono_Init(&sys->render, 5, VLC_TICK_FROM_MS(10));
+    /* Arbitrary initial times */
+    vout_chrono_Init(&sys->chrono.filter, 5, VLC_TICK_FROM_MS(2));
+    vout_chrono_Init(&sys->chrono.spu, 5, VLC_TICK_FROM_MS(2));
+    vout_chrono_Init(&sys->chrono.prepare, 5, VLC_TICK_FROM_MS(6));
+    vout_chrono_Init(&sys->chrono.display, 5, VLC_TICK_FROM_MS(1));
+    atomic_init(&sys->render_delay, ThreadRenderDelay(sys));
 
     /* */
     atomic_init(&sys->refs, 0);
 
     if (sys->display_cfg.window == NULL) {
         spu_Destroy(sys->spu);
+        VoutReleaseMouseVars(vout);
         vlc_object_delete(vout);
         return NULL;
     }
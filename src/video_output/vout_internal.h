@@ -52,6 +52,7 @@ typedef struct {
     unsigned             dpb_size;
     vlc_mouse_event      mouse_event;
     void                 *mouse_opaque;
+    int                  es_id; /* traced elementary stream */
 } vout_configuration_t;
 #include "control.h"
 
@@ -104,6 +105,10 @@ struct vout_thread_sys_t
     } source;
     unsigned        dpb_size;
 
+    /* Pipeline tracing */
+    struct vlc_tracer *tracer;
+    int             es_id;
+
     /* Snapshot interface */
     struct vout_snapshot *snapshot;
 
@@ -116,6 +121,13 @@ struct vout_thread_sys_t
     vlc_fourcc_t    spu_blend_chroma;
     filter_t        *spu_blend;
 
+    /* Picture blended in place and pixels under its subpicture regions */
+    struct {
+        picture_t    *picture;
+        subpicture_t *subpic;
+        picture_t    *save;
+    } spu_underlay;
+
     /* Thread & synchronization */
     vlc_thread_t    thread;
     vout_control_t  control;
@@ -168,6 +180,11 @@ struct vout_thread_sys_t
     vlc_mouse_t     mouse;
     vlc_mouse_event mouse_event;
     void            *mouse_opaque;
+    struct {
+        vlc_var_t   *moved;
+        vlc_var_t   *button_down;
+        vlc_var_t   *clicked;
+    } mouse_var;
 
     /* Video output window */
     bool            window_active;
@@ -182,7 +199,24 @@ struct vout_thread_sys_t
     picture_pool_t  *display_pool;
     picture_pool_t  *decoder_pool;
     picture_fifo_t  *decoder_fifo;
-    vout_chrono_t   render;           /**< picture render time estimator */
+
+    /* Picture rendering cost estimators, per stage */
+    struct {
+        vout_chrono_t filter;         /**< interactive filters */
+        vout_chrono_t spu;            /**< subpictures rendering and blending */
+        vout_chrono_t prepare;        /**< conversion and display preparation */
+        vout_chrono_t display;        /**< picture display */
+    } chrono;
+    atomic_llong    render_delay;     /**< render start to display delay */
+
+    /* Frame pacing statistics, since the display was started */
+    struct {
+        unsigned   displayed;
+        unsigned   late;              /**< displayed past their deadline */
+        unsigned   dropped;           /**< dropped as they could not be in time */
+        vlc_tick_t lateness_sum;      /**< of the absolute display offsets */
+        vlc_tick_t lateness_max;
+    } pacing;
 
     atomic_uintptr_t refs;
 };
@@ -306,7 +340,15 @@ void spu_OffsetSubtitleDate( spu_t *p_spu, vlc_tick_t i_duration );
  * This function will return and reset internal statistics.
  */
 void vout_GetResetStatistic( vout_thread_t *p_vout, unsigned *pi_displayed,
-                             unsigned *pi_lost );
+                             unsigned *pi_lost, vout_pacing_t *p_pacing );
+
+/**
+ * Returns the time the video output needs to render and display a picture.
+ *
+ * Decoders must output pictures at least this long before their display date
+ * for them to be displayed on time.
+ */
+vlc_tick_t vout_GetRenderDelay( vout_thread_t *p_vout );
 
 /*
  * Cancel the vout, if cancel is true, it won't return any pictures after this
@@ -319,6 +361,12 @@ void vout_Cancel( vout_thread_t *p_vout, bool b_canceled );
  */
 void vout_NextPicture( vout_thread_t *p_vout, vlc_tick_t *pi_duration );
 
+/**
+ * This function returns the date of the picture being displayed, or
+ * VLC_TICK_INVALID
+ */
+vlc_tick_t vout_GetDisplayedTimestamp( vout_thread_t *p_vout );
+
 /**
  * This function will ask the display of the input title
  */
@@ -78,6 +78,8 @@ struct spu_private_t {
 
     int channel;             /**< number of subpicture channels registered */
     filter_t *text;                              /**< text renderer module */
+    vlc_var_t *text_elapsed;                /**< text renderer "spu-elapsed" */
+    vlc_var_t *text_rerender;             /**< text renderer "text-rerender" */
     filter_t *scale_yuvp;                     /**< scaling module for YUVP */
     filter_t *scale;                    /**< scaling module (all but YUVP) */
     bool force_crop;                     /**< force cropping of subpicture */
@@ -199,6 +201,22 @@ static int spu_get_attachments(filter_t *filter,
     return VLC_EGENERIC;
 }
 
+static void SpuRenderReleaseText(spu_t *spu)
+{
+    spu_private_t *sys = spu->p;
+
+    if (!sys->text)
+        return;
+
+    if (sys->text_elapsed)
+        var_Release(sys->text, sys->text_elapsed);
+    if (sys->text_rerender)
+        var_Release(sys->text, sys->text_rerender);
+    FilterRelease(sys->text);
+    sys->text = NULL;
+    sys->text_elapsed = sys->text_rerender = NULL;
+}
+
 static filter_t *SpuRenderCreateAndLoadText(spu_t *spu)
 {
     filter_t *text = vlc_custom_create(spu, sizeof(*text), "spu text");
@@ -223,6 +241,10 @@ static filter_t *SpuRenderCreateAndLoadText(spu_t *spu)
     var_Create(text, "spu-elapsed",   VLC_VAR_INTEGER);
     var_Create(text, "text-rerender", VLC_VAR_BOOL);
 
+    /* They are set for every rendered region */
+    spu->p->text_elapsed  = var_Resolve(text, "spu-elapsed");
+    spu->p->text_rerender = var_Resolve(text, "text-rerender");
+
     return text;
 }
 
@@ -265,12 +287,15 @@ static void SpuRenderText(spu_t *spu, bool *rerender_text,
                           const vlc_fourcc_t *chroma_list,
                           vlc_tick_t elapsed_time)
 {
-    filter_t *text = spu->p->text;
+    spu_private_t *sys = spu->p;
+    filter_t *text = sys->text;
 
     assert(region->fmt.i_chroma == VLC_CODEC_TEXT);
 
     if (!text || !text->p_module)
         return;
+    if (unlikely(!sys->text_elapsed || !sys->text_rerender))
+        return;
 
     /* Setup 3 variables which can be used to render
      * time-dependent text (and effects). The first indicates
@@ -291,12 +316,12 @@ static void SpuRenderText(spu_t *spu, bool *rerender_text,
      * least show up on screen, but the effect won't change
      * the text over time.
      */
-    var_SetInteger(text, "spu-elapsed", elapsed_time);
-    var_SetBool(text, "text-rerender", false);
+    var_HandleSetInteger(text, sys->text_elapsed, elapsed_time);
+    var_HandleSetBool(text, sys->text_rerender, false);
 
     if ( region->p_text )
         text->pf_render(text, region, region, chroma_list);
-    *rerender_text = var_GetBool(text, "text-rerender");
+    *rerender_text = var_HandleGetBool(sys->text_rerender);
 }
 
 /**
@@ -1382,6 +1407,7 @@ spu_t *spu_Create(vlc_object_t *object, vout_thread_t *vout)
 
     sys->clock = NULL;
     sys->text = NULL;
+    sys->text_elapsed = sys->text_rerender = NULL;
     sys->scale = NULL;
     sys->scale_yuvp = NULL;
 
@@ -1426,8 +1452,7 @@ void spu_Destroy(spu_t *spu)
 {
     spu_private_t *sys = spu->p;
 
-    if (sys->text)
-        FilterRelease(sys->text);
+    SpuRenderReleaseText(spu);
 
     if (sys->scale_yuvp)
         FilterRelease(sys->scale_yuvp);
@@ -1470,8 +1495,7 @@ void spu_Attach(spu_t *spu, input_thread_t *input)
 
         spu->p->input = input;
 
-        if (spu->p->text)
-            FilterRelease(spu->p->text);
+        SpuRenderReleaseText(spu);
         spu->p->text = SpuRenderCreateAndLoadText(spu);
     }
     vlc_mutex_unlock(&spu->p->lock);
@@ -0,0 +1,471 @@
+/*****************************************************************************
+ * biquad.c: test the biquad filter sections
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#define MODULE_STRING "biquad"
+#include "../../../modules/audio_filter/biquad.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include <float.h>
+
+#include <vlc_tick.h>
+
+#define RATE 48000
+#define EQZ_IN_FACTOR 0.25f
+#define BANDS 10
+
+static const struct
+{
+    const char *name;
+    biquad_kernel_t kernel;
+    bool double_precision;
+} kernels[] = {
+    { "C", KernelFloatC, false },
+    { "C double", KernelDoubleC, true },
+#if defined(HAVE_SSE2_INTRINSICS)
+    { "SSE", KernelFloatSSE, false },
+    { "SSE2 double", KernelDoubleSSE2, true },
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    { "AVX", KernelFloatAVX, false },
+    { "AVX double", KernelDoubleAVX, true },
+#endif
+#if defined(__ARM_NEON)
+    { "NEON", KernelFloatNEON, false },
+#endif
+};
+
+static bool KernelSupported(biquad_kernel_t kernel)
+{
+#if defined(HAVE_SSE2_INTRINSICS)
+    if (kernel == KernelFloatSSE)
+        return vlc_CPU_SSE();
+    if (kernel == KernelDoubleSSE2)
+        return vlc_CPU_SSE2();
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (kernel == KernelFloatAVX || kernel == KernelDoubleAVX)
+        return vlc_CPU_AVX();
+#endif
+#if defined(__ARM_NEON)
+    if (kernel == KernelFloatNEON)
+        return vlc_CPU_ARM_NEON();
+#endif
+    return true;
+}
+
+/* Peaking sections, as in the parametric equalizer */
+static void PeakCoeffs(float f0, float Q, float gainDB, float *coeffs)
+{
+    const float A = powf(10, gainDB / 40);
+    const float w0 = 2 * (float)M_PI * f0 / RATE;
+    const float alpha = sinf(w0) / (2 * Q);
+    const float a0 = 1 + alpha / A;
+
+    coeffs[0] = (1 + alpha * A) / a0;
+    coeffs[1] = -2 * cosf(w0) / a0;
+    coeffs[2] = (1 - alpha * A) / a0;
+    coeffs[3] = -2 * cosf(w0) / a0;
+    coeffs[4] = (1 - alpha / A) / a0;
+}
+
+/* Band-pass sections, as in the equalizer: alpha, beta, gamma */
+static void BandCoeffs(float freq, float *coeffs)
+{
+    const float octave = powf(2.0f, 0.5f);
+    const float theta_1 = (2.0f * (float)M_PI * freq) / RATE;
+    const float theta_2 = theta_1 / octave;
+    const float sin_ = sinf(theta_2);
+    const float sin_prd = sinf(theta_2 * 0.5f * (octave + 1.0f))
+                        * sinf(theta_2 * 0.5f * (octave - 1.0f));
+    const float sin_hlf = sin_ * 0.5f;
+    const float den = sin_hlf + sin_prd;
+
+    coeffs[0] = sin_prd / den;
+    coeffs[1] = (sin_hlf - sin_prd) / den;
+    coeffs[2] = sin_ * cosf(theta_1) / den;
+}
+
+/* The former scalar cascade of the parametric equalizer, and the same in
+ * double precision as a reference */
+#define REF_CASCADE(name, type) \
+static void name(const float *src, float *dest, type *state, \
+                 unsigned channels, unsigned samples, const float *coeffs, \
+                 unsigned eqCount) \
+{ \
+    for (unsigned i = 0; i < samples; i++) \
+    { \
+        type *state1 = state; \
+        for (unsigned chn = 0; chn < channels; chn++) \
+        { \
+            const float *coeffs1 = coeffs; \
+            type x = *src++, y = 0; \
+            for (unsigned eq = 0; eq < eqCount; eq++) \
+            { \
+                y = x * coeffs1[0] + state1[0] * coeffs1[1] \
+                  + state1[1] * coeffs1[2] - state1[2] * coeffs1[3] \
+                  - state1[3] * coeffs1[4]; \
+                coeffs1 += 5; \
+                state1[1] = state1[0]; \
+                state1[0] = x; \
+                state1[3] = state1[2]; \
+                state1[2] = y; \
+                x = y; \
+                state1 += 4; \
+            } \
+            *dest++ = y; \
+        } \
+    } \
+}
+
+REF_CASCADE(RefCascade, float)
+REF_CASCADE(RefCascadeDouble, double)
+
+/* The former scalar filter of the equalizer, in one or two passes */
+#define REF_BANK(name, type) \
+struct name##_state \
+{ \
+    type x[2][32][2]; \
+    type y[2][32][BANDS][2]; \
+}; \
+\
+static void name(struct name##_state *st, const float *in, float *out, \
+                 unsigned channels, unsigned samples, const float *coeffs, \
+                 const float *amp, float gamp, bool two_pass) \
+{ \
+    for (unsigned i = 0; i < samples; i++) \
+    { \
+        for (unsigned ch = 0; ch < channels; ch++) \
+        { \
+            type x = in[ch], o = 0.f; \
+\
+            for (unsigned p = 0; p < (two_pass ? 2 : 1); p++) \
+            { \
+                if (p > 0) \
+                { \
+                    x = EQZ_IN_FACTOR * x + o; \
+                    o = 0.f; \
+                } \
+                for (unsigned j = 0; j < BANDS; j++) \
+                { \
+                    const float *c = coeffs + 3 * j; \
+                    type y = c[0] * (x - st->x[p][ch][1]) \
+                           + c[2] * st->y[p][ch][j][0] \
+                           - c[1] * st->y[p][ch][j][1]; \
+                    st->y[p][ch][j][1] = st->y[p][ch][j][0]; \
+                    st->y[p][ch][j][0] = y; \
+                    o += y * amp[j]; \
+                } \
+                st->x[p][ch][1] = st->x[p][ch][0]; \
+                st->x[p][ch][0] = x; \
+            } \
+            out[ch] = (two_pass ? gamp * gamp : gamp) \
+                    * (EQZ_IN_FACTOR * x + o); \
+        } \
+        in += channels; \
+        out += channels; \
+    } \
+}
+
+REF_BANK(RefBank, float)
+REF_BANK(RefBankDouble, double)
+
+static void FillNoise(float *buf, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        buf[i] = rand() / (float)RAND_MAX - .5f;
+}
+
+static double SNR(const float *ref, const float *out, size_t count)
+{
+    double signal = 0., noise = 0.;
+    for (size_t i = 0; i < count; i++)
+    {
+        signal += (double)ref[i] * ref[i];
+        noise += ((double)out[i] - ref[i]) * ((double)out[i] - ref[i]);
+    }
+    return 10. * log10(signal / (noise + DBL_MIN));
+}
+
+static audio_biquad_t *NewCascade(unsigned channels, size_t k,
+                                  const float *coeffs, unsigned sections)
+{
+    audio_biquad_t *bq = audio_biquad_New(channels, sections, false,
+                                          kernels[k].double_precision);
+    assert(bq != NULL);
+    bq->kernel = kernels[k].kernel;
+    for (unsigned s = 0; s < sections; s++)
+    {
+        const double c[5] = {
+            coeffs[5 * s], coeffs[5 * s + 1], coeffs[5 * s + 2],
+            coeffs[5 * s + 3], coeffs[5 * s + 4],
+        };
+        audio_biquad_SetSection(bq, s, c, 1.);
+    }
+    return bq;
+}
+
+static void SetBank(audio_biquad_t *bq, const float *coeffs,
+                    const float *amp, float gain)
+{
+    for (unsigned j = 0; j < BANDS; j++)
+    {
+        const float *c = coeffs + 3 * j;
+        const double ab[5] = { c[0], 0., -c[0], -c[2], c[1] };
+        audio_biquad_SetSection(bq, j, ab, gain * amp[j]);
+    }
+    audio_biquad_SetDirect(bq, gain * EQZ_IN_FACTOR);
+}
+
+/* Checks that the cascade matches the parametric equalizer response */
+static void test_cascade(unsigned channels, unsigned frames)
+{
+    float coeffs[5 * 5];
+    PeakCoeffs(300.f, 3.f, 6.f, coeffs);
+    PeakCoeffs(1000.f, 1.f, -12.f, coeffs + 5);
+    PeakCoeffs(3000.f, 10.f, 9.f, coeffs + 10);
+    PeakCoeffs(100.f, .7f, 4.f, coeffs + 15);
+    PeakCoeffs(10000.f, .7f, -3.f, coeffs + 20);
+
+    float *in = vlc_alloc(frames * channels, sizeof (float));
+    float *ref = vlc_alloc(frames * channels, sizeof (float));
+    float *out = vlc_alloc(frames * channels, sizeof (float));
+    float *truth = vlc_alloc(frames * channels, sizeof (float));
+    float *state = calloc(channels * 5 * 4, sizeof (float));
+    double *state_double = calloc(channels * 5 * 4, sizeof (double));
+    assert(in != NULL && ref != NULL && out != NULL && truth != NULL
+        && state != NULL && state_double != NULL);
+
+    FillNoise(in, frames * channels);
+    RefCascade(in, ref, state, channels, frames, coeffs, 5);
+    RefCascadeDouble(in, truth, state_double, channels, frames, coeffs, 5);
+    const double ref_snr = SNR(truth, ref, frames * channels);
+
+    for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+    {
+        if (!KernelSupported(kernels[k].kernel))
+            continue;
+
+        audio_biquad_t *bq = NewCascade(channels, k, coeffs, 5);
+        /* In uneven calls, the last one in place */
+        memcpy(out, in, frames * channels * sizeof (float));
+        unsigned first = frames / 3;
+        audio_biquad_Process(bq, in, out, first);
+        audio_biquad_Process(bq, out + first * channels,
+                             out + first * channels, frames - first);
+
+        const double snr = SNR(truth, out, frames * channels);
+        printf("cascade, %u channels, %s: %.1f dB SNR (former %.1f dB)\n",
+               channels, kernels[k].name, snr, ref_snr);
+        assert(snr > ref_snr - 6.);
+        if (kernels[k].double_precision)
+            assert(snr > 120.);
+        audio_biquad_Delete(bq);
+    }
+
+    free(state_double);
+    free(state);
+    free(truth);
+    free(out);
+    free(ref);
+    free(in);
+}
+
+/* Checks that the bank matches the equalizer response */
+static void test_bank(unsigned channels, unsigned frames, bool two_pass)
+{
+    static const float freqs[BANDS] = {
+        60, 170, 310, 600, 1000, 3000, 6000, 12000, 14000, 16000,
+    };
+    float coeffs[3 * BANDS], amp[BANDS];
+    const float gamp = .7f;
+    for (unsigned j = 0; j < BANDS; j++)
+    {
+        BandCoeffs(freqs[j], coeffs + 3 * j);
+        amp[j] = EQZ_IN_FACTOR * (powf(10.f, (j * 4.f - 18.f) / 20.f) - 1.f);
+    }
+
+    float *in = vlc_alloc(frames * channels, sizeof (float));
+    float *ref = vlc_alloc(frames * channels, sizeof (float));
+    float *out = vlc_alloc(frames * channels, sizeof (float));
+    float *truth = vlc_alloc(frames * channels, sizeof (float));
+    struct RefBank_state *st = calloc(1, sizeof (*st));
+    struct RefBankDouble_state *st_double = calloc(1, sizeof (*st_double));
+    assert(in != NULL && ref != NULL && out != NULL && truth != NULL
+        && st != NULL && st_double != NULL);
+
+    FillNoise(in, frames * channels);
+    RefBank(st, in, ref, channels, frames, coeffs, amp, gamp, two_pass);
+    RefBankDouble(st_double, in, truth, channels, frames, coeffs, amp, gamp,
+                  two_pass);
+    const double ref_snr = SNR(truth, ref, frames * channels);
+
+    for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+    {
+        if (!KernelSupported(kernels[k].kernel))
+            continue;
+
+        audio_biquad_t *bank[2];
+        for (unsigned p = 0; p < 2; p++)
+        {
+            bank[p] = audio_biquad_New(channels, BANDS, true,
+                                       kernels[k].double_precision);
+            assert(bank[p] != NULL);
+            bank[p]->kernel = kernels[k].kernel;
+        }
+        if (two_pass)
+        {
+            SetBank(bank[0], coeffs, amp, 1.f);
+            SetBank(bank[1], coeffs, amp, gamp * gamp);
+            audio_biquad_Process(bank[0], in, out, frames);
+            audio_biquad_Process(bank[1], out, out, frames);
+        }
+        else
+        {
+            SetBank(bank[0], coeffs, amp, gamp);
+            audio_biquad_Process(bank[0], in, out, frames);
+        }
+
+        const double snr = SNR(truth, out, frames * channels);
+        printf("bank, %u channels, %u pass, %s: %.1f dB SNR (former %.1f dB)"
+               "\n", channels, two_pass ? 2 : 1, kernels[k].name, snr,
+               ref_snr);
+        assert(snr > ref_snr - 6.);
+        if (kernels[k].double_precision)
+            assert(snr > 120.);
+        audio_biquad_Delete(bank[0]);
+        audio_biquad_Delete(bank[1]);
+    }
+
+    free(st_double);
+    free(st);
+    free(truth);
+    free(out);
+    free(ref);
+    free(in);
+}
+
+/* Checks that the state decays to zero rather than to denormal numbers */
+static void test_denormals(void)
+{
+    float coeffs[5];
+    PeakCoeffs(20.f, 10.f, 12.f, coeffs);
+
+    for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+    {
+        if (!KernelSupported(kernels[k].kernel))
+            continue;
+
+        audio_biquad_t *bq = NewCascade(2, k, coeffs, 1);
+        float buf[2 * 1024] = { 1.f, 1.f };
+        audio_biquad_Process(bq, buf, buf, 1024);
+
+        for (unsigned i = 0; i < 10000; i++)
+        {
+            memset(buf, 0, sizeof (buf));
+            audio_biquad_Process(bq, buf, buf, 1024);
+        }
+        for (unsigned i = 0; i < ARRAY_SIZE(buf); i++)
+            assert(buf[i] == 0.f);
+        audio_biquad_Delete(bq);
+    }
+}
+
+static void bench(unsigned seconds)
+{
+    enum { FRAMES = 1024, CHANNELS = 8 };
+    static float in[FRAMES * CHANNELS], out[FRAMES * CHANNELS];
+    const unsigned count = seconds * RATE / FRAMES;
+    float coeffs[3 * BANDS], amp[BANDS];
+
+    FillNoise(in, ARRAY_SIZE(in));
+    for (unsigned j = 0; j < BANDS; j++)
+    {
+        BandCoeffs(60.f * (j + 1), coeffs + 3 * j);
+        amp[j] = .1f;
+    }
+
+    /* The 10 bands equalizer in two passes, on 7.1 */
+    struct RefBank_state *st = calloc(1, sizeof (*st));
+    assert(st != NULL);
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned n = 0; n < count; n++)
+        RefBank(st, in, out, CHANNELS, FRAMES, coeffs, amp, 1.f, true);
+    vlc_tick_t time = vlc_tick_now() - start;
+    printf("equalizer, 10 bands, 2 pass, 7.1: former %.0fx real time\n",
+           seconds / secf_from_vlc_tick(time));
+    free(st);
+
+    for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+    {
+        if (!KernelSupported(kernels[k].kernel))
+            continue;
+
+        audio_biquad_t *bank[2];
+        for (unsigned p = 0; p < 2; p++)
+        {
+            bank[p] = audio_biquad_New(CHANNELS, BANDS, true,
+                                       kernels[k].double_precision);
+            assert(bank[p] != NULL);
+            bank[p]->kernel = kernels[k].kernel;
+            SetBank(bank[p], coeffs, amp, 1.f);
+        }
+        start = vlc_tick_now();
+        for (unsigned n = 0; n < count; n++)
+        {
+            audio_biquad_Process(bank[0], in, out, FRAMES);
+            audio_biquad_Process(bank[1], out, out, FRAMES);
+        }
+        time = vlc_tick_now() - start;
+        printf("equalizer, 10 bands, 2 pass, 7.1: %s %.0fx real time\n",
+               kernels[k].name, seconds / secf_from_vlc_tick(time));
+        audio_biquad_Delete(bank[0]);
+        audio_biquad_Delete(bank[1]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        bench(argc > 2 ? atoi(argv[2]) : 10);
+    else
+    {
+        static const unsigned layouts[] = { 1, 2, 3, 6, 8, 9 };
+        for (size_t i = 0; i < ARRAY_SIZE(layouts); i++)
+        {
+            test_cascade(layouts[i], 5000);
+            test_bank(layouts[i], 5000, false);
+            test_bank(layouts[i], 5000, true);
+        }
+        test_denormals();
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
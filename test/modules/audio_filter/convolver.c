@@ -0,0 +1,293 @@
+/*****************************************************************************
+ * convolver.c: test the partitioned convolution
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#define MODULE_STRING "convolver"
+#include "../../../modules/audio_filter/convolver.c"
+#include "../../../modules/audio_filter/fft.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include <unistd.h>
+#include <float.h>
+
+#include <vlc_tick.h>
+
+static float Random(void)
+{
+    return rand() / (float)RAND_MAX - .5f;
+}
+
+/* Checks the convolution against the direct form, fed in random chunks */
+static void test_convolve(unsigned inputs, unsigned outputs, unsigned block,
+                          unsigned length)
+{
+    const unsigned frames = 4 * length + 3 * block + 17;
+
+    audio_convolver_t *conv = audio_convolver_New(inputs, outputs, block,
+                                                  length);
+    assert(conv != NULL);
+    assert(audio_convolver_Latency(conv) == block);
+
+    float *ir = vlc_alloc((size_t)inputs * outputs * length, sizeof (float));
+    float *in = vlc_alloc((size_t)frames * inputs, sizeof (float));
+    float *out = vlc_alloc((size_t)frames * outputs, sizeof (float));
+    assert(ir != NULL && in != NULL && out != NULL);
+
+    for (unsigned i = 0; i < inputs; i++)
+        for (unsigned o = 0; o < outputs; o++)
+        {
+            float *h = ir + ((size_t)i * outputs + o) * length;
+            /* Leave some pairs silent, and some responses short */
+            const unsigned len = ((i + o) % 3 == 2) ? 0
+                               : ((i + o) % 3 == 1) ? length / 3 + 1 : length;
+            for (unsigned n = 0; n < length; n++)
+                h[n] = (n < len) ? Random() * expf(-4.f * n / length) : 0.f;
+            audio_convolver_SetResponse(conv, i, o, h, length);
+        }
+    for (size_t n = 0; n < (size_t)frames * inputs; n++)
+        in[n] = Random();
+
+    for (unsigned pos = 0; pos < frames;)
+    {
+        const unsigned chunk = 1 + rand() % (3 * block);
+        const unsigned count = __MIN(frames - pos, chunk);
+        audio_convolver_Process(conv, in + pos * inputs, out + pos * outputs,
+                                count);
+        pos += count;
+    }
+
+    double signal = 0., noise = 0.;
+    for (unsigned n = 0; n < frames; n++)
+        for (unsigned o = 0; o < outputs; o++)
+        {
+            double ref = 0.;
+            if (n >= block)
+                for (unsigned i = 0; i < inputs; i++)
+                {
+                    const float *h = ir + ((size_t)i * outputs + o) * length;
+                    for (unsigned k = 0; k < length && k <= n - block; k++)
+                        ref += h[k] * in[(n - block - k) * inputs + i];
+                }
+            const double err = out[n * outputs + o] - ref;
+            signal += ref * ref;
+            noise += err * err;
+        }
+
+    const double snr = 10. * log10(signal / (noise + DBL_MIN));
+    printf("%u -> %u channels, %u frames blocks, %u frames responses: "
+           "%.1f dB SNR\n", inputs, outputs, block, length, snr);
+    assert(snr > 100.);
+
+    /* After a reset, only silence comes out of silence */
+    audio_convolver_Reset(conv);
+    memset(in, 0, (size_t)frames * inputs * sizeof (float));
+    audio_convolver_Process(conv, in, out, frames);
+    for (size_t n = 0; n < (size_t)frames * outputs; n++)
+        assert(out[n] == 0.f);
+
+    free(out);
+    free(in);
+    free(ir);
+    audio_convolver_Delete(conv);
+}
+
+static void WriteWAV(FILE *file, const void *data, unsigned size,
+                     unsigned tag, unsigned channels, unsigned rate,
+                     unsigned bits)
+{
+    uint8_t hdr[44];
+    const unsigned align = channels * bits / 8;
+
+    memcpy(hdr, "RIFF", 4);
+    SetDWLE(hdr + 4, 36 + size);
+    memcpy(hdr + 8, "WAVEfmt ", 8);
+    SetDWLE(hdr + 16, 16);
+    SetWLE(hdr + 20, tag);
+    SetWLE(hdr + 22, channels);
+    SetDWLE(hdr + 24, rate);
+    SetDWLE(hdr + 28, rate * align);
+    SetWLE(hdr + 32, align);
+    SetWLE(hdr + 34, bits);
+    memcpy(hdr + 36, "data", 4);
+    SetDWLE(hdr + 40, size);
+
+    assert(fwrite(hdr, 1, sizeof (hdr), file) == sizeof (hdr));
+    assert(fwrite(data, 1, size, file) == size);
+}
+
+/* Checks the loading of impulse responses, resampled or not */
+static void test_wav(vlc_object_t *obj)
+{
+    char path[] = "/tmp/vlc-test-convolver-XXXXXX";
+    int fd = vlc_mkstemp(path);
+    assert(fd != -1);
+    FILE *file = fdopen(fd, "wb");
+    assert(file != NULL);
+
+    /* A smooth pulse per channel, in 16-bits samples */
+    enum { CHANNELS = 2, FRAMES = 200 };
+    int16_t pcm[FRAMES * CHANNELS];
+    double sum[CHANNELS] = { 0., 0. };
+    for (unsigned n = 0; n < FRAMES; n++)
+        for (unsigned c = 0; c < CHANNELS; c++)
+        {
+            const double x = (n - 50. - 20. * c) / 8.;
+            pcm[n * CHANNELS + c] = lrint(16384. * exp(-x * x));
+            SetWLE(&pcm[n * CHANNELS + c], pcm[n * CHANNELS + c]);
+            sum[c] += (int16_t)GetWLE(&pcm[n * CHANNELS + c]) / 32768.;
+        }
+    WriteWAV(file, pcm, sizeof (pcm), 1, CHANNELS, 24000, 16);
+    fclose(file);
+
+    unsigned channels, frames;
+    float *ir = audio_convolver_LoadWAV(obj, path, 24000, &channels, &frames);
+    assert(ir != NULL);
+    assert(channels == CHANNELS && frames == FRAMES);
+    for (unsigned n = 0; n < FRAMES * CHANNELS; n++)
+        assert(ir[n] == (int16_t)GetWLE(&pcm[n]) / 32768.f);
+    free(ir);
+
+    /* The frequency response stays the same at other rates */
+    static const unsigned rates[] = { 48000, 16000 };
+    for (size_t i = 0; i < ARRAY_SIZE(rates); i++)
+    {
+        ir = audio_convolver_LoadWAV(obj, path, rates[i], &channels, &frames);
+        assert(ir != NULL);
+        assert(channels == CHANNELS);
+        assert(frames == (FRAMES * rates[i] + 23999) / 24000);
+        for (unsigned c = 0; c < CHANNELS; c++)
+        {
+            double resampled = 0.;
+            for (unsigned n = 0; n < frames; n++)
+                resampled += ir[n * CHANNELS + c];
+            assert(fabs(resampled - sum[c]) < 1e-3 * sum[c]);
+        }
+        free(ir);
+    }
+
+    /* Float samples */
+    file = vlc_fopen(path, "wb");
+    assert(file != NULL);
+    uint32_t fl32[4];
+    static const float values[4] = { 1.f, -.5f, .25f, 0.f };
+    for (unsigned n = 0; n < 4; n++)
+    {
+        union { float f; uint32_t u; } u = { .f = values[n] };
+        SetDWLE(&fl32[n], u.u);
+    }
+    WriteWAV(file, fl32, sizeof (fl32), 3, 1, 48000, 32);
+    fclose(file);
+
+    ir = audio_convolver_LoadWAV(obj, path, 48000, &channels, &frames);
+    assert(ir != NULL);
+    assert(channels == 1 && frames == 4);
+    assert(!memcmp(ir, values, sizeof (values)));
+    free(ir);
+
+    /* Not a WAV file */
+    file = vlc_fopen(path, "wb");
+    assert(file != NULL);
+    fputs("This is not a WAV file at all.", file);
+    fclose(file);
+    assert(audio_convolver_LoadWAV(obj, path, 48000, &channels,
+                                   &frames) == NULL);
+
+    unlink(path);
+    assert(audio_convolver_LoadWAV(obj, path, 48000, &channels,
+                                   &frames) == NULL);
+}
+
+static void bench(unsigned seconds)
+{
+    static const unsigned lengths[] = { 512, 4096, 65536 };
+    static const struct
+    {
+        const char *name;
+        unsigned channels;
+    } layouts[] = {
+        { "stereo", 2 }, { "5.1", 6 }, { "7.1", 8 },
+    };
+    const unsigned rate = 48000, frames = 1024;
+
+    for (size_t i = 0; i < ARRAY_SIZE(lengths); i++)
+        for (size_t j = 0; j < ARRAY_SIZE(layouts); j++)
+        {
+            const unsigned inputs = layouts[j].channels;
+            audio_convolver_t *conv = audio_convolver_New(inputs, 2, 256,
+                                                          lengths[i]);
+            float *ir = vlc_alloc(lengths[i], sizeof (float));
+            float *in = vlc_alloc(frames * inputs, sizeof (float));
+            float *out = vlc_alloc(frames * 2, sizeof (float));
+            assert(conv != NULL && ir != NULL && in != NULL && out != NULL);
+
+            for (unsigned n = 0; n < lengths[i]; n++)
+                ir[n] = Random();
+            for (unsigned c = 0; c < inputs; c++)
+                for (unsigned e = 0; e < 2; e++)
+                    audio_convolver_SetResponse(conv, c, e, ir, lengths[i]);
+            for (unsigned n = 0; n < frames * inputs; n++)
+                in[n] = Random();
+
+            const unsigned count = seconds * rate / frames;
+            vlc_tick_t start = vlc_tick_now();
+            for (unsigned n = 0; n < count; n++)
+                audio_convolver_Process(conv, in, out, frames);
+            const vlc_tick_t time = vlc_tick_now() - start;
+
+            printf("%u frames responses, %s to binaural: %.0fx real time\n",
+                   lengths[i], layouts[j].name,
+                   (double)count * frames / rate / secf_from_vlc_tick(time));
+
+            free(out);
+            free(in);
+            free(ir);
+            audio_convolver_Delete(conv);
+        }
+}
+
+int main(int argc, char **argv)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        bench(argc > 2 ? atoi(argv[2]) : 10);
+    else
+    {
+        test_convolve(1, 1, 2, 1);
+        test_convolve(1, 1, 16, 16);
+        test_convolve(1, 2, 16, 100);
+        test_convolve(2, 2, 64, 1000);
+        test_convolve(3, 2, 32, 257);
+        test_convolve(6, 2, 256, 2048);
+        test_convolve(8, 3, 128, 1500);
+
+        test_wav(VLC_OBJECT(vlc->p_libvlc_int));
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,288 @@
+/*****************************************************************************
+ * polyphase.c: test the polyphase resampler
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#define MODULE_NAME polyphase_resampler
+#define MODULE_STRING "polyphase_resampler"
+#include "../../../modules/audio_filter/resampler/polyphase.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include <vlc_tick.h>
+
+#include <float.h>
+
+#define BLOCK_FRAMES 1024
+
+static filter_t *CreateFilter(libvlc_int_t *libvlc, unsigned rate_in,
+                              unsigned rate_out, uint16_t channels)
+{
+    filter_t *filter = vlc_object_create(libvlc, sizeof (*filter));
+    assert(filter != NULL);
+
+    es_format_Init(&filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_in.audio.i_rate = rate_in;
+    filter->fmt_in.audio.i_physical_channels = channels;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+    es_format_Copy(&filter->fmt_out, &filter->fmt_in);
+    filter->fmt_out.audio.i_rate = rate_out;
+
+    int ret = OpenResampler(VLC_OBJECT(filter));
+    assert(ret == VLC_SUCCESS);
+    return filter;
+}
+
+static void DeleteFilter(filter_t *filter)
+{
+    Close(VLC_OBJECT(filter));
+    vlc_object_delete(filter);
+}
+
+/* Resamples a sine, in blocks of random input rates around the nominal
+ * rate if jitter is not zero, and returns the signal to noise ratio */
+static double Sine(libvlc_int_t *libvlc, unsigned rate_in, unsigned rate_out,
+                   uint16_t channels, double freq, unsigned jitter)
+{
+    filter_t *filter = CreateFilter(libvlc, rate_in, rate_out, channels);
+    const unsigned nb_channels = filter->fmt_in.audio.i_channels;
+    const unsigned half = ((filter_sys_t *)filter->p_sys)->taps / 2;
+    const double omega = 2. * M_PI * freq / rate_in;
+    double pos = 0., signal = 0., noise = 0.;
+    unsigned frame = 0, out_frames = 0;
+    vlc_tick_t pts = VLC_TICK_0;
+
+    for (unsigned i = 0; i < 100; i++)
+    {
+        block_t *in = block_Alloc(BLOCK_FRAMES * nb_channels * sizeof (float));
+        assert(in != NULL);
+        float *samples = (float *)in->p_buffer;
+        for (unsigned j = 0; j < BLOCK_FRAMES; j++, frame++)
+            for (unsigned c = 0; c < nb_channels; c++)
+                samples[j * nb_channels + c] = sin(omega * frame + c);
+        in->i_nb_samples = BLOCK_FRAMES;
+        in->i_pts = pts;
+        pts += vlc_tick_from_samples(BLOCK_FRAMES, rate_in);
+
+        /* Like aout_FiltersPlay() with drift compensation */
+        const unsigned rate = rate_in + (jitter ? rand() % (2 * jitter + 1)
+                                                  - jitter : 0);
+        filter->fmt_in.audio.i_rate = rate;
+        block_t *out = filter->pf_audio_filter(filter, in);
+        filter->fmt_in.audio.i_rate = rate_in;
+        if (out == NULL)
+            continue;
+
+        const float *res = (const float *)out->p_buffer;
+        for (unsigned j = 0; j < out->i_nb_samples; j++, out_frames++)
+        {
+            /* Skip the edges of the input, where the filter sees silence */
+            if (pos > half && pos + half < 99 * BLOCK_FRAMES)
+                for (unsigned c = 0; c < nb_channels; c++)
+                {
+                    const double ref = sin(omega * pos + c);
+                    const double err = res[j * nb_channels + c] - ref;
+                    signal += ref * ref;
+                    noise += err * err;
+                }
+            pos += rate / (double)rate_out;
+        }
+        block_Release(out);
+    }
+
+    block_t *out = filter->pf_audio_drain(filter);
+    if (out != NULL)
+    {
+        out_frames += out->i_nb_samples;
+        block_Release(out);
+    }
+    if (!jitter)
+    {
+        /* All the input is resampled */
+        const double expected = frame * (double)rate_out / rate_in;
+        assert(fabs(out_frames - expected) < 2.);
+    }
+
+    DeleteFilter(filter);
+    assert(signal > 0.);
+    return 10. * log10(signal / (noise > 0. ? noise : DBL_MIN));
+}
+
+/* Checks that a sine above the output Nyquist frequency is rejected */
+static void test_aliasing(libvlc_int_t *libvlc, unsigned rate_in,
+                          unsigned rate_out, double freq)
+{
+    filter_t *filter = CreateFilter(libvlc, rate_in, rate_out,
+                                    AOUT_CHAN_CENTER);
+    const double omega = 2. * M_PI * freq / rate_in;
+    double power = 0.;
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < 50; i++)
+    {
+        block_t *in = block_Alloc(BLOCK_FRAMES * sizeof (float));
+        assert(in != NULL);
+        float *samples = (float *)in->p_buffer;
+        for (unsigned j = 0; j < BLOCK_FRAMES; j++)
+            samples[j] = sin(omega * (i * BLOCK_FRAMES + j));
+        in->i_nb_samples = BLOCK_FRAMES;
+        in->i_pts = VLC_TICK_0
+                  + vlc_tick_from_samples(i * BLOCK_FRAMES, rate_in);
+
+        block_t *out = filter->pf_audio_filter(filter, in);
+        if (out == NULL)
+            continue;
+        const float *res = (const float *)out->p_buffer;
+        /* Skip the onset */
+        for (unsigned j = 0; j < out->i_nb_samples; j++)
+            if (i > 0)
+            {
+                power += res[j] * res[j];
+                count++;
+            }
+        block_Release(out);
+    }
+    DeleteFilter(filter);
+
+    const double db = 10. * log10(2. * power / count + DBL_MIN);
+    printf("%u Hz -> %u Hz: %g Hz at %.1f dB\n", rate_in, rate_out, freq, db);
+    assert(db < -80.);
+}
+
+static void test_sine(libvlc_int_t *libvlc, unsigned rate_in,
+                      unsigned rate_out, uint16_t channels, double freq,
+                      unsigned jitter, double min_snr)
+{
+    const double snr = Sine(libvlc, rate_in, rate_out, channels, freq, jitter);
+    printf("%u Hz -> %u Hz (+/- %u Hz): %g Hz at %.1f dB SNR\n",
+           rate_in, rate_out, jitter, freq, snr);
+    assert(snr >= min_snr);
+}
+
+/* Checks that the input passes through while the rates match */
+static void test_passthrough(libvlc_int_t *libvlc)
+{
+    filter_t *filter = CreateFilter(libvlc, 48000, 48000, AOUT_CHANS_STEREO);
+
+    block_t *in = block_Alloc(BLOCK_FRAMES * 2 * sizeof (float));
+    assert(in != NULL);
+    memset(in->p_buffer, 0, in->i_buffer);
+    in->i_nb_samples = BLOCK_FRAMES;
+    in->i_pts = VLC_TICK_0;
+    assert(filter->pf_audio_filter(filter, in) == in);
+    block_Release(in);
+    assert(filter->pf_audio_drain(filter) == NULL);
+
+    DeleteFilter(filter);
+}
+
+static void bench(libvlc_int_t *libvlc, unsigned iterations)
+{
+    static const struct
+    {
+        unsigned in, out;
+    } rates[] = {
+        { 44100, 48000 }, { 48000, 44100 }, { 96000, 48000 }, { 48000, 48001 },
+    };
+    static const struct
+    {
+        const char *name;
+        uint16_t channels;
+    } layouts[] = {
+        { "mono", AOUT_CHAN_CENTER },
+        { "stereo", AOUT_CHANS_STEREO },
+        { "5.1", AOUT_CHANS_5_1 },
+        { "7.1", AOUT_CHANS_7_1 },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(rates); i++)
+        for (size_t j = 0; j < ARRAY_SIZE(layouts); j++)
+        {
+            filter_t *filter = CreateFilter(libvlc, rates[i].in, rates[i].out,
+                                            layouts[j].channels);
+            filter_sys_t *p_sys = filter->p_sys;
+            const polyphase_kernel_t kernels[] = { FilterC, p_sys->kernel };
+            const unsigned nb_channels = filter->fmt_in.audio.i_channels;
+            vlc_tick_t times[2];
+
+            for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+            {
+                p_sys->kernel = kernels[k];
+                vlc_tick_t start = vlc_tick_now();
+                for (unsigned n = 0; n < iterations; n++)
+                {
+                    block_t *in = block_Alloc(BLOCK_FRAMES * nb_channels
+                                              * sizeof (float));
+                    assert(in != NULL);
+                    memset(in->p_buffer, 0, in->i_buffer);
+                    in->i_nb_samples = BLOCK_FRAMES;
+                    in->i_pts = VLC_TICK_0;
+                    block_t *out = filter->pf_audio_filter(filter, in);
+                    if (out != NULL)
+                        block_Release(out);
+                }
+                times[k] = vlc_tick_now() - start;
+            }
+
+            /* Speed relative to real time */
+            const double duration = (double)iterations * BLOCK_FRAMES
+                                  / rates[i].in;
+            printf("%u Hz -> %u Hz %s, %u taps: C %.0fx, SIMD %.0fx "
+                   "real time\n", rates[i].in, rates[i].out, layouts[j].name,
+                   p_sys->taps, duration / secf_from_vlc_tick(times[0]),
+                   duration / secf_from_vlc_tick(times[1]));
+
+            DeleteFilter(filter);
+        }
+}
+
+int main(int argc, char **argv)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+    libvlc_int_t *libvlc = vlc->p_libvlc_int;
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        bench(libvlc, argc > 2 ? atoi(argv[2]) : 1000);
+    else
+    {
+        test_passthrough(libvlc);
+
+        test_sine(libvlc, 44100, 48000, AOUT_CHANS_STEREO, 1000., 0, 90.);
+        test_sine(libvlc, 44100, 48000, AOUT_CHANS_STEREO, 15000., 0, 90.);
+        test_sine(libvlc, 48000, 44100, AOUT_CHANS_5_1, 1000., 0, 90.);
+        test_sine(libvlc, 48000, 44100, AOUT_CHAN_CENTER, 17000., 0, 85.);
+        test_sine(libvlc, 96000, 44100, AOUT_CHANS_STEREO, 5000., 0, 90.);
+        test_sine(libvlc, 8000, 48000, AOUT_CHAN_CENTER, 3000., 0, 85.);
+        test_sine(libvlc, 48000, 48000, AOUT_CHANS_STEREO, 1000., 20, 90.);
+        test_sine(libvlc, 44100, 48000, AOUT_CHANS_7_1, 1000., 40, 90.);
+
+        test_aliasing(libvlc, 96000, 44100, 30000.);
+        test_aliasing(libvlc, 48000, 44100, 23000.);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,224 @@
+/*****************************************************************************
+ * scaletempo.c: test the scaletempo overlap search
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#define MODULE_NAME scaletempo
+#define MODULE_STRING "scaletempo"
+#include "../../../modules/audio_filter/scaletempo.c"
+#include "../../../modules/audio_filter/fft.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include <vlc_tick.h>
+
+enum signal
+{
+    SIGNAL_NOISE,
+    SIGNAL_SINE,
+    SIGNAL_CHIRP,
+    SIGNAL_SILENCE,
+    SIGNAL_DC,
+    SIGNAL_QUIET,
+    SIGNAL_CLICKS,
+};
+
+static float Sample(enum signal signal, unsigned frame, unsigned channel)
+{
+    switch (signal)
+    {
+        case SIGNAL_NOISE:
+            return rand() / (float)RAND_MAX - .5f;
+        case SIGNAL_SINE:
+            return sinf(frame * (.01f + .003f * channel));
+        case SIGNAL_CHIRP:
+            return sinf(frame * frame * 1e-5f) * .5f
+                 + (rand() / (float)RAND_MAX - .5f) * 1e-3f;
+        case SIGNAL_SILENCE:
+            return 0.f;
+        case SIGNAL_DC:
+            return .25f;
+        case SIGNAL_QUIET:
+            return (rand() / (float)RAND_MAX - .5f) * 1e-30f;
+        case SIGNAL_CLICKS:
+            return (frame % 97) == channel ? 1.f : 0.f;
+    }
+    vlc_assert_unreachable();
+}
+
+static filter_t *CreateFilter(libvlc_int_t *libvlc, unsigned rate,
+                              uint16_t channels)
+{
+    filter_t *filter = vlc_object_create(libvlc, sizeof (*filter));
+    assert(filter != NULL);
+
+    var_Create(filter, "scaletempo-stride", VLC_VAR_INTEGER);
+    var_SetInteger(filter, "scaletempo-stride", 30);
+    var_Create(filter, "scaletempo-overlap", VLC_VAR_FLOAT);
+    var_SetFloat(filter, "scaletempo-overlap", .20f);
+    var_Create(filter, "scaletempo-search", VLC_VAR_INTEGER);
+    var_SetInteger(filter, "scaletempo-search", 14);
+
+    es_format_Init(&filter->fmt_in, AUDIO_ES, VLC_CODEC_FL32);
+    filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
+    filter->fmt_in.audio.i_rate = rate;
+    filter->fmt_in.audio.i_physical_channels = channels;
+    aout_FormatPrepare(&filter->fmt_in.audio);
+
+    int ret = Open(VLC_OBJECT(filter));
+    assert(ret == VLC_SUCCESS);
+    return filter;
+}
+
+static void DeleteFilter(filter_t *filter)
+{
+    Close(VLC_OBJECT(filter));
+    vlc_object_delete(filter);
+}
+
+/* Sets up the FFT search even where the direct search costs less */
+static void EnableFFT(filter_t *filter)
+{
+    filter_sys_t *p = filter->p_sys;
+    if (p->fft != NULL)
+        return;
+
+    unsigned size = 2;
+    while (size < p->frames_search
+                + p->samples_overlap / p->samples_per_frame - 2)
+        size *= 2;
+    p->fft = audio_fft_New(size);
+    p->fft_re = vlc_alloc(size, sizeof (double));
+    p->fft_im = vlc_alloc(size, sizeof (double));
+    p->corr_re = vlc_alloc(size, sizeof (double));
+    p->corr_im = vlc_alloc(size, sizeof (double));
+    assert(p->fft && p->fft_re && p->fft_im && p->corr_re && p->corr_im);
+}
+
+static void Fill(filter_t *filter, enum signal signal)
+{
+    filter_sys_t *p = filter->p_sys;
+    float *queue = (float *)p->buf_queue, *overlap = p->buf_overlap;
+    const unsigned channels = p->samples_per_frame;
+
+    for (unsigned i = 0; i < p->bytes_queue_max / p->bytes_per_sample; i++)
+        queue[i] = Sample(signal, 100 + i / channels, i % channels);
+    /* The overlap of the previous stride, taken from further in the queue
+     * to make a likely best offset */
+    for (unsigned i = 0; i < p->samples_overlap; i++)
+        overlap[i] = Sample(signal, 100 + i / channels
+                                    + p->frames_search / 3, i % channels);
+}
+
+/* Checks that the FFT search selects the same offsets as the direct search */
+static void test_search(libvlc_int_t *libvlc, unsigned rate, uint16_t channels)
+{
+    static const enum signal signals[] = {
+        SIGNAL_NOISE, SIGNAL_SINE, SIGNAL_CHIRP, SIGNAL_SILENCE, SIGNAL_DC,
+        SIGNAL_QUIET, SIGNAL_CLICKS,
+    };
+
+    filter_t *filter = CreateFilter(libvlc, rate, channels);
+    EnableFFT(filter);
+
+    for (size_t i = 0; i < ARRAY_SIZE(signals); i++)
+        for (unsigned j = 0; j < 4; j++)
+        {
+            Fill(filter, signals[i]);
+            assert(best_overlap_offset_fft(filter)
+                == best_overlap_offset_float(filter));
+        }
+
+    DeleteFilter(filter);
+}
+
+/* Compares the direct and FFT searches for one stride */
+static void bench(libvlc_int_t *libvlc, unsigned iterations)
+{
+    static const unsigned rates[] = { 44100, 48000, 96000 };
+    static const struct
+    {
+        const char *name;
+        uint16_t channels;
+    } layouts[] = {
+        { "mono", AOUT_CHAN_CENTER },
+        { "stereo", AOUT_CHANS_STEREO },
+        { "5.1", AOUT_CHANS_5_1 },
+        { "7.1", AOUT_CHANS_7_1 },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(rates); i++)
+        for (size_t j = 0; j < ARRAY_SIZE(layouts); j++)
+        {
+            filter_t *filter = CreateFilter(libvlc, rates[i],
+                                            layouts[j].channels);
+            filter_sys_t *p = filter->p_sys;
+            const bool fft_used =
+                p->best_overlap_offset == best_overlap_offset_fft;
+
+            EnableFFT(filter);
+            Fill(filter, SIGNAL_NOISE);
+
+            vlc_tick_t start = vlc_tick_now();
+            for (unsigned k = 0; k < iterations; k++)
+                best_overlap_offset_float(filter);
+            const vlc_tick_t direct = vlc_tick_now() - start;
+
+            start = vlc_tick_now();
+            for (unsigned k = 0; k < iterations; k++)
+                best_overlap_offset_fft(filter);
+            const vlc_tick_t fft_search = vlc_tick_now() - start;
+
+            /* One search per output stride, whatever the playback rate */
+            printf("%u Hz %s: direct %"PRId64" us, fft %"PRId64" us "
+                   "per stride (%u ms), fft used: %s\n",
+                   rates[i], layouts[j].name,
+                   US_FROM_VLC_TICK(direct) / iterations,
+                   US_FROM_VLC_TICK(fft_search) / iterations, p->ms_stride,
+                   fft_used ? "yes" : "no");
+
+            DeleteFilter(filter);
+        }
+}
+
+int main(int argc, char **argv)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        bench(vlc->p_libvlc_int, argc > 2 ? atoi(argv[2]) : 100);
+    else
+    {
+        test_search(vlc->p_libvlc_int, 8000, AOUT_CHAN_CENTER);
+        test_search(vlc->p_libvlc_int, 44100, AOUT_CHANS_STEREO);
+        test_search(vlc->p_libvlc_int, 48000, AOUT_CHANS_5_1);
+        test_search(vlc->p_libvlc_int, 96000, AOUT_CHAN_CENTER);
+        test_search(vlc->p_libvlc_int, 96000, AOUT_CHANS_STEREO);
+        test_search(vlc->p_libvlc_int, 96000, AOUT_CHANS_7_1);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,342 @@
+/*****************************************************************************
+ * float.c: test the float audio volume and mixer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#define MODULE_STRING "float_mixer"
+#include "../../../modules/audio_mixer/float.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include <vlc_block.h>
+#include <vlc_tick.h>
+
+#define RATE 48000
+
+static const struct
+{
+    const char *name;
+    ramp_fl32_t kernel;
+} kernels[] = {
+    { "C", RampFL32C },
+#if defined(HAVE_SSE2_INTRINSICS)
+    { "SSE", RampFL32SSE },
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    { "AVX", RampFL32AVX },
+#endif
+#if defined(__ARM_NEON)
+    { "NEON", RampFL32NEON },
+#endif
+};
+
+static bool KernelSupported(ramp_fl32_t kernel)
+{
+#if defined(HAVE_SSE2_INTRINSICS)
+    if (kernel == RampFL32SSE)
+        return vlc_CPU_SSE();
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (kernel == RampFL32AVX)
+        return vlc_CPU_AVX();
+#endif
+#if defined(__ARM_NEON)
+    if (kernel == RampFL32NEON)
+        return vlc_CPU_ARM_NEON();
+#endif
+    return true;
+}
+
+static void FillNoise(float *buf, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        buf[i] = rand() / (float)RAND_MAX * 2.f - 1.f;
+}
+
+/* Gain of a frame of a ramp, from its definition */
+static double RampGain(const audio_volume_ramp_t *ramp, size_t n,
+                       size_t frames)
+{
+    if (ramp->exponential)
+        return ramp->from * pow((double)ramp->to / ramp->from,
+                                (double)n / frames);
+    return ramp->from + ((double)ramp->to - ramp->from) * n / frames;
+}
+
+static bool Near(double value, double expected)
+{
+    return fabs(value - expected) <= 1e-5 * (fabs(expected) + 1e-2);
+}
+
+static void test_kernels(unsigned channels, size_t frames, float from,
+                         float to)
+{
+    const audio_volume_ramp_t ramp = audio_volume_Ramp(from, to);
+    float *src = malloc(frames * channels * sizeof (float));
+    float *dst = malloc(frames * channels * sizeof (float));
+    float *acc = malloc(frames * channels * sizeof (float));
+    assert(src != NULL && dst != NULL && acc != NULL);
+
+    FillNoise(src, frames * channels);
+    FillNoise(acc, frames * channels);
+
+    for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+    {
+        if (!KernelSupported(kernels[k].kernel))
+            continue;
+
+        for (unsigned accumulate = 0; accumulate < 2; accumulate++)
+        {
+            double ratio, step, gain = from;
+
+            memcpy(dst, acc, frames * channels * sizeof (float));
+            audio_volume_RampProgression(&ramp, frames, &ratio, &step);
+            kernels[k].kernel(dst, src, accumulate, frames, channels, &gain,
+                              ratio, step);
+
+            for (size_t n = 0; n < frames; n++)
+            {
+                const double g = RampGain(&ramp, n, frames);
+
+                for (unsigned c = 0; c < channels; c++)
+                {
+                    const size_t i = n * channels + c;
+                    const double expected = (accumulate ? acc[i] : 0.)
+                                          + src[i] * g;
+                    if (!Near(dst[i], expected))
+                    {
+                        printf("%s, %u channels, %zu frames, %g to %g: "
+                               "frame %zu is %g, not %g\n", kernels[k].name,
+                               channels, frames, from, to, n, dst[i],
+                               expected);
+                        abort();
+                    }
+                }
+            }
+            /* The next buffer continues the ramp */
+            assert(Near(gain, to));
+        }
+    }
+    free(src);
+    free(dst);
+    free(acc);
+}
+
+static block_t *NoiseBlock(size_t samples)
+{
+    block_t *block = block_Alloc(samples * sizeof (float));
+    assert(block != NULL);
+    FillNoise((float *)block->p_buffer, samples);
+    return block;
+}
+
+static void test_mix(unsigned channels, size_t frames, bool in_place)
+{
+    static const audio_volume_ramp_t ramps[] = {
+        { 1.f, .5f, true }, { 0.f, 1.f, false }, { .25f, .25f, true },
+    };
+    const size_t samples = frames * channels;
+    block_t *in[ARRAY_SIZE(ramps)];
+    float *ref = calloc(samples, sizeof (float));
+    assert(ref != NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(ramps); i++)
+    {
+        in[i] = NoiseBlock(samples);
+        for (size_t n = 0; n < frames; n++)
+            for (unsigned c = 0; c < channels; c++)
+            {
+                const size_t j = n * channels + c;
+                ref[j] += ((float *)in[i]->p_buffer)[j]
+                        * RampGain(&ramps[i], n, frames);
+            }
+    }
+
+    block_t *out = in_place ? in[0] : NoiseBlock(samples);
+    MixFL32(NULL, out, in, ramps, ARRAY_SIZE(ramps), channels);
+
+    const float *p = (const float *)out->p_buffer;
+    for (size_t i = 0; i < samples; i++)
+        assert(Near(p[i], ref[i]));
+
+    if (!in_place)
+        block_Release(out);
+    for (size_t i = 0; i < ARRAY_SIZE(ramps); i++)
+        block_Release(in[i]);
+    free(ref);
+}
+
+static void test_fl64(unsigned channels, size_t frames)
+{
+    const audio_volume_ramp_t ramp = audio_volume_Ramp(.75f, .5f);
+    block_t *block = block_Alloc(frames * channels * sizeof (double));
+    assert(block != NULL);
+
+    double *p = (double *)block->p_buffer;
+    for (size_t i = 0; i < frames * channels; i++)
+        p[i] = 1.;
+
+    RampFL64(NULL, block, channels, &ramp);
+    for (size_t n = 0; n < frames; n++)
+        for (unsigned c = 0; c < channels; c++)
+            assert(Near(p[n * channels + c], RampGain(&ramp, n, frames)));
+    block_Release(block);
+}
+
+/* The volume before the ramps */
+static void FormerFL32(block_t *p_buffer, float f_multiplier)
+{
+    float *p = (float *)p_buffer->p_buffer;
+    for (size_t i = p_buffer->i_buffer / sizeof(*p); i > 0; i--)
+        *(p++) *= f_multiplier;
+}
+
+static void bench(unsigned count)
+{
+    enum { CHANNELS = 8, FRAMES = 1024, INPUTS = 4 };
+    const double seconds = (double)count * FRAMES / RATE;
+    const size_t samples = CHANNELS * FRAMES;
+    const audio_volume_ramp_t ramp = audio_volume_Ramp(1.f, .5f);
+    float *buf = malloc(samples * sizeof (float));
+    block_t *in[INPUTS];
+    audio_volume_ramp_t ramps[INPUTS];
+    assert(buf != NULL);
+
+    FillNoise(buf, samples);
+    for (unsigned i = 0; i < INPUTS; i++)
+    {
+        in[i] = NoiseBlock(samples);
+        ramps[i] = audio_volume_Ramp(.5f, .25f);
+    }
+
+    /* Former constant gain, and mix through an intermediate buffer */
+    block_t *block = block_Alloc(samples * sizeof (float));
+    assert(block != NULL);
+    memcpy(block->p_buffer, buf, samples * sizeof (float));
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned n = 0; n < count; n++)
+        FormerFL32(block, .999f);
+    vlc_tick_t time = vlc_tick_now() - start;
+    printf("gain, 7.1: former %.0fx real time\n",
+           seconds / secf_from_vlc_tick(time));
+
+    start = vlc_tick_now();
+    for (unsigned n = 0; n < count; n++)
+    {
+        memset(buf, 0, samples * sizeof (float));
+        for (unsigned i = 0; i < INPUTS; i++)
+        {
+            const float *p = (const float *)block->p_buffer;
+
+            memcpy(block->p_buffer, in[i]->p_buffer, in[i]->i_buffer);
+            FormerFL32(block, .5f);
+            for (size_t j = 0; j < block->i_buffer / sizeof (float); j++)
+                buf[j] += p[j];
+        }
+    }
+    time = vlc_tick_now() - start;
+    printf("mix, %d inputs, 7.1: former %.0fx real time\n", INPUTS,
+           seconds / secf_from_vlc_tick(time));
+    block_Release(block);
+
+    for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+    {
+        if (!KernelSupported(kernels[k].kernel))
+            continue;
+
+        double ratio, step, gain;
+
+        start = vlc_tick_now();
+        for (unsigned n = 0; n < count; n++)
+        {
+            gain = .999;
+            kernels[k].kernel(buf, buf, false, FRAMES, CHANNELS, &gain,
+                              1., 0.);
+        }
+        time = vlc_tick_now() - start;
+        printf("gain, 7.1: %s %.0fx real time\n", kernels[k].name,
+               seconds / secf_from_vlc_tick(time));
+        FillNoise(buf, samples);
+
+        audio_volume_RampProgression(&ramp, FRAMES, &ratio, &step);
+        start = vlc_tick_now();
+        for (unsigned n = 0; n < count; n++)
+        {
+            gain = ramp.from;
+            kernels[k].kernel(buf, buf, false, FRAMES, CHANNELS, &gain,
+                              ratio, step);
+        }
+        time = vlc_tick_now() - start;
+        printf("ramp, 7.1: %s %.0fx real time\n", kernels[k].name,
+               seconds / secf_from_vlc_tick(time));
+
+        start = vlc_tick_now();
+        for (unsigned n = 0; n < count; n++)
+            for (unsigned i = 0; i < INPUTS; i++)
+            {
+                gain = ramps[i].from;
+                audio_volume_RampProgression(&ramps[i], FRAMES, &ratio,
+                                             &step);
+                kernels[k].kernel(buf, (const float *)in[i]->p_buffer, i > 0,
+                                  FRAMES, CHANNELS, &gain, ratio, step);
+            }
+        time = vlc_tick_now() - start;
+        printf("mix, %d inputs, 7.1: %s %.0fx real time\n", INPUTS,
+               kernels[k].name, seconds / secf_from_vlc_tick(time));
+    }
+
+    for (unsigned i = 0; i < INPUTS; i++)
+        block_Release(in[i]);
+    free(buf);
+}
+
+int main(int argc, char **argv)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        bench(argc > 2 ? atoi(argv[2]) : 10000);
+    else
+    {
+        static const size_t lengths[] = { 1, 7, 64, 1023 };
+
+        for (unsigned channels = 1; channels <= AOUT_CHAN_MAX; channels++)
+            for (size_t i = 0; i < ARRAY_SIZE(lengths); i++)
+            {
+                test_kernels(channels, lengths[i], 1.f, 1.f);
+                test_kernels(channels, lengths[i], .5f, 2.f);
+                test_kernels(channels, lengths[i], 1.f, .001f);
+                test_kernels(channels, lengths[i], 0.f, .5f);
+                test_kernels(channels, lengths[i], .5f, 0.f);
+                test_mix(channels, lengths[i], false);
+                test_mix(channels, lengths[i], true);
+                test_fl64(channels, lengths[i]);
+            }
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,370 @@
+/*****************************************************************************
+ * libmp4.c: test the deferred loading of MP4 sample tables
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_stream.h>
+
+#include "../../../modules/demux/mp4/libmp4.h"
+
+const char vlc_module_name[] = "test_libmp4";
+
+#include "mp4_writer.h"
+
+#define STSS_COUNT 2000
+#define SBGP_COUNT 1000
+
+#define STSS_PATH "moov/trak[1]/mdia/minf/stbl/stss"
+#define SBGP_PATH "moov/trak[1]/mdia/minf/stbl/sbgp"
+
+struct file
+{
+    struct mp4w w;
+    size_t stss; /* offset of the big stss box */
+    size_t sbgp; /* offset of the sbgp box */
+};
+
+static void OpenStbl(struct mp4w *w)
+{
+    mp4w_Open(w, "trak");
+    mp4w_Open(w, "mdia");
+    mp4w_Open(w, "minf");
+    mp4w_Open(w, "stbl");
+}
+
+static void CloseStbl(struct mp4w *w)
+{
+    for (unsigned i = 0; i < 4; i++)
+        mp4w_Close(w);
+}
+
+/* A small sample table, always parsed, then big ones that can be deferred,
+ * the last one ending the file */
+static void Build(struct file *f)
+{
+    struct mp4w *w = &f->w;
+
+    mp4w_Init(w);
+    mp4w_Open(w, "ftyp");
+    mp4w_Bytes(w, "isom", 4);
+    mp4w_U32(w, 0x200);
+    mp4w_Bytes(w, "isom", 4);
+    mp4w_Close(w);
+
+    mp4w_Open(w, "moov");
+
+    OpenStbl(w);
+    mp4w_OpenFull(w, "stss", 0, 0);
+    mp4w_U32(w, 3);
+    mp4w_U32(w, 1);
+    mp4w_U32(w, 25);
+    mp4w_U32(w, 50);
+    mp4w_Close(w);
+    CloseStbl(w);
+
+    OpenStbl(w);
+    f->sbgp = w->size;
+    mp4w_OpenFull(w, "sbgp", 0, 0);
+    mp4w_Bytes(w, "roll", 4);
+    mp4w_U32(w, SBGP_COUNT);
+    for (uint32_t i = 0; i < SBGP_COUNT; i++)
+    {
+        mp4w_U32(w, 1 + i % 5);
+        mp4w_U32(w, i % 3);
+    }
+    mp4w_Close(w);
+
+    f->stss = w->size;
+    mp4w_OpenFull(w, "stss", 0, 0);
+    mp4w_U32(w, STSS_COUNT);
+    for (uint32_t i = 0; i < STSS_COUNT; i++)
+        mp4w_U32(w, 1 + 12 * i);
+    mp4w_Close(w);
+    CloseStbl(w);
+
+    mp4w_Close(w); /* moov */
+    assert(w->depth == 0);
+}
+
+/* A stream that cannot seek, so that nothing is deferred */
+static ssize_t UnseekableRead(stream_t *s, void *buf, size_t len)
+{
+    return vlc_stream_Read(s->p_sys, buf, len);
+}
+
+static int UnseekableControl(stream_t *s, int query, va_list args)
+{
+    (void) s;
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+        case STREAM_CAN_FASTSEEK:
+            *va_arg(args, bool *) = false;
+            return VLC_SUCCESS;
+        case STREAM_CAN_PAUSE:
+        case STREAM_CAN_CONTROL_PACE:
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+        case STREAM_GET_PTS_DELAY:
+            *va_arg(args, vlc_tick_t *) = 0;
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+/* A stream that can only seek slowly, as a network stream */
+static int SlowSeek(stream_t *s, uint64_t offset)
+{
+    return vlc_stream_Seek(s->p_sys, offset);
+}
+
+static int SlowSeekControl(stream_t *s, int query, va_list args)
+{
+    switch (query)
+    {
+        case STREAM_CAN_SEEK:
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+        case STREAM_CAN_FASTSEEK:
+            *va_arg(args, bool *) = false;
+            return VLC_SUCCESS;
+        default:
+            return UnseekableControl(s, query, args);
+    }
+}
+
+static void UnseekableDestroy(stream_t *s)
+{
+    vlc_stream_Delete(s->p_sys);
+}
+
+static stream_t *UnseekableNew(vlc_object_t *obj, uint8_t *buf, size_t size)
+{
+    stream_t *s = vlc_stream_CommonNew(obj, UnseekableDestroy);
+    assert(s != NULL);
+    s->p_sys = vlc_stream_MemoryNew(obj, buf, size, true);
+    assert(s->p_sys != NULL);
+    s->pf_read = UnseekableRead;
+    s->pf_control = UnseekableControl;
+    return s;
+}
+
+static stream_t *SlowSeekNew(vlc_object_t *obj, uint8_t *buf, size_t size)
+{
+    stream_t *s = UnseekableNew(obj, buf, size);
+    s->pf_seek = SlowSeek;
+    s->pf_control = SlowSeekControl;
+    return s;
+}
+
+static void CheckSameStss(const MP4_Box_t *a, const MP4_Box_t *b)
+{
+    const MP4_Box_data_stss_t *x = a->data.p_stss, *y = b->data.p_stss;
+
+    assert(x != NULL && y != NULL);
+    assert(x->i_entry_count == STSS_COUNT);
+    assert(y->i_entry_count == STSS_COUNT);
+    for (uint32_t i = 0; i < STSS_COUNT; i++)
+    {
+        /* libmp4 numbers samples from 0 */
+        assert(x->i_sample_number[i] == 12 * i);
+        assert(y->i_sample_number[i] == x->i_sample_number[i]);
+    }
+}
+
+static void CheckSameSbgp(const MP4_Box_t *a, const MP4_Box_t *b)
+{
+    const MP4_Box_data_sbgp_t *x = a->data.p_sbgp, *y = b->data.p_sbgp;
+
+    assert(x != NULL && y != NULL);
+    assert(x->i_grouping_type == VLC_FOURCC('r','o','l','l'));
+    assert(y->i_grouping_type == x->i_grouping_type);
+    assert(x->i_entry_count == SBGP_COUNT);
+    assert(y->i_entry_count == SBGP_COUNT);
+    for (uint32_t i = 0; i < SBGP_COUNT; i++)
+    {
+        assert(x->entries.pi_sample_count[i] == 1 + i % 5);
+        assert(x->entries.pi_group_description_index[i] == i % 3);
+        assert(y->entries.pi_sample_count[i] == x->entries.pi_sample_count[i]);
+        assert(y->entries.pi_group_description_index[i]
+               == x->entries.pi_group_description_index[i]);
+    }
+}
+
+/* Loads a deferred box, checking that the stream position is kept */
+static int Load(stream_t *s, MP4_Box_t *box)
+{
+    assert(vlc_stream_Seek(s, 20) == VLC_SUCCESS);
+    int ret = MP4_BoxLoad(s, box);
+    assert(vlc_stream_Tell(s) == 20);
+    assert(!(box->e_flags & BOX_FLAG_DEFERRED));
+    return ret;
+}
+
+static void test_deferred(vlc_object_t *obj)
+{
+    struct file f;
+    Build(&f);
+
+    stream_t *eager_s = UnseekableNew(obj, f.w.buf, f.w.size);
+    MP4_Box_t *eager = MP4_BoxGetRoot(eager_s);
+    assert(eager != NULL);
+
+    stream_t *s = vlc_stream_MemoryNew(obj, f.w.buf, f.w.size, true);
+    assert(s != NULL);
+    MP4_Box_t *root = MP4_BoxGetRoot(s);
+    assert(root != NULL);
+
+    /* Small tables are parsed right away */
+    MP4_Box_t *box = MP4_BoxGet(root, "moov/trak[0]/mdia/minf/stbl/stss");
+    assert(box != NULL && !(box->e_flags & BOX_FLAG_DEFERRED));
+    assert(box->data.p_stss->i_entry_count == 3);
+    assert(box->data.p_stss->i_sample_number[2] == 49);
+
+    /* Big ones only when needed, with the same contents */
+    MP4_Box_t *stss = MP4_BoxGet(root, STSS_PATH);
+    MP4_Box_t *sbgp = MP4_BoxGet(root, SBGP_PATH);
+    MP4_Box_t *eager_stss = MP4_BoxGet(eager, STSS_PATH);
+    MP4_Box_t *eager_sbgp = MP4_BoxGet(eager, SBGP_PATH);
+    assert(stss != NULL && sbgp != NULL);
+    assert(eager_stss != NULL && eager_sbgp != NULL);
+    assert(!(eager_stss->e_flags & BOX_FLAG_DEFERRED));
+    assert(!(eager_sbgp->e_flags & BOX_FLAG_DEFERRED));
+    assert(stss->e_flags & BOX_FLAG_DEFERRED);
+    assert(sbgp->e_flags & BOX_FLAG_DEFERRED);
+    assert(stss->data.p_payload == NULL && sbgp->data.p_payload == NULL);
+
+    /* The stss box ends the file */
+    assert(stss->i_pos + stss->i_size == f.w.size);
+    assert(Load(s, stss) == VLC_SUCCESS);
+    CheckSameStss(stss, eager_stss);
+    assert(Load(s, sbgp) == VLC_SUCCESS);
+    CheckSameSbgp(sbgp, eager_sbgp);
+
+    /* Loaded once */
+    assert(MP4_BoxLoad(s, stss) == VLC_SUCCESS);
+    CheckSameStss(stss, eager_stss);
+
+    MP4_BoxFree(root);
+    vlc_stream_Delete(s);
+
+    /* Nor on streams that seek slowly, where the first frame would wait for
+     * a round trip per deferred table */
+    s = SlowSeekNew(obj, f.w.buf, f.w.size);
+    root = MP4_BoxGetRoot(s);
+    assert(root != NULL);
+    stss = MP4_BoxGet(root, STSS_PATH);
+    sbgp = MP4_BoxGet(root, SBGP_PATH);
+    assert(stss != NULL && !(stss->e_flags & BOX_FLAG_DEFERRED));
+    assert(sbgp != NULL && !(sbgp->e_flags & BOX_FLAG_DEFERRED));
+    CheckSameStss(stss, eager_stss);
+    CheckSameSbgp(sbgp, eager_sbgp);
+    MP4_BoxFree(root);
+    vlc_stream_Delete(s);
+
+    MP4_BoxFree(eager);
+    vlc_stream_Delete(eager_s);
+    mp4w_Clean(&f.w);
+}
+
+static void test_failures(vlc_object_t *obj)
+{
+    struct file f;
+    Build(&f);
+
+    stream_t *s = vlc_stream_MemoryNew(obj, f.w.buf, f.w.size, true);
+    assert(s != NULL);
+    MP4_Box_t *root = MP4_BoxGetRoot(s);
+    assert(root != NULL);
+
+    MP4_Box_t *stss = MP4_BoxGet(root, STSS_PATH);
+    MP4_Box_t *sbgp = MP4_BoxGet(root, SBGP_PATH);
+    assert(stss != NULL && (stss->e_flags & BOX_FLAG_DEFERRED));
+    assert(sbgp != NULL && (sbgp->e_flags & BOX_FLAG_DEFERRED));
+
+    /* The file got shorter since the moov was read: the box at the end
+     * cannot be read back */
+    stream_t *cut = vlc_stream_MemoryNew(obj, f.w.buf, f.w.size - 100, true);
+    assert(cut != NULL);
+    assert(Load(cut, stss) == VLC_EGENERIC);
+    assert(stss->data.p_payload == NULL);
+    /* and is not retried */
+    assert(MP4_BoxLoad(s, stss) == VLC_EGENERIC);
+    assert(stss->data.p_payload == NULL);
+
+    /* Invalid flags */
+    f.w.buf[f.sbgp + 11] = 1;
+    assert(Load(s, sbgp) == VLC_EGENERIC);
+    assert(sbgp->data.p_payload == NULL);
+
+    vlc_stream_Delete(cut);
+    MP4_BoxFree(root);
+    vlc_stream_Delete(s);
+
+    /* More entries than the box can hold */
+    f.w.buf[f.sbgp + 11] = 0;
+    f.w.buf[f.stss + 12] = 0x10;
+    s = vlc_stream_MemoryNew(obj, f.w.buf, f.w.size, true);
+    assert(s != NULL);
+    root = MP4_BoxGetRoot(s);
+    assert(root != NULL);
+
+    stss = MP4_BoxGet(root, STSS_PATH);
+    assert(stss != NULL && (stss->e_flags & BOX_FLAG_DEFERRED));
+    assert(Load(s, stss) == VLC_EGENERIC);
+    assert(stss->data.p_payload == NULL);
+    sbgp = MP4_BoxGet(root, SBGP_PATH);
+    assert(Load(s, sbgp) == VLC_SUCCESS);
+
+    MP4_BoxFree(root);
+    vlc_stream_Delete(s);
+
+    /* A box truncated by the end of the file is dropped, deferred or not */
+    f.w.buf[f.stss + 12] = 0;
+    s = vlc_stream_MemoryNew(obj, f.w.buf, f.w.size - 100, true);
+    assert(s != NULL);
+    root = MP4_BoxGetRoot(s);
+    if (root != NULL)
+    {
+        assert(MP4_BoxGet(root, STSS_PATH) == NULL);
+        MP4_BoxFree(root);
+    }
+    vlc_stream_Delete(s);
+
+    mp4w_Clean(&f.w);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    test_deferred(VLC_OBJECT(vlc->p_libvlc_int));
+    test_failures(VLC_OBJECT(vlc->p_libvlc_int));
+
+    libvlc_release(vlc);
+    return 0;
+}
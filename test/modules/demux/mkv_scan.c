@@ -0,0 +1,279 @@
+/*****************************************************************************
+ * mkv_scan.c: test the Matroska background cluster scan
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_modules.h>
+#include <vlc_atomic.h>
+
+const char vlc_module_name[] = "test_mkv_scan";
+
+/* 2 seconds of 8 kHz mono 16 bits PCM, one block of 40 ms per cluster */
+#define CLUSTERS     50
+#define CLUSTER_MS   40
+#define BLOCK_SIZE   (8 * CLUSTER_MS * 2)
+
+#define EBML_DEPTH   8
+
+struct ebml
+{
+    uint8_t *buf;
+    size_t size;
+    size_t alloc;
+    size_t elements[EBML_DEPTH];
+    unsigned depth;
+};
+
+static void EbmlBytes(struct ebml *w, const void *data, size_t size)
+{
+    if (w->size + size > w->alloc)
+    {
+        w->alloc = (w->size + size) * 2;
+        w->buf = realloc(w->buf, w->alloc);
+        assert(w->buf != NULL);
+    }
+    if (data != NULL)
+        memcpy(w->buf + w->size, data, size);
+    else
+        memset(w->buf + w->size, 0, size);
+    w->size += size;
+}
+
+static void EbmlID(struct ebml *w, uint32_t id)
+{
+    uint8_t buf[4];
+    size_t len = id > 0xFFFFFF ? 4 : id > 0xFFFF ? 3 : id > 0xFF ? 2 : 1;
+
+    SetDWBE(buf, id);
+    EbmlBytes(w, buf + 4 - len, len);
+}
+
+/* Opens a master element, its size is written by EbmlClose() */
+static void EbmlOpen(struct ebml *w, uint32_t id)
+{
+    assert(w->depth < EBML_DEPTH);
+    EbmlID(w, id);
+    w->elements[w->depth++] = w->size;
+    EbmlBytes(w, NULL, 8);
+}
+
+static void EbmlClose(struct ebml *w)
+{
+    assert(w->depth > 0);
+    size_t pos = w->elements[--w->depth];
+
+    /* sizes are always coded on 8 bytes */
+    SetQWBE(w->buf + pos, w->size - pos - 8);
+    w->buf[pos] = 0x01;
+}
+
+static void EbmlData(struct ebml *w, uint32_t id, const void *data,
+                     size_t size)
+{
+    EbmlID(w, id);
+    assert(size < 0x7F);
+    uint8_t len = 0x80 | size;
+    EbmlBytes(w, &len, 1);
+    EbmlBytes(w, data, size);
+}
+
+static void EbmlUint(struct ebml *w, uint32_t id, uint64_t value)
+{
+    uint8_t buf[8];
+
+    SetQWBE(buf, value);
+    EbmlData(w, id, buf, 8);
+}
+
+static void EbmlFloat(struct ebml *w, uint32_t id, double value)
+{
+    union { double d; uint64_t u; } v = { .d = value };
+    EbmlUint(w, id, v.u);
+}
+
+static void EbmlString(struct ebml *w, uint32_t id, const char *str)
+{
+    EbmlData(w, id, str, strlen(str));
+}
+
+/* A file without cues nor seek head: seeking needs the cluster scan */
+static void Build(struct ebml *w)
+{
+    EbmlOpen(w, 0x1A45DFA3); /* EBML */
+    EbmlUint(w, 0x4286, 1);
+    EbmlUint(w, 0x42F7, 1);
+    EbmlUint(w, 0x42F2, 4);
+    EbmlUint(w, 0x42F3, 8);
+    EbmlString(w, 0x4282, "matroska");
+    EbmlUint(w, 0x4287, 2);
+    EbmlUint(w, 0x4285, 2);
+    EbmlClose(w);
+
+    EbmlOpen(w, 0x18538067); /* Segment */
+
+    EbmlOpen(w, 0x1549A966); /* Info */
+    EbmlUint(w, 0x2AD7B1, 1000000);
+    EbmlFloat(w, 0x4489, CLUSTERS * CLUSTER_MS);
+    EbmlString(w, 0x4D80, "test");
+    EbmlString(w, 0x5741, "test");
+    EbmlClose(w);
+
+    EbmlOpen(w, 0x1654AE6B); /* Tracks */
+    EbmlOpen(w, 0xAE); /* TrackEntry */
+    EbmlUint(w, 0xD7, 1);
+    EbmlUint(w, 0x73C5, 1);
+    EbmlUint(w, 0x83, 2);
+    EbmlString(w, 0x86, "A_PCM/INT/LIT");
+    EbmlOpen(w, 0xE1); /* Audio */
+    EbmlFloat(w, 0xB5, 8000.);
+    EbmlUint(w, 0x9F, 1);
+    EbmlUint(w, 0x6264, 16);
+    EbmlClose(w);
+    EbmlClose(w);
+    EbmlClose(w);
+
+    for (unsigned i = 0; i < CLUSTERS; i++)
+    {
+        EbmlOpen(w, 0x1F43B675); /* Cluster */
+        EbmlUint(w, 0xE7, i * CLUSTER_MS);
+
+        /* SimpleBlock: track 1, relative timecode 0, keyframe */
+        static const uint8_t header[] = { 0x81, 0x00, 0x00, 0x80 };
+        EbmlID(w, 0xA3);
+        uint8_t size[8];
+        SetQWBE(size, sizeof (header) + BLOCK_SIZE);
+        size[0] = 0x01;
+        EbmlBytes(w, size, sizeof (size));
+        EbmlBytes(w, header, sizeof (header));
+        EbmlBytes(w, NULL, BLOCK_SIZE);
+        EbmlClose(w);
+    }
+
+    EbmlClose(w); /* Segment */
+    assert(w->depth == 0);
+}
+
+/* Number of clusters found by the last completed scan, -1 if none */
+static atomic_int scanned = ATOMIC_VAR_INIT(-1);
+static uint64_t file_size;
+
+static void Log(void *data, int level, const libvlc_log_t *ctx,
+                const char *fmt, va_list ap)
+{
+    char msg[256];
+    unsigned count;
+    uint64_t end;
+
+    (void) data; (void) level; (void) ctx;
+    vsnprintf(msg, sizeof (msg), fmt, ap);
+    if (sscanf(msg, "found %u clusters in the background, stopped at %"SCNu64,
+               &count, &end) == 2 && end == file_size)
+        atomic_store(&scanned, count);
+}
+
+static void OnEnd(const libvlc_event_t *event, void *data)
+{
+    assert(event->type == libvlc_MediaPlayerEndReached);
+    vlc_sem_post(data);
+}
+
+int main(void)
+{
+    test_init();
+
+    static const char *args[] = {
+        "-v", "--vout=vdummy", "--aout=adummy", "--demux=mkv",
+        "--no-seek-index-cache",
+    };
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
+    assert(vlc != NULL);
+
+    if (!module_exists("mkv"))
+    {
+        libvlc_release(vlc);
+        return 77;
+    }
+
+    char path[] = "/tmp/vlc-mkv-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+
+    struct ebml w = { .buf = NULL };
+    Build(&w);
+    assert(write(fd, w.buf, w.size) == (ssize_t)w.size);
+    close(fd);
+    file_size = w.size;
+    free(w.buf);
+
+    libvlc_log_set(vlc, Log, NULL);
+
+    libvlc_media_t *md = libvlc_media_new_path(vlc, path);
+    assert(md != NULL);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(md);
+    assert(mp != NULL);
+    libvlc_media_release(md);
+
+    /* Closed while the scan may still be running */
+    for (unsigned i = 0; i < 20; i++)
+    {
+        assert(libvlc_media_player_play(mp) == 0);
+        libvlc_media_player_stop(mp);
+    }
+
+    /* Seeks before and while the scan runs */
+    for (unsigned i = 0; i < 20; i++)
+    {
+        assert(libvlc_media_player_play(mp) == 0);
+        libvlc_media_player_set_time(mp, (CLUSTERS - 1 - i) * CLUSTER_MS,
+                                     false);
+        libvlc_media_player_set_time(mp, i * CLUSTER_MS, true);
+        libvlc_media_player_set_time(mp, (CLUSTERS - 1) * CLUSTER_MS, false);
+        libvlc_media_player_stop(mp);
+    }
+
+    /* Played through, the scan covers the whole segment long before the
+     * end, the first cluster being known from the opening */
+    libvlc_event_manager_t *em = libvlc_media_player_event_manager(mp);
+    vlc_sem_t ended;
+
+    vlc_sem_init(&ended, 0);
+    assert(libvlc_event_attach(em, libvlc_MediaPlayerEndReached, OnEnd,
+                               &ended) == 0);
+    assert(libvlc_event_attach(em, libvlc_MediaPlayerEncounteredError, OnEnd,
+                               &ended) == 0);
+    atomic_store(&scanned, -1);
+    assert(libvlc_media_player_play(mp) == 0);
+    vlc_sem_wait(&ended);
+    libvlc_event_detach(em, libvlc_MediaPlayerEndReached, OnEnd, &ended);
+    libvlc_event_detach(em, libvlc_MediaPlayerEncounteredError, OnEnd,
+                        &ended);
+    vlc_sem_destroy(&ended);
+    libvlc_media_player_stop(mp);
+
+    int count = atomic_load(&scanned);
+    assert(count >= CLUSTERS - 1 && count <= CLUSTERS);
+
+    libvlc_media_player_release(mp);
+    libvlc_log_unset(vlc);
+    libvlc_release(vlc);
+    unlink(path);
+    return 0;
+}
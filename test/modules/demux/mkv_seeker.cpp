@@ -0,0 +1,167 @@
+/*****************************************************************************
+ * mkv_seeker.cpp: test the Matroska seek index serializer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../../modules/demux/mkv/matroska_segment_seeker.hpp"
+
+#undef NDEBUG
+#include <cassert>
+
+extern "C" const char vlc_module_name[] = MODULE_STRING;
+
+using namespace mkv;
+
+typedef SegmentSeeker::Seekpoint Seekpoint;
+typedef SegmentSeeker::Range Range;
+
+static void Fill( SegmentSeeker& seeker )
+{
+    static const SegmentSeeker::Cluster clusters[] = {
+        { 100,  VLC_TICK_FROM_MS(0),   -1, 2900 },
+        { 3000, VLC_TICK_FROM_MS(40),  -1, 2000 },
+        { 8000, VLC_TICK_FROM_MS(120), -1, UINT64_MAX },
+    };
+
+    seeker.mark_range_as_searched( Range( 100, 4999 ) );
+    seeker.mark_range_as_searched( Range( 8000, 9000 ) );
+    for( size_t i = 0; i < sizeof( clusters ) / sizeof( clusters[0] ); i++ )
+        seeker.add_cluster( clusters[i] );
+    seeker.add_cluster_position( 12000 );
+
+    seeker.add_seekpoint( 1, Seekpoint( 100, VLC_TICK_FROM_MS(0) ) );
+    seeker.add_seekpoint( 1, Seekpoint( 3000, VLC_TICK_FROM_MS(40),
+                                        Seekpoint::QUESTIONABLE ) );
+    seeker.add_seekpoint( 2, Seekpoint( 150, VLC_TICK_FROM_MS(10),
+                                        Seekpoint::DISABLED ) );
+}
+
+static bool IsEmpty( SegmentSeeker const& seeker )
+{
+    return seeker._ranges_searched.empty() && seeker._clusters.empty() &&
+           seeker._cluster_positions.empty() &&
+           seeker._tracks_seekpoints.empty();
+}
+
+static void test_roundtrip( std::vector<uint8_t>& data )
+{
+    SegmentSeeker seeker;
+    Fill( seeker );
+    seeker.serialize( data );
+
+    SegmentSeeker restored;
+    assert( restored.deserialize( data.data(), data.size() ) );
+
+    std::vector<uint8_t> again;
+    restored.serialize( again );
+    assert( again == data );
+
+    assert( restored._ranges_searched.size() == 2 );
+    assert( restored._ranges_searched[1].start == 8000 );
+    assert( restored._ranges_searched[1].end == 9000 );
+    assert( restored._cluster_positions.size() == 4 );
+    assert( restored._cluster_positions[3] == 12000 );
+    assert( restored._clusters.size() == 3 );
+    assert( restored._clusters[VLC_TICK_FROM_MS(0)].duration
+            == VLC_TICK_FROM_MS(40) );
+    assert( restored._clusters[VLC_TICK_FROM_MS(120)].size == UINT64_MAX );
+    assert( restored._tracks_seekpoints[1].size() == 2 );
+    assert( restored._tracks_seekpoints[1][1].trust_level
+            == Seekpoint::QUESTIONABLE );
+    assert( restored._tracks_seekpoints[2][0].trust_level
+            == Seekpoint::DISABLED );
+
+    /* Nothing gathered */
+    SegmentSeeker empty;
+    std::vector<uint8_t> none;
+    empty.serialize( none );
+    assert( none.size() == 16 );
+    assert( empty.deserialize( none.data(), none.size() ) );
+    assert( IsEmpty( empty ) );
+}
+
+/* Damaged payloads are refused and leave the seeker untouched */
+static void test_damaged( std::vector<uint8_t> const& data )
+{
+    for( size_t size = 0; size < data.size(); size++ )
+    {
+        SegmentSeeker seeker;
+        assert( !seeker.deserialize( data.data(), size ) );
+        assert( IsEmpty( seeker ) );
+    }
+
+    std::vector<uint8_t> damaged( data );
+    damaged.push_back( 0 );
+    SegmentSeeker trailing;
+    assert( !trailing.deserialize( damaged.data(), damaged.size() ) );
+    assert( IsEmpty( trailing ) );
+
+    /* Unknown trust level of the last seekpoint */
+    damaged = data;
+    SetDWLE( &damaged[damaged.size() - 4], 1 );
+    SegmentSeeker trust;
+    assert( !trust.deserialize( damaged.data(), damaged.size() ) );
+    assert( IsEmpty( trust ) );
+
+    /* More searched ranges than the payload holds */
+    damaged = data;
+    SetDWLE( &damaged[0], UINT32_MAX );
+    SegmentSeeker count;
+    assert( !count.deserialize( damaged.data(), damaged.size() ) );
+    assert( IsEmpty( count ) );
+}
+
+/* The cached index is merged with what was found while opening */
+static void test_merge( std::vector<uint8_t> const& data )
+{
+    SegmentSeeker seeker;
+
+    seeker.mark_range_as_searched( Range( 5000, 7999 ) );
+    seeker.add_cluster_position( 500 );
+    seeker.add_seekpoint( 1, Seekpoint( 3000, VLC_TICK_FROM_MS(40) ) );
+    assert( seeker.deserialize( data.data(), data.size() ) );
+
+    assert( seeker._ranges_searched.size() == 1 );
+    assert( seeker._ranges_searched[0].start == 100 );
+    assert( seeker._ranges_searched[0].end == 9000 );
+
+    static const SegmentSeeker::fptr_t positions[] = {
+        100, 500, 3000, 8000, 12000,
+    };
+    assert( seeker._cluster_positions ==
+            SegmentSeeker::cluster_positions_t( positions, positions + 5 ) );
+
+    /* The better trusted seekpoint is kept */
+    assert( seeker._tracks_seekpoints[1].size() == 2 );
+    assert( seeker._tracks_seekpoints[1][1].trust_level
+            == Seekpoint::TRUSTED );
+    assert( seeker._tracks_seekpoints[2].size() == 1 );
+}
+
+int main()
+{
+    std::vector<uint8_t> data;
+
+    test_roundtrip( data );
+    test_damaged( data );
+    test_merge( data );
+    return 0;
+}
@@ -0,0 +1,425 @@
+/*****************************************************************************
+ * mp4.c: test the MP4 demux sample timing and seeking
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_demux.h>
+#include <vlc_es_out.h>
+#include <vlc_stream.h>
+
+#include "mp4_writer.h"
+
+#define MAX_SAMPLES 64
+
+struct track_desc
+{
+    uint32_t samples;
+    const uint32_t *stts; /* count, delta */
+    uint32_t stts_count;
+    const uint32_t *ctts; /* count, offset */
+    uint32_t ctts_count;
+    const uint32_t *stsc; /* first chunk, samples per chunk, description */
+    uint32_t stsc_count;
+    const uint32_t *stss; /* 1-based sample numbers */
+    uint32_t stss_count;
+};
+
+/* The timestamps of each sample, expanded from the run-length tables */
+struct reference
+{
+    vlc_tick_t dts[MAX_SAMPLES];
+    vlc_tick_t pts[MAX_SAMPLES];
+    bool sync[MAX_SAMPLES];
+    uint32_t duration;
+};
+
+static size_t SampleSize(uint32_t i)
+{
+    return 8 + (i * 7) % 23;
+}
+
+static void Expand(const struct track_desc *desc, struct reference *ref)
+{
+    uint32_t n = 0, dts = 0;
+
+    for (uint32_t i = 0; i < desc->stts_count; i++)
+        for (uint32_t j = 0; j < desc->stts[2 * i]; j++)
+        {
+            assert(n < desc->samples);
+            ref->dts[n] = VLC_TICK_0 + VLC_TICK_FROM_MS(dts);
+            /* Video without composition offsets has no known PTS */
+            ref->pts[n] = desc->ctts != NULL ? ref->dts[n] : VLC_TICK_INVALID;
+            ref->sync[n] = desc->stss == NULL;
+            dts += desc->stts[2 * i + 1];
+            n++;
+        }
+    assert(n == desc->samples);
+    ref->duration = dts;
+
+    n = 0;
+    for (uint32_t i = 0; i < desc->ctts_count; i++)
+        for (uint32_t j = 0; j < desc->ctts[2 * i]; j++)
+            ref->pts[n++] += VLC_TICK_FROM_MS(desc->ctts[2 * i + 1]);
+    assert(desc->ctts == NULL || n == desc->samples);
+
+    for (uint32_t i = 0; i < desc->stss_count; i++)
+        ref->sync[desc->stss[i] - 1] = true;
+}
+
+/* Returns the number of samples in each chunk, as described by stsc */
+static uint32_t Chunks(const struct track_desc *desc, uint32_t *chunks)
+{
+    uint32_t count = 0, n = 0;
+
+    for (uint32_t i = 0; n < desc->samples; i++)
+    {
+        const uint32_t *entry = &desc->stsc[3 * i];
+        const bool last = i + 1 == desc->stsc_count;
+
+        for (uint32_t chunk = entry[0];
+             n < desc->samples && (last || chunk < entry[3]); chunk++)
+        {
+            chunks[count++] = entry[1];
+            n += entry[1];
+        }
+    }
+    assert(n == desc->samples);
+    return count;
+}
+
+static void Build(struct mp4w *w, const struct track_desc *desc,
+                  const struct reference *ref)
+{
+    uint32_t chunks[MAX_SAMPLES], offsets[MAX_SAMPLES], sizes[MAX_SAMPLES];
+    const uint32_t chunk_count = Chunks(desc, chunks);
+
+    mp4w_Open(w, "ftyp");
+    mp4w_Bytes(w, "isom", 4);
+    mp4w_U32(w, 0x200);
+    mp4w_Bytes(w, "isommp41", 8);
+    mp4w_Close(w);
+
+    /* Each sample is filled with its own index */
+    mp4w_Open(w, "mdat");
+    for (uint32_t i = 0, n = 0; i < chunk_count; i++)
+    {
+        offsets[i] = w->size;
+        for (uint32_t j = 0; j < chunks[i]; j++, n++)
+        {
+            sizes[n] = SampleSize(n);
+            for (size_t k = 0; k < sizes[n]; k++)
+                mp4w_U8(w, n);
+        }
+    }
+    mp4w_Close(w);
+
+    mp4w_Open(w, "moov");
+    mp4w_OpenFull(w, "mvhd", 0, 0);
+    mp4w_Zero(w, 8);
+    mp4w_U32(w, 1000);
+    mp4w_U32(w, ref->duration);
+    mp4w_U32(w, 0x00010000);
+    mp4w_U16(w, 0x0100);
+    mp4w_Zero(w, 10 + 36 + 24);
+    mp4w_U32(w, 2);
+    mp4w_Close(w);
+
+    mp4w_Open(w, "trak");
+    mp4w_OpenFull(w, "tkhd", 0, 0x3);
+    mp4w_Zero(w, 8);
+    mp4w_U32(w, 1);
+    mp4w_Zero(w, 4);
+    mp4w_U32(w, ref->duration);
+    mp4w_Zero(w, 8 + 8 + 36);
+    mp4w_U32(w, 16 << 16);
+    mp4w_U32(w, 16 << 16);
+    mp4w_Close(w);
+
+    mp4w_Open(w, "mdia");
+    mp4w_OpenFull(w, "mdhd", 0, 0);
+    mp4w_Zero(w, 8);
+    mp4w_U32(w, 1000);
+    mp4w_U32(w, ref->duration);
+    mp4w_U16(w, 0x55c4); /* und */
+    mp4w_U16(w, 0);
+    mp4w_Close(w);
+
+    mp4w_OpenFull(w, "hdlr", 0, 0);
+    mp4w_Zero(w, 4);
+    mp4w_Bytes(w, "vide", 4);
+    mp4w_Zero(w, 12 + 1);
+    mp4w_Close(w);
+
+    mp4w_Open(w, "minf");
+    mp4w_OpenFull(w, "vmhd", 0, 1);
+    mp4w_Zero(w, 8);
+    mp4w_Close(w);
+    mp4w_Open(w, "dinf");
+    mp4w_OpenFull(w, "dref", 0, 0);
+    mp4w_U32(w, 1);
+    mp4w_OpenFull(w, "url ", 0, 1);
+    mp4w_Close(w);
+    mp4w_Close(w);
+    mp4w_Close(w);
+
+    mp4w_Open(w, "stbl");
+    mp4w_OpenFull(w, "stsd", 0, 0);
+    mp4w_U32(w, 1);
+    mp4w_Open(w, "test");
+    mp4w_Zero(w, 6);
+    mp4w_U16(w, 1);
+    mp4w_Zero(w, 16);
+    mp4w_U16(w, 16);
+    mp4w_U16(w, 16);
+    mp4w_U32(w, 0x00480000);
+    mp4w_U32(w, 0x00480000);
+    mp4w_Zero(w, 4);
+    mp4w_U16(w, 1);
+    mp4w_Zero(w, 32);
+    mp4w_U16(w, 0x18);
+    mp4w_U16(w, 0xffff);
+    mp4w_Close(w);
+    mp4w_Close(w);
+
+    mp4w_Table(w, "stts", desc->stts, desc->stts_count, 2);
+    if (desc->ctts != NULL)
+        mp4w_Table(w, "ctts", desc->ctts, desc->ctts_count, 2);
+    mp4w_Table(w, "stsc", desc->stsc, desc->stsc_count, 3);
+    mp4w_OpenFull(w, "stsz", 0, 0);
+    mp4w_U32(w, 0);
+    mp4w_U32(w, desc->samples);
+    for (uint32_t i = 0; i < desc->samples; i++)
+        mp4w_U32(w, sizes[i]);
+    mp4w_Close(w);
+    mp4w_Table(w, "stco", offsets, chunk_count, 1);
+    if (desc->stss != NULL)
+        mp4w_Table(w, "stss", desc->stss, desc->stss_count, 1);
+    mp4w_Close(w); /* stbl */
+
+    mp4w_Close(w); /* minf */
+    mp4w_Close(w); /* mdia */
+    mp4w_Close(w); /* trak */
+    mp4w_Close(w); /* moov */
+    assert(w->depth == 0);
+}
+
+struct capture
+{
+    es_out_t out;
+    es_out_id_t *id;
+    struct
+    {
+        uint32_t sample;
+        vlc_tick_t dts, pts;
+    } blocks[4 * MAX_SAMPLES];
+    unsigned count;
+};
+
+struct es_out_id_t
+{
+    int dummy;
+};
+
+static es_out_id_t *EsOutAdd(es_out_t *out, const es_format_t *fmt)
+{
+    struct capture *cap = container_of(out, struct capture, out);
+
+    assert(fmt->i_cat == VIDEO_ES);
+    assert(cap->id == NULL);
+    cap->id = malloc(sizeof (*cap->id));
+    assert(cap->id != NULL);
+    return cap->id;
+}
+
+static int EsOutSend(es_out_t *out, es_out_id_t *id, block_t *block)
+{
+    struct capture *cap = container_of(out, struct capture, out);
+
+    assert(id == cap->id);
+    assert(block->i_buffer > 0);
+    assert(cap->count < ARRAY_SIZE(cap->blocks));
+
+    /* The payload tells which sample was sent */
+    const uint32_t sample = block->p_buffer[0];
+    assert(block->i_buffer == SampleSize(sample));
+    for (size_t i = 0; i < block->i_buffer; i++)
+        assert(block->p_buffer[i] == sample);
+
+    cap->blocks[cap->count].sample = sample;
+    cap->blocks[cap->count].dts = block->i_dts;
+    cap->blocks[cap->count].pts = block->i_pts;
+    cap->count++;
+    block_Release(block);
+    return VLC_SUCCESS;
+}
+
+static void EsOutDel(es_out_t *out, es_out_id_t *id)
+{
+    struct capture *cap = container_of(out, struct capture, out);
+
+    assert(id == cap->id);
+    free(id);
+    cap->id = NULL;
+}
+
+static int EsOutControl(es_out_t *out, int query, va_list args)
+{
+    struct capture *cap = container_of(out, struct capture, out);
+
+    switch (query)
+    {
+        case ES_OUT_GET_ES_STATE:
+            assert(va_arg(args, es_out_id_t *) == cap->id);
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+        case ES_OUT_SET_ES:
+        case ES_OUT_SET_ES_DEFAULT:
+        case ES_OUT_SET_ES_STATE:
+        case ES_OUT_SET_ES_CAT_POLICY:
+        case ES_OUT_SET_GROUP:
+        case ES_OUT_SET_PCR:
+        case ES_OUT_SET_GROUP_PCR:
+        case ES_OUT_RESET_PCR:
+        case ES_OUT_SET_ES_FMT:
+        case ES_OUT_SET_NEXT_DISPLAY_TIME:
+        case ES_OUT_SET_GROUP_META:
+        case ES_OUT_SET_META:
+            return VLC_SUCCESS;
+        case ES_OUT_GET_EMPTY:
+            *va_arg(args, bool *) = true;
+            return VLC_SUCCESS;
+        default:
+            return VLC_EGENERIC;
+    }
+}
+
+static void EsOutDestroy(es_out_t *out)
+{
+    (void) out;
+}
+
+static const struct es_out_callbacks capture_cbs =
+{
+    .add = EsOutAdd,
+    .send = EsOutSend,
+    .del = EsOutDel,
+    .control = EsOutControl,
+    .destroy = EsOutDestroy,
+};
+
+/* Returns the sample a seek to the given time should resume from */
+static uint32_t SeekSample(const struct track_desc *desc,
+                           const struct reference *ref, vlc_tick_t time)
+{
+    uint32_t sample = 0;
+
+    while (sample + 1 < desc->samples
+        && ref->dts[sample + 1] - VLC_TICK_0 <= time)
+        sample++;
+    while (sample > 0 && !ref->sync[sample])
+        sample--;
+    return sample;
+}
+
+static void test_track(vlc_object_t *obj, const struct track_desc *desc)
+{
+    struct reference ref;
+    struct mp4w w;
+
+    Expand(desc, &ref);
+    mp4w_Init(&w);
+    Build(&w, desc, &ref);
+
+    stream_t *s = vlc_stream_MemoryNew(obj, w.buf, w.size, true);
+    assert(s != NULL);
+
+    struct capture cap = { .out = { .cbs = &capture_cbs } };
+    demux_t *demux = demux_New(VLC_OBJECT(s), "mp4", s, &cap.out);
+    assert(demux != NULL);
+    assert(cap.id != NULL);
+
+    /* Every sample, in order, with the timestamps of the tables */
+    while (demux_Demux(demux) == VLC_DEMUXER_SUCCESS)
+        ;
+    assert(cap.count == desc->samples);
+    for (uint32_t i = 0; i < desc->samples; i++)
+    {
+        assert(cap.blocks[i].sample == i);
+        assert(cap.blocks[i].dts == ref.dts[i]);
+        assert(cap.blocks[i].pts == ref.pts[i]);
+    }
+
+    /* Seeks land inside chunks and inside timing runs */
+    for (uint32_t ms = 0; ms < ref.duration; ms += 7)
+    {
+        const vlc_tick_t time = VLC_TICK_FROM_MS(ms);
+        const uint32_t sample = SeekSample(desc, &ref, time);
+
+        cap.count = 0;
+        assert(demux_Control(demux, DEMUX_SET_TIME, time, true)
+               == VLC_SUCCESS);
+        /* The last increment may end the stream */
+        while (demux_Demux(demux) == VLC_DEMUXER_SUCCESS && cap.count == 0)
+            ;
+        assert(cap.count > 0);
+
+        assert(cap.blocks[0].sample == sample);
+        assert(cap.blocks[0].dts == ref.dts[sample]);
+        assert(cap.blocks[0].pts == ref.pts[sample]);
+    }
+
+    demux_Delete(demux); /* and its stream */
+    mp4w_Clean(&w);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    /* 3 chunks of 3 samples, 2 of 5, then chunks of 2: the timing runs
+     * below all start or end in the middle of a chunk */
+    static const uint32_t stsc[] = { 1, 3, 1,   4, 5, 1,   6, 2, 1 };
+    static const uint32_t stts[] = { 4, 40,   9, 33,   1, 100,   23, 40 };
+    static const uint32_t ctts[] = { 2, 80,   5, 0,   3, 120,   27, 40 };
+    static const uint32_t stss[] = { 1, 12, 14, 25 };
+    static const uint32_t stts_single[] = { 37, 20 };
+    static const uint32_t stsc_single[] = { 1, 1, 1 };
+
+    const struct track_desc tracks[] = {
+        { 37, stts, 4, NULL, 0, stsc, 3, NULL, 0 },
+        { 37, stts, 4, ctts, 4, stsc, 3, NULL, 0 },
+        { 37, stts, 4, ctts, 4, stsc, 3, stss, 4 },
+        { 37, stts_single, 1, ctts, 4, stsc, 3, stss, 4 },
+        { 37, stts, 4, ctts, 4, stsc_single, 1, stss, 4 },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(tracks); i++)
+        test_track(VLC_OBJECT(vlc->p_libvlc_int), &tracks[i]);
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*****************************************************************************
+ * mp4_writer.h: build small ISOBMFF files in memory for the demux tests
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_TEST_MP4_WRITER_H
+#define VLC_TEST_MP4_WRITER_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MP4W_DEPTH 16
+
+struct mp4w
+{
+    uint8_t *buf;
+    size_t size;
+    size_t alloc;
+    size_t boxes[MP4W_DEPTH];
+    unsigned depth;
+};
+
+static inline void mp4w_Init(struct mp4w *w)
+{
+    w->buf = NULL;
+    w->size = w->alloc = 0;
+    w->depth = 0;
+}
+
+static inline void mp4w_Clean(struct mp4w *w)
+{
+    free(w->buf);
+}
+
+static inline void mp4w_Bytes(struct mp4w *w, const void *data, size_t size)
+{
+    if (w->size + size > w->alloc)
+    {
+        w->alloc = (w->size + size) * 2;
+        w->buf = realloc(w->buf, w->alloc);
+        assert(w->buf != NULL);
+    }
+    if (data != NULL)
+        memcpy(&w->buf[w->size], data, size);
+    else
+        memset(&w->buf[w->size], 0, size);
+    w->size += size;
+}
+
+static inline void mp4w_U8(struct mp4w *w, uint8_t v)
+{
+    mp4w_Bytes(w, &v, 1);
+}
+
+static inline void mp4w_U16(struct mp4w *w, uint16_t v)
+{
+    mp4w_U8(w, v >> 8);
+    mp4w_U8(w, v);
+}
+
+static inline void mp4w_U32(struct mp4w *w, uint32_t v)
+{
+    mp4w_U16(w, v >> 16);
+    mp4w_U16(w, v);
+}
+
+static inline void mp4w_Zero(struct mp4w *w, size_t size)
+{
+    mp4w_Bytes(w, NULL, size);
+}
+
+static inline void mp4w_Open(struct mp4w *w, const char type[4])
+{
+    assert(w->depth < MP4W_DEPTH);
+    w->boxes[w->depth++] = w->size;
+    mp4w_U32(w, 0);
+    mp4w_Bytes(w, type, 4);
+}
+
+static inline void mp4w_OpenFull(struct mp4w *w, const char type[4],
+                                 uint8_t version, uint32_t flags)
+{
+    mp4w_Open(w, type);
+    mp4w_U32(w, ((uint32_t)version << 24) | flags);
+}
+
+/* Closes the innermost open box and patches its size */
+static inline void mp4w_Close(struct mp4w *w)
+{
+    assert(w->depth > 0);
+    const size_t pos = w->boxes[--w->depth];
+    const uint32_t size = w->size - pos;
+
+    w->buf[pos] = size >> 24;
+    w->buf[pos + 1] = size >> 16;
+    w->buf[pos + 2] = size >> 8;
+    w->buf[pos + 3] = size;
+}
+
+/* Writes a full box whose payload is a count followed by as many entries of
+ * fields 32-bit fields */
+static inline void mp4w_Table(struct mp4w *w, const char type[4],
+                              const uint32_t *entries, uint32_t count,
+                              unsigned fields)
+{
+    mp4w_OpenFull(w, type, 0, 0);
+    mp4w_U32(w, count);
+    for (uint32_t i = 0; i < count * fields; i++)
+        mp4w_U32(w, entries[i]);
+    mp4w_Close(w);
+}
+
+#endif
@@ -0,0 +1,257 @@
+/*****************************************************************************
+ * oggseek.c: test the Ogg seek index serializer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#define MODULE_STRING "ogg"
+#include "../../../modules/demux/ogg.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include "../../../modules/demux/seekindex.h"
+
+#define MEDIA_SIZE (256 * 1024)
+
+static char cachedir[] = "/tmp/vlc-oggseek-XXXXXX";
+static uint8_t media[MEDIA_SIZE];
+
+struct entry
+{
+    unsigned stream;
+    vlc_tick_t time;
+    int64_t pagepos;
+};
+
+static const struct entry entries[] = {
+    { 0, VLC_TICK_FROM_SEC(1), 1000 },
+    { 0, VLC_TICK_FROM_SEC(2), 5000 },
+    { 0, VLC_TICK_FROM_SEC(3), 9000 },
+    { 1, VLC_TICK_FROM_SEC(1), 1500 },
+    { 1, VLC_TICK_FROM_SEC(9), 120000 },
+};
+
+/* A demuxer with two logical streams and an empty index */
+static demux_t *DemuxNew(vlc_object_t *obj)
+{
+    demux_t *demux = vlc_object_create(obj, sizeof (*demux));
+    assert(demux != NULL);
+
+    demux->s = vlc_stream_MemoryNew(obj, media, sizeof (media), true);
+    assert(demux->s != NULL);
+    demux->psz_filepath = NULL;
+    demux->b_preparsing = false;
+
+    demux_sys_t *sys = calloc(1, sizeof (*sys));
+    assert(sys != NULL);
+    sys->i_streams = 2;
+    sys->pp_stream = calloc(2, sizeof (*sys->pp_stream));
+    assert(sys->pp_stream != NULL);
+    for (int i = 0; i < 2; i++)
+    {
+        sys->pp_stream[i] = calloc(1, sizeof (**sys->pp_stream));
+        assert(sys->pp_stream[i] != NULL);
+        sys->pp_stream[i]->i_serial_no = 11 * (i + 1);
+        sys->pp_stream[i]->i_data_start = 100 * (i + 1);
+    }
+    sys->i_total_length = MEDIA_SIZE;
+    demux->p_sys = sys;
+    return demux;
+}
+
+static void DemuxDelete(demux_t *demux)
+{
+    demux_sys_t *sys = demux->p_sys;
+
+    for (int i = 0; i < sys->i_streams; i++)
+    {
+        oggseek_index_entries_free(sys->pp_stream[i]->idx);
+        free(sys->pp_stream[i]);
+    }
+    free(sys->pp_stream);
+    free(sys);
+    vlc_stream_Delete(demux->s);
+    vlc_object_delete(demux);
+}
+
+static unsigned CountIndex(demux_t *demux)
+{
+    demux_sys_t *sys = demux->p_sys;
+    unsigned count = 0;
+
+    for (int i = 0; i < sys->i_streams; i++)
+        for (const demux_index_entry_t *idx = sys->pp_stream[i]->idx;
+             idx != NULL; idx = idx->p_next)
+            count++;
+    return count;
+}
+
+static void CheckIndex(demux_t *demux)
+{
+    demux_sys_t *sys = demux->p_sys;
+    const demux_index_entry_t *idx[2] = {
+        sys->pp_stream[0]->idx, sys->pp_stream[1]->idx,
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(entries); i++)
+    {
+        const demux_index_entry_t *entry = idx[entries[i].stream];
+        assert(entry != NULL);
+        assert(entry->i_value == entries[i].time);
+        assert(entry->i_pagepos == entries[i].pagepos);
+        idx[entries[i].stream] = entry->p_next;
+    }
+    assert(idx[0] == NULL && idx[1] == NULL);
+}
+
+/* Stores a raw payload under the Ogg tag, and checks that it is refused
+ * without touching the index */
+static void Refused(demux_t *demux, const uint8_t *data, size_t size,
+                    uint32_t version)
+{
+    demux_sys_t *sys = demux->p_sys;
+
+    assert(demux_SeekIndexStore(demux, "ogg", version, data, size)
+           == VLC_SUCCESS);
+    assert(!Oggseek_LoadIndex(demux));
+    assert(sys->i_length == 0);
+    assert(CountIndex(demux) == 0);
+}
+
+static void test_oggseek(vlc_object_t *obj)
+{
+    demux_t *demux = DemuxNew(obj);
+    demux_sys_t *sys = demux->p_sys;
+
+    /* Nothing cached yet: the index is built and stored on close */
+    assert(!Oggseek_LoadIndex(demux));
+    assert(sys->b_seekindex && !sys->b_seekindex_dirty);
+
+    for (size_t i = 0; i < ARRAY_SIZE(entries); i++)
+        assert(OggSeek_IndexAdd(sys->pp_stream[entries[i].stream],
+                                entries[i].time, entries[i].pagepos) != NULL);
+    sys->i_length = 60;
+    sys->b_seekindex_dirty = true;
+    Oggseek_StoreIndex(demux);
+    DemuxDelete(demux);
+
+    /* Round trip */
+    demux = DemuxNew(obj);
+    sys = demux->p_sys;
+    assert(Oggseek_LoadIndex(demux));
+    assert(sys->i_length == 60);
+    CheckIndex(demux);
+
+    size_t size;
+    uint8_t *data = demux_SeekIndexLoad(demux, "ogg", OGGSEEK_INDEX_VERSION,
+                                        &size);
+    assert(data != NULL);
+    assert(size == 12 + 2 * 8 + ARRAY_SIZE(entries) * 16);
+    DemuxDelete(demux);
+
+    /* Positions out of the data of the stream or of the file, and entries
+     * of unknown streams are ignored */
+    demux = DemuxNew(obj);
+    sys = demux->p_sys;
+    sys->pp_stream[0]->i_data_start = 5000;
+    sys->pp_stream[1]->i_serial_no = 33;
+    sys->i_total_length = 9000;
+    assert(Oggseek_LoadIndex(demux));
+    assert(CountIndex(demux) == 1);
+    assert(sys->pp_stream[0]->idx->i_pagepos == 5000);
+    DemuxDelete(demux);
+
+    demux = DemuxNew(obj);
+    sys = demux->p_sys;
+
+    /* Truncated, or with trailing bytes */
+    Refused(demux, data, size - 1, OGGSEEK_INDEX_VERSION);
+    Refused(demux, data, 11, OGGSEEK_INDEX_VERSION);
+    uint8_t *longer = malloc(size + 1);
+    assert(longer != NULL);
+    memcpy(longer, data, size);
+    longer[size] = 0;
+    Refused(demux, longer, size + 1, OGGSEEK_INDEX_VERSION);
+
+    /* Stream and entry counts beyond the data */
+    memcpy(longer, data, size);
+    SetDWLE(longer + 8, 3);
+    Refused(demux, longer, size, OGGSEEK_INDEX_VERSION);
+    memcpy(longer, data, size);
+    SetDWLE(longer + 16, 4);
+    Refused(demux, longer, size, OGGSEEK_INDEX_VERSION);
+    memcpy(longer, data, size);
+    SetDWLE(longer + 16, UINT32_MAX);
+    Refused(demux, longer, size, OGGSEEK_INDEX_VERSION);
+
+    /* No length */
+    memcpy(longer, data, size);
+    SetQWLE(longer, 0);
+    assert(demux_SeekIndexStore(demux, "ogg", OGGSEEK_INDEX_VERSION,
+                                longer, size) == VLC_SUCCESS);
+    assert(!Oggseek_LoadIndex(demux));
+    assert(sys->i_length == 0);
+    free(longer);
+
+    /* Another layout */
+    DemuxDelete(demux);
+    demux = DemuxNew(obj);
+    Refused(demux, data, size, OGGSEEK_INDEX_VERSION + 1);
+    assert(demux_SeekIndexLoad(demux, "ogg", OGGSEEK_INDEX_VERSION,
+                               &size) == NULL);
+
+    /* Unchanged, nothing is written */
+    DemuxDelete(demux);
+    demux = DemuxNew(obj);
+    assert(!Oggseek_LoadIndex(demux));
+    Oggseek_StoreIndex(demux);
+    assert(demux_SeekIndexLoad(demux, "ogg", OGGSEEK_INDEX_VERSION,
+                               &size) == NULL);
+
+    free(data);
+    DemuxDelete(demux);
+}
+
+int main(void)
+{
+    test_init();
+
+    assert(mkdtemp(cachedir) != NULL);
+    setenv("XDG_CACHE_HOME", cachedir, 1);
+
+    for (size_t i = 0; i < sizeof (media); i++)
+        media[i] = i * 7;
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    test_oggseek(VLC_OBJECT(vlc->p_libvlc_int));
+
+    libvlc_release(vlc);
+
+    char path[sizeof (cachedir) + 16];
+    snprintf(path, sizeof (path), "%s/vlc/seekindex", cachedir);
+    rmdir(path);
+    snprintf(path, sizeof (path), "%s/vlc", cachedir);
+    rmdir(path);
+    rmdir(cachedir);
+    return 0;
+}
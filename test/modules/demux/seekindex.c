@@ -0,0 +1,464 @@
+/*****************************************************************************
+ * seekindex.c: test the persistent seek index cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+/* Small bounds to exercise the eviction */
+#define SEEKINDEX_CACHE_ENTRIES 4
+#define SEEKINDEX_CACHE_SIZE    (64 * 1024)
+#include "../../../modules/demux/seekindex.c"
+
+#define MODULE_STRING "avi"
+#include "../../../modules/demux/avi/avi.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <utime.h>
+
+#define MEDIA_SIZE (256 * 1024)
+
+static char cachedir[] = "/tmp/vlc-seekindex-XXXXXX";
+static char mediapath[sizeof (cachedir) + 16];
+static uint8_t media[MEDIA_SIZE];
+
+/* A demuxer of the media file, or of a copy of it in memory when remote */
+static demux_t *DemuxNew(vlc_object_t *obj, bool local)
+{
+    demux_t *demux = vlc_object_create(obj, sizeof (*demux));
+    assert(demux != NULL);
+
+    demux->s = vlc_stream_MemoryNew(obj, media, sizeof (media), true);
+    assert(demux->s != NULL);
+    demux->psz_filepath = local ? mediapath : NULL;
+    demux->b_preparsing = false;
+    return demux;
+}
+
+static void DemuxDelete(demux_t *demux)
+{
+    vlc_stream_Delete(demux->s);
+    vlc_object_delete(demux);
+}
+
+static void WriteMedia(void)
+{
+    FILE *file = fopen(mediapath, "wb");
+    assert(file != NULL);
+    assert(fwrite(media, sizeof (media), 1, file) == 1);
+    assert(fclose(file) == 0);
+}
+
+static unsigned CountEntries(void)
+{
+    char *dir = SeekIndexGetDir();
+    assert(dir != NULL);
+    DIR *handle = vlc_opendir(dir);
+    assert(handle != NULL);
+
+    unsigned count = 0;
+    const char *name;
+    while ((name = vlc_readdir(handle)) != NULL)
+        if (name[0] != '.')
+            count++;
+    closedir(handle);
+    free(dir);
+    return count;
+}
+
+static void ClearEntries(void)
+{
+    char *dir = SeekIndexGetDir();
+    assert(dir != NULL);
+    DIR *handle = vlc_opendir(dir);
+
+    if (handle != NULL)
+    {
+        const char *name;
+        while ((name = vlc_readdir(handle)) != NULL)
+        {
+            char *path;
+            if (name[0] == '.')
+                continue;
+            assert(asprintf(&path, "%s/%s", dir, name) != -1);
+            unlink(path);
+            free(path);
+        }
+        closedir(handle);
+    }
+    free(dir);
+}
+
+static void Fill(uint8_t *data, size_t size, unsigned seed)
+{
+    for (size_t i = 0; i < size; i++)
+        data[i] = (i * 31 + seed) >> 2;
+}
+
+/* Checks that the entry can be loaded, keeping the stream position */
+static bool Found(demux_t *demux, const char *tag, uint32_t version,
+                  size_t size, unsigned seed)
+{
+    uint8_t expected[size];
+    size_t loaded;
+
+    Fill(expected, size, seed);
+    assert(vlc_stream_Seek(demux->s, 1234) == VLC_SUCCESS);
+    uint8_t *data = demux_SeekIndexLoad(demux, tag, version, &loaded);
+    assert(vlc_stream_Tell(demux->s) == 1234);
+    if (data == NULL)
+        return false;
+    assert(loaded == size && !memcmp(data, expected, size));
+    free(data);
+    return true;
+}
+
+static void Store(demux_t *demux, const char *tag, uint32_t version,
+                  size_t size, unsigned seed)
+{
+    uint8_t *data = malloc(size);
+    assert(data != NULL);
+
+    Fill(data, size, seed);
+    assert(vlc_stream_Seek(demux->s, 4321) == VLC_SUCCESS);
+    assert(demux_SeekIndexStore(demux, tag, version, data, size)
+           == VLC_SUCCESS);
+    assert(vlc_stream_Tell(demux->s) == 4321);
+    free(data);
+}
+
+/* Rewrites a stored entry with one of its bytes changed, or truncated */
+static void Damage(demux_t *demux, const char *tag, long offset, int size)
+{
+    char *path = SeekIndexGetPath(demux, tag);
+    assert(path != NULL);
+
+    FILE *file = fopen(path, "r+b");
+    assert(file != NULL);
+    if (size >= 0)
+        assert(ftruncate(fileno(file), size) == 0);
+    else
+    {
+        assert(fseek(file, offset, SEEK_SET) == 0);
+        int c = fgetc(file);
+        assert(c != EOF);
+        assert(fseek(file, offset, SEEK_SET) == 0);
+        assert(fputc(c ^ 0x40, file) != EOF);
+    }
+    assert(fclose(file) == 0);
+    free(path);
+}
+
+static void test_roundtrip(vlc_object_t *obj, bool local)
+{
+    demux_t *demux = DemuxNew(obj, local);
+
+    Store(demux, "test", 1, 1000, 1);
+    assert(Found(demux, "test", 1, 1000, 1));
+    assert(!Found(demux, "other", 1, 1000, 1));
+    /* Replaced */
+    Store(demux, "test", 1, 10, 2);
+    assert(Found(demux, "test", 1, 10, 2));
+    Store(demux, "test", 1, 0, 0);
+    assert(Found(demux, "test", 1, 0, 0));
+
+    /* Another layout: the entry is dropped */
+    Store(demux, "test", 1, 1000, 1);
+    assert(!Found(demux, "test", 2, 1000, 1));
+    assert(!Found(demux, "test", 1, 1000, 1));
+
+    /* Truncated, in the header or in the data */
+    Store(demux, "test", 1, 1000, 1);
+    Damage(demux, "test", 0, SEEKINDEX_HEADER - 1);
+    assert(!Found(demux, "test", 1, 1000, 1));
+    Store(demux, "test", 1, 1000, 1);
+    Damage(demux, "test", 0, SEEKINDEX_HEADER + 999);
+    assert(!Found(demux, "test", 1, 1000, 1));
+
+    /* Corrupted data, checksum, size, format and magic */
+    static const long offsets[] = {
+        SEEKINDEX_HEADER + 500, 24, 16, 8, 0,
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(offsets); i++)
+    {
+        Store(demux, "test", 1, 1000, 1);
+        Damage(demux, "test", offsets[i], -1);
+        assert(!Found(demux, "test", 1, 1000, 1));
+    }
+    /* Invalid entries are removed */
+    assert(CountEntries() == 0);
+
+    /* Another file */
+    Store(demux, "test", 1, 1000, 1);
+    media[100] ^= 1;
+    assert(!Found(demux, "test", 1, 1000, 1));
+    media[100] ^= 1;
+    assert(Found(demux, "test", 1, 1000, 1));
+
+    /* Files are also identified by their last bytes */
+    media[MEDIA_SIZE - 1] ^= 1;
+    assert(!Found(demux, "test", 1, 1000, 1));
+    media[MEDIA_SIZE - 1] ^= 1;
+    assert(Found(demux, "test", 1, 1000, 1));
+
+    if (local)
+    {
+        /* Local files by their date */
+        struct utimbuf times = { .actime = 1000000, .modtime = 1000000 };
+        assert(utime(mediapath, &times) == 0);
+        assert(!Found(demux, "test", 1, 1000, 1));
+        Store(demux, "test", 1, 1000, 1);
+        assert(Found(demux, "test", 1, 1000, 1));
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+        /* Rewritten within the same second */
+        const struct timespec ts[2] = {
+            { .tv_sec = 1000000, .tv_nsec = 0 },
+            { .tv_sec = 1000000, .tv_nsec = 500000000 },
+        };
+        assert(utimensat(AT_FDCWD, mediapath, ts, 0) == 0);
+        assert(!Found(demux, "test", 1, 1000, 1));
+#endif
+    }
+
+    /* Nothing is hashed nor stored while preparsing */
+    demux->b_preparsing = true;
+    assert(!Found(demux, "test", 1, 1000, 1));
+    assert(demux_SeekIndexStore(demux, "test", 1, media, 10)
+           == VLC_EGENERIC);
+    demux->b_preparsing = false;
+
+    ClearEntries();
+    DemuxDelete(demux);
+}
+
+/* Stores an entry as if it was written at the given date */
+static void StoreAt(demux_t *demux, const char *tag, size_t size,
+                    unsigned seed, time_t date)
+{
+    Store(demux, tag, 1, size, seed);
+
+    char *path = SeekIndexGetPath(demux, tag);
+    assert(path != NULL);
+    struct utimbuf times = { .actime = date, .modtime = date };
+    assert(utime(path, &times) == 0);
+    free(path);
+}
+
+static void test_eviction(vlc_object_t *obj)
+{
+    demux_t *demux = DemuxNew(obj, true);
+    char tag[16];
+
+    for (unsigned i = 0; i < 6; i++)
+    {
+        snprintf(tag, sizeof (tag), "entry%u", i);
+        StoreAt(demux, tag, 100, i, 1000000 + i);
+        assert(CountEntries() == __MIN(i + 1, SEEKINDEX_CACHE_ENTRIES));
+    }
+
+    /* The oldest ones are evicted first */
+    for (unsigned i = 0; i < 6; i++)
+    {
+        snprintf(tag, sizeof (tag), "entry%u", i);
+        assert(Found(demux, tag, 1, 100, i) == (i >= 2));
+    }
+
+    /* Until the size fits too */
+    StoreAt(demux, "big0", 30000, 10, 2000000);
+    assert(CountEntries() == SEEKINDEX_CACHE_ENTRIES);
+    assert(!Found(demux, "entry2", 1, 100, 2));
+    StoreAt(demux, "big1", 30000, 11, 2000001);
+    assert(CountEntries() == SEEKINDEX_CACHE_ENTRIES);
+    assert(Found(demux, "big0", 1, 30000, 10));
+    StoreAt(demux, "big2", 30000, 12, 2000002);
+    assert(CountEntries() == 2);
+    assert(!Found(demux, "big0", 1, 30000, 10));
+    assert(Found(demux, "big1", 1, 30000, 11));
+    assert(Found(demux, "big2", 1, 30000, 12));
+
+    /* Too large entries are refused */
+    assert(demux_SeekIndexStore(demux, "huge", 1, media, SEEKINDEX_MAX + 1)
+           == VLC_EGENERIC);
+
+    ClearEntries();
+    DemuxDelete(demux);
+}
+
+/* The AVI index serializer */
+static void AviEntry(avi_entry_t *entry, unsigned track, unsigned i)
+{
+    entry->i_id = VLC_FOURCC('0', '0' + track, 'd', 'c');
+    entry->i_flags = (i % 12) ? 0 : AVIIF_KEYFRAME;
+    entry->i_pos = 1024 + 7919 * i + track * 13;
+    entry->i_length = 100 + i % 300;
+}
+
+static void test_avi(vlc_object_t *obj)
+{
+    static const unsigned counts[] = { 30, 0, 17 };
+    demux_t *demux = DemuxNew(obj, true);
+    demux_sys_t sys;
+    avi_track_t tracks[ARRAY_SIZE(counts)], *tks[ARRAY_SIZE(counts)];
+
+    memset(&sys, 0, sizeof (sys));
+    sys.i_track = ARRAY_SIZE(counts);
+    sys.track = tks;
+    demux->p_sys = &sys;
+
+    for (unsigned i = 0; i < sys.i_track; i++)
+    {
+        tks[i] = &tracks[i];
+        avi_index_Init(&tracks[i].idx);
+        for (unsigned j = 0; j < counts[i]; j++)
+        {
+            avi_entry_t entry;
+            AviEntry(&entry, i, j);
+            avi_index_Append(&tracks[i].idx, &sys.i_movi_lastchunk_pos,
+                             &entry);
+        }
+    }
+    const uint64_t last = sys.i_movi_lastchunk_pos;
+
+    AVI_IndexStoreCache(demux);
+
+    for (unsigned i = 0; i < sys.i_track; i++)
+    {
+        avi_index_Clean(&tracks[i].idx);
+        avi_index_Init(&tracks[i].idx);
+    }
+    sys.i_movi_lastchunk_pos = 0;
+
+    assert(AVI_IndexLoadCache(demux) == VLC_SUCCESS);
+    assert(sys.b_indexloaded);
+    assert(sys.i_movi_lastchunk_pos == last);
+    for (unsigned i = 0; i < sys.i_track; i++)
+    {
+        const avi_index_t *idx = &tracks[i].idx;
+        uint64_t total = 0;
+
+        assert(idx->i_size == counts[i]);
+        for (unsigned j = 0; j < counts[i]; j++)
+        {
+            avi_entry_t entry;
+            AviEntry(&entry, i, j);
+            assert(idx->p_entry[j].i_id == entry.i_id);
+            assert(idx->p_entry[j].i_flags == entry.i_flags);
+            assert(idx->p_entry[j].i_pos == entry.i_pos);
+            assert(idx->p_entry[j].i_length == entry.i_length);
+            assert(idx->p_entry[j].i_lengthtotal == total);
+            total += entry.i_length;
+        }
+    }
+
+    /* Serialized indexes not matching the file are refused, and leave the
+     * current index alone */
+    uint8_t buf[4 + 3 * 4 + 2 * AVI_INDEX_CACHE_ENTRY];
+    SetDWLE(&buf[0], 3);
+    SetDWLE(&buf[4], 2);
+    for (unsigned i = 0; i < 2; i++)
+    {
+        uint8_t *p = &buf[8 + i * AVI_INDEX_CACHE_ENTRY];
+        SetDWLE(&p[0], VLC_FOURCC('0', '0', 'd', 'c'));
+        SetDWLE(&p[4], AVIIF_KEYFRAME);
+        SetQWLE(&p[8], 1000 * (i + 1));
+        SetDWLE(&p[16], 10);
+    }
+    SetDWLE(&buf[8 + 2 * AVI_INDEX_CACHE_ENTRY], 0);
+    SetDWLE(&buf[12 + 2 * AVI_INDEX_CACHE_ENTRY], 0);
+
+    const struct
+    {
+        size_t size;
+        size_t offset; /* of the 32-bits value to change */
+        uint32_t value;
+    } bad[] = {
+        { sizeof (buf) - 1, 0, 3 },            /* truncated */
+        { sizeof (buf), 0, 2 },                /* track count */
+        { sizeof (buf), 4, 3 },                /* entry count */
+        { sizeof (buf), 20, 1 },               /* past the end of the file */
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(bad); i++)
+    {
+        uint8_t data[sizeof (buf)];
+
+        memcpy(data, buf, sizeof (buf));
+        SetDWLE(&data[bad[i].offset], bad[i].value);
+        assert(demux_SeekIndexStore(demux, "avi", AVI_INDEX_CACHE_VERSION,
+                                    data, bad[i].size) == VLC_SUCCESS);
+        sys.b_indexloaded = false;
+        assert(AVI_IndexLoadCache(demux) == VLC_EGENERIC);
+        assert(!sys.b_indexloaded);
+        assert(tracks[0].idx.i_size == counts[0]);
+        assert(sys.i_movi_lastchunk_pos == last);
+    }
+
+    /* The valid one is taken */
+    assert(demux_SeekIndexStore(demux, "avi", AVI_INDEX_CACHE_VERSION,
+                                buf, sizeof (buf)) == VLC_SUCCESS);
+    assert(AVI_IndexLoadCache(demux) == VLC_SUCCESS);
+    assert(tracks[0].idx.i_size == 2 && tracks[1].idx.i_size == 0);
+    assert(tracks[0].idx.p_entry[1].i_pos == 2000);
+
+    /* But not with another layout version */
+    assert(demux_SeekIndexStore(demux, "avi", AVI_INDEX_CACHE_VERSION + 1,
+                                buf, sizeof (buf)) == VLC_SUCCESS);
+    assert(AVI_IndexLoadCache(demux) == VLC_EGENERIC);
+
+    for (unsigned i = 0; i < sys.i_track; i++)
+        avi_index_Clean(&tracks[i].idx);
+    ClearEntries();
+    DemuxDelete(demux);
+}
+
+int main(void)
+{
+    test_init();
+
+    assert(mkdtemp(cachedir) != NULL);
+    snprintf(mediapath, sizeof (mediapath), "%s/media", cachedir);
+    setenv("XDG_CACHE_HOME", cachedir, 1);
+
+    Fill(media, sizeof (media), 0);
+    WriteMedia();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    test_roundtrip(VLC_OBJECT(vlc->p_libvlc_int), true);
+    test_roundtrip(VLC_OBJECT(vlc->p_libvlc_int), false);
+    test_eviction(VLC_OBJECT(vlc->p_libvlc_int));
+    test_avi(VLC_OBJECT(vlc->p_libvlc_int));
+
+    libvlc_release(vlc);
+
+    char *dir = SeekIndexGetDir();
+    rmdir(dir);
+    free(dir);
+    char path[sizeof (cachedir) + 16];
+    snprintf(path, sizeof (path), "%s/vlc", cachedir);
+    rmdir(path);
+    unlink(mediapath);
+    rmdir(cachedir);
+    return 0;
+}
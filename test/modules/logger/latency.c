@@ -0,0 +1,205 @@
+/*****************************************************************************
+ * latency.c: test the pipeline latency tracer
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#define MODULE_STRING "latency_tracer"
+#include "../../../modules/logger/latency.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include <vlc_tick.h>
+
+#define US(n) VLC_TICK_FROM_US(n)
+
+static const struct latency_edge *FindEdge(vlc_tracer_sys_t *sys, int id,
+                                           const char *from, const char *to)
+{
+    const struct latency_edge *edge;
+
+    vlc_vector_foreach(edge, &sys->edges)
+        if (edge->id == id && !strcmp(edge->from_type, from)
+         && !strcmp(edge->to_type, to))
+            return edge;
+    return NULL;
+}
+
+static void test_histogram(void)
+{
+    struct latency_edge edge;
+
+    memset(&edge, 0, sizeof (edge));
+
+    /* Bucket n holds [2^(n-1), 2^n[ us */
+    EdgeAdd(&edge, US(0));
+    EdgeAdd(&edge, US(1));
+    EdgeAdd(&edge, US(2));
+    EdgeAdd(&edge, US(3));
+    EdgeAdd(&edge, US(1000));
+    EdgeAdd(&edge, VLC_TICK_FROM_SEC(3600));
+    assert(edge.buckets[0] == 1);
+    assert(edge.buckets[1] == 1);
+    assert(edge.buckets[2] == 2);
+    assert(edge.buckets[10] == 1);
+    assert(edge.buckets[LATENCY_BUCKETS - 1] == 1);
+    assert(edge.count == 6);
+    assert(edge.max == VLC_TICK_FROM_SEC(3600));
+
+    memset(&edge, 0, sizeof (edge));
+    for (unsigned i = 0; i < 50; i++)
+        EdgeAdd(&edge, US(100));
+    for (unsigned i = 0; i < 40; i++)
+        EdgeAdd(&edge, US(1000));
+    for (unsigned i = 0; i < 10; i++)
+        EdgeAdd(&edge, US(5000));
+    assert(edge.sum == US(50 * 100 + 40 * 1000 + 10 * 5000));
+
+    /* Quantiles are reported as the upper bound of their bucket, but never
+     * above the maximum */
+    assert(EdgeQuantile(&edge, 50) == US(128));
+    assert(EdgeQuantile(&edge, 51) == US(1024));
+    assert(EdgeQuantile(&edge, 90) == US(1024));
+    assert(EdgeQuantile(&edge, 99) == US(5000));
+}
+
+static void test_trace(vlc_object_t *obj)
+{
+    void *opaque;
+    const struct vlc_tracer_operations *ops = Open(obj, &opaque);
+    assert(ops != NULL);
+
+    vlc_tracer_sys_t *sys = opaque;
+    const vlc_tick_t t0 = VLC_TICK_FROM_SEC(100);
+
+    /* Two frames of ES 1 in flight at once, and one of ES 2 with the same
+     * timestamp */
+    ops->trace(opaque, t0, "DEMUX", 1, "OUT", VLC_TICK_0);
+    ops->trace(opaque, t0 + US(10), "DEMUX", 1, "OUT", VLC_TICK_0 + US(40));
+    ops->trace(opaque, t0 + US(20), "DEMUX", 2, "OUT", VLC_TICK_0);
+    /* Second block of the same frame: ignored */
+    ops->trace(opaque, t0 + US(30), "DEMUX", 1, "OUT", VLC_TICK_0);
+    /* Undated: ignored */
+    ops->trace(opaque, t0 + US(40), "DEC", 1, "IN", VLC_TICK_INVALID);
+
+    ops->trace(opaque, t0 + US(1000), "DEC", 1, "IN", VLC_TICK_0);
+    ops->trace(opaque, t0 + US(1010), "DEC", 1, "IN", VLC_TICK_0 + US(40));
+    ops->trace(opaque, t0 + US(3000), "DEC", 2, "IN", VLC_TICK_0);
+    ops->trace(opaque, t0 + US(4000), "VOUT", 1, "DISPLAY", VLC_TICK_0);
+
+    assert(sys->edges.size == 3);
+
+    const struct latency_edge *edge = FindEdge(sys, 1, "DEMUX", "DEC");
+    assert(edge != NULL && edge->count == 2);
+    assert(edge->sum == US(1000) * 2 && edge->max == US(1000));
+    assert(edge->buckets[10] == 2);
+
+    edge = FindEdge(sys, 2, "DEMUX", "DEC");
+    assert(edge != NULL && edge->count == 1 && edge->sum == US(2980));
+
+    edge = FindEdge(sys, 1, "DEC", "VOUT");
+    assert(edge != NULL && edge->count == 1 && edge->sum == US(3000));
+    assert(edge->buckets[12] == 1);
+
+    /* Frames older than the pending ring are forgotten */
+    for (unsigned i = 0; i < LATENCY_PENDING; i++)
+        ops->trace(opaque, t0 + US(5000), "DEMUX", 3, "OUT",
+                   VLC_TICK_0 + US(i));
+    ops->trace(opaque, t0 + US(5000), "DEMUX", 3, "OUT",
+               VLC_TICK_0 + US(1000));
+    ops->trace(opaque, t0 + US(6000), "DEC", 3, "IN", VLC_TICK_0);
+    assert(FindEdge(sys, 3, "DEMUX", "DEC") == NULL);
+    /* The frame above took the slot of the next oldest one */
+    ops->trace(opaque, t0 + US(6000), "DEC", 3, "IN", VLC_TICK_0 + US(2));
+    edge = FindEdge(sys, 3, "DEMUX", "DEC");
+    assert(edge != NULL && edge->count == 1);
+
+    ops->destroy(opaque);
+}
+
+static void test_trace_file(vlc_object_t *obj)
+{
+    char path[] = "/tmp/vlc-latency-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    var_Create(obj, "latency-trace-file", VLC_VAR_STRING);
+    var_SetString(obj, "latency-trace-file", path);
+
+    void *opaque;
+    const struct vlc_tracer_operations *ops = Open(obj, &opaque);
+    assert(ops != NULL);
+    var_Destroy(obj, "latency-trace-file");
+
+    /* Enough events for the writer thread to flush a few batches */
+    const unsigned count = 3 * LATENCY_BATCH + 1;
+    const vlc_tick_t t0 = VLC_TICK_FROM_SEC(100);
+
+    for (unsigned i = 0; i < count; i++)
+    {
+        vlc_tick_t pts = VLC_TICK_0 + US(40 * i);
+
+        ops->trace(opaque, t0 + US(40 * i), "DEMUX", 0, "OUT", pts);
+        ops->trace(opaque, t0 + US(40 * i + 7), "DEC", 0, "IN", pts);
+    }
+    ops->destroy(opaque);
+
+    FILE *file = fopen(path, "rt");
+    assert(file != NULL);
+
+    char line[512];
+    unsigned events = 0;
+
+    assert(fgets(line, sizeof (line), file) != NULL);
+    assert(strstr(line, "traceEvents") != NULL);
+    while (fgets(line, sizeof (line), file) != NULL)
+    {
+        if (!strcmp(line, "]}\n"))
+            break;
+
+        char expected[256];
+        snprintf(expected, sizeof (expected),
+                 "{\"name\":\"DEMUX:OUT > DEC:IN\",\"cat\":\"DEC\","
+                 "\"ph\":\"X\",\"ts\":%u,\"dur\":7,\"pid\":1,\"tid\":0,"
+                 "\"args\":{\"pts\":%u}}", 40 * events, 40 * events + 1);
+        assert(!strncmp(line, expected, strlen(expected)));
+        events++;
+    }
+    assert(events == count);
+    fclose(file);
+    unlink(path);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    test_histogram();
+    test_trace(VLC_OBJECT(vlc->p_libvlc_int));
+    test_trace_file(VLC_OBJECT(vlc->p_libvlc_int));
+
+    libvlc_release(vlc);
+    return 0;
+}
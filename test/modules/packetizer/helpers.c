@@ -30,6 +30,12 @@
 #include <vlc_block_helper.h>
 
 #include "../modules/packetizer/startcode_helper.h"
+#include "../modules/packetizer/hxxx_ep3b.h"
+
+#define MODULE_STRING "hevc"
+#include "../modules/packetizer/hevc.c"
+
+const char vlc_module_name[] = MODULE_STRING;
 
 struct results_s
 {
@@ -77,21 +83,410 @@ static int run_annexb_sets( const uint8_t *p_set, const uint8_t *p_end,
         return i_ret;
 
     /* Perform same tests on simd optimized code */
-    if( startcode_FindAnnexB_Bits != startcode_FindAnnexB )
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE2() )
+    {
+        printf("checking sse2:\n");
+        i_ret = check_set( p_set, p_end, p_results, i_results, i_results_offset,
+                           startcode_FindAnnexB_SSE2 );
+        if( i_ret != 0 )
+            return i_ret;
+    }
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
     {
-        printf("checking asm:\n");
+        printf("checking avx2:\n");
         i_ret = check_set( p_set, p_end, p_results, i_results, i_results_offset,
-                           startcode_FindAnnexB );
+                           startcode_FindAnnexB_AVX2 );
         if( i_ret != 0 )
             return i_ret;
     }
-    else printf("asm not built in, skipping test:\n");
+#endif
+#ifdef STARTCODE_NEON
+    printf("checking neon:\n");
+    i_ret = check_set( p_set, p_end, p_results, i_results, i_results_offset,
+                       startcode_FindAnnexB_NEON );
+    if( i_ret != 0 )
+        return i_ret;
+#endif
+
+    printf("checking default:\n");
+    return check_set( p_set, p_end, p_results, i_results, i_results_offset,
+                      startcode_FindAnnexB );
+}
+
+typedef const uint8_t *(*startcode_find_t)(const uint8_t *, const uint8_t *);
+
+struct scanner_s
+{
+    const char *psz_name;
+    startcode_find_t pf_find;
+};
+
+/* Lists the startcode scanners usable on this CPU */
+static size_t get_scanners( struct scanner_s *p_scanners )
+{
+    size_t i = 0;
+
+    p_scanners[i++] = (struct scanner_s) { "bits", startcode_FindAnnexB_Bits };
+#if defined(CAN_COMPILE_SSE2) || defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_SSE2() )
+        p_scanners[i++] = (struct scanner_s) { "sse2", startcode_FindAnnexB_SSE2 };
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    if( vlc_CPU_AVX2() )
+        p_scanners[i++] = (struct scanner_s) { "avx2", startcode_FindAnnexB_AVX2 };
+#endif
+#ifdef STARTCODE_NEON
+    p_scanners[i++] = (struct scanner_s) { "neon", startcode_FindAnnexB_NEON };
+#endif
+    return i;
+}
+
+static const uint8_t * startcode_reference( const uint8_t *p, const uint8_t *end )
+{
+    for( ; end - p >= 3; p++ )
+        if( p[0] == 0 && p[1] == 0 && p[2] == 1 )
+            return p;
+    return NULL;
+}
+
+/* Checks every scanner against a byte per byte lookup, on sparse zero bytes
+ * and at every alignment, so that startcodes straddle vectors boundaries and
+ * the scalar tails are used */
+static int run_annexb_random( void )
+{
+    struct scanner_s scanners[4];
+    const size_t i_scanners = get_scanners( scanners );
+
+    uint8_t *p_data = malloc( 4096 );
+    if( !p_data )
+        return 0;
+
+    srand( 0 );
+    for( size_t i = 0; i < 4096; i++ )
+        p_data[i] = (rand() % 3) ? 0 : rand() % 3;
+
+    for( size_t i_offset = 0; i_offset < 64; i_offset++ )
+    {
+        for( size_t i_size = 0; i_size < 4096 - 64; i_size += 37 )
+        {
+            const uint8_t *p_start = &p_data[i_offset];
+            const uint8_t *p_end = p_start + i_size;
+
+            for( size_t j = 0; j < i_scanners; j++ )
+            {
+                const uint8_t *p_ref = p_start, *p = p_start;
+                do
+                {
+                    p_ref = startcode_reference( p_ref, p_end );
+                    p = scanners[j].pf_find( p, p_end );
+                    if( p != p_ref )
+                    {
+                        printf("%s mismatch at offset %zu size %zu\n",
+                               scanners[j].psz_name, i_offset, i_size);
+                        free( p_data );
+                        return 1;
+                    }
+                    if( p != NULL )
+                        p_ref = ++p;
+                } while( p != NULL );
+            }
+        }
+    }
+
+    free( p_data );
+    return 0;
+}
+
+/* Byte per byte emulation prevention removal, as mandated by the spec */
+static size_t ep3b_reference_size( const uint8_t *p, size_t i )
+{
+    size_t i_size = i;
+    for( size_t j = 3; j + 1 < i; j++ )
+    {
+        if( p[j - 2] == 0 && p[j - 1] == 0 && p[j] == 3 )
+            i_size--;
+    }
+    return i_size;
+}
+
+static int run_ep3b_sets( void )
+{
+    const uint8_t test_ep3b[] = { 0x42, 0, 0, 3, 1, /* stripped */
+                                  0, 0, 3, 0, 3, /* second one is payload */
+                                  0, 0, 3, 0, 0, 3, 0, /* both stripped */
+                                  3, 0, 0, 3, /* never the last byte */
+                                };
+    if( hxxx_ep3b_total_size( test_ep3b, test_ep3b + sizeof(test_ep3b) )
+        != sizeof(test_ep3b) - 4 )
+        return 1;
+
+    uint8_t *p_data = malloc( 4096 );
+    if( !p_data )
+        return 0;
+
+    /* Sparse zero bytes, so that sequences straddle vectors boundaries */
+    srand( 0 );
+    for( size_t i = 0; i < 4096; i++ )
+        p_data[i] = (rand() % 3) ? 0 : rand() % 4;
+
+    for( size_t i_offset = 0; i_offset < 64; i_offset++ )
+    {
+        for( size_t i_size = 0; i_size < 4096 - 64; i_size += 37 )
+        {
+            const uint8_t *p = &p_data[i_offset];
+            if( hxxx_ep3b_total_size( p, p + i_size )
+                != ep3b_reference_size( p, i_size ) )
+            {
+                printf("ep3b size mismatch at offset %zu size %zu\n",
+                       i_offset, i_size);
+                free( p_data );
+                return 1;
+            }
+
+            /* The bitstream reader must read exactly as many bytes */
+            struct hxxx_bsfw_ep3b_ctx_s bsctx;
+            hxxx_bsfw_ep3b_ctx_init( &bsctx );
+            bs_t bs;
+            bs_init_custom( &bs, p, i_size, &hxxx_bsfw_ep3b_callbacks, &bsctx );
+            size_t i_read = 0;
+            while( !bs_eof( &bs ) )
+            {
+                bs_skip( &bs, 8 );
+                i_read++;
+            }
+            if( i_read != ep3b_reference_size( p, i_size ) )
+            {
+                printf("ep3b read mismatch at offset %zu size %zu\n",
+                       i_offset, i_size);
+                free( p_data );
+                return 1;
+            }
+        }
+    }
+
+    free( p_data );
+    return 0;
+}
+
+/* Allocates a NAL unit filled with its tag, with the given room around */
+static block_t * nal_alloc( uint8_t i_tag, size_t i_size,
+                            size_t i_headroom, size_t i_tailroom )
+{
+    /* Not block_Alloc(), which pads on both sides */
+    const size_t i_alloc = i_headroom + i_size + i_tailroom;
+    block_t *p_nal = block_heap_Alloc( malloc( i_alloc ), i_alloc );
+    assert( p_nal );
+    p_nal->p_buffer += i_headroom;
+    p_nal->i_buffer = i_size;
+    memset( p_nal->p_buffer, i_tag, i_size );
+    p_nal->i_flags = i_tag;
+    p_nal->i_pts = VLC_TICK_0 + i_tag;
+    p_nal->i_dts = VLC_TICK_0 + i_tag / 2;
+    p_nal->i_length = i_tag;
+    return p_nal;
+}
+
+/* Checks the access unit is made of the given NAL units, in order */
+static int check_au( const block_t *p_au, const block_t *const *pp_nals,
+                     size_t i_nals )
+{
+    const uint8_t *p = p_au->p_buffer;
+    size_t i_size = 0;
+    vlc_tick_t i_length = 0;
+
+    if( p_au->p_next != NULL )
+        return 1;
+    for( size_t i = 0; i < i_nals; i++ )
+    {
+        const uint8_t i_tag = pp_nals[i]->p_buffer[0];
+        const size_t i_nal = pp_nals[i]->i_buffer;
+
+        if( i_size + i_nal > p_au->i_buffer )
+            return 1;
+        for( size_t j = 0; j < i_nal; j++ )
+            if( p[i_size + j] != i_tag )
+            {
+                printf("AU byte %zu is not from NAL %zu\n", i_size + j, i);
+                return 1;
+            }
+        i_size += i_nal;
+        i_length += i_tag;
+    }
+    if( i_size != p_au->i_buffer )
+        return 1;
 
+    /* Properties of the first NAL unit, summed lengths */
+    const uint8_t i_first = pp_nals[0]->p_buffer[0];
+    if( p_au->i_flags != i_first || p_au->i_pts != VLC_TICK_0 + i_first ||
+        p_au->i_dts != VLC_TICK_0 + i_first / 2 || p_au->i_length != i_length )
+        return 1;
     return 0;
 }
 
-int main( void )
+static int run_gather_au( size_t i_room )
+{
+    block_t *p_aud = nal_alloc( 0x01, 6, 0, 0 );
+    block_t *p_vps = nal_alloc( 0x02, 10, 0, 0 );
+    block_t *p_sps = nal_alloc( 0x03, 20, 0, 0 );
+    block_t *p_sei = nal_alloc( 0x04, 7, 0, 0 );
+    block_t *p_slice1 = nal_alloc( 0x05, 100, i_room, i_room );
+    block_t *p_slice2 = nal_alloc( 0x06, 50, 0, 0 );
+    const block_t *nals[] = { p_aud, p_vps, p_sps, p_sei, p_slice1, p_slice2 };
+    const block_t *xps[] = { p_vps, p_sps };
+
+    /* Keep copies of the consumed NAL units to check the result */
+    block_t *copies[ARRAY_SIZE(nals)];
+    for( size_t i = 0; i < ARRAY_SIZE(nals); i++ )
+    {
+        copies[i] = block_Duplicate( (block_t *) nals[i] );
+        assert( copies[i] );
+    }
+
+    p_aud->p_next = NULL;
+    p_sei->p_next = p_slice1;
+    p_slice1->p_next = p_slice2;
+
+    /* The largest NAL unit, in the tail, is grown if it has enough room */
+    block_t *p_au = hxxx_GatherAU( p_aud, xps, 2, p_sei );
+    int i_ret = check_au( p_au, (const block_t **) copies, ARRAY_SIZE(nals) );
+    if( i_ret == 0 && (p_au == p_slice1) != (i_room >= 6 + 10 + 20 + 7 + 50) )
+    {
+        printf("anchor %s in place\n", p_au == p_slice1 ? "grown" : "not grown");
+        i_ret = 1;
+    }
+    block_Release( p_au );
+    if( i_ret != 0 )
+        goto end;
+
+    /* Parameter sets are only copied */
+    if( p_vps->i_buffer != 10 || p_vps->p_buffer[9] != 0x02 ||
+        p_sps->i_buffer != 20 || p_sps->p_buffer[19] != 0x03 )
+    {
+        i_ret = 1;
+        goto end;
+    }
+
+    /* The largest NAL unit is in the head */
+    p_aud = nal_alloc( 0x01, 6, 0, 0 );
+    p_slice1 = nal_alloc( 0x05, 100, i_room, i_room );
+    p_slice2 = nal_alloc( 0x06, 50, 0, 0 );
+    p_aud->p_next = p_slice1;
+    p_slice1->p_next = p_slice2;
+    const block_t *nals2[] = { copies[0], copies[4], copies[5], copies[1] };
+    p_au = hxxx_GatherAU( p_aud, xps, 1, NULL );
+    i_ret = check_au( p_au, nals2, ARRAY_SIZE(nals2) );
+    if( i_ret == 0 && (p_au == p_slice1) != (i_room >= 10 + 50) )
+        i_ret = 1;
+    block_Release( p_au );
+    if( i_ret != 0 )
+        goto end;
+
+    /* Without head, the first NAL unit is the first parameter set */
+    p_slice1 = nal_alloc( 0x05, 100, i_room, i_room );
+    const block_t *nals3[] = { copies[1], copies[2], copies[4] };
+    p_au = hxxx_GatherAU( NULL, xps, 2, p_slice1 );
+    i_ret = check_au( p_au, nals3, ARRAY_SIZE(nals3) );
+    block_Release( p_au );
+    if( i_ret != 0 )
+        goto end;
+
+    /* Only parameter sets */
+    p_au = hxxx_GatherAU( NULL, xps, 2, NULL );
+    i_ret = check_au( p_au, nals3, 2 );
+    block_Release( p_au );
+
+end:
+    block_Release( p_vps );
+    block_Release( p_sps );
+    for( size_t i = 0; i < ARRAY_SIZE(copies); i++ )
+        block_Release( copies[i] );
+    return i_ret;
+}
+
+static int run_hevc_xps( void )
 {
+    decoder_sys_t *p_sys = calloc( 1, sizeof(*p_sys) );
+    if( !p_sys )
+        return 0;
+
+    /* Sets stored at the first and last IDs */
+    block_t *p_vps = nal_alloc( 0x01, 1, 0, 0 );
+    block_t *p_sps0 = nal_alloc( 0x02, 1, 0, 0 );
+    block_t *p_sps = nal_alloc( 0x03, 1, 0, 0 );
+    block_t *p_pps = nal_alloc( 0x04, 1, 0, 0 );
+    p_sys->rg_vps[HEVC_VPS_ID_MAX].p_nal = p_vps;
+    p_sys->rg_sps[0].p_nal = p_sps0;
+    p_sys->rg_sps[HEVC_SPS_ID_MAX].p_nal = p_sps;
+    p_sys->rg_pps[HEVC_PPS_ID_MAX].p_nal = p_pps;
+
+    const block_t *xps[HEVC_VPS_ID_MAX + 1 + HEVC_SPS_ID_MAX + 1 +
+                       HEVC_PPS_ID_MAX + 1];
+    const size_t i_xps = GetXPS( p_sys, xps );
+    int i_ret = i_xps != 4 || xps[0] != p_vps || xps[1] != p_sps0 ||
+                xps[2] != p_sps || xps[3] != p_pps;
+
+    block_Release( p_vps );
+    block_Release( p_sps0 );
+    block_Release( p_sps );
+    block_Release( p_pps );
+    free( p_sys );
+    return i_ret;
+}
+
+/* Usage: test_modules_packetizer_helpers bench [MiB]
+ * Reports the throughput of every startcode scanner and of the RBSP size
+ * computation over a buffer with a startcode and an emulation prevention
+ * sequence every 64 KiB, as in the slices of large pictures. */
+static void bench( size_t i_mib )
+{
+    const size_t i_size = i_mib << 20;
+    uint8_t *p_data = malloc( i_size );
+    if( !p_data )
+        return;
+
+    srand( 0 );
+    for( size_t i = 0; i < i_size; i++ )
+        p_data[i] = 1 + rand() % 255;
+    for( size_t i = 0; i + 8 < i_size; i += 65536 )
+        memcpy( &p_data[i], (const uint8_t[]) { 0, 0, 1, 0x42, 0, 0, 3, 1 }, 8 );
+
+    struct scanner_s scanners[4];
+    const size_t i_scanners = get_scanners( scanners );
+    const uint8_t *p_end = p_data + i_size;
+
+    for( size_t j = 0; j < i_scanners; j++ )
+    {
+        unsigned i_found = 0;
+        vlc_tick_t start = vlc_tick_now();
+        for( const uint8_t *p = scanners[j].pf_find( p_data, p_end ); p != NULL;
+             p = scanners[j].pf_find( p + 3, p_end ) )
+            i_found++;
+        const vlc_tick_t elapsed = vlc_tick_now() - start;
+
+        printf("startcode %s: %u found, %"PRId64" MB/s\n", scanners[j].psz_name,
+               i_found, (int64_t) i_size / __MAX(US_FROM_VLC_TICK(elapsed), 1));
+    }
+
+    vlc_tick_t start = vlc_tick_now();
+    const size_t i_rbsp = hxxx_ep3b_total_size( p_data, p_end );
+    const vlc_tick_t elapsed = vlc_tick_now() - start;
+    printf("RBSP size: %zu bytes, %"PRId64" MB/s\n", i_rbsp,
+           (int64_t) i_size / __MAX(US_FROM_VLC_TICK(elapsed), 1));
+
+    free( p_data );
+}
+
+int main( int argc, char *argv[] )
+{
+    if( argc > 1 && !strcmp( argv[1], "bench" ) )
+    {
+        bench( argc > 2 ? strtoul( argv[2], NULL, 0 ) : 64 );
+        return 0;
+    }
+
     const uint8_t test1_annexbdata[] = { 0, 0, 0, 1, 0x55, 0x55, 0x55, 0x55, 0x55, // 9
                                          0, 0, 1, 0x22, 0x22, //14
                                          0, 0, 1, 0x0, 0x0, //19
@@ -134,5 +529,23 @@ int main( void )
             return i_ret;
     }
 
-    return 0;
+    printf("* Running random startcode tests:\n");
+    i_ret = run_annexb_random();
+    if( i_ret != 0 )
+        return i_ret;
+
+    printf("* Running emulation prevention tests:\n");
+    i_ret = run_ep3b_sets();
+    if( i_ret != 0 )
+        return i_ret;
+
+    printf("* Running access unit gathering tests:\n");
+    i_ret = run_gather_au( 0 );
+    if( i_ret == 0 )
+        i_ret = run_gather_au( 256 );
+    if( i_ret != 0 )
+        return i_ret;
+
+    printf("* Running HEVC parameter sets tests:\n");
+    return run_hevc_xps();
 }
@@ -0,0 +1,317 @@
+/*****************************************************************************
+ * glyph_cache.c: test the freetype glyph and shaped run cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#define MODULE_STRING "freetype"
+#include "../../../modules/text_renderer/freetype/glyph_cache.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include FT_OUTLINE_H
+
+static FT_Library library;
+
+/* Faces are only compared by the cache */
+static int faces[2];
+#define FACE(n) ((FT_Face)&faces[n])
+
+/* A quad with corners off the pixel grid, so that its rendering depends on
+ * the subpixel position */
+static FT_Glyph NewGlyph(FT_Pos size)
+{
+    FT_Glyph glyph;
+    assert(FT_New_Glyph(library, FT_GLYPH_FORMAT_OUTLINE, &glyph) == 0);
+
+    FT_Outline *outline = &((FT_OutlineGlyph)glyph)->outline;
+    assert(FT_Outline_New(library, 4, 1, outline) == 0);
+
+    static const FT_Vector corners[4] = {
+        { 10, 5 }, { 10, 0 }, { 0, 0 }, { 0, 5 },
+    };
+    for (int i = 0; i < 4; i++)
+    {
+        outline->points[i].x = corners[i].x * size / 10 + 7;
+        outline->points[i].y = corners[i].y * size / 10 + 21;
+        outline->tags[i] = FT_CURVE_TAG_ON;
+    }
+    outline->contours[0] = 3;
+    return glyph;
+}
+
+static bool SameBitmap(FT_Glyph a, FT_Glyph b)
+{
+    const FT_BitmapGlyph ba = (FT_BitmapGlyph)a, bb = (FT_BitmapGlyph)b;
+
+    assert(a->format == FT_GLYPH_FORMAT_BITMAP);
+    assert(b->format == FT_GLYPH_FORMAT_BITMAP);
+    if (ba->left != bb->left || ba->top != bb->top
+     || ba->bitmap.rows != bb->bitmap.rows
+     || ba->bitmap.width != bb->bitmap.width)
+        return false;
+
+    for (unsigned y = 0; y < ba->bitmap.rows; y++)
+        if (memcmp(ba->bitmap.buffer + y * ba->bitmap.pitch,
+                   bb->bitmap.buffer + y * bb->bitmap.pitch,
+                   ba->bitmap.width))
+            return false;
+    return true;
+}
+
+static unsigned CountBitmaps(const glyph_cache_entry_t *entry)
+{
+    unsigned count = 0;
+    for (const glyph_bitmap_t *b = entry->p_bitmaps; b != NULL; b = b->p_next)
+        count++;
+    return count;
+}
+
+static void test_keys(void)
+{
+    glyph_cache_t *cache = GlyphCacheNew(SIZE_MAX);
+    assert(cache != NULL);
+
+    static const glyph_cache_key_t keys[] = {
+        { FACE(0), 36, 0, 0 },
+        { FACE(1), 36, 0, 0 },
+        { FACE(0), 37, 0, 0 },
+        { FACE(0), 36, GLYPH_CACHE_BOLD, 0 },
+        { FACE(0), 36, GLYPH_CACHE_ITALIC, 0 },
+        { FACE(0), 36, 0, 64 },
+    };
+    glyph_cache_entry_t *entries[ARRAY_SIZE(keys)];
+    FT_Glyph glyph, outline;
+    FT_Vector advance;
+
+    /* Every field of the key tells the glyphs apart */
+    for (size_t i = 0; i < ARRAY_SIZE(keys); i++)
+    {
+        assert(GlyphCacheGet(cache, &keys[i], &glyph, &outline,
+                             &advance) == NULL);
+
+        FT_Glyph src = NewGlyph(64 * (i + 1));
+        FT_Glyph src_outline = keys[i].i_radius ? NewGlyph(64 * 20) : NULL;
+        const FT_Vector src_advance = { 64 * (i + 1), 0 };
+
+        entries[i] = GlyphCacheAdd(cache, &keys[i], src, src_outline,
+                                   &src_advance);
+        assert(entries[i] != NULL);
+        /* The cache keeps its own copies */
+        FT_Done_Glyph(src);
+        if (src_outline)
+            FT_Done_Glyph(src_outline);
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(keys); i++)
+    {
+        assert(GlyphCacheGet(cache, &keys[i], &glyph, &outline,
+                             &advance) == entries[i]);
+        assert(glyph != entries[i]->p_glyph);
+        assert(advance.x == (FT_Pos)(64 * (i + 1)) && advance.y == 0);
+
+        FT_BBox bbox;
+        FT_Glyph_Get_CBox(glyph, FT_GLYPH_BBOX_UNSCALED, &bbox);
+        assert(bbox.xMax - bbox.xMin == (FT_Pos)(64 * (i + 1)));
+        FT_Done_Glyph(glyph);
+
+        assert((outline != NULL) == (keys[i].i_radius != 0));
+        if (outline)
+        {
+            assert(outline != entries[i]->p_outline);
+            FT_Done_Glyph(outline);
+        }
+    }
+
+    /* Runs are told apart by the face, script, direction and text */
+    static const uni_char_t text[] = { 'a', 'b', 'c' };
+    static const uni_char_t other[] = { 'a', 'b', 'd' };
+    static const shaped_glyph_t shaped[] = {
+        { 1, 0, 0, 0, 640, 0 },
+        { 2, 1, 0, 0, 704, 0 },
+    };
+    unsigned count;
+
+    const shaped_glyph_t *run = GlyphCacheAddRun(cache, FACE(0), 1, 0, text,
+                                                 3, shaped, 2);
+    assert(run != NULL && run != shaped);
+    assert(!memcmp(run, shaped, sizeof (shaped)));
+    assert(GlyphCacheGetRun(cache, FACE(0), 1, 0, text, 3, &count) == run);
+    assert(count == 2);
+    assert(GlyphCacheGetRun(cache, FACE(1), 1, 0, text, 3, &count) == NULL);
+    assert(GlyphCacheGetRun(cache, FACE(0), 2, 0, text, 3, &count) == NULL);
+    assert(GlyphCacheGetRun(cache, FACE(0), 1, 1, text, 3, &count) == NULL);
+    assert(GlyphCacheGetRun(cache, FACE(0), 1, 0, text, 2, &count) == NULL);
+    assert(GlyphCacheGetRun(cache, FACE(0), 1, 0, other, 3, &count) == NULL);
+
+    GlyphCacheDelete(cache);
+}
+
+static void test_eviction(void)
+{
+    glyph_cache_t *cache = GlyphCacheNew(SIZE_MAX);
+    assert(cache != NULL);
+
+    glyph_cache_key_t keys[4];
+    FT_Glyph src = NewGlyph(640);
+    const FT_Vector advance = { 640, 0 };
+
+    for (unsigned i = 0; i < ARRAY_SIZE(keys); i++)
+    {
+        keys[i] = (glyph_cache_key_t) { FACE(0), i, 0, 0 };
+        assert(GlyphCacheAdd(cache, &keys[i], src, NULL, &advance) != NULL);
+    }
+    FT_Done_Glyph(src);
+
+    const size_t entry_size = cache->i_size / ARRAY_SIZE(keys);
+    assert(cache->i_size == entry_size * ARRAY_SIZE(keys));
+
+    /* Nothing is evicted while the cache fits */
+    cache->i_max_size = cache->i_size;
+    GlyphCacheTrim(cache);
+    assert(cache->i_size == entry_size * ARRAY_SIZE(keys));
+
+    /* Looking an entry up makes it the most recently used */
+    FT_Glyph glyph, outline;
+    FT_Vector adv;
+    assert(GlyphCacheGet(cache, &keys[0], &glyph, &outline, &adv) != NULL);
+    FT_Done_Glyph(glyph);
+
+    /* The least recently used entries are evicted first */
+    cache->i_max_size = entry_size * 2;
+    GlyphCacheTrim(cache);
+    assert(cache->i_size == entry_size * 2);
+    assert(GlyphCacheGet(cache, &keys[1], &glyph, &outline, &adv) == NULL);
+    assert(GlyphCacheGet(cache, &keys[2], &glyph, &outline, &adv) == NULL);
+
+    /* Rendered bitmaps are accounted to their entry */
+    glyph_cache_entry_t *entry =
+        GlyphCacheGet(cache, &keys[3], &glyph, &outline, &adv);
+    assert(entry != NULL);
+    const FT_Vector origin = { 0, 0 };
+    assert(GlyphCacheToBitmap(cache, entry, false, &glyph, &origin,
+                              true) == 0);
+    FT_Done_Glyph(glyph);
+    assert(cache->i_size > entry_size * 2);
+    assert(entry->node.i_size == cache->i_size - entry_size);
+
+    /* Which now outweighs the others */
+    cache->i_max_size = entry->node.i_size;
+    GlyphCacheTrim(cache);
+    assert(cache->i_size == entry->node.i_size);
+    assert(GlyphCacheGet(cache, &keys[0], &glyph, &outline, &adv) == NULL);
+    assert(GlyphCacheGet(cache, &keys[3], &glyph, &outline, &adv) == entry);
+    FT_Done_Glyph(glyph);
+
+    cache->i_max_size = 0;
+    GlyphCacheTrim(cache);
+    assert(cache->i_size == 0);
+    assert(vlc_list_is_empty(&cache->lru));
+
+    GlyphCacheDelete(cache);
+}
+
+/* Renders as FreeType would, and through the cache */
+static void CheckBitmap(glyph_cache_t *cache, glyph_cache_entry_t *entry,
+                        bool b_outline, FT_Pos x, FT_Pos y)
+{
+    const FT_Vector origin = { x, y };
+    FT_Glyph source = b_outline ? entry->p_outline : entry->p_glyph;
+    FT_Glyph expected, glyph;
+
+    assert(FT_Glyph_Copy(source, &expected) == 0);
+    assert(FT_Glyph_To_Bitmap(&expected, FT_RENDER_MODE_NORMAL,
+                              (FT_Vector *)&origin, true) == 0);
+
+    assert(FT_Glyph_Copy(source, &glyph) == 0);
+    assert(GlyphCacheToBitmap(cache, entry, b_outline, &glyph, &origin,
+                              true) == 0);
+    assert(SameBitmap(glyph, expected));
+
+    FT_Done_Glyph(glyph);
+    FT_Done_Glyph(expected);
+}
+
+static void test_shift(void)
+{
+    glyph_cache_t *cache = GlyphCacheNew(SIZE_MAX);
+    assert(cache != NULL);
+
+    const glyph_cache_key_t key = { FACE(0), 1, 0, 64 };
+    FT_Glyph src = NewGlyph(64 * 12), src_outline = NewGlyph(64 * 14);
+    const FT_Vector advance = { 64 * 12, 0 };
+
+    glyph_cache_entry_t *entry = GlyphCacheAdd(cache, &key, src, src_outline,
+                                               &advance);
+    assert(entry != NULL);
+    FT_Done_Glyph(src);
+    FT_Done_Glyph(src_outline);
+
+    /* The first position of a phase renders it */
+    CheckBitmap(cache, entry, false, 64 * 3 + 16, 64 * 7 + 40);
+    assert(CountBitmaps(entry) == 1);
+    const size_t size = cache->i_size;
+
+    /* Other whole pixel positions of the phase shift the same bitmap, on
+     * both sides of the origin */
+    static const FT_Pos shifts[][2] = {
+        { 0, 0 }, { 64 * 100, -64 * 3 }, { -64 * 5, 64 * 2 },
+        { -64 * 4, -64 * 9 },
+    };
+    for (size_t i = 0; i < ARRAY_SIZE(shifts); i++)
+        CheckBitmap(cache, entry, false, shifts[i][0] + 16,
+                    shifts[i][1] + 40);
+    assert(CountBitmaps(entry) == 1);
+    assert(cache->i_size == size);
+
+    /* Each phase, of the glyph or of its outline, has its own bitmap */
+    CheckBitmap(cache, entry, false, 64 * 3 + 17, 64 * 7 + 40);
+    CheckBitmap(cache, entry, false, 64 * 3 + 16, 64 * 7 + 41);
+    CheckBitmap(cache, entry, false, -64 * 3 + 16, -64 * 7 + 41);
+    CheckBitmap(cache, entry, true, 64 * 3 + 16, 64 * 7 + 40);
+    CheckBitmap(cache, entry, true, -64 * 2 + 16, 64 * 7 + 40);
+    assert(CountBitmaps(entry) == 4);
+    assert(cache->i_size > size);
+
+    /* Without an entry, the glyph is rendered as is */
+    FT_Glyph glyph;
+    const FT_Vector origin = { 64 + 16, 40 };
+    assert(FT_Glyph_Copy(entry->p_glyph, &glyph) == 0);
+    assert(GlyphCacheToBitmap(cache, NULL, false, &glyph, &origin,
+                              true) == 0);
+    assert(glyph->format == FT_GLYPH_FORMAT_BITMAP);
+    FT_Done_Glyph(glyph);
+    assert(CountBitmaps(entry) == 4);
+
+    GlyphCacheDelete(cache);
+}
+
+int main(void)
+{
+    test_init();
+
+    assert(FT_Init_FreeType(&library) == 0);
+
+    test_keys();
+    test_eviction();
+    test_shift();
+
+    FT_Done_FreeType(library);
+    return 0;
+}
@@ -0,0 +1,301 @@
+/*****************************************************************************
+ * hqdn3d.c: test the high quality 3D denoiser
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#define MODULE_STRING "hqdn3d"
+#include "../../../modules/video_filter/hqdn3d.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include <vlc_tick.h>
+
+/* The single pass denoiser from MPlayer, as the filter used it formerly,
+ * but for the first row of the spatial only denoiser, which filtered each
+ * pixel against the first one rather than the previous one */
+static void FormerTemporal(unsigned char *Frame, unsigned char *FrameDest,
+                           unsigned short *FrameAnt, int W, int H,
+                           int sStride, int dStride, int *Temporal)
+{
+    unsigned int PixelDst;
+
+    for (long Y = 0; Y < H; Y++){
+        for (long X = 0; X < W; X++){
+            PixelDst = LowPassMul(FrameAnt[X]<<8, Frame[X]<<16, Temporal);
+            FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+            FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+        }
+        Frame += sStride;
+        FrameDest += dStride;
+        FrameAnt += W;
+    }
+}
+
+static void FormerSpacial(unsigned char *Frame, unsigned char *FrameDest,
+                          unsigned int *LineAnt, int W, int H,
+                          int sStride, int dStride,
+                          int *Horizontal, int *Vertical)
+{
+    long sLineOffs = 0, dLineOffs = 0;
+    unsigned int PixelAnt;
+    unsigned int PixelDst;
+
+    PixelDst = LineAnt[0] = PixelAnt = Frame[0]<<16;
+    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+
+    for (long X = 1; X < W; X++){
+        PixelDst = LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    }
+
+    for (long Y = 1; Y < H; Y++){
+        sLineOffs += sStride, dLineOffs += dStride;
+        PixelAnt = Frame[sLineOffs]<<16;
+        PixelDst = LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
+        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
+
+        for (long X = 1; X < W; X++){
+            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
+            PixelDst = LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
+            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+        }
+    }
+}
+
+static void FormerDenoise(unsigned char *Frame, unsigned char *FrameDest,
+                          unsigned int *LineAnt, unsigned short **FrameAntPtr,
+                          int W, int H, int sStride, int dStride,
+                          int *Horizontal, int *Vertical, int *Temporal)
+{
+    long sLineOffs = 0, dLineOffs = 0;
+    unsigned int PixelAnt;
+    unsigned int PixelDst;
+    unsigned short* FrameAnt=(*FrameAntPtr);
+
+    if(!FrameAnt){
+        (*FrameAntPtr)=FrameAnt=malloc(W*H*sizeof(unsigned short));
+        assert(FrameAnt != NULL);
+        for (long Y = 0; Y < H; Y++){
+            unsigned short* dst=&FrameAnt[Y*W];
+            unsigned char* src=Frame+Y*sStride;
+            for (long X = 0; X < W; X++) dst[X]=src[X]<<8;
+        }
+    }
+
+    if(!Horizontal[0] && !Vertical[0]){
+        FormerTemporal(Frame, FrameDest, FrameAnt,
+                       W, H, sStride, dStride, Temporal);
+        return;
+    }
+    if(!Temporal[0]){
+        FormerSpacial(Frame, FrameDest, LineAnt,
+                      W, H, sStride, dStride, Horizontal, Vertical);
+        return;
+    }
+
+    LineAnt[0] = PixelAnt = Frame[0]<<16;
+    PixelDst = LowPassMul(FrameAnt[0]<<8, PixelAnt, Temporal);
+    FrameAnt[0] = ((PixelDst+0x1000007F)>>8);
+    FrameDest[0]= ((PixelDst+0x10007FFF)>>16);
+
+    for (long X = 1; X < W; X++){
+        LineAnt[X] = PixelAnt = LowPassMul(PixelAnt, Frame[X]<<16, Horizontal);
+        PixelDst = LowPassMul(FrameAnt[X]<<8, PixelAnt, Temporal);
+        FrameAnt[X] = ((PixelDst+0x1000007F)>>8);
+        FrameDest[X]= ((PixelDst+0x10007FFF)>>16);
+    }
+
+    for (long Y = 1; Y < H; Y++){
+        unsigned short* LinePrev=&FrameAnt[Y*W];
+        sLineOffs += sStride, dLineOffs += dStride;
+        PixelAnt = Frame[sLineOffs]<<16;
+        LineAnt[0] = LowPassMul(LineAnt[0], PixelAnt, Vertical);
+        PixelDst = LowPassMul(LinePrev[0]<<8, LineAnt[0], Temporal);
+        LinePrev[0] = ((PixelDst+0x1000007F)>>8);
+        FrameDest[dLineOffs]= ((PixelDst+0x10007FFF)>>16);
+
+        for (long X = 1; X < W; X++){
+            PixelAnt = LowPassMul(PixelAnt, Frame[sLineOffs+X]<<16, Horizontal);
+            LineAnt[X] = LowPassMul(LineAnt[X], PixelAnt, Vertical);
+            PixelDst = LowPassMul(LinePrev[X]<<8, LineAnt[X], Temporal);
+            LinePrev[X] = ((PixelDst+0x1000007F)>>8);
+            FrameDest[dLineOffs+X]= ((PixelDst+0x10007FFF)>>16);
+        }
+    }
+}
+
+/* Noisy gradient, so that neighbours and frames are close */
+static void FillFrame(plane_t *plane, int w, int h, unsigned frame)
+{
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            plane->p_pixels[y * plane->i_pitch + x] =
+                VLC_CLIP((x + y) * 2 + (int)frame + rand() % 16 - 8, 0, 255);
+}
+
+static plane_t NewPlane(int w, int h)
+{
+    plane_t plane = {
+        .i_pitch = (w + 31) & ~31,
+        .i_lines = h, .i_visible_pitch = w, .i_visible_lines = h,
+    };
+    plane.p_pixels = malloc(plane.i_pitch * h);
+    assert(plane.p_pixels != NULL);
+    return plane;
+}
+
+static void InitSys(filter_sys_t *sys, unsigned threads, int w, int h)
+{
+    sys->cfg.Line = malloc(w * sizeof (unsigned));
+    sys->horiz = malloc((size_t)w * h * sizeof (unsigned));
+    sys->slices = filter_slices_New(threads);
+    assert(sys->cfg.Line != NULL && sys->horiz != NULL
+        && sys->slices != NULL);
+}
+
+static void CleanSys(filter_sys_t *sys)
+{
+    filter_slices_Delete(sys->slices);
+    free(sys->horiz);
+    free(sys->cfg.Line);
+}
+
+static void test_denoise(int w, int h, double spatial, double temporal,
+                         unsigned threads)
+{
+    static int coefs[2][512*16];
+    enum { FRAMES = 4 };
+    filter_sys_t sys;
+    unsigned short *ant = NULL, *former_ant = NULL;
+    unsigned *line = malloc(w * sizeof (unsigned));
+    plane_t src = NewPlane(w, h), dst = NewPlane(w, h);
+    plane_t ref = NewPlane(w, h);
+    assert(line != NULL);
+
+    PrecalcCoefs(coefs[0], spatial);
+    PrecalcCoefs(coefs[1], temporal);
+    InitSys(&sys, threads, w, h);
+
+    for (unsigned n = 0; n < FRAMES; n++)
+    {
+        FillFrame(&src, w, h, n);
+        FormerDenoise(src.p_pixels, ref.p_pixels, line, &former_ant,
+                      w, h, src.i_pitch, ref.i_pitch,
+                      coefs[0], coefs[0], coefs[1]);
+        assert(Denoise(&sys, &src, &dst, &ant, w, h,
+                       coefs[0], coefs[0], coefs[1]));
+
+        for (int y = 0; y < h; y++)
+            if (memcmp(dst.p_pixels + y * dst.i_pitch,
+                       ref.p_pixels + y * ref.i_pitch, w)
+             || memcmp(ant + y * w, former_ant + y * w, w * sizeof (*ant)))
+            {
+                fprintf(stderr, "%dx%d, %g/%g, %u threads: frame %u "
+                        "differs on row %d\n", w, h, spatial, temporal,
+                        threads, n, y);
+                abort();
+            }
+    }
+
+    CleanSys(&sys);
+    free(ant);
+    free(former_ant);
+    free(line);
+    free(src.p_pixels);
+    free(dst.p_pixels);
+    free(ref.p_pixels);
+}
+
+static void bench(unsigned count)
+{
+    enum { W = 1920, H = 1080 };
+    static int coefs[2][512*16];
+    static const unsigned threads[] = { 1, 0 };
+    unsigned short *ant = NULL;
+    unsigned *line = malloc(W * sizeof (unsigned));
+    plane_t src = NewPlane(W, H), dst = NewPlane(W, H);
+    assert(line != NULL);
+
+    PrecalcCoefs(coefs[0], PARAM1_DEFAULT);
+    PrecalcCoefs(coefs[1], PARAM3_DEFAULT);
+    FillFrame(&src, W, H, 0);
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned n = 0; n < count; n++)
+        FormerDenoise(src.p_pixels, dst.p_pixels, line, &ant, W, H,
+                      src.i_pitch, dst.i_pitch,
+                      coefs[0], coefs[0], coefs[1]);
+    vlc_tick_t time = vlc_tick_now() - start;
+    printf("1080p luma: former %.1f frames/s\n",
+           count / secf_from_vlc_tick(time));
+
+    for (size_t t = 0; t < ARRAY_SIZE(threads); t++)
+    {
+        filter_sys_t sys;
+
+        InitSys(&sys, threads[t], W, H);
+        start = vlc_tick_now();
+        for (unsigned n = 0; n < count; n++)
+            Denoise(&sys, &src, &dst, &ant, W, H,
+                    coefs[0], coefs[0], coefs[1]);
+        time = vlc_tick_now() - start;
+        printf("1080p luma: %u threads %.1f frames/s\n",
+               filter_slices_Threads(sys.slices),
+               count / secf_from_vlc_tick(time));
+        CleanSys(&sys);
+    }
+
+    free(ant);
+    free(line);
+    free(src.p_pixels);
+    free(dst.p_pixels);
+}
+
+int main(int argc, char **argv)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        bench(argc > 2 ? atoi(argv[2]) : 100);
+    else
+    {
+        static const int sizes[][2] = {
+            { 1, 1 }, { 7, 3 }, { 64, 16 }, { 301, 37 },
+        };
+        static const double strengths[][2] = {
+            { PARAM1_DEFAULT, PARAM3_DEFAULT }, { PARAM1_DEFAULT, 0. },
+            { 0., PARAM3_DEFAULT }, { 0., 0. }, { 254., 254. },
+        };
+
+        for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+            for (size_t j = 0; j < ARRAY_SIZE(strengths); j++)
+                for (unsigned threads = 1; threads <= 4; threads += 3)
+                    test_denoise(sizes[i][0], sizes[i][1], strengths[j][0],
+                                 strengths[j][1], threads);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,268 @@
+/*****************************************************************************
+ * sharpen.c: test the sharpen video filter
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#define MODULE_STRING "sharpen"
+#include "../../../modules/video_filter/sharpen.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include <vlc_tick.h>
+
+static const struct
+{
+    const char *name;
+    sharpen_row_t row, row_10bits;
+} kernels[] = {
+    { "C", SharpenRowC, SharpenRow10C },
+#if defined(HAVE_SSE2_INTRINSICS)
+    { "SSE4.1", SharpenRowSSE4_1, SharpenRow10SSE4_1 },
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    { "AVX2", SharpenRowAVX2, SharpenRow10AVX2 },
+#endif
+#if defined(__ARM_NEON)
+    { "NEON", SharpenRowNEON, SharpenRow10NEON },
+#endif
+};
+
+static bool KernelSupported(sharpen_row_t kernel)
+{
+#if defined(HAVE_SSE2_INTRINSICS)
+    if (kernel == SharpenRowSSE4_1)
+        return vlc_CPU_SSE4_1();
+#endif
+#if defined(HAVE_AVX2_INTRINSICS)
+    if (kernel == SharpenRowAVX2)
+        return vlc_CPU_AVX2();
+#endif
+#if defined(__ARM_NEON)
+    if (kernel == SharpenRowNEON)
+        return vlc_CPU_ARM_NEON();
+#endif
+    return true;
+}
+
+/* The luma plane as the filter sharpened it formerly, pixel by pixel, with
+ * the bounds of the rows in pixels rather than in bytes */
+#define FORMER_SHARPEN(name, data_t, maxval) \
+static void name(data_t *p_out, const data_t *p_src, int i_out_line_len, \
+                 int i_src_line_len, unsigned i_visible_lines, \
+                 unsigned i_visible_width, int sigma) \
+{ \
+    const int v1 = -1; \
+    const int v2 = 3; /* 2^3 = 8 */ \
+\
+    memcpy(p_out, p_src, i_visible_width * sizeof (data_t)); \
+    for (unsigned i = 1; i < i_visible_lines - 1; i++) \
+    { \
+        p_out[i * i_out_line_len] = p_src[i * i_src_line_len]; \
+\
+        for (unsigned j = 1; j < i_visible_width - 1; j++) \
+        { \
+            const int line_idx_1 = (i - 1) * i_src_line_len; \
+            const int line_idx_2 = i * i_src_line_len; \
+            const int line_idx_3 = (i + 1) * i_src_line_len; \
+            int pix = \
+                (p_src[line_idx_1 + j - 1] * v1) + \
+                (p_src[line_idx_1 + j    ] * v1) + \
+                (p_src[line_idx_1 + j + 1] * v1) + \
+                (p_src[line_idx_2 + j - 1] * v1) + \
+                (p_src[line_idx_2 + j    ] << v2) + \
+                (p_src[line_idx_2 + j + 1] * v1) + \
+                (p_src[line_idx_3 + j - 1] * v1) + \
+                (p_src[line_idx_3 + j    ] * v1) + \
+                (p_src[line_idx_3 + j + 1] * v1); \
+\
+            pix = (VLC_CLIP(pix, -(maxval), maxval) * sigma) >> 20; \
+            p_out[i * i_out_line_len + j] = \
+                VLC_CLIP(p_src[line_idx_2 + j] + pix, 0, maxval); \
+        } \
+        p_out[i * i_out_line_len + i_visible_width - 1] = \
+            p_src[i * i_src_line_len + i_visible_width - 1]; \
+    } \
+    memcpy(&p_out[(i_visible_lines - 1) * i_out_line_len], \
+           &p_src[(i_visible_lines - 1) * i_src_line_len], \
+           i_visible_width * sizeof (data_t)); \
+}
+
+FORMER_SHARPEN(FormerSharpen, uint8_t, 255)
+FORMER_SHARPEN(FormerSharpen10, uint16_t, 1023)
+
+/* Runs the slices as the filter does */
+static void Sharpen(filter_slices_t *slices, sharpen_row_t row,
+                    uint8_t *dst, const uint8_t *src, ptrdiff_t dst_pitch,
+                    ptrdiff_t src_pitch, unsigned lines, unsigned width,
+                    unsigned pixel_size, int sigma)
+{
+    struct sharpen_job job = {
+        .row = row, .src = src, .dst = dst,
+        .src_pitch = src_pitch, .dst_pitch = dst_pitch,
+        .lines = lines, .width = width, .pixel_size = pixel_size,
+        .sigma = sigma, .slices = filter_slices_Threads(slices),
+    };
+
+    memcpy(dst, src, width * pixel_size);
+    filter_slices_Run(slices, SharpenSlice, &job, job.slices);
+    memcpy(dst + (lines - 1) * dst_pitch, src + (lines - 1) * src_pitch,
+           width * pixel_size);
+}
+
+static void FillNoise(uint8_t *buf, size_t size, unsigned pixel_size,
+                      unsigned maxval)
+{
+    if (pixel_size == 1)
+        for (size_t i = 0; i < size; i++)
+            buf[i] = rand() % (maxval + 1);
+    else
+        for (size_t i = 0; i < size / 2; i++)
+            ((uint16_t *)buf)[i] = rand() % (maxval + 1);
+}
+
+static void test_sharpen(unsigned width, unsigned lines, int sigma,
+                         bool b_10bits, unsigned threads)
+{
+    const unsigned size = b_10bits ? 2 : 1;
+    const ptrdiff_t src_pitch = (width + 17) * size;
+    const ptrdiff_t dst_pitch = (width + 5) * size;
+    uint8_t *src = malloc(src_pitch * lines);
+    uint8_t *dst = malloc(dst_pitch * lines);
+    uint8_t *ref = malloc(dst_pitch * lines);
+    filter_slices_t *slices = filter_slices_New(threads);
+    assert(src != NULL && dst != NULL && ref != NULL && slices != NULL);
+
+    FillNoise(src, src_pitch * lines, size, b_10bits ? 1023 : 255);
+    if (b_10bits)
+        FormerSharpen10((uint16_t *)ref, (const uint16_t *)src,
+                        dst_pitch / 2, src_pitch / 2, lines, width, sigma);
+    else
+        FormerSharpen(ref, src, dst_pitch, src_pitch, lines, width, sigma);
+
+    for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+    {
+        if (!KernelSupported(kernels[k].row))
+            continue;
+
+        Sharpen(slices, b_10bits ? kernels[k].row_10bits : kernels[k].row,
+                dst, src, dst_pitch, src_pitch, lines, width, size, sigma);
+        for (unsigned i = 0; i < lines; i++)
+            if (memcmp(dst + i * dst_pitch, ref + i * dst_pitch,
+                       width * size))
+            {
+                fprintf(stderr, "%s, %ux%u, %s, sigma %d, %u threads: "
+                        "row %u differs\n", kernels[k].name, width, lines,
+                        b_10bits ? "10 bits" : "8 bits", sigma, threads, i);
+                abort();
+            }
+    }
+
+    filter_slices_Delete(slices);
+    free(src);
+    free(dst);
+    free(ref);
+}
+
+static void bench(unsigned count)
+{
+    enum { W = 1920, H = 1080 };
+    const int sigma = 0.05 * (1 << 20);
+    uint8_t *src = malloc(W * H * 2);
+    uint8_t *dst = malloc(W * H * 2);
+    assert(src != NULL && dst != NULL);
+
+    for (unsigned b_10bits = 0; b_10bits < 2; b_10bits++)
+    {
+        const unsigned size = b_10bits + 1;
+        const char *depth = b_10bits ? "10 bits" : "8 bits";
+
+        FillNoise(src, W * H * size, size, b_10bits ? 1023 : 255);
+
+        vlc_tick_t start = vlc_tick_now();
+        for (unsigned n = 0; n < count; n++)
+            if (b_10bits)
+                FormerSharpen10((uint16_t *)dst, (const uint16_t *)src,
+                                W, W, H, W, sigma);
+            else
+                FormerSharpen(dst, src, W, W, H, W, sigma);
+        vlc_tick_t time = vlc_tick_now() - start;
+        printf("1080p, %s: former %.1f frames/s\n", depth,
+               count / secf_from_vlc_tick(time));
+
+        for (size_t k = 0; k < ARRAY_SIZE(kernels); k++)
+        {
+            if (!KernelSupported(kernels[k].row))
+                continue;
+
+            static const unsigned threads[] = { 1, 0 };
+            for (size_t t = 0; t < ARRAY_SIZE(threads); t++)
+            {
+                filter_slices_t *slices = filter_slices_New(threads[t]);
+                assert(slices != NULL);
+
+                start = vlc_tick_now();
+                for (unsigned n = 0; n < count; n++)
+                    Sharpen(slices, b_10bits ? kernels[k].row_10bits
+                                             : kernels[k].row,
+                            dst, src, W * size, W * size, H, W, size, sigma);
+                time = vlc_tick_now() - start;
+                printf("1080p, %s: %s, %u threads %.1f frames/s\n", depth,
+                       kernels[k].name, filter_slices_Threads(slices),
+                       count / secf_from_vlc_tick(time));
+                filter_slices_Delete(slices);
+            }
+        }
+    }
+    free(src);
+    free(dst);
+}
+
+int main(int argc, char **argv)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        bench(argc > 2 ? atoi(argv[2]) : 100);
+    else
+    {
+        static const unsigned sizes[][2] = {
+            { 3, 3 }, { 9, 4 }, { 18, 7 }, { 33, 16 }, { 301, 37 },
+        };
+        static const int sigmas[] = { 0, 0.05 * (1 << 20), 1 << 20, 2 << 20 };
+
+        for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+            for (size_t j = 0; j < ARRAY_SIZE(sigmas); j++)
+                for (unsigned threads = 1; threads <= 4; threads += 3)
+                {
+                    test_sharpen(sizes[i][0], sizes[i][1], sigmas[j], false,
+                                 threads);
+                    test_sharpen(sizes[i][0], sizes[i][1], sigmas[j], true,
+                                 threads);
+                }
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
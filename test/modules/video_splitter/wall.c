@@ -0,0 +1,203 @@
+/*****************************************************************************
+ * wall.c: test the wall video splitter
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#define MODULE_STRING "wall"
+#include "../../../modules/video_splitter/wall.c"
+
+const char vlc_module_name[] = MODULE_STRING;
+
+#include <vlc_tick.h>
+
+/* The outputs as the splitter copied them formerly */
+static int FormerFilter( video_splitter_t *p_splitter, picture_t *pp_dst[],
+                         picture_t *p_src )
+{
+    video_splitter_sys_t *p_sys = p_splitter->p_sys;
+
+    if( video_splitter_NewPicture( p_splitter, pp_dst ) )
+    {
+        picture_Release( p_src );
+        return VLC_EGENERIC;
+    }
+
+    for( int y = 0; y < p_sys->i_row; y++ )
+    {
+        for( int x = 0; x < p_sys->i_col; x++ )
+        {
+            wall_output_t *p_output = &p_sys->pp_output[x][y];
+            if( !p_output->b_active )
+                continue;
+
+            picture_t *p_dst = pp_dst[p_output->i_output];
+
+            picture_t tmp = *p_src;
+            for( int i = 0; i < tmp.i_planes; i++ )
+            {
+                plane_t *p0 = &tmp.p[0];
+                plane_t *p = &tmp.p[i];
+                const int i_y = p_output->i_top  * p->i_visible_pitch / p0->i_visible_pitch;
+                const int i_x = p_output->i_left * p->i_visible_lines / p0->i_visible_lines;
+
+                p->p_pixels += i_y * p->i_pitch + ( i_x - (i_x % p->i_pixel_pitch));
+            }
+            picture_Copy( p_dst, &tmp );
+        }
+    }
+
+    picture_Release( p_src );
+    return VLC_SUCCESS;
+}
+
+static video_splitter_t *CreateWall(libvlc_instance_t *vlc, unsigned width,
+                                    unsigned height, int cols, int rows)
+{
+    video_splitter_t *splitter =
+        vlc_object_create(vlc->p_libvlc_int, sizeof (*splitter));
+    assert(splitter != NULL);
+
+    video_format_Init(&splitter->fmt, VLC_CODEC_I420);
+    video_format_Setup(&splitter->fmt, VLC_CODEC_I420, width, height,
+                       width, height, 1, 1);
+    splitter->p_cfg = NULL;
+
+    var_Create(splitter, CFG_PREFIX "cols", VLC_VAR_INTEGER);
+    var_SetInteger(splitter, CFG_PREFIX "cols", cols);
+    var_Create(splitter, CFG_PREFIX "rows", VLC_VAR_INTEGER);
+    var_SetInteger(splitter, CFG_PREFIX "rows", rows);
+    var_Create(splitter, CFG_PREFIX "element-aspect", VLC_VAR_STRING);
+    var_SetString(splitter, CFG_PREFIX "element-aspect", "16:9");
+
+    assert(Open(VLC_OBJECT(splitter)) == VLC_SUCCESS);
+    return splitter;
+}
+
+static void DeleteWall(video_splitter_t *splitter)
+{
+    Close(VLC_OBJECT(splitter));
+    video_format_Clean(&splitter->fmt);
+    vlc_object_delete(splitter);
+}
+
+static picture_t *NewSource(const video_format_t *fmt)
+{
+    picture_t *pic = picture_NewFromFormat(fmt);
+    assert(pic != NULL);
+
+    for (int i = 0; i < pic->i_planes; i++)
+        for (int y = 0; y < pic->p[i].i_lines; y++)
+            for (int x = 0; x < pic->p[i].i_pitch; x++)
+                pic->p[i].p_pixels[y * pic->p[i].i_pitch + x] =
+                    x * 3 + y * 7 + i * 50;
+    return pic;
+}
+
+static void test_wall(libvlc_instance_t *vlc, unsigned width, unsigned height,
+                      int cols, int rows)
+{
+    video_splitter_t *splitter = CreateWall(vlc, width, height, cols, rows);
+    picture_t *src = NewSource(&splitter->fmt);
+    picture_t *dst[COL_MAX * ROW_MAX], *ref[COL_MAX * ROW_MAX];
+
+    assert(FormerFilter(splitter, ref, picture_Hold(src)) == VLC_SUCCESS);
+    assert(Filter(splitter, dst, src) == VLC_SUCCESS);
+
+    /* The outputs keep the source alive */
+    for (int i = 0; i < splitter->i_output; i++)
+    {
+        assert(dst[i]->format.i_visible_width == ref[i]->format.i_visible_width);
+        assert(dst[i]->format.i_visible_height == ref[i]->format.i_visible_height);
+
+        for (int p = 0; p < dst[i]->i_planes; p++)
+        {
+            const plane_t *d = &dst[i]->p[p], *r = &ref[i]->p[p];
+
+            assert(d->i_visible_lines == r->i_visible_lines);
+            for (int y = 0; y < d->i_visible_lines; y++)
+                if (memcmp(d->p_pixels + y * d->i_pitch,
+                           r->p_pixels + y * r->i_pitch, d->i_visible_pitch))
+                {
+                    fprintf(stderr, "%ux%u, %dx%d wall: output %d, plane %d "
+                            "differs on line %d\n", width, height, cols, rows,
+                            i, p, y);
+                    abort();
+                }
+        }
+        picture_Release(dst[i]);
+        picture_Release(ref[i]);
+    }
+    DeleteWall(splitter);
+}
+
+static void bench(libvlc_instance_t *vlc, unsigned count)
+{
+    video_splitter_t *splitter = CreateWall(vlc, 3840, 2160, 4, 4);
+    picture_t *src = NewSource(&splitter->fmt);
+    picture_t *dst[COL_MAX * ROW_MAX];
+    static const struct
+    {
+        const char *name;
+        int (*filter)(video_splitter_t *, picture_t *[], picture_t *);
+    } filters[] = {
+        { "former", FormerFilter },
+        { "reference", Filter },
+    };
+
+    for (size_t f = 0; f < ARRAY_SIZE(filters); f++)
+    {
+        vlc_tick_t start = vlc_tick_now();
+        for (unsigned n = 0; n < count; n++)
+        {
+            filters[f].filter(splitter, dst, picture_Hold(src));
+            video_splitter_DeletePicture(splitter, dst);
+        }
+        vlc_tick_t time = vlc_tick_now() - start;
+        printf("2160p, 4x4 wall: %s %.1f frames/s\n", filters[f].name,
+               count / secf_from_vlc_tick(time));
+    }
+
+    picture_Release(src);
+    DeleteWall(splitter);
+}
+
+int main(int argc, char **argv)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        bench(vlc, argc > 2 ? atoi(argv[2]) : 100);
+    else
+    {
+        test_wall(vlc, 640, 360, 1, 1);
+        test_wall(vlc, 1920, 1080, 2, 2);
+        test_wall(vlc, 1920, 1080, 3, 2);
+        test_wall(vlc, 1280, 1024, 4, 4);
+        test_wall(vlc, 3840, 2160, 4, 4);
+    }
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*****************************************************************************
+ * filters.c: test the audio output filters pipeline
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_aout.h>
+#include <vlc_block.h>
+
+#define FRAMES 4096
+
+static void FormatInit(audio_sample_format_t *fmt, vlc_fourcc_t format,
+                       unsigned rate, uint16_t channels)
+{
+    memset(fmt, 0, sizeof (*fmt));
+    fmt->i_format = format;
+    fmt->i_rate = rate;
+    fmt->i_physical_channels = channels;
+    fmt->channel_type = AUDIO_CHANNEL_TYPE_BITMAP;
+    aout_FormatPrepare(fmt);
+}
+
+static block_t *Play(aout_filters_t *filters, const audio_sample_format_t *fmt,
+                     unsigned frames, float value, float step)
+{
+    block_t *block = block_Alloc(frames * fmt->i_bytes_per_frame);
+    assert(block != NULL);
+
+    for (unsigned i = 0; i < frames * fmt->i_channels; i++)
+    {
+        const float s = value + step * (i % fmt->i_channels);
+        switch (fmt->i_format)
+        {
+            case VLC_CODEC_FL32:
+                ((float *)block->p_buffer)[i] = s;
+                break;
+            case VLC_CODEC_S16N:
+                ((int16_t *)block->p_buffer)[i] = s * 32768.f;
+                break;
+            default:
+                vlc_assert_unreachable();
+        }
+    }
+    block->i_nb_samples = frames;
+    block->i_pts = VLC_TICK_0;
+    block->i_length = vlc_tick_from_samples(frames, fmt->i_rate);
+
+    return aout_FiltersPlay(filters, block, 1.f);
+}
+
+/* Checks the conversion to the output format, with the channels in order */
+static void test_convert(vlc_object_t *obj, vlc_fourcc_t in_format,
+                         vlc_fourcc_t out_format, const aout_filters_cfg_t *cfg,
+                         bool swapped)
+{
+    audio_sample_format_t in, out;
+    FormatInit(&in, in_format, 48000, AOUT_CHANS_STEREO);
+    FormatInit(&out, out_format, 48000, AOUT_CHANS_STEREO);
+
+    aout_filters_t *filters = aout_FiltersNew(obj, &in, &out, cfg);
+    assert(filters != NULL);
+
+    block_t *block = Play(filters, &in, FRAMES, .25f, .25f);
+    assert(block != NULL);
+    assert(block->i_buffer == FRAMES * out.i_bytes_per_frame);
+
+    for (unsigned i = 0; i < FRAMES; i++)
+        for (unsigned c = 0; c < 2; c++)
+        {
+            const unsigned from = swapped ? 1 - c : c;
+            const float expected = .25f + .25f * from;
+
+            switch (out_format)
+            {
+                case VLC_CODEC_FL32:
+                    assert(((float *)block->p_buffer)[2 * i + c] == expected);
+                    break;
+                case VLC_CODEC_S16N:
+                    assert(((int16_t *)block->p_buffer)[2 * i + c]
+                           == expected * 32768.f);
+                    break;
+                case VLC_CODEC_S32N:
+                    assert(((int32_t *)block->p_buffer)[2 * i + c]
+                           == expected * 2147483648.f);
+                    break;
+                default:
+                    vlc_assert_unreachable();
+            }
+        }
+    block_Release(block);
+
+    aout_FiltersDelete(obj, filters);
+}
+
+/* Checks the resampling and remixing to an output format */
+static void test_pipeline(vlc_object_t *obj, unsigned in_rate,
+                          uint16_t in_channels, unsigned out_rate,
+                          uint16_t out_channels, const aout_filters_cfg_t *cfg)
+{
+    audio_sample_format_t in, out;
+    FormatInit(&in, VLC_CODEC_FL32, in_rate, in_channels);
+    FormatInit(&out, VLC_CODEC_S16N, out_rate, out_channels);
+
+    aout_filters_t *filters = aout_FiltersNew(obj, &in, &out, cfg);
+    assert(filters != NULL);
+
+    size_t frames = 0;
+    for (unsigned i = 0; i < 10; i++)
+    {
+        block_t *block = Play(filters, &in, FRAMES, .1f, 0.f);
+        if (block == NULL)
+            continue;
+        assert(block->i_buffer % out.i_bytes_per_frame == 0);
+        frames += block->i_buffer / out.i_bytes_per_frame;
+        block_Release(block);
+    }
+
+    block_t *block = aout_FiltersDrain(filters);
+    if (block != NULL)
+    {
+        frames += block->i_buffer / out.i_bytes_per_frame;
+        block_Release(block);
+    }
+    assert(llabs((long long)frames
+                 - 10LL * FRAMES * out_rate / in_rate) <= 2);
+
+    aout_FiltersDelete(obj, filters);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = vlc_object_create(vlc->p_libvlc_int, sizeof (*obj));
+    assert(obj != NULL);
+    var_Create(obj, "visual", VLC_VAR_STRING);
+    var_Create(obj, "audio-time-stretch", VLC_VAR_BOOL);
+    var_SetBool(obj, "audio-time-stretch", false);
+
+    aout_filters_cfg_t reversed = AOUT_FILTERS_CFG_INIT;
+    reversed.remap[AOUT_CHANIDX_LEFT] = AOUT_CHANIDX_RIGHT;
+    reversed.remap[AOUT_CHANIDX_RIGHT] = AOUT_CHANIDX_LEFT;
+
+    test_convert(obj, VLC_CODEC_FL32, VLC_CODEC_FL32, NULL, false);
+    test_convert(obj, VLC_CODEC_FL32, VLC_CODEC_S16N, NULL, false);
+    test_convert(obj, VLC_CODEC_S16N, VLC_CODEC_S16N, NULL, false);
+    test_convert(obj, VLC_CODEC_FL32, VLC_CODEC_S32N, NULL, false);
+    test_convert(obj, VLC_CODEC_FL32, VLC_CODEC_FL32, &reversed, true);
+    test_convert(obj, VLC_CODEC_S16N, VLC_CODEC_S16N, &reversed, true);
+    test_convert(obj, VLC_CODEC_FL32, VLC_CODEC_S32N, &reversed, true);
+
+    test_pipeline(obj, 44100, AOUT_CHANS_STEREO, 48000, AOUT_CHANS_STEREO,
+                  NULL);
+    test_pipeline(obj, 48000, AOUT_CHANS_5_1, 48000, AOUT_CHANS_STEREO,
+                  &reversed);
+    test_pipeline(obj, 48000, AOUT_CHANS_5_1, 44100, AOUT_CHANS_STEREO,
+                  NULL);
+
+    vlc_object_delete(obj);
+    libvlc_release(vlc);
+    return 0;
+}
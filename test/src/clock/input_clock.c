@@ -0,0 +1,246 @@
+/*****************************************************************************
+ * input_clock.c: test the input clock rate changes and live catch-up
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+#include "../../../lib/libvlc_internal.h"
+
+#include "../../../src/clock/input_clock.c"
+
+const char vlc_module_name[] = "test_input_clock";
+
+#include <vlc_tick.h>
+
+#define PCR VLC_TICK_FROM_MS(40)
+#define MS(n) VLC_TICK_FROM_MS(n)
+
+/* A live source sending a clock reference every PCR, received with some
+ * jitter */
+struct source
+{
+    input_clock_t *cl;
+    vlc_object_t *obj;
+    vlc_tick_t stream;
+    vlc_tick_t system;
+    vlc_tick_t jitter;
+    unsigned count;
+    /* Catch-up as driven by the es_out */
+    float catchup;
+    vlc_tick_t i_jitter, i_headroom;
+};
+
+static void SourceInit(struct source *src, vlc_object_t *obj,
+                       vlc_tick_t pts_delay, vlc_tick_t jitter,
+                       bool low_latency)
+{
+    src->cl = input_clock_New(1.f, low_latency);
+    assert(src->cl != NULL);
+    if (pts_delay > 0)
+        input_clock_SetJitter(src->cl, pts_delay, 40);
+    src->obj = obj;
+    src->stream = VLC_TICK_FROM_SEC(1000);
+    src->system = VLC_TICK_FROM_SEC(10);
+    src->jitter = jitter;
+    src->count = 0;
+    src->catchup = 1.f;
+}
+
+/* Receives the next clock reference, returns true if the catch-up changed */
+static bool SourceFeed(struct source *src)
+{
+    bool late;
+    const vlc_tick_t offset = (src->count++ % 2) ? src->jitter : -src->jitter;
+
+    src->stream += PCR;
+    src->system += PCR;
+    input_clock_Update(src->cl, src->obj, &late, false, true, src->stream,
+                       src->system + offset);
+
+    if (input_clock_GetArrival(src->cl, &src->i_jitter, &src->i_headroom))
+        return false;
+
+    float catchup = input_clock_GetCatchup(src->catchup, src->i_jitter,
+                                           src->i_headroom);
+    if (catchup == src->catchup)
+        return false;
+
+    src->catchup = catchup;
+    input_clock_ChangeRate(src->cl, catchup);
+    return true;
+}
+
+static vlc_tick_t Convert(struct source *src, vlc_tick_t ts)
+{
+    int ret = input_clock_ConvertTS(src->obj, src->cl, NULL, &ts, NULL,
+                                    INT64_MAX);
+    assert(ret == VLC_SUCCESS);
+    return ts;
+}
+
+static void test_hysteresis(void)
+{
+    /* 10 ms of jitter: the target is 2 * 10 + 20 ms */
+    assert(input_clock_GetCatchup(1.f, MS(10), MS(40) + MS(40)) == 1.f);
+    assert(input_clock_GetCatchup(1.f, MS(10), MS(40) + MS(40) + 1)
+           == INPUT_CLOCK_CATCHUP_RATE);
+    assert(input_clock_GetCatchup(INPUT_CLOCK_CATCHUP_RATE, MS(10), MS(40) + 1)
+           == INPUT_CLOCK_CATCHUP_RATE);
+    assert(input_clock_GetCatchup(INPUT_CLOCK_CATCHUP_RATE, MS(10), MS(40))
+           == 1.f);
+    assert(input_clock_GetCatchup(INPUT_CLOCK_CATCHUP_RATE, MS(10), -MS(5))
+           == 1.f);
+}
+
+static void test_catchup(vlc_object_t *obj)
+{
+    struct source src;
+
+    /* 300 ms of caching, references received 5 ms early or late */
+    SourceInit(&src, obj, MS(300), MS(5), true);
+
+    /* Not enough references to judge */
+    for (unsigned i = 1; i < INPUT_CLOCK_ARRIVAL_MIN; i++)
+    {
+        assert(!SourceFeed(&src));
+        assert(input_clock_GetArrival(src.cl, &src.i_jitter,
+                                      &src.i_headroom) == VLC_EGENERIC);
+    }
+
+    /* Far more buffering than the jitter requires */
+    assert(SourceFeed(&src));
+    assert(src.catchup == INPUT_CLOCK_CATCHUP_RATE);
+    assert(src.i_jitter == MS(10));
+    assert(src.i_headroom > MS(280));
+
+    /* Catching up trims the buffering until the target is reached */
+    const vlc_tick_t target = 2 * src.i_jitter + INPUT_CLOCK_CATCHUP_MARGIN;
+    vlc_tick_t headroom = src.i_headroom;
+    unsigned steps = 0;
+
+    while (!SourceFeed(&src))
+    {
+        assert(src.i_headroom <= headroom);
+        assert(src.i_headroom > target);
+        headroom = src.i_headroom;
+        assert(++steps < 1000);
+    }
+    assert(src.catchup == 1.f);
+    assert(src.i_headroom <= target);
+    /* No overshoot: it stopped on the first reference below the target */
+    assert(src.i_headroom > target - MS(5));
+    /* About (1 - 1 / 1.05) * 40 ms are trimmed per reference */
+    assert(steps > (MS(280) - target) / MS(2) - 10);
+
+    /* Within the hysteresis band, the nominal rate is kept */
+    for (unsigned i = 0; i < 500; i++)
+    {
+        assert(!SourceFeed(&src));
+        assert(src.i_headroom <= target + INPUT_CLOCK_CATCHUP_HYSTERESIS);
+    }
+
+    /* More caching requested: catch up again */
+    input_clock_SetJitter(src.cl, MS(400), 40);
+    assert(SourceFeed(&src));
+    assert(src.catchup == INPUT_CLOCK_CATCHUP_RATE);
+
+    input_clock_Delete(src.cl);
+}
+
+static void test_change_rate(vlc_object_t *obj)
+{
+    struct source src;
+
+    /* No caching, so that only the stream to system mapping is checked */
+    SourceInit(&src, obj, 0, 0, true);
+    for (unsigned i = 0; i < 50; i++)
+        SourceFeed(&src);
+
+    const vlc_tick_t last = src.stream;
+    const vlc_tick_t date = Convert(&src, last);
+
+    /* The last reference keeps its date, later ones come faster */
+    input_clock_ChangeRate(src.cl, 1.05f);
+    assert(llabs(Convert(&src, last) - date) <= 2);
+    assert(llabs(Convert(&src, last + VLC_TICK_FROM_SEC(1))
+                 - (date + (vlc_tick_t)(VLC_TICK_FROM_SEC(1) / 1.05f))) <= 2);
+
+    /* The source keeps its own pace: this is not a drift */
+    for (unsigned i = 0; i < 250; i++)
+        SourceFeed(&src);
+    assert(fabs(AvgGet(&src.cl->drift)) < 1.);
+
+    const vlc_tick_t last2 = src.stream;
+    const vlc_tick_t date2 = Convert(&src, last2);
+    assert(llabs(date2 - (date + (vlc_tick_t)((last2 - last) / 1.05f))) <= 2);
+
+    input_clock_ChangeRate(src.cl, 1.f);
+    assert(llabs(Convert(&src, last2) - date2) <= 2);
+    assert(llabs(Convert(&src, last2 + VLC_TICK_FROM_SEC(1))
+                 - (date2 + VLC_TICK_FROM_SEC(1))) <= 2);
+
+    input_clock_Delete(src.cl);
+}
+
+static void test_default_mode(vlc_object_t *obj)
+{
+    struct source src;
+
+    /* Without the low latency mode, nothing is measured nor trimmed */
+    SourceInit(&src, obj, MS(300), MS(5), false);
+    for (unsigned i = 0; i < 2 * INPUT_CLOCK_ARRIVAL_COUNT; i++)
+    {
+        assert(!SourceFeed(&src));
+        assert(input_clock_GetArrival(src.cl, &src.i_jitter,
+                                      &src.i_headroom) == VLC_EGENERIC);
+    }
+    assert(src.catchup == 1.f);
+    input_clock_Delete(src.cl);
+
+    /* A rate change still keeps the last reference at its date */
+    SourceInit(&src, obj, 0, 0, false);
+    for (unsigned i = 0; i < 50; i++)
+        SourceFeed(&src);
+
+    const vlc_tick_t last = src.stream;
+    const vlc_tick_t date = Convert(&src, last);
+
+    input_clock_ChangeRate(src.cl, 2.f);
+    assert(llabs(Convert(&src, last) - date) <= 2);
+    assert(llabs(Convert(&src, last + VLC_TICK_FROM_SEC(1))
+                 - (date + VLC_TICK_FROM_SEC(1) / 2)) <= 2);
+
+    input_clock_Delete(src.cl);
+}
+
+int main(void)
+{
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(test_defaults_nargs,
+                                        test_defaults_args);
+    assert(vlc != NULL);
+
+    test_hysteresis();
+    test_catchup(VLC_OBJECT(vlc->p_libvlc_int));
+    test_change_rate(VLC_OBJECT(vlc->p_libvlc_int));
+    test_default_mode(VLC_OBJECT(vlc->p_libvlc_int));
+
+    libvlc_release(vlc);
+    return 0;
+}
@@ -0,0 +1,209 @@
+/*****************************************************************************
+ * display_date.c: test the display date given to the video decoders, and
+ *                 the video statistics they report
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include "../../../src/input/decoder.c"
+#include "../../../src/input/scrub.c"
+#include "../../../src/input/stats.c"
+
+const char vlc_module_name[] = "test_display_date";
+
+/* The clock maps the stream time 0 to the system date EPOCH */
+#define EPOCH VLC_TICK_FROM_SEC(1000)
+
+static vout_thread_t vout;
+static int clock_dummy;
+#define CLOCK ((vlc_clock_t *)&clock_dummy)
+static vlc_tick_t render_delay;
+
+vlc_tick_t vout_GetRenderDelay(vout_thread_t *p_vout)
+{
+    assert(p_vout == &vout);
+    return render_delay;
+}
+
+vlc_tick_t vlc_clock_ConvertToSystem(vlc_clock_t *clock, vlc_tick_t system_now,
+                                     vlc_tick_t ts, double rate)
+{
+    (void) system_now;
+    assert(clock == CLOCK);
+    return EPOCH + (vlc_tick_t)((ts - VLC_TICK_0) / rate);
+}
+
+static vout_pacing_t pacing;
+
+void vout_GetResetStatistic(vout_thread_t *p_vout, unsigned *displayed,
+                            unsigned *lost, vout_pacing_t *p_pacing)
+{
+    assert(p_vout == &vout);
+    *displayed = pacing.timed;
+    *lost = 0;
+    *p_pacing = pacing;
+    memset(&pacing, 0, sizeof (pacing));
+}
+
+/* Not reached by the display date */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#define STUB(ret, name, ...) \
+    ret name(__VA_ARGS__) { vlc_assert_unreachable(); }
+
+STUB(void, aout_DecChangeDelay, audio_output_t *a, vlc_tick_t b)
+STUB(void, aout_DecChangePause, audio_output_t *a, bool b, vlc_tick_t c)
+STUB(void, aout_DecChangeRate, audio_output_t *a, float b)
+STUB(void, aout_DecDelete, audio_output_t *a)
+STUB(void, aout_DecDrain, audio_output_t *a)
+STUB(void, aout_DecFlush, audio_output_t *a)
+STUB(void, aout_DecGetResetStats, audio_output_t *a, unsigned *b, unsigned *c)
+STUB(int, aout_DecNew, audio_output_t *a, const audio_sample_format_t *b,
+     vlc_clock_t *c, const audio_replay_gain_t *d)
+STUB(int, aout_DecPlay, audio_output_t *a, block_t *b)
+STUB(size_t, block_FifoSize, block_fifo_t *a)
+STUB(int, input_GetAttachments, input_thread_t *a, input_attachment_t ***b)
+STUB(vout_thread_t *, input_resource_GetVout, input_resource_t *a,
+     const vout_configuration_t *b)
+STUB(vout_thread_t *, input_resource_HoldVout, input_resource_t *a)
+STUB(void, input_resource_PutVout, input_resource_t *a, vout_thread_t *b)
+STUB(int, sout_InputControl, sout_packetizer_input_t *a, int b, ...)
+STUB(int, sout_InputDelete, sout_packetizer_input_t *a)
+STUB(void, sout_InputFlush, sout_packetizer_input_t *a)
+STUB(bool, sout_InputIsEmpty, sout_packetizer_input_t *a)
+STUB(sout_packetizer_input_t *, sout_InputNew, sout_instance_t *a,
+     const es_format_t *b)
+STUB(int, sout_InputSendBuffer, sout_packetizer_input_t *a, block_t *b)
+STUB(void *, (vlc_custom_create), vlc_object_t *a, size_t b, const char *c)
+STUB(void, vout_Cancel, vout_thread_t *a, bool b)
+STUB(void, vout_ChangeDelay, vout_thread_t *a, vlc_tick_t b)
+STUB(void, vout_ChangePause, vout_thread_t *a, bool b, vlc_tick_t c)
+STUB(void, vout_ChangeRate, vout_thread_t *a, float b)
+STUB(void, vout_ChangeSpuDelay, vout_thread_t *a, vlc_tick_t b)
+STUB(void, vout_ChangeSpuRate, vout_thread_t *a, float b)
+STUB(vlc_tick_t, vout_GetDisplayedTimestamp, vout_thread_t *a)
+STUB(bool, vout_IsEmpty, vout_thread_t *a)
+STUB(void, vout_NextPicture, vout_thread_t *a, vlc_tick_t *b)
+STUB(void, vout_SetSpuHighlight, vout_thread_t *a,
+     const vlc_spu_highlight_t *b)
+STUB(void, vout_SetSubpictureClock, vout_thread_t *a, vlc_clock_t *b)
+#pragma GCC diagnostic pop
+
+static vlc_tick_t Date(struct decoder_owner *owner, vlc_tick_t ts)
+{
+    return decoder_GetDisplayDate(&owner->dec, vlc_tick_now(), ts);
+}
+
+static void test_display_date(void)
+{
+    struct decoder_owner owner;
+
+    memset(&owner, 0, sizeof (owner));
+    vlc_mutex_init(&owner.lock);
+    owner.dec.fmt_in.i_cat = VIDEO_ES;
+    owner.dec.cbs = &dec_video_cbs;
+    owner.p_clock = CLOCK;
+    owner.output_rate = 1.f;
+
+    const vlc_tick_t ts = VLC_TICK_0 + VLC_TICK_FROM_SEC(4);
+
+    /* No video output yet: nothing to render ahead */
+    render_delay = VLC_TICK_FROM_MS(15);
+    assert(Date(&owner, ts) == EPOCH + VLC_TICK_FROM_SEC(4));
+
+    /* The render delay of the video output is read on every call, as it
+     * follows the measured rendering costs */
+    owner.p_vout = &vout;
+    assert(Date(&owner, ts) == EPOCH + VLC_TICK_FROM_SEC(4)
+                               - VLC_TICK_FROM_MS(15));
+    render_delay = VLC_TICK_FROM_MS(40);
+    assert(Date(&owner, ts) == EPOCH + VLC_TICK_FROM_SEC(4)
+                               - VLC_TICK_FROM_MS(40));
+    render_delay = 0;
+    assert(Date(&owner, ts) == EPOCH + VLC_TICK_FROM_SEC(4));
+
+    /* The rate scales the stream time, not the rendering time */
+    render_delay = VLC_TICK_FROM_MS(40);
+    owner.output_rate = 2.f;
+    assert(Date(&owner, ts) == EPOCH + VLC_TICK_FROM_SEC(2)
+                               - VLC_TICK_FROM_MS(40));
+    owner.output_rate = 1.f;
+
+    /* No display date while waiting or paused, nor without a timestamp */
+    owner.b_waiting = true;
+    assert(Date(&owner, ts) == VLC_TICK_INVALID);
+    owner.b_waiting = false;
+    owner.paused = true;
+    assert(Date(&owner, ts) == VLC_TICK_INVALID);
+    owner.paused = false;
+    assert(Date(&owner, VLC_TICK_INVALID) == VLC_TICK_INVALID);
+
+    /* Without a clock, the timestamp is given back unconverted */
+    owner.p_clock = NULL;
+    assert(Date(&owner, ts) == ts);
+}
+
+static void test_pacing_stats(void)
+{
+    struct decoder_owner owner;
+    input_thread_private_t priv;
+    input_stats_t st;
+
+    memset(&owner, 0, sizeof (owner));
+    memset(&priv, 0, sizeof (priv));
+    priv.stats = input_stats_Create();
+    assert(priv.stats != NULL);
+    owner.p_input = &priv.input;
+    owner.p_vout = &vout;
+
+    /* The running totals are published while playing */
+    pacing = (vout_pacing_t) {
+        .late = 1, .timed = 4,
+        .offset_sum = VLC_TICK_FROM_MS(40), .offset_max = VLC_TICK_FROM_MS(25),
+    };
+    DecoderUpdateStatVideo(&owner, 4, 0);
+    input_stats_Compute(priv.stats, &st);
+    assert(st.i_displayed_pictures == 4);
+    assert(st.i_late_pictures == 1);
+    assert(st.i_display_offset_avg == VLC_TICK_FROM_MS(10));
+    assert(st.i_display_offset_max == VLC_TICK_FROM_MS(25));
+
+    /* The peak is kept across readings of the video output */
+    pacing = (vout_pacing_t) {
+        .late = 0, .timed = 4,
+        .offset_sum = VLC_TICK_FROM_MS(8), .offset_max = VLC_TICK_FROM_MS(3),
+    };
+    DecoderUpdateStatVideo(&owner, 4, 0);
+    input_stats_Compute(priv.stats, &st);
+    assert(st.i_displayed_pictures == 8);
+    assert(st.i_late_pictures == 1);
+    assert(st.i_display_offset_avg == VLC_TICK_FROM_MS(6));
+    assert(st.i_display_offset_max == VLC_TICK_FROM_MS(25));
+
+    input_stats_Destroy(priv.stats);
+}
+
+int main(void)
+{
+    test_init();
+
+    test_display_date();
+    test_pacing_stats();
+    return 0;
+}
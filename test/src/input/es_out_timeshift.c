@@ -0,0 +1,116 @@
+/*****************************************************************************
+ * es_out_timeshift.c: test the controls forwarded by the timeshift es_out
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include "../../../src/input/es_out_timeshift.c"
+
+const char vlc_module_name[] = "test_es_out_timeshift";
+
+#define SCRUB_DATE VLC_TICK_FROM_SEC(12)
+#define STEP_DATE VLC_TICK_FROM_SEC(34)
+
+/* Not reached by the scrub controls */
+void input_ControlPush(input_thread_t *input, int type,
+                       const input_control_param_t *param)
+{
+    (void) input; (void) type; (void) param;
+    vlc_assert_unreachable();
+}
+
+/* The es_out of the input, behind the timeshift one */
+static int next_query;
+static vlc_tick_t next_date;
+
+static int NextControl(es_out_t *out, int query, va_list args)
+{
+    (void) out;
+    next_query = query;
+
+    switch (query)
+    {
+        case ES_OUT_SCRUB:
+            next_date = va_arg(args, vlc_tick_t);
+            return VLC_SUCCESS;
+        case ES_OUT_SCRUB_STEP:
+            (void) va_arg(args, int);
+            *va_arg(args, vlc_tick_t *) = STEP_DATE;
+            return VLC_SUCCESS;
+        default:
+            vlc_assert_unreachable();
+    }
+}
+
+static const struct es_out_callbacks next_cbs =
+{
+    .control = NextControl,
+};
+
+static void test_scrub(void)
+{
+    es_out_t next = { .cbs = &next_cbs };
+    ts_thread_t ts;
+    es_out_sys_t sys;
+    es_out_t *out = &sys.out;
+    vlc_tick_t date;
+
+    memset(&ts, 0, sizeof (ts));
+    vlc_mutex_init(&ts.lock);
+
+    memset(&sys, 0, sizeof (sys));
+    sys.out.cbs = &es_out_timeshift_cbs;
+    sys.p_out = &next;
+    vlc_mutex_init_recursive(&sys.lock);
+
+    /* Without timeshift, the decoders follow the input */
+    next_query = -1;
+    assert(es_out_Scrub(out, SCRUB_DATE) == VLC_SUCCESS);
+    assert(next_query == ES_OUT_SCRUB && next_date == SCRUB_DATE);
+
+    next_query = -1;
+    date = VLC_TICK_INVALID;
+    assert(es_out_ScrubStep(out, true, &date) == VLC_SUCCESS);
+    assert(next_query == ES_OUT_SCRUB_STEP && date == STEP_DATE);
+
+    /* Paused while buffering into the timeshift: the decoders lag behind,
+     * their cached pictures must not be used */
+    ts.b_paused = true;
+    sys.p_ts = &ts;
+    sys.b_delayed = true;
+
+    next_query = -1;
+    assert(es_out_Scrub(out, SCRUB_DATE) == VLC_EGENERIC);
+    assert(next_query == -1);
+
+    date = STEP_DATE;
+    assert(es_out_ScrubStep(out, false, &date) == VLC_EGENERIC);
+    assert(next_query == -1 && date == VLC_TICK_INVALID);
+
+    /* Still delayed: the timeshift thread is in use */
+    assert(sys.b_delayed);
+}
+
+int main(void)
+{
+    test_init();
+
+    test_scrub();
+    return 0;
+}
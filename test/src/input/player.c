@@ -1551,6 +1551,75 @@ test_seeks(struct ctx *ctx)
     test_end(ctx);
 }
 
+/* Waits for the time of a picture shown from the scrubbing cache */
+static void
+wait_scrubbed(struct ctx *ctx, vlc_tick_t time)
+{
+    vec_on_position_changed *vec = &ctx->report.on_position_changed;
+    vec_on_buffering_changed *buffering = &ctx->report.on_buffering_changed;
+    const size_t buffering_count = buffering->size;
+
+    while (VEC_LAST(vec).time != time)
+    {
+        /* Decoding again would buffer */
+        assert(buffering->size == buffering_count);
+        vlc_player_CondWait(ctx->player, &ctx->wait);
+    }
+}
+
+static void
+wait_buffered(struct ctx *ctx)
+{
+    vec_on_buffering_changed *vec = &ctx->report.on_buffering_changed;
+    while (vec->size == 0 || VEC_LAST(vec) != 1.0f)
+        vlc_player_CondWait(ctx->player, &ctx->wait);
+}
+
+static void
+test_scrub(struct ctx *ctx)
+{
+    test_log("scrub\n");
+    vlc_player_t *player = ctx->player;
+
+    struct media_params params = DEFAULT_MEDIA_PARAMS(VLC_TICK_FROM_SEC(10));
+    player_set_next_mock_media(ctx, "media1", &params);
+
+    /* Decode the first second */
+    player_start(ctx);
+    {
+        vec_on_position_changed *vec = &ctx->report.on_position_changed;
+        while (vec->size == 0 || VEC_LAST(vec).time < VLC_TICK_FROM_SEC(1))
+            vlc_player_CondWait(player, &ctx->wait);
+    }
+    vlc_player_Pause(player);
+    wait_state(ctx, VLC_PLAYER_STATE_PAUSED);
+
+    /* The first precise seek decodes, and maps the times to the pictures */
+    vec_on_buffering_changed *buffering = &ctx->report.on_buffering_changed;
+    size_t buffering_count = buffering->size;
+    vlc_player_SetTime(player, VLC_TICK_FROM_MS(500));
+    while (buffering->size == buffering_count)
+        vlc_player_CondWait(player, &ctx->wait);
+    wait_buffered(ctx);
+
+    /* The mock pictures are dated every 40ms from VLC_TICK_0 */
+    vlc_player_SetTime(player, VLC_TICK_FROM_MS(300));
+    wait_scrubbed(ctx, VLC_TICK_FROM_MS(300));
+
+    vlc_player_PreviousVideoFrame(player);
+    wait_scrubbed(ctx, VLC_TICK_0 + VLC_TICK_FROM_MS(240));
+    vlc_player_PreviousVideoFrame(player);
+    wait_scrubbed(ctx, VLC_TICK_0 + VLC_TICK_FROM_MS(200));
+    vlc_player_NextVideoFrame(player);
+    wait_scrubbed(ctx, VLC_TICK_0 + VLC_TICK_FROM_MS(240));
+
+    /* Resuming decodes from the shown picture */
+    vlc_player_Resume(player);
+    wait_state(ctx, VLC_PLAYER_STATE_PLAYING);
+
+    test_end(ctx);
+}
+
 #define assert_media_name(media, name) do { \
     assert(media); \
     char *media_name = input_item_GetName(media); \
@@ -1700,6 +1769,7 @@ main(void)
         "--dec-dev=none",
         "--vout=dummy",
         "--aout=dummy",
+        "--scrub-cache=16",
     };
     libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
     assert(vlc);
@@ -1743,6 +1813,7 @@ REPORT_LIST
     test_next_media(&ctx);
     test_seeks(&ctx);
     test_pause(&ctx);
+    test_scrub(&ctx);
     test_capabilities_pause(&ctx);
     test_capabilities_seek(&ctx);
     test_error(&ctx);
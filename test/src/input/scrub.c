@@ -0,0 +1,187 @@
+/*****************************************************************************
+ * scrub.c: test the cache of decoded pictures used for scrubbing
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include "../../../src/input/scrub.c"
+
+#include <vlc_tick.h>
+
+#define FRAME VLC_TICK_FROM_MS(40)
+#define DATE(n) (VLC_TICK_0 + (n) * FRAME)
+
+static video_format_t fmt;
+
+/* Adds the pictures from..to, as a decoder outputs them */
+static void Decode(input_scrub_t *scrub, int from, int to)
+{
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+
+    for (int n = from; n <= to; n++)
+    {
+        pic->date = DATE(n);
+        memset(pic->p[0].p_pixels, n, pic->p[0].i_pitch * pic->p[0].i_lines);
+        input_scrub_Add(scrub, pic);
+    }
+    picture_Release(pic);
+}
+
+static void Check(picture_t *pic, int expected, const char *what)
+{
+    int n = pic != NULL ? (int)((pic->date - VLC_TICK_0) / FRAME) : -1;
+
+    if (n != expected
+     || (pic != NULL && pic->p[0].p_pixels[pic->p[0].i_pitch] != expected))
+    {
+        fprintf(stderr, "%s: got picture %d, expected %d\n", what, n,
+                expected);
+        abort();
+    }
+    if (pic != NULL)
+        picture_Release(pic);
+}
+
+static void test_scrub(void)
+{
+    input_scrub_t *scrub = input_scrub_New(SIZE_MAX);
+    assert(scrub != NULL);
+
+    /* Decoded from the keyframe 0 up to 9 */
+    Decode(scrub, 0, 9);
+    Check(input_scrub_Get(scrub, DATE(4)), 4, "get");
+    Check(input_scrub_Get(scrub, DATE(4) + FRAME / 2), 4, "get between");
+    Check(input_scrub_Get(scrub, DATE(0) - 1), -1, "get before");
+    /* Whether a later picture follows 9 is unknown */
+    Check(input_scrub_Get(scrub, DATE(9)), -1, "get last");
+
+    Check(input_scrub_Step(scrub, DATE(4), true), 5, "step forward");
+    Check(input_scrub_Step(scrub, DATE(4), false), 3, "step back");
+    Check(input_scrub_Step(scrub, DATE(0), false), -1, "step before");
+    Check(input_scrub_Step(scrub, DATE(9), true), -1, "step after");
+    Check(input_scrub_Step(scrub, DATE(4) + 1, true), -1, "step off date");
+
+    /* Seek to the keyframe 20 */
+    input_scrub_Flush(scrub);
+    Decode(scrub, 20, 25);
+    Check(input_scrub_Get(scrub, DATE(15)), -1, "get in the gap");
+    Check(input_scrub_Step(scrub, DATE(9), true), -1, "step over the gap");
+    Check(input_scrub_Step(scrub, DATE(20), false), -1, "step back over the gap");
+    Check(input_scrub_Get(scrub, DATE(22)), 22, "get after the gap");
+
+    /* Seek to the keyframe 10, joining both spans */
+    input_scrub_Flush(scrub);
+    Decode(scrub, 10, 20);
+    Check(input_scrub_Get(scrub, DATE(9)), -1, "get before the flush");
+    Check(input_scrub_Get(scrub, DATE(15)), 15, "get in the filled gap");
+    Check(input_scrub_Step(scrub, DATE(20), false), 19, "step back joined");
+    Check(input_scrub_Step(scrub, DATE(19), true), 20, "step forward joined");
+
+    /* Decoding again from the keyframe 0 keeps the known links */
+    input_scrub_Flush(scrub);
+    Decode(scrub, 0, 3);
+    Check(input_scrub_Get(scrub, DATE(5)), 5, "get after decoding again");
+
+    input_scrub_Delete(scrub);
+}
+
+static void test_evict(void)
+{
+    picture_t *pic = picture_NewFromFormat(&fmt);
+    assert(pic != NULL);
+    size_t size = 0;
+    for (int i = 0; i < pic->i_planes; i++)
+        size += pic->p[i].i_pitch * pic->p[i].i_lines;
+    picture_Release(pic);
+
+    input_scrub_t *scrub = input_scrub_New(4 * size);
+    assert(scrub != NULL);
+
+    /* Only the 4 last decoded pictures are kept */
+    Decode(scrub, 0, 9);
+    Check(input_scrub_Get(scrub, DATE(5)), -1, "get evicted");
+    Check(input_scrub_Step(scrub, DATE(6), false), -1, "step back evicted");
+    Check(input_scrub_Get(scrub, DATE(6)), 6, "get kept");
+    Check(input_scrub_Step(scrub, DATE(7), false), 6, "step back kept");
+
+    /* Scrubbing back keeps the pictures around the requested one */
+    input_scrub_Flush(scrub);
+    Decode(scrub, 0, 2);
+    Check(input_scrub_Get(scrub, DATE(1)), 1, "get decoded again");
+    Decode(scrub, 3, 3);
+    Check(input_scrub_Get(scrub, DATE(2)), 2, "get after eviction");
+    Check(input_scrub_Get(scrub, DATE(6)), -1, "get far evicted");
+
+    /* Pictures larger than the cache are not kept */
+    input_scrub_t *tiny = input_scrub_New(size - 1);
+    assert(tiny != NULL);
+    Decode(tiny, 0, 3);
+    Check(input_scrub_Get(tiny, DATE(1)), -1, "get too large");
+    input_scrub_Delete(tiny);
+
+    input_scrub_Delete(scrub);
+}
+
+static void bench(unsigned count)
+{
+    video_format_t hd;
+    video_format_Setup(&hd, VLC_CODEC_I420, 1920, 1080, 1920, 1080, 1, 1);
+
+    input_scrub_t *scrub = input_scrub_New(SIZE_MAX);
+    picture_t *pic = picture_NewFromFormat(&hd);
+    assert(scrub != NULL && pic != NULL);
+
+    /* A GOP of 25 pictures */
+    for (int n = 0; n < 25; n++)
+    {
+        pic->date = DATE(n);
+        input_scrub_Add(scrub, pic);
+    }
+    picture_Release(pic);
+
+    vlc_tick_t start = vlc_tick_now();
+    for (unsigned n = 0; n < count; n++)
+    {
+        pic = input_scrub_Step(scrub, DATE(1 + n % 24), false);
+        assert(pic != NULL);
+        picture_Release(pic);
+    }
+    vlc_tick_t time = vlc_tick_now() - start;
+    printf("1080p, step back from the cache: %.1f frames/s\n",
+           count / secf_from_vlc_tick(time));
+
+    input_scrub_Delete(scrub);
+}
+
+int main(int argc, char **argv)
+{
+    test_init();
+
+    video_format_Setup(&fmt, VLC_CODEC_I420, 64, 48, 64, 48, 1, 1);
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        bench(argc > 2 ? atoi(argv[2]) : 1000);
+    else
+    {
+        test_scrub();
+        test_evict();
+    }
+    return 0;
+}
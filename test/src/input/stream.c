@@ -23,6 +23,7 @@
 
 #include <vlc_md5.h>
 #include <vlc_stream.h>
+#include <vlc_modules.h>
 #include <vlc_rand.h>
 #include <vlc_fs.h>
 
@@ -47,6 +48,7 @@ struct reader
         stream_t *s;
     } u;
     void *p_data;
+    void *p_peek;
 
     void        (*pf_close)( struct reader * );
     uint64_t    (*pf_getsize)( struct reader * );
@@ -161,6 +163,24 @@ stream_peek( struct reader *p_reader, const uint8_t **pp_buf, size_t i_len )
     return vlc_stream_Peek( p_reader->u.s, pp_buf, i_len );
 }
 
+static ssize_t
+stream_peek_chain( struct reader *p_reader, const uint8_t **pp_buf,
+                   size_t i_len )
+{
+    const block_t *p_chain;
+    ssize_t i_ret = vlc_stream_PeekChain( p_reader->u.s, &p_chain, i_len );
+
+    if( i_ret <= 0 )
+        return i_ret;
+
+    free( p_reader->p_peek );
+    p_reader->p_peek = malloc( i_ret );
+    assert( p_reader->p_peek );
+    *pp_buf = vlc_stream_ChainAt( p_chain, 0, i_ret, p_reader->p_peek );
+    assert( *pp_buf );
+    return i_ret;
+}
+
 static uint64_t
 stream_tell( struct reader *p_reader )
 {
@@ -178,11 +198,12 @@ stream_close( struct reader *p_reader )
 {
     vlc_stream_Delete( p_reader->u.s );
     libvlc_release( p_reader->p_data );
+    free( p_reader->p_peek );
     free( p_reader );
 }
 
 static struct reader *
-stream_open( const char *psz_url )
+stream_open( const char *psz_url, const char *psz_opt )
 {
     libvlc_instance_t *p_vlc;
     struct reader *p_reader;
@@ -194,12 +215,14 @@ stream_open( const char *psz_url )
         "--no-media-library",
         "--vout=dummy",
         "--aout=dummy",
+        psz_opt,
     };
+    int i_argc = sizeof(argv) / sizeof(argv[0]) - ( psz_opt == NULL );
 
     p_reader = calloc( 1, sizeof(struct reader) );
     assert( p_reader );
 
-    p_vlc = libvlc_new( sizeof(argv) / sizeof(argv[0]), argv );
+    p_vlc = libvlc_new( i_argc, argv );
     assert( p_vlc != NULL );
 
     p_reader->u.s = vlc_stream_NewURL( p_vlc->p_libvlc_int, psz_url );
@@ -216,7 +239,7 @@ stream_open( const char *psz_url )
     p_reader->pf_tell = stream_tell;
     p_reader->pf_seek = stream_seek;
     p_reader->p_data = p_vlc;
-    p_reader->psz_name = "stream";
+    p_reader->psz_name = psz_opt ? psz_opt : "stream";
     return p_reader;
 }
 
@@ -341,6 +364,12 @@ test( struct reader **pp_readers, unsigned int i_readers, const char *psz_md5 )
     PEEK_AT( i_size - 23, 46 );
     PEEK_AT( i_size / 2, 46 );
     PEEK_AT( 0, 46 );
+
+    /* Test large peeks, then reads and seeks within them */
+    PEEK_AT( i_size / 3, 5 * 4096 + 17 );
+    READ_AT( i_size / 3 + 4095, 45 );
+    PEEK_AT( i_size / 3 + 4095 + 45, 3 * 4096 );
+    READ_AT( i_size / 3 + 3 * 4096, 4096 );
 }
 
 #ifndef TEST_NET
@@ -365,7 +394,7 @@ fill_rand( int i_fd, size_t i_size )
 int
 main( void )
 {
-    struct reader *pp_readers[3];
+    struct reader *pp_readers[4];
 
     test_init();
 
@@ -377,15 +406,25 @@ main( void )
     test_log( "Generating random file...\n" );
     i_tmp_fd = vlc_mkstemp( psz_tmp_path );
     fill_rand( i_tmp_fd, RAND_FILE_SIZE );
-    test_log( "Testing random file with libc, and stream...\n" );
+    test_log( "Testing random file with libc, stream and io_uring...\n" );
     assert( i_tmp_fd != -1 );
     assert( asprintf( &psz_url, "file://%s", psz_tmp_path ) != -1 );
 
-    assert( ( pp_readers[0] = libc_open( psz_tmp_path ) ) );
-    assert( ( pp_readers[1] = stream_open( psz_url ) ) );
-
-    test( pp_readers, 2, NULL );
-    for( unsigned int i = 0; i < 2; ++i )
+    unsigned int i_readers = 0;
+    assert( ( pp_readers[i_readers++] = libc_open( psz_tmp_path ) ) );
+    assert( ( pp_readers[i_readers++] = stream_open( psz_url, NULL ) ) );
+    /* The module is only built where <linux/io_uring.h> is found, and
+     * falls back to the file access if io_uring is not available */
+    if( module_exists( "uring" ) )
+        assert( ( pp_readers[i_readers++] = stream_open( psz_url, "--uring" ) ) );
+    else
+        test_log( "io_uring access not built, skipping it\n" );
+    assert( ( pp_readers[i_readers] = stream_open( psz_url, NULL ) ) );
+    pp_readers[i_readers]->pf_peek = stream_peek_chain;
+    pp_readers[i_readers++]->psz_name = "chain";
+
+    test( pp_readers, i_readers, NULL );
+    for( unsigned int i = 0; i < i_readers; ++i )
         pp_readers[i]->pf_close( pp_readers[i] );
     free( psz_url );
 
@@ -394,7 +433,7 @@ main( void )
 
     test_log( "Testing http url with stream...\n" );
     alarm( 0 );
-    if( !( pp_readers[0] = stream_open( HTTP_URL ) ) )
+    if( !( pp_readers[0] = stream_open( HTTP_URL, NULL ) ) )
     {
         test_log( "WARNING: can't test http url" );
         return 0;
@@ -207,19 +207,195 @@ static void test_cancel_thumbnail( libvlc_instance_t* p_vlc )
     vlc_thumbnailer_Release( p_thumbnailer );
 }
 
-int main()
+struct batch_ctx
+{
+    vlc_cond_t cond;
+    vlc_mutex_t lock;
+    const vlc_tick_t *times;
+    unsigned *calls;
+    size_t count;
+    size_t done;
+    bool b_expected_success;
+};
+
+static void thumbnailer_batch_callback( void* data, size_t index,
+                                        picture_t* thumbnail )
+{
+    struct batch_ctx* p_ctx = data;
+    vlc_mutex_lock( &p_ctx->lock );
+
+    assert( index < p_ctx->count );
+    assert( p_ctx->calls[index]++ == 0 && "Thumbnail delivered twice" );
+    if ( thumbnail != NULL )
+    {
+        assert( p_ctx->b_expected_success &&
+                "Expected failure but got a thumbnail" );
+        assert( thumbnail->format.i_chroma == VLC_CODEC_ARGB );
+        /* Scaled to 64 pixels wide, keeping the 4:3 aspect ratio */
+        assert( thumbnail->format.i_visible_width == 64 );
+        assert( thumbnail->format.i_visible_height == 48 );
+        /* The mock video pictures are filled from their time */
+        const vlc_tick_t time = p_ctx->times[index];
+        assert( thumbnail->p[0].p_pixels[0] ==
+                ( time / VLC_TICK_FROM_MS( 10 ) ) % 255 );
+    }
+    else
+        assert( !p_ctx->b_expected_success &&
+                "Expected a thumbnail but got a failure" );
+
+    p_ctx->done++;
+    vlc_cond_signal( &p_ctx->cond );
+    vlc_mutex_unlock( &p_ctx->lock );
+}
+
+static void test_batch_thumbnails( libvlc_instance_t* p_vlc )
+{
+    vlc_thumbnailer_t* p_thumbnailer = vlc_thumbnailer_Create(
+                VLC_OBJECT( p_vlc->p_libvlc_int ) );
+    assert( p_thumbnailer != NULL );
+
+    /* Unsorted, with a duplicate */
+    static const vlc_tick_t times[] = {
+        VLC_TICK_FROM_SEC( 120 ), VLC_TICK_FROM_SEC( 30 ),
+        VLC_TICK_FROM_SEC( 90 ), VLC_TICK_FROM_SEC( 30 ),
+        VLC_TICK_FROM_SEC( 270 ), VLC_TICK_FROM_MS( 60250 ),
+    };
+    unsigned calls[ARRAY_SIZE(times)];
+
+    struct batch_ctx ctx;
+    vlc_cond_init( &ctx.cond );
+    vlc_mutex_init( &ctx.lock );
+    ctx.times = times;
+    ctx.calls = calls;
+    ctx.count = ARRAY_SIZE(times);
+
+    for ( unsigned i = 0; i < 3; ++i )
+    {
+        /* Fast seek, precise seek, and a file without video */
+        const bool b_video = i < 2;
+        char* psz_mrl;
+
+        if ( asprintf( &psz_mrl, "mock://video_track_count=%u;audio_track_count=1"
+                       ";length=%" PRId64 ";video_chroma=ARGB",
+                       b_video, MOCK_DURATION ) < 0 )
+            assert( !"Failed to allocate mock mrl" );
+        input_item_t* p_item = input_item_New( psz_mrl, "mock item" );
+        assert( p_item != NULL );
+
+        memset( calls, 0, sizeof( calls ) );
+        ctx.done = 0;
+        ctx.b_expected_success = b_video;
+
+        vlc_mutex_lock( &ctx.lock );
+        vlc_thumbnailer_request_t* p_req = vlc_thumbnailer_RequestBatch(
+            p_thumbnailer, times, ARRAY_SIZE(times),
+            i == 0 ? VLC_THUMBNAILER_SEEK_FAST : VLC_THUMBNAILER_SEEK_PRECISE,
+            64, 0, p_item, VLC_TICK_FROM_SEC( b_video ? 5 : 1 ),
+            thumbnailer_batch_callback, &ctx );
+        assert( p_req != NULL );
+
+        while ( ctx.done < ARRAY_SIZE(times) )
+        {
+            vlc_tick_t timeout = vlc_tick_now() + VLC_TICK_FROM_SEC( 5 );
+            int res = vlc_cond_timedwait( &ctx.cond, &ctx.lock, timeout );
+            assert( res != ETIMEDOUT );
+        }
+        vlc_mutex_unlock( &ctx.lock );
+
+        input_item_Release( p_item );
+        free( psz_mrl );
+    }
+    vlc_thumbnailer_Release( p_thumbnailer );
+}
+
+static void bench_batch_callback( void* data, size_t index,
+                                  picture_t* thumbnail )
+{
+    struct batch_ctx* p_ctx = data;
+    VLC_UNUSED( index );
+    assert( thumbnail != NULL );
+    vlc_mutex_lock( &p_ctx->lock );
+    p_ctx->done++;
+    vlc_cond_signal( &p_ctx->cond );
+    vlc_mutex_unlock( &p_ctx->lock );
+}
+
+static void bench_callback( void* data, picture_t* thumbnail )
+{
+    bench_batch_callback( data, 0, thumbnail );
+}
+
+/* Contact sheet of 50 thumbnails, taken one by one, then as a batch */
+static void bench( libvlc_instance_t* p_vlc )
+{
+    vlc_thumbnailer_t* p_thumbnailer = vlc_thumbnailer_Create(
+                VLC_OBJECT( p_vlc->p_libvlc_int ) );
+    assert( p_thumbnailer != NULL );
+
+    vlc_tick_t times[50];
+    for ( size_t i = 0; i < ARRAY_SIZE(times); i++ )
+        times[i] = MOCK_DURATION * i / ARRAY_SIZE(times);
+
+    struct batch_ctx ctx;
+    vlc_cond_init( &ctx.cond );
+    vlc_mutex_init( &ctx.lock );
+
+    char* psz_mrl;
+    if ( asprintf( &psz_mrl, "mock://video_track_count=1;length=%" PRId64
+                   ";video_chroma=ARGB;video_width=320;video_height=240",
+                   MOCK_DURATION ) < 0 )
+        assert( !"Failed to allocate mock mrl" );
+    input_item_t* p_item = input_item_New( psz_mrl, "mock item" );
+    assert( p_item != NULL );
+
+    for ( unsigned b_batch = 0; b_batch < 2; b_batch++ )
+    {
+        ctx.done = 0;
+
+        vlc_tick_t start = vlc_tick_now();
+        vlc_mutex_lock( &ctx.lock );
+        if ( b_batch )
+            vlc_thumbnailer_RequestBatch( p_thumbnailer, times,
+                ARRAY_SIZE(times), VLC_THUMBNAILER_SEEK_FAST, 64, 0, p_item,
+                VLC_TICK_INVALID, bench_batch_callback, &ctx );
+        for ( size_t i = 0; i < ARRAY_SIZE(times); i++ )
+        {
+            if ( !b_batch )
+                vlc_thumbnailer_RequestByTime( p_thumbnailer, times[i],
+                    VLC_THUMBNAILER_SEEK_FAST, p_item, VLC_TICK_INVALID,
+                    bench_callback, &ctx );
+            while ( ctx.done <= i )
+                vlc_cond_wait( &ctx.cond, &ctx.lock );
+        }
+        vlc_mutex_unlock( &ctx.lock );
+        printf( "50 thumbnails, %s: %.1f ms\n", b_batch ? "batch" : "single",
+                secf_from_vlc_tick( vlc_tick_now() - start ) * 1000. );
+    }
+
+    input_item_Release( p_item );
+    free( psz_mrl );
+    vlc_thumbnailer_Release( p_thumbnailer );
+}
+
+int main( int argc, char** argv )
 {
     test_init();
 
-    static const char * argv[] = {
+    static const char * args[] = {
         "-v",
         "--ignore-config",
     };
-    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(args), args);
     assert(vlc);
 
-    test_thumbnails( vlc );
-    test_cancel_thumbnail( vlc );
+    if ( argc > 1 && !strcmp( argv[1], "bench" ) )
+        bench( vlc );
+    else
+    {
+        test_thumbnails( vlc );
+        test_cancel_thumbnail( vlc );
+        test_batch_thumbnails( vlc );
+    }
 
     libvlc_release( vlc );
 }
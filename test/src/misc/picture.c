@@ -0,0 +1,164 @@
+/*****************************************************************************
+ * picture.c: test picture area copies
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "../../libvlc/test.h"
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_tick.h>
+
+static picture_t *picture_NewFilled(vlc_fourcc_t chroma, unsigned width,
+                                    unsigned height, bool random)
+{
+    picture_t *pic = picture_New(chroma, width, height, 1, 1);
+    assert(pic != NULL);
+
+    for (int i = 0; i < pic->i_planes; i++)
+    {
+        plane_t *p = &pic->p[i];
+        for (int j = 0; j < p->i_pitch * p->i_lines; j++)
+            p->p_pixels[j] = random ? 1 + rand() % 255 : 0;
+    }
+    return pic;
+}
+
+/* Checks that the area, and only the area extended to the chroma samples,
+ * was copied */
+static void test_area(vlc_fourcc_t chroma, unsigned x, unsigned y,
+                      unsigned width, unsigned height)
+{
+    const vlc_chroma_description_t *dsc =
+        vlc_fourcc_GetChromaDescription(chroma);
+    assert(dsc != NULL);
+
+    picture_t *src = picture_NewFilled(chroma, 320, 240, true);
+    picture_t *dst = picture_NewFilled(chroma, 320, 240, false);
+
+    picture_CopyArea(dst, src, x, y, width, height);
+
+    for (int i = 0; i < src->i_planes; i++)
+    {
+        const plane_t *in = &src->p[i], *out = &dst->p[i];
+        const vlc_rational_t w = dsc->p[i].w, h = dsc->p[i].h;
+
+        /* Area covered by the samples of the requested pixels */
+        const unsigned left = x * w.num / w.den * dsc->pixel_size;
+        const unsigned right = __MIN((unsigned)out->i_pitch,
+            ((x + width) * w.num + w.den - 1) / w.den * dsc->pixel_size);
+        const unsigned top = y * h.num / h.den;
+        const unsigned bottom = __MIN((unsigned)out->i_lines,
+            ((y + height) * h.num + h.den - 1) / h.den);
+        /* Largest alignment margin */
+        const unsigned margin = 4 * dsc->pixel_size;
+
+        for (int line = 0; line < out->i_lines; line++)
+            for (int col = 0; col < out->i_pitch; col++)
+            {
+                const uint8_t a = in->p_pixels[line * in->i_pitch + col];
+                const uint8_t b = out->p_pixels[line * out->i_pitch + col];
+
+                if ((unsigned)line >= top && (unsigned)line < bottom
+                 && (unsigned)col >= left && (unsigned)col < right)
+                    assert(a == b);
+                else if ((unsigned)line + 4 < top || (unsigned)line >= bottom
+                      || (unsigned)col + margin < left
+                      || (unsigned)col >= right + margin)
+                    assert(b == 0);
+            }
+    }
+
+    picture_Release(src);
+    picture_Release(dst);
+}
+
+/* Compares the cost of a full frame copy, as done to blend subpictures on a
+ * shared picture, with saving and restoring the areas under the
+ * subpicture regions, as done on a picture owned by the video output */
+static void bench(unsigned frames)
+{
+    static const struct
+    {
+        const char *name;
+        unsigned width, height;
+    } sizes[] = {
+        { "HD",  1920, 1080 },
+        { "UHD", 3840, 2160 },
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        const unsigned width = sizes[i].width, height = sizes[i].height;
+        picture_t *src = picture_NewFilled(VLC_CODEC_I420, width, height, true);
+        picture_t *dst = picture_NewFilled(VLC_CODEC_I420, width, height, false);
+        /* Two lines of subtitles */
+        const unsigned area_w = width * 2 / 3, area_h = height / 9;
+        const unsigned area_x = (width - area_w) / 2, area_y = height - 2 * area_h;
+
+        vlc_tick_t start = vlc_tick_now();
+        for (unsigned f = 0; f < frames; f++)
+            picture_Copy(dst, src);
+        const vlc_tick_t full = vlc_tick_now() - start;
+
+        start = vlc_tick_now();
+        for (unsigned f = 0; f < frames; f++)
+        {
+            picture_CopyArea(dst, src, area_x, area_y, area_w, area_h);
+            picture_CopyArea(src, dst, area_x, area_y, area_w, area_h);
+        }
+        const vlc_tick_t area = vlc_tick_now() - start;
+
+        printf("%s: full frame copy %"PRId64" us/frame, "
+               "save and restore %ux%u %"PRId64" us/frame\n", sizes[i].name,
+               US_FROM_VLC_TICK(full) / frames, area_w, area_h,
+               US_FROM_VLC_TICK(area) / frames);
+
+        picture_Release(src);
+        picture_Release(dst);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    test_init();
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+    {
+        bench(argc > 2 ? atoi(argv[2]) : 100);
+        return 0;
+    }
+
+    static const vlc_fourcc_t chromas[] = {
+        VLC_CODEC_I420, VLC_CODEC_I422, VLC_CODEC_I410, VLC_CODEC_NV12,
+        VLC_CODEC_YUYV, VLC_CODEC_RGBA, VLC_CODEC_I420_10L,
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(chromas); i++)
+    {
+        test_area(chromas[i], 0, 0, 320, 240);
+        test_area(chromas[i], 17, 33, 101, 45);
+        test_area(chromas[i], 250, 201, 200, 100); /* clipped */
+        test_area(chromas[i], 31, 7, 1, 1);
+        test_area(chromas[i], 400, 300, 10, 10); /* outside */
+    }
+
+    return 0;
+}
@@ -444,6 +444,141 @@ static void test_creation_and_type( libvlc_int_t *p_libvlc )
     assert( var_Get( p_libvlc, "bla", &val ) == VLC_ENOVAR );
 }
 
+static int handle_callback( vlc_object_t *p_this, char const *psz_var,
+                            vlc_value_t oldval, vlc_value_t newval,
+                            void *p_data )
+{
+    (void)p_this;
+
+    assert( !strcmp( psz_var, "bla" ) );
+    assert( oldval.i_int == 10 && newval.i_int == 5 );
+    ( *(unsigned *)p_data )++;
+    return VLC_SUCCESS;
+}
+
+static void test_handles( libvlc_int_t *p_libvlc )
+{
+    unsigned i_calls = 0;
+    vlc_var_t *p_var;
+
+    assert( var_Resolve( p_libvlc, "bla" ) == NULL );
+
+    var_Create( p_libvlc, "bla", VLC_VAR_INTEGER );
+    var_SetInteger( p_libvlc, "bla", 42 );
+    p_var = var_Resolve( p_libvlc, "bla" );
+    assert( p_var != NULL );
+    assert( var_HandleGetInteger( p_var ) == 42 );
+
+    /* Values set by name and by handle are the same */
+    var_HandleSetInteger( p_libvlc, p_var, 1234 );
+    assert( var_GetInteger( p_libvlc, "bla" ) == 1234 );
+    var_SetInteger( p_libvlc, "bla", -1 );
+    assert( var_HandleGetInteger( p_var ) == -1 );
+    var_IncInteger( p_libvlc, "bla" );
+    assert( var_HandleGetInteger( p_var ) == 0 );
+
+    /* Limits apply to handles */
+    var_Change( p_libvlc, "bla", VLC_VAR_SETMINMAX,
+                (vlc_value_t){ .i_int = 0 }, (vlc_value_t){ .i_int = 10 } );
+    var_HandleSetInteger( p_libvlc, p_var, 20 );
+    assert( var_HandleGetInteger( p_var ) == 10 );
+
+    /* Callbacks are triggered through handles */
+    var_AddCallback( p_libvlc, "bla", handle_callback, &i_calls );
+    var_HandleSetInteger( p_libvlc, p_var, 5 );
+    var_DelCallback( p_libvlc, "bla", handle_callback, &i_calls );
+    assert( i_calls == 1 );
+
+    /* The handle holds the variable */
+    var_Destroy( p_libvlc, "bla" );
+    assert( var_HandleGetInteger( p_var ) == 5 );
+    assert( var_GetInteger( p_libvlc, "bla" ) == 5 );
+    var_Release( p_libvlc, p_var );
+    assert( var_Type( p_libvlc, "bla" ) == 0 );
+
+    var_Create( p_libvlc, "bla", VLC_VAR_FLOAT );
+    p_var = var_Resolve( p_libvlc, "bla" );
+    var_HandleSetFloat( p_libvlc, p_var, 4.5f );
+    assert( var_HandleGetFloat( p_var ) == 4.5f );
+    assert( var_GetFloat( p_libvlc, "bla" ) == 4.5f );
+    var_Release( p_libvlc, p_var );
+    var_Destroy( p_libvlc, "bla" );
+
+    var_Create( p_libvlc, "bla", VLC_VAR_BOOL );
+    p_var = var_Resolve( p_libvlc, "bla" );
+    var_ToggleBool( p_libvlc, "bla" );
+    assert( var_HandleGetBool( p_var ) );
+    var_HandleSetBool( p_libvlc, p_var, false );
+    assert( !var_GetBool( p_libvlc, "bla" ) );
+    var_Release( p_libvlc, p_var );
+    var_Destroy( p_libvlc, "bla" );
+
+    int32_t x, y;
+    var_Create( p_libvlc, "bla", VLC_VAR_COORDS );
+    p_var = var_Resolve( p_libvlc, "bla" );
+    var_HandleSetCoords( p_libvlc, p_var, -3, 7 );
+    var_GetCoords( p_libvlc, "bla", &x, &y );
+    assert( x == -3 && y == 7 );
+    var_SetCoords( p_libvlc, "bla", 640, 480 );
+    var_HandleGetCoords( p_var, &x, &y );
+    assert( x == 640 && y == 480 );
+    var_Release( p_libvlc, p_var );
+    var_Destroy( p_libvlc, "bla" );
+}
+
+static void bench( libvlc_int_t *p_libvlc, unsigned count )
+{
+    char psz_name[16];
+    vlc_tick_t start, time;
+    int64_t i_sum = 0;
+
+    /* About as many variables as a video output holds */
+    for( unsigned i = 0; i < 100; i++ )
+    {
+        snprintf( psz_name, sizeof (psz_name), "bench-%u", i );
+        var_Create( p_libvlc, psz_name, VLC_VAR_INTEGER );
+    }
+    vlc_var_t *p_var = var_Resolve( p_libvlc, "bench-50" );
+    assert( p_var != NULL );
+
+    start = vlc_tick_now();
+    for( unsigned i = 0; i < count; i++ )
+        var_SetInteger( p_libvlc, "bench-50", i );
+    time = vlc_tick_now() - start;
+    printf( "var_SetInteger():       %5.1f ns\n",
+            1e9 * secf_from_vlc_tick( time ) / count );
+
+    start = vlc_tick_now();
+    for( unsigned i = 0; i < count; i++ )
+        var_HandleSetInteger( p_libvlc, p_var, i );
+    time = vlc_tick_now() - start;
+    printf( "var_HandleSetInteger(): %5.1f ns\n",
+            1e9 * secf_from_vlc_tick( time ) / count );
+
+    start = vlc_tick_now();
+    for( unsigned i = 0; i < count; i++ )
+        i_sum += var_GetInteger( p_libvlc, "bench-50" );
+    time = vlc_tick_now() - start;
+    printf( "var_GetInteger():       %5.1f ns\n",
+            1e9 * secf_from_vlc_tick( time ) / count );
+
+    start = vlc_tick_now();
+    for( unsigned i = 0; i < count; i++ )
+        i_sum += var_HandleGetInteger( p_var );
+    time = vlc_tick_now() - start;
+    printf( "var_HandleGetInteger(): %5.1f ns\n",
+            1e9 * secf_from_vlc_tick( time ) / count );
+
+    /* Both loops read the last value set */
+    assert( i_sum == 2 * (int64_t)count * (count - 1) );
+    var_Release( p_libvlc, p_var );
+    for( unsigned i = 0; i < 100; i++ )
+    {
+        snprintf( psz_name, sizeof (psz_name), "bench-%u", i );
+        var_Destroy( p_libvlc, psz_name );
+    }
+}
+
 static void test_variables( libvlc_instance_t *p_vlc )
 {
     libvlc_int_t *p_libvlc = p_vlc->p_libvlc_int;
@@ -481,10 +616,13 @@ static void test_variables( libvlc_instance_t *p_vlc )
 
     test_log( "Testing type at creation\n" );
     test_creation_and_type( p_libvlc );
+
+    test_log( "Testing variable handles\n" );
+    test_handles( p_libvlc );
 }
 
 
-int main( void )
+int main( int argc, char **argv )
 {
     libvlc_instance_t *p_vlc;
 
@@ -494,7 +632,11 @@ int main( void )
     p_vlc = libvlc_new( test_defaults_nargs, test_defaults_args );
     assert( p_vlc != NULL );
 
-    test_variables( p_vlc );
+    if( argc > 1 && !strcmp( argv[1], "bench" ) )
+        bench( p_vlc->p_libvlc_int,
+               argc > 2 ? atoi( argv[2] ) : 10000000 );
+    else
+        test_variables( p_vlc );
 
     libvlc_release( p_vlc );
 